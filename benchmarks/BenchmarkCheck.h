@@ -0,0 +1,27 @@
+#ifndef _BENCHMARKCHECK_H_
+#define _BENCHMARKCHECK_H_
+
+#include <cstdio>
+
+/*
+ * the pass/fail bookkeeping of the benchmarks
+ *
+ * Check() counts and names every condition that does not hold; a benchmark prints
+ * failures at the end and returns -1 when there were any. every benchmark is a single
+ * translation unit, so each gets its own count.
+ */
+namespace {
+
+unsigned int failures{0};
+
+void Check(const char *what, const bool ok)
+{
+  if(ok)
+    return;
+  ++failures;
+  printf("  %s FAILED\n", what);
+}
+
+} // namespace
+
+#endif // _BENCHMARKCHECK_H_
@@ -0,0 +1,281 @@
+#include <climits>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+#include <ElapsedTimes.hpp>
+
+#include "BenchmarkCheck.h"
+
+// OS Interface
+#include "osiBus.h"
+#include "tSimulatedXSeries.h"
+
+#include <AoStream.h>
+#include <SampleScaling.h>
+
+/*
+ * AoStream on a simulated x series board at the motor model rate
+ *
+ * three phase currents go out at 100 kS/s per channel while this thread plays the model
+ * step: it pushes one frame per 10 us update and polls every 100 us, with the model
+ * clock advanced by hand. every frame carries its index, so the codes that come out of
+ * the model tell which frame each update was: it must be the next one, a repeat of the
+ * last one counted as held, or a jump over frames counted as dropped, and the three
+ * channels of an update must belong to the same frame. the push to update latency must
+ * stay within twice the write-ahead and a poll. the source runs steady with jitter,
+ * stalls and then catches up in a burst, and runs off the board clock either way;
+ * none of it may underflow the fifo. Poll() is timed including the model behind it.
+ */
+
+namespace {
+
+constexpr auto kChannels = 3u;
+constexpr auto kUpdateNs = 10000ull; // 100 kS/s
+constexpr auto kUpdateTicks = 1000u;
+constexpr auto kIndexes = 4096u; // frame indexes the codes tell apart
+constexpr auto kMinWriteAhead = 32u; // three polls of updates
+constexpr auto kMaxWriteAhead = 256u;
+
+tSimulatedXSeries *simulated{NULL};
+// amps of frame index, ramps of about 13 codes per frame on all three channels
+AoFrame Frame(const unsigned int index)
+{
+  const float amps = (static_cast<int>(index % kIndexes) - 2048) * 0.004f;
+  return AoFrame{{amps, -amps, 0.5f * amps}};
+}
+
+struct Sink
+{
+  int16_t mCodes[kIndexes][kChannels]; // expected codes per frame index
+  int mIndexOfCode[65536]; // channel 0 code to frame index
+  unsigned long long mPushNs[kIndexes];
+  int16_t mUpdate[kChannels];
+  int mLast;
+  unsigned long long mUpdates;
+  unsigned long long mRepeats;
+  unsigned long long mSkipped;
+  unsigned long long mWrong;
+  unsigned long long mMaxLatencyNs;
+  unsigned long long mLatencyFromNs; // latency counts from this model time on
+};
+
+void Record(void *context, u32 channel, i16 code, u64 ns)
+{
+  auto &sink = *static_cast<Sink*>(context);
+  sink.mUpdate[channel] = code;
+  if(channel != kChannels - 1)
+    return;
+
+  ++sink.mUpdates;
+  const auto index = sink.mIndexOfCode[static_cast<uint16_t>(sink.mUpdate[0])];
+  if(index < 0 || memcmp(sink.mUpdate, sink.mCodes[index], sizeof(sink.mUpdate)) != 0)
+  {
+    ++sink.mWrong;
+    return;
+  }
+  const auto step = (index - sink.mLast + kIndexes) % kIndexes;
+  if(step == 0)
+  {
+    ++sink.mRepeats;
+    return;
+  }
+  if(step > kIndexes / 2)
+  {
+    ++sink.mWrong;
+    return;
+  }
+  sink.mSkipped += step - 1;
+  sink.mLast = index;
+  if(ns >= sink.mLatencyFromNs && ns - sink.mPushNs[index] > sink.mMaxLatencyNs)
+    sink.mMaxLatencyNs = ns - sink.mPushNs[index];
+}
+
+struct Source
+{
+  const char *mName;
+  unsigned int mJitterFrames; // up to this many frames of a poll come one poll late
+  double mPpm; // step period off the board clock, faster when positive
+  unsigned long long mStallAfterNs;
+  unsigned long long mStallNs; // the steps of a stall all come at its end
+};
+
+unsigned int Random()
+{
+  static unsigned int state{12345};
+  state ^= state << 13;
+  state ^= state >> 17;
+  state ^= state << 5;
+  return state;
+}
+
+void Run(iBus *bus, Sink &sink, const Source &source, const unsigned int polls,
+  const unsigned long long pollNs, utils::ElapsedTimes &pollTimes, double &pollSeconds)
+{
+  printf("\n%s\n", source.mName);
+  simulated->setAoSink(kChannels, kUpdateNs, Record, &sink);
+
+  AoStreamConfig config{kChannels, nNISTC3::kOutput_10V, kUpdateTicks, kMinWriteAhead,
+    kMaxWriteAhead, {{1.f, 0.f}, {1.f, 0.f}, {1.f, 0.f}}};
+  auto stream = std::make_unique<AoStream>("ao", bus, config);
+  Check("open", stream->Open() == 0);
+  if(failures)
+    return;
+
+  // every index the codes of the stream's scaling, the portable kernel as reference
+  std::vector<float> planes[kChannels];
+  for(auto &plane : planes)
+  {
+    plane.resize(kIndexes);
+  }
+  for(auto i{0u}; i < kIndexes; ++i)
+  {
+    const auto frame = Frame(i);
+    for(auto j{0u}; j < kChannels; ++j)
+    {
+      planes[j][i] = frame.mValues[j];
+    }
+  }
+  const float *channels[] = {planes[0].data(), planes[1].data(), planes[2].data()};
+  ScaleAoScalar(stream->Scaling(), channels, kIndexes, &sink.mCodes[0][0]);
+  for(auto &index : sink.mIndexOfCode)
+  {
+    index = -1;
+  }
+  auto unique{true};
+  for(auto i{0u}; i < kIndexes; ++i)
+  {
+    auto &index = sink.mIndexOfCode[static_cast<uint16_t>(sink.mCodes[i][0])];
+    unique = unique && index < 0;
+    index = i;
+  }
+  Check("frame codes unique", unique);
+
+  // the initial frame is the one before index 0
+  sink.mLast = kIndexes - 1;
+  sink.mUpdates = sink.mRepeats = sink.mSkipped = sink.mWrong = sink.mMaxLatencyNs = 0;
+  const auto startNs = simulated->getTime();
+  const auto endNs = startNs + polls * pollNs;
+  sink.mLatencyFromNs = startNs + 3 * (endNs - startNs) / 4;
+  const auto underflows = simulated->getUnderflows();
+  Check("start", stream->Start(Frame(kIndexes - 1)) == 0);
+
+  const double stepNs = kUpdateNs * (1. - source.mPpm * 1e-6);
+  double dueNs = startNs + stepNs;
+  unsigned int next{0};
+  unsigned int maxWriteAhead{0};
+  for(auto i{0u}; i < polls; ++i)
+  {
+    simulated->advance(pollNs);
+    const auto nowNs = simulated->getTime();
+    const auto stalled = nowNs >= startNs + source.mStallAfterNs &&
+      nowNs < startNs + source.mStallAfterNs + source.mStallNs;
+    // the steps due by now, less the ones the jitter holds back to the next poll
+    auto due{0u};
+    while(dueNs + due * stepNs <= nowNs)
+    {
+      ++due;
+    }
+    const auto late = source.mJitterFrames ? Random() % (source.mJitterFrames + 1) : 0u;
+    const auto push = stalled ? 0u : (due > late ? due - late : 0u);
+    for(auto j{0u}; j < push; ++j, ++next)
+    {
+      sink.mPushNs[next % kIndexes] = nowNs;
+      Check("push", stream->Push(Frame(next)) == 0);
+    }
+    dueNs += push * stepNs;
+
+    auto begin = std::chrono::steady_clock::now();
+    const auto result = stream->Poll();
+    auto end = std::chrono::steady_clock::now();
+    pollTimes.AddTime(end - begin);
+    pollSeconds += std::chrono::duration<double>(end - begin).count();
+    if(result < 0)
+    {
+      Check("poll", false);
+      break;
+    }
+    if(nowNs >= sink.mLatencyFromNs && stream->WriteAhead() > maxWriteAhead)
+      maxWriteAhead = stream->WriteAhead();
+  }
+  stream->PrintStats(polls * pollNs);
+  stream->Stop();
+
+  auto &counters = stream->Counters();
+  const auto boundNs = 2ull * maxWriteAhead * kUpdateNs + pollNs;
+  printf("  %llu updates, %llu repeated, %llu skipped, %llu wrong, max latency %.1f us "
+    "(bound %.1f us) at a write-ahead of up to %u frames\n", sink.mUpdates, sink.mRepeats,
+    sink.mSkipped, sink.mWrong, sink.mMaxLatencyNs * 1e-3, boundNs * 1e-3, maxWriteAhead);
+  Check("updates of pushed, held or initial frames", sink.mWrong == 0);
+  Check("updates at the board rate", sink.mUpdates + 2 >= polls * pollNs / kUpdateNs);
+  // the primed write-ahead is the initial frame over and over
+  Check("repeats are the held frames", sink.mRepeats == kMinWriteAhead + counters.mHeld);
+  Check("skips are the dropped frames", sink.mSkipped == counters.mDropped);
+  Check("latency within twice the write-ahead", sink.mMaxLatencyNs <= boundNs);
+  Check("no underflows", counters.mUnderruns == 0 &&
+    simulated->getUnderflows() == underflows);
+
+  if(source.mStallNs)
+    Check("a stall is held", counters.mHeld > 0);
+  if(source.mStallNs || source.mPpm > 0)
+    Check("what runs ahead is dropped", counters.mDropped > 0);
+  if(source.mPpm < 0)
+    Check("what falls behind is held", counters.mHeld > 0);
+  if(source.mPpm == 0 && source.mStallNs == 0)
+    Check("write-ahead settles", maxWriteAhead <= 4 * pollNs / kUpdateNs);
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+  if(argc > 1 && argv[1][0] == '-')
+  {
+    printf("Usage: ao_stream_benchmark [polls per run] [poll (us)]\n");
+    return -1;
+  }
+  const unsigned int polls = (argc > 1) ? atol(argv[1]) : 40000;
+  const unsigned long long pollNs = ((argc > 2) ? atol(argv[2]) : 100) * 1000ull;
+
+  char location[] = "PXI0::0::INSTR";
+  iBus *bus = acquireBoard(location);
+  simulated = getSimulatedXSeries(bus);
+  if(simulated == NULL)
+  {
+    printf("no simulated board FAILED\n");
+    return -1;
+  }
+  simulated->useManualClock(kTrue);
+
+  auto sink = std::make_unique<Sink>();
+  utils::ElapsedTimes pollTimes;
+  double pollSeconds{0};
+  const auto runNs = polls * pollNs;
+  const Source sources[] = {
+    {"steady source, up to 3 frames of jitter", 3, 0., 0, 0},
+    {"source stalls for 5 ms half way, then catches up", 3, 0., runNs / 2, 5000000ull},
+    {"source 1000 ppm faster than the board", 1, 1000., 0, 0},
+    {"source 1000 ppm slower than the board", 1, -1000., 0, 0},
+  };
+  for(const auto &source : sources)
+  {
+    Run(bus, *sink, source, polls, pollNs, pollTimes, pollSeconds);
+    if(failures)
+      break;
+  }
+
+  pollTimes.PrintHeader("AoStream, 3 channels at 100 kS/s");
+  pollTimes.Print("Poll()");
+  const auto frames = 4. * polls * pollNs / kUpdateNs;
+  printf("  %.1f MS/s per channel through Poll(), %s scaling\n", frames / pollSeconds * 1e-6,
+    ScalingUsesAvx2() ? "avx2" : "scalar");
+
+  releaseBoard(bus);
+  printf("\n%d failures\n", failures);
+  return failures ? -1 : 0;
+}
@@ -0,0 +1,272 @@
+#include <climits>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+#include <ElapsedTimes.hpp>
+
+#include "BenchmarkCheck.h"
+
+// OS Interface
+#include "osiBus.h"
+#include "tSimulatedXSeries.h"
+
+// Chip Objects
+#include "tXSeries.h"
+
+#include <CalibrationCache.h>
+#include <NiDeviceService.h>
+
+/*
+ * eeprom calibration read in full against the cached snapshot, on the simulated board
+ *
+ * a PXIe-6363 (one adc, four dacs) and a PXIe-6358 (sixteen adcs) are opened without the
+ * cache, cold into an empty cache file and warm from it. the warm coefficients must match
+ * the eeprom exactly. a new calibration date, a second board and a corrupted file must
+ * all fall back to the eeprom and refresh the file. the simulated eeprom answers at
+ * memory speed, so besides the host times the eeprom reads per open are counted and
+ * priced at a per-read cost of the hardware. NiDeviceService::Open() is timed cold and
+ * warm as the startup of a tool.
+ */
+
+namespace {
+
+constexpr auto kCachePath = "/tmp/calibration_cache_benchmark.bin";
+constexpr auto kSecondSerial = 0x0badcafeu;
+
+tSimulatedXSeries *simulated{NULL};
+unsigned long long SimulatedNs()
+{
+  return simulated->getTime();
+}
+
+// every coefficient of every converter and interval, invalid intervals as a marker
+std::vector<float> Coefficients(nNISTC3::eepromHelper &eeprom,
+  const nNISTC3::tDeviceInfo &deviceInfo)
+{
+  std::vector<float> coefficients;
+  for(auto i{0u}; i < deviceInfo.numberOfADCs; ++i)
+  {
+    for(auto j{0u}; j < nNISTC3::eepromHelper::kNumAIIntervals; ++j)
+    {
+      nMDBG::tStatus2 status;
+      nNISTC3::tAIScalingCoefficients ai;
+      eeprom.getAIScalingCoefficients(i, j, ai, status);
+      for(auto k{0u}; k < nNISTC3::kNumAIScalingCoefficients; ++k)
+      {
+        coefficients.push_back(status.isFatal() ? -1.f : ai.c[k]);
+      }
+    }
+  }
+  for(auto i{0u}; i < deviceInfo.numberOfDACs; ++i)
+  {
+    for(auto j{0u}; j < nNISTC3::eepromHelper::kNumAOIntervals; ++j)
+    {
+      nMDBG::tStatus2 status;
+      nNISTC3::tAOScalingCoefficients ao;
+      eeprom.getAOScalingCoefficients(i, j, ao, status);
+      for(auto k{0u}; k < nNISTC3::kNumAOScalingCoefficients; ++k)
+      {
+        coefficients.push_back(status.isFatal() ? -1.f : ao.c[k]);
+      }
+    }
+  }
+  return coefficients;
+}
+
+bool Same(const std::vector<float> &a, const std::vector<float> &b)
+{
+  return a.size() == b.size() && memcmp(a.data(), b.data(), a.size() * sizeof(float)) == 0;
+}
+
+struct OpenResult
+{
+  bool mWarm;
+  unsigned long long mReads;
+  std::vector<float> mCoefficients;
+};
+
+// one open as a new process does it, with a fresh cache object
+OpenResult OpenCached(tXSeries &device, const nNISTC3::tDeviceInfo &deviceInfo)
+{
+  CalibrationCache cache("cache", kCachePath);
+  const auto reads = simulated->getEepromReads();
+  auto eeprom = cache.Open(device, deviceInfo);
+  Check("cache open", eeprom != NULL);
+  if(!eeprom)
+    return OpenResult{false, 0, {}};
+  OpenResult result{cache.Warm(), simulated->getEepromReads() - reads,
+    Coefficients(*eeprom, deviceInfo)};
+  cache.Flush();
+  return result;
+}
+
+std::vector<float> ReadDirect(tXSeries &device, const nNISTC3::tDeviceInfo &deviceInfo,
+  unsigned long long *reads=NULL)
+{
+  nMDBG::tStatus2 status;
+  const auto before = simulated->getEepromReads();
+  nNISTC3::eepromHelper eeprom(device, deviceInfo.isSimultaneous, deviceInfo.numberOfADCs,
+    deviceInfo.numberOfDACs, status);
+  Check("eeprom read", status.isNotFatal());
+  if(reads)
+    *reads = simulated->getEepromReads() - before;
+  return Coefficients(eeprom, deviceInfo);
+}
+
+void Board(iBus *bus, const u32 productId, const u32 numberOfADCs, const unsigned int iterations,
+  const double readUs)
+{
+  simulated->setProductId(productId);
+  simulated->setEeprom(kSimulatedSerialNumber, kSimulatedCalTime, numberOfADCs, 4);
+  remove(kCachePath);
+
+  nMDBG::tStatus2 status;
+  tAddressSpace bar0 = bus->createAddressSpace(kPCI_BAR0);
+  {
+    tXSeries device(bar0, &status);
+    const auto *deviceInfo = nNISTC3::getDeviceInfo(device, status);
+    Check("device info", deviceInfo != NULL);
+    if(deviceInfo == NULL)
+    {
+      bus->destroyAddressSpace(bar0);
+      return;
+    }
+
+    unsigned long long directReads{0};
+    const auto eepromCoefficients = ReadDirect(device, *deviceInfo, &directReads);
+
+    auto cold = OpenCached(device, *deviceInfo);
+    Check("cold open reads the eeprom", !cold.mWarm);
+    Check("cold coefficients", Same(cold.mCoefficients, eepromCoefficients));
+    FILE *file = fopen(kCachePath, "rb");
+    Check("cache file written", file != NULL);
+    if(file)
+      fclose(file);
+
+    auto warm = OpenCached(device, *deviceInfo);
+    Check("warm open from the cache", warm.mWarm);
+    Check("warm coefficients", Same(warm.mCoefficients, eepromCoefficients));
+
+    utils::ElapsedTimes directTimes, warmTimes;
+    for(auto i{0u}; i < iterations; ++i)
+    {
+      auto begin = std::chrono::steady_clock::now();
+      ReadDirect(device, *deviceInfo);
+      directTimes.AddTime(std::chrono::steady_clock::now() - begin);
+      begin = std::chrono::steady_clock::now();
+      OpenCached(device, *deviceInfo);
+      warmTimes.AddTime(std::chrono::steady_clock::now() - begin);
+    }
+
+    // a new self calibration changes the dates and the coefficients
+    simulated->setEeprom(kSimulatedSerialNumber, kSimulatedCalTime + 86400, numberOfADCs, 4);
+    const auto recalibrated = ReadDirect(device, *deviceInfo);
+    auto stale = OpenCached(device, *deviceInfo);
+    Check("recalibration reads the eeprom", !stale.mWarm);
+    Check("recalibrated coefficients differ", !Same(recalibrated, eepromCoefficients));
+    Check("recalibrated coefficients", Same(stale.mCoefficients, recalibrated));
+    Check("recalibration cached", OpenCached(device, *deviceInfo).mWarm);
+
+    // a second board shares the file
+    simulated->setEeprom(kSecondSerial, kSimulatedCalTime, numberOfADCs, 4);
+    const auto second = ReadDirect(device, *deviceInfo);
+    Check("second board reads the eeprom", !OpenCached(device, *deviceInfo).mWarm);
+    auto secondWarm = OpenCached(device, *deviceInfo);
+    Check("second board cached", secondWarm.mWarm && Same(secondWarm.mCoefficients, second));
+    simulated->setEeprom(kSimulatedSerialNumber, kSimulatedCalTime + 86400, numberOfADCs, 4);
+    Check("first board still cached", OpenCached(device, *deviceInfo).mWarm);
+
+    // a damaged file is ignored and replaced
+    file = fopen(kCachePath, "r+b");
+    if(file)
+    {
+      fseek(file, 64, SEEK_SET);
+      fputc(fgetc(file) ^ 0xff, file);
+      fclose(file);
+    }
+    auto damaged = OpenCached(device, *deviceInfo);
+    Check("damaged file reads the eeprom", !damaged.mWarm &&
+      Same(damaged.mCoefficients, recalibrated));
+    Check("damaged file replaced", OpenCached(device, *deviceInfo).mWarm);
+
+    char title[64];
+    snprintf(title, sizeof(title), "%s calibration", deviceInfo->deviceName);
+    directTimes.PrintHeader(title);
+    directTimes.Print("eeprom");
+    warmTimes.Print("cache");
+    printf("  eeprom reads per open: %llu in full, %llu warm; at %.1f us per read on "
+      "hardware %.2f ms cold, %.2f ms warm\n", directReads, warm.mReads, readUs,
+      directReads * readUs * 1e-3, warm.mReads * readUs * 1e-3);
+    Check("warm reads fewer", warm.mReads * 2 < directReads);
+  }
+  bus->destroyAddressSpace(bar0);
+}
+
+// the startup of a tool, device identification to the scaling tables
+void Service(iBus *bus, const unsigned int iterations)
+{
+  simulated->setProductId(kSimulatedProductId);
+  simulated->setEeprom(kSimulatedSerialNumber, kSimulatedCalTime, 1, 4);
+  remove(kCachePath);
+
+  utils::ElapsedTimes coldTimes, warmTimes;
+  unsigned long long coldReads{0}, warmReads{0};
+  for(auto i{0u}; i < iterations; ++i)
+  {
+    remove(kCachePath);
+    for(auto warm : {false, true})
+    {
+      auto reads = simulated->getEepromReads();
+      auto begin = std::chrono::steady_clock::now();
+      auto service = std::make_unique<NiDeviceService>("service", bus, SimulatedNs);
+      Check("service open", service->Open(kCachePath) == 0);
+      Check("service scaling", service->EnableAi(NiAiConfig{4, nNISTC3::kInput_10V, nAI::kRSE,
+        10000}) == 0 && service->AiScaling().mNumChannels == 4);
+      (warm ? warmTimes : coldTimes).AddTime(std::chrono::steady_clock::now() - begin);
+      (warm ? warmReads : coldReads) = simulated->getEepromReads() - reads;
+      service.reset();
+    }
+  }
+  coldTimes.PrintHeader("NiDeviceService::Open() and EnableAi()");
+  coldTimes.Print("cold");
+  warmTimes.Print("warm");
+  printf("  eeprom reads: %llu cold, %llu warm\n", coldReads, warmReads);
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+  if(argc > 1 && argv[1][0] == '-')
+  {
+    printf("Usage: calibration_cache_benchmark [iterations] [eeprom read on hardware (us)]\n");
+    return -1;
+  }
+  const unsigned int iterations = (argc > 1) ? atol(argv[1]) : 200;
+  const double readUs = (argc > 2) ? atof(argv[2]) : 1.;
+
+  char location[] = "PXI0::0::INSTR";
+  iBus *bus = acquireBoard(location);
+  simulated = getSimulatedXSeries(bus);
+  if(simulated == NULL)
+  {
+    printf("no simulated board FAILED\n");
+    return -1;
+  }
+  simulated->useManualClock(kTrue);
+
+  Board(bus, kSimulatedProductId, 1, iterations, readUs);
+  Board(bus, 0x7437, 16, iterations, readUs); // PXIe-6358
+  Service(bus, iterations / 10 + 1);
+
+  remove(kCachePath);
+  releaseBoard(bus);
+  printf("\n%d failures\n", failures);
+  return failures ? -1 : 0;
+}
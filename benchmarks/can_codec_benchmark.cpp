@@ -0,0 +1,226 @@
+#include <climits>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+
+#include <chrono>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <vector>
+
+#include <ElapsedTimes.hpp>
+
+#include <CanCodec.h>
+#include <MotorOutputDbc.h>
+
+/*
+ * round trip checks and per frame cost of the generated dbc codecs
+ *
+ * the bit layout of each message is pinned down at compile time with static_asserts
+ * against hand computed payloads. at run time random physical values are packed into
+ * frames and unpacked again, every signal must come back within half a scaling step
+ * (or at its clamp limit), so any mismatch makes the benchmark fail. then batches of
+ * frames are encoded and decoded the way the 1 ms can path would.
+ */
+
+using namespace MotorOutputDbc;
+
+// intel: 1 A -> 100 = 0x0064, -1 A -> -100 = 0xff9c, out of range clamps to 30000
+static_assert(MotorCurrents::Pack(MotorCurrents{1.f, -1.f, 0.f}) == 0x0000ff9c0064ull,
+  "MotorCurrents layout");
+static_assert(MotorCurrents::Pack(MotorCurrents{1000.f, 0.f, 0.f}) == 30000ull,
+  "MotorCurrents clamping");
+static_assert(MotorCurrents::Unpack(0x0000ff9c0064ull).mCurrentV == -1.f,
+  "MotorCurrents sign extension");
+
+// motorola: 1000 rpm -> 2000 = 0x07d0, msb first in data[0..1]; counter in data[6] high nibble
+static_assert(MotorState::Pack(MotorState{1000.f, 0.f, 0.f, 0.f}) == 0xd007ull,
+  "MotorState byte order");
+static_assert(MotorState::Pack(MotorState{0.f, 0.f, 0.f, 5.f}) == 0x0050000000000000ull,
+  "MotorState sub byte signal");
+static_assert(MotorState::Unpack(0xd007ull).mRotorRPM == 1000.f, "MotorState unpack");
+static_assert(MotorState::Unpack(0x0050000000000000ull).mStateCounter == 5.f,
+  "MotorState sub byte unpack");
+
+// multiplexing: only the signals of the selected group are packed
+static_assert(MotorDiagnostics::Pack(MotorDiagnostics{1u, 9.f, 9.f, 0.5f, 0.f, 1.f}) ==
+  0x27100000138801ull, "MotorDiagnostics mux 1");
+static_assert(MotorDiagnostics::Pack(MotorDiagnostics{0u, 2.f, -2.f, 1.f, 1.f, 1.f}) ==
+  0xff9c006400ull, "MotorDiagnostics mux 0");
+static_assert(MotorDiagnostics::Unpack(0xff9c006400ull).mDutyU == 0.f,
+  "MotorDiagnostics inactive group");
+
+static_assert(MotorDiagnostics::kType == CanFrameType::kExtended &&
+  MotorDiagnostics::kId == 0x19000000, "MotorDiagnostics extended id");
+
+namespace {
+
+unsigned int failures{0};
+
+// within half a step of the raw resolution, plus float rounding of the physical value
+void Check(const char *name, const double sent, const double received, const double factor)
+{
+  if(std::fabs(sent - received) > factor * 0.5 + std::fabs(sent) * 1e-6)
+  {
+    if(failures++ < 10)
+      printf("round trip mismatch %s: sent %f, received %f\n", name, sent, received);
+  }
+}
+
+double Clamp(const double value, const double minimum, const double maximum)
+{
+  return value < minimum ? minimum : (value > maximum ? maximum : value);
+}
+
+template <typename tMessage>
+double TimePerFrame(void (*run)(std::vector<tMessage>&, std::vector<CanFrame>&),
+  std::vector<tMessage> &messages, std::vector<CanFrame> &frames, const unsigned int numBatches,
+  utils::ElapsedTimes &batchTimes)
+{
+  auto begin = std::chrono::steady_clock::now();
+  for(auto i{0u}; i < numBatches; ++i)
+  {
+    auto batchBegin = std::chrono::steady_clock::now();
+    run(messages, frames);
+    batchTimes.AddTime(std::chrono::steady_clock::now() - batchBegin);
+  }
+  return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - begin).count() /
+    (static_cast<double>(numBatches) * frames.size());
+}
+
+template <typename tMessage>
+void Encode(std::vector<tMessage> &messages, std::vector<CanFrame> &frames)
+{
+  CanCodec::PackFrames(messages.data(), frames.data(), frames.size());
+}
+
+template <typename tMessage>
+void Decode(std::vector<tMessage> &messages, std::vector<CanFrame> &frames)
+{
+  CanCodec::UnpackFrames(frames.data(), messages.data(), frames.size());
+}
+
+template <typename tMessage>
+void Benchmark(const char *name, std::vector<tMessage> &messages, const unsigned int numBatches)
+{
+  std::vector<CanFrame> frames(messages.size());
+  utils::ElapsedTimes encodeTimes;
+  utils::ElapsedTimes decodeTimes;
+  auto encodeNs = TimePerFrame(Encode<tMessage>, messages, frames, numBatches, encodeTimes);
+  auto decodeNs = TimePerFrame(Decode<tMessage>, messages, frames, numBatches, decodeTimes);
+  printf("%s: encode %.2f ns/frame, decode %.2f ns/frame\n", name, encodeNs, decodeNs);
+  encodeTimes.PrintHeader("Batch of frames");
+  encodeTimes.Print("encode");
+  decodeTimes.Print("decode");
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+  if(argc > 1 && argv[1][0] == '-')
+  {
+    printf("Usage: can_codec_benchmark [frames per batch] [batches] [round trips]\n");
+    return -1;
+  }
+  const unsigned int batchSize = (argc > 1) ? atol(argv[1]) : 64;
+  const unsigned int numBatches = (argc > 2) ? atol(argv[2]) : 100000;
+  const unsigned int numRoundTrips = (argc > 3) ? atol(argv[3]) : 1000000;
+
+  // round trips, slightly past the dbc ranges to exercise the clamping
+  std::mt19937 random(42);
+  std::uniform_real_distribution<double> current(-330., 330.);
+  std::uniform_real_distribution<double> rpm(-17000., 17000.);
+  std::uniform_real_distribution<double> angle(-0.5, 7.);
+  std::uniform_real_distribution<double> unit(-0.1, 1.1);
+  std::uniform_int_distribution<unsigned int> counter(0, 15);
+  std::uniform_int_distribution<unsigned int> mux(0, 1);
+
+  std::vector<MotorCurrents> currents(numRoundTrips);
+  std::vector<MotorState> states(numRoundTrips);
+  std::vector<MotorDiagnostics> diagnostics(numRoundTrips);
+  for(auto i{0u}; i < numRoundTrips; ++i)
+  {
+    currents[i] = MotorCurrents{static_cast<float>(current(random)),
+      static_cast<float>(current(random)), static_cast<float>(current(random))};
+    states[i] = MotorState{static_cast<float>(rpm(random)), static_cast<float>(angle(random)),
+      static_cast<float>(current(random)), static_cast<float>(counter(random))};
+    diagnostics[i] = MotorDiagnostics{mux(random), static_cast<float>(current(random)),
+      static_cast<float>(current(random)), static_cast<float>(unit(random)),
+      static_cast<float>(unit(random)), static_cast<float>(unit(random))};
+  }
+
+  std::vector<CanFrame> frames(numRoundTrips);
+  std::vector<MotorCurrents> currentsBack(numRoundTrips);
+  std::vector<MotorState> statesBack(numRoundTrips);
+  std::vector<MotorDiagnostics> diagnosticsBack(numRoundTrips);
+
+  CanCodec::PackFrames(currents.data(), frames.data(), numRoundTrips);
+  CanCodec::UnpackFrames(frames.data(), currentsBack.data(), numRoundTrips);
+  for(auto i{0u}; i < numRoundTrips; ++i)
+  {
+    Check("CurrentU", Clamp(currents[i].mCurrentU, -300., 300.), currentsBack[i].mCurrentU, 0.01);
+    Check("CurrentV", Clamp(currents[i].mCurrentV, -300., 300.), currentsBack[i].mCurrentV, 0.01);
+    Check("CurrentW", Clamp(currents[i].mCurrentW, -300., 300.), currentsBack[i].mCurrentW, 0.01);
+  }
+
+  CanCodec::PackFrames(states.data(), frames.data(), numRoundTrips);
+  CanCodec::UnpackFrames(frames.data(), statesBack.data(), numRoundTrips);
+  for(auto i{0u}; i < numRoundTrips; ++i)
+  {
+    Check("RotorRPM", Clamp(states[i].mRotorRPM, -16000., 16000.), statesBack[i].mRotorRPM, 0.5);
+    Check("RotorDegreeRad", Clamp(states[i].mRotorDegreeRad, 0., 6.2832),
+      statesBack[i].mRotorDegreeRad, 0.0001);
+    Check("OutputTorque", Clamp(states[i].mOutputTorque, -300., 300.),
+      statesBack[i].mOutputTorque, 0.01);
+    Check("StateCounter", states[i].mStateCounter, statesBack[i].mStateCounter, 1.);
+  }
+
+  CanCodec::PackFrames(diagnostics.data(), frames.data(), numRoundTrips);
+  CanCodec::UnpackFrames(frames.data(), diagnosticsBack.data(), numRoundTrips);
+  for(auto i{0u}; i < numRoundTrips; ++i)
+  {
+    auto &sent = diagnostics[i];
+    auto &received = diagnosticsBack[i];
+    Check("DiagMux", sent.mDiagMux, received.mDiagMux, 1.);
+    if(frames[i].mId != MotorDiagnostics::kId || frames[i].mType != CanFrameType::kExtended)
+      ++failures;
+    if(sent.mDiagMux == 0)
+    {
+      Check("VoltageQ", sent.mVoltageQ, received.mVoltageQ, 0.02);
+      Check("VoltageD", sent.mVoltageD, received.mVoltageD, 0.02);
+      Check("DutyU", 0., received.mDutyU, 0.);
+    }
+    else
+    {
+      Check("DutyU", Clamp(sent.mDutyU, 0., 1.), received.mDutyU, 0.0001);
+      Check("DutyV", Clamp(sent.mDutyV, 0., 1.), received.mDutyV, 0.0001);
+      Check("DutyW", Clamp(sent.mDutyW, 0., 1.), received.mDutyW, 0.0001);
+      Check("VoltageQ", 0., received.mVoltageQ, 0.);
+    }
+  }
+
+  // a nan signal, e.g. from a diverged model, goes out as the bottom of its range
+  const auto nan = std::numeric_limits<float>::quiet_NaN();
+  const auto nanCurrents = MotorCurrents::Unpack(MotorCurrents::Pack(MotorCurrents{nan, nan, nan}));
+  Check("CurrentU nan", -300., nanCurrents.mCurrentU, 0.01);
+  Check("CurrentW nan", -300., nanCurrents.mCurrentW, 0.01);
+  const auto nanState = MotorState::Unpack(MotorState::Pack(MotorState{nan, nan, nan, nan}));
+  Check("RotorRPM nan", -16000., nanState.mRotorRPM, 0.5);
+  Check("RotorDegreeRad nan", 0., nanState.mRotorDegreeRad, 0.0001);
+  Check("StateCounter nan", 0., nanState.mStateCounter, 1.);
+
+  printf("%d round trips per message, %d mismatches\n", numRoundTrips, failures);
+  if(failures > 0)
+    return -1;
+
+  // batches as sent or received per 1 ms cycle
+  currents.resize(batchSize);
+  states.resize(batchSize);
+  diagnostics.resize(batchSize);
+  Benchmark("MotorCurrents (intel)", currents, numBatches);
+  Benchmark("MotorState (motorola)", states, numBatches);
+  Benchmark("MotorDiagnostics (multiplexed)", diagnostics, numBatches);
+  return 0;
+}
@@ -0,0 +1,190 @@
+#include <climits>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include <ElapsedTimes.hpp>
+
+#include <CanGateway.h>
+
+/*
+ * cost of the can gateway without hardware
+ *
+ * one reader thread per channel plays RtPeakCanReceiveTask and offers every frame of
+ * its bus to CanGateway::Forward(). the driver write of each destination is an atomic
+ * counter that reports a full queue once in a while, so the tx full path is exercised
+ * too. afterwards the per rule counters are checked against the traffic each reader
+ * generated.
+ */
+
+namespace {
+
+struct DriverQueue
+{
+  std::atomic<unsigned long long> mWritten;
+  std::atomic<unsigned long long> mCalls;
+  unsigned int mFullEvery;
+};
+
+int WriteFrame(void *context, const CanFrame &)
+{
+  auto *queue = static_cast<DriverQueue*>(context);
+  if(queue->mCalls.fetch_add(1, std::memory_order_relaxed) % queue->mFullEvery == 0)
+    return -1;
+  queue->mWritten.fetch_add(1, std::memory_order_relaxed);
+  return 0;
+}
+
+unsigned long long NowNs()
+{
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return static_cast<unsigned long long>(now.tv_sec) * 1000000000ull + now.tv_nsec;
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+  if(argc > 1 && argv[1][0] == '-')
+  {
+    printf("Usage: can_gateway_benchmark [channels] [routed ids per channel] "
+      "[frames per channel] [tx full every n writes]\n");
+    return -1;
+  }
+  const unsigned int numChannels = (argc > 1) ? atol(argv[1]) : 4;
+  const unsigned int idsPerChannel = (argc > 2) ? atol(argv[2]) : 32;
+  const unsigned int numFrames = (argc > 3) ? atol(argv[3]) : 2000000;
+  const unsigned int fullEvery = (argc > 4) ? atol(argv[4]) : 1000;
+  if(numChannels < 2 || numChannels > CanRoute::kMaxChannels)
+  {
+    printf("2 to %d channels\n", CanRoute::kMaxChannels);
+    return -1;
+  }
+
+  CanGateway gateway(NowNs);
+  std::vector<DriverQueue> queues(numChannels);
+  for(auto channel{0u}; channel < numChannels; ++channel)
+  {
+    queues[channel].mWritten = 0;
+    queues[channel].mCalls = 0;
+    queues[channel].mFullEvery = fullEvery;
+    gateway.SetWriter(channel, WriteFrame, &queues[channel]);
+  }
+
+  // every channel forwards its ids to the next one, every fourth id also fans out to the
+  // channel after that with a new id, as a diagnostics mirror would
+  for(auto channel{0u}; channel < numChannels; ++channel)
+  {
+    for(auto i{0u}; i < idsPerChannel; ++i)
+    {
+      auto id = 0x100 + channel * 0x100 + i;
+      if(gateway.AddRule(CanGatewayRule{channel, id, CanFrameType::kStandard,
+        (channel + 1) % numChannels, CanRoute::kKeepId, 0}) < 0)
+        return -1;
+      if(i % 4 == 0 && numChannels > 2)
+      {
+        if(gateway.AddRule(CanGatewayRule{channel, id, CanFrameType::kStandard,
+          (channel + 2) % numChannels, 0x18000000u + id, CanFrameType::kExtended}) < 0)
+          return -1;
+      }
+    }
+  }
+  if(gateway.Build())
+    return -1;
+
+  // per channel traffic: routed ids and a share of ids that stay on the bus
+  std::vector<std::vector<CanFrame>> traffic(numChannels);
+  std::vector<std::vector<unsigned long long>> sentPerId(numChannels,
+    std::vector<unsigned long long>(idsPerChannel, 0));
+  std::mt19937 random(42);
+  std::uniform_int_distribution<unsigned int> pick(0, idsPerChannel * 2 - 1);
+  for(auto channel{0u}; channel < numChannels; ++channel)
+  {
+    traffic[channel].resize(numFrames);
+    for(auto &frame : traffic[channel])
+    {
+      auto i = pick(random);
+      frame = CanFrame{};
+      frame.mId = (i < idsPerChannel) ? 0x100 + channel * 0x100 + i : 0x700 + (i & 0x3f);
+      frame.mType = CanFrameType::kStandard;
+      frame.mLen = 8;
+      if(i < idsPerChannel)
+        ++sentPerId[channel][i];
+    }
+  }
+
+  std::vector<utils::ElapsedTimes> forwardTimes(numChannels);
+  std::vector<std::thread> readers;
+  auto begin = std::chrono::steady_clock::now();
+  for(auto channel{0u}; channel < numChannels; ++channel)
+  {
+    readers.emplace_back([&, channel]()
+    {
+      auto &frames = traffic[channel];
+      for(auto i{0u}; i < frames.size(); ++i)
+      {
+        auto readNs = NowNs();
+        gateway.Forward(channel, frames[i], readNs);
+        if((i & 0xff) == 0)
+          forwardTimes[channel].AddTime(std::chrono::nanoseconds(NowNs() - readNs));
+      }
+    });
+  }
+  for(auto &reader : readers)
+  {
+    reader.join();
+  }
+  auto elapsedNs = std::chrono::duration_cast<std::chrono::nanoseconds>(
+    std::chrono::steady_clock::now() - begin).count();
+
+  printf("%d channels, %d rules, %d frames per channel: %.2f ns/frame per reader\n",
+    numChannels, gateway.NumRules(), numFrames,
+    static_cast<double>(elapsedNs) / numFrames);
+  forwardTimes[0].PrintHeader("Forward (1/256)");
+  for(auto channel{0u}; channel < numChannels; ++channel)
+  {
+    char name[32];
+    snprintf(name, sizeof(name), "channel %d", channel);
+    forwardTimes[channel].Print(name);
+  }
+
+  // every routed frame must be either forwarded or counted as tx full, on every rule
+  auto failures{0u};
+  unsigned long long forwarded{0};
+  for(auto rule{0u}; rule < gateway.NumRules(); ++rule)
+  {
+    auto &route = gateway.Rule(rule);
+    auto &counters = gateway.Counters(rule);
+    auto sent = sentPerId[route.mSource][route.mId - 0x100 - route.mSource * 0x100];
+    if(counters.mForwarded + counters.mTxFull != sent)
+    {
+      printf("rule %d: sent %llu, forwarded %llu, tx full %llu\n", rule, sent,
+        counters.mForwarded, counters.mTxFull);
+      ++failures;
+    }
+    forwarded += counters.mForwarded;
+  }
+
+  unsigned long long written{0};
+  for(auto &queue : queues)
+  {
+    written += queue.mWritten;
+  }
+  if(written != forwarded)
+  {
+    printf("written %llu, forwarded %llu\n", written, forwarded);
+    ++failures;
+  }
+
+  gateway.PrintStats(0, "can_gateway_benchmark channel 0", elapsedNs);
+  printf("forwarded: %llu, mismatched rules: %d\n", forwarded, failures);
+  return failures ? -1 : 0;
+}
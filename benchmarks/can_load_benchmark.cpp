@@ -0,0 +1,259 @@
+#include <climits>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+
+#include <sys/resource.h>
+
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include <ElapsedTimes.hpp>
+
+#include <CanReceiveEngine.h>
+#include <SocketCanDevice.h>
+
+/*
+ * load generator for the can receive path on a socketcan interface
+ *
+ * a sender floods the bus through one socket in bursts (one sendmmsg per burst), a
+ * reader drains a second socket the way RtPeakCanReceiveTask does and feeds a
+ * CanReceiveEngine, and a consumer dispatches every millisecond. every frame carries a
+ * sequence number and its send time, so the consumer measures send to decode latency
+ * and the reader counts frames lost on the way. cpu time of the sender and the reader
+ * is taken per thread and reported per frame.
+ *
+ * without hardware, run it on a virtual bus:
+ *   sudo modprobe vcan
+ *   sudo ip link add dev vcan0 type vcan && sudo ip link set up vcan0
+ */
+
+namespace {
+
+std::atomic<bool> running{true};
+
+unsigned long long NowNs()
+{
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return static_cast<unsigned long long>(now.tv_sec) * 1000000000ull + now.tv_nsec;
+}
+
+unsigned long long ThreadCpuNs()
+{
+  struct rusage usage;
+  getrusage(RUSAGE_THREAD, &usage);
+  return (usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1000000000ull +
+    (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) * 1000ull;
+}
+
+void SleepUntil(timespec &next, const long ns)
+{
+  next.tv_nsec += ns;
+  while(next.tv_nsec >= 1000000000l)
+  {
+    next.tv_nsec -= 1000000000l;
+    ++next.tv_sec;
+  }
+  clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL);
+}
+
+// bytes 0..3 sequence number, 4..7 send time in us, both little endian
+void Stamp(CanFrame &frame, const uint32_t sequence, const uint32_t sendUs)
+{
+  memcpy(frame.mData, &sequence, sizeof(sequence));
+  memcpy(frame.mData + 4, &sendUs, sizeof(sendUs));
+}
+
+struct Decoded
+{
+  unsigned long long mFrames;
+  utils::ElapsedTimes mLatency;
+};
+
+void Decode(void *context, const CanFrame &frame)
+{
+  auto *decoded = static_cast<Decoded*>(context);
+  uint32_t sendUs;
+  memcpy(&sendUs, frame.mData + 4, sizeof(sendUs));
+  auto nowUs = static_cast<uint32_t>(NowNs() / 1000);
+  decoded->mLatency.AddTime(std::chrono::microseconds(nowUs - sendUs));
+  ++decoded->mFrames;
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+  if(argc > 1 && argv[1][0] == '-')
+  {
+    printf("Usage: can_load_benchmark [interface] [frames/s] [ids] [extended ids (%%)] "
+      "[burst interval (us)] [duration (s)]\n");
+    return -1;
+  }
+  const char *interfaceName = (argc > 1) ? argv[1] : "vcan0";
+  const unsigned int framesPerSecond = (argc > 2) ? atol(argv[2]) : 20000;
+  const unsigned int numIds = (argc > 3) ? atol(argv[3]) : 64;
+  const unsigned int extendedPercent = (argc > 4) ? atol(argv[4]) : 10;
+  const long burstNs = ((argc > 5) ? atol(argv[5]) : 1000) * 1000l;
+  const unsigned int durationS = (argc > 6) ? atol(argv[6]) : 5;
+
+  SocketCanDevice sender("sender", interfaceName, 1000);
+  SocketCanDevice reader("reader", interfaceName, 1000);
+  if(sender.Open() || reader.Open())
+  {
+    printf("can_load_benchmark needs a socketcan interface, see the top of "
+      "can_load_benchmark.cpp to create vcan0\n");
+    return -1;
+  }
+
+  // id mix: registered ids, a share of them extended, plus some traffic nobody decodes
+  std::mt19937 random(42);
+  std::uniform_int_distribution<unsigned int> standardId(0, 0x6ff);
+  std::uniform_int_distribution<unsigned int> extendedId(0, CanLimit::kMaxExtendedId);
+  std::uniform_int_distribution<unsigned int> percent(0, 99);
+
+  CanReceiveEngine engine;
+  Decoded decoded;
+  decoded.mFrames = 0;
+  std::vector<CanFrame> mix;
+  std::vector<uint32_t> keys;
+  while(mix.size() < numIds)
+  {
+    CanFrame frame{};
+    auto extended = percent(random) < extendedPercent;
+    frame.mId = extended ? extendedId(random) : standardId(random);
+    frame.mType = extended ? CanFrameType::kExtended : CanFrameType::kStandard;
+    frame.mLen = 8;
+    auto key = CanIdTable::Key(frame.mId, frame.mType);
+    auto duplicate{false};
+    for(auto other : keys)
+    {
+      duplicate = duplicate || other == key;
+    }
+    if(duplicate)
+      continue;
+
+    keys.push_back(key);
+    engine.Register(frame.mId, frame.mType, Decode, &decoded);
+    mix.push_back(frame);
+  }
+  for(auto i{0u}; i < numIds / 8; ++i)
+  {
+    mix.push_back(CanFrame{0x700u + i, CanFrameType::kStandard, 8, {0}, 0, 0});
+  }
+  if(engine.Build())
+    return -1;
+
+  const auto framesPerBurst = static_cast<unsigned int>(
+    static_cast<unsigned long long>(framesPerSecond) * burstNs / 1000000000ull);
+  printf("Flooding %s with %d frames/s over %zu ids (%d%% extended) in bursts of %d every "
+    "%ld us, for %d s\n", interfaceName, framesPerSecond, mix.size(), extendedPercent,
+    framesPerBurst, burstNs / 1000, durationS);
+
+  unsigned long long sent{0}, txFull{0}, senderCpuNs{0};
+  std::thread senderThread([&]()
+  {
+    std::vector<CanFrame> burst(framesPerBurst);
+    std::uniform_int_distribution<unsigned int> pick(0, mix.size() - 1);
+    uint32_t sequence{0};
+    timespec next;
+    clock_gettime(CLOCK_MONOTONIC, &next);
+    while(running)
+    {
+      SleepUntil(next, burstNs);
+      auto sendUs = static_cast<uint32_t>(NowNs() / 1000);
+      for(auto &frame : burst)
+      {
+        frame = mix[pick(random)];
+        Stamp(frame, sequence++, sendUs);
+      }
+
+      auto written = sender.Write(burst.data(), burst.size());
+      if(written < 0)
+        written = 0;
+      sent += written;
+      txFull += burst.size() - written;
+      // unsent frames are gone, the reader must not count them as lost
+      sequence -= burst.size() - written;
+    }
+    senderCpuNs = ThreadCpuNs();
+  });
+
+  unsigned long long received{0}, lost{0}, readerCpuNs{0};
+  utils::ElapsedTimes receiveTimes;
+  std::thread readerThread([&]()
+  {
+    CanFrame frames[CanReceive::kMaxBatch];
+    uint32_t expected{0};
+    while(running)
+    {
+      auto numFrames = reader.Read(frames, CanReceive::kMaxBatch, 10000);
+      if(numFrames < 0)
+      {
+        engine.RecordError();
+        continue;
+      }
+
+      auto batchBegin = std::chrono::steady_clock::now();
+      auto readNs = NowNs();
+      for(auto i{0}; i < numFrames; ++i)
+      {
+        uint32_t sequence;
+        memcpy(&sequence, frames[i].mData, sizeof(sequence));
+        if(sequence != expected)
+          lost += sequence - expected;
+        expected = sequence + 1;
+        engine.Receive(frames[i], readNs);
+      }
+      if(numFrames > 0)
+      {
+        engine.EndBatch(numFrames);
+        receiveTimes.AddTime((std::chrono::steady_clock::now() - batchBegin) / numFrames);
+      }
+      received += numFrames;
+    }
+    readerCpuNs = ThreadCpuNs();
+  });
+
+  std::thread consumerThread([&]()
+  {
+    timespec next;
+    clock_gettime(CLOCK_MONOTONIC, &next);
+    while(running)
+    {
+      SleepUntil(next, 1000000l);
+      engine.Dispatch();
+    }
+    engine.Dispatch();
+  });
+
+  std::this_thread::sleep_for(std::chrono::seconds(durationS));
+  running = false;
+  senderThread.join();
+  readerThread.join();
+  consumerThread.join();
+
+  receiveTimes.PrintHeader("Per frame");
+  receiveTimes.Print("receive");
+  decoded.mLatency.Print("send to decode");
+
+  unsigned long long overflows{0};
+  for(auto i{0u}; i < engine.NumIds(); ++i)
+  {
+    overflows += engine.Counters(i).mOverflows;
+  }
+  printf("sent: %llu, tx full: %llu, received: %llu, lost: %llu (%.4f%%), kernel drops: %llu, "
+    "decoded: %llu, engine overflows: %llu\n", sent, txFull, received, lost,
+    sent ? 100. * lost / sent : 0., reader.mDropped, decoded.mFrames, overflows);
+  printf("cpu per frame: sender %.0f ns, reader %.0f ns\n",
+    sent ? static_cast<double>(senderCpuNs) / sent : 0.,
+    received ? static_cast<double>(readerCpuNs) / received : 0.);
+  engine.PrintStats("can_load_benchmark", durationS * 1000000000ull);
+  return 0;
+}
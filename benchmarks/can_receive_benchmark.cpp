@@ -0,0 +1,222 @@
+#include <climits>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include <ElapsedTimes.hpp>
+
+#include <CanReceiveEngine.h>
+
+/*
+ * cost of the can receive path without hardware
+ *
+ * a reader thread plays RtPeakCanReceiveTask: it wakes every burst interval and hands
+ * the frames "the driver" queued since the last wake to CanReceiveEngine::Receive().
+ * a consumer thread plays the model and calls Dispatch() every dispatch period.
+ * the id lookup is also timed against a std::unordered_map on the same id mix.
+ */
+
+namespace {
+
+std::atomic<bool> running{true};
+
+unsigned long long NowNs()
+{
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return static_cast<unsigned long long>(now.tv_sec) * 1000000000ull + now.tv_nsec;
+}
+
+void SleepUntil(timespec &next, const long ns)
+{
+  next.tv_nsec += ns;
+  while(next.tv_nsec >= 1000000000l)
+  {
+    next.tv_nsec -= 1000000000l;
+    ++next.tv_sec;
+  }
+  clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL);
+}
+
+struct DecodedSum
+{
+  unsigned long long mFrames;
+  unsigned long long mBytes;
+};
+
+void Decode(void *context, const CanFrame &frame)
+{
+  auto *sum = static_cast<DecodedSum*>(context);
+  ++sum->mFrames;
+  sum->mBytes += frame.mData[0];
+}
+
+// a realistic mix: mostly standard ids, a few j1939 style extended ones, some noise
+std::vector<CanFrame> MakeTraffic(const std::vector<CanFrame> &registered,
+  const unsigned int numFrames, std::mt19937 &random)
+{
+  std::uniform_int_distribution<unsigned int> pick(0, registered.size() - 1);
+  std::uniform_int_distribution<unsigned int> noise(0, 9);
+  std::vector<CanFrame> traffic(numFrames);
+  for(auto i{0u}; i < numFrames; ++i)
+  {
+    traffic[i] = registered[pick(random)];
+    if(noise(random) == 0)
+      traffic[i].mId = 0x700 + (i & 0x7f); // not registered
+    traffic[i].mData[0] = i & 0xff;
+  }
+  return traffic;
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+  if(argc > 1 && argv[1][0] == '-')
+  {
+    printf("Usage: can_receive_benchmark [ids] [frames/s] [burst interval (us)] "
+      "[dispatch period (us)] [duration (s)]\n");
+    return -1;
+  }
+  const unsigned int numIds = (argc > 1) ? atol(argv[1]) : 64;
+  const unsigned int framesPerSecond = (argc > 2) ? atol(argv[2]) : 8000;
+  const long burstNs = ((argc > 3) ? atol(argv[3]) : 500) * 1000l;
+  const long dispatchNs = ((argc > 4) ? atol(argv[4]) : 1000) * 1000l;
+  const unsigned int durationS = (argc > 5) ? atol(argv[5]) : 3;
+
+  std::mt19937 random(42);
+  std::uniform_int_distribution<unsigned int> standardId(0, 0x6ff);
+  std::uniform_int_distribution<unsigned int> extendedId(0, CanLimit::kMaxExtendedId);
+
+  CanReceiveEngine engine;
+  std::vector<CanFrame> registered;
+  std::unordered_map<uint32_t, int> map;
+  DecodedSum sum{0, 0};
+  while(registered.size() < numIds)
+  {
+    CanFrame frame{};
+    auto extended = registered.size() % 8 == 7;
+    frame.mId = extended ? extendedId(random) : standardId(random);
+    frame.mType = extended ? CanFrameType::kExtended : CanFrameType::kStandard;
+    frame.mLen = 8;
+    auto key = CanIdTable::Key(frame.mId, frame.mType);
+    if(map.count(key))
+      continue;
+
+    map[key] = engine.Register(frame.mId, frame.mType, Decode, &sum);
+    registered.push_back(frame);
+  }
+  if(engine.Build())
+    return -1;
+
+  // lookup only
+  auto traffic = MakeTraffic(registered, 1 << 20, random);
+  volatile int sink = 0;
+  CanIdTable table;
+  {
+    std::vector<uint32_t> keys;
+    for(auto &frame : registered)
+    {
+      keys.push_back(CanIdTable::Key(frame.mId, frame.mType));
+    }
+    table.Build(keys.data(), keys.size());
+  }
+
+  auto begin = std::chrono::steady_clock::now();
+  for(auto &frame : traffic)
+  {
+    sink = sink + table.Find(CanIdTable::Key(frame.mId, frame.mType));
+  }
+  auto tableNs = std::chrono::duration<double, std::nano>(
+    std::chrono::steady_clock::now() - begin).count() / traffic.size();
+
+  begin = std::chrono::steady_clock::now();
+  for(auto &frame : traffic)
+  {
+    auto found = map.find(CanIdTable::Key(frame.mId, frame.mType));
+    sink = sink + (found == map.end() ? -1 : found->second);
+  }
+  auto mapNs = std::chrono::duration<double, std::nano>(
+    std::chrono::steady_clock::now() - begin).count() / traffic.size();
+
+  printf("Id lookup over %d ids: perfect hash %.2f ns, unordered_map %.2f ns\n",
+    numIds, tableNs, mapNs);
+
+  // reader and consumer threads at the requested load
+  const auto framesPerBurst = static_cast<unsigned int>(
+    static_cast<unsigned long long>(framesPerSecond) * burstNs / 1000000000ull);
+  printf("Streaming %d frames/s in bursts of %d every %ld us, dispatching every %ld us, "
+    "for %d s\n", framesPerSecond, framesPerBurst, burstNs / 1000, dispatchNs / 1000,
+    durationS);
+
+  utils::ElapsedTimes receiveTimes;
+  utils::ElapsedTimes dispatchTimes;
+  unsigned long long sent{0};
+
+  std::thread reader([&]()
+  {
+    timespec next;
+    clock_gettime(CLOCK_MONOTONIC, &next);
+    auto cursor{0u};
+    while(running)
+    {
+      SleepUntil(next, burstNs);
+      // the controller stamped the burst when it was due, the wake up is late by jitter
+      auto driverUs = (static_cast<unsigned long long>(next.tv_sec) * 1000000000ull +
+        next.tv_nsec) / 1000;
+
+      auto batchBegin = std::chrono::steady_clock::now();
+      for(auto i{0u}; i < framesPerBurst; ++i)
+      {
+        auto frame = traffic[cursor++ & (traffic.size() - 1)];
+        frame.mDriverUs = driverUs;
+        engine.Receive(frame, NowNs());
+      }
+      engine.EndBatch(framesPerBurst);
+      if(framesPerBurst > 0)
+        receiveTimes.AddTime((std::chrono::steady_clock::now() - batchBegin) / framesPerBurst);
+      sent += framesPerBurst;
+    }
+  });
+
+  std::thread consumer([&]()
+  {
+    timespec next;
+    clock_gettime(CLOCK_MONOTONIC, &next);
+    while(running)
+    {
+      SleepUntil(next, dispatchNs);
+      auto dispatchBegin = std::chrono::steady_clock::now();
+      auto dispatched = engine.Dispatch();
+      if(dispatched > 0)
+        dispatchTimes.AddTime((std::chrono::steady_clock::now() - dispatchBegin) / dispatched);
+    }
+    engine.Dispatch();
+  });
+
+  std::this_thread::sleep_for(std::chrono::seconds(durationS));
+  running = false;
+  reader.join();
+  consumer.join();
+
+  receiveTimes.PrintHeader("Per frame");
+  receiveTimes.Print("receive");
+  dispatchTimes.Print("dispatch");
+
+  unsigned long long overflows{0};
+  for(auto i{0u}; i < engine.NumIds(); ++i)
+  {
+    overflows += engine.Counters(i).mOverflows;
+  }
+  printf("sent: %llu, decoded: %llu, overflows: %llu\n", sent, sum.mFrames, overflows);
+  engine.PrintStats("can_receive_benchmark", durationS * 1000000000ull);
+  return 0;
+}
@@ -0,0 +1,115 @@
+#include <climits>
+#include <cstdio>
+#include <cstdlib>
+
+#include <chrono>
+#include <iostream>
+#include <vector>
+
+#include <ElapsedTimes.hpp>
+
+#include <CanTransmitSchedule.h>
+
+/*
+ * offset tuning and per-tick cost of the can transmit schedule
+ *
+ * a rest-bus of frames at 1/5/10/100 ms is laid out twice, once with every offset at
+ * zero as the old single frame task would have sent them, once with automatic
+ * offsets, and the busiest tick of each is compared. then the tuned schedule is
+ * walked tick by tick with a payload source on every frame, as the rt task does.
+ */
+
+namespace {
+
+void Counter(void *, CanFrame &frame)
+{
+  ++frame.mData[0];
+  frame.mData[1] = frame.mData[0] ^ 0x5a;
+}
+
+void AddRestBus(CanTransmitSchedule &schedule, const unsigned int numIds, const long offsetUs)
+{
+  // a typical powertrain mix, a few fast frames and many slow ones
+  const unsigned long periodsUs[] = {1000, 5000, 10000, 10000, 20000, 20000, 50000, 100000,
+    5000, 10000, 10000, 20000, 50000, 100000, 100000, 100000};
+  for(auto i{0u}; i < numIds; ++i)
+  {
+    CanScheduleEntry entry{};
+    entry.mFrame.mId = 0x100 + i;
+    entry.mFrame.mType = CanFrameType::kStandard;
+    entry.mFrame.mLen = 8;
+    entry.mPeriodUs = periodsUs[i % 16];
+    entry.mOffsetUs = offsetUs;
+    entry.mSource = Counter;
+    schedule.Add(entry);
+  }
+}
+
+unsigned int BusiestTick(const CanTransmitSchedule &schedule)
+{
+  const uint16_t *entries;
+  auto busiest{0u};
+  for(auto tick{0u}; tick < schedule.NumSlots(); ++tick)
+  {
+    auto frames = schedule.Slot(tick, &entries);
+    if(frames > busiest)
+      busiest = frames;
+  }
+  return busiest;
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+  if(argc > 1 && argv[1][0] == '-')
+  {
+    printf("Usage: can_schedule_benchmark [ids] [bit rate (kbit/s)] [tx fifo depth] [ticks]\n");
+    return -1;
+  }
+  const unsigned int numIds = (argc > 1) ? atol(argv[1]) : 24;
+  const unsigned int bitRate = ((argc > 2) ? atol(argv[2]) : 1000) * 1000;
+  const unsigned int fifoDepth = (argc > 3) ? atol(argv[3]) : CanSchedule::kDefaultTxFifoDepth;
+  const unsigned int numTicks = (argc > 4) ? atol(argv[4]) : 1000000;
+  const auto tickUs = 1000ul;
+
+  CanTransmitSchedule untuned;
+  AddRestBus(untuned, numIds, 0);
+  untuned.Build(tickUs, UINT_MAX);
+
+  CanTransmitSchedule schedule;
+  AddRestBus(schedule, numIds, CanSchedule::kAutoOffset);
+  auto buildBegin = std::chrono::steady_clock::now();
+  if(schedule.Build(tickUs, fifoDepth))
+    return -1;
+  auto buildUs = std::chrono::duration_cast<std::chrono::microseconds>(
+    std::chrono::steady_clock::now() - buildBegin).count();
+
+  printf("%d ids, busiest tick: %d frames with zero offsets, %d frames tuned "
+    "(tx fifo %d), built in %ld us\n", numIds, BusiestTick(untuned), BusiestTick(schedule),
+    fifoDepth, buildUs);
+  schedule.PrintSchedule(bitRate);
+
+  // walk the table as the rt task does, the driver write replaced by a copy
+  utils::ElapsedTimes tickTimes;
+  CanFrame sent{};
+  const uint16_t *entries;
+  unsigned long long sendNs{0};
+  for(auto tick{0u}; tick < numTicks; ++tick)
+  {
+    auto begin = std::chrono::steady_clock::now();
+    auto numEntries = schedule.Slot(tick, &entries);
+    for(auto i{0u}; i < numEntries; ++i)
+    {
+      sent = schedule.Prepare(entries[i]);
+      schedule.RecordSend(entries[i], sendNs, true);
+    }
+    tickTimes.AddTime(std::chrono::steady_clock::now() - begin);
+    sendNs += tickUs * 1000;
+  }
+
+  tickTimes.PrintHeader("Schedule tick");
+  tickTimes.Print("tick");
+  schedule.PrintStats("can_schedule_benchmark", numTicks * tickUs * 1000ull, bitRate);
+  return sent.mLen == 8 ? 0 : -1;
+}
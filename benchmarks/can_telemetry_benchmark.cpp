@@ -0,0 +1,169 @@
+#include <climits>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include <ElapsedTimes.hpp>
+
+#include <CanFd.h>
+#include <MotorTelemetry.h>
+
+/*
+ * motor telemetry over can fd against one classic frame per sample
+ *
+ * random samples are packed into fd frames, some frames are dropped on the way and the
+ * rest unpacked again: every sample must come back within half a scaling step at its
+ * original time, and the unpacker must count exactly the dropped frames. then the
+ * samples per second a bus can carry are computed from the worst case frame times, for
+ * fd with bit rate switching against one classic frame per sample on a bus of the same
+ * nominal rate, and the pack and unpack cost per sample is measured.
+ */
+
+static_assert(CanFd::RoundUpLength(8 + 9 * 6) == 64 && CanFd::RoundUpLength(8 + 6) == 16 &&
+  CanFd::RoundUpLength(8 + 3 * 6) == 32 && CanFd::RoundUpLength(8 + 5 * 6) == 48,
+  "fd lengths of telemetry frames");
+static_assert(MotorTelemetry::kMaxSamples == 9, "samples per telemetry frame");
+
+namespace {
+
+unsigned int failures{0};
+
+void Check(const char *name, const double sent, const double received, const double step)
+{
+  if(std::fabs(sent - received) > step * 0.5 + std::fabs(sent) * 1e-6)
+  {
+    if(failures++ < 10)
+      printf("round trip mismatch %s: sent %f, received %f\n", name, sent, received);
+  }
+}
+
+double SamplesPerSecond(const CanFrame &frame, const unsigned int samplesPerFrame,
+  const unsigned int bitRate, const unsigned int dataBitRate)
+{
+  return samplesPerFrame * 1e9 / CanFd::FrameTimeNs(frame, bitRate, dataBitRate);
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+  if(argc > 1 && argv[1][0] == '-')
+  {
+    printf("Usage: can_telemetry_benchmark [samples] [drop every n frames] [sample period (us)]\n");
+    return -1;
+  }
+  const unsigned int numSamples = (argc > 1) ? atol(argv[1]) : 1000000;
+  const unsigned int dropEvery = (argc > 2) ? atol(argv[2]) : 97;
+  const unsigned int periodUs = (argc > 3) ? atol(argv[3]) : 100;
+
+  std::mt19937 random(42);
+  std::uniform_real_distribution<double> current(-300., 300.);
+  std::uniform_real_distribution<double> angle(0., 6.28);
+  std::vector<MotorSample> samples(numSamples);
+  for(auto &sample : samples)
+  {
+    sample = MotorSample{static_cast<float>(current(random)), static_cast<float>(current(random)),
+      static_cast<float>(current(random)), static_cast<float>(angle(random))};
+  }
+
+  // pack, drop, unpack
+  MotorTelemetryPacker packer(0x300);
+  MotorTelemetryUnpacker unpacker;
+  std::vector<CanFrame> frames(numSamples / MotorTelemetry::kMaxSamples + 1);
+  auto numFrames{0u};
+  auto begin = std::chrono::steady_clock::now();
+  for(auto i{0u}; i < numSamples; ++i)
+  {
+    if(packer.Add(samples[i], i * periodUs, frames[numFrames]))
+      ++numFrames;
+  }
+  if(packer.Flush(frames[numFrames]))
+    ++numFrames;
+  frames.resize(numFrames);
+  auto packNs = std::chrono::duration<double, std::nano>(
+    std::chrono::steady_clock::now() - begin).count();
+
+  MotorSample received[MotorTelemetry::kMaxSamples];
+  uint32_t timesUs[MotorTelemetry::kMaxSamples];
+  unsigned long long dropped{0};
+  utils::ElapsedTimes unpackTimes;
+  double unpackNs{0.};
+  for(auto i{0u}; i < frames.size(); ++i)
+  {
+    if(dropEvery > 0 && i % dropEvery == dropEvery / 2)
+    {
+      ++dropped;
+      continue;
+    }
+
+    auto frameBegin = std::chrono::steady_clock::now();
+    auto count = unpacker.Unpack(frames[i], received, timesUs);
+    auto elapsed = std::chrono::steady_clock::now() - frameBegin;
+    unpackTimes.AddTime(elapsed);
+    unpackNs += std::chrono::duration<double, std::nano>(elapsed).count();
+    if(count <= 0 || frames[i].mLen != CanFd::RoundUpLength(frames[i].mLen))
+    {
+      ++failures;
+      continue;
+    }
+
+    for(auto j{0}; j < count; ++j)
+    {
+      auto index = timesUs[j] / periodUs;
+      if(index >= numSamples || timesUs[j] != index * periodUs)
+      {
+        ++failures;
+        continue;
+      }
+      auto &sent = samples[index];
+      Check("CurrentU", sent.mCurrentU, received[j].mCurrentU, MotorTelemetry::kCurrentScale);
+      Check("CurrentV", sent.mCurrentV, received[j].mCurrentV, MotorTelemetry::kCurrentScale);
+      // w is restored from u and v, so it carries the error of both
+      Check("CurrentW", -(sent.mCurrentU + sent.mCurrentV), received[j].mCurrentW,
+        2. * MotorTelemetry::kCurrentScale);
+      Check("RotorAngleRad", sent.mRotorAngleRad, received[j].mRotorAngleRad,
+        MotorTelemetry::kAngleScale);
+    }
+  }
+  if(unpacker.mLostFrames != dropped)
+  {
+    printf("dropped %llu frames, unpacker counted %llu\n", dropped, unpacker.mLostFrames);
+    ++failures;
+  }
+  printf("%d samples in %zu frames, %llu dropped, %d mismatches\n", numSamples, frames.size(),
+    dropped, failures);
+  unpacker.PrintStats("can_telemetry_benchmark");
+  printf("pack %.2f ns/sample, unpack %.2f ns/sample\n", packNs / numSamples,
+    unpackNs / unpacker.mSamples);
+  unpackTimes.PrintHeader("Per frame");
+  unpackTimes.Print("unpack");
+
+  // bus capacity: a full fd frame against the same sample alone in a classic frame
+  CanFrame classic{};
+  classic.mType = CanFrameType::kStandard;
+  classic.mLen = MotorTelemetry::kSampleBytes;
+  CanFrame fd{};
+  fd.mType = MotorTelemetry::kFrameType;
+  fd.mLen = CanLimit::kMaxFdDataLength;
+  const unsigned int bitRates[][2] = {{500000, 2000000}, {1000000, 5000000}, {1000000, 8000000}};
+  printf("%-20s %14s %14s %8s\n", "bus (nominal/data)", "classic (1/s)", "fd (1/s)", "gain");
+  for(auto &rates : bitRates)
+  {
+    auto classicRate = SamplesPerSecond(classic, 1, rates[0], 0);
+    auto fdRate = SamplesPerSecond(fd, MotorTelemetry::kMaxSamples, rates[0], rates[1]);
+    auto gain = fdRate / classicRate;
+    printf("%5d k / %5d k %16.0f %14.0f %7.2fx\n", rates[0] / 1000, rates[1] / 1000,
+      classicRate, fdRate, gain);
+    if(gain < 5.)
+    {
+      printf("less than 5x the samples of classic can\n");
+      ++failures;
+    }
+  }
+  return failures ? -1 : 0;
+}
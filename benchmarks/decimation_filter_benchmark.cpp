@@ -0,0 +1,506 @@
+#include <climits>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include <ElapsedTimes.hpp>
+
+#include "BenchmarkCheck.h"
+
+// OS Interface
+#include "osiBus.h"
+#include "tSimulatedXSeries.h"
+
+#include <DecimationFilter.h>
+#include <DynoSensingFilter.h>
+#include <NiDeviceService.h>
+
+/*
+ * cic and compensating fir decimation of oversampled ai, and the dyno sensing on top
+ *
+ * the kernels first: a bank of filters of every order, rate and tap count runs random
+ * scans in random block sizes with the dispatched and with the portable kernels, which
+ * must give the same outputs bit for bit, and the cic alone must give the exact moving
+ * sums of its samples. the timing filters 1 MS/s scans of the three phase currents to
+ * 100 kS/s and the torque to 1 kS/s, as the motor model does.
+ *
+ * then the frequency response: a sine at each of a sweep of frequencies runs through
+ * the current filter, and the amplitude of its alias at the output, fitted by least
+ * squares, must be the gain the bank computes from its design. from that the passband
+ * must be flat, and everything that aliases into it must be attenuated.
+ *
+ * last the dyno sensing on the simulated board: a current sensor with a 100 Hz wave and
+ * a 60 kHz disturbance, and a torque with a 20 kHz one, scanned at 125 kS/s. every value
+ * published must be the filtered signal at its scan time less the group delay.
+ */
+
+namespace {
+
+constexpr auto kTimebaseHz = 100e6;
+constexpr auto kTwoPi = 6.283185307179586;
+constexpr auto kBlockScans = 1024u;
+constexpr auto kEpochNs = 1000000000000ull; // rt clock at sim time 0
+
+// the motor model sensors: 1 MS/s, currents by 10 to 100 kS/s, torque by 1000 to 1 kS/s
+const DecimationConfig kCurrent{0, 4, 5, 2, 32, 0.25f};
+const DecimationConfig kTorque{3, 3, 250, 4, 32, 0.25f};
+
+// response
+constexpr auto kSineCodes = 12000.;
+constexpr auto kFitOutputs = 4000u;
+constexpr auto kResponseError = 2e-4; // of the input amplitude
+constexpr auto kPassbandRippleDb = 0.02;
+constexpr auto kAliasAttenuationDb = 60.;
+
+// the board: 2 channels at 800 ticks, the fastest a mio device scans them
+constexpr auto kScanTicks = 800u;
+constexpr auto kPollNs = 100000ull;
+constexpr auto kRunNs = 200000000ull;
+constexpr auto kCurrentAmpsPerVolt = 10.;
+constexpr auto kTorqueNmPerVolt = 20.;
+constexpr auto kValueError = 0.02; // 2 mV, a few codes
+
+tSimulatedXSeries *simulated{NULL};
+unsigned long long SimNowNs()
+{
+  return kEpochNs + simulated->getTime();
+}
+
+double Db(const double gain)
+{
+  return 20. * std::log10(gain);
+}
+
+//
+// kernels
+//
+
+struct Outputs
+{
+  std::vector<std::vector<float>> mData;
+  std::vector<float*> mPointers;
+  std::vector<unsigned int> mCounts;
+
+  explicit Outputs(const unsigned int numFilters)
+    : mData(numFilters, std::vector<float>(kBlockScans + 1))
+    , mPointers(numFilters)
+    , mCounts(numFilters)
+  {
+    for(auto j{0u}; j < numFilters; ++j)
+    {
+      mPointers[j] = mData[j].data();
+    }
+  }
+};
+
+void CheckKernels()
+{
+  printf("\nkernels, %s against scalar\n", DecimationUsesAvx2() ? "avx2" : "scalar");
+  // every order, rates up to the bit limit, taps on and off a multiple of eight, 0 taps
+  const DecimationConfig configs[] = {
+    {0, 1, 1, 1, 0, 0.f}, {1, 1, 7, 1, 0, 0.f}, {2, 2, 16, 2, 24, 0.2f},
+    {3, 3, 250, 4, 32, 0.25f}, {4, 4, 5, 2, 31, 0.25f}, {5, 5, 64, 8, 127, 0.35f},
+    {0, 6, 100, 1, 9, 0.1f}, {1, 6, 3, 16, 128, 0.2f}, {2, 2, 4096, 3, 64, 0.3f},
+    {3, 4, 5, 2, 32, 0.25f}};
+  const auto numFilters = static_cast<unsigned int>(sizeof(configs) / sizeof(configs[0]));
+  const auto numChannels = 6u;
+  DecimationFilterBank bank("bank", numChannels, numFilters, configs);
+  DecimationFilterBank reference("reference", numChannels, numFilters, configs);
+  Check("configs", bank.Valid() && reference.Valid());
+
+  std::mt19937 random(3);
+  std::uniform_int_distribution<int> code(-32768, 32767);
+  std::vector<int16_t> raw(200000 * numChannels);
+  for(auto &sample : raw)
+  {
+    sample = static_cast<int16_t>(code(random));
+  }
+  Outputs outputs(numFilters);
+  Outputs expected(numFilters);
+  std::vector<std::vector<float>> all(numFilters);
+  auto same{true};
+  auto numScans = static_cast<unsigned int>(raw.size() / numChannels);
+  for(auto s{0u}; s < numScans;)
+  {
+    auto scans = 1 + random() % kBlockScans;
+    scans = (scans < numScans - s) ? scans : numScans - s;
+    bank.Filter(raw.data() + s * numChannels, scans, outputs.mPointers.data(),
+      outputs.mCounts.data());
+    reference.FilterScalar(raw.data() + s * numChannels, scans, expected.mPointers.data(),
+      expected.mCounts.data());
+    for(auto j{0u}; j < numFilters; ++j)
+    {
+      same = same && outputs.mCounts[j] == expected.mCounts[j] &&
+        memcmp(outputs.mData[j].data(), expected.mData[j].data(),
+          outputs.mCounts[j] * sizeof(float)) == 0;
+      all[j].insert(all[j].end(), outputs.mData[j].begin(),
+        outputs.mData[j].begin() + outputs.mCounts[j]);
+    }
+    s += scans;
+  }
+  Check("kernels match bit for bit", same);
+
+  // the cic alone against the moving sums: order times a box of decimation samples
+  auto exact{true};
+  auto counted{true};
+  for(auto j{0u}; j < numFilters; ++j)
+  {
+    const auto &config = configs[j];
+    counted = counted && all[j].size() == numScans / bank.Decimation(j);
+    if(config.mFirTaps || config.mCicDecimation > 16)
+      continue;
+    std::vector<long long> box(1, 1);
+    for(auto k{0u}; k < config.mCicOrder; ++k)
+    {
+      std::vector<long long> next(box.size() + config.mCicDecimation - 1, 0);
+      for(auto i{0u}; i < box.size(); ++i)
+      {
+        for(auto r{0u}; r < config.mCicDecimation; ++r)
+        {
+          next[i + r] += box[i];
+        }
+      }
+      box = next;
+    }
+    const auto scale = 1. / std::pow(static_cast<double>(config.mCicDecimation),
+      config.mCicOrder);
+    for(auto n{0u}; n < all[j].size(); ++n)
+    {
+      const long long last = (n + 1) * config.mCicDecimation - 1;
+      long long sum{0};
+      for(long long k{0}; k < static_cast<long long>(box.size()) && k <= last; ++k)
+      {
+        sum += box[k] * raw[(last - k) * numChannels + config.mChannel];
+      }
+      exact = exact && all[j][n] == static_cast<float>(sum * scale);
+    }
+  }
+  Check("outputs at every decimation", counted);
+  Check("cic gives the exact moving sums", exact);
+}
+
+void TimeKernels(utils::ElapsedTimes &times, utils::ElapsedTimes &scalarTimes, double &scanNs,
+  double &scalarScanNs)
+{
+  DecimationConfig configs[] = {kCurrent, kCurrent, kCurrent, kTorque};
+  configs[1].mChannel = 1;
+  configs[2].mChannel = 2;
+  DecimationFilterBank bank("bank", 4, 4, configs);
+  std::mt19937 random(5);
+  std::uniform_int_distribution<int> code(-32768, 32767);
+  std::vector<int16_t> raw(kBlockScans * 4);
+  for(auto &sample : raw)
+  {
+    sample = static_cast<int16_t>(code(random));
+  }
+  Outputs outputs(4);
+  const auto repeats = 5000u;
+  auto seconds{0.};
+  auto scalarSeconds{0.};
+  for(auto i{0u}; i < repeats; ++i)
+  {
+    auto begin = std::chrono::steady_clock::now();
+    bank.Filter(raw.data(), kBlockScans, outputs.mPointers.data(), outputs.mCounts.data());
+    auto end = std::chrono::steady_clock::now();
+    times.AddTime(end - begin);
+    seconds += std::chrono::duration<double>(end - begin).count();
+
+    begin = std::chrono::steady_clock::now();
+    bank.FilterScalar(raw.data(), kBlockScans, outputs.mPointers.data(),
+      outputs.mCounts.data());
+    end = std::chrono::steady_clock::now();
+    scalarTimes.AddTime(end - begin);
+    scalarSeconds += std::chrono::duration<double>(end - begin).count();
+  }
+  scanNs = seconds * 1e9 / (repeats * kBlockScans);
+  scalarScanNs = scalarSeconds * 1e9 / (repeats * kBlockScans);
+}
+
+//
+// frequency response
+//
+
+// amplitude of the sine at frequency (cycles per sample) in samples, with a dc term
+double FitAmplitude(const std::vector<float> &samples, const unsigned int first,
+  const double frequency)
+{
+  // normal equations of [sin cos 1]
+  double a[3][3] = {};
+  double b[3] = {};
+  for(auto n{first}; n < samples.size(); ++n)
+  {
+    const double basis[3] = {std::sin(kTwoPi * frequency * n), std::cos(kTwoPi * frequency * n),
+      1.};
+    for(auto r{0}; r < 3; ++r)
+    {
+      for(auto c{0}; c < 3; ++c)
+      {
+        a[r][c] += basis[r] * basis[c];
+      }
+      b[r] += basis[r] * samples[n];
+    }
+  }
+  // gaussian elimination, the matrix is well conditioned away from dc and nyquist
+  for(auto r{0}; r < 3; ++r)
+  {
+    for(auto below{r + 1}; below < 3; ++below)
+    {
+      const auto factor = a[below][r] / a[r][r];
+      for(auto c{r}; c < 3; ++c)
+      {
+        a[below][c] -= factor * a[r][c];
+      }
+      b[below] -= factor * b[r];
+    }
+  }
+  double x[3];
+  for(auto r{2}; r >= 0; --r)
+  {
+    auto sum = b[r];
+    for(auto c{r + 1}; c < 3; ++c)
+    {
+      sum -= a[r][c] * x[c];
+    }
+    x[r] = sum / a[r][r];
+  }
+  return std::hypot(x[0], x[1]);
+}
+
+void CheckResponse()
+{
+  printf("\nfrequency response, cic order %u by %u, %u taps by %u, passband %.2f\n",
+    kCurrent.mCicOrder, kCurrent.mCicDecimation, kCurrent.mFirTaps, kCurrent.mFirDecimation,
+    kCurrent.mPassband);
+  DecimationFilterBank bank("response", 1, 1, &kCurrent);
+  const auto decimation = bank.Decimation(0);
+  const auto outputRate = 1. / decimation; // of the input rate
+  const auto passband = kCurrent.mPassband * outputRate;
+  const auto settle = static_cast<unsigned int>(2. * bank.Delay(0) / decimation) + 4;
+  const auto numScans = (kFitOutputs + settle) * decimation;
+
+  std::vector<int16_t> raw(numScans);
+  Outputs outputs(1);
+  std::vector<float> samples;
+  auto maxError{0.};
+  auto minPassband{1e9};
+  auto maxPassband{-1e9};
+  auto maxAlias{0.};
+  auto maxCicDroop{0.};
+  printf("  %10s %10s %12s %12s\n", "f/fs", "f/fout", "designed dB", "measured dB");
+  const auto numFrequencies = 240u;
+  for(auto i{0u}; i < numFrequencies; ++i)
+  {
+    // up to the input nyquist, off the bins that alias onto dc or the output nyquist;
+    // alias is where it lands, as a fraction of the output rate
+    const auto frequency = (i + 0.37) * 0.5 / numFrequencies;
+    auto alias = std::fmod(frequency, outputRate) / outputRate;
+    alias = (alias > 0.5) ? 1. - alias : alias;
+    if(alias < 0.02 || alias > 0.48)
+      continue;
+
+    const auto phase = 1.3 * i;
+    for(auto n{0u}; n < numScans; ++n)
+    {
+      raw[n] = static_cast<int16_t>(std::lround(kSineCodes *
+        std::sin(kTwoPi * frequency * n + phase)));
+    }
+    bank.Reset();
+    samples.clear();
+    for(auto s{0u}; s < numScans; s += kBlockScans)
+    {
+      const auto scans = (numScans - s < kBlockScans) ? numScans - s : kBlockScans;
+      bank.Filter(raw.data() + s, scans, outputs.mPointers.data(), outputs.mCounts.data());
+      samples.insert(samples.end(), outputs.mData[0].begin(),
+        outputs.mData[0].begin() + outputs.mCounts[0]);
+    }
+    const auto measured = FitAmplitude(samples, settle, alias) / kSineCodes;
+    const auto designed = bank.Response(0, frequency);
+    maxError = std::max(maxError, std::fabs(measured - designed));
+    if(frequency <= passband)
+    {
+      minPassband = std::min(minPassband, Db(measured));
+      maxPassband = std::max(maxPassband, Db(measured));
+      // what the cic alone would have lost there
+      const auto cic = std::pow(std::fabs(std::sin(M_PI * frequency * kCurrent.mCicDecimation) /
+        (kCurrent.mCicDecimation * std::sin(M_PI * frequency))), kCurrent.mCicOrder);
+      maxCicDroop = std::max(maxCicDroop, -Db(cic));
+    }
+    // what folds onto the passband at the output
+    if(frequency > passband && alias <= kCurrent.mPassband)
+      maxAlias = std::max(maxAlias, measured);
+    if(i % 12 == 0)
+      printf("  %10.4f %10.3f %12.2f %12.2f\n", frequency, frequency / outputRate,
+        Db(designed), Db(measured));
+  }
+  printf("  measured against designed within %.1e, passband %+.3f..%+.3f dB (the cic alone "
+    "droops %.2f dB), aliases into it at most %.1f dB\n", maxError, minPassband, maxPassband,
+    maxCicDroop, Db(maxAlias));
+  Check("response as designed", maxError <= kResponseError);
+  Check("flat passband", maxPassband - minPassband <= kPassbandRippleDb &&
+    std::fabs(maxPassband) <= kPassbandRippleDb && std::fabs(minPassband) <= kPassbandRippleDb);
+  Check("aliases attenuated", Db(maxAlias) <= -kAliasAttenuationDb);
+}
+
+//
+// the board
+//
+
+const AiScalingTable *aiScaling{NULL};
+
+double CurrentVolts(const double t)
+{
+  return 0.2 + 0.8 * std::sin(kTwoPi * 100. * t) + 0.5 * std::sin(kTwoPi * 60000. * t + 0.3);
+}
+
+double TorqueVolts(const double t)
+{
+  return -1.5 + 0.4 * std::sin(kTwoPi * 20000. * t + 1.1);
+}
+
+// what the filter makes of them: the waves in its passband as they are, the others gone
+double CurrentFiltered(const double t)
+{
+  return 0.2 + 0.8 * std::sin(kTwoPi * 100. * t);
+}
+
+i16 SensorCode(void *, u32 channel, u64 ns)
+{
+  const auto t = ns * 1e-9;
+  const auto volts = (channel == 0) ? CurrentVolts(t) : TorqueVolts(t);
+  const auto *c = aiScaling->mCoefficients[channel];
+  double code = (volts - c[0]) / c[1];
+  for(auto i{0u}; i < 3; ++i)
+  {
+    const auto value = ((c[3] * code + c[2]) * code + c[1]) * code + c[0];
+    const auto slope = (3. * c[3] * code + 2. * c[2]) * code + c[1];
+    code -= (value - volts) / slope;
+  }
+  code = std::round(code);
+  return static_cast<i16>(code < -32768. ? -32768. : code > 32767. ? 32767. : code);
+}
+
+void CheckBoard(iBus *bus, utils::ElapsedTimes &pollTimes)
+{
+  printf("\ndyno sensing on the simulated board\n");
+  // 125 kS/s: the current by 5 and 2 to 12.5 kS/s, the torque by 25 and 5 to 1 kS/s
+  const DynoSensingConfig config{2, nNISTC3::kInput_10V, nAI::kDifferential, kScanTicks, 2,
+    {{kDynoCurrentU, static_cast<float>(kCurrentAmpsPerVolt), 0.f, {0, 4, 5, 2, 32, 0.25f}},
+     {kDynoOutputTorque, static_cast<float>(kTorqueNmPerVolt), 5.f, {1, 3, 25, 5, 48, 0.2f}}}};
+  auto service = std::make_shared<NiDeviceService>("dyno", bus, SimNowNs);
+  auto filter = std::make_unique<DynoSensingFilter>("dyno", service, SimNowNs, config);
+  const auto opened = service->Open() == 0 && filter->Open() == 0;
+  Check("open", opened);
+  if(!opened)
+    return;
+  aiScaling = &service->AiScaling();
+  const auto periodNs = static_cast<unsigned long long>(kScanTicks * 1e9 / kTimebaseHz);
+  simulated->setAiSource(2, periodNs, SensorCode, NULL);
+
+  const auto overflows = simulated->getOverflows();
+  const auto startNs = simulated->getTime();
+  Check("start", filter->Start() == 0);
+  const auto currentDelayNs = filter->DelayNs(0);
+  const auto currentScans = 10u;
+  const auto torqueScans = 125u;
+
+  std::mt19937 random(13);
+  auto pollFailed{false};
+  auto checked{0u};
+  auto maxCurrentError{0.};
+  auto maxTorqueError{0.};
+  unsigned long long sequence{0};
+  while(simulated->getTime() - startNs < kRunNs)
+  {
+    simulated->advance(kPollNs + random() % 20000);
+    auto begin = std::chrono::steady_clock::now();
+    pollFailed = filter->Poll() < 0 || pollFailed;
+    auto end = std::chrono::steady_clock::now();
+    pollTimes.AddTime(end - begin);
+
+    DynoSensingSample sample;
+    if(!filter->mLatest.Load(sample) || sample.sequence == sequence)
+      continue;
+    sequence = sample.sequence;
+    // the newest value of each came from the last scan of its decimation
+    const auto &counters = filter->Counters();
+    const auto currentNs = startNs + counters.mValues[0] * currentScans * periodNs;
+    const auto torqueNs = startNs + counters.mValues[1] * torqueScans * periodNs;
+    if(currentNs < startNs + 20000000ull)
+      continue;
+    const auto current = kCurrentAmpsPerVolt * CurrentFiltered((currentNs - currentDelayNs) * 1e-9);
+    const auto torque = kTorqueNmPerVolt * -1.5 + 5.;
+    maxCurrentError = std::max(maxCurrentError,
+      std::fabs(sample.ft_Value[kDynoCurrentU] - current));
+    maxTorqueError = std::max(maxTorqueError,
+      std::fabs(sample.ft_Value[kDynoOutputTorque] - torque));
+    checked += sample.measured == ((1u << kDynoCurrentU) | (1u << kDynoOutputTorque)) &&
+      sample.sampleNs[kDynoCurrentU] >= kEpochNs + currentNs &&
+      sample.sampleNs[kDynoOutputTorque] >= kEpochNs + torqueNs;
+  }
+  filter->PrintStats(kRunNs);
+  const auto &counters = filter->Counters();
+  filter->Stop();
+
+  const auto scans = kRunNs / periodNs;
+  printf("  %llu scans, %llu currents, %llu torques, %u values checked: current within %.4f A, "
+    "torque within %.4f Nm\n", counters.mScans, counters.mValues[0], counters.mValues[1],
+    checked, maxCurrentError, maxTorqueError);
+  Check("polls", !pollFailed && simulated->getOverflows() == overflows);
+  Check("every scan filtered", counters.mScans + 2 * kPollNs / periodNs >= scans);
+  Check("values at the decimated rates",
+    counters.mValues[0] == counters.mScans / currentScans &&
+    counters.mValues[1] == counters.mScans / torqueScans);
+  Check("values checked", checked > 1000);
+  Check("current", maxCurrentError <= kValueError * kCurrentAmpsPerVolt);
+  Check("torque", maxTorqueError <= kValueError * kTorqueNmPerVolt);
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+  if(argc > 1 && argv[1][0] == '-')
+  {
+    printf("Usage: decimation_filter_benchmark\n");
+    return -1;
+  }
+
+  CheckKernels();
+  utils::ElapsedTimes times;
+  utils::ElapsedTimes scalarTimes;
+  double scanNs{0.};
+  double scalarScanNs{0.};
+  TimeKernels(times, scalarTimes, scanNs, scalarScanNs);
+  CheckResponse();
+
+  char location[] = "PXI0::0::INSTR";
+  iBus *bus = acquireBoard(location);
+  simulated = getSimulatedXSeries(bus);
+  if(simulated == NULL)
+  {
+    printf("no simulated board FAILED\n");
+    return -1;
+  }
+  simulated->useManualClock(kTrue);
+  utils::ElapsedTimes pollTimes;
+  CheckBoard(bus, pollTimes);
+
+  times.PrintHeader("1024 scans");
+  times.Print(DecimationUsesAvx2() ? "avx2" : "dispatched");
+  scalarTimes.Print("scalar");
+  pollTimes.PrintHeader("Dyno sensing");
+  pollTimes.Print("Poll()");
+  printf("  4 filters: %.2f ns per scan, %.2f ns scalar: %.1f %% of a core at 1 MS/s\n",
+    scanNs, scalarScanNs, scanNs * 1e6 * 1e-9 * 100.);
+
+  releaseBoard(bus);
+  printf("\n%d failures\n", failures);
+  return failures ? -1 : 0;
+}
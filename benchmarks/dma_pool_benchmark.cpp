@@ -0,0 +1,336 @@
+#include <climits>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include <chrono>
+#include <iostream>
+#include <vector>
+
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <ElapsedTimes.hpp>
+
+#include "osiDMAPool.h"
+
+/*
+ * dma buffers from the driver one by one against buffers carved from a pool
+ *
+ * without the nirlpk driver the per buffer path is modelled by what iBus::allocDMA()
+ * does in user space: a fresh shared mapping per buffer, zeroed by the buffer class and
+ * unmapped on free. the ioctl that allocates the kernel side comes on top on a real
+ * board, so the pool gains there are larger than shown. the pool is one region mapped
+ * with MAP_POPULATE and locked up front, tDMAPool hands out the blocks. the buffer set
+ * is what pwm capture configures (3 rings of 4 KiB, 2 sgl links each) plus an ai stream
+ * ring with its links. configure allocates and zeroes all of them, reconfigure frees and
+ * allocates again. then every buffer is read repeatedly the way a consumer drains
+ * the rings, counting data tlb misses where the cpu exposes them. the last row maps the
+ * pool on transparent huge pages, which the driver mapping cannot offer; it shows what
+ * a driver with huge page support would add.
+ */
+
+namespace {
+
+struct Buffer
+{
+  unsigned int mSize;
+  unsigned char *mAddress;
+  unsigned int mOffset;
+};
+
+std::vector<Buffer> BufferSet(const unsigned int aiRingBytes)
+{
+  std::vector<Buffer> buffers;
+  for(auto i{0u}; i < 3; ++i)
+  {
+    buffers.push_back(Buffer{4096, NULL, 0});
+    buffers.push_back(Buffer{512, NULL, 0});
+    buffers.push_back(Buffer{512, NULL, 0});
+  }
+  buffers.push_back(Buffer{aiRingBytes, NULL, 0});
+  for(auto i{0u}; i < 4; ++i)
+  {
+    buffers.push_back(Buffer{512, NULL, 0});
+  }
+  return buffers;
+}
+
+class Allocator
+{
+public:
+  virtual ~Allocator() {}
+  virtual bool Allocate(Buffer &buffer) = 0;
+  virtual void Free(Buffer &buffer) = 0;
+};
+
+// iBus::allocDMA() without the ioctl
+class PerBufferAllocator : public Allocator
+{
+public:
+  bool Allocate(Buffer &buffer) override
+  {
+    auto *address = mmap(NULL, buffer.mSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS,
+      -1, 0);
+    if(address == MAP_FAILED)
+      return false;
+    buffer.mAddress = static_cast<unsigned char*>(address);
+    memset(buffer.mAddress, 0, buffer.mSize);
+    return true;
+  }
+  void Free(Buffer &buffer) override
+  {
+    munmap(buffer.mAddress, buffer.mSize);
+    buffer.mAddress = NULL;
+  }
+};
+
+// iBus::reserveDMA() and the pooled allocDMA()
+class PoolAllocator : public Allocator
+{
+private:
+  void *mMapping;
+  size_t mMappingSize;
+  unsigned char *mRegion;
+  size_t mSize;
+  tDMAPool mPool;
+
+public:
+  PoolAllocator(const size_t size, const bool hugePages)
+    : mMapping(MAP_FAILED)
+    , mMappingSize(size)
+    , mRegion(NULL)
+    , mSize(size)
+    , mPool(static_cast<u32>(size))
+  {
+    void *address;
+    if(hugePages)
+    {
+      // a 2 MiB aligned private mapping, advised before the first touch
+      const size_t huge = 2u << 20;
+      mMappingSize = size + huge;
+      address = mmap(NULL, mMappingSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS,
+        -1, 0);
+      mMapping = address;
+      if(address != MAP_FAILED)
+      {
+        auto aligned = (reinterpret_cast<uintptr_t>(address) + huge - 1) & ~(huge - 1);
+        address = reinterpret_cast<void*>(aligned);
+        madvise(address, size, MADV_HUGEPAGE);
+      }
+    }
+    else
+    {
+      address = mmap(NULL, size, PROT_READ | PROT_WRITE,
+        MAP_SHARED | MAP_ANONYMOUS | MAP_POPULATE, -1, 0);
+      mMapping = address;
+    }
+    if(address == MAP_FAILED)
+      return;
+    mRegion = static_cast<unsigned char*>(address);
+    mlock(mRegion, mSize);
+    memset(mRegion, 0, mSize);
+  }
+  ~PoolAllocator()
+  {
+    if(mMapping != MAP_FAILED)
+      munmap(mMapping, mMappingSize);
+  }
+
+  bool Allocate(Buffer &buffer) override
+  {
+    if(mRegion == NULL)
+      return false;
+    buffer.mOffset = mPool.allocate(buffer.mSize);
+    if(buffer.mOffset == kDMAPoolInvalidOffset)
+      return false;
+    buffer.mAddress = mRegion + buffer.mOffset;
+    memset(buffer.mAddress, 0, buffer.mSize);
+    return true;
+  }
+  void Free(Buffer &buffer) override
+  {
+    mPool.free(buffer.mOffset);
+    buffer.mAddress = NULL;
+  }
+  unsigned int PeakBytesUsed() const
+  {
+    return mPool.getPeakBytesUsed();
+  }
+};
+
+int OpenTlbCounter()
+{
+  perf_event_attr attr;
+  memset(&attr, 0, sizeof(attr));
+  attr.size = sizeof(attr);
+  attr.type = PERF_TYPE_HW_CACHE;
+  attr.config = PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+    (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+  attr.disabled = 1;
+  attr.exclude_kernel = 1;
+  attr.exclude_hv = 1;
+  return static_cast<int>(syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0));
+}
+
+long MinorFaults()
+{
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  return usage.ru_minflt;
+}
+
+unsigned int failures{0};
+
+void Run(const char *name, Allocator &allocator, const unsigned int aiRingBytes,
+  const unsigned int numReconfigurations, const unsigned int numPasses, const int tlbCounter)
+{
+  auto buffers = BufferSet(aiRingBytes);
+  utils::ElapsedTimes configureTimes, reconfigureTimes, drainTimes;
+
+  auto faults = MinorFaults();
+  auto begin = std::chrono::steady_clock::now();
+  for(auto &buffer : buffers)
+  {
+    if(!allocator.Allocate(buffer))
+    {
+      printf("  %s: allocation of %u bytes failed FAILED\n", name, buffer.mSize);
+      ++failures;
+      return;
+    }
+  }
+  configureTimes.AddTime(std::chrono::steady_clock::now() - begin);
+  auto configureFaults = MinorFaults() - faults;
+
+  faults = MinorFaults();
+  for(auto i{0u}; i < numReconfigurations; ++i)
+  {
+    begin = std::chrono::steady_clock::now();
+    for(auto &buffer : buffers)
+    {
+      allocator.Free(buffer);
+    }
+    for(auto &buffer : buffers)
+    {
+      if(!allocator.Allocate(buffer))
+      {
+        printf("  %s: reallocation of %u bytes failed FAILED\n", name, buffer.mSize);
+        ++failures;
+        return;
+      }
+    }
+    reconfigureTimes.AddTime(std::chrono::steady_clock::now() - begin);
+  }
+  auto reconfigureFaults = MinorFaults() - faults;
+
+  // drain every ring a cache line at a time, as the consumers read the dma data
+  long long tlbMisses{-1};
+  if(tlbCounter >= 0)
+  {
+    ioctl(tlbCounter, PERF_EVENT_IOC_RESET, 0);
+    ioctl(tlbCounter, PERF_EVENT_IOC_ENABLE, 0);
+  }
+  volatile unsigned int sink{0};
+  for(auto pass{0u}; pass < numPasses; ++pass)
+  {
+    begin = std::chrono::steady_clock::now();
+    auto sum{0u};
+    for(auto &buffer : buffers)
+    {
+      for(auto offset{0u}; offset < buffer.mSize; offset += 64)
+      {
+        sum += buffer.mAddress[offset];
+      }
+    }
+    sink = sink + sum;
+    drainTimes.AddTime(std::chrono::steady_clock::now() - begin);
+  }
+  if(tlbCounter >= 0)
+  {
+    ioctl(tlbCounter, PERF_EVENT_IOC_DISABLE, 0);
+    if(read(tlbCounter, &tlbMisses, sizeof(tlbMisses)) != sizeof(tlbMisses))
+      tlbMisses = -1;
+  }
+
+  for(auto &buffer : buffers)
+  {
+    allocator.Free(buffer);
+  }
+
+  configureTimes.PrintHeader(name);
+  configureTimes.Print("configure");
+  reconfigureTimes.Print("reconfigure");
+  drainTimes.Print("drain pass");
+  printf("  page faults: configure %ld, reconfigure %.1f each; dtlb misses per pass: ",
+    configureFaults, static_cast<double>(reconfigureFaults) / numReconfigurations);
+  if(tlbMisses >= 0)
+    printf("%.1f\n", static_cast<double>(tlbMisses) / numPasses);
+  else
+    printf("n/a\n");
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+  if(argc > 1 && argv[1][0] == '-')
+  {
+    printf("Usage: dma_pool_benchmark [ai ring (KiB)] [reconfigurations] [drain passes]\n");
+    return -1;
+  }
+  const unsigned int aiRingBytes = ((argc > 1) ? atol(argv[1]) : 1024) * 1024;
+  const unsigned int numReconfigurations = (argc > 2) ? atol(argv[2]) : 1000;
+  const unsigned int numPasses = (argc > 3) ? atol(argv[3]) : 1000;
+
+  // the pool allocator on its own: first fit, merging, reuse of the same block
+  {
+    tDMAPool pool(64 * 1024);
+    auto a = pool.allocate(4096);
+    auto b = pool.allocate(100);
+    auto c = pool.allocate(4096);
+    pool.free(b);
+    auto d = pool.allocate(512);
+    pool.free(a);
+    pool.free(d);
+    auto e = pool.allocate(4608);
+    pool.free(c);
+    pool.free(e);
+    auto all = pool.allocate(64 * 1024);
+    auto failed = a != 0 || b != 4096 || c != 4608 || d != 4096 || e != 0 || all != 0 ||
+      pool.allocate(1) != kDMAPoolInvalidOffset || pool.getPeakBytesUsed() != 64 * 1024;
+    failures += failed ? 1 : 0;
+    printf("pool allocator: offsets %u %u %u %u %u %u%s\n", a, b, c, d, e, all,
+      failed ? " FAILED" : "");
+  }
+
+  const int tlbCounter = OpenTlbCounter();
+  if(tlbCounter < 0)
+    printf("no dtlb miss counter on this cpu, run outside a vm to see them\n");
+
+  const size_t poolBytes = aiRingBytes + 64 * 1024;
+  {
+    PerBufferAllocator allocator;
+    Run("driver, one mapping per buffer", allocator, aiRingBytes, numReconfigurations,
+      numPasses, tlbCounter);
+  }
+  {
+    PoolAllocator allocator(poolBytes, false);
+    Run("pool, populated and locked", allocator, aiRingBytes, numReconfigurations,
+      numPasses, tlbCounter);
+    printf("  pool peak use %u of %zu bytes\n", allocator.PeakBytesUsed(), poolBytes);
+  }
+  {
+    PoolAllocator allocator(poolBytes, true);
+    Run("pool, huge pages (anonymous)", allocator, aiRingBytes, numReconfigurations,
+      numPasses, tlbCounter);
+  }
+
+  if(tlbCounter >= 0)
+    close(tlbCounter);
+  printf("\n%d failures\n", failures);
+  return failures ? -1 : 0;
+}
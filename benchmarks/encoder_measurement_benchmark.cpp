@@ -0,0 +1,281 @@
+#include <climits>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <memory>
+
+#include <ElapsedTimes.hpp>
+
+#include "BenchmarkCheck.h"
+
+// OS Interface
+#include "osiBus.h"
+#include "tSimulatedXSeries.h"
+
+#include <EncoderMeasurement.h>
+#include <MessageTypes.h>
+
+/*
+ * EncoderMeasurement on a simulated x series board
+ *
+ * a and b of a quadrature encoder gate counters 0 and 1, a quarter period apart, with
+ * the model clock advanced by hand and one Poll() per period. the speed ramps up and
+ * down in steps of at most 10%, each applied at the rising edge of the leading line and
+ * with one stretched cycle of the lagging line, so the lines stay in exact quadrature.
+ * at the end of every step the published speed must be the one of the gate periods, no
+ * edge may count the wrong way, the position must be the count of every edge, and after
+ * the lines stop the speed must fall and reach 0 once the stall time passed. the same
+ * runs with b leading on a second board, where every count must go down. the counter
+ * pair must arm at once with the gate levels it had, a filter on an internal gate must
+ * be refused, and the latency from an edge to its publication must stay within two polls.
+ */
+
+namespace {
+
+constexpr auto kNanosecondsPerTick = 10ull;
+constexpr auto kLines = 1024u;
+constexpr auto kMinRpm = 300.;
+constexpr auto kMaxRpm = 3000.;
+constexpr auto kStepRatio = 1.1; // largest speed step
+constexpr auto kStepNs = 5000000ull;
+constexpr auto kHoldNs = 50000000ull;
+constexpr auto kStallNs = 20000000ull;
+constexpr auto kRpmTolerance = 0.005;
+
+constexpr EncoderConfig kEncoder{0, nCounter::kGate_PFI0, nCounter::kGate_PFI1,
+  nTriggers::kSmall_Filter, kLines, 64, 2000000ull, kStallNs, false};
+
+tSimulatedXSeries *simulated{NULL};
+unsigned long long SimulatedNs()
+{
+  return simulated->getTime();
+}
+
+// a period of 4 ticks or a multiple of it keeps the quarter exact
+unsigned int PeriodTicks(const double rpm)
+{
+  return 4u * static_cast<unsigned int>(llround(6e9 / (rpm * kLines) / 4.));
+}
+
+double Rpm(const unsigned int periodTicks)
+{
+  return 6e9 / (static_cast<double>(periodTicks) * kLines);
+}
+
+// the two lines on the simulated board and the encoder that decodes them
+struct Run
+{
+  EncoderMeasurement *encoder;
+  unsigned long long pollNs;
+  unsigned long long nextPollNs;
+  unsigned int leading; // counter of the line that leads
+  unsigned long long riseTicks; // a rising edge of the leading line
+  unsigned int periodTicks;
+  DynoSpeedSample sample;
+  double worstError; // relative, of the speeds checked
+  unsigned long long torn; // samples out of sequence
+  utils::ElapsedTimes pollTimes;
+};
+
+void RunTo(Run &run, const unsigned long long ns)
+{
+  while(run.nextPollNs <= ns)
+  {
+    simulated->advanceTo(run.nextPollNs);
+    const auto begin = std::chrono::steady_clock::now();
+    if(run.encoder->Poll() < 0)
+      Check("poll", false);
+    run.pollTimes.AddTime(std::chrono::steady_clock::now() - begin);
+    const auto sequence = run.sample.sequence;
+    if(run.encoder->mLatest.Load(run.sample) && run.sample.sequence <= sequence)
+      ++run.torn;
+    run.nextPollNs += run.pollNs;
+  }
+  simulated->advanceTo(ns);
+}
+
+void StartLines(Run &run, const unsigned int periodTicks)
+{
+  run.periodTicks = periodTicks;
+  run.riseTicks = simulated->getTime() / kNanosecondsPerTick;
+  simulated->setCounterGate(run.leading, periodTicks, periodTicks / 2);
+  simulated->advanceTo((run.riseTicks + periodTicks / 4) * kNanosecondsPerTick);
+  simulated->setCounterGate(run.leading ^ 1, periodTicks, periodTicks / 2);
+}
+
+// the new period from the next rising edge of the leading line, the lagging line a
+// quarter of it behind
+void ChangePeriod(Run &run, const unsigned int periodTicks)
+{
+  const auto nowTicks = simulated->getTime() / kNanosecondsPerTick;
+  const auto rise = run.riseTicks + ((nowTicks - run.riseTicks) / run.periodTicks + 1) *
+    run.periodTicks;
+  RunTo(run, (rise + 1) * kNanosecondsPerTick);
+  const auto stretched = run.periodTicks - run.periodTicks / 4 + periodTicks / 4;
+  simulated->setCounterGate(run.leading ^ 1, stretched, run.periodTicks / 2);
+  simulated->setCounterGate(run.leading, periodTicks, periodTicks / 2);
+  RunTo(run, (rise + run.periodTicks / 4 + 1) * kNanosecondsPerTick);
+  simulated->setCounterGate(run.leading ^ 1, periodTicks, periodTicks / 2);
+  run.riseTicks = rise + run.periodTicks;
+  run.periodTicks = periodTicks;
+}
+
+void CheckSpeed(Run &run, const double sign, const char *what)
+{
+  const auto expected = sign * Rpm(run.periodTicks);
+  run.worstError = std::max(run.worstError, fabs(run.sample.ft_DynoRPM / expected - 1.));
+  if(fabs(run.sample.ft_DynoRPM - expected) > kRpmTolerance * fabs(expected))
+  {
+    printf("  %s: %.3f rpm, %.3f expected\n", what, run.sample.ft_DynoRPM, expected);
+    Check("speed of the gate periods", false);
+  }
+}
+
+// ramps from kMinRpm to kMaxRpm and back, then stops the lines
+void Profile(Run &run, const double sign)
+{
+  auto holdEndNs = simulated->getTime() + kHoldNs;
+  RunTo(run, holdEndNs);
+  CheckSpeed(run, sign, "start");
+  auto steps{0u};
+  for(auto rpm{kMinRpm * kStepRatio}; rpm < kMaxRpm * kStepRatio; rpm *= kStepRatio)
+  {
+    ChangePeriod(run, PeriodTicks(std::min(rpm, kMaxRpm)));
+    RunTo(run, simulated->getTime() + kStepNs);
+    CheckSpeed(run, sign, "ramp up");
+    ++steps;
+  }
+  RunTo(run, simulated->getTime() + kHoldNs);
+  CheckSpeed(run, sign, "top");
+  for(auto rpm{kMaxRpm / kStepRatio}; rpm > kMinRpm / kStepRatio; rpm /= kStepRatio)
+  {
+    ChangePeriod(run, PeriodTicks(std::max(rpm, kMinRpm)));
+    RunTo(run, simulated->getTime() + kStepNs);
+    CheckSpeed(run, sign, "ramp down");
+    ++steps;
+  }
+  RunTo(run, simulated->getTime() + kHoldNs);
+  CheckSpeed(run, sign, "bottom");
+  printf("  %u speed steps between %.0f and %.0f rpm, worst speed error %.4f%%\n", steps,
+    kMinRpm, kMaxRpm, run.worstError * 100.);
+
+  // both lines stop low at their next rising edge
+  const auto latency = run.encoder->Counters();
+  Check("edge to publication within two polls", latency.mLatencies > 0 &&
+    latency.mMaxLatencyNs <= 2 * run.pollNs + run.periodTicks * kNanosecondsPerTick);
+  printf("  edge to publication avg %.1f us, max %.1f us\n",
+    latency.mLatencies ? latency.mLatencyNs * 1e-3 / latency.mLatencies : 0.,
+    latency.mMaxLatencyNs * 1e-3);
+  simulated->setCounterGate(run.leading, 0, 0);
+  simulated->setCounterGate(run.leading ^ 1, 0, 0);
+  const auto stopNs = simulated->getTime() + run.periodTicks * kNanosecondsPerTick;
+  RunTo(run, stopNs);
+  auto previous = fabs(run.sample.ft_DynoRPM);
+  auto rising{0u}, falling{0u};
+  while(simulated->getTime() < stopNs + kStallNs + 2 * run.pollNs)
+  {
+    RunTo(run, simulated->getTime() + run.pollNs);
+    const auto rpm = fabs(run.sample.ft_DynoRPM);
+    rising += rpm > previous ? 1 : 0;
+    falling += rpm < previous && rpm > 0.f ? 1 : 0;
+    previous = rpm;
+  }
+  printf("  stopped: %u falling values, then %.3f rpm\n", falling, run.sample.ft_DynoRPM);
+  Check("speed falls after the lines stop", falling > 0 && rising == 0);
+  Check("speed 0 after the stall time", run.sample.ft_DynoRPM == 0.f);
+}
+
+int RunBoard(const char *name, char *location, const unsigned int leading, const double sign,
+  const unsigned long long pollNs)
+{
+  printf("%s\n", name);
+  iBus *bus = acquireBoard(location);
+  simulated = getSimulatedXSeries(bus);
+  if(simulated == NULL)
+  {
+    printf("no simulated board FAILED\n");
+    return -1;
+  }
+  simulated->useManualClock(kTrue);
+
+  auto service = std::make_shared<NiDeviceService>("service", bus, SimulatedNs);
+  Check("open", service->Open() == 0);
+  Check("filter on an internal gate refused",
+    service->EnableCounter(2, nCounter::kGate_RTSI0, nTriggers::kSmall_Filter) != 0);
+  auto encoder = std::make_unique<EncoderMeasurement>("encoder", service, SimulatedNs, kEncoder);
+  Check("encoder open", encoder->Open() == 0);
+  if(failures)
+    return -1;
+
+  Run run{};
+  run.encoder = encoder.get();
+  run.pollNs = pollNs;
+  run.leading = leading;
+  StartLines(run, PeriodTicks(kMinRpm));
+  // the arm falls an eighth of a period into the second cycle: the leading line high, the
+  // lagging one low
+  simulated->advanceTo((run.riseTicks + run.periodTicks + run.periodTicks / 8) *
+    kNanosecondsPerTick);
+  Check("start", encoder->Start() == 0);
+  const auto &armA = service->CounterArm(0);
+  const auto &armB = service->CounterArm(1);
+  Check("pair armed at once", armA.mNs == armB.mNs);
+  Check("gate levels at the arm", (leading == 0 ? armA : armB).mGateHigh &&
+    !(leading == 0 ? armB : armA).mGateHigh);
+  run.nextPollNs = simulated->getTime() + pollNs;
+
+  Profile(run, sign);
+  const auto &counters = encoder->Counters();
+  printf("  %llu edges, %llu up, %llu down, position %lld, angle %.4f rad, %llu published\n",
+    counters.mEdges, counters.mForward, counters.mBackward, run.sample.position,
+    run.sample.ft_AngleRad, counters.mPublished);
+  Check("no count the wrong way", sign > 0 ? counters.mBackward == 0 : counters.mForward == 0);
+  Check("position of every edge", run.sample.position ==
+    static_cast<long long>(counters.mForward) - static_cast<long long>(counters.mBackward));
+  Check("angle of the position", fabs(run.sample.ft_AngleRad - 6.283185307179586 *
+    (((run.sample.position % (4 * kLines)) + 4 * kLines) % (4 * kLines)) / (4 * kLines)) < 1e-4);
+  Check("published in sequence", run.torn == 0);
+
+  const auto elapsedNs = simulated->getTime();
+  encoder->PrintStats(elapsedNs);
+  for(auto i{0u}; i < 2; ++i)
+  {
+    const auto &stream = service->Counters(static_cast<nNISTC3::tDMAChannelNumber>(
+      nNISTC3::kCounter0DmaChannel + i));
+    Check("no overflows or errors", stream.mOverflows == 0 && stream.mDmaErrors == 0 &&
+      stream.mSubsystemErrors == 0);
+  }
+  run.pollTimes.PrintHeader(name);
+  run.pollTimes.Print("Poll()");
+  printf("  %.0f updates/s\n", counters.mPublished * 1e9 / elapsedNs);
+
+  encoder->Stop();
+  encoder.reset();
+  service.reset();
+  releaseBoard(bus);
+  return 0;
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+  if(argc > 1 && argv[1][0] == '-')
+  {
+    printf("Usage: encoder_measurement_benchmark [poll (us)]\n");
+    return -1;
+  }
+  const unsigned long long pollNs = ((argc > 1) ? atol(argv[1]) : 100) * 1000ull;
+
+  char forward[] = "PXI0::0::INSTR";
+  RunBoard("EncoderMeasurement, a leading", forward, 0, 1., pollNs);
+  char reverse[] = "PXI0::1::INSTR";
+  RunBoard("EncoderMeasurement, b leading", reverse, 1, -1., pollNs);
+
+  printf("\n%d failures\n", failures);
+  return failures ? -1 : 0;
+}
@@ -0,0 +1,151 @@
+#include <climits>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include <ElapsedTimes.hpp>
+
+#include "BenchmarkCheck.h"
+
+// OS Interface
+#include "osiBus.h"
+#include "osiMMIOProfile.h"
+
+// Chip Objects
+#include "tXSeries.h"
+
+/*
+ * the register access profiler on the chip objects, without a board
+ *
+ * built with kMMIOProfiling, tXSeries runs over plain memory standing in for bar0. two
+ * loops replay the register traffic of our tools: the poll of PwmOutput (status
+ * register, fifo count, two fifo writes per pulse, an error ack now and then) and the
+ * save register spin of pwm_input. the profile must count exactly the accesses each
+ * loop issues per iteration and put them on the right registers, otherwise the
+ * benchmark fails. the cost of recording one access is printed next to a plain read of
+ * the same memory; against a ~1 us read across pcie it is small, and writes are posted
+ * on a board, so their profiled time is mostly this overhead. a second thread polling
+ * its own registers must not show up in the profile of the first, as rt tasks each
+ * report their own accesses.
+ */
+
+int main(int argc, char **argv)
+{
+  if(argc > 1 && argv[1][0] == '-')
+  {
+    printf("Usage: mmio_profile_benchmark [iterations] [pulses per poll] [report rows]\n");
+    return -1;
+  }
+  const unsigned int iterations = (argc > 1) ? atol(argv[1]) : 100000;
+  const unsigned int pulsesPerPoll = (argc > 2) ? atol(argv[2]) : 2;
+  const unsigned int rows = (argc > 3) ? atol(argv[3]) : 5;
+
+  // bar0 of an x series device ends with the do stream circuit below 0x34000
+  std::vector<u32> bar0(0x40000 / sizeof(u32), 0);
+  tAddressSpace space(bar0.data());
+  nMDBG::tStatus2 status;
+  tXSeries device(space, &status);
+  auto &profile = getMMIOProfile();
+  tCounter *counter = &device.Counter0;
+
+  // PwmOutput::Poll()
+  profile.reset();
+  utils::ElapsedTimes pollTimes;
+  for(auto i{0u}; i < iterations; ++i)
+  {
+    auto begin = std::chrono::steady_clock::now();
+    auto &statusRegister = counter->Gi_Status_Register;
+    statusRegister.refresh(&status);
+    if(statusRegister.getGi_GateSwitchError_St(&status))
+      counter->Gi_Interrupt1_Register.writeGi_GateSwitchError_Ack(kTrue, &status);
+    auto queued = counter->Gi_FifoStatusRegister.readRegister(&status);
+    for(auto pulse{0u}; pulse < pulsesPerPoll; ++pulse)
+    {
+      counter->Gi_WrFifoRegister.writeRegister(1000 + queued, &status);
+      counter->Gi_WrFifoRegister.writeRegister(4000, &status);
+    }
+    // an underrun every 100 polls
+    if(i % 100 == 99)
+      counter->Gi_Interrupt1_Register.writeGi_GateSwitchError_Ack(kTrue, &status);
+    profile.markIteration();
+    pollTimes.AddTime(std::chrono::steady_clock::now() - begin);
+  }
+  printf("PwmOutput::Poll(), %u pulses per poll:\n", pulsesPerPoll);
+  profile.report(rows);
+  Check("poll reads", profile.getReads() == 2ull * iterations);
+  Check("poll writes", profile.getWrites() ==
+    2ull * pulsesPerPoll * iterations + iterations / 100);
+
+  // pwm_input: read the save register until it changes, here it never does
+  profile.reset();
+  utils::ElapsedTimes spinTimes;
+  const auto spinReads = 8u;
+  for(auto i{0u}; i < iterations; ++i)
+  {
+    auto begin = std::chrono::steady_clock::now();
+    auto lastValue = counter->Gi_Save_Register.readRegister(&status);
+    for(auto spin{1u}; spin < spinReads; ++spin)
+    {
+      if(counter->Gi_Save_Register.readRegister(&status) != lastValue)
+        break;
+    }
+    counter->Gi_Status_Register.refresh(&status);
+    profile.markIteration();
+    spinTimes.AddTime(std::chrono::steady_clock::now() - begin);
+  }
+  printf("\npwm_input save register spin, %u reads per sample:\n", spinReads);
+  profile.report(rows);
+  Check("spin reads", profile.getReads() == (spinReads + 1ull) * iterations);
+  Check("spin writes", profile.getWrites() == 0);
+
+  // another task polling at the same time records into a profile of its own
+  auto otherReads{0ull};
+  std::thread other([&]()
+  {
+    auto &otherProfile = getMMIOProfile();
+    nMDBG::tStatus2 otherStatus;
+    for(auto i{0u}; i < iterations; ++i)
+    {
+      device.Counter1.Gi_Status_Register.refresh(&otherStatus);
+    }
+    otherReads = otherProfile.getReads();
+  });
+  other.join();
+  Check("other thread reads", otherReads == iterations);
+  Check("own reads untouched", profile.getReads() == (spinReads + 1ull) * iterations);
+
+  // what recording costs per access, against a plain read of the same memory
+  utils::ElapsedTimes plainTimes, profiledTimes;
+  volatile u32 *plain = bar0.data() + 0x20300 / sizeof(u32);
+  volatile u32 sink{0};
+  for(auto i{0u}; i < iterations; ++i)
+  {
+    auto begin = std::chrono::steady_clock::now();
+    for(auto j{0u}; j < 100; ++j)
+    {
+      sink = sink + *plain;
+    }
+    auto plainEnd = std::chrono::steady_clock::now();
+    for(auto j{0u}; j < 100; ++j)
+    {
+      sink = sink + space.read32(0x20300);
+    }
+    auto profiledEnd = std::chrono::steady_clock::now();
+    plainTimes.AddTime((plainEnd - begin) / 100);
+    profiledTimes.AddTime((profiledEnd - plainEnd) / 100);
+  }
+  printf("\n");
+  pollTimes.PrintHeader("Loop in memory");
+  pollTimes.Print("poll");
+  spinTimes.Print("spin");
+  plainTimes.PrintHeader("One read");
+  plainTimes.Print("plain");
+  profiledTimes.Print("profiled");
+
+  printf("\n%d failures\n", failures);
+  return failures ? -1 : 0;
+}
@@ -0,0 +1,296 @@
+#include <climits>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include <chrono>
+#include <iostream>
+#include <memory>
+
+#include <ElapsedTimes.hpp>
+
+#include "BenchmarkCheck.h"
+
+// OS Interface
+#include "osiBus.h"
+#include "tSimulatedXSeries.h"
+
+#include <NiDeviceService.h>
+
+/*
+ * NiDeviceService on a simulated x series board
+ *
+ * ai (8 channels), ao (2 channels), correlated di and do and the four counters all run
+ * at once from one Poll() per period, with the model clock advanced by hand. this thread
+ * is also the consumer and producer at the far end of the rings. every ai and di sample
+ * and every counter semi-period must arrive in order, every code and value pushed to ao
+ * and do must come out of the model in order, and no channel may overflow, underrun or
+ * error. Poll() is timed including the model behind every register access.
+ */
+
+namespace {
+
+constexpr auto kTimebaseHz = 100000000u;
+constexpr auto kAiChannels = 8u;
+constexpr auto kAoChannels = 2u;
+constexpr auto kGatePeriodTicks = 5000u; // 20 kHz
+constexpr auto kDiLines = 0x0000ffffu;
+constexpr auto kDoLines = 0xffff0000u;
+
+tSimulatedXSeries *simulated{NULL};
+
+// ai and di count up from the model, ao and do count up from this thread
+i16 aiNext{0};
+u32 diNext{0};
+i16 aoExpected{0};
+u32 doExpected{0};
+unsigned long long aoUpdates{0}, aoWrong{0}, doUpdates{0}, doWrong{0};
+
+unsigned long long SimulatedNs()
+{
+  return simulated->getTime();
+}
+
+i16 NextAiSample(void*, u32, u64)
+{
+  return aiNext++;
+}
+
+u32 NextDiSample(void*, u64)
+{
+  return diNext++ & kDiLines;
+}
+
+void RecordAo(void*, u32, i16 code, u64)
+{
+  aoWrong += code != aoExpected ? 1 : 0;
+  aoExpected = code + 1;
+  ++aoUpdates;
+}
+
+void RecordDo(void*, u32 value, u64)
+{
+  doWrong += value != ((doExpected << 16) & kDoLines) ? 1 : 0;
+  doExpected = (value >> 16) + 1;
+  ++doUpdates;
+}
+
+struct Consumer
+{
+  i16 aiExpected;
+  u32 diExpected;
+  unsigned long long aiSamples, aiWrong, diSamples, diWrong;
+  unsigned long long counterValues[NiServiceLimit::kNumCounters];
+  unsigned long long counterWrong[NiServiceLimit::kNumCounters];
+  i16 aoNext;
+  u32 doNext;
+};
+
+void Drain(NiDeviceService &service, Consumer &consumer, const unsigned int highTicks[])
+{
+  auto &ai = service.Ring(nNISTC3::kAI_DMAChannel);
+  NiStreamBlock *block;
+  while((block = ai.Peek()) != NULL)
+  {
+    auto *samples = reinterpret_cast<const i16*>(block->mData);
+    for(auto i{0u}; i < block->mBytes / sizeof(i16); ++i)
+    {
+      consumer.aiWrong += samples[i] != consumer.aiExpected ? 1 : 0;
+      consumer.aiExpected = samples[i] + 1;
+    }
+    consumer.aiSamples += block->mBytes / sizeof(i16);
+    ai.Release();
+  }
+
+  auto &di = service.Ring(nNISTC3::kDI_DMAChannel);
+  while((block = di.Peek()) != NULL)
+  {
+    auto *samples = reinterpret_cast<const u32*>(block->mData);
+    for(auto i{0u}; i < block->mBytes / sizeof(u32); ++i)
+    {
+      consumer.diWrong += samples[i] != (consumer.diExpected & kDiLines) ? 1 : 0;
+      consumer.diExpected = samples[i] + 1;
+    }
+    consumer.diSamples += block->mBytes / sizeof(u32);
+    di.Release();
+  }
+
+  // semi-periods alternate between the high and the low time of each gate
+  for(auto c{0u}; c < NiServiceLimit::kNumCounters; ++c)
+  {
+    auto &ring = service.Ring(static_cast<nNISTC3::tDMAChannelNumber>(
+      nNISTC3::kCounter0DmaChannel + c));
+    while((block = ring.Peek()) != NULL)
+    {
+      auto *ticks = reinterpret_cast<const u32*>(block->mData);
+      for(auto i{0u}; i < block->mBytes / sizeof(u32); ++i)
+      {
+        consumer.counterWrong[c] += ticks[i] != highTicks[c] &&
+          ticks[i] != kGatePeriodTicks - highTicks[c] ? 1 : 0;
+      }
+      consumer.counterValues[c] += block->mBytes / sizeof(u32);
+      ring.Release();
+    }
+  }
+}
+
+void Fill(NiDeviceService &service, Consumer &consumer)
+{
+  auto &ao = service.Ring(nNISTC3::kAO_DMAChannel);
+  const auto aoFrameBytes = service.FrameBytes(nNISTC3::kAO_DMAChannel);
+  NiStreamBlock *block;
+  while((block = ao.Reserve()) != NULL)
+  {
+    block->mBytes = NiServiceLimit::kBlockBytes - NiServiceLimit::kBlockBytes % aoFrameBytes;
+    auto *codes = reinterpret_cast<i16*>(block->mData);
+    for(auto i{0u}; i < block->mBytes / sizeof(i16); ++i)
+    {
+      codes[i] = consumer.aoNext++;
+    }
+    ao.Commit();
+  }
+
+  auto &dout = service.Ring(nNISTC3::kDO_DMAChannel);
+  while((block = dout.Reserve()) != NULL)
+  {
+    block->mBytes = NiServiceLimit::kBlockBytes;
+    auto *values = reinterpret_cast<u32*>(block->mData);
+    for(auto i{0u}; i < block->mBytes / sizeof(u32); ++i)
+    {
+      values[i] = (consumer.doNext++ << 16) & kDoLines;
+    }
+    dout.Commit();
+  }
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+  if(argc > 1 && argv[1][0] == '-')
+  {
+    printf("Usage: ni_device_service_benchmark [iterations] [poll (us)] [ai scan rate (kHz)] "
+      "[dio rate (kHz)]\n");
+    return -1;
+  }
+  const unsigned int iterations = (argc > 1) ? atol(argv[1]) : 20000;
+  const unsigned long long pollNs = ((argc > 2) ? atol(argv[2]) : 100) * 1000ull;
+  const unsigned int aiKHz = (argc > 3) ? atol(argv[3]) : 25;
+  const unsigned int dioKHz = (argc > 4) ? atol(argv[4]) : 1000;
+  const unsigned long long aiPeriodNs = 1000000ull / aiKHz;
+  const unsigned long long dioPeriodNs = 1000000ull / dioKHz;
+  const unsigned long long aoPeriodNs = 10000ull;
+
+  char location[] = "PXI0::0::INSTR";
+  iBus *bus = acquireBoard(location);
+  simulated = getSimulatedXSeries(bus);
+  if(simulated == NULL)
+  {
+    printf("no simulated board FAILED\n");
+    return -1;
+  }
+  simulated->useManualClock(kTrue);
+
+  const unsigned int highTicks[] = {1250, 2500, 3750, 1000};
+  for(auto i{0u}; i < NiServiceLimit::kNumCounters; ++i)
+  {
+    simulated->setCounterGate(i, kGatePeriodTicks, highTicks[i]);
+  }
+  simulated->setAiSource(kAiChannels, aiPeriodNs, NextAiSample, NULL);
+  simulated->setAoSink(kAoChannels, aoPeriodNs, RecordAo, NULL);
+  simulated->setDiSource(dioPeriodNs, NextDiSample, NULL);
+  simulated->setDoSink(dioPeriodNs, RecordDo, NULL);
+
+  auto service = std::make_unique<NiDeviceService>("service", bus, SimulatedNs);
+  Check("open", service->Open() == 0);
+  Check("enable ai", service->EnableAi(NiAiConfig{kAiChannels, nNISTC3::kInput_10V, nAI::kRSE,
+    static_cast<uint32_t>(aiPeriodNs * kTimebaseHz / 1000000000ull)}) == 0);
+  Check("enable ao", service->EnableAo(NiAoConfig{kAoChannels, nNISTC3::kOutput_10V,
+    static_cast<uint32_t>(aoPeriodNs * kTimebaseHz / 1000000000ull)}) == 0);
+  Check("enable di", service->EnableDi(NiDioConfig{kDiLines,
+    static_cast<uint32_t>(dioPeriodNs * kTimebaseHz / 1000000000ull)}) == 0);
+  Check("enable do", service->EnableDo(NiDioConfig{kDoLines,
+    static_cast<uint32_t>(dioPeriodNs * kTimebaseHz / 1000000000ull)}) == 0);
+  Check("overlapping lines refused", service->EnableDi(NiDioConfig{kDoLines, 100}) != 0);
+  const nCounter::tGi_Gate_Select_t gates[] = {nCounter::kGate_PFI0, nCounter::kGate_PFI1,
+    nCounter::kGate_PFI2, nCounter::kGate_PFI3};
+  for(auto i{0u}; i < NiServiceLimit::kNumCounters; ++i)
+  {
+    Check("enable counter", service->EnableCounter(i, gates[i]) == 0);
+  }
+  if(failures)
+  {
+    printf("\n%d failures\n", failures);
+    return -1;
+  }
+
+  Consumer consumer{};
+  Fill(*service, consumer);
+  Check("start", service->Start() == 0);
+
+  utils::ElapsedTimes advanceTimes, pollTimes;
+  double pollSeconds{0};
+  for(auto i{0u}; i < iterations; ++i)
+  {
+    auto begin = std::chrono::steady_clock::now();
+    simulated->advance(pollNs);
+    auto polled = std::chrono::steady_clock::now();
+    if(service->Poll() < 0)
+    {
+      Check("poll", false);
+      break;
+    }
+    auto end = std::chrono::steady_clock::now();
+    advanceTimes.AddTime(polled - begin);
+    pollTimes.AddTime(end - polled);
+    pollSeconds += std::chrono::duration<double>(end - polled).count();
+    Drain(*service, consumer, highTicks);
+    Fill(*service, consumer);
+  }
+  const auto elapsedNs = static_cast<unsigned long long>(iterations) * pollNs;
+  service->PrintStats(elapsedNs);
+  service->Stop();
+  Drain(*service, consumer, highTicks);
+
+  printf("ai: %llu samples, %llu out of order\n", consumer.aiSamples, consumer.aiWrong);
+  printf("di: %llu samples, %llu out of order\n", consumer.diSamples, consumer.diWrong);
+  printf("ao: %llu updates, %llu out of order\n", aoUpdates, aoWrong);
+  printf("do: %llu updates, %llu out of order\n", doUpdates, doWrong);
+  Check("ai samples in order", consumer.aiWrong == 0);
+  Check("ai samples", consumer.aiSamples + 2 * kAiChannels >= elapsedNs / aiPeriodNs * kAiChannels);
+  Check("di samples in order", consumer.diWrong == 0);
+  Check("di samples", consumer.diSamples + 2 >= elapsedNs / dioPeriodNs);
+  Check("ao updates in order", aoWrong == 0);
+  Check("ao updates", aoUpdates + 2 * kAoChannels >= elapsedNs / aoPeriodNs * kAoChannels);
+  Check("do updates in order", doWrong == 0);
+  Check("do updates", doUpdates + 2 >= elapsedNs / dioPeriodNs);
+  for(auto i{0u}; i < NiServiceLimit::kNumCounters; ++i)
+  {
+    printf("ctr%u: %llu semi-periods, %llu wrong\n", i, consumer.counterValues[i],
+      consumer.counterWrong[i]);
+    // the first semi-period starts at the arm, not at an edge
+    Check("counter semi-periods", consumer.counterWrong[i] <= 1);
+    Check("counter semi-periods in time",
+      consumer.counterValues[i] + 4 >= 2 * elapsedNs / (kGatePeriodTicks * 10ull));
+  }
+  for(auto i{0u}; i < NiServiceLimit::kNumChannels; ++i)
+  {
+    auto &counters = service->Counters(static_cast<nNISTC3::tDMAChannelNumber>(i));
+    Check("no overflows, underruns or errors", counters.mOverflows == 0 &&
+      counters.mUnderruns == 0 && counters.mDmaErrors == 0 && counters.mSubsystemErrors == 0);
+  }
+  Check("model overflows and underflows",
+    simulated->getOverflows() == 0 && simulated->getUnderflows() == 0);
+
+  advanceTimes.PrintHeader("NiDeviceService, 8 channels");
+  advanceTimes.Print("advance");
+  pollTimes.Print("Poll()");
+  const auto megabytes = (consumer.aiSamples * sizeof(i16) + consumer.diSamples * sizeof(u32) +
+    aoUpdates * sizeof(i16) + doUpdates * sizeof(u32)) / 1e6;
+  printf("  %.1f MB/s through Poll()\n", megabytes / pollSeconds);
+
+  service.reset();
+  releaseBoard(bus);
+  printf("\n%d failures\n", failures);
+  return failures ? -1 : 0;
+}
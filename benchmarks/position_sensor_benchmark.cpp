@@ -0,0 +1,561 @@
+#include <climits>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include <ElapsedTimes.hpp>
+
+#include "BenchmarkCheck.h"
+
+// OS Interface
+#include "osiBus.h"
+#include "tSimulatedXSeries.h"
+
+#include <NiDeviceService.h>
+#include <PositionSensorEmulator.h>
+#include <PositionSynthesis.h>
+
+/*
+ * resolver, encoder and hall emulation of a model rotor angle on a simulated x series board
+ *
+ * the kernels first: the avx2 synthesis must match the portable kernels bit for bit, and
+ * the sine and cosine must be within float accuracy of the libm ones; both are timed on
+ * the blocks a poll computes. then the emulator runs on the board at 200 kS/s analog and
+ * 10 MS/s digital while this thread plays the model step, publishing every 10 us, and the
+ * rt task, polling every 100 us with up to 20 us of jitter, with the model clock advanced
+ * by hand. once settled, every do update is checked against the true angle at its time:
+ * a quadrature, index or hall state that differs is an edge placed early or late, its
+ * error is how far the true angle was from that edge; two states apart or an illegal
+ * quadrature step is wrong. the resolver outputs are demodulated every carrier period
+ * against the true excitation and angle, for the angle, the amplitude and the carrier
+ * phase they carry.
+ */
+
+namespace {
+
+constexpr auto kTimebaseHz = 100e6;
+constexpr auto kAnalogTicks = 500u; // 200 kS/s
+constexpr auto kDigitalTicks = 10u; // 10 MS/s
+constexpr auto kWriteAheadNs = 300000ull;
+constexpr auto kStepNs = 10000ull; // model step
+constexpr auto kPollNs = 100000ull;
+constexpr auto kJitterNs = 20000u;
+constexpr auto kEpochNs = 1000000000000ull; // rt clock at sim time 0
+constexpr auto kSettleNs = 20000000ull; // excitation lock and two offset windows
+constexpr auto kTwoPi = 6.283185307179586;
+constexpr auto kBlockFrames = 512u;
+
+// excitation and sensors
+constexpr auto kExcitationHz = 10000.;
+constexpr auto kExcitationVolts = 4.;
+constexpr auto kExcitationPhase = 0.7;
+constexpr auto kSamplesPerCarrier = 20u;
+constexpr auto kLines = 1024u;
+constexpr auto kMotorPolePairs = 4u;
+constexpr ResolverEmulation kResolver{true, 0.5f, 1, 0.2f, 0.3f};
+constexpr EncoderEmulation kEncoder{kLines, 0x01, 0x02, 0x04, 0.3f, kMotorPolePairs, 0x08,
+  0x10, 0x20, 0.5f};
+
+// tolerances
+constexpr auto kEdgeErrorNs = 1000.; // 0.12 degrees at 20000 rpm
+constexpr auto kRampEdgeErrorNs = 5000.; // the extrapolation knows no acceleration
+constexpr auto kResolverErrorRad = 0.002; // electrical
+constexpr auto kAmplitudeError = 0.03; // linear interpolation of the carrier
+constexpr auto kPhaseErrorRad = 0.01;
+
+tSimulatedXSeries *simulated{NULL};
+unsigned long long SimNowNs()
+{
+  return kEpochNs + simulated->getTime();
+}
+
+//
+// kernels
+//
+
+void CheckKernels(utils::ElapsedTimes &resolverTimes, utils::ElapsedTimes &encoderTimes,
+  double &resolverNs, double &encoderNs)
+{
+  printf("\nkernels, %s against scalar\n", SynthesisUsesAvx2() ? "avx2" : "scalar");
+  std::mt19937 random(7);
+  std::uniform_real_distribution<float> uniform(-1.f, 1.f);
+  std::vector<float> excitation(kBlockFrames + 1);
+  std::vector<float> sine(kBlockFrames), cosine(kBlockFrames);
+  std::vector<float> sineReference(kBlockFrames), cosineReference(kBlockFrames);
+  std::vector<uint32_t> port(kBlockFrames), portReference(kBlockFrames);
+  EncoderPattern pattern{4.f * kLines, {0, 1, 3, 2}, 4, {0x28, 0x08, 0x18, 0x10, 0x30, 0x20}};
+
+  auto sameResolver{true};
+  auto sameEncoder{true};
+  for(auto i{0u}; i < 2000; ++i)
+  {
+    for(auto &value : excitation)
+    {
+      value = 5.f * uniform(random);
+    }
+    // up to 60000 electrical rpm at 200 kS/s, up to 40000 rpm at 10 MS/s for the encoder
+    const auto numFrames = kBlockFrames - (i % 13);
+    const SampleRamp angle{3.2f * uniform(random), 0.0314f * uniform(random)};
+    const auto fraction = 0.5f * (uniform(random) + 1.f);
+    SynthesizeResolver(excitation.data(), fraction, 0.5f, angle, numFrames, sine.data(),
+      cosine.data());
+    SynthesizeResolverScalar(excitation.data(), fraction, 0.5f, angle, numFrames,
+      sineReference.data(), cosineReference.data());
+    sameResolver = sameResolver &&
+      memcmp(sine.data(), sineReference.data(), numFrames * sizeof(float)) == 0 &&
+      memcmp(cosine.data(), cosineReference.data(), numFrames * sizeof(float)) == 0;
+
+    const SampleRamp counts{2048.f * (uniform(random) + 1.f), 0.0273f * uniform(random)};
+    const SampleRamp sixths{3.f * (uniform(random) + 1.f), 0.0016f * uniform(random)};
+    SynthesizeEncoder(pattern, counts, sixths, numFrames, port.data());
+    SynthesizeEncoderScalar(pattern, counts, sixths, numFrames, portReference.data());
+    sameEncoder = sameEncoder &&
+      memcmp(port.data(), portReference.data(), numFrames * sizeof(uint32_t)) == 0;
+  }
+  Check("resolver kernels match bit for bit", sameResolver);
+  Check("encoder kernels match bit for bit", sameEncoder);
+
+  // the sine and cosine alone: unit excitation, no interpolation
+  std::vector<float> ones(kBlockFrames + 1, 1.f);
+  auto maxError{0.};
+  for(auto i{0u}; i < 200; ++i)
+  {
+    const SampleRamp angle{20.f * uniform(random), 0.08f * uniform(random)};
+    SynthesizeResolver(ones.data(), 0.f, 1.f, angle, kBlockFrames, sine.data(), cosine.data());
+    for(auto k{0u}; k < kBlockFrames; ++k)
+    {
+      const double a = angle.mStart + static_cast<float>(k) * angle.mStep;
+      maxError = std::max(maxError, std::fabs(sine[k] - std::sin(a)));
+      maxError = std::max(maxError, std::fabs(cosine[k] - std::cos(a)));
+    }
+  }
+  printf("  sine and cosine within %.2e of libm for angles up to 60 rad\n", maxError);
+  Check("sine and cosine accuracy", maxError < 3e-7);
+
+  // one block of each per timing, as a poll computes them
+  const SampleRamp angle{0.3f, 0.0157f};
+  const SampleRamp counts{100.f, 0.0137f};
+  const SampleRamp sixths{1.f, 0.0008f};
+  const auto repeats = 20000u;
+  auto resolverSeconds{0.};
+  auto encoderSeconds{0.};
+  for(auto i{0u}; i < repeats; ++i)
+  {
+    auto begin = std::chrono::steady_clock::now();
+    SynthesizeResolver(excitation.data(), 0.25f, 0.5f, angle, kBlockFrames, sine.data(),
+      cosine.data());
+    auto end = std::chrono::steady_clock::now();
+    resolverTimes.AddTime(end - begin);
+    resolverSeconds += std::chrono::duration<double>(end - begin).count();
+
+    begin = std::chrono::steady_clock::now();
+    SynthesizeEncoder(pattern, counts, sixths, kBlockFrames, port.data());
+    end = std::chrono::steady_clock::now();
+    encoderTimes.AddTime(end - begin);
+    encoderSeconds += std::chrono::duration<double>(end - begin).count();
+  }
+  resolverNs = resolverSeconds * 1e9 / (repeats * kBlockFrames);
+  encoderNs = encoderSeconds * 1e9 / (repeats * kBlockFrames);
+}
+
+//
+// the board
+//
+
+struct Profile
+{
+  const char *mName;
+  double mStartRpm;
+  double mEndRpm; // linearly over the run
+  bool mExcitation;
+};
+
+struct Run
+{
+  const Profile *mProfile;
+  unsigned long long mStartNs;
+  unsigned long long mDurationNs;
+  const AiScalingTable *mAiScaling;
+  const AoScalingTable *mAoScaling;
+
+  // do
+  unsigned long long mDoUpdates;
+  unsigned long long mEdgesOff; // states off by one, an edge early or late
+  unsigned long long mWrong;
+  unsigned long long mIllegal; // a and b changed together
+  double mMaxEdgeErrorNs;
+  double mMaxHallErrorNs;
+  uint32_t mLastPort;
+  bool mHaveLast;
+
+  // ao
+  std::vector<unsigned long long> mAoNs;
+  std::vector<int16_t> mAoCodes[2];
+  int16_t mCode0;
+};
+
+Run run;
+
+double Seconds(const unsigned long long ns)
+{
+  return (static_cast<double>(ns) - run.mStartNs) * 1e-9;
+}
+
+// the model trajectory
+double AngleAt(const double t)
+{
+  const auto &profile = *run.mProfile;
+  const auto duration = run.mDurationNs * 1e-9;
+  const auto omega = profile.mStartRpm * kTwoPi / 60.;
+  const auto alpha = (profile.mEndRpm - profile.mStartRpm) * kTwoPi / 60. / duration;
+  return 1. + omega * t + 0.5 * alpha * t * t;
+}
+
+double RpmAt(const double t)
+{
+  const auto &profile = *run.mProfile;
+  return profile.mStartRpm + (profile.mEndRpm - profile.mStartRpm) * t * 1e9 / run.mDurationNs;
+}
+
+double Excitation(const double t)
+{
+  return run.mProfile->mExcitation ?
+    kExcitationVolts * std::sin(kTwoPi * kExcitationHz * t + kExcitationPhase) : 0.;
+}
+
+i16 ExcitationCode(void *, u32, u64 ns)
+{
+  // the raw code the board's calibration reads as the excitation volts
+  const auto volts = Excitation(Seconds(ns));
+  const auto *c = run.mAiScaling->mCoefficients[0];
+  double code = (volts - c[0]) / c[1];
+  for(auto i{0u}; i < 3; ++i)
+  {
+    const auto value = ((c[3] * code + c[2]) * code + c[1]) * code + c[0];
+    const auto slope = (3. * c[3] * code + 2. * c[2]) * code + c[1];
+    code -= (value - volts) / slope;
+  }
+  code = std::round(code);
+  return static_cast<i16>(code < -32768. ? -32768. : code > 32767. ? 32767. : code);
+}
+
+void RecordAo(void *, u32 channel, i16 code, u64 ns)
+{
+  if(channel == 0)
+  {
+    run.mCode0 = code;
+    return;
+  }
+  run.mAoNs.push_back(ns);
+  run.mAoCodes[0].push_back(run.mCode0);
+  run.mAoCodes[1].push_back(code);
+}
+
+int Sector(const uint32_t hall)
+{
+  static const uint32_t patterns[] = {0x28, 0x08, 0x18, 0x10, 0x30, 0x20};
+  for(auto i{0}; i < 6; ++i)
+  {
+    if(hall == patterns[i])
+      return i;
+  }
+  return -1;
+}
+
+// how far the true position is from the edge between the expected and the observed
+// state, in states; negative when they are further apart than one edge
+double EdgeDistance(const double position, const int observed, const int states)
+{
+  const auto expected = static_cast<long long>(std::floor(position));
+  const auto fraction = position - expected;
+  const auto off = ((observed - expected) % states + states) % states;
+  if(off == 0)
+    return 0.;
+  if(off == 1)
+    return 1. - fraction;
+  if(off == states - 1)
+    return fraction;
+  return -1.;
+}
+
+void RecordDo(void *, u32 port, u64 ns)
+{
+  // the first polls correct the clock offset Start() guessed, which may move an edge
+  const auto settled = ns >= run.mStartNs + kSettleNs;
+  if(settled && run.mHaveLast && ((port ^ run.mLastPort) & 0x03) == 0x03)
+    ++run.mIllegal;
+  run.mLastPort = port;
+  run.mHaveLast = true;
+  if(!settled)
+    return;
+
+  ++run.mDoUpdates;
+  const auto t = Seconds(ns);
+  const auto angle = AngleAt(t);
+  const auto radPerSecond = std::fabs(RpmAt(t)) * kTwoPi / 60.;
+
+  // quadrature and index, in counts of the turn
+  const auto countsPerRad = 4. * kLines / kTwoPi;
+  const auto counts = (angle - kEncoder.mOffsetRad) * countsPerRad;
+  static const int states[] = {0, 1, 3, 2}; // a | b << 1 to the count modulo 4
+  const auto distance = EdgeDistance(counts, states[port & 0x03], 4);
+  auto errorNs = distance > 0. ? distance / (countsPerRad * radPerSecond) * 1e9 : 0.;
+  const auto count = static_cast<long long>(std::floor(counts));
+  const auto inTurn = ((count % (4 * kLines)) + 4 * kLines) % (4 * kLines);
+  const bool index = (port & 0x04) != 0;
+  if(distance >= 0. && index != (inTurn == 0))
+  {
+    // the index is off around count 0 only
+    const auto fraction = counts - count;
+    const auto indexDistance = inTurn == 0 ? std::min(fraction, 1. - fraction) :
+      inTurn == 1 ? fraction : inTurn == 4 * kLines - 1 ? 1. - fraction : -1.;
+    if(indexDistance < 0.)
+      ++run.mWrong;
+    else
+      errorNs = std::max(errorNs, indexDistance / (countsPerRad * radPerSecond) * 1e9);
+  }
+  if(distance < 0.)
+    ++run.mWrong;
+  else if(errorNs > 0.)
+    ++run.mEdgesOff;
+  run.mMaxEdgeErrorNs = std::max(run.mMaxEdgeErrorNs, errorNs);
+
+  // halls, in sixths of the electrical turn
+  const auto sixthsPerRad = kMotorPolePairs * 6. / kTwoPi;
+  const auto sixths = (angle * kMotorPolePairs - kEncoder.mHallOffsetRad) * 6. / kTwoPi;
+  const auto sector = Sector(port & 0x38);
+  const auto hallDistance = sector < 0 ? -1. : EdgeDistance(sixths, sector, 6);
+  if(hallDistance < 0.)
+    ++run.mWrong;
+  else if(hallDistance > 0.)
+    run.mMaxHallErrorNs = std::max(run.mMaxHallErrorNs,
+      hallDistance / (sixthsPerRad * radPerSecond) * 1e9);
+}
+
+struct ResolverResult
+{
+  unsigned int mWindows;
+  double mMaxAngleError;
+  double mMaxAmplitudeError;
+  double mMaxPhaseError;
+  double mMaxVolts;
+};
+
+// every carrier period of the settled run against the true excitation and angle
+ResolverResult Demodulate()
+{
+  ResolverResult result{0, 0., 0., 0., 0.};
+  const auto *c = run.mAoScaling->mCoefficients;
+  const auto shift = kResolver.mPhaseShiftRad / (kTwoPi * kExcitationHz);
+  for(auto first{0u}; first + kSamplesPerCarrier <= run.mAoNs.size(); first += kSamplesPerCarrier)
+  {
+    if(run.mAoNs[first] < run.mStartNs + kSettleNs)
+      continue;
+    double s{0.}, cs{0.}, sExpected{0.}, cExpected{0.}, inPhase{0.}, quadrature{0.};
+    for(auto k{first}; k < first + kSamplesPerCarrier; ++k)
+    {
+      const auto t = Seconds(run.mAoNs[k]);
+      const double sineVolts = (run.mAoCodes[0][k] - c[0][0]) / c[0][1];
+      const double cosineVolts = (run.mAoCodes[1][k] - c[1][0]) / c[1][1];
+      result.mMaxVolts = std::max(result.mMaxVolts, std::max(std::fabs(sineVolts),
+        std::fabs(cosineVolts)));
+      const auto carrier = kTwoPi * kExcitationHz * (t - shift) + kExcitationPhase;
+      const auto reference = kExcitationVolts * std::sin(carrier);
+      const auto electrical = kResolver.mPolePairs * AngleAt(t) + kResolver.mOffsetRad;
+      s += sineVolts * reference;
+      cs += cosineVolts * reference;
+      sExpected += kResolver.mRatio * reference * reference * std::sin(electrical);
+      cExpected += kResolver.mRatio * reference * reference * std::cos(electrical);
+      const auto projected = sineVolts * std::sin(electrical) + cosineVolts * std::cos(electrical);
+      inPhase += projected * std::sin(carrier);
+      quadrature += projected * std::cos(carrier);
+    }
+    ++result.mWindows;
+    auto angleError = std::atan2(s, cs) - std::atan2(sExpected, cExpected);
+    angleError -= kTwoPi * std::floor(angleError / kTwoPi + 0.5);
+    result.mMaxAngleError = std::max(result.mMaxAngleError, std::fabs(angleError));
+    result.mMaxAmplitudeError = std::max(result.mMaxAmplitudeError,
+      std::fabs(std::hypot(s, cs) / std::hypot(sExpected, cExpected) - 1.));
+    result.mMaxPhaseError = std::max(result.mMaxPhaseError,
+      std::fabs(std::atan2(quadrature, inPhase)));
+  }
+  return result;
+}
+
+void RunProfile(iBus *bus, const Profile &profile, const unsigned long long durationNs,
+  utils::ElapsedTimes &pollTimes)
+{
+  printf("\n%s\n", profile.mName);
+  run.mProfile = &profile;
+  run.mDurationNs = durationNs;
+  run.mDoUpdates = run.mEdgesOff = run.mWrong = run.mIllegal = 0;
+  run.mMaxEdgeErrorNs = run.mMaxHallErrorNs = 0.;
+  run.mHaveLast = false;
+  run.mAoNs.clear();
+  run.mAoCodes[0].clear();
+  run.mAoCodes[1].clear();
+
+  auto service = std::make_shared<NiDeviceService>("sensors", bus, SimNowNs);
+  auto emulator = std::make_unique<PositionSensorEmulator>("position", service, SimNowNs,
+    PositionSensorConfig{kAnalogTicks, kDigitalTicks, kWriteAheadNs, kResolver, kEncoder});
+  Check("open", service->Open() == 0 && emulator->Open() == 0);
+  if(failures)
+    return;
+  run.mAiScaling = &service->AiScaling();
+  run.mAoScaling = &service->AoScaling();
+  const auto periodNs = static_cast<unsigned long long>(kAnalogTicks * 1e9 / kTimebaseHz);
+  simulated->setAiSource(1, periodNs, ExcitationCode, NULL);
+  simulated->setAoSink(2, periodNs, RecordAo, NULL);
+  simulated->setDoSink(static_cast<unsigned long long>(kDigitalTicks * 1e9 / kTimebaseHz),
+    RecordDo, NULL);
+
+  const auto underflows = simulated->getUnderflows();
+  run.mStartNs = simulated->getTime();
+  const auto endNs = run.mStartNs + durationNs;
+  auto angle = [](const unsigned long long ns)
+  {
+    const auto wrapped = std::fmod(AngleAt(Seconds(ns)), kTwoPi);
+    return static_cast<float>(wrapped < 0. ? wrapped + kTwoPi : wrapped);
+  };
+  emulator->Publish(angle(run.mStartNs), static_cast<float>(profile.mStartRpm));
+  Check("start", emulator->Start() == 0);
+
+  std::mt19937 random(11);
+  auto nextStepNs = run.mStartNs + kStepNs;
+  auto polls{1u};
+  auto nextPollNs = run.mStartNs + kPollNs + random() % kJitterNs;
+  auto pollFailed{false};
+  while(simulated->getTime() < endNs)
+  {
+    const auto nowNs = simulated->getTime();
+    const auto targetNs = nextStepNs < nextPollNs ? nextStepNs : nextPollNs;
+    simulated->advance(targetNs - nowNs);
+    if(targetNs == nextStepNs)
+    {
+      emulator->Publish(angle(targetNs), static_cast<float>(RpmAt(Seconds(targetNs))));
+      nextStepNs += kStepNs;
+    }
+    if(targetNs == nextPollNs)
+    {
+      auto begin = std::chrono::steady_clock::now();
+      pollFailed = emulator->Poll() < 0 || pollFailed;
+      auto end = std::chrono::steady_clock::now();
+      pollTimes.AddTime(end - begin);
+      nextPollNs = run.mStartNs + ++polls * kPollNs + random() % kJitterNs;
+    }
+  }
+  emulator->PrintStats(durationNs);
+  const auto offsetErrorNs = emulator->OffsetNs() -
+    static_cast<long long>(kEpochNs + run.mStartNs);
+  const auto excitationHz = emulator->ExcitationHz();
+  emulator->Stop();
+
+  const auto &counters = emulator->Counters();
+  Check("polls", !pollFailed);
+  // a write-ahead shorter than the fifos leaves the dma buffers empty at most polls, so
+  // the service counts underruns; only a fifo running dry puts a glitch on the lines
+  Check("no underflows", simulated->getUnderflows() == underflows);
+  Check("outputs computed ahead", counters.mBehind == 0 && counters.mRejected == 0);
+  printf("  rt clock offset %lld ns late\n", offsetErrorNs);
+  Check("rt clock offset", offsetErrorNs >= 0 && offsetErrorNs < 1000);
+
+  const auto tolerance = profile.mStartRpm == profile.mEndRpm ? kEdgeErrorNs : kRampEdgeErrorNs;
+  printf("  do: %llu updates, %llu edges off, %llu wrong, %llu illegal, max edge error "
+    "%.0f ns, hall %.0f ns (tolerance %.0f ns)\n", run.mDoUpdates, run.mEdgesOff, run.mWrong,
+    run.mIllegal, run.mMaxEdgeErrorNs, run.mMaxHallErrorNs, tolerance);
+  Check("do updates", run.mDoUpdates + 2 >= (durationNs - kSettleNs) / 100);
+  Check("no state off by more than an edge", run.mWrong == 0);
+  Check("no illegal quadrature step", run.mIllegal == 0);
+  Check("encoder edges on time", run.mMaxEdgeErrorNs <= tolerance);
+  Check("hall edges on time", run.mMaxHallErrorNs <= tolerance);
+
+  const auto resolver = Demodulate();
+  if(profile.mExcitation)
+  {
+    printf("  resolver: excitation %.2f Hz, %u carrier periods, angle error %.4f deg, "
+      "amplitude %.2f %%, carrier phase %.3f deg\n", excitationHz, resolver.mWindows,
+      resolver.mMaxAngleError * 360. / kTwoPi, resolver.mMaxAmplitudeError * 100.,
+      resolver.mMaxPhaseError * 360. / kTwoPi);
+    Check("excitation locked", std::fabs(excitationHz - kExcitationHz) < 1.);
+    Check("resolver periods", resolver.mWindows + 2 >=
+      (durationNs - kSettleNs) * kExcitationHz * 1e-9);
+    Check("resolver angle", resolver.mMaxAngleError <= kResolverErrorRad);
+    Check("resolver amplitude", resolver.mMaxAmplitudeError <= kAmplitudeError);
+    Check("resolver carrier phase", resolver.mMaxPhaseError <= kPhaseErrorRad);
+  }
+  else
+  {
+    printf("  resolver: %llu frames unlocked of %llu, at most %.4f V\n", counters.mUnlocked,
+      counters.mAoFrames, resolver.mMaxVolts);
+    Check("no excitation, no resolver output", excitationHz == 0. &&
+      counters.mUnlocked == counters.mAoFrames && resolver.mMaxVolts < 0.001);
+  }
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+  if(argc > 1 && argv[1][0] == '-')
+  {
+    printf("Usage: position_sensor_benchmark [run (ms)]\n");
+    return -1;
+  }
+  const unsigned long long durationNs = ((argc > 1) ? atol(argv[1]) : 60) * 1000000ull;
+
+  utils::ElapsedTimes resolverTimes;
+  utils::ElapsedTimes encoderTimes;
+  double resolverNs{0.};
+  double encoderNs{0.};
+  CheckKernels(resolverTimes, encoderTimes, resolverNs, encoderNs);
+
+  char location[] = "PXI0::0::INSTR";
+  iBus *bus = acquireBoard(location);
+  simulated = getSimulatedXSeries(bus);
+  if(simulated == NULL)
+  {
+    printf("no simulated board FAILED\n");
+    return -1;
+  }
+  simulated->useManualClock(kTrue);
+
+  utils::ElapsedTimes pollTimes;
+  const Profile profiles[] = {
+    {"3000 rpm", 3000., 3000., true},
+    {"20000 rpm", 20000., 20000., true},
+    {"30000 rpm", 30000., 30000., true},
+    {"20000 rpm backwards", -20000., -20000., true},
+    {"0 to 3000 rpm", 0., 3000., true},
+    {"20000 rpm without excitation", 20000., 20000., false},
+  };
+  for(const auto &profile : profiles)
+  {
+    RunProfile(bus, profile, durationNs, pollTimes);
+    if(failures)
+      break;
+  }
+
+  resolverTimes.PrintHeader("512 samples");
+  resolverTimes.Print("resolver");
+  encoderTimes.Print("encoder");
+  pollTimes.PrintHeader("Emulator");
+  pollTimes.Print("Poll()");
+  // a second of board time: two resolver channels at 200 kS/s, the do port at 10 MS/s
+  const auto load = (resolverNs * kTimebaseHz / kAnalogTicks +
+    encoderNs * kTimebaseHz / kDigitalTicks) * 1e-9;
+  printf("  %.2f ns per resolver sample, %.2f ns per do sample with %s synthesis: %.1f %% of "
+    "a core for the signals; at 30000 rpm the encoder steps every %.1f do samples\n",
+    resolverNs, encoderNs, SynthesisUsesAvx2() ? "avx2" : "scalar", load * 100.,
+    kTimebaseHz / kDigitalTicks / (30000. / 60. * 4. * kLines));
+
+  releaseBoard(bus);
+  printf("\n%d failures\n", failures);
+  return failures ? -1 : 0;
+}
@@ -0,0 +1,255 @@
+#include <climits>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include <ElapsedTimes.hpp>
+
+#include <MessageTypes.h>
+#include <PwmDutyDecoder.h>
+#include <RtLatestValue.h>
+
+/*
+ * the software half of the pwm capture without a board
+ *
+ * first the semi-period streams of three pwm lines are generated the way the counters
+ * latch them, with a counter timebase that runs fast or slow against the host clock,
+ * and fed to PwmDutyDecoder: every duty and every edge time must come back, within the
+ * shortest read delay and the drift of the anchor windows, and the line held at its
+ * last level must stall after kStallPeriods. then a capture thread publishes duty
+ * samples through RtLatestValue while a model thread steps at a fixed rate and takes
+ * the newest one.
+ * every sample carries redundant copies of its sequence, so a torn read fails the run,
+ * and the age of each sample at the model step is the edge to model latency of the
+ * software path. on a shared core the threads run in bursts and take fewer fresh
+ * samples than the rates allow, the rt tasks have cores of their own.
+ */
+
+namespace {
+
+unsigned long long NowNs()
+{
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return static_cast<unsigned long long>(now.tv_sec) * 1000000000ull + now.tv_nsec;
+}
+
+void SleepUntil(timespec &next, const long ns)
+{
+  next.tv_nsec += ns;
+  while(next.tv_nsec >= 1000000000l)
+  {
+    next.tv_nsec -= 1000000000l;
+    ++next.tv_sec;
+  }
+  clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL);
+}
+
+unsigned int failures{0};
+
+// semi-periods of one line, starting at the arm, with the line high or low at arm
+unsigned int DecodeLine(const double frequencyHz, const bool gateHigh, const double driftPpm,
+  const unsigned int numPeriods, std::mt19937 &random)
+{
+  std::uniform_real_distribution<double> duty(2., 98.);
+  std::uniform_real_distribution<double> armOffset(0., 1.);
+  const auto periodTicks = PwmCaptureLimit::kTimebaseHz / frequencyHz;
+  // the counter timebase against the host clock
+  const auto hostNsPerTick = PwmCaptureLimit::kNanosecondsPerTick / (1. + driftPpm * 1e-6);
+
+  PwmDutyDecoder decoder;
+  const unsigned long long armNs = 1000000000ull;
+  decoder.Start(armNs, gateHigh);
+
+  // partial first semi-period, then alternating full ones
+  auto highTicks = static_cast<uint32_t>(periodTicks * duty(random) / 100.);
+  auto lowTicks = static_cast<uint32_t>(periodTicks) - highTicks;
+  auto first = static_cast<uint32_t>((gateHigh ? highTicks : lowTicks) * armOffset(random)) + 1;
+  double hostNs = armNs + first * hostNsPerTick;
+  decoder.Add(first, static_cast<unsigned long long>(hostNs) + 2000);
+  // shortest read delay of every anchor window, the first one starts with the partial sample
+  double windowDelayNs{2000.}, maxWindowDelayNs{0.};
+  auto windowSamples{1u};
+
+  auto isHigh = !gateHigh;
+  auto mismatches{0u};
+  double maxEdgeErrorNs{0.};
+  for(auto i{0u}; i < 2 * numPeriods; ++i)
+  {
+    // the duty changes once per period, on the rising edge
+    if(isHigh)
+    {
+      highTicks = static_cast<uint32_t>(periodTicks * duty(random) / 100.);
+      lowTicks = static_cast<uint32_t>(periodTicks) - highTicks;
+    }
+    auto ticks = isHigh ? highTicks : lowTicks;
+    hostNs += ticks * hostNsPerTick;
+    // the dma read comes 2 to 50 us after the edge
+    auto readNs = static_cast<unsigned long long>(hostNs) + 2000 + (i * 7919) % 48000;
+    auto updated = decoder.Add(ticks, readNs);
+    windowDelayNs = std::min(windowDelayNs, readNs - hostNs);
+    if(++windowSamples == PwmCaptureLimit::kAnchorWindow)
+    {
+      maxWindowDelayNs = std::max(maxWindowDelayNs, windowDelayNs);
+      windowDelayNs = 1e12;
+      windowSamples = 0;
+    }
+    if(i > 0 && !updated)
+      ++mismatches;
+
+    if(updated && !isHigh)
+    {
+      auto expected = 100. * highTicks / (highTicks + lowTicks);
+      if(std::fabs(decoder.DutyPercent() - expected) > 1e-3)
+        ++mismatches;
+    }
+    if(updated)
+    {
+      auto edgeErrorNs = std::fabs(static_cast<double>(decoder.EdgeNs()) - hostNs);
+      maxEdgeErrorNs = edgeErrorNs > maxEdgeErrorNs ? edgeErrorNs : maxEdgeErrorNs;
+    }
+    isHigh = !isHigh;
+  }
+
+  // then the line holds its level, a stall only after kStallPeriods of the latest period
+  const auto periodNs = static_cast<unsigned long long>(1e9 / decoder.FrequencyHz());
+  if(decoder.LineHigh() != isHigh ||
+    decoder.Stalled(decoder.EdgeNs() + (PwmCaptureLimit::kStallPeriods - 1) * periodNs) ||
+    !decoder.Stalled(decoder.EdgeNs() + (PwmCaptureLimit::kStallPeriods + 1) * periodNs))
+    ++mismatches;
+
+  // edges may be late by the shortest read delay of a window, plus the drift over the
+  // window that is measured and the one it is corrected in
+  auto windowNs = PwmCaptureLimit::kAnchorWindow * periodTicks / 2. * hostNsPerTick;
+  if(maxEdgeErrorNs > maxWindowDelayNs + 2. * std::fabs(driftPpm) * 1e-6 * windowNs + 1.)
+    ++mismatches;
+  printf("%8.0f Hz, high at arm %d, drift %+5.0f ppm: %u periods, max edge error %.0f ns, "
+    "clock corrections %llu, mismatches %u\n", frequencyHz, gateHigh, driftPpm,
+    static_cast<unsigned int>(decoder.mPeriods), maxEdgeErrorNs, decoder.mClockCorrections,
+    mismatches);
+  return mismatches;
+}
+
+McuOutputSample MakeSample(const unsigned long long sequence, const unsigned long long edgeNs)
+{
+  McuOutputSample sample{};
+  sample.sequence = sequence;
+  for(auto i{0u}; i < 3; ++i)
+  {
+    sample.ft_DutyPercent[i] = static_cast<float>(sequence % 1000) + i;
+    sample.ft_FrequencyHz[i] = static_cast<float>(sequence % 997);
+    sample.edgeNs[i] = edgeNs + i;
+  }
+  return sample;
+}
+
+bool Consistent(const McuOutputSample &sample)
+{
+  for(auto i{0u}; i < 3; ++i)
+  {
+    if(sample.ft_DutyPercent[i] != static_cast<float>(sample.sequence % 1000) + i ||
+      sample.ft_FrequencyHz[i] != static_cast<float>(sample.sequence % 997) ||
+      sample.edgeNs[i] != sample.edgeNs[0] + i)
+      return false;
+  }
+  return true;
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+  if(argc > 1 && argv[1][0] == '-')
+  {
+    printf("Usage: pwm_capture_benchmark [publish period (us)] [model step (us)] "
+      "[duration (s)]\n");
+    return -1;
+  }
+  const long publishNs = ((argc > 1) ? atol(argv[1]) : 100) * 1000l;
+  const long stepNs = ((argc > 2) ? atol(argv[2]) : 50) * 1000l;
+  const unsigned int durationS = (argc > 3) ? atol(argv[3]) : 3;
+
+  std::mt19937 random(42);
+  for(auto frequencyHz : {1000., 20000., 100000.})
+  {
+    for(auto gateHigh : {false, true})
+    {
+      for(auto driftPpm : {0., 50., -50.})
+      {
+        failures += DecodeLine(frequencyHz, gateHigh, driftPpm, 20000, random);
+      }
+    }
+  }
+
+  // capture thread against model step through the latest value slot
+  RtLatestValue<McuOutputSample> latest;
+  std::atomic<bool> running{true};
+  unsigned long long published{0};
+  utils::ElapsedTimes storeTimes;
+  std::thread captureThread([&]()
+  {
+    timespec next;
+    clock_gettime(CLOCK_MONOTONIC, &next);
+    while(running)
+    {
+      SleepUntil(next, publishNs);
+      auto edgeNs = NowNs();
+      auto sample = MakeSample(++published, edgeNs);
+      auto begin = std::chrono::steady_clock::now();
+      latest.Store(sample);
+      storeTimes.AddTime(std::chrono::steady_clock::now() - begin);
+    }
+  });
+
+  unsigned long long steps{0}, taken{0}, torn{0}, reordered{0}, lastSequence{0};
+  utils::ElapsedTimes loadTimes;
+  utils::ElapsedTimes ageTimes;
+  std::thread modelThread([&]()
+  {
+    timespec next;
+    clock_gettime(CLOCK_MONOTONIC, &next);
+    McuOutputSample sample;
+    while(running)
+    {
+      SleepUntil(next, stepNs);
+      auto begin = std::chrono::steady_clock::now();
+      auto fresh = latest.Load(sample);
+      loadTimes.AddTime(std::chrono::steady_clock::now() - begin);
+      ++steps;
+      if(!fresh)
+        continue;
+
+      ++taken;
+      ageTimes.AddTime(std::chrono::nanoseconds(NowNs() - sample.edgeNs[0]));
+      if(!Consistent(sample))
+        ++torn;
+      if(sample.sequence <= lastSequence)
+        ++reordered;
+      lastSequence = sample.sequence;
+    }
+  });
+
+  std::this_thread::sleep_for(std::chrono::seconds(durationS));
+  running = false;
+  captureThread.join();
+  modelThread.join();
+
+  storeTimes.PrintHeader("Latest value");
+  storeTimes.Print("store");
+  loadTimes.Print("load");
+  ageTimes.Print("edge to model");
+  printf("published: %llu, model steps: %llu, taken: %llu, skipped: %llu, torn: %llu, "
+    "reordered: %llu\n", published, steps, taken, published - taken, torn, reordered);
+  failures += torn + reordered;
+  printf("%u failures\n", failures);
+  return failures ? -1 : 0;
+}
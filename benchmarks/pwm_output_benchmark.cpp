@@ -0,0 +1,267 @@
+#include <climits>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+
+#include <algorithm>
+#include <chrono>
+#include <deque>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include <ElapsedTimes.hpp>
+
+#include <PwmPulseQueue.h>
+
+/*
+ * how fast one counter can take new pulses from a polling task, without a board
+ *
+ * the counter loads one pulse from its fifo on every update clock edge, the task wakes
+ * every period, queues the pulses that came due and tops the fifo up to the write-ahead
+ * through PwmPulseQueue, the way RtPwmOutputTask and PwmOutput::Poll() do. the fifo is
+ * replayed against the wake-up times of a task, so every load that finds it empty is an
+ * underrun. first the replay runs on made-up wake-ups with late periods to check the
+ * queue: no reordering, latency bounded by the write-ahead and the longest gap between
+ * polls. then the wake-ups of a real periodic thread on this host are recorded, and for
+ * every write-ahead the highest update rate without underruns is searched, next to the
+ * rate with wake-ups right on time. 0 Hz means underruns at every rate tried. register
+ * reads and writes of a poll are charged with the given costs, a read across pcie takes
+ * around a microsecond.
+ */
+
+namespace {
+
+unsigned long long NowNs()
+{
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return static_cast<unsigned long long>(now.tv_sec) * 1000000000ull + now.tv_nsec;
+}
+
+void SleepUntil(timespec &next, const long ns)
+{
+  next.tv_nsec += ns;
+  while(next.tv_nsec >= 1000000000l)
+  {
+    next.tv_nsec -= 1000000000l;
+    ++next.tv_sec;
+  }
+  clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL);
+}
+
+struct ReplayResult
+{
+  unsigned long long mLoads;
+  unsigned long long mUnderruns;
+  unsigned long long mReordered;
+  unsigned long long mMerged;
+  unsigned long long mPadded;
+  double mMaxLatencyUpdates;
+};
+
+// wake-ups relative to the arm, the first update clock edge comes one update period later
+ReplayResult Replay(const std::vector<unsigned long long> &wakeNs, const unsigned long long periodNs,
+  const unsigned long long updateNs, const unsigned int writeAhead, const double readNs,
+  const double writeNs)
+{
+  ReplayResult result{};
+  // sequence numbers ride in the high ticks, the initial pulse is sequence 0
+  const PwmPulse initial{PwmOutputLimit::kMinTicks, PwmOutputLimit::kMinTicks};
+  PwmPulseQueue queue(initial);
+  std::deque<PwmPulse> fifo(writeAhead, initial);
+  std::vector<unsigned long long> pushNs(1, 0);
+  PwmPulse out[PwmOutputLimit::kFifoPulses];
+  uint32_t sequence{0}, lastLoaded{0};
+  unsigned long long nextLoadNs{updateNs}, dueNs{0};
+
+  auto loadUntil = [&](const double untilNs)
+  {
+    while(nextLoadNs < untilNs)
+    {
+      ++result.mLoads;
+      if(fifo.empty())
+      {
+        ++result.mUnderruns;
+      }
+      else
+      {
+        auto loaded = fifo.front().mHighTicks - PwmOutputLimit::kMinTicks;
+        fifo.pop_front();
+        if(loaded < lastLoaded)
+          ++result.mReordered;
+        // a repeated pulse is no update
+        if(loaded > lastLoaded)
+        {
+          auto latency = static_cast<double>(nextLoadNs - pushNs[loaded]) / updateNs;
+          if(latency > result.mMaxLatencyUpdates)
+            result.mMaxLatencyUpdates = latency;
+        }
+        lastLoaded = loaded;
+      }
+      nextLoadNs += updateNs;
+    }
+  };
+
+  for(auto wake : wakeNs)
+  {
+    // the pulses due in this period, as RtPwmOutputTask asks its source
+    dueNs += periodNs;
+    while(dueNs >= updateNs)
+    {
+      queue.Push(PwmPulse{++sequence + PwmOutputLimit::kMinTicks, PwmOutputLimit::kMinTicks});
+      pushNs.push_back(wake);
+      dueNs -= updateNs;
+    }
+
+    // status and fifo status reads, then the fifo count is what the poll sees
+    const double sampleNs = wake + 2. * readNs;
+    loadUntil(sampleNs);
+    auto numOut = queue.TopUp(fifo.size(), writeAhead, out);
+    // two register writes per pulse, the pulses land when the last one is through
+    loadUntil(sampleNs + 2. * writeNs * numOut);
+    fifo.insert(fifo.end(), out, out + numOut);
+  }
+  result.mMerged = queue.mMerged;
+  result.mPadded = queue.mPadded;
+  return result;
+}
+
+std::vector<unsigned long long> MadeUpWakeups(const unsigned long long periodNs,
+  const unsigned int count, const unsigned long long lateNs, std::mt19937 &random)
+{
+  // mostly a few us late, one period in a thousand lateNs late
+  std::uniform_int_distribution<unsigned long long> jitter(0, 5000);
+  std::uniform_int_distribution<unsigned int> spike(0, 999);
+  std::vector<unsigned long long> wakeNs(count);
+  for(auto i{0u}; i < count; ++i)
+  {
+    wakeNs[i] = (i + 1) * periodNs + jitter(random) + (spike(random) == 0 ? lateNs : 0);
+    if(i > 0 && wakeNs[i] < wakeNs[i - 1])
+      wakeNs[i] = wakeNs[i - 1];
+  }
+  return wakeNs;
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+  if(argc > 1 && argv[1][0] == '-')
+  {
+    printf("Usage: pwm_output_benchmark [task period (us)] [recording (s)] "
+      "[register read (ns)] [register write (ns)]\n");
+    return -1;
+  }
+  const unsigned long long periodNs = ((argc > 1) ? atol(argv[1]) : 100) * 1000ull;
+  const unsigned int recordS = (argc > 2) ? atol(argv[2]) : 2;
+  const double readNs = (argc > 3) ? atof(argv[3]) : 1000.;
+  const double writeNs = (argc > 4) ? atof(argv[4]) : 100.;
+
+  // the queue alone
+  utils::ElapsedTimes topUpTimes;
+  {
+    PwmPulseQueue queue;
+    PwmPulse out[PwmOutputLimit::kFifoPulses];
+    auto queued{8u};
+    for(auto i{0u}; i < 1000000; ++i)
+    {
+      queue.Push(PwmPulse{1000, 4000});
+      queue.Push(PwmPulse{1200, 3800});
+      auto begin = std::chrono::steady_clock::now();
+      auto numOut = queue.TopUp(queued, 10, out);
+      topUpTimes.AddTime(std::chrono::steady_clock::now() - begin);
+      queued = queued + numOut - 2;
+    }
+  }
+  topUpTimes.PrintHeader("Write-ahead queue");
+  topUpTimes.Print("top up");
+
+  // made-up wake-ups: a late period shorter than the write-ahead must not underrun
+  auto failures{0u};
+  std::mt19937 random(42);
+  printf("\nmade-up wake-ups, %llu us period, 50 us update period:\n", periodNs / 1000);
+  for(auto writeAhead : {4u, 8u, 16u})
+  {
+    const unsigned long long updateNs = 50000;
+    const auto slackNs = writeAhead * updateNs;
+    for(auto lateNs : {slackNs / 2, slackNs * 2})
+    {
+      auto wakeNs = MadeUpWakeups(periodNs, 200000, lateNs, random);
+      auto result = Replay(wakeNs, periodNs, updateNs, writeAhead, 0., 0.);
+      // a pulse that finds the fifo full waits for the next poll
+      unsigned long long maxGapNs{0};
+      for(auto i{1u}; i < wakeNs.size(); ++i)
+      {
+        maxGapNs = std::max(maxGapNs, wakeNs[i] - wakeNs[i - 1]);
+      }
+      const auto latencyBound = writeAhead + static_cast<double>(maxGapNs) / updateNs + 1.;
+      auto expectUnderruns = lateNs + periodNs + 5000 > slackNs;
+      auto failed = result.mReordered > 0 || result.mMaxLatencyUpdates > latencyBound ||
+        (!expectUnderruns && result.mUnderruns > 0);
+      failures += failed ? 1 : 0;
+      printf("  write-ahead %2d, late by %4llu us: loads %llu, underruns %llu, merged %llu, "
+        "padded %llu, reordered %llu, max latency %.1f updates%s\n", writeAhead,
+        lateNs / 1000, result.mLoads, result.mUnderruns, result.mMerged, result.mPadded,
+        result.mReordered, result.mMaxLatencyUpdates, failed ? " FAILED" : "");
+    }
+  }
+
+  // wake-ups of a real periodic thread
+  printf("\nrecording %d s of wake-ups every %llu us...\n", recordS, periodNs / 1000);
+  std::vector<unsigned long long> wakeNs;
+  wakeNs.reserve(recordS * 1000000000ull / periodNs + 1);
+  utils::ElapsedTimes lateTimes;
+  {
+    timespec next;
+    clock_gettime(CLOCK_MONOTONIC, &next);
+    const auto armNs = NowNs();
+    const auto count = recordS * 1000000000ull / periodNs;
+    for(auto i{0ull}; i < count; ++i)
+    {
+      SleepUntil(next, periodNs);
+      auto wake = NowNs() - armNs;
+      wakeNs.push_back(wake);
+      auto late = static_cast<long long>(wake) - static_cast<long long>((i + 1) * periodNs);
+      lateTimes.AddTime(std::chrono::nanoseconds(late > 0 ? late : 0));
+    }
+  }
+  lateTimes.PrintHeader("Task");
+  lateTimes.Print("wake-up late");
+
+  // the same number of wake-ups right on time, what the counter takes with an ideal task
+  std::vector<unsigned long long> onTimeNs(wakeNs.size());
+  for(auto i{0u}; i < onTimeNs.size(); ++i)
+  {
+    onTimeNs[i] = (i + 1) * periodNs;
+  }
+
+  printf("\nhighest update rate without underruns, %.0f ns per register read, %.0f ns per "
+    "write:\n", readNs, writeNs);
+  const unsigned int ratesHz[] = {1000, 2000, 5000, 10000, 20000, 50000, 100000, 200000,
+    500000, 1000000};
+  for(auto writeAhead : {1u, 2u, 4u, 8u, 16u, 32u, 62u})
+  {
+    unsigned int bestHz[2] = {0, 0};
+    double latencyUs[2] = {0., 0.};
+    const std::vector<unsigned long long> *traces[2] = {&onTimeNs, &wakeNs};
+    for(auto trace{0u}; trace < 2; ++trace)
+    {
+      for(auto rateHz : ratesHz)
+      {
+        auto result = Replay(*traces[trace], periodNs, 1000000000ull / rateHz, writeAhead,
+          readNs, writeNs);
+        if(result.mUnderruns > 0)
+          continue;
+        bestHz[trace] = rateHz;
+        latencyUs[trace] = result.mMaxLatencyUpdates * 1e6 / rateHz;
+      }
+    }
+    printf("  write-ahead %2d: on time %7d Hz (max latency %6.0f us), recorded %7d Hz "
+      "(max latency %6.0f us)\n", writeAhead, bestHz[0], latencyUs[0], bestHz[1],
+      latencyUs[1]);
+  }
+
+  printf("\n%d failures\n", failures);
+  return failures ? -1 : 0;
+}
@@ -0,0 +1,168 @@
+#include <climits>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+
+#include <atomic>
+#include <iostream>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include <ElapsedTimes.hpp>
+
+#include <PxiCardManager.h>
+#include <PxiCommandExecutor.h>
+#include <SimulatedPxiBackend.h>
+
+/*
+ * throughput of the pickering update engine against a simulated rack
+ *
+ * one producer thread plays RtResistanceTask (every resistor subunit changes every
+ * cycle), another plays RtSwitchTask (bit 1 of every switch subunit toggles every
+ * cycle), both post into a PxiCommandExecutor that drives the simulated cards
+ */
+
+namespace {
+
+std::atomic<bool> running{true};
+
+struct ProducerResult
+{
+  utils::ElapsedTimes mPostTimes;
+  utils::ElapsedTimes mWakeJitter;
+  unsigned long long mCompletions{0};
+  unsigned long long mDeadlineMisses{0};
+};
+
+void AddNs(timespec &time, const long ns)
+{
+  time.tv_nsec += ns;
+  while(time.tv_nsec >= 1000000000l)
+  {
+    time.tv_nsec -= 1000000000l;
+    ++time.tv_sec;
+  }
+}
+
+void ProducerRoutine(PxiCommandExecutor *executor, const int producer,
+  const std::vector<int> *handles, const bool resistor, const long periodNs,
+  ProducerResult *result)
+{
+  timespec next;
+  clock_gettime(CLOCK_MONOTONIC, &next);
+
+  PxiCommandStatus status;
+  auto cycle{0u};
+  while(running)
+  {
+    AddNs(next, periodNs);
+    clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL);
+
+    auto wakeNs = PxiCommandExecutor::NowNs();
+    auto idealNs = static_cast<unsigned long long>(next.tv_sec) * 1000000000ull + next.tv_nsec;
+    result->mWakeJitter.AddTime(std::chrono::nanoseconds(wakeNs - idealNs));
+
+    for(auto i{0u}; i < handles->size(); ++i)
+    {
+      executor->Post((*handles)[i], resistor ? 100 + (cycle * 7 + i) % 1000 : cycle & 1u);
+    }
+    result->mPostTimes.AddTime(std::chrono::nanoseconds(PxiCommandExecutor::NowNs() - wakeNs));
+
+    while(executor->PollStatus(producer, status))
+    {
+      ++result->mCompletions;
+      if(status.mDeadlineMissed)
+        ++result->mDeadlineMisses;
+    }
+    ++cycle;
+  }
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+  if(argc > 1 && argv[1][0] == '-')
+  {
+    printf("Usage: pxi_update_benchmark [resistance cards] [switch cards] "
+      "[subunits per card] [period (us)] [duration (s)]\n");
+    return -1;
+  }
+  const unsigned int numResistanceCards = (argc > 1) ? atol(argv[1]) : 6;
+  const unsigned int numSwitchCards = (argc > 2) ? atol(argv[2]) : 4;
+  const unsigned int subunitsPerCard = (argc > 3) ? atol(argv[3]) : 16;
+  const long periodNs = ((argc > 4) ? atol(argv[4]) : 10000) * 1000l;
+  const unsigned int durationS = (argc > 5) ? atol(argv[5]) : 5;
+
+  auto backend = std::make_shared<SimulatedPxiBackend>(
+    SimulatedPxiBackend::MakeRack(numResistanceCards, numSwitchCards, subunitsPerCard),
+    SimulatedPxiBackend::DriverLatency());
+
+  PxiCardManager pxiCardManager(backend);
+  pxiCardManager.FindFreeCards();
+  if(pxiCardManager.OpenAllCards())
+  {
+    printf("Error opening simulated cards. Exiting.\n");
+    return -1;
+  }
+
+  PxiCommandExecutor executor(-1, false);
+  auto resistanceProducer = executor.RegisterProducer();
+  auto switchProducer = executor.RegisterProducer();
+
+  std::vector<int> resistanceHandles;
+  std::vector<int> switchHandles;
+  for(auto &card : pxiCardManager.GetOpenCards())
+  {
+    for(auto subunit{1u}; subunit <= card->mNumOutputSubunits; ++subunit)
+    {
+      if(card->mOutputSubunits[subunit - 1].mTypeNum == PxiSubunitType::kResistor)
+        resistanceHandles.push_back(
+          executor.RegisterSubunit(resistanceProducer, card, subunit, periodNs));
+      else
+        switchHandles.push_back(
+          executor.RegisterBit(switchProducer, card, subunit, 1, periodNs));
+    }
+  }
+
+  printf("Benchmarking %lu resistor and %lu switch subunits, period %ld us, for %u s\n",
+    resistanceHandles.size(), switchHandles.size(), periodNs / 1000, durationS);
+
+  executor.Start();
+
+  ProducerResult resistanceResult;
+  ProducerResult switchResult;
+  std::thread resistanceThread(ProducerRoutine, &executor, resistanceProducer,
+    &resistanceHandles, true, periodNs, &resistanceResult);
+  std::thread switchThread(ProducerRoutine, &executor, switchProducer,
+    &switchHandles, false, periodNs, &switchResult);
+
+  std::this_thread::sleep_for(std::chrono::seconds(durationS));
+  running = false;
+  resistanceThread.join();
+  switchThread.join();
+  executor.Stop();
+
+  auto applied = executor.mStats.mApplied;
+  printf("\n");
+  executor.PrintStats();
+  printf("\nThroughput: %.0f subunits/s applied, %.1f %% of the executor busy in the driver\n",
+    static_cast<double>(applied) / durationS,
+    100. * backend->mStats.mBusyNs / (durationS * 1e9));
+
+  resistanceResult.mPostTimes.PrintHeader("Post cycle");
+  resistanceResult.mPostTimes.Print("resistance");
+  switchResult.mPostTimes.Print("switch");
+  resistanceResult.mWakeJitter.PrintHeader("Wake jitter");
+  resistanceResult.mWakeJitter.Print("resistance");
+  switchResult.mWakeJitter.Print("switch");
+
+  printf("resistance: %llu completions, %llu deadline misses\n",
+    resistanceResult.mCompletions, resistanceResult.mDeadlineMisses);
+  printf("switch: %llu completions, %llu deadline misses\n",
+    switchResult.mCompletions, switchResult.mDeadlineMisses);
+
+  pxiCardManager.CloseAllCards();
+  return 0;
+}
@@ -0,0 +1,137 @@
+#include <climits>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+#include <ElapsedTimes.hpp>
+
+#include <PxiCardManager.h>
+#include <ResistanceGenerator.h>
+#include <SimulatedPxiBackend.h>
+
+/*
+ * per-cycle cost of turning model signals into subunit resistances
+ *
+ * "vector" is the original RtGenerateResistanceArrayTask mapping (clear and refill a
+ * std::vector with 2 * x + 10), "generator" is ResistanceGenerator driven by the
+ * topology of a simulated rack, with a multi-breakpoint calibration on every subunit
+ */
+
+namespace {
+
+constexpr auto kNumSignals = 10u;
+
+// keeps the compiler from dropping the generated values
+volatile DWORD sink;
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+  if(argc > 1 && argv[1][0] == '-')
+  {
+    printf("Usage: resistance_generator_benchmark [resistance cards] [subunits per card] "
+      "[cycles]\n");
+    return -1;
+  }
+  const unsigned int numCards = (argc > 1) ? atol(argv[1]) : 8;
+  const unsigned int subunitsPerCard = (argc > 2) ? atol(argv[2]) : 16;
+  const unsigned int numCycles = (argc > 3) ? atol(argv[3]) : 100000;
+
+  auto backend = std::make_shared<SimulatedPxiBackend>(
+    SimulatedPxiBackend::MakeRack(numCards, 0, subunitsPerCard),
+    SimulatedPxiBackend::NoLatency());
+
+  PxiCardManager pxiCardManager(backend);
+  pxiCardManager.FindFreeCards();
+  if(pxiCardManager.OpenAllCards())
+  {
+    printf("Error opening simulated cards. Exiting.\n");
+    return -1;
+  }
+
+  ResistanceGenerator generator;
+  if(generator.Configure(pxiCardManager.GetOpenCards(), kNumSignals))
+    return -1;
+  const auto numSubunits = generator.NumSubunits();
+
+  // a thermistor-like curve per subunit, partly outside the 10 - 100000 ohm range
+  for(auto i{0u}; i < numSubunits; ++i)
+  {
+    ResistanceCalibration calibration{};
+    calibration.mSignal = i % kNumSignals;
+    calibration.mNumBreakpoints = 12;
+    for(auto j{0u}; j < calibration.mNumBreakpoints; ++j)
+    {
+      calibration.mX[j] = -1.2 + 0.2 * j;
+      calibration.mOhm[j] = 200000. * std::exp(-0.9 * j) + i;
+    }
+    if(generator.SetCalibration(i, calibration))
+      return -1;
+  }
+
+  printf("Generating %d subunits from %d signals, %d cycles\n",
+    numSubunits, kNumSignals, numCycles);
+
+  double signals[kNumSignals];
+  DWORD resistances[PxiLimit::kMaxSharedSubunits];
+  std::vector<DWORD> vectorResistances;
+
+  utils::ElapsedTimes vectorTimes;
+  utils::ElapsedTimes generatorTimes;
+  auto phase{0.};
+  for(auto cycle{0u}; cycle < numCycles; ++cycle)
+  {
+    for(auto i{0u}; i < kNumSignals; ++i)
+    {
+      phase += 1e-3;
+      signals[i] = std::sin(phase);
+    }
+
+    auto begin = std::chrono::steady_clock::now();
+    vectorResistances.clear();
+    for(auto i{0u}; i < numSubunits; ++i)
+    {
+      vectorResistances.push_back(signals[i % kNumSignals] * 2 + 10);
+    }
+    auto end = std::chrono::steady_clock::now();
+    vectorTimes.AddTime(end - begin);
+    sink = vectorResistances[numSubunits - 1];
+
+    begin = std::chrono::steady_clock::now();
+    generator.Generate(signals, resistances);
+    end = std::chrono::steady_clock::now();
+    generatorTimes.AddTime(end - begin);
+    sink = resistances[numSubunits - 1];
+  }
+
+  vectorTimes.PrintHeader("Generate cycle");
+  vectorTimes.Print("vector");
+  generatorTimes.Print("generator");
+
+  // every output must stay within the subunit range whatever the signal does
+  const double probes[] = {-1e9, -1.2, -0.55, 0., 0.37, 1.0, 1e9, NAN};
+  auto outOfRange{0u};
+  for(auto probe : probes)
+  {
+    for(auto i{0u}; i < kNumSignals; ++i)
+    {
+      signals[i] = probe;
+    }
+    generator.Generate(signals, resistances);
+    for(auto i{0u}; i < numSubunits; ++i)
+    {
+      if(resistances[i] < 10 || resistances[i] > 100000)
+        ++outOfRange;
+    }
+  }
+  printf("out of range outputs: %d\n", outOfRange);
+
+  pxiCardManager.CloseAllCards();
+  return outOfRange ? -1 : 0;
+}
@@ -0,0 +1,339 @@
+#include <climits>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include <ElapsedTimes.hpp>
+
+#include "BenchmarkCheck.h"
+
+// OS Interface
+#include "osiBus.h"
+#include "tSimulatedXSeries.h"
+
+#include <NiDeviceService.h>
+#include <NiWatchdog.h>
+#include <PxiCardManager.h>
+#include <PxiCommandExecutor.h>
+#include <SafeState.h>
+#include <SimulatedPxiBackend.h>
+
+/*
+ * the do watchdog of a simulated x series board and the safe states of the engines
+ *
+ * NiDeviceService streams do on lines 0..7, lines 0..5 under the watchdog hold a
+ * constant pattern and lines 6..7 count. while it is petted every update must come
+ * through untouched. once the pets stop the first update of the safe value must come
+ * exactly one timeout after the last pet, lines 6..7 must keep counting, and the
+ * expiration must survive the process: only the next Open() gives the lines back.
+ * Trip() and a SafeState with the watchdog registered must reach the safe value at
+ * once. the handlers of a SafeState must run once, newest first, and the pickering
+ * cards must end cleared with their safe subunits set and the executor stopped.
+ * Pet() is timed including the model behind the register write.
+ */
+
+namespace {
+
+constexpr auto kTimebaseHz = 100000000u;
+constexpr auto kDoLines = 0xffu;
+constexpr auto kDoPeriodNs = 10000ull;
+constexpr auto kWatchdogLines = 0x3fu;
+constexpr auto kStreamValue = 0x15u; // of the watchdog lines while they are do's
+constexpr auto kSafeValue = 0x2au;
+constexpr auto kTimeoutNs = 1000000ull;
+constexpr auto kPetPeriodNs = 10000ull;
+constexpr auto kSafeSubunitValue = 0x5u;
+
+tSimulatedXSeries *simulated{NULL};
+
+// what the do sink saw
+u32 doCount{0};
+unsigned long long doUpdates{0}, doWrong{0}, safeUpdates{0};
+unsigned long long firstSafeNs{0};
+u32 lastValue{0};
+
+unsigned long long SimulatedNs()
+{
+  return simulated->getTime();
+}
+
+void RecordDo(void*, u32 value, u64 ns)
+{
+  const auto lines = value & kWatchdogLines;
+  if(lines == kSafeValue)
+  {
+    if(safeUpdates++ == 0)
+      firstSafeNs = ns;
+  }
+  else if(lines != kStreamValue)
+  {
+    ++doWrong;
+  }
+  // lines 6 and 7 stay do's, a release repeats the last value
+  const auto count = (value & kDoLines) >> 6;
+  if(count != doCount && count != ((doCount + 1) & 3u))
+    ++doWrong;
+  doCount = count;
+  lastValue = value;
+  ++doUpdates;
+}
+
+void ResetRecord()
+{
+  safeUpdates = 0;
+  firstSafeNs = 0;
+  doWrong = 0;
+}
+
+void Fill(NiDeviceService &service, u32 &next)
+{
+  auto &dout = service.Ring(nNISTC3::kDO_DMAChannel);
+  NiStreamBlock *block;
+  while((block = dout.Reserve()) != NULL)
+  {
+    block->mBytes = NiServiceLimit::kBlockBytes;
+    auto *values = reinterpret_cast<u32*>(block->mData);
+    for(auto i{0u}; i < block->mBytes / sizeof(u32); ++i)
+    {
+      values[i] = ((next++ << 6) | kStreamValue) & kDoLines;
+    }
+    dout.Commit();
+  }
+}
+
+// keeps do streaming for ns, petting every kPetPeriodNs when a watchdog is given
+void Run(NiDeviceService &service, u32 &next, const unsigned long long ns,
+  NiWatchdog *watchdog, utils::ElapsedTimes *petTimes)
+{
+  for(auto elapsedNs{0ull}; elapsedNs < ns; elapsedNs += kPetPeriodNs)
+  {
+    simulated->advance(kPetPeriodNs);
+    if(service.Poll() < 0)
+    {
+      Check("poll", false);
+      return;
+    }
+    Fill(service, next);
+    if(watchdog == NULL)
+      continue;
+    auto begin = std::chrono::steady_clock::now();
+    watchdog->Pet();
+    if(petTimes)
+      petTimes->AddTime(std::chrono::steady_clock::now() - begin);
+  }
+}
+
+std::vector<int> entered;
+
+void Record0(void*)
+{
+  entered.push_back(0);
+}
+
+void Record1(void*)
+{
+  entered.push_back(1);
+}
+
+void Record2(void*)
+{
+  entered.push_back(2);
+}
+
+void CheckSafeState()
+{
+  SafeState safeState("safe");
+  Check("register", safeState.Register("0", Record0, NULL) == 0 &&
+    safeState.Register("1", Record1, NULL) == 0 && safeState.Register("2", Record2, NULL) == 0);
+  Check("not entered", !safeState.Entered());
+  Check("enter", safeState.Enter());
+  Check("handlers newest first", entered == std::vector<int>({2, 1, 0}));
+  Check("enter once", !safeState.Enter() && entered.size() == 3 && safeState.Entered());
+
+  SafeState full("full");
+  for(auto i{0u}; i < SafeStateLimit::kMaxHandlers; ++i)
+  {
+    full.Register("0", Record0, NULL);
+  }
+  Check("handlers limited", full.Register("1", Record1, NULL) != 0 &&
+    full.NumHandlers() == SafeStateLimit::kMaxHandlers);
+}
+
+void CheckPickering()
+{
+  auto backend = std::make_shared<SimulatedPxiBackend>(SimulatedPxiBackend::MakeRack(1, 1, 2),
+    SimulatedPxiBackend::NoLatency());
+  PxiCardManager manager(backend);
+  manager.FindFreeCards();
+  if(manager.OpenAllCards())
+  {
+    Check("open simulated cards", false);
+    return;
+  }
+  auto resistance = manager.GetCard(1);
+  auto switches = manager.GetCard(2);
+  Check("no safe subunit on a missing card", manager.AddSafeSubunit(3, 1, 0) != 0);
+  Check("no safe subunit on a missing subunit", manager.AddSafeSubunit(2, 3, 0) != 0);
+  Check("safe subunit", manager.AddSafeSubunit(2, 1, kSafeSubunitValue) == 0);
+
+  PxiCommandExecutor executor(-1, false);
+  const auto producer = executor.RegisterProducer();
+  const auto resistor = executor.RegisterSubunit(producer, resistance, 1, 1000000);
+  const auto relay = executor.RegisterSubunit(producer, switches, 2, 1000000);
+  SafeState safeState("pickering");
+  Check("register", manager.RegisterSafeState(safeState) == 0 &&
+    executor.RegisterSafeState(safeState) == 0);
+  executor.Start();
+  executor.Post(resistor, 1234);
+  executor.Post(relay, 0xffff);
+  PxiCommandStatus status;
+  auto completions{0u};
+  for(auto i{0u}; i < 1000 && completions < 2; ++i)
+  {
+    while(executor.PollStatus(producer, status))
+    {
+      ++completions;
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  Check("posts applied", completions == 2);
+
+  safeState.Enter();
+  const auto writes = backend->mStats.mWriteSubs.load();
+  executor.Post(resistor, 4321);
+  std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  Check("executor stopped", backend->mStats.mWriteSubs.load() == writes);
+
+  DWORD data[PxiLimit::kMaxSubunits];
+  backend->ViewSub(resistance->mCardNum, 1, data);
+  Check("resistor cleared", data[0] == 0);
+  backend->ViewSub(switches->mCardNum, 2, data);
+  Check("switch cleared", data[0] == 0);
+  backend->ViewSub(switches->mCardNum, 1, data);
+  Check("safe subunit set", data[0] == kSafeSubunitValue);
+  printf("pickering: %u posts applied, cards cleared, subunit 1 of card 2 at 0x%x\n",
+    completions, data[0]);
+  manager.CloseAllCards();
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+  if(argc > 1 && argv[1][0] == '-')
+  {
+    printf("Usage: safe_state_benchmark [petted (ms)]\n");
+    return -1;
+  }
+  const unsigned long long pettedNs = ((argc > 1) ? atol(argv[1]) : 100) * 1000000ull;
+
+  char location[] = "PXI0::0::INSTR";
+  iBus *bus = acquireBoard(location);
+  simulated = getSimulatedXSeries(bus);
+  if(simulated == NULL)
+  {
+    printf("no simulated board FAILED\n");
+    return -1;
+  }
+  simulated->useManualClock(kTrue);
+  simulated->setDoSink(kDoPeriodNs, RecordDo, NULL);
+
+  // before the service, as a run after a crash has to
+  auto watchdog = std::make_unique<NiWatchdog>("watchdog", bus);
+  Check("open watchdog", watchdog->Open() == 0);
+  auto service = std::make_unique<NiDeviceService>("service", bus, SimulatedNs);
+  Check("open", service->Open() == 0);
+  Check("enable do", service->EnableDo(NiDioConfig{kDoLines,
+    static_cast<uint32_t>(kDoPeriodNs * kTimebaseHz / 1000000000ull)}) == 0);
+  const NiWatchdogConfig config{kWatchdogLines, nDO::kWDT_SafeValue, kSafeValue, kTimeoutNs};
+  Check("no lines refused", watchdog->Arm(NiWatchdogConfig{0, nDO::kWDT_SafeValue, 0,
+    kTimeoutNs}) != 0);
+  Check("short timeout refused", watchdog->Arm(NiWatchdogConfig{kWatchdogLines,
+    nDO::kWDT_SafeValue, 0, 10}) != 0);
+  if(failures)
+  {
+    printf("\n%d failures\n", failures);
+    return -1;
+  }
+
+  u32 next{0};
+  Fill(*service, next);
+  Check("start", service->Start() == 0);
+  Check("arm", watchdog->Arm(config) == 0);
+
+  // petted
+  utils::ElapsedTimes petTimes;
+  Run(*service, next, pettedNs, watchdog.get(), &petTimes);
+  watchdog->PrintStats(pettedNs);
+  printf("petted: %llu do updates, %llu safe, %llu wrong\n", doUpdates, safeUpdates, doWrong);
+  Check("no expiration while petted", !watchdog->Expired() && watchdog->Expirations() == 0);
+  Check("do untouched while petted", safeUpdates == 0 && doWrong == 0);
+  Check("do updates", doUpdates + 2 >= pettedNs / kDoPeriodNs);
+
+  // stalled, as a hung rt task
+  const auto lastPetNs = simulated->getTime();
+  Run(*service, next, 3 * kTimeoutNs, NULL, NULL);
+  printf("stalled: safe value %llu ns after the last pet, %llu safe updates, %llu wrong\n",
+    firstSafeNs - lastPetNs, safeUpdates, doWrong);
+  Check("safe value one timeout after the last pet", firstSafeNs == lastPetNs + kTimeoutNs);
+  Check("other lines keep streaming", doWrong == 0 &&
+    safeUpdates + 2 >= 2 * kTimeoutNs / kDoPeriodNs);
+  Check("expired", watchdog->Expired() && watchdog->Expirations() == 1);
+  Run(*service, next, kTimeoutNs, watchdog.get(), NULL);
+  Check("a late pet does not recover", watchdog->Expired() &&
+    (lastValue & kWatchdogLines) == kSafeValue);
+
+  // the process is gone, the lines stay safe until the next run opens the board
+  watchdog.reset();
+  Run(*service, next, kTimeoutNs, NULL, NULL);
+  Check("safe after the process", (lastValue & kWatchdogLines) == kSafeValue);
+  watchdog = std::make_unique<NiWatchdog>("watchdog", bus);
+  Check("reopen", watchdog->Open() == 0);
+  Check("lines released", !watchdog->Expired() && (lastValue & kWatchdogLines) == kStreamValue);
+  ResetRecord();
+  Run(*service, next, kTimeoutNs, NULL, NULL);
+  Check("do again", safeUpdates == 0 && doWrong == 0);
+
+  // trip
+  Check("rearm", watchdog->Arm(config) == 0);
+  Run(*service, next, 10 * kTimeoutNs, watchdog.get(), NULL);
+  const auto tripNs = simulated->getTime();
+  watchdog->Trip();
+  Check("tripped at once", safeUpdates > 0 && firstSafeNs == tripNs && watchdog->Expired());
+  watchdog->Disarm();
+  Check("disarmed", !watchdog->Expired() && (lastValue & kWatchdogLines) == kStreamValue);
+
+  // entered with the watchdog registered
+  ResetRecord();
+  Check("rearm", watchdog->Arm(config) == 0);
+  Run(*service, next, kTimeoutNs, watchdog.get(), NULL);
+  SafeState safeState("motor");
+  Check("register watchdog", watchdog->RegisterSafeState(safeState) == 0);
+  const auto enterNs = simulated->getTime();
+  safeState.Enter();
+  Check("safe state trips", safeUpdates > 0 && firstSafeNs == enterNs && watchdog->Expired());
+  watchdog->Disarm();
+
+  CheckSafeState();
+  CheckPickering();
+
+  service->Stop();
+  const auto &counters = service->Counters(nNISTC3::kDO_DMAChannel);
+  Check("no underruns or errors", counters.mUnderruns == 0 && counters.mDmaErrors == 0 &&
+    counters.mSubsystemErrors == 0);
+
+  petTimes.PrintHeader("NiWatchdog, do lines 0..5 of 8");
+  petTimes.Print("Pet()");
+
+  service.reset();
+  watchdog.reset();
+  releaseBoard(bus);
+  printf("\n%d failures\n", failures);
+  return failures ? -1 : 0;
+}
@@ -0,0 +1,326 @@
+#include <climits>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include <ElapsedTimes.hpp>
+
+#include <SampleScaling.h>
+
+/*
+ * ai and ao scaling with cached coefficients against the per sample helpers
+ *
+ * the reference is nAIDataHelper::scaleData() and nAODataHelper::scaleData() as shipped,
+ * with the eeprom helper lookup copied over a made-up calibration: per sample the
+ * coefficients of the mode are multiplied by the interval gain and the offset is added,
+ * then nNISTC3::scale() runs on the interleaved sample. the tables hold what that lookup
+ * returns, so the scalar and avx2 kernels must match the reference bit for bit, which is
+ * checked for several channel counts and odd scan counts. the timing scales the blocks a
+ * 1 MS/s aggregate acquisition delivers every millisecond.
+ */
+
+namespace {
+
+constexpr auto kNumIntervals = 7u; // nNISTC3::kNumAIIntervals
+
+// the parts of the eeprom helper calibration the lookup reads
+struct ReferenceInterval
+{
+  bool mValid;
+  float mGain;
+  float mOffset;
+};
+
+struct ReferenceCalibration
+{
+  float mModeCoefficients[ScalingLimit::kAiCoefficients];
+  ReferenceInterval mIntervals[kNumIntervals];
+};
+
+struct ReferenceAoCalibration
+{
+  ReferenceInterval mIntervals[kNumIntervals];
+};
+
+unsigned int failures{0};
+
+// eepromHelper::getAIScalingCoefficients()
+void ReferenceAiCoefficients(const std::vector<ReferenceCalibration> &calibration,
+  const unsigned int adc, const unsigned int interval, float *c)
+{
+  if(adc >= calibration.size() || !calibration[adc].mIntervals[interval].mValid)
+    return;
+  for(auto i{0u}; i < ScalingLimit::kAiCoefficients; ++i)
+  {
+    c[i] = calibration[adc].mModeCoefficients[i] * calibration[adc].mIntervals[interval].mGain;
+    if(i == 0)
+      c[i] += calibration[adc].mIntervals[interval].mOffset;
+  }
+}
+
+// nAIDataHelper::scaleData() with nNISTC3::scale()
+void ReferenceScaleAi(const std::vector<int16_t> &raw, std::vector<float> &scaled,
+  const std::vector<unsigned int> &ranges, const std::vector<ReferenceCalibration> &calibration,
+  const bool isSimultaneous)
+{
+  for(auto i{0u}; i < raw.size(); ++i)
+  {
+    float c[ScalingLimit::kAiCoefficients]{};
+    auto channel = i % ranges.size();
+    ReferenceAiCoefficients(calibration, isSimultaneous ? channel : 0, ranges[channel], c);
+    float result = 0;
+    for(int j = ScalingLimit::kAiCoefficients - 1; j >= 0; --j)
+    {
+      result *= raw[i];
+      result += c[j];
+    }
+    scaled[i] = result;
+  }
+}
+
+// nAODataHelper::scaleData() with nNISTC3::scale(), samples within the dac range only
+void ReferenceScaleAo(const std::vector<float> &volts, std::vector<int16_t> &raw,
+  const std::vector<unsigned int> &ranges, const std::vector<ReferenceAoCalibration> &calibration)
+{
+  const auto numChannels = ranges.size();
+  for(auto i{0u}; i < volts.size(); i += numChannels)
+  {
+    for(auto m{0u}; m < numChannels; ++m)
+    {
+      const auto &interval = calibration[m].mIntervals[ranges[m]];
+      raw[i + m] = static_cast<int16_t>(volts[i + m] * interval.mGain + interval.mOffset);
+    }
+  }
+}
+
+std::vector<ReferenceCalibration> MadeUpCalibration(const unsigned int numAdcs,
+  std::mt19937 &random)
+{
+  // roughly what an x series device stores: an offset, 10 V over 2^15 and a small bow
+  std::uniform_real_distribution<float> spread(-1.f, 1.f);
+  std::vector<ReferenceCalibration> calibration(numAdcs);
+  for(auto &adc : calibration)
+  {
+    adc.mModeCoefficients[0] = 1e-3f * spread(random);
+    adc.mModeCoefficients[1] = 3.05e-4f * (1.f + 1e-3f * spread(random));
+    adc.mModeCoefficients[2] = 1e-12f * spread(random);
+    adc.mModeCoefficients[3] = 1e-17f * spread(random);
+    for(auto i{0u}; i < kNumIntervals; ++i)
+    {
+      auto gain = 1.f / (1u << i) * (1.f + 1e-3f * spread(random));
+      adc.mIntervals[i] = ReferenceInterval{true, gain, 1e-4f * spread(random)};
+    }
+  }
+  return calibration;
+}
+
+void CheckEqual(const char *what, const unsigned int numChannels, const unsigned int numScans,
+  const bool equal)
+{
+  if(equal)
+    return;
+  ++failures;
+  printf("  %s differs with %u channels, %u scans FAILED\n", what, numChannels, numScans);
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+  if(argc > 1 && argv[1][0] == '-')
+  {
+    printf("Usage: sample_scaling_benchmark [aggregate rate (S/s)] [block period (us)] "
+      "[blocks]\n");
+    return -1;
+  }
+  const unsigned int rate = (argc > 1) ? atol(argv[1]) : 1000000;
+  const unsigned int blockUs = (argc > 2) ? atol(argv[2]) : 1000;
+  const unsigned int numBlocks = (argc > 3) ? atol(argv[3]) : 2000;
+
+  std::mt19937 random(42);
+  std::uniform_int_distribution<int> code(-32768, 32767);
+  std::uniform_int_distribution<unsigned int> range(0, kNumIntervals - 1);
+  printf("avx2 kernels %s\n", ScalingUsesAvx2() ? "in use" : "not available");
+
+  // bit exact against the reference, odd scan counts exercise the scalar tails
+  for(auto numChannels : {1u, 3u, 8u, 16u, 32u})
+  {
+    for(auto numScans : {0u, 1u, 7u, 8u, 9u, 17u, 1000u})
+    {
+      for(auto isSimultaneous : {false, true})
+      {
+        auto calibration = MadeUpCalibration(isSimultaneous ? numChannels : 1, random);
+        std::vector<unsigned int> ranges(numChannels);
+        AiScalingTable table;
+        table.mNumChannels = numChannels;
+        for(auto m{0u}; m < numChannels; ++m)
+        {
+          ranges[m] = range(random);
+          ReferenceAiCoefficients(calibration, isSimultaneous ? m : 0, ranges[m],
+            table.mCoefficients[m]);
+        }
+        std::vector<int16_t> raw(numChannels * numScans);
+        for(auto &sample : raw)
+        {
+          sample = static_cast<int16_t>(code(random));
+        }
+        std::vector<float> interleaved(raw.size());
+        ReferenceScaleAi(raw, interleaved, ranges, calibration, isSimultaneous);
+
+        std::vector<std::vector<float>> scalar(numChannels, std::vector<float>(numScans));
+        std::vector<std::vector<float>> engine(numChannels, std::vector<float>(numScans));
+        std::vector<float*> scalarChannels(numChannels), engineChannels(numChannels);
+        for(auto m{0u}; m < numChannels; ++m)
+        {
+          scalarChannels[m] = scalar[m].data();
+          engineChannels[m] = engine[m].data();
+        }
+        ScaleAiScalar(table, raw.data(), numScans, scalarChannels.data());
+        ScaleAi(table, raw.data(), numScans, engineChannels.data());
+        auto scalarEqual{true}, engineEqual{true};
+        for(auto s{0u}; s < numScans; ++s)
+        {
+          for(auto m{0u}; m < numChannels; ++m)
+          {
+            scalarEqual &= scalar[m][s] == interleaved[s * numChannels + m];
+            engineEqual &= engine[m][s] == interleaved[s * numChannels + m];
+          }
+        }
+        CheckEqual("ai scalar", numChannels, numScans, scalarEqual);
+        CheckEqual("ai", numChannels, numScans, engineEqual);
+      }
+
+      // ao, within the dac range against the reference, beyond it clamped
+      std::vector<ReferenceAoCalibration> aoCalibration(numChannels);
+      std::vector<unsigned int> ranges(numChannels);
+      AoScalingTable aoTable;
+      aoTable.mNumChannels = numChannels;
+      std::uniform_real_distribution<float> spread(-1.f, 1.f);
+      for(auto m{0u}; m < numChannels; ++m)
+      {
+        for(auto &interval : aoCalibration[m].mIntervals)
+        {
+          interval = ReferenceInterval{true, 3276.7f * (1.f + 1e-3f * spread(random)),
+            10.f * spread(random)};
+        }
+        ranges[m] = range(random) % 4;
+        aoTable.mCoefficients[m][0] = aoCalibration[m].mIntervals[ranges[m]].mOffset;
+        aoTable.mCoefficients[m][1] = aoCalibration[m].mIntervals[ranges[m]].mGain;
+      }
+      std::vector<float> volts(numChannels * numScans);
+      std::vector<std::vector<float>> voltChannels(numChannels, std::vector<float>(numScans));
+      std::vector<const float*> inChannels(numChannels);
+      for(auto m{0u}; m < numChannels; ++m)
+      {
+        inChannels[m] = voltChannels[m].data();
+        for(auto s{0u}; s < numScans; ++s)
+        {
+          voltChannels[m][s] = volts[s * numChannels + m] = 9.9f * spread(random);
+        }
+      }
+      std::vector<int16_t> reference(volts.size()), scalar(volts.size()), engine(volts.size());
+      ReferenceScaleAo(volts, reference, ranges, aoCalibration);
+      ScaleAoScalar(aoTable, inChannels.data(), numScans, scalar.data());
+      ScaleAo(aoTable, inChannels.data(), numScans, engine.data());
+      CheckEqual("ao scalar", numChannels, numScans, scalar == reference);
+      CheckEqual("ao", numChannels, numScans, engine == reference);
+
+      // one sample above and one below, unless both would be the same one
+      if(numScans * numChannels > 1)
+      {
+        voltChannels[0][numScans - 1] = 1e6f;
+        voltChannels[numChannels - 1][0] = -1e6f;
+        ScaleAoScalar(aoTable, inChannels.data(), numScans, scalar.data());
+        ScaleAo(aoTable, inChannels.data(), numScans, engine.data());
+        CheckEqual("ao clamping", numChannels, numScans, scalar == engine &&
+          scalar[(numScans - 1) * numChannels] == 32767 && scalar[numChannels - 1] == -32768);
+      }
+    }
+  }
+
+  // cost per block of a 1 MS/s acquisition
+  const unsigned int samplesPerBlock = static_cast<unsigned long long>(rate) * blockUs / 1000000;
+  printf("\n%u S/s aggregate, %u us blocks of %u samples:\n", rate, blockUs, samplesPerBlock);
+  for(auto numChannels : {1u, 4u, 8u, 16u, 32u})
+  {
+    const auto numScans = samplesPerBlock / numChannels;
+    if(numScans == 0)
+      continue;
+    auto calibration = MadeUpCalibration(1, random);
+    std::vector<unsigned int> ranges(numChannels);
+    AiScalingTable table;
+    table.mNumChannels = numChannels;
+    for(auto m{0u}; m < numChannels; ++m)
+    {
+      ranges[m] = range(random);
+      ReferenceAiCoefficients(calibration, 0, ranges[m], table.mCoefficients[m]);
+    }
+    std::vector<int16_t> raw(numChannels * numScans);
+    for(auto &sample : raw)
+    {
+      sample = static_cast<int16_t>(code(random));
+    }
+    std::vector<float> interleaved(raw.size());
+    std::vector<std::vector<float>> scaled(numChannels, std::vector<float>(numScans));
+    std::vector<float*> channels(numChannels);
+    std::vector<const float*> inChannels(numChannels);
+    for(auto m{0u}; m < numChannels; ++m)
+    {
+      channels[m] = scaled[m].data();
+      inChannels[m] = scaled[m].data();
+    }
+    std::vector<int16_t> aoRaw(raw.size());
+    AoScalingTable aoTable;
+    aoTable.mNumChannels = numChannels;
+    std::vector<ReferenceAoCalibration> aoCalibration(numChannels);
+    for(auto m{0u}; m < numChannels; ++m)
+    {
+      for(auto &interval : aoCalibration[m].mIntervals)
+      {
+        interval = ReferenceInterval{true, 3276.7f, 0.f};
+      }
+      aoTable.mCoefficients[m][0] = 0.f;
+      aoTable.mCoefficients[m][1] = 3276.7f;
+    }
+
+    utils::ElapsedTimes times[5];
+    for(auto i{0u}; i < numBlocks; ++i)
+    {
+      auto begin = std::chrono::steady_clock::now();
+      ReferenceScaleAi(raw, interleaved, ranges, calibration, false);
+      auto referenceEnd = std::chrono::steady_clock::now();
+      ScaleAiScalar(table, raw.data(), numScans, channels.data());
+      auto scalarEnd = std::chrono::steady_clock::now();
+      ScaleAi(table, raw.data(), numScans, channels.data());
+      auto engineEnd = std::chrono::steady_clock::now();
+      ReferenceScaleAo(interleaved, aoRaw, ranges, aoCalibration);
+      auto aoReferenceEnd = std::chrono::steady_clock::now();
+      ScaleAo(aoTable, inChannels.data(), numScans, aoRaw.data());
+      auto aoEnd = std::chrono::steady_clock::now();
+      times[0].AddTime(referenceEnd - begin);
+      times[1].AddTime(scalarEnd - referenceEnd);
+      times[2].AddTime(engineEnd - scalarEnd);
+      times[3].AddTime(aoReferenceEnd - engineEnd);
+      times[4].AddTime(aoEnd - aoReferenceEnd);
+    }
+    char header[64];
+    snprintf(header, sizeof(header), "%u channels, %u scans", numChannels, numScans);
+    times[0].PrintHeader(header);
+    times[0].Print("ai per sample lookup");
+    times[1].Print("ai table scalar");
+    times[2].Print(ScalingUsesAvx2() ? "ai table avx2" : "ai table");
+    times[3].Print("ao per sample lookup");
+    times[4].Print(ScalingUsesAvx2() ? "ao table avx2" : "ao table");
+    printf("  ai speedup %.1fx, %.2f%% of a core at %u S/s\n",
+      static_cast<double>(times[0].GetAverage()) / times[2].GetAverage(),
+      100. * times[2].GetAverage() / (blockUs * 1000.), rate);
+  }
+
+  printf("\n%d failures\n", failures);
+  return failures ? -1 : 0;
+}
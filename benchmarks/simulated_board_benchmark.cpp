@@ -0,0 +1,322 @@
+#include <climits>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include <chrono>
+#include <iostream>
+#include <vector>
+
+#include <ElapsedTimes.hpp>
+
+#include "BenchmarkCheck.h"
+
+// OS Interface
+#include "osiBus.h"
+#include "tSimulatedXSeries.h"
+
+// Chip Objects
+#include "tXSeries.h"
+
+// Chip Object Helpers
+#include "streamHelper.h"
+
+// DMA Support
+#include "CHInCh/tCHInChDMAChannel.h"
+
+#include <PwmCapture.h>
+#include <PwmOutput.h>
+
+/*
+ * the ni tools on a simulated x series board
+ *
+ * built with kSimulatedBus, acquireBoard() hands out an iBus over the register model of
+ * tSimulatedXSeries, and PwmCapture, PwmOutput and the dma classes run on it unmodified
+ * with the model clock advanced by hand. pwm capture measures three scripted gates
+ * (20 kHz at 25, 50 and 75 %) and one duty change, and must decode them exactly; gates
+ * then held high and low must read 100 and 0 %, and a stream overflow must publish that
+ * no phase is measured. pwm output gets a new pulse every update period, and every
+ * pushed pulse must come out of the counter in order without an underrun. an ai scan
+ * stream runs through a dma ring with the transfer count throttling it, and every
+ * sample must arrive in order across the ring wraps. the times per poll and per read
+ * include the model behind every register access; advancing the model is timed on its
+ * own.
+ */
+
+namespace {
+
+constexpr auto kGatePeriodTicks = 5000u; // 20 kHz on timebase 3
+constexpr auto kUpdatePeriodTicks = 10000u; // 100 us
+constexpr auto kWriteAhead = 4u;
+constexpr auto kAiChannels = 8u;
+
+tSimulatedXSeries *simulated{NULL};
+std::vector<PwmPulse> pulses;
+i16 aiNext{0};
+unsigned long long SimulatedNs()
+{
+  return simulated->getTime();
+}
+
+void RecordPulse(void*, u32 counter, u32 highTicks, u32 lowTicks, u64)
+{
+  if(counter == 0)
+    pulses.push_back(PwmPulse{highTicks, lowTicks});
+}
+
+// samples count up across channels and scans, so a lost or repeated one shows
+i16 NextAiSample(void*, u32, u64)
+{
+  return aiNext++;
+}
+
+bool Near(const float value, const float expected, const float tolerance)
+{
+  return value > expected - tolerance && value < expected + tolerance;
+}
+
+void Capture(iBus *bus, const unsigned int iterations, const unsigned long long pollNs)
+{
+  const unsigned int highTicks[] = {1250, 2500, 3750};
+  for(auto i{0u}; i < PwmCaptureLimit::kNumPhases; ++i)
+  {
+    simulated->setCounterGate(i, kGatePeriodTicks, highTicks[i]);
+  }
+
+  PwmCapture capture("capture", bus, SimulatedNs);
+  Check("capture open", capture.Open() == 0);
+  Check("capture start", capture.Start() == 0);
+
+  utils::ElapsedTimes advanceTimes, pollTimes;
+  McuOutputSample sample{};
+  for(auto i{0u}; i < iterations; ++i)
+  {
+    // phase u moves to 40 % halfway
+    if(i == iterations / 2)
+    {
+      capture.mLatest.Load(sample);
+      Check("capture duty before the change", Near(sample.ft_DutyPercent[0], 25.f, 0.01f));
+      simulated->setCounterGate(0, kGatePeriodTicks, 2000);
+    }
+    auto begin = std::chrono::steady_clock::now();
+    simulated->advance(pollNs);
+    auto polled = std::chrono::steady_clock::now();
+    if(capture.Poll() < 0)
+    {
+      Check("capture poll", false);
+      break;
+    }
+    advanceTimes.AddTime(polled - begin);
+    pollTimes.AddTime(std::chrono::steady_clock::now() - polled);
+  }
+
+  capture.mLatest.Load(sample);
+  const float expected[] = {40.f, 50.f, 75.f};
+  const auto elapsedTicks = static_cast<unsigned long long>(iterations) * pollNs / 10;
+  for(auto i{0u}; i < PwmCaptureLimit::kNumPhases; ++i)
+  {
+    auto &counters = capture.Counters(i);
+    printf("capture phase %c: duty %.2f %% at %.1f Hz, %llu semi-periods, %llu drq errors\n",
+      "uvw"[i], sample.ft_DutyPercent[i], sample.ft_FrequencyHz[i], counters.mSemiPeriods,
+      counters.mDrqErrors);
+    Check("capture duty", Near(sample.ft_DutyPercent[i], expected[i], 0.01f));
+    Check("capture frequency", Near(sample.ft_FrequencyHz[i], 20000.f, 0.5f));
+    Check("capture semi-periods", counters.mSemiPeriods + 4 >= 2 * elapsedTicks / kGatePeriodTicks);
+    Check("capture errors", counters.mDrqErrors == 0 && counters.mDmaErrors == 0);
+  }
+
+  // v held high and w held low have no edges, after a few periods they read 100 and 0 %
+  simulated->setCounterGate(1, kGatePeriodTicks, kGatePeriodTicks);
+  simulated->setCounterGate(2, kGatePeriodTicks, 0);
+  for(auto i{0u}; i < 20; ++i)
+  {
+    simulated->advance(100000);
+    Check("capture poll while stalled", capture.Poll() >= 0);
+  }
+  capture.mLatest.Load(sample);
+  printf("capture stalled: duty v %.2f %%, w %.2f %%, stalled 0x%x\n", sample.ft_DutyPercent[1],
+    sample.ft_DutyPercent[2], sample.stalled);
+  Check("capture stalled phases", sample.stalled == 0x6 && sample.measured == 0x7);
+  Check("capture stalled duty", sample.ft_DutyPercent[0] == 40.f &&
+    sample.ft_DutyPercent[1] == 100.f && sample.ft_DutyPercent[2] == 0.f);
+  Check("capture stalled frequency", sample.ft_FrequencyHz[1] == 0.f &&
+    sample.ft_FrequencyHz[2] == 0.f);
+
+  // unpolled, u overflows its stream, the failed capture then measures no phase
+  simulated->advance(100000000);
+  Check("capture overflow fails", capture.Poll() < 0);
+  Check("capture overflow published", capture.mLatest.Load(sample) && sample.measured == 0);
+  capture.Stop();
+
+  advanceTimes.PrintHeader("PwmCapture, 3 phases");
+  advanceTimes.Print("advance");
+  pollTimes.Print("Poll()");
+}
+
+void Output(iBus *bus, const unsigned int iterations)
+{
+  pulses.clear();
+  simulated->setPulseSink(RecordPulse, NULL);
+
+  PwmOutput output("output", bus, 0, 4, kUpdatePeriodTicks, kWriteAhead);
+  Check("output open", output.Open() == 0);
+  const auto initial = PwmPulseFromDuty(50.f, kGatePeriodTicks);
+  Check("output start", output.Start(initial) == 0);
+
+  utils::ElapsedTimes pollTimes;
+  std::vector<PwmPulse> pushed;
+  for(auto i{0u}; i < iterations; ++i)
+  {
+    simulated->advance(kUpdatePeriodTicks * 10ull);
+    PwmPulse pulse{100 + i % 2000, kGatePeriodTicks - 100 - i % 2000};
+    pushed.push_back(pulse);
+    output.Push(pulse);
+    auto begin = std::chrono::steady_clock::now();
+    if(output.Poll() < 0)
+    {
+      Check("output poll", false);
+      break;
+    }
+    pollTimes.AddTime(std::chrono::steady_clock::now() - begin);
+  }
+  output.Stop();
+  simulated->setPulseSink(NULL, NULL);
+
+  // the initial pulse until the write-ahead drained, then every pushed one in order
+  auto first{0u};
+  while(first < pulses.size() && pulses[first].mHighTicks == initial.mHighTicks)
+  {
+    ++first;
+  }
+  auto inOrder{true};
+  for(auto i{first}; i < pulses.size(); ++i)
+  {
+    auto &expected = pushed[i - first];
+    inOrder = inOrder && pulses[i].mHighTicks == expected.mHighTicks &&
+      pulses[i].mLowTicks == expected.mLowTicks;
+  }
+  auto &counters = output.Counters();
+  printf("output: %zu pulses out, %u initial, %llu underruns, %llu writes too fast\n",
+    pulses.size(), first, counters.mUnderruns, counters.mWritesTooFast);
+  Check("output pulses in order", inOrder);
+  Check("output pulses out", pulses.size() - first + kWriteAhead + 1 >= iterations);
+  Check("output errors", counters.mUnderruns == 0 && counters.mWritesTooFast == 0);
+
+  pollTimes.PrintHeader("PwmOutput");
+  pollTimes.Print("Poll()");
+}
+
+void AiStream(iBus *bus, const unsigned int iterations, const unsigned long long scanPeriodNs,
+  const unsigned long long readNs, const unsigned int ringBytes)
+{
+  nMDBG::tStatus2 status;
+  tAddressSpace bar0 = bus->createAddressSpace(kPCI_BAR0);
+  tXSeries device(bar0, &status);
+  nNISTC3::streamHelper stream(device.AIStreamCircuit, device.CHInCh, status);
+  nNISTC3::tCHInChDMAChannel dma(device, nNISTC3::kAI_DMAChannel, status);
+  dma.reset(status);
+  dma.configure(bus, nNISTC3::kReuseLinkRing, nNISTC3::kIn, ringBytes, status);
+  dma.start(status);
+  stream.configureForInput(kTrue, nNISTC3::kAI_DMAChannel, status);
+  stream.modifyTransferSize(ringBytes, status);
+  stream.enable(status);
+
+  // the capture overflowed on purpose before
+  const auto overflowsBefore = simulated->getOverflows();
+  aiNext = 0;
+  simulated->setAiSource(kAiChannels, scanPeriodNs, NextAiSample, NULL);
+  // START1 selects the software pulse after reset, so it comes with the arm
+  device.AI.AI_Timer.Command_Register.writeRegister(nInTimer::nCommand_Register::nSC_Arm::kMask |
+    nInTimer::nCommand_Register::nSTART1_Pulse::kMask, &status);
+  Check("ai setup", status.isNotFatal());
+
+  utils::ElapsedTimes advanceTimes, readTimes;
+  std::vector<i16> samples(ringBytes / sizeof(i16));
+  i16 expected{0};
+  unsigned long long numSamples{0}, numWrong{0};
+  double advanceSeconds{0}, readSeconds{0};
+  for(auto i{0u}; i < iterations && status.isNotFatal(); ++i)
+  {
+    auto begin = std::chrono::steady_clock::now();
+    simulated->advance(readNs);
+    auto advanced = std::chrono::steady_clock::now();
+
+    u32 bytesAvailable{0};
+    tBoolean overwritten{kFalse};
+    dma.read(0, NULL, &bytesAvailable, kFalse, &overwritten, status);
+    auto bytes = bytesAvailable - bytesAvailable % sizeof(i16);
+    if(bytes > 0)
+    {
+      dma.read(bytes, reinterpret_cast<u8*>(samples.data()), &bytesAvailable, kFalse,
+        &overwritten, status);
+      stream.modifyTransferSize(bytes, status);
+    }
+    auto end = std::chrono::steady_clock::now();
+    advanceTimes.AddTime(advanced - begin);
+    readTimes.AddTime(end - advanced);
+    advanceSeconds += std::chrono::duration<double>(advanced - begin).count();
+    readSeconds += std::chrono::duration<double>(end - advanced).count();
+
+    for(auto j{0u}; j < bytes / sizeof(i16); ++j)
+    {
+      numWrong += samples[j] != expected ? 1 : 0;
+      expected = samples[j] + 1;
+    }
+    numSamples += bytes / sizeof(i16);
+  }
+  device.AI.AI_Timer.Command_Register.writeRegister(nInTimer::nCommand_Register::nDisarm::kMask,
+    &status);
+  stream.disable(status);
+  dma.stop(status);
+
+  const auto expectedSamples = static_cast<unsigned long long>(iterations) * readNs /
+    scanPeriodNs * kAiChannels;
+  const auto overflows = simulated->getOverflows() - overflowsBefore;
+  printf("ai: %llu samples through a %u byte ring, %llu out of order, %llu overflows\n",
+    numSamples, ringBytes, numWrong, static_cast<unsigned long long>(overflows));
+  Check("ai status", status.isNotFatal());
+  Check("ai samples in order", numWrong == 0);
+  Check("ai samples", numSamples + 2 * kAiChannels >= expectedSamples);
+  Check("ai overflows", overflows == 0);
+
+  advanceTimes.PrintHeader("AI stream");
+  advanceTimes.Print("advance");
+  readTimes.Print("read");
+  const auto megabytes = numSamples * sizeof(i16) / 1e6;
+  printf("  model %.1f MB/s, dma read %.1f MB/s\n", megabytes / advanceSeconds,
+    megabytes / readSeconds);
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+  if(argc > 1 && argv[1][0] == '-')
+  {
+    printf("Usage: simulated_board_benchmark [iterations] [poll (us)] [ai scan rate (kHz)] "
+      "[ai ring (KiB)]\n");
+    return -1;
+  }
+  const unsigned int iterations = (argc > 1) ? atol(argv[1]) : 10000;
+  const unsigned long long pollNs = ((argc > 2) ? atol(argv[2]) : 100) * 1000ull;
+  const unsigned long long scanPeriodNs = 1000000ull / ((argc > 3) ? atol(argv[3]) : 100);
+  const unsigned int ringBytes = ((argc > 4) ? atol(argv[4]) : 64) * 1024;
+
+  char location[] = "PXI0::0::INSTR";
+  iBus *bus = acquireBoard(location);
+  simulated = getSimulatedXSeries(bus);
+  if(simulated == NULL)
+  {
+    printf("no simulated board FAILED\n");
+    return -1;
+  }
+  simulated->useManualClock(kTrue);
+
+  Capture(bus, iterations, pollNs);
+  Output(bus, iterations);
+  AiStream(bus, iterations, scanPeriodNs, pollNs, ringBytes);
+
+  releaseBoard(bus);
+  printf("\n%d failures\n", failures);
+  return failures ? -1 : 0;
+}
@@ -0,0 +1,241 @@
+#include <climits>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include <ElapsedTimes.hpp>
+
+#include "BenchmarkCheck.h"
+
+// OS Interface
+#include "osiBus.h"
+#include "tSimulatedXSeries.h"
+
+#include <NiDeviceService.h>
+#include <SyncAcquisition.h>
+
+/*
+ * ai of three simulated boards started by one trigger, merged and timestamped
+ *
+ * the boards run in lockstep on one manual clock, each oscillator off by its own ppm,
+ * and the rt clock of the polls runs fast against all of them. every board gives the
+ * model time of a scan as its code, so the boards of one merged scan agree exactly
+ * when it was one instant. with the pll they must agree on every scan; on their own
+ * oscillators they must be seen to drift apart, which is what the pll is for.
+ *
+ * the polls come at jittered intervals, as an rt task's do. the time of every merged
+ * scan must be within kMaxTimestampErrorNs of the true rt time of the scan once the
+ * scan clock has settled, and the drift it found must be the ppm the clocks are apart.
+ */
+
+namespace {
+
+constexpr auto kTimebaseHz = 100000000ull;
+constexpr auto kNumBoards = 3u;
+constexpr auto kAiChannels = 4u;
+constexpr auto kScanPeriodNs = 100000ull; // 10 kS/s
+constexpr auto kRtSkewPpm = 37.; // of the rt clock against the model
+constexpr auto kRtEpochNs = 1000000000000ull; // rt clock at model time 0
+constexpr auto kSettleNs = 1000000000ull; // of the scan clock, before its times are checked
+constexpr auto kMaxTimestampErrorNs = 1000.;
+constexpr auto kMaxDriftErrorPpm = 1.;
+
+const double kOscillatorPpm[kNumBoards] = {40., -25., 10.};
+
+tSimulatedXSeries *boards[kNumBoards];
+std::vector<u64> masterScanNs; // model time of every scan of the master
+double RtOf(const u64 modelNs)
+{
+  return kRtEpochNs + modelNs * (1. + kRtSkewPpm * 1e-6);
+}
+
+unsigned long long RtNs()
+{
+  return static_cast<unsigned long long>(RtOf(boards[0]->getTime()));
+}
+
+// the model time of the scan in us, the master also keeps it whole
+i16 ScanTime(void *context, u32 channel, u64 ns)
+{
+  if(context != NULL && channel == 0)
+    masterScanNs.push_back(ns);
+  return static_cast<i16>(ns / 1000);
+}
+
+struct Result
+{
+  unsigned long long mScans;
+  unsigned long long mMisalignedScans; // where a board's scan was not the master's instant
+  unsigned long long mCheckedScans;
+  double mMaxErrorNs;
+  double mMeanErrorNs;
+  double mDriftPpm;
+  SyncAcquisitionCounters mCounters;
+};
+
+Result Run(const char *name, const bool lockPll, const double seconds,
+  const unsigned long long pollNs, utils::ElapsedTimes &pollTimes)
+{
+  Result result{};
+  iBus *buses[kNumBoards];
+  u64 nowNs{0};
+  for(auto i{0u}; i < kNumBoards; ++i)
+  {
+    char location[32];
+    snprintf(location, sizeof(location), "PXI0::%u::INSTR", i);
+    buses[i] = acquireBoard(location);
+    boards[i] = getSimulatedXSeries(buses[i]);
+    if(boards[i] == NULL)
+    {
+      Check("simulated board", false);
+      return result;
+    }
+    boards[i]->useManualClock(kTrue);
+    if(boards[i]->getTime() > nowNs)
+      nowNs = boards[i]->getTime();
+    boards[i]->setOscillatorPpm(kOscillatorPpm[i]);
+    boards[i]->setAiSource(kAiChannels, kScanPeriodNs, ScanTime, i == 0 ? boards : NULL);
+  }
+  // one backplane, one time
+  for(auto *board : boards)
+  {
+    board->advanceTo(nowNs);
+  }
+  masterScanNs.clear();
+  masterScanNs.reserve(static_cast<size_t>(seconds * 1e9 / kScanPeriodNs) + 1024);
+
+  {
+    auto acquisition = std::make_unique<SyncAcquisition>(name, RtNs);
+    char names[kNumBoards][16];
+    for(auto i{0u}; i < kNumBoards; ++i)
+    {
+      snprintf(names[i], sizeof(names[i]), "board %u", i);
+      auto service = std::make_shared<NiDeviceService>(names[i], buses[i], RtNs);
+      Check("open", service->Open() == 0);
+      Check("add", acquisition->AddDevice(service) == 0);
+    }
+    Check("synchronize", acquisition->Open(NiAiConfig{kAiChannels, nNISTC3::kInput_10V,
+      nAI::kRSE, static_cast<uint32_t>(kScanPeriodNs * kTimebaseHz / 1000000000ull)},
+      lockPll) == 0);
+    Check("start", acquisition->Start() == 0);
+    const auto startNs = boards[0]->getTime();
+
+    std::mt19937 random(7);
+    std::uniform_int_distribution<unsigned long long> jitter(pollNs / 2, 3 * pollNs / 2);
+    auto &ring = *acquisition->mRing;
+    const auto scanBytes = acquisition->FrameBytes();
+    auto errorSumNs{0.};
+    while(boards[0]->getTime() - startNs < seconds * 1e9)
+    {
+      const auto stepNs = jitter(random);
+      for(auto *board : boards)
+      {
+        board->advance(stepNs);
+      }
+      auto begin = std::chrono::steady_clock::now();
+      const auto polled = acquisition->Poll();
+      pollTimes.AddTime(std::chrono::steady_clock::now() - begin);
+      if(polled < 0)
+      {
+        Check("poll", false);
+        break;
+      }
+
+      SyncBlock *block;
+      while((block = ring.Peek()) != NULL)
+      {
+        for(auto k{0u}; k < block->mNumScans; ++k)
+        {
+          const auto *scan = block->mData + k * kNumBoards * scanBytes;
+          const auto master = *reinterpret_cast<const i16*>(scan);
+          for(auto i{1u}; i < kNumBoards; ++i)
+          {
+            if(*reinterpret_cast<const i16*>(scan + i * scanBytes) != master)
+            {
+              ++result.mMisalignedScans;
+              break;
+            }
+          }
+          const auto index = block->mFirstScan + k;
+          if(index >= masterScanNs.size() || masterScanNs[index] - startNs < kSettleNs)
+            continue;
+          const auto errorNs = fabs(block->mNs + k * block->mPeriodNs -
+            RtOf(masterScanNs[index]));
+          errorSumNs += errorNs;
+          ++result.mCheckedScans;
+          if(errorNs > result.mMaxErrorNs)
+            result.mMaxErrorNs = errorNs;
+        }
+        result.mScans += block->mNumScans;
+        ring.Release();
+      }
+    }
+    result.mMeanErrorNs = result.mCheckedScans ? errorSumNs / result.mCheckedScans : 0.;
+    result.mDriftPpm = acquisition->Clock().DriftPpm();
+    result.mCounters = acquisition->Counters();
+    acquisition->PrintStats(static_cast<unsigned long long>(seconds * 1e9));
+  }
+  for(auto &bus : buses)
+  {
+    releaseBoard(bus);
+  }
+  return result;
+}
+
+void Print(const char *name, const Result &result)
+{
+  printf("%s: %llu scans, %llu misaligned, timestamp error mean %.0f ns, max %.0f ns over "
+    "%llu scans, drift %.2f ppm\n", name, result.mScans, result.mMisalignedScans,
+    result.mMeanErrorNs, result.mMaxErrorNs, result.mCheckedScans, result.mDriftPpm);
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+  if(argc > 1 && argv[1][0] == '-')
+  {
+    printf("Usage: sync_acquisition_benchmark [seconds] [poll (us)]\n");
+    return -1;
+  }
+  const double seconds = (argc > 1) ? atof(argv[1]) : 3.;
+  const unsigned long long pollNs = ((argc > 2) ? atol(argv[2]) : 250) * 1000ull;
+
+  utils::ElapsedTimes pllTimes, oscillatorTimes;
+  const auto locked = Run("pll", true, seconds, pollNs, pllTimes);
+  Print("pll", locked);
+  const auto minScans = static_cast<unsigned long long>(seconds * 1e9 / kScanPeriodNs) -
+    2 * NiServiceLimit::kBlockBytes / (kAiChannels * sizeof(i16));
+  Check("pll scans", locked.mScans >= minScans);
+  Check("pll boards aligned", locked.mScans > 0 && locked.mMisalignedScans == 0);
+  Check("pll no overflows", locked.mCounters.mOverflows == 0 &&
+    locked.mCounters.mMisaligned == 0);
+  Check("pll timestamps", locked.mCheckedScans > 0 &&
+    locked.mMaxErrorNs <= kMaxTimestampErrorNs);
+  // the rt clock runs fast, so a scan period takes more of its ns
+  Check("pll drift", fabs(locked.mDriftPpm - kRtSkewPpm) <= kMaxDriftErrorPpm);
+
+  const auto free = Run("oscillators", false, seconds, pollNs, oscillatorTimes);
+  Print("oscillators", free);
+  Check("oscillator boards drift apart", free.mMisalignedScans > free.mScans / 10);
+  Check("oscillator timestamps", free.mCheckedScans > 0 &&
+    free.mMaxErrorNs <= kMaxTimestampErrorNs);
+  // the master's scans come kOscillatorPpm fast against the model
+  const auto freeDriftPpm = ((1. + kRtSkewPpm * 1e-6) / (1. + kOscillatorPpm[0] * 1e-6) - 1.) *
+    1e6;
+  Check("oscillator drift", fabs(free.mDriftPpm - freeDriftPpm) <= kMaxDriftErrorPpm);
+
+  pllTimes.PrintHeader("SyncAcquisition, 3 boards of 4 channels at 10 kS/s");
+  pllTimes.Print("Poll() pll");
+  oscillatorTimes.Print("Poll() oscillators");
+
+  printf("\n%d failures\n", failures);
+  return failures ? -1 : 0;
+}
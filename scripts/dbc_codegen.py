@@ -0,0 +1,259 @@
+#!/usr/bin/env python3
+
+# generates a header of constexpr pack/unpack codecs from a dbc file
+#
+# every message becomes a struct of its physical signal values with
+#   kId, kType, kLength
+#   static constexpr uint64_t Pack(const Message&)
+#   static constexpr Message Unpack(uint64_t)
+# scaling, byte order, sign and multiplexing are resolved here, so the generated
+# code is one shift and one mask per signal. see CanCodec.h for the payload layout
+# and the batch helpers.
+#
+# supported: BO_ and SG_ lines, intel (@1) and motorola (@0) signals, signed (-) and
+# unsigned (+), factor/offset, [min|max] clamping, simple multiplexing (M / mN)
+
+import os
+import re
+import sys
+
+MESSAGE_PATTERN = re.compile(r'^BO_\s+(\d+)\s+(\w+)\s*:\s*(\d+)\s+(\w+)')
+SIGNAL_PATTERN = re.compile(
+    r'^SG_\s+(\w+)\s*(M|m\d+)?\s*:\s*(\d+)\|(\d+)@([01])([+-])\s*'
+    r'\(([^,]+),([^)]+)\)\s*\[([^|]+)\|([^\]]+)\]\s*"([^"]*)"')
+
+
+class Signal:
+    def __init__(self, match):
+        self.name = match.group(1)
+        mux = match.group(2)
+        self.isMultiplexor = mux == 'M'
+        self.muxValue = int(mux[1:]) if mux and mux != 'M' else None
+        self.start = int(match.group(3))
+        self.length = int(match.group(4))
+        self.intel = match.group(5) == '1'
+        self.signed = match.group(6) == '-'
+        self.factor = float(match.group(7))
+        self.offset = float(match.group(8))
+        self.minimum = float(match.group(9))
+        self.maximum = float(match.group(10))
+        self.unit = match.group(11)
+
+        if self.factor <= 0:
+            raise ValueError('signal %s: only positive factors are supported' % self.name)
+        if self.length < 1 or self.length > 64:
+            raise ValueError('signal %s: length %d' % (self.name, self.length))
+
+    def Field(self):
+        return 'm' + self.name
+
+    def Type(self):
+        return 'uint32_t' if self.isMultiplexor else 'float'
+
+    def Mask(self):
+        return '0x%xull' % ((1 << self.length) - 1)
+
+    def Position(self):
+        # bit of the lsb within the intel word, or within the byte swapped word
+        if self.intel:
+            position = self.start
+        else:
+            msb = (7 - self.start // 8) * 8 + self.start % 8
+            position = msb - (self.length - 1)
+        if position < 0 or position + self.length > 64:
+            raise ValueError('signal %s does not fit in 8 bytes' % self.name)
+        return position
+
+    def RawRange(self):
+        if self.signed:
+            rawMin, rawMax = -(1 << (self.length - 1)), (1 << (self.length - 1)) - 1
+        else:
+            rawMin, rawMax = 0, (1 << self.length) - 1
+        # a dbc range of [0|0] means unbounded
+        if self.minimum != self.maximum:
+            rawMin = max(rawMin, (self.minimum - self.offset) / self.factor)
+            rawMax = min(rawMax, (self.maximum - self.offset) / self.factor)
+        return round(float(rawMin), 6), round(float(rawMax), 6)
+
+    def Word(self):
+        return 'intel' if self.intel else 'motorola'
+
+
+class Message:
+    def __init__(self, match):
+        frameId = int(match.group(1))
+        self.extended = bool(frameId & 0x80000000)
+        self.id = frameId & 0x1fffffff
+        self.name = match.group(2)
+        self.length = int(match.group(3))
+        self.signals = []
+
+    def Multiplexor(self):
+        for signal in self.signals:
+            if signal.isMultiplexor:
+                return signal
+        return None
+
+
+def Literal(value):
+    return repr(float(value))
+
+
+def Parse(path):
+    messages = []
+    with open(path) as dbc:
+        for line in dbc:
+            line = line.strip()
+            match = MESSAGE_PATTERN.match(line)
+            if match:
+                messages.append(Message(match))
+                continue
+            match = SIGNAL_PATTERN.match(line)
+            if match:
+                if not messages:
+                    raise ValueError('signal outside of a message: ' + line)
+                messages[-1].signals.append(Signal(match))
+    return messages
+
+
+def PackLine(signal):
+    rawMin, rawMax = signal.RawRange()
+    return ('%s |= (static_cast<uint64_t>(CanCodec::Encode(message.%s, %s, %s, %s, %s)) & %s) << %d;'
+        % (signal.Word(), signal.Field(), Literal(signal.offset), Literal(1. / signal.factor),
+           Literal(rawMin), Literal(rawMax), signal.Mask(), signal.Position()))
+
+
+def UnpackLine(signal):
+    raw = '((%s >> %d) & %s)' % ('payload' if signal.intel else 'motorola',
+        signal.Position(), signal.Mask())
+    if signal.signed:
+        raw = 'CanCodec::SignExtend(%s, %d)' % (raw, signal.length)
+    else:
+        raw = 'static_cast<int64_t>%s' % raw
+    # x + 0.0 is not folded away under ieee rules, so identity scaling is left out
+    physical = raw
+    if signal.factor != 1.:
+        physical += ' * ' + Literal(signal.factor)
+    if signal.offset != 0.:
+        physical += ' + ' + Literal(signal.offset)
+    return 'message.%s = static_cast<%s>(%s);' % (signal.Field(), signal.Type(), physical)
+
+
+def Grouped(message):
+    # signals outside the multiplexing first, then one group per mux value
+    plain = [s for s in message.signals if s.muxValue is None]
+    values = sorted(set(s.muxValue for s in message.signals if s.muxValue is not None))
+    groups = [(value, [s for s in message.signals if s.muxValue == value]) for value in values]
+    return plain, groups
+
+
+def EmitMessage(message, out):
+    plain, groups = Grouped(message)
+    multiplexor = message.Multiplexor()
+    if groups and multiplexor is None:
+        raise ValueError('message %s has multiplexed signals but no multiplexor' % message.name)
+    usesIntel = any(s.intel for s in message.signals)
+    usesMotorola = any(not s.intel for s in message.signals)
+
+    out.append('struct %s' % message.name)
+    out.append('{')
+    out.append('  static constexpr uint32_t kId = 0x%x;' % message.id)
+    out.append('  static constexpr uint8_t kType = CanFrameType::%s;'
+        % ('kExtended' if message.extended else 'kStandard'))
+    out.append('  static constexpr uint8_t kLength = %d;' % message.length)
+    out.append('')
+    for signal in message.signals:
+        comment = ' // ' + signal.unit if signal.unit else ''
+        if signal.muxValue is not None:
+            comment = ' // %s = %d%s' % (multiplexor.Field(), signal.muxValue,
+                ', ' + signal.unit if signal.unit else '')
+        out.append('  %s %s;%s' % (signal.Type(), signal.Field(), comment))
+    out.append('')
+
+    out.append('  static constexpr uint64_t Pack(const %s &message)' % message.name)
+    out.append('  {')
+    if usesIntel:
+        out.append('    uint64_t intel{0};')
+    if usesMotorola:
+        out.append('    uint64_t motorola{0};')
+    for signal in plain:
+        out.append('    ' + PackLine(signal))
+    for value, signals in groups:
+        out.append('    if(message.%s == %d)' % (multiplexor.Field(), value))
+        out.append('    {')
+        for signal in signals:
+            out.append('      ' + PackLine(signal))
+        out.append('    }')
+    if usesIntel and usesMotorola:
+        out.append('    return intel | CanCodec::Swap(motorola);')
+    elif usesMotorola:
+        out.append('    return CanCodec::Swap(motorola);')
+    elif usesIntel:
+        out.append('    return intel;')
+    else:
+        out.append('    return 0;')
+    out.append('  }')
+    out.append('')
+
+    out.append('  static constexpr %s Unpack(const uint64_t payload)' % message.name)
+    out.append('  {')
+    if usesMotorola:
+        out.append('    const auto motorola = CanCodec::Swap(payload);')
+    out.append('    %s message{};' % message.name)
+    for signal in plain:
+        out.append('    ' + UnpackLine(signal))
+    for value, signals in groups:
+        out.append('    if(message.%s == %d)' % (multiplexor.Field(), value))
+        out.append('    {')
+        for signal in signals:
+            out.append('      ' + UnpackLine(signal))
+        out.append('    }')
+    out.append('    return message;')
+    out.append('  }')
+    out.append('};')
+    out.append('')
+
+
+def Generate(dbcPath, headerPath, namespace):
+    messages = Parse(dbcPath)
+    guard = '_%s_H_' % os.path.splitext(os.path.basename(headerPath))[0].upper()
+
+    out = []
+    out.append('#ifndef %s' % guard)
+    out.append('#define %s' % guard)
+    out.append('')
+    out.append('// generated by scripts/dbc_codegen.py from %s, do not edit' % os.path.basename(dbcPath))
+    out.append('')
+    out.append('#include <stdint.h>')
+    out.append('')
+    out.append('#include <CanCodec.h>')
+    out.append('#include <CanTypes.h>')
+    out.append('')
+    out.append('namespace %s' % namespace)
+    out.append('{')
+    out.append('')
+    for message in messages:
+        EmitMessage(message, out)
+    out.append('} // namespace %s' % namespace)
+    out.append('')
+    out.append('#endif // %s' % guard)
+
+    with open(headerPath, 'w') as header:
+        header.write('\n'.join(out) + '\n')
+    print('%d messages written to %s' % (len(messages), headerPath))
+
+
+if __name__ == "__main__":
+    if len(sys.argv) < 3:
+        print("Usage: dbc_codegen.py input.dbc output.h [namespace]")
+        sys.exit(-1)
+
+    dbcPath = sys.argv[1]
+    headerPath = sys.argv[2]
+    if len(sys.argv) > 3:
+        namespace = sys.argv[3]
+    else:
+        stem = os.path.splitext(os.path.basename(dbcPath))[0]
+        namespace = ''.join(part.capitalize() for part in stem.split('_')) + 'Dbc'
+
+    Generate(dbcPath, headerPath, namespace)
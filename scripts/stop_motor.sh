@@ -1,13 +1,18 @@
 #!/bin/bash
 
-if [ ! -z `pgrep -x controller` ]; then
-    kill -9 `pgrep -x controller`
-fi
+# sigterm first, so the processes put their outputs in their safe state, and kill -9
+# only what is still running after a second
 
-if [ ! -z `pgrep -x motor_monitor` ]; then
-    kill -9 `pgrep -x motor_monitor`
-fi
+for process in controller motor_monitor motor; do
+    if [ ! -z `pgrep -x $process` ]; then
+        kill -TERM `pgrep -x $process`
+    fi
+done
 
-if [ ! -z `pgrep -x motor` ]; then
-    kill -9 `pgrep -x motor`
-fi
+sleep 1
+
+for process in controller motor_monitor motor; do
+    if [ ! -z `pgrep -x $process` ]; then
+        kill -9 `pgrep -x $process`
+    fi
+done
@@ -1,4 +1,5 @@
 #include <signal.h>
+#include <string.h>
 #include <sys/mman.h>
 
 #include <algorithm>
@@ -11,8 +12,21 @@
 #include <alchemy/queue.h>
 #include <alchemy/task.h>
 
+#include <AoStream.h>
+#include <DynoSensingFilter.h>
+#include <EncoderMeasurement.h>
 #include <MessageTypes.h>
+#include <NiDeviceService.h>
+#include <NiWatchdog.h>
+#include <PositionSensorEmulator.h>
+#include <PwmCapture.h>
+#include <RtAoStreamTask.h>
+#include <RtDynoSensingTask.h>
+#include <RtEncoderMeasurementTask.h>
 #include <RtMacro.h>
+#include <RtPositionSensorTask.h>
+#include <RtPwmCaptureTask.h>
+#include <SafeState.h>
 
 #include "generated_model.h"
 #include "input_interface.h"
@@ -31,11 +45,94 @@ RT_TASK rtMotorStepTask;
 auto numberOfMessages{0u};
 double totalStepTime{0.0};
 
+iBus *pwmCaptureBus = NULL;
+std::unique_ptr<RtPwmCaptureTask> rtPwmCaptureTask;
+std::shared_ptr<AoStream> phaseCurrentStream;
+std::unique_ptr<RtAoStreamTask> rtAoStreamTask;
+
+// one ao update per model step, 100 MHz timebase ticks
+constexpr auto kAoUpdatePeriodTicks = 1000u;
+constexpr auto kAoMinWriteAhead = 32u;
+constexpr auto kAoMaxWriteAhead = 256u;
+
+iBus *positionSensorBus = NULL;
+std::shared_ptr<PositionSensorEmulator> positionSensors;
+std::unique_ptr<RtPositionSensorTask> rtPositionSensorTask;
+
+// resolver on ai0 (excitation), ao0 and ao1 at 200 kS/s; a 1024 line encoder on do lines
+// 0..2 and halls of a 4 pole pair motor on lines 3..5 at 10 MS/s
+constexpr PositionSensorConfig kPositionSensors{500, 10, 300000,
+  {true, 0.5f, 1, 0.f, 0.f},
+  {1024, 0x01, 0x02, 0x04, 0.f, 4, 0x08, 0x10, 0x20, 0.f}};
+
+// the model step pets it; 1 ms without a step drives the encoder and hall lines low, and
+// halls 000 is no valid sector, so the mcu sees a sensor fault and stops switching
+std::unique_ptr<NiWatchdog> watchdog;
+constexpr NiWatchdogConfig kWatchdog{0x3f, nDO::kWDT_SafeValue, 0x00, RtTime::kOneMillisecond};
+SafeState safeState("[motor|safe]");
+
+iBus *dynoSensingBus = NULL;
+std::shared_ptr<DynoSensingFilter> dynoSensing;
+std::unique_ptr<RtDynoSensingTask> rtDynoSensingTask;
+
+// phase current transducers on ai0..2 and the torque flange on ai3 of a simultaneous
+// board at 1 MS/s each; the currents to 100 kS/s for the model step, the torque to 1 kS/s
+constexpr DynoSensingConfig kDynoSensing{4, nNISTC3::kInput_10V, nAI::kDifferential, 100, 4,
+  {{kDynoCurrentU, 10.f, 0.f, {0, 4, 5, 2, 32, 0.25f}},
+   {kDynoCurrentV, 10.f, 0.f, {1, 4, 5, 2, 32, 0.25f}},
+   {kDynoCurrentW, 10.f, 0.f, {2, 4, 5, 2, 32, 0.25f}},
+   {kDynoOutputTorque, 20.f, 0.f, {3, 3, 250, 4, 32, 0.25f}}}};
+
+iBus *dynoEncoderBus = NULL;
+std::shared_ptr<EncoderMeasurement> dynoEncoder;
+std::unique_ptr<RtEncoderMeasurementTask> rtEncoderMeasurementTask;
+
+// a 2048 line encoder on the dyno shaft, a on pfi0 and b on pfi1 filtered against ringing;
+// the speed over the newest 64 edges, none older than 2 ms, and 0 after 50 ms without one
+constexpr EncoderConfig kDynoEncoder{0, nCounter::kGate_PFI0, nCounter::kGate_PFI1,
+  nTriggers::kSmall_Filter, 2048, 64, 2 * RtTime::kOneMillisecond,
+  50 * RtTime::kOneMillisecond, false};
+
+unsigned long long RtNowNs()
+{
+  return rt_timer_read();
+}
+
+iBus *AcquireBoard(const char *bus, const char *device)
+{
+  char boardLocation[256];
+  snprintf(boardLocation, sizeof(boardLocation), "PXI%s::%s::INSTR", bus, device);
+  auto *board = acquireBoard(boardLocation);
+  if (board == NULL)
+    printf("[motor|model] Could not access PCI device %s\n", boardLocation);
+  return board;
+}
+
+void PrintUsage(const char *program)
+{
+  printf("usage: %s [<pxi bus> [--pwm <device> [--ao-scale <volts per amp>]] "
+    "[--position <device>] [--dyno <device>] [--encoder <device>]]\n", program);
+}
+
 void terminationHandler(int signal)
 {
   std::cout << "Motor Exiting ..." << std::endl;
+  safeState.Enter();
   rt_queue_delete(&rtMotorOutputQueue);
   generated_model_terminate();
+  rtEncoderMeasurementTask.reset();
+  rtDynoSensingTask.reset();
+  rtPositionSensorTask.reset();
+  rtAoStreamTask.reset();
+  rtPwmCaptureTask.reset();
+  if(dynoEncoderBus)
+    releaseBoard(dynoEncoderBus);
+  if(dynoSensingBus)
+    releaseBoard(dynoSensingBus);
+  if(positionSensorBus)
+    releaseBoard(positionSensorBus);
+  if(pwmCaptureBus)
+    releaseBoard(pwmCaptureBus);
   exit(1);
 }
 
@@ -132,8 +229,21 @@ void MotorStepRoutine(void*)
   for (;;)
   {
     rtTimerBegin = rt_timer_read();
+    if (watchdog)
+      watchdog->Pet();
     generated_model_step();
     rtTimerEnd = rt_timer_read();
+    if (phaseCurrentStream)
+    {
+      auto output = input_interface::GetMsgMotorOutput();
+      phaseCurrentStream->Push(AoFrame{{output.ft_CurrentU, output.ft_CurrentV,
+        output.ft_CurrentW}});
+    }
+    if (positionSensors)
+    {
+      auto output = input_interface::GetMsgMotorOutput();
+      positionSensors->Publish(output.ft_RotorDegreeRad, output.ft_RotorRPM);
+    }
     ++numberOfMessages;
     totalStepTime += (rtTimerEnd - rtTimerBegin);
 
@@ -143,6 +253,21 @@ void MotorStepRoutine(void*)
       rt_printf("[motor|model] Motor Stepped %d times. avg step time: %.2f nanoseconds\n",
         numberOfMessages, totalStepTime / numberOfMessages);
       #endif // MOTOR_CONTROL_DEBUG
+      if (rtPwmCaptureTask)
+      {
+        auto latency = input_interface::TakeMcuOutputLatency();
+        rt_printf("[motor|model] pwm edge to model input: %llu samples, avg %llu ns, max %llu ns\n",
+          latency.samples, latency.samples ? latency.sumNs / latency.samples : 0, latency.maxNs);
+      }
+      if (rtEncoderMeasurementTask)
+      {
+        auto latency = input_interface::TakeDynoCmdLatency();
+        rt_printf("[motor|model] encoder edge to model input: %llu samples, avg %llu ns, "
+          "max %llu ns\n", latency.samples, latency.samples ? latency.sumNs / latency.samples : 0,
+          latency.maxNs);
+      }
+      if (watchdog)
+        watchdog->PrintStats(rt_timer_read() - rtTimerOneSecond, rt_printf);
       rtTimerOneSecond = rt_timer_read();
     }
 
@@ -157,11 +282,155 @@ int main(int argc, char * argv[])
   sigemptyset(&action.sa_mask);
   action.sa_flags = 0;
   sigaction(SIGINT, &action, NULL);
+  sigaction(SIGTERM, &action, NULL);
 
   mlockall(MCL_CURRENT|MCL_FUTURE);
 
   generated_model_initialize();
 
+  // every ni board is on the one pxi bus and enables its service on its own
+  const char *bus = NULL;
+  const char *pwmDevice = NULL;
+  const char *aoScale = NULL;
+  const char *positionDevice = NULL;
+  const char *dynoDevice = NULL;
+  const char *encoderDevice = NULL;
+  for (auto i{1}; i < argc; ++i)
+  {
+    if (strcmp(argv[i], "--pwm") == 0 && i + 1 < argc)
+      pwmDevice = argv[++i];
+    else if (strcmp(argv[i], "--ao-scale") == 0 && i + 1 < argc)
+      aoScale = argv[++i];
+    else if (strcmp(argv[i], "--position") == 0 && i + 1 < argc)
+      positionDevice = argv[++i];
+    else if (strcmp(argv[i], "--dyno") == 0 && i + 1 < argc)
+      dynoDevice = argv[++i];
+    else if (strcmp(argv[i], "--encoder") == 0 && i + 1 < argc)
+      encoderDevice = argv[++i];
+    else if (bus == NULL && argv[i][0] != '-')
+      bus = argv[i];
+    else
+    {
+      PrintUsage(argv[0]);
+      return -1;
+    }
+  }
+  if ((bus == NULL && (pwmDevice || positionDevice || dynoDevice || encoderDevice)) ||
+    (aoScale && pwmDevice == NULL))
+  {
+    PrintUsage(argv[0]);
+    return -1;
+  }
+
+  // with an ni board the duty cycles of the mcu pwm outputs feed MsgMcuOutput
+  if (pwmDevice)
+  {
+    pwmCaptureBus = AcquireBoard(bus, pwmDevice);
+    if (pwmCaptureBus == NULL)
+      return -1;
+
+    auto capture = std::make_shared<PwmCapture>("[motor|pwm]", pwmCaptureBus, RtNowNs);
+    if (capture->Open())
+      return -1;
+    input_interface::SetMcuOutputSource(&capture->mLatest, RtNowNs);
+    rtPwmCaptureTask = std::make_unique<RtPwmCaptureTask>(capture, "rtPwmCaptureTask",
+      RtTask::kStackSize, RtTask::kHighPriority, RtTask::kMode, RtTime::kTwentyMicroseconds,
+      RtCpu::kCore4);
+    if (rtPwmCaptureTask->StartRoutine())
+      return -1;
+  }
+
+  // and with a scale the phase currents go out on ao0..2 of that board at the model rate
+  if (aoScale)
+  {
+    const float voltsPerAmp = atof(aoScale);
+    AoStreamConfig config{3, nNISTC3::kOutput_10V, kAoUpdatePeriodTicks, kAoMinWriteAhead,
+      kAoMaxWriteAhead, {{voltsPerAmp, 0.f}, {voltsPerAmp, 0.f}, {voltsPerAmp, 0.f}}};
+    phaseCurrentStream = std::make_shared<AoStream>("[motor|ao]", pwmCaptureBus, config);
+    if (phaseCurrentStream->Open())
+      return -1;
+    rtAoStreamTask = std::make_unique<RtAoStreamTask>(phaseCurrentStream, "rtAoStreamTask",
+      RtTask::kStackSize, RtTask::kHighPriority, RtTask::kMode,
+      RtTime::kOneHundredMicroseconds, RtCpu::kCore7);
+    if (rtAoStreamTask->StartRoutine())
+      return -1;
+  }
+
+  // a board emulating the rotor position sensors
+  if (positionDevice)
+  {
+    positionSensorBus = AcquireBoard(bus, positionDevice);
+    if (positionSensorBus == NULL)
+      return -1;
+
+    // first, a safe state left by the last run would keep the board from being programmed
+    watchdog = std::make_unique<NiWatchdog>("[motor|watchdog]", positionSensorBus);
+    if (watchdog->Open())
+      return -1;
+    auto service = std::make_shared<NiDeviceService>("[motor|sensors]", positionSensorBus,
+      RtNowNs);
+    if (service->Open())
+      return -1;
+    positionSensors = std::make_shared<PositionSensorEmulator>("[motor|position]", service,
+      RtNowNs, kPositionSensors);
+    if (positionSensors->Open())
+      return -1;
+    rtPositionSensorTask = std::make_unique<RtPositionSensorTask>(positionSensors,
+      "rtPositionSensorTask", RtTask::kStackSize, RtTask::kHighPriority, RtTask::kMode,
+      RtTime::kOneHundredMicroseconds, RtCpu::kCore6);
+    if (rtPositionSensorTask->StartRoutine())
+      return -1;
+  }
+
+  // a board sampling the dyno sensors into MsgDynoSensing
+  if (dynoDevice)
+  {
+    dynoSensingBus = AcquireBoard(bus, dynoDevice);
+    if (dynoSensingBus == NULL)
+      return -1;
+
+    auto service = std::make_shared<NiDeviceService>("[motor|dyno]", dynoSensingBus, RtNowNs);
+    if (service->Open())
+      return -1;
+    dynoSensing = std::make_shared<DynoSensingFilter>("[motor|dyno]", service, RtNowNs,
+      kDynoSensing);
+    if (dynoSensing->Open())
+      return -1;
+    input_interface::SetDynoSensingSource(&dynoSensing->mLatest);
+    // not beside the 20 us pwm capture on core 4, core 7 only has the 100 us ao stream
+    // and the 10 ms broadcast
+    rtDynoSensingTask = std::make_unique<RtDynoSensingTask>(dynoSensing, "rtDynoSensingTask",
+      RtTask::kStackSize, RtTask::kHighPriority, RtTask::kMode, RtTime::kTwentyMicroseconds,
+      RtCpu::kCore7);
+    if (rtDynoSensingTask->StartRoutine())
+      return -1;
+  }
+
+  // a board measuring the dyno speed from its encoder into MsgDynoCmd
+  if (encoderDevice)
+  {
+    dynoEncoderBus = AcquireBoard(bus, encoderDevice);
+    if (dynoEncoderBus == NULL)
+      return -1;
+
+    auto service = std::make_shared<NiDeviceService>("[motor|encoder]", dynoEncoderBus,
+      RtNowNs);
+    if (service->Open())
+      return -1;
+    dynoEncoder = std::make_shared<EncoderMeasurement>("[motor|encoder]", service, RtNowNs,
+      kDynoEncoder);
+    if (dynoEncoder->Open())
+      return -1;
+    input_interface::SetDynoCmdSource(&dynoEncoder->mLatest, RtNowNs);
+    // a poll reads about 25 registers, too many for 20 us; beside the 100 us position
+    // sensors and the queue driven input, as the speed averages over milliseconds anyway
+    rtEncoderMeasurementTask = std::make_unique<RtEncoderMeasurementTask>(dynoEncoder,
+      "rtEncoderMeasurementTask", RtTask::kStackSize, RtTask::kHighPriority, RtTask::kMode,
+      RtTime::kOneHundredMicroseconds, RtCpu::kCore6);
+    if (rtEncoderMeasurementTask->StartRoutine())
+      return -1;
+  }
+
   cpu_set_t cpuSet;
 
   // motor step task
@@ -173,6 +442,8 @@ int main(int argc, char * argv[])
   rt_task_set_affinity(&rtMotorStepTask, &cpuSet);
 
   rt_task_set_periodic(&rtMotorStepTask, TM_NOW, rt_timer_ns2ticks(RtTime::kTenMicroseconds));
+  if (watchdog && (watchdog->Arm(kWatchdog) || watchdog->RegisterSafeState(safeState)))
+    return -1;
   rt_task_start(&rtMotorStepTask, MotorStepRoutine, NULL);
 
   // receive motor input task
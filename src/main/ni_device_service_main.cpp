@@ -0,0 +1,182 @@
+#include <math.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <chrono>
+#include <memory>
+#include <thread>
+
+#include <NiDeviceService.h>
+#include <RtMacro.h>
+#include <RtNiDeviceTask.h>
+
+/*
+ * one process for ai, ao, correlated di and do and the four counters of an ni board
+ *
+ * an rt task serves all dma channels each period. this thread is the consumer and the
+ * producer at the other end of the rings: it drains ai, di and the counters, and keeps
+ * ao fed with a sine on every channel and do with a counting pattern. the task prints
+ * the throughput and the overflow and underrun counts of every channel once a second.
+ */
+
+iBus *niDeviceBus = NULL;
+std::unique_ptr<RtNiDeviceTask> rtNiDeviceTask;
+
+constexpr auto kTimebaseHz = 100000000u;
+constexpr auto kDiLines = 0x0fu; // port 0 lines 0..3 in, 4..7 out
+constexpr auto kDoLines = 0xf0u;
+// eeprom calibration of the boards of this machine, read in full only after a new calibration
+constexpr auto kCalibrationCache = "/var/tmp/ni_calibration.bin";
+
+unsigned long long RtNowNs()
+{
+  return rt_timer_read();
+}
+
+void TerminationHandler(int s)
+{
+  printf("Caught ctrl + c signal. Closing and Exiting.\n");
+  rtNiDeviceTask.reset();
+  if(niDeviceBus)
+    releaseBoard(niDeviceBus);
+  exit(1);
+}
+
+// queues whole blocks of a sine on every ao channel while the ring has room
+static void FillAo(NiDeviceService &service, double &phase, const double step)
+{
+  auto &ring = service.Ring(nNISTC3::kAO_DMAChannel);
+  const auto frameBytes = service.FrameBytes(nNISTC3::kAO_DMAChannel);
+  const auto numChannels = frameBytes / sizeof(i16);
+  NiStreamBlock *block;
+  while((block = ring.Reserve()) != NULL)
+  {
+    auto *codes = reinterpret_cast<i16*>(block->mData);
+    const auto numFrames = NiServiceLimit::kBlockBytes / frameBytes;
+    for(auto i{0u}; i < numFrames; ++i)
+    {
+      const auto code = static_cast<i16>(16000. * sin(phase));
+      for(auto j{0u}; j < numChannels; ++j)
+      {
+        codes[i * numChannels + j] = code;
+      }
+      phase += step;
+    }
+    if(phase > 2. * M_PI)
+      phase = fmod(phase, 2. * M_PI);
+    block->mBytes = numFrames * frameBytes;
+    ring.Commit();
+  }
+}
+
+static void FillDo(NiDeviceService &service, uint32_t &pattern)
+{
+  auto &ring = service.Ring(nNISTC3::kDO_DMAChannel);
+  const auto frameBytes = service.FrameBytes(nNISTC3::kDO_DMAChannel);
+  NiStreamBlock *block;
+  while((block = ring.Reserve()) != NULL)
+  {
+    const auto numFrames = NiServiceLimit::kBlockBytes / frameBytes;
+    for(auto i{0u}; i < numFrames; ++i, ++pattern)
+    {
+      const uint32_t value = (pattern << 4) & kDoLines;
+      memcpy(block->mData + i * frameBytes, &value, frameBytes);
+    }
+    block->mBytes = numFrames * frameBytes;
+    ring.Commit();
+  }
+}
+
+static void Drain(NiDeviceService &service, const nNISTC3::tDMAChannelNumber dmaChannel)
+{
+  auto &ring = service.Ring(dmaChannel);
+  while(ring.Peek() != NULL)
+  {
+    ring.Release();
+  }
+}
+
+int main(int argc, char **argv)
+{
+  if(argc < 3)
+  {
+    printf("Usage: ni_device_service [bus number] [device number] [ai channels] "
+      "[ai scan rate (Hz)] [ao update rate (Hz)] [dio rate (Hz)] [task period (us)]\n"
+      "  defaults: 4 channels, 10000 scans/s, 10000 updates/s, 100000 samples/s, 250 us,\n"
+      "  counters 0..3 measure semi-periods on PFI0..3, di on lines 0..3, do on 4..7\n");
+    return -1;
+  }
+  const unsigned int aiChannels = (argc > 3) ? atol(argv[3]) : 4;
+  const unsigned int aiHz = (argc > 4) ? atol(argv[4]) : 10000;
+  const unsigned int aoHz = (argc > 5) ? atol(argv[5]) : 10000;
+  const unsigned int dioHz = (argc > 6) ? atol(argv[6]) : 100000;
+  const unsigned long long periodNs = ((argc > 7) ? atol(argv[7]) : 250) *
+    RtTime::kOneMicrosecond;
+  if(aiHz == 0 || aoHz == 0 || dioHz == 0)
+  {
+    printf("ni_device_service: rates must not be zero\n");
+    return -1;
+  }
+
+  // ctrl + c signal handler
+  struct sigaction signalHandler;
+  signalHandler.sa_handler = TerminationHandler;
+  sigemptyset(&signalHandler.sa_mask);
+  signalHandler.sa_flags = 0;
+  sigaction(SIGINT, &signalHandler, NULL);
+
+  char boardLocation[256];
+  snprintf(boardLocation, sizeof(boardLocation), "PXI%s::%s::INSTR", argv[1], argv[2]);
+  niDeviceBus = acquireBoard(boardLocation);
+  if(niDeviceBus == NULL)
+  {
+    printf("ni_device_service: Could not access PCI device %s\n", boardLocation);
+    return -1;
+  }
+
+  auto service = std::make_shared<NiDeviceService>("ni_device_service", niDeviceBus, RtNowNs);
+  if(service->Open(kCalibrationCache))
+    return -1;
+  if(service->EnableAi(NiAiConfig{aiChannels, nNISTC3::kInput_10V, nAI::kRSE, kTimebaseHz / aiHz}) ||
+    service->EnableAo(NiAoConfig{2, nNISTC3::kOutput_10V, kTimebaseHz / aoHz}) ||
+    service->EnableDi(NiDioConfig{kDiLines, kTimebaseHz / dioHz}) ||
+    service->EnableDo(NiDioConfig{kDoLines, kTimebaseHz / dioHz}))
+    return -1;
+  const nCounter::tGi_Gate_Select_t gates[] = {nCounter::kGate_PFI0, nCounter::kGate_PFI1,
+    nCounter::kGate_PFI2, nCounter::kGate_PFI3};
+  for(auto i{0u}; i < NiServiceLimit::kNumCounters; ++i)
+  {
+    if(service->EnableCounter(i, gates[i]))
+      return -1;
+  }
+
+  // the outputs start from what is queued, one sine per second
+  auto phase{0.};
+  const auto step = 2. * M_PI / aoHz;
+  uint32_t pattern{0};
+  FillAo(*service, phase, step);
+  FillDo(*service, pattern);
+
+  rtNiDeviceTask = std::make_unique<RtNiDeviceTask>(service, "RtNiDeviceTask",
+    RtTask::kStackSize, RtTask::kHighPriority, RtTask::kMode, periodNs, RtCpu::kCore5);
+  if(rtNiDeviceTask->StartRoutine())
+    return -1;
+
+  const nNISTC3::tDMAChannelNumber inputs[] = {nNISTC3::kAI_DMAChannel,
+    nNISTC3::kCounter0DmaChannel, nNISTC3::kCounter1DmaChannel, nNISTC3::kCounter2DmaChannel,
+    nNISTC3::kCounter3DmaChannel, nNISTC3::kDI_DMAChannel};
+  while(true)
+  {
+    for(auto input : inputs)
+    {
+      Drain(*service, input);
+    }
+    FillAo(*service, phase, step);
+    FillDo(*service, pattern);
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+
+  return 0;
+}
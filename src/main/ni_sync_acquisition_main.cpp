@@ -0,0 +1,134 @@
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <chrono>
+#include <memory>
+#include <thread>
+
+#include <NiDeviceService.h>
+#include <RtMacro.h>
+#include <RtSyncAcquisitionTask.h>
+#include <SyncAcquisition.h>
+
+/*
+ * ai of several ni boards scanning as one, every scan stamped on the rt clock
+ *
+ * the first device is the master: it exports its start trigger and, on pcie, its
+ * reference clock over rtsi, and every board locks its timebase with the pll. an rt task
+ * polls all boards and merges their scans; this thread drains the merged blocks and
+ * checks that no scan goes missing. the task prints the rates, the skew between the
+ * boards and the drift of their timebase against the rt clock once a second.
+ */
+
+iBus *niDeviceBuses[SyncAcquisitionLimit::kMaxDevices] = {};
+std::unique_ptr<RtSyncAcquisitionTask> rtSyncAcquisitionTask;
+
+constexpr auto kTimebaseHz = 100000000u;
+// eeprom calibration of the boards of this machine, read in full only after a new calibration
+constexpr auto kCalibrationCache = "/var/tmp/ni_calibration.bin";
+
+unsigned long long RtNowNs()
+{
+  return rt_timer_read();
+}
+
+void TerminationHandler(int s)
+{
+  printf("Caught ctrl + c signal. Closing and Exiting.\n");
+  rtSyncAcquisitionTask.reset();
+  for(auto *bus : niDeviceBuses)
+  {
+    if(bus)
+      releaseBoard(bus);
+  }
+  exit(1);
+}
+
+int main(int argc, char **argv)
+{
+  if(argc < 3)
+  {
+    printf("Usage: ni_sync_acquisition [bus number] [device numbers, master first, as 3,4] "
+      "[ai channels] [ai scan rate (Hz)] [task period (us)] [pll (1 or 0)]\n"
+      "  defaults: 4 channels, 10000 scans/s, 250 us, pll on\n");
+    return -1;
+  }
+  const unsigned int aiChannels = (argc > 3) ? atol(argv[3]) : 4;
+  const unsigned int aiHz = (argc > 4) ? atol(argv[4]) : 10000;
+  const unsigned long long periodNs = ((argc > 5) ? atol(argv[5]) : 250) *
+    RtTime::kOneMicrosecond;
+  const bool lockPll = (argc > 6) ? atol(argv[6]) != 0 : true;
+  if(aiHz == 0)
+  {
+    printf("ni_sync_acquisition: the scan rate must not be zero\n");
+    return -1;
+  }
+
+  // ctrl + c signal handler
+  struct sigaction signalHandler;
+  signalHandler.sa_handler = TerminationHandler;
+  sigemptyset(&signalHandler.sa_mask);
+  signalHandler.sa_flags = 0;
+  sigaction(SIGINT, &signalHandler, NULL);
+
+  auto acquisition = std::make_shared<SyncAcquisition>("ni_sync_acquisition", RtNowNs);
+  static char names[SyncAcquisitionLimit::kMaxDevices][32];
+  auto numDevices{0u};
+  char *save = NULL;
+  for(auto *device = strtok_r(argv[2], ",", &save); device != NULL;
+    device = strtok_r(NULL, ",", &save))
+  {
+    if(numDevices == SyncAcquisitionLimit::kMaxDevices)
+    {
+      printf("ni_sync_acquisition: %u devices at most\n", SyncAcquisitionLimit::kMaxDevices);
+      return -1;
+    }
+    char boardLocation[256];
+    snprintf(boardLocation, sizeof(boardLocation), "PXI%s::%s::INSTR", argv[1], device);
+    niDeviceBuses[numDevices] = acquireBoard(boardLocation);
+    if(niDeviceBuses[numDevices] == NULL)
+    {
+      printf("ni_sync_acquisition: Could not access PCI device %s\n", boardLocation);
+      return -1;
+    }
+    snprintf(names[numDevices], sizeof(names[numDevices]), "%s %s",
+      numDevices ? "slave" : "master", device);
+    auto service = std::make_shared<NiDeviceService>(names[numDevices],
+      niDeviceBuses[numDevices], RtNowNs);
+    if(service->Open(kCalibrationCache) || acquisition->AddDevice(service))
+      return -1;
+    ++numDevices;
+  }
+  if(acquisition->Open(NiAiConfig{aiChannels, nNISTC3::kInput_10V, nAI::kRSE,
+    kTimebaseHz / aiHz}, lockPll))
+    return -1;
+
+  rtSyncAcquisitionTask = std::make_unique<RtSyncAcquisitionTask>(acquisition,
+    "RtSyncAcquisitionTask", RtTask::kStackSize, RtTask::kHighPriority, RtTask::kMode,
+    periodNs, RtCpu::kCore5);
+  if(rtSyncAcquisitionTask->StartRoutine())
+    return -1;
+
+  auto &ring = *acquisition->mRing;
+  unsigned long long nextScan{0}, missing{0};
+  while(true)
+  {
+    SyncBlock *block;
+    while((block = ring.Peek()) != NULL)
+    {
+      if(block->mFirstScan != nextScan)
+      {
+        missing += block->mFirstScan - nextScan;
+        printf("ni_sync_acquisition: %llu scans missing before %.6f s, %llu in all\n",
+          block->mFirstScan - nextScan, block->mNs * 1e-9, missing);
+      }
+      nextScan = block->mFirstScan + block->mNumScans;
+      ring.Release();
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+
+  return 0;
+}
@@ -1,12 +1,16 @@
 #include <memory>
 
-#include <PxiCardTask.h>
+#include <PilpxiBackend.h>
+#include <PxiCardManager.h>
 
 int main(int argc, char **argv)
 {
-  auto pxiCardTask = std::make_shared<PxiCardTask>();
+  auto pxiCardManager = std::make_unique<PxiCardManager>(std::make_shared<PilpxiBackend>());
 
-  pxiCardTask->ListAllCards();
+  pxiCardManager->FindFreeCards();
+  pxiCardManager->OpenAllCards();
+  pxiCardManager->ListAllCards();
+  pxiCardManager->CloseAllCards();
 
   return 0;
 }
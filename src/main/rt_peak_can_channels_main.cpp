@@ -0,0 +1,352 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <deque>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <CanDevice.h>
+#include <CanGateway.h>
+#include <CanReceiveEngine.h>
+#include <CanTransmitSchedule.h>
+#include <PeakCanTask.h>
+#include <RtCanDispatchTask.h>
+#include <RtMacro.h>
+#include <RtPeakCanReceiveTask.h>
+#include <RtPeakCanTransmitTask.h>
+#include <SafeState.h>
+
+/*
+ * several peak can channels in one process
+ *
+ * every channel gets a receive task and, when it has a schedule, a transmit task,
+ * each on the core given in the config. gateway rules forward frames between the
+ * channels from the receive tasks, one dispatch task runs the decoders of all of them.
+ */
+
+struct LatestFrame
+{
+  CanFrame mFrame;
+  unsigned long long mCount;
+};
+
+static void StoreLatestFrame(void *context, const CanFrame &frame)
+{
+  auto *latest = static_cast<LatestFrame*>(context);
+  latest->mFrame = frame;
+  ++latest->mCount;
+}
+
+static unsigned long long RtNowNs()
+{
+  return rt_timer_read();
+}
+
+struct ChannelSetup
+{
+  std::string mName;
+  std::string mDeviceName;
+  std::string mRxName;
+  std::string mTxName;
+  std::string mSchedulePath;
+  unsigned int mBaudRate;
+  unsigned int mDataBaudRate;
+  int mRxCore;
+  int mTxCore;
+
+  std::shared_ptr<CanDevice> mChannel;
+  std::shared_ptr<CanReceiveEngine> mEngine;
+  std::shared_ptr<CanTransmitSchedule> mSchedule;
+  std::vector<CanFrame> mSafeFrames;
+  std::unique_ptr<RtPeakCanReceiveTask> mRxTask;
+  std::unique_ptr<RtPeakCanTransmitTask> mTxTask;
+};
+
+std::vector<std::unique_ptr<ChannelSetup>> channels;
+std::unique_ptr<RtCanDispatchTask> rtCanDispatchTask;
+SafeState safeState("peak_can_channels");
+
+void TerminationHandler(int s)
+{
+  printf("Caught ctrl + c signal. Closing and Exiting.\n");
+  safeState.Enter();
+  rtCanDispatchTask.reset();
+  channels.clear();
+  exit(1);
+}
+
+static int FindChannel(const char *name)
+{
+  for(auto i{0u}; i < channels.size(); ++i)
+  {
+    if(channels[i]->mName == name)
+      return i;
+  }
+  printf("peak_can_channels: unknown channel %s\n", name);
+  return -1;
+}
+
+static void ToIdAndType(const long id, uint32_t &canId, uint8_t &type)
+{
+  canId = id & CanLimit::kMaxExtendedId;
+  type = (id & 0x80000000l) ? CanFrameType::kExtended : CanFrameType::kStandard;
+}
+
+/*
+ * one statement per line, # starts a comment, ids take 0x80000000 for extended
+ *   channel <name> <device> <baud rate (Kbits/s)> <rx core> <tx core> [schedule file]
+ *   fd <channel> <data baud rate (Kbits/s)>
+ *   receive <channel> <id>
+ *   route <from channel> <id> <to channel> [out id]
+ *   safe <channel> <id> <length> [data byte ...]
+ * channels must be declared before they are used, the device is a /dev/pcan* node or
+ * a socketcan interface such as can0 or vcan0. fd opens the channel in can fd mode,
+ * a socketcan interface must have been set up with the same bit timing (ip link ... fd on).
+ * safe frames go out once, in order, when the process stops; only a channel with a
+ * schedule has a transmit task to send them
+ */
+static int LoadConfig(const char *path, std::deque<LatestFrame> &latestFrames,
+  CanGateway &gateway)
+{
+  auto *file = fopen(path, "r");
+  if(!file)
+  {
+    printf("peak_can_channels: could not open config %s\n", path);
+    return -1;
+  }
+
+  char line[512];
+  auto lineNum{0u};
+  auto result{0};
+  while(result == 0 && fgets(line, sizeof(line), file))
+  {
+    ++lineNum;
+    auto *comment = strchr(line, '#');
+    if(comment)
+      *comment = '\0';
+
+    char keyword[16], first[128], second[128], third[128];
+    long id, outId;
+    int rxCore, txCore;
+    unsigned int baudRate;
+    auto numFields = sscanf(line, "%15s", keyword);
+    if(numFields < 1)
+      continue; // blank line
+
+    if(strcmp(keyword, "channel") == 0)
+    {
+      third[0] = '\0';
+      numFields = sscanf(line, "%*s %127s %127s %u %d %d %127s", first, second, &baudRate,
+        &rxCore, &txCore, third);
+      if(numFields < 5 || channels.size() == CanRoute::kMaxChannels)
+      {
+        printf("peak_can_channels: %s:%d: expected name, device, baud rate, rx core and "
+          "tx core, at most %d channels\n", path, lineNum, CanRoute::kMaxChannels);
+        result = -1;
+        continue;
+      }
+
+      auto setup = std::make_unique<ChannelSetup>();
+      setup->mName = first;
+      setup->mDeviceName = second;
+      setup->mRxName = std::string("RtCanRx_") + first;
+      setup->mTxName = std::string("RtCanTx_") + first;
+      setup->mSchedulePath = third;
+      setup->mBaudRate = baudRate;
+      setup->mDataBaudRate = 0;
+      setup->mRxCore = rxCore;
+      setup->mTxCore = txCore;
+      setup->mEngine = std::make_shared<CanReceiveEngine>();
+      channels.push_back(std::move(setup));
+    }
+    else if(strcmp(keyword, "fd") == 0)
+    {
+      numFields = sscanf(line, "%*s %127s %u", first, &baudRate);
+      auto channel = (numFields == 2) ? FindChannel(first) : -1;
+      if(channel < 0 || baudRate < channels[channel]->mBaudRate)
+      {
+        printf("peak_can_channels: %s:%d: expected channel and a data baud rate of at least "
+          "its baud rate\n", path, lineNum);
+        result = -1;
+        continue;
+      }
+      channels[channel]->mDataBaudRate = baudRate;
+    }
+    else if(strcmp(keyword, "receive") == 0)
+    {
+      numFields = sscanf(line, "%*s %127s %li", first, &id);
+      auto channel = (numFields == 2) ? FindChannel(first) : -1;
+      if(channel < 0)
+      {
+        printf("peak_can_channels: %s:%d: expected channel and id\n", path, lineNum);
+        result = -1;
+        continue;
+      }
+
+      uint32_t canId;
+      uint8_t type;
+      ToIdAndType(id, canId, type);
+      latestFrames.emplace_back();
+      if(channels[channel]->mEngine->Register(canId, type, StoreLatestFrame,
+        &latestFrames.back()) < 0)
+        result = -1;
+    }
+    else if(strcmp(keyword, "route") == 0)
+    {
+      numFields = sscanf(line, "%*s %127s %li %127s %li", first, &id, second, &outId);
+      auto source = (numFields >= 3) ? FindChannel(first) : -1;
+      auto destination = (numFields >= 3) ? FindChannel(second) : -1;
+      if(source < 0 || destination < 0)
+      {
+        printf("peak_can_channels: %s:%d: expected channel, id, channel and an optional "
+          "out id\n", path, lineNum);
+        result = -1;
+        continue;
+      }
+
+      CanGatewayRule rule{};
+      rule.mSource = source;
+      rule.mDestination = destination;
+      ToIdAndType(id, rule.mId, rule.mType);
+      rule.mOutId = CanRoute::kKeepId;
+      if(numFields == 4)
+        ToIdAndType(outId, rule.mOutId, rule.mOutType);
+      if(gateway.AddRule(rule) < 0)
+        result = -1;
+    }
+    else if(strcmp(keyword, "safe") == 0)
+    {
+      unsigned int length;
+      int dataBegin{0};
+      numFields = sscanf(line, "%*s %127s %li %u%n", first, &id, &length, &dataBegin);
+      auto channel = (numFields == 3) ? FindChannel(first) : -1;
+      if(channel < 0 || length > CanLimit::kMaxDataLength ||
+        channels[channel]->mSchedulePath.empty())
+      {
+        printf("peak_can_channels: %s:%d: expected a channel with a schedule, id, length "
+          "of at most %d and data bytes\n", path, lineNum, CanLimit::kMaxDataLength);
+        result = -1;
+        continue;
+      }
+
+      CanFrame frame{};
+      ToIdAndType(id, frame.mId, frame.mType);
+      frame.mLen = length;
+      char *cursor = line + dataBegin;
+      for(auto i{0u}; i < length; ++i)
+      {
+        frame.mData[i] = strtoul(cursor, &cursor, 0);
+      }
+      channels[channel]->mSafeFrames.push_back(frame);
+    }
+    else
+    {
+      printf("peak_can_channels: %s:%d: unknown statement %s\n", path, lineNum, keyword);
+      result = -1;
+    }
+  }
+
+  fclose(file);
+  return result;
+}
+
+int main(int argc, char **argv)
+{
+  if(argc < 2)
+  {
+    printf("Usage: peak_can_channels [config file]\n"
+      "  see LoadConfig() for the config format\n");
+    return -1;
+  }
+
+  // ctrl + c signal handler
+  struct sigaction signalHandler;
+  signalHandler.sa_handler = TerminationHandler;
+  sigemptyset(&signalHandler.sa_mask);
+  signalHandler.sa_flags = 0;
+  sigaction(SIGINT, &signalHandler, NULL);
+  sigaction(SIGTERM, &signalHandler, NULL);
+
+  std::deque<LatestFrame> latestFrames;
+  auto gateway = std::make_shared<CanGateway>(RtNowNs);
+  if(LoadConfig(argv[1], latestFrames, *gateway))
+    return -1;
+  if(channels.empty())
+  {
+    printf("peak_can_channels: no channel in %s\n", argv[1]);
+    return -1;
+  }
+
+  // the base tick of every schedule is the period of its transmit task
+  const auto tick = RtTime::kOneMillisecond;
+  for(auto i{0u}; i < channels.size(); ++i)
+  {
+    auto &setup = *channels[i];
+    setup.mChannel = PeakCanTask::MakeDevice(setup.mName.c_str(),
+      setup.mDeviceName.c_str(), setup.mBaudRate, setup.mDataBaudRate);
+    if(setup.mChannel->Open() || setup.mEngine->Build())
+      return -1;
+    gateway->SetWriter(i, CanDevice::Write, setup.mChannel.get());
+
+    if(!setup.mSchedulePath.empty())
+    {
+      setup.mSchedule = std::make_shared<CanTransmitSchedule>();
+      if(setup.mSchedule->Load(setup.mSchedulePath.c_str()) ||
+        setup.mSchedule->Build(tick / RtTime::kNanosecondsToMicroseconds))
+        return -1;
+    }
+  }
+  if(gateway->Build())
+    return -1;
+
+  rtCanDispatchTask = std::make_unique<RtCanDispatchTask>(
+    "RtCanDispatchTask", RtTask::kStackSize, RtTask::kMediumPriority, RtTask::kMode,
+    RtTime::kOneMillisecond, RtCpu::kCore7);
+
+  for(auto i{0u}; i < channels.size(); ++i)
+  {
+    auto &setup = *channels[i];
+    setup.mRxTask = std::make_unique<RtPeakCanReceiveTask>(
+      setup.mChannel, setup.mRxName.c_str(), RtTask::kStackSize, RtTask::kHighPriority,
+      RtTask::kMode, RtTime::kTenMilliseconds, setup.mRxCore);
+    setup.mRxTask->mEngine = setup.mEngine;
+    setup.mRxTask->mGateway = gateway;
+    setup.mRxTask->mChannelIndex = i;
+    rtCanDispatchTask->mEngines.push_back(setup.mEngine);
+
+    if(setup.mSchedule)
+    {
+      setup.mTxTask = std::make_unique<RtPeakCanTransmitTask>(
+        setup.mChannel, setup.mTxName.c_str(), RtTask::kStackSize, RtTask::kHighPriority,
+        RtTask::kMode, tick, setup.mTxCore);
+      setup.mTxTask->mSchedule = setup.mSchedule;
+      setup.mTxTask->mSafeFrames = setup.mSafeFrames;
+      if(setup.mTxTask->RegisterSafeState(safeState))
+        return -1;
+    }
+  }
+  // the gateway writes to the channels from the receive tasks, they stop before any
+  // transmit task sends its safe frames
+  for(auto &setup : channels)
+  {
+    if(setup->mRxTask->RegisterSafeState(safeState))
+      return -1;
+  }
+
+  for(auto &setup : channels)
+  {
+    if(setup->mRxTask->StartRoutine())
+      return -1;
+    if(setup->mTxTask && setup->mTxTask->StartRoutine())
+      return -1;
+  }
+  if(rtCanDispatchTask->StartRoutine())
+    return -1;
+
+  while(true)
+  {}
+
+  return 0;
+}
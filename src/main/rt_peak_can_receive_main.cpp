@@ -1,13 +1,34 @@
 #include <memory>
+#include <vector>
 
+#include <CanReceiveEngine.h>
+#include <RtCanDispatchTask.h>
 #include <RtMacro.h>
 #include <RtPeakCanReceiveTask.h>
 
+/*
+ * latest frame of every registered id, as a model would consume them
+ */
+struct LatestFrame
+{
+  CanFrame mFrame;
+  unsigned long long mCount;
+};
+
+static void StoreLatestFrame(void *context, const CanFrame &frame)
+{
+  auto *latest = static_cast<LatestFrame*>(context);
+  latest->mFrame = frame;
+  ++latest->mCount;
+}
+
 std::unique_ptr<RtPeakCanReceiveTask> rtPeakCanReceiveTask;
+std::unique_ptr<RtCanDispatchTask> rtCanDispatchTask;
 
 void TerminationHandler(int s)
 {
   printf("Caught ctrl + c signal. Closing and Exiting.\n");
+  rtCanDispatchTask.reset();
   rtPeakCanReceiveTask.reset();
   exit(1);
 }
@@ -16,12 +37,22 @@ int main(int argc, char **argv)
 {
   if(argc < 3)
   {
-    printf("Usage: peak_can_receive [device name] [baud rate (Kbits/s)]\n");
+    printf("Usage: peak_can_receive [device name] [baud rate (Kbits/s)] [ids...]\n"
+      "  ids default to 0x123, add 0x80000000 for an extended id\n"
+      "  the device is a /dev/pcan* node or a socketcan interface such as vcan0\n");
     return -1;
   }
   const char *deviceName = argv[1];
   const unsigned int baudRate = atol(argv[2]);
 
+  std::vector<unsigned long> ids;
+  for(auto i{3}; i < argc; ++i)
+  {
+    ids.push_back(strtoul(argv[i], NULL, 0));
+  }
+  if(ids.empty())
+    ids.push_back(0x123);
+
   // ctrl + c signal handler
   struct sigaction signalHandler;
   signalHandler.sa_handler = TerminationHandler;
@@ -29,12 +60,31 @@ int main(int argc, char **argv)
   signalHandler.sa_flags = 0;
   sigaction(SIGINT, &signalHandler, NULL);
 
-  auto rtPeakCanReceiveTask = std::make_unique<RtPeakCanReceiveTask>(
+  auto engine = std::make_shared<CanReceiveEngine>();
+  std::unique_ptr<LatestFrame[]> latestFrames(new LatestFrame[ids.size()]());
+  for(auto i{0u}; i < ids.size(); ++i)
+  {
+    auto type = (ids[i] & 0x80000000ul) ? CanFrameType::kExtended : CanFrameType::kStandard;
+    if(engine->Register(ids[i] & CanLimit::kMaxExtendedId, type, StoreLatestFrame,
+      &latestFrames[i]) < 0)
+      return -1;
+  }
+  if(engine->Build())
+    return -1;
+
+  rtPeakCanReceiveTask = std::make_unique<RtPeakCanReceiveTask>(
     deviceName, baudRate, "RtPeakCanReceiveTask", RtTask::kStackSize,
-    RtTask::kMediumPriority, RtTask::kMode, RtTime::kTenMilliseconds,
+    RtTask::kHighPriority, RtTask::kMode, RtTime::kTenMilliseconds,
     RtCpu::kCore6);
+  rtPeakCanReceiveTask->mEngine = engine;
+
+  rtCanDispatchTask = std::make_unique<RtCanDispatchTask>(
+    "RtCanDispatchTask", RtTask::kStackSize, RtTask::kMediumPriority, RtTask::kMode,
+    RtTime::kOneMillisecond, RtCpu::kCore7);
+  rtCanDispatchTask->mEngines.push_back(engine);
 
-  rtPeakCanReceiveTask->StartRoutine();
+  if(rtPeakCanReceiveTask->StartRoutine() || rtCanDispatchTask->StartRoutine())
+    return -1;
 
   while(true)
   {}
@@ -1,13 +1,23 @@
 #include <memory>
 
+#include <CanTransmitSchedule.h>
 #include <RtMacro.h>
 #include <RtPeakCanTransmitTask.h>
+#include <SafeState.h>
 
 std::unique_ptr<RtPeakCanTransmitTask> rtPeakCanTransmitTask;
+SafeState safeState("peak_can_transmit");
+
+// rolling counter in the first byte, so a receiver can spot lost frames
+static void AliveCounter(void *context, CanFrame &frame)
+{
+  ++frame.mData[0];
+}
 
 void TerminationHandler(int s)
 {
   printf("Caught ctrl + c signal. Closing and Exiting.\n");
+  safeState.Enter();
   rtPeakCanTransmitTask.reset();
   exit(1);
 }
@@ -16,7 +26,10 @@ int main(int argc, char **argv)
 {
   if(argc < 3)
   {
-    printf("Usage: peak_can_transmit [device name] [baud rate (Kbits/s)]\n");
+    printf("Usage: peak_can_transmit [device name] [baud rate (Kbits/s)] [schedule file]\n"
+      "  see CanTransmitSchedule::Load() for the schedule format, without one 0x123 is\n"
+      "  sent every 10 ms\n"
+      "  the device is a /dev/pcan* node or a socketcan interface such as vcan0\n");
     return -1;
   }
   const char *deviceName = argv[1];
@@ -28,13 +41,38 @@ int main(int argc, char **argv)
   sigemptyset(&signalHandler.sa_mask);
   signalHandler.sa_flags = 0;
   sigaction(SIGINT, &signalHandler, NULL);
+  sigaction(SIGTERM, &signalHandler, NULL);
 
-  auto rtPeakCanTransmitTask = std::make_unique<RtPeakCanTransmitTask>(
+  auto schedule = std::make_shared<CanTransmitSchedule>();
+  if(argc > 3)
+  {
+    if(schedule->Load(argv[3]))
+      return -1;
+  }
+  else
+  {
+    CanScheduleEntry entry{};
+    entry.mFrame = CanFrame{0x123, CanFrameType::kStandard, 3, {0x1f, 0x2a, 0x3e}};
+    entry.mPeriodUs = 10000;
+    entry.mOffsetUs = CanSchedule::kAutoOffset;
+    entry.mSource = AliveCounter;
+    schedule->Add(entry);
+  }
+
+  // the base tick is the period of the task
+  const auto tick = RtTime::kOneMillisecond;
+  if(schedule->Build(tick / RtTime::kNanosecondsToMicroseconds))
+    return -1;
+
+  rtPeakCanTransmitTask = std::make_unique<RtPeakCanTransmitTask>(
       deviceName, baudRate, "RtPeakCanTransmitTask",
-      RtTask::kStackSize, RtTask::kMediumPriority, RtTask::kMode,
-      RtTime::kTenMilliseconds, RtCpu::kCore7);
+      RtTask::kStackSize, RtTask::kHighPriority, RtTask::kMode,
+      tick, RtCpu::kCore7);
+  rtPeakCanTransmitTask->mSchedule = schedule;
+  rtPeakCanTransmitTask->RegisterSafeState(safeState);
 
-  rtPeakCanTransmitTask->StartRoutine();
+  if(rtPeakCanTransmitTask->StartRoutine())
+    return -1;
 
   while(true)
   {}
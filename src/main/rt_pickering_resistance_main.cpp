@@ -1,28 +1,48 @@
+#include <string.h>
+
 #include <chrono>
 #include <iostream>
 #include <memory>
 #include <thread>
+#include <vector>
 
 #include <alchemy/mutex.h>
 
 #include <testing.h>
 
+#include <PilpxiBackend.h>
+#include <PxiCardManager.h>
+#include <PxiCommandExecutor.h>
 #include <RtGenerateResistanceArrayTask.h>
 #include <RtMacro.h>
 #include <RtResistanceTask.h>
+#include <SafeState.h>
 
 // TODO: delete this
 RT_TASK rtResistanceArrayTask;
 
+// model outputs sampled per period, one per model step
+constexpr auto kNumModelSignals = 10u;
+
+static std::unique_ptr<PxiCardManager> pxiCardManager;
+static std::shared_ptr<PxiCommandExecutor> pxiCommandExecutor;
 static std::shared_ptr<RtSharedArray> rtSharedArray;
 static std::unique_ptr<RtResistanceTask> rtResistanceTask;
 static std::unique_ptr<RtGenerateResistanceArrayTask> rtGenerateResistanceArrayTask;
+static SafeState safeState("resistance_testing");
 
 void TerminationHandler(int s)
 {
-  printf("Caught ctrl + c signal. Closing Card and Exiting.\n");
-  PIL_ClearCard(rtResistanceTask->mCardNum);
-  PIL_CloseSpecifiedCard(rtResistanceTask->mCardNum);
+  printf("Caught ctrl + c signal. Closing Cards and Exiting.\n");
+  safeState.Enter();
+  // closed as they are, CloseAllCards() would clear the safe subunits again
+  if(pxiCardManager)
+  {
+    for(auto &card : pxiCardManager->GetOpenCards())
+    {
+      card->Close();
+    }
+  }
   exit(1);
 }
 
@@ -34,23 +54,85 @@ int main(int argc, char **argv)
   sigemptyset(&signalHandler.sa_mask);
   signalHandler.sa_flags = 0;
   sigaction(SIGINT, &signalHandler, NULL);
+  sigaction(SIGTERM, &signalHandler, NULL);
 
   rtSharedArray = std::make_shared<RtSharedArray>("RtSharedArray");
 
+  // card positions to drive, defaults to the third card found
+  // -c <file> loads resistance calibrations, see ResistanceGenerator::LoadCalibration
+  // -s <card position> <subunit> <value>, as often as needed, is a subunit the safe state
+  // sets after clearing the cards
+  std::vector<DWORD> cardPositions;
+  std::vector<PxiSafeSubunit> safeSubunits;
+  const char *calibrationPath = NULL;
+  for(auto i{1}; i < argc; ++i)
+  {
+    if(strcmp(argv[i], "-c") == 0 && i + 1 < argc)
+      calibrationPath = argv[++i];
+    else if(strcmp(argv[i], "-s") == 0 && i + 3 < argc)
+    {
+      safeSubunits.push_back(PxiSafeSubunit{static_cast<DWORD>(atol(argv[i + 1])),
+        static_cast<DWORD>(atol(argv[i + 2])), static_cast<DWORD>(strtoul(argv[i + 3], NULL, 0))});
+      i += 3;
+    }
+    else
+      cardPositions.push_back(atol(argv[i]));
+  }
+  if(cardPositions.empty())
+    cardPositions.push_back(3);
+
+  pxiCommandExecutor = std::make_shared<PxiCommandExecutor>(RtCpu::kCore5);
+  pxiCardManager = std::make_unique<PxiCardManager>(std::make_shared<PilpxiBackend>());
+  pxiCardManager->FindFreeCards();
+  if(pxiCardManager->OpenCards(cardPositions))
+  {
+    printf("Error opening resistance cards. Exiting.\n");
+    return -1;
+  }
+  for(auto &safe : safeSubunits)
+  {
+    if(pxiCardManager->AddSafeSubunit(safe.mCardPosition, safe.mSubunit, safe.mValue))
+    {
+      printf("Error setting up the safe state. Exiting.\n");
+      pxiCardManager->CloseAllCards();
+      return -1;
+    }
+  }
+  // the executor stops before the cards are cleared
+  pxiCardManager->RegisterSafeState(safeState);
+  pxiCommandExecutor->RegisterSafeState(safeState);
+
+  rtResistanceTask = std::make_unique<RtResistanceTask>(
+    "SetSubunitResistanceRoutine", RtTask::kStackSize, RtTask::kMediumPriority,
+    RtTask::kMode, RtTime::kTenMilliseconds, RtCpu::kCore7);
+  for(auto cardPosition : cardPositions)
+  {
+    rtResistanceTask->AddCard(pxiCardManager->GetCard(cardPosition));
+  }
+  rtResistanceTask->mRtSharedArray = rtSharedArray;
+  rtResistanceTask->mExecutor = pxiCommandExecutor;
+
+  // the generator covers the same subunits, in the same order, as rtResistanceTask
   rtGenerateResistanceArrayTask = std::make_unique<RtGenerateResistanceArrayTask>(
     "GenerateResistanceArrayRoutine", RtTask::kStackSize, RtTask::kMediumPriority,
     RtTask::kMode, RtTime::kTenMilliseconds, RtCpu::kCore6);
   rtGenerateResistanceArrayTask->mRtSharedArray = rtSharedArray;
+  auto &generator = rtGenerateResistanceArrayTask->mGenerator;
+  if(generator.Configure(rtResistanceTask->mCards, kNumModelSignals) ||
+    (calibrationPath && generator.LoadCalibration(calibrationPath)))
+  {
+    printf("Error configuring the resistance generator. Exiting.\n");
+    pxiCardManager->CloseAllCards();
+    return -1;
+  }
+  generator.PrintCalibration();
   rtGenerateResistanceArrayTask->StartRoutine();
 
-  DWORD cardNum = 3;
-  rtResistanceTask = std::make_unique<RtResistanceTask>(
-    "SetSubunitResistanceRoutine", RtTask::kStackSize, RtTask::kMediumPriority,
-    RtTask::kMode, RtTime::kTenMilliseconds, RtCpu::kCore7);
-  rtResistanceTask->OpenCard(cardNum);
-  rtResistanceTask->mRtSharedArray = rtSharedArray;
   rtResistanceTask->StartRoutine();
 
+  // pilpxi calls are made from this linux thread only
+  pxiCommandExecutor->Start();
+
   while(true) // original parent process will wait until ctrl+c signal
   {}
 
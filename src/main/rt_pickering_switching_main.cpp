@@ -1,27 +1,42 @@
+#include <string.h>
+
 #include <chrono>
 #include <iostream>
 #include <memory>
 #include <thread>
+#include <vector>
 
 #include <testing.h>
 
 #include <alchemy/mutex.h>
 
+#include <PilpxiBackend.h>
+#include <PxiCardManager.h>
+#include <PxiCommandExecutor.h>
 #include <RtGenerateStateTask.h>
 #include <RtSharedState.h>
 #include <RtSwitchTask.h>
+#include <SafeState.h>
 
+static std::unique_ptr<PxiCardManager> pxiCardManager;
+static std::shared_ptr<PxiCommandExecutor> pxiCommandExecutor;
 static std::unique_ptr<RtSwitchTask> rtSwitchTask;
 static std::unique_ptr<RtGenerateStateTask> rtGenerateStateTask;
 static std::shared_ptr<RtSharedState> rtSharedState;
+static SafeState safeState("switching_testing");
 
 void TerminationHandler(int s)
 {
-  printf("Caught ctrl + c signal. Closing Card and Exiting.\n");
-
-  PIL_ClearCard(rtSwitchTask->mCardNum);
-  PIL_CloseSpecifiedCard(rtSwitchTask->mCardNum);
-
+  printf("Caught ctrl + c signal. Closing Cards and Exiting.\n");
+  safeState.Enter();
+  // closed as they are, CloseAllCards() would clear the safe subunits again
+  if(pxiCardManager)
+  {
+    for(auto &card : pxiCardManager->GetOpenCards())
+    {
+      card->Close();
+    }
+  }
   exit(1);
 }
 
@@ -33,6 +48,7 @@ int main(int argc, char **argv)
   sigemptyset(&signalHandler.sa_mask);
   signalHandler.sa_flags = 0;
   sigaction(SIGINT, &signalHandler, NULL);
+  sigaction(SIGTERM, &signalHandler, NULL);
 
   rtSharedState = std::make_shared<RtSharedState>("RtSharedState");
 
@@ -43,21 +59,58 @@ int main(int argc, char **argv)
   rtGenerateStateTask->mRtSharedState = rtSharedState;
   rtGenerateStateTask->StartRoutine();
 
-  DWORD cardNum = 2;
-  DWORD subunit = 1;
-  DWORD bit = 1;
+  // [card position] [subunit] [bit], and -s <card position> <subunit> <value> as often as
+  // needed for a subunit the safe state sets after clearing the cards
+  std::vector<DWORD> arguments;
+  std::vector<PxiSafeSubunit> safeSubunits;
+  for(auto i{1}; i < argc; ++i)
+  {
+    if(strcmp(argv[i], "-s") == 0 && i + 3 < argc)
+    {
+      safeSubunits.push_back(PxiSafeSubunit{static_cast<DWORD>(atol(argv[i + 1])),
+        static_cast<DWORD>(atol(argv[i + 2])), static_cast<DWORD>(strtoul(argv[i + 3], NULL, 0))});
+      i += 3;
+    }
+    else
+      arguments.push_back(atol(argv[i]));
+  }
+  DWORD cardPosition = (arguments.size() > 0) ? arguments[0] : 2;
+  DWORD subunit = (arguments.size() > 1) ? arguments[1] : 1;
+  DWORD bit = (arguments.size() > 2) ? arguments[2] : 1;
+
+  pxiCommandExecutor = std::make_shared<PxiCommandExecutor>(RtCpu::kCore5);
+  pxiCardManager = std::make_unique<PxiCardManager>(std::make_shared<PilpxiBackend>());
+  pxiCardManager->FindFreeCards();
+  if(pxiCardManager->OpenCards({cardPosition}))
+  {
+    printf("Error opening switching card. Exiting.\n");
+    return -1;
+  }
+  for(auto &safe : safeSubunits)
+  {
+    if(pxiCardManager->AddSafeSubunit(safe.mCardPosition, safe.mSubunit, safe.mValue))
+    {
+      printf("Error setting up the safe state. Exiting.\n");
+      pxiCardManager->CloseAllCards();
+      return -1;
+    }
+  }
+  // the executor stops before the cards are cleared
+  pxiCardManager->RegisterSafeState(safeState);
+  pxiCommandExecutor->RegisterSafeState(safeState);
 
   rtSwitchTask = std::make_unique<RtSwitchTask>(
     "SetSubunitSwitchState", RtTask::kStackSize, RtTask::kMediumPriority,
     RtTask::kMode, RtTime::kTenMilliseconds, RtCpu::kCore6);
 
-  rtSwitchTask->OpenCard(cardNum);
-  rtSwitchTask->mSubunit = subunit;
-  rtSwitchTask->mBit = bit;
+  rtSwitchTask->AddTarget(pxiCardManager->GetCard(cardPosition), subunit, bit);
   rtSwitchTask->mRtSharedState = rtSharedState;
-  rtSwitchTask->mOneSecondTimer = rt_timer_read();
+  rtSwitchTask->mExecutor = pxiCommandExecutor;
   rtSwitchTask->StartRoutine();
 
+  // pilpxi calls are made from this linux thread only
+  pxiCommandExecutor->Start();
+
   while(true) // original parent process will wait until ctrl+c signal
   {}
 
@@ -0,0 +1,109 @@
+#include <math.h>
+#include <stdio.h>
+
+#include <memory>
+
+#include <PwmDutyDecoder.h>
+#include <PwmOutput.h>
+#include <RtMacro.h>
+#include <RtPwmOutputTask.h>
+
+/*
+ * buffered pwm output driven by an rt task
+ *
+ * the duty follows a slow sine, one pulse per update period. raise the update rate
+ * until the stats show underruns to find what one counter sustains with a given task
+ * period and write-ahead.
+ */
+
+iBus *pwmOutputBus = NULL;
+std::unique_ptr<RtPwmOutputTask> rtPwmOutputTask;
+
+struct SineDuty
+{
+  uint32_t mPeriodTicks;
+  double mPhase;
+  double mStep;
+};
+
+static void NextSinePulse(void *context, PwmPulse &pulse)
+{
+  auto *sine = static_cast<SineDuty*>(context);
+  sine->mPhase += sine->mStep;
+  if(sine->mPhase > 2. * M_PI)
+    sine->mPhase -= 2. * M_PI;
+  pulse = PwmPulseFromDuty(static_cast<float>(50. + 40. * sin(sine->mPhase)),
+    sine->mPeriodTicks);
+}
+
+void TerminationHandler(int s)
+{
+  printf("Caught ctrl + c signal. Closing and Exiting.\n");
+  rtPwmOutputTask.reset();
+  if(pwmOutputBus)
+    releaseBoard(pwmOutputBus);
+  exit(1);
+}
+
+int main(int argc, char **argv)
+{
+  if(argc < 3)
+  {
+    printf("Usage: rt_pwm_output [bus number] [device number] [pwm frequency (Hz)] "
+      "[update rate (Hz)] [write-ahead (pulses)] [task period (us)] [counter] [PFI]\n"
+      "  defaults: 20000 Hz, 20000 updates/s, 8 pulses, 100 us, counter 0 on PFI0,\n"
+      "  the paired counter (1 for 0, 3 for 2) clocks the updates\n");
+    return -1;
+  }
+  const unsigned int frequencyHz = (argc > 3) ? atol(argv[3]) : 20000;
+  const unsigned int updateHz = (argc > 4) ? atol(argv[4]) : 20000;
+  const unsigned int writeAhead = (argc > 5) ? atol(argv[5]) : 8;
+  const unsigned long long periodNs = ((argc > 6) ? atol(argv[6]) : 100) *
+    RtTime::kOneMicrosecond;
+  const unsigned int counterNumber = (argc > 7) ? atol(argv[7]) : 0;
+  const unsigned int pfi = (argc > 8) ? atol(argv[8]) : 0;
+  if(frequencyHz == 0 || updateHz == 0 || updateHz > frequencyHz)
+  {
+    printf("rt_pwm_output: at most one update per pwm period\n");
+    return -1;
+  }
+
+  // ctrl + c signal handler
+  struct sigaction signalHandler;
+  signalHandler.sa_handler = TerminationHandler;
+  sigemptyset(&signalHandler.sa_mask);
+  signalHandler.sa_flags = 0;
+  sigaction(SIGINT, &signalHandler, NULL);
+
+  char boardLocation[256];
+  snprintf(boardLocation, sizeof(boardLocation), "PXI%s::%s::INSTR", argv[1], argv[2]);
+  pwmOutputBus = acquireBoard(boardLocation);
+  if(pwmOutputBus == NULL)
+  {
+    printf("rt_pwm_output: Could not access PCI device %s\n", boardLocation);
+    return -1;
+  }
+
+  SineDuty sine;
+  sine.mPeriodTicks = static_cast<uint32_t>(PwmCaptureLimit::kTimebaseHz / frequencyHz);
+  sine.mPhase = 0.;
+  sine.mStep = 2. * M_PI / updateHz; // one sine per second
+
+  auto output = std::make_shared<PwmOutput>("rt_pwm_output", pwmOutputBus, counterNumber,
+    pfi, static_cast<uint32_t>(PwmCaptureLimit::kTimebaseHz / updateHz), writeAhead);
+  if(output->Open())
+    return -1;
+
+  rtPwmOutputTask = std::make_unique<RtPwmOutputTask>(output, "RtPwmOutputTask",
+    RtTask::kStackSize, RtTask::kHighPriority, RtTask::kMode, periodNs, RtCpu::kCore5);
+  rtPwmOutputTask->mSource = NextSinePulse;
+  rtPwmOutputTask->mSourceContext = &sine;
+  rtPwmOutputTask->mInitial = PwmPulseFromDuty(50.f, sine.mPeriodTicks);
+  if(rtPwmOutputTask->StartRoutine())
+    return -1;
+
+  while(true)
+  {}
+
+  return 0;
+}
@@ -0,0 +1,431 @@
+#include <AoStream.h>
+
+#include <string.h>
+#include <time.h>
+
+#include <vector>
+
+#include "simultaneousInit.h"
+
+#include <CalibrationTable.h>
+
+namespace {
+
+constexpr auto kDelayTicks = 2u; // tb3 ticks from the start trigger to the first update
+constexpr auto kMinUpdatePeriodTicks = 100u; // 1 MS/s, the fastest dac update
+constexpr auto kTimebaseHz = 100e6;
+constexpr auto kTimeoutNs = 5000000000ull;
+
+unsigned long long NowNs()
+{
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return static_cast<unsigned long long>(now.tv_sec) * 1000000000ull + now.tv_nsec;
+}
+
+} // namespace
+
+AoStream::AoStream(const char *name, iBus *bus, const AoStreamConfig &config)
+  : mBus(bus)
+  , mDeviceInfo(NULL)
+  , mConfig(config)
+  , mScaling{}
+  , mFrameBytes(config.mNumChannels * sizeof(i16))
+  , mDmaBytes(AoStreamLimit::kDmaFrames * config.mNumChannels * sizeof(i16))
+  , mWriteAhead(config.mMinWriteAhead)
+  , mWindowPolls(0)
+  , mWindowMinAhead(AoStreamLimit::kDmaFrames)
+  , mLast{}
+  , mCounters{}
+  , mRunning(false)
+  , mName(name)
+{
+  mCounters.mMinAhead = AoStreamLimit::kDmaFrames;
+}
+
+int AoStream::Open(const char *calibrationCache)
+{
+  if(mConfig.mNumChannels == 0 || mConfig.mNumChannels > AoStreamLimit::kMaxChannels ||
+    mConfig.mMinWriteAhead == 0 || mConfig.mMinWriteAhead > mConfig.mMaxWriteAhead ||
+    mConfig.mMaxWriteAhead > AoStreamLimit::kMaxWriteAhead ||
+    mConfig.mUpdatePeriodTicks < kMinUpdatePeriodTicks)
+  {
+    printf("%s: 1..%u channels, a write-ahead within 1..%u frames and an update period of "
+      "at least %u ticks expected.\n", mName, AoStreamLimit::kMaxChannels,
+      AoStreamLimit::kMaxWriteAhead, kMinUpdatePeriodTicks);
+    return -1;
+  }
+
+  nMDBG::tStatus2 status;
+  mBar0 = mBus->createAddressSpace(kPCI_BAR0);
+  mDevice = std::make_unique<tXSeries>(mBar0, &status);
+
+  mDeviceInfo = nNISTC3::getDeviceInfo(*mDevice, status);
+  if(status.isFatal())
+  {
+    printf("%s: Cannot identify device (%d).\n", mName, status.statusCode);
+    return -1;
+  }
+  // also opens the eeprom window of a simultaneous device
+  if(mDeviceInfo->isSimultaneous)
+    nNISTC3::initializeSimultaneousXSeries(*mDevice, status);
+  if(mConfig.mNumChannels > mDeviceInfo->numberOfDACs)
+  {
+    printf("%s: %u AO channels, the device has %u.\n", mName, mConfig.mNumChannels,
+      mDeviceInfo->numberOfDACs);
+    return -1;
+  }
+
+  if(calibrationCache)
+  {
+    mCalibrationCache = std::make_unique<CalibrationCache>(mName, calibrationCache);
+    mEeprom = mCalibrationCache->Open(*mDevice, *mDeviceInfo);
+  }
+  else
+  {
+    mEeprom = std::make_unique<nNISTC3::eepromHelper>(*mDevice, mDeviceInfo->isSimultaneous,
+      mDeviceInfo->numberOfADCs, mDeviceInfo->numberOfDACs, status);
+    if(status.isFatal())
+      mEeprom.reset();
+  }
+  if(!mEeprom)
+  {
+    printf("%s: Cannot read the calibration (%d).\n", mName, status.statusCode);
+    return -1;
+  }
+  const auto gain = mDeviceInfo->getAO_Gain(mConfig.mRange, status);
+  if(status.isFatal())
+  {
+    printf("%s: Invalid AO range (%d).\n", mName, status.statusCode);
+    return -1;
+  }
+
+  // continuous updates from the dma stream without regeneration, as in aoex6
+  mAoHelper = std::make_unique<nNISTC3::aoHelper>(mDevice->AO, mDevice->AO.AO_Timer,
+    mHelperStatus);
+  auto &timer = mAoHelper->getOutTimerHelper(status);
+  mAoHelper->reset(status);
+  mDevice->AO.AO_Timer.Reset_Register.writeConfiguration_Start(kTrue, &status);
+  mAoHelper->programExternalGate(nAO::kGate_Disabled, nAO::kRising_Edge, kFalse, status);
+  mAoHelper->programStart1(nAO::kStart1_Pulse, nAO::kRising_Edge, kTrue, status);
+  timer.programStart1(nOutTimer::kSyncDefault, nOutTimer::kExportSynchronizedTriggers, status);
+  // continuous, the buffer and update counts only pace the stop
+  timer.programBufferCount(2, status);
+  timer.programUpdateCount(AoStreamLimit::kMaxWriteAhead, 0, status);
+  timer.loadUC(status);
+  timer.programBCGate(nOutTimer::kDisabled, status);
+  mAoHelper->programUpdate(nAO::kUpdate_UI_TC, nAO::kRising_Edge, status);
+  timer.programUICounter(nOutTimer::kUI_Src_TB3, nOutTimer::kRising_Edge,
+    nOutTimer::kContinuousOp, status);
+  timer.loadUI(kDelayTicks, mConfig.mUpdatePeriodTicks, status);
+  // an underflow holds the dacs, Poll() counts it and refills
+  timer.programStopCondition(kTrue, nOutTimer::kContinuousOp, nOutTimer::kContinue_on_Error,
+    nOutTimer::kContinue_on_Error, nOutTimer::kStop_on_Error, status);
+  timer.programFIFO(kTrue, nOutTimer::kFifoMode_Less_Than_Full, nOutTimer::kDisabled, status);
+  timer.clearFIFO(status);
+  timer.programNumberOfChannels(mConfig.mNumChannels, status);
+
+  std::vector<nNISTC3::aoHelper::tChannelConfiguration> channels(mConfig.mNumChannels);
+  for(auto i{0u}; i < mConfig.mNumChannels; ++i)
+  {
+    channels[i].channel = i;
+    channels[i].gain = gain;
+    channels[i].updateMode = nAO::kTimed;
+    channels[i].range = mConfig.mRange;
+    mAoHelper->programConfigBank(channels[i], status);
+  }
+  mAoHelper->programChannels(channels, status);
+  mDevice->AO.AO_Timer.Reset_Register.writeConfiguration_End(kTrue, &status);
+  if(status.isFatal())
+  {
+    printf("%s: AO configuration (%d).\n", mName, status.statusCode);
+    return -1;
+  }
+
+  // code = c0 + c1 * volts and volts = offset + gain * value, one multiply-add per sample
+  if(LoadAoScalingTable(mName, *mEeprom, channels, mScaling))
+    return -1;
+  for(auto i{0u}; i < mConfig.mNumChannels; ++i)
+  {
+    auto *coefficients = mScaling.mCoefficients[i];
+    coefficients[0] += coefficients[1] * mConfig.mScale[i].mOffsetVolts;
+    coefficients[1] *= mConfig.mScale[i].mVoltsPerUnit;
+  }
+
+  if(mBus->getDMAPool() == NULL && mBus->reserveDMA(AoStreamLimit::kDmaPoolBytes))
+    printf("%s: No DMA pool, the ring comes from the driver.\n", mName);
+  mStreamHelper = std::make_unique<nNISTC3::streamHelper>(mDevice->AOStreamCircuit,
+    mDevice->CHInCh, mHelperStatus);
+  mDma = std::make_unique<nNISTC3::tCHInChDMAChannel>(*mDevice, nNISTC3::kAO_DMAChannel,
+    status);
+  if(status.isFatal())
+  {
+    printf("%s: DMA channel initialization (%d).\n", mName, status.statusCode);
+    return -1;
+  }
+  mDma->reset(status);
+  mDma->configure(mBus, nNISTC3::kReuseLinkRing, nNISTC3::kOut, mDmaBytes, status);
+  if(status.isFatal())
+  {
+    printf("%s: DMA channel configuration (%d).\n", mName, status.statusCode);
+    return -1;
+  }
+  return 0;
+}
+
+// frames the dma ring and the fifo still hold for the dacs
+uint32_t AoStream::Ahead(nMDBG::tStatus2 &status)
+{
+  tBoolean regenerated = kFalse;
+  u32 space = 0;
+  mDma->write(0, NULL, &space, kFalse, &regenerated, status);
+  const auto fifoSamples = mDevice->AO.AO_FIFO_Status_Register.readRegister(&status);
+  return (mDmaBytes - space) / mFrameBytes + fifoSamples / mConfig.mNumChannels;
+}
+
+// the first numFrames of the ring scaled, then numHeld copies of the last frame, through
+// one span of the dma ring; it wraps between two frames
+int AoStream::Write(const uint32_t numFrames, const uint32_t numHeld, nMDBG::tStatus2 &status)
+{
+  const auto numChannels = mConfig.mNumChannels;
+  const auto bytes = (numFrames + numHeld) * mFrameBytes;
+  if(bytes == 0)
+    return 0;
+
+  for(auto i{0u}; i < numFrames; ++i)
+  {
+    const auto *frame = mRing.Peek(i);
+    for(auto j{0u}; j < numChannels; ++j)
+    {
+      mPlanes[j][i] = frame->mValues[j];
+    }
+  }
+
+  nNISTC3::tDMASpan span;
+  tBoolean regenerated = kFalse;
+  u32 space = 0;
+  mDma->acquireWrite(bytes, &span, &space, kFalse, &regenerated, status);
+  if(status.isFatal())
+    return -1;
+  const float *channels[AoStreamLimit::kMaxChannels];
+  auto scaled{0u};
+  for(auto part{0u}; part < 2; ++part)
+  {
+    auto *raw = reinterpret_cast<int16_t*>(span.data[part]);
+    auto partFrames = span.size[part] / mFrameBytes;
+    if(scaled < numFrames && partFrames > 0)
+    {
+      const auto count = numFrames - scaled < partFrames ? numFrames - scaled : partFrames;
+      for(auto j{0u}; j < numChannels; ++j)
+      {
+        channels[j] = mPlanes[j] + scaled;
+      }
+      ScaleAo(mScaling, channels, count, raw);
+      raw += count * numChannels;
+      memcpy(mLast, raw - numChannels, mFrameBytes);
+      partFrames -= count;
+      scaled += count;
+    }
+    for(auto i{0u}; i < partFrames; ++i, raw += numChannels)
+    {
+      memcpy(raw, mLast, mFrameBytes);
+    }
+  }
+  mDma->releaseWrite(&space, kFalse, &regenerated, status);
+  if(status.isFatal())
+    return -1;
+  mRing.Release(numFrames);
+  return static_cast<int>(bytes);
+}
+
+int AoStream::WaitForFifo()
+{
+  nMDBG::tStatus2 status;
+  auto startNs = NowNs();
+  while(mDevice->AO.AO_Timer.Status_1_Register.readFIFO_Empty_St(&status) == nOutTimer::kEmpty)
+  {
+    if(status.isFatal() || NowNs() - startNs > kTimeoutNs)
+      return -1;
+  }
+  return 0;
+}
+
+int AoStream::Start(const AoFrame &initial)
+{
+  nMDBG::tStatus2 status;
+  // the initial frame as the last one, the dacs hold it until the first push arrives
+  const float *channels[AoStreamLimit::kMaxChannels];
+  for(auto j{0u}; j < mConfig.mNumChannels; ++j)
+  {
+    channels[j] = &initial.mValues[j];
+  }
+  ScaleAo(mScaling, channels, 1, mLast);
+  mWriteAhead = mConfig.mMinWriteAhead;
+  mWindowPolls = 0;
+  mWindowMinAhead = AoStreamLimit::kDmaFrames;
+
+  const auto primed = Write(0, mWriteAhead, status);
+  if(primed <= 0)
+  {
+    printf("%s: Cannot prime the DMA ring (%d).\n", mName, status.statusCode);
+    return -1;
+  }
+  mDma->start(status);
+  mStreamHelper->configureForOutput(kTrue, nNISTC3::kAO_DMAChannel, status);
+  mStreamHelper->modifyTransferSize(primed, status);
+  mStreamHelper->enable(status);
+  if(status.isFatal())
+  {
+    printf("%s: DMA start (%d).\n", mName, status.statusCode);
+    return -1;
+  }
+
+  // the first frame goes to the dacs without an update so they don't glitch
+  auto &timer = mAoHelper->getOutTimerHelper(status);
+  if(WaitForFifo())
+  {
+    printf("%s: AO FIFO did not receive data within timeout.\n", mName);
+    return -1;
+  }
+  timer.notAnUpdate(status);
+  timer.setArmUI(kTrue, status);
+  timer.setArmUC(kTrue, status);
+  timer.setArmBC(kTrue, status);
+  timer.armTiming(status);
+  mDevice->AO.AO_Timer.Command_1_Register.writeSTART1_Pulse(kTrue, &status);
+  if(status.isFatal())
+  {
+    printf("%s: Start (%d).\n", mName, status.statusCode);
+    return -1;
+  }
+  mRunning = true;
+  return 0;
+}
+
+void AoStream::Adapt(const uint32_t ahead, const bool late)
+{
+  if(late)
+  {
+    if(mWriteAhead < mConfig.mMaxWriteAhead)
+    {
+      mWriteAhead += mWriteAhead / 2 + 1;
+      if(mWriteAhead > mConfig.mMaxWriteAhead)
+        mWriteAhead = mConfig.mMinWriteAhead;
+      ++mCounters.mGrown;
+    }
+    mWindowPolls = 0;
+    mWindowMinAhead = AoStreamLimit::kDmaFrames;
+    return;
+  }
+
+  if(ahead < mWindowMinAhead)
+    mWindowMinAhead = ahead;
+  if(++mWindowPolls < AoStreamLimit::kAdaptPolls)
+    return;
+  if(mWindowMinAhead > mWriteAhead / 2 && mWriteAhead > mConfig.mMinWriteAhead)
+  {
+    mWriteAhead -= mWriteAhead / 8 ? mWriteAhead / 8 : 1;
+    if(mWriteAhead < mConfig.mMinWriteAhead)
+      mWriteAhead = mConfig.mMinWriteAhead;
+    ++mCounters.mShrunk;
+  }
+  mWindowPolls = 0;
+  mWindowMinAhead = AoStreamLimit::kDmaFrames;
+}
+
+int AoStream::Poll()
+{
+  if(!mRunning)
+    return -1;
+
+  nMDBG::tStatus2 status;
+  auto &timerStatus = mDevice->AO.AO_Timer.Status_1_Register;
+  timerStatus.refresh(&status);
+  auto late{false};
+  if(timerStatus.getUnderflow_St(&status))
+  {
+    ++mCounters.mUnderruns;
+    mDevice->AO.AO_Timer.Interrupt1_Register.writeError_Interrupt_Ack(kTrue, &status);
+    late = true;
+  }
+  if(timerStatus.getOverrun_St(&status))
+    return -1;
+
+  const auto ahead = Ahead(status);
+  if(status.isFatal())
+    return -1;
+  if(ahead == 0)
+    late = true;
+  if(ahead < mCounters.mMinAhead)
+    mCounters.mMinAhead = ahead;
+  if(ahead > mCounters.mMaxAhead)
+    mCounters.mMaxAhead = ahead;
+
+  // what would wait longer than twice the write-ahead goes, oldest first
+  uint32_t numFrames = mRing.Size();
+  const auto limit = 2 * mWriteAhead;
+  if(ahead + numFrames > limit)
+  {
+    const auto dropped = ahead < limit ? ahead + numFrames - limit : numFrames;
+    mRing.Release(dropped);
+    mCounters.mDropped += dropped;
+    numFrames -= dropped;
+  }
+  // a source that fell behind is held at its last frame for the write-ahead
+  const auto numHeld = ahead + numFrames < mWriteAhead ? mWriteAhead - ahead - numFrames : 0u;
+
+  const auto bytes = Write(numFrames, numHeld, status);
+  if(bytes < 0)
+    return -1;
+  if(bytes > 0)
+    mStreamHelper->modifyTransferSize(bytes, status);
+  mCounters.mFrames += numFrames;
+  mCounters.mHeld += numHeld;
+  ++mCounters.mPolls;
+  Adapt(ahead, late);
+
+  if(status.isFatal())
+    return -1;
+  return static_cast<int>(numFrames);
+}
+
+void AoStream::Stop()
+{
+  if(!mRunning)
+    return;
+
+  nMDBG::tStatus2 status;
+  mAoHelper->getOutTimerHelper(status).disarmTiming(status);
+  mStreamHelper->disable(status);
+  mDma->stop(status);
+  mRunning = false;
+}
+
+void AoStream::PrintStats(const unsigned long long elapsedNs, int (*print)(const char*, ...))
+{
+  print("%s: %u channels at %.0f S/s, polls/s: %.0f, write-ahead %u frames, ahead %u..%u, "
+    "frames: %llu, held: %llu, dropped: %llu, rejected: %llu, underruns: %llu, grown: %llu, "
+    "shrunk: %llu\n", mName, mConfig.mNumChannels, kTimebaseHz / mConfig.mUpdatePeriodTicks,
+    elapsedNs ? mCounters.mPolls * 1e9 / elapsedNs : 0., mWriteAhead, mCounters.mMinAhead,
+    mCounters.mMaxAhead, mCounters.mFrames, mCounters.mHeld, mCounters.mDropped,
+    mCounters.mRejected, mCounters.mUnderruns, mCounters.mGrown, mCounters.mShrunk);
+  mCounters.mPolls = 0;
+  mCounters.mMinAhead = AoStreamLimit::kDmaFrames;
+  mCounters.mMaxAhead = 0;
+}
+
+AoStream::~AoStream()
+{
+  Stop();
+  // the helpers unwind the ao timer and the stream circuit before the device goes away
+  mDma.reset();
+  mStreamHelper.reset();
+  mAoHelper.reset();
+  mEeprom.reset();
+  mCalibrationCache.reset();
+  if(mDevice)
+  {
+    mDevice.reset();
+    mBus->destroyAddressSpace(mBar0);
+  }
+}
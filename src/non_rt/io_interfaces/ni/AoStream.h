@@ -0,0 +1,186 @@
+#ifndef _AOSTREAM_H_
+#define _AOSTREAM_H_
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include <memory>
+
+// OS Interface
+#include "osiBus.h"
+
+// Chip Objects
+#include "tXSeries.h"
+
+// Chip Object Helpers
+#include "devices.h"
+#include "eepromHelper.h"
+#include "outTimer/aoHelper.h"
+#include "streamHelper.h"
+
+// DMA Support
+#include "CHInCh/dmaProperties.h"
+#include "CHInCh/tCHInChDMAChannel.h"
+
+#include <CalibrationCache.h>
+#include <RtSpscRing.h>
+#include <SampleScaling.h>
+
+namespace AoStreamLimit
+{
+constexpr auto kMaxChannels = 4u; // dacs of an x series device
+constexpr auto kRingFrames = 4096u; // frames pushed between two polls, a power of two
+constexpr auto kMaxWriteAhead = 1024u; // frames
+constexpr auto kDmaFrames = 2 * kMaxWriteAhead; // frames are capped at twice the write-ahead
+constexpr auto kAdaptPolls = 1000u; // polls with room to spare before the write-ahead shrinks
+constexpr auto kDmaPoolBytes = 64u * 1024u; // ring and sgl links, with room
+}
+
+// one update of every streamed channel in the units of its source, amps for currents
+struct AoFrame
+{
+  float mValues[AoStreamLimit::kMaxChannels];
+};
+
+typedef RtSpscRing<AoFrame, AoStreamLimit::kRingFrames> AoFrameRing;
+
+// source units to volts at the connector
+struct AoChannelScale
+{
+  float mVoltsPerUnit;
+  float mOffsetVolts;
+};
+
+struct AoStreamConfig
+{
+  uint32_t mNumChannels; // ao0 on
+  nNISTC3::tOutputRange mRange;
+  uint32_t mUpdatePeriodTicks; // timebase 3 ticks per update
+  // the write-ahead adapts between these, in frames; it must cover a poll period
+  uint32_t mMinWriteAhead;
+  uint32_t mMaxWriteAhead;
+  AoChannelScale mScale[AoStreamLimit::kMaxChannels];
+};
+
+struct AoStreamCounters
+{
+  unsigned long long mFrames;
+  // repeats of the last frame written because the source fell behind
+  unsigned long long mHeld;
+  // frames beyond twice the write-ahead, dropped unwritten
+  unsigned long long mDropped;
+  // pushes that found the ring full
+  unsigned long long mRejected;
+  // fifo underflows, the dacs held their last update meanwhile
+  unsigned long long mUnderruns;
+  unsigned long long mGrown;
+  unsigned long long mShrunk;
+  // since the last PrintStats()
+  unsigned long long mPolls;
+  unsigned int mMinAhead;
+  unsigned int mMaxAhead;
+};
+
+/*
+ * hardware-timed ao of values a model publishes every step, at the model rate
+ *
+ * the ao timer updates from the dma stream as in aoex6, without regeneration. the model
+ * step pushes one frame per update into a lock-free ring and Poll() scales what is
+ * there to dac codes straight into the dma ring with the vectorized ScaleAo(), the
+ * volts per unit of every channel folded into the calibration. only what is written is
+ * credited to the stream circuit, so the dma ring and the fifo together hold no more
+ * than was written, and the frames of a poll reach the dacs in the order pushed.
+ *
+ * after every poll the hardware holds at least the write-ahead: when the source fell
+ * behind, the last frame is repeated so the dacs hold their value rather than the fifo
+ * underflowing. the frames between the model and the dacs are capped at twice the
+ * write-ahead, beyond that the oldest unwritten ones are dropped, which bounds the
+ * latency when the source runs ahead of the board clock. the write-ahead starts at its
+ * smallest; an underflow or a poll that finds the hardware drained grows it by half, and
+ * after kAdaptPolls polls that all found more than half of it still ahead it shrinks by
+ * an eighth, back towards the updates of one poll period and its jitter.
+ */
+class AoStream
+{
+private:
+  iBus *mBus;
+  tAddressSpace mBar0;
+  std::unique_ptr<tXSeries> mDevice;
+  const nNISTC3::tDeviceInfo *mDeviceInfo;
+  std::unique_ptr<CalibrationCache> mCalibrationCache;
+  std::unique_ptr<nNISTC3::eepromHelper> mEeprom;
+  // the example helpers keep a reference to the status they were made with
+  nMDBG::tStatus2 mHelperStatus;
+  std::unique_ptr<nNISTC3::aoHelper> mAoHelper;
+  std::unique_ptr<nNISTC3::streamHelper> mStreamHelper;
+  std::unique_ptr<nNISTC3::tCHInChDMAChannel> mDma;
+  const AoStreamConfig mConfig;
+  AoScalingTable mScaling;
+  uint32_t mFrameBytes;
+  uint32_t mDmaBytes;
+  uint32_t mWriteAhead;
+  uint32_t mWindowPolls;
+  uint32_t mWindowMinAhead;
+  AoFrameRing mRing;
+  // one plane per channel for ScaleAo()
+  float mPlanes[AoStreamLimit::kMaxChannels][AoStreamLimit::kDmaFrames];
+  int16_t mLast[AoStreamLimit::kMaxChannels];
+  AoStreamCounters mCounters;
+  bool mRunning;
+
+  uint32_t Ahead(nMDBG::tStatus2 &status);
+  int Write(const uint32_t numFrames, const uint32_t numHeld, nMDBG::tStatus2 &status);
+  void Adapt(const uint32_t ahead, const bool late);
+  int WaitForFifo();
+
+public:
+  const char *mName;
+
+public:
+  AoStream() = delete;
+  AoStream(const char *name, iBus *bus, const AoStreamConfig &config);
+
+  AoStream(const AoStream&) = delete;
+  AoStream& operator=(const AoStream&) = delete;
+
+  // identifies the device, reads the calibration, programs the ao timer and the dma
+  // channel; with a calibration cache file as NiDeviceService::Open()
+  int Open(const char *calibrationCache=NULL);
+  // fills the smallest write-ahead with initial, then arms and starts the updates
+  int Start(const AoFrame &initial);
+  // queues the frame of the next update, -1 when the ring is full
+  int Push(const AoFrame &frame)
+  {
+    if(mRing.Push(frame))
+      return 0;
+    ++mCounters.mRejected;
+    return -1;
+  }
+  // writes what was pushed, held up to the write-ahead, returns the frames written from
+  // the ring or -1 on error
+  int Poll();
+  void Stop();
+
+  uint32_t UpdatePeriodTicks() const
+  {
+    return mConfig.mUpdatePeriodTicks;
+  }
+  uint32_t WriteAhead() const
+  {
+    return mWriteAhead;
+  }
+  // source units to codes of the streamed channels, calibration included
+  const AoScalingTable& Scaling() const
+  {
+    return mScaling;
+  }
+  const AoStreamCounters& Counters() const
+  {
+    return mCounters;
+  }
+  void PrintStats(const unsigned long long elapsedNs, int (*print)(const char*, ...)=printf);
+
+  ~AoStream();
+};
+
+#endif // _AOSTREAM_H_
@@ -0,0 +1,143 @@
+#include <CalibrationCache.h>
+
+#include <stdio.h>
+#include <string.h>
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+CalibrationCache::CalibrationCache(const char *name, const char *path)
+  : mPath(path)
+  , mNumSnapshots(0)
+  , mWarm(false)
+  , mOpenUs(0)
+  , mName(name)
+{}
+
+uint32_t CalibrationCache::Checksum(const void *data, const uint32_t bytes)
+{
+  auto *bytePtr = static_cast<const uint8_t*>(data);
+  uint32_t hash = 2166136261u;
+  for(auto i{0u}; i < bytes; ++i)
+  {
+    hash = (hash ^ bytePtr[i]) * 16777619u;
+  }
+  return hash;
+}
+
+int CalibrationCache::Load()
+{
+  mNumSnapshots = 0;
+  auto *file = fopen(mPath, "rb");
+  if(!file)
+    return -1;
+
+  Header header;
+  auto valid = fread(&header, sizeof(header), 1, file) == 1 &&
+    header.mMagic == CalibrationCacheLimit::kMagic &&
+    header.mVersion == CalibrationCacheLimit::kVersion &&
+    header.mSnapshotBytes == sizeof(nNISTC3::eepromHelper::tSnapshot) &&
+    header.mNumSnapshots <= CalibrationCacheLimit::kMaxBoards &&
+    fread(mSnapshots, sizeof(mSnapshots[0]), header.mNumSnapshots, file) ==
+      header.mNumSnapshots &&
+    Checksum(mSnapshots, header.mNumSnapshots * sizeof(mSnapshots[0])) == header.mChecksum;
+  fclose(file);
+  if(!valid)
+  {
+    printf("%s: Ignoring the calibration cache %s, it is damaged or from another build.\n",
+      mName, mPath);
+    return -1;
+  }
+  mNumSnapshots = header.mNumSnapshots;
+  return 0;
+}
+
+// written next to the file and renamed over it, a reader never sees half a file
+int CalibrationCache::Write(const char *path, const Header header,
+  const nNISTC3::eepromHelper::tSnapshot *snapshots)
+{
+  const auto temporary = std::string(path) + ".tmp";
+  auto *file = fopen(temporary.c_str(), "wb");
+  if(!file)
+    return -1;
+  auto written = fwrite(&header, sizeof(header), 1, file) == 1 &&
+    fwrite(snapshots, sizeof(snapshots[0]), header.mNumSnapshots, file) == header.mNumSnapshots;
+  written = fclose(file) == 0 && written;
+  if(!written || rename(temporary.c_str(), path) != 0)
+  {
+    remove(temporary.c_str());
+    return -1;
+  }
+  return 0;
+}
+
+void CalibrationCache::Store(const nNISTC3::eepromHelper::tSnapshot &snapshot)
+{
+  // the board's old calibration goes, a new board pushes out the oldest one
+  auto slot{0u};
+  while(slot < mNumSnapshots && mSnapshots[slot].serialNumber != snapshot.serialNumber)
+  {
+    ++slot;
+  }
+  if(slot == CalibrationCacheLimit::kMaxBoards)
+  {
+    memmove(&mSnapshots[0], &mSnapshots[1], (slot - 1) * sizeof(mSnapshots[0]));
+    --slot;
+  }
+  mSnapshots[slot] = snapshot;
+  if(slot == mNumSnapshots)
+    ++mNumSnapshots;
+
+  Flush();
+  Header header{CalibrationCacheLimit::kMagic, CalibrationCacheLimit::kVersion,
+    sizeof(nNISTC3::eepromHelper::tSnapshot), mNumSnapshots,
+    Checksum(mSnapshots, mNumSnapshots * sizeof(mSnapshots[0]))};
+  std::vector<nNISTC3::eepromHelper::tSnapshot> snapshots(mSnapshots, mSnapshots + mNumSnapshots);
+  auto *path = mPath;
+  auto *name = mName;
+  mWriter = std::thread([path, name, header, snapshots]()
+  {
+    if(Write(path, header, snapshots.data()))
+      printf("%s: Could not write the calibration cache %s.\n", name, path);
+  });
+}
+
+std::unique_ptr<nNISTC3::eepromHelper> CalibrationCache::Open(tXSeries &device,
+  const nNISTC3::tDeviceInfo &deviceInfo)
+{
+  auto begin = std::chrono::steady_clock::now();
+  Flush();
+  Load();
+
+  nMDBG::tStatus2 status;
+  auto eeprom = std::make_unique<nNISTC3::eepromHelper>(device, deviceInfo.isSimultaneous,
+    deviceInfo.numberOfADCs, deviceInfo.numberOfDACs, mSnapshots, mNumSnapshots, status);
+  if(status.isFatal())
+  {
+    printf("%s: Cannot read the calibration (%d).\n", mName, status.statusCode);
+    return NULL;
+  }
+  mWarm = eeprom->isFromSnapshot();
+  if(!mWarm)
+  {
+    nNISTC3::eepromHelper::tSnapshot snapshot;
+    eeprom->getSnapshot(snapshot, status);
+    if(status.isNotFatal())
+      Store(snapshot);
+  }
+  mOpenUs = std::chrono::duration_cast<std::chrono::microseconds>(
+    std::chrono::steady_clock::now() - begin).count();
+  return eeprom;
+}
+
+void CalibrationCache::Flush()
+{
+  if(mWriter.joinable())
+    mWriter.join();
+}
+
+CalibrationCache::~CalibrationCache()
+{
+  Flush();
+}
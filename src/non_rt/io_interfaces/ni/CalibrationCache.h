@@ -0,0 +1,89 @@
+#ifndef _CALIBRATIONCACHE_H_
+#define _CALIBRATIONCACHE_H_
+
+#include <stdint.h>
+
+#include <memory>
+#include <thread>
+
+// Chip Objects
+#include "tXSeries.h"
+
+// Chip Object Helpers
+#include "devices.h"
+#include "eepromHelper.h"
+
+namespace CalibrationCacheLimit
+{
+constexpr auto kMaxBoards = 8u; // snapshots kept in one file, the oldest goes first
+constexpr uint32_t kMagic = 0x5343494e; // "NICS"
+constexpr uint32_t kVersion = 1;
+}
+
+/*
+ * eeprom calibration snapshots of the boards of this machine in one local binary file
+ *
+ * reading the calibration walks the eeprom byte by byte through the window, and most of
+ * it is the coefficients. Open() hands the snapshots of the file to the eeprom helper,
+ * which then reads only the serial number and the calibration dates and takes the
+ * coefficients from the snapshot of the same board and calibration. when none matches,
+ * after a new calibration or on a new board, the helper reads them in full and the file
+ * is rewritten in the background, so startup waits for the eeprom but not for the disk.
+ * a file with the wrong size, version or checksum is ignored and replaced.
+ */
+class CalibrationCache
+{
+private:
+  struct Header
+  {
+    uint32_t mMagic;
+    uint32_t mVersion;
+    uint32_t mSnapshotBytes; // sizeof(tSnapshot) of the build that wrote it
+    uint32_t mNumSnapshots;
+    uint32_t mChecksum; // fnv-1a of the snapshots
+  };
+
+  const char *mPath;
+  nNISTC3::eepromHelper::tSnapshot mSnapshots[CalibrationCacheLimit::kMaxBoards];
+  uint32_t mNumSnapshots;
+  std::thread mWriter;
+  bool mWarm;
+  unsigned long long mOpenUs;
+
+  int Load();
+  void Store(const nNISTC3::eepromHelper::tSnapshot &snapshot);
+  static int Write(const char *path, const Header header,
+    const nNISTC3::eepromHelper::tSnapshot *snapshots);
+  static uint32_t Checksum(const void *data, const uint32_t bytes);
+
+public:
+  const char *mName;
+
+public:
+  CalibrationCache() = delete;
+  CalibrationCache(const char *name, const char *path);
+
+  CalibrationCache(const CalibrationCache&) = delete;
+  CalibrationCache& operator=(const CalibrationCache&) = delete;
+
+  // the eeprom helper of device, from a snapshot when one matches, NULL when the eeprom
+  // can't be read
+  std::unique_ptr<nNISTC3::eepromHelper> Open(tXSeries &device,
+    const nNISTC3::tDeviceInfo &deviceInfo);
+
+  // whether the last Open() took the coefficients from the file, and how long it took
+  bool Warm() const
+  {
+    return mWarm;
+  }
+  unsigned long long OpenUs() const
+  {
+    return mOpenUs;
+  }
+  // waits for a background rewrite of the file
+  void Flush();
+
+  ~CalibrationCache();
+};
+
+#endif // _CALIBRATIONCACHE_H_
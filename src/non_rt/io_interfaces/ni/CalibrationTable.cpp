@@ -0,0 +1,67 @@
+#include <CalibrationTable.h>
+
+#include <stdio.h>
+
+int LoadAiScalingTable(const char *name, nNISTC3::eepromHelper &eeprom,
+  const std::vector<nNISTC3::aiHelper::tChannelConfiguration> &channelConfig,
+  const nNISTC3::tDeviceInfo &deviceInfo, AiScalingTable &table)
+{
+  if(channelConfig.empty() || channelConfig.size() > ScalingLimit::kMaxChannels)
+  {
+    printf("%s: %zu ai channels, 1 to %u supported.\n", name, channelConfig.size(),
+      ScalingLimit::kMaxChannels);
+    return -1;
+  }
+
+  table.mNumChannels = static_cast<unsigned int>(channelConfig.size());
+  for(auto m{0u}; m < table.mNumChannels; ++m)
+  {
+    nMDBG::tStatus2 status;
+    nNISTC3::tAIScalingCoefficients coefficients;
+    eeprom.getAIScalingCoefficients(deviceInfo.isSimultaneous ? m : 0,
+      channelConfig[m].range, coefficients, status);
+    if(status.isFatal())
+    {
+      printf("%s: No ai calibration for channel %u (%d).\n", name, channelConfig[m].channel,
+        status.statusCode);
+      return -1;
+    }
+    for(auto i{0u}; i < ScalingLimit::kAiCoefficients; ++i)
+    {
+      table.mCoefficients[m][i] = coefficients.c[i];
+    }
+  }
+  return 0;
+}
+
+int LoadAoScalingTable(const char *name, nNISTC3::eepromHelper &eeprom,
+  const std::vector<nNISTC3::aoHelper::tChannelConfiguration> &channelConfig,
+  AoScalingTable &table)
+{
+  if(channelConfig.empty() || channelConfig.size() > ScalingLimit::kMaxChannels)
+  {
+    printf("%s: %zu ao channels, 1 to %u supported.\n", name, channelConfig.size(),
+      ScalingLimit::kMaxChannels);
+    return -1;
+  }
+
+  table.mNumChannels = static_cast<unsigned int>(channelConfig.size());
+  for(auto m{0u}; m < table.mNumChannels; ++m)
+  {
+    nMDBG::tStatus2 status;
+    nNISTC3::tAOScalingCoefficients coefficients;
+    eeprom.getAOScalingCoefficients(channelConfig[m].channel, channelConfig[m].range,
+      coefficients, status);
+    if(status.isFatal())
+    {
+      printf("%s: No ao calibration for channel %u (%d).\n", name, channelConfig[m].channel,
+        status.statusCode);
+      return -1;
+    }
+    for(auto i{0u}; i < ScalingLimit::kAoCoefficients; ++i)
+    {
+      table.mCoefficients[m][i] = coefficients.c[i];
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,31 @@
+#ifndef _CALIBRATIONTABLE_H_
+#define _CALIBRATIONTABLE_H_
+
+#include <vector>
+
+// Chip Object Helpers
+#include "devices.h"
+#include "eepromHelper.h"
+#include "inTimer/aiHelper.h"
+#include "outTimer/aoHelper.h"
+
+#include <SampleScaling.h>
+
+/*
+ * scaling tables from the calibration in the device eeprom
+ *
+ * nAIDataHelper::scaleData() asks the eeprom helper for the coefficients of every single
+ * sample, these resolve them once per channel configuration. a simultaneous device has
+ * one adc per channel, the others scan all channels through adc 0. rebuild the table
+ * whenever the scan list or a range changes.
+ */
+
+// -1 when a channel has no valid calibration for its range or there are too many channels
+int LoadAiScalingTable(const char *name, nNISTC3::eepromHelper &eeprom,
+  const std::vector<nNISTC3::aiHelper::tChannelConfiguration> &channelConfig,
+  const nNISTC3::tDeviceInfo &deviceInfo, AiScalingTable &table);
+int LoadAoScalingTable(const char *name, nNISTC3::eepromHelper &eeprom,
+  const std::vector<nNISTC3::aoHelper::tChannelConfiguration> &channelConfig,
+  AoScalingTable &table);
+
+#endif // _CALIBRATIONTABLE_H_
@@ -0,0 +1,411 @@
+#include <DecimationFilter.h>
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <limits>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define DECIMATION_FILTER_AVX2 1
+#include <immintrin.h>
+#endif
+
+namespace {
+
+constexpr auto kPi = 3.141592653589793;
+constexpr auto kDesignPoints = 4096u; // frequency samples of the fir design
+constexpr auto kKaiserBeta = 6.; // about 63 dB of stopband
+// taps times the transition width of that window, as a fraction of the sample rate
+constexpr auto kKaiserTransition = 3.83;
+constexpr auto kIdle = std::numeric_limits<int64_t>::max(); // a lane without a filter
+
+// gain of an order cic decimating by decimation, at frequency as a fraction of its
+// output rate
+double CicResponse(const uint32_t order, const uint32_t decimation, const double frequency)
+{
+  const auto denominator = decimation * sin(kPi * frequency / decimation);
+  if(fabs(denominator) < 1e-12)
+    return 1.;
+  return pow(fabs(sin(kPi * frequency) / denominator), static_cast<double>(order));
+}
+
+// modified bessel function of the first kind, order 0
+double BesselI0(const double x)
+{
+  auto sum{1.};
+  auto term{1.};
+  for(auto k{1u}; k < 64 && term > 1e-12 * sum; ++k)
+  {
+    const auto half = x / (2. * k);
+    term *= half * half;
+    sum += term;
+  }
+  return sum;
+}
+
+// taps[n] multiplies the sample n steps back; the inverse cic response up to half the
+// output rate, where the window makes the transition
+void DesignCompensator(const DecimationConfig &config, float *taps)
+{
+  const auto numTaps = config.mFirTaps;
+  const auto cutoff = 0.5 / config.mFirDecimation;
+  const auto center = (numTaps - 1) / 2.;
+  double designed[DecimationLimit::kMaxFirTaps];
+  auto sum{0.};
+  for(auto n{0u}; n < numTaps; ++n)
+  {
+    auto tap{0.};
+    for(auto k{0u}; k < kDesignPoints; ++k)
+    {
+      const auto frequency = (k + 0.5) * 0.5 / kDesignPoints;
+      if(frequency >= cutoff)
+        break;
+      const auto desired = 1. / CicResponse(config.mCicOrder, config.mCicDecimation, frequency);
+      tap += desired * cos(2. * kPi * frequency * (n - center));
+    }
+    const auto ratio = center > 0. ? (n - center) / center : 0.;
+    designed[n] = tap * BesselI0(kKaiserBeta * sqrt(1. - ratio * ratio));
+    sum += designed[n];
+  }
+  // unity gain at dc, as the cic
+  for(auto n{0u}; n < numTaps; ++n)
+  {
+    taps[n] = static_cast<float>(designed[n] / sum);
+  }
+}
+
+float DotScalar(const float *taps, const float *window, const uint32_t length)
+{
+  float sums[16] = {};
+  for(auto i{0u}; i < length; i += 16)
+  {
+    for(auto k{0u}; k < 16; ++k)
+    {
+      sums[k] = sums[k] + taps[i + k] * window[i + k];
+    }
+  }
+  // as the avx2 kernel folds its two vectors: together, halves, then pairs
+  float half[8];
+  for(auto k{0u}; k < 8; ++k)
+  {
+    half[k] = sums[k] + sums[k + 8];
+  }
+  const float quarter[4] = {half[0] + half[4], half[1] + half[5], half[2] + half[6],
+    half[3] + half[7]};
+  return (quarter[0] + quarter[2]) + (quarter[1] + quarter[3]);
+}
+
+#ifdef DECIMATION_FILTER_AVX2
+__attribute__((target("avx2")))
+float DotAvx2(const float *taps, const float *window, const uint32_t length)
+{
+  // two sums, so that consecutive adds do not wait on each other
+  auto low = _mm256_setzero_ps();
+  auto high = _mm256_setzero_ps();
+  for(auto i{0u}; i < length; i += 16)
+  {
+    low = _mm256_add_ps(low, _mm256_mul_ps(_mm256_loadu_ps(taps + i),
+      _mm256_loadu_ps(window + i)));
+    high = _mm256_add_ps(high, _mm256_mul_ps(_mm256_loadu_ps(taps + i + 8),
+      _mm256_loadu_ps(window + i + 8)));
+  }
+  const auto sums = _mm256_add_ps(low, high);
+  const auto quarter = _mm_add_ps(_mm256_castps256_ps128(sums), _mm256_extractf128_ps(sums, 1));
+  const auto half = _mm_add_ps(quarter, _mm_movehl_ps(quarter, quarter));
+  return _mm_cvtss_f32(_mm_add_ss(half, _mm_shuffle_ps(half, half, 1)));
+}
+#endif
+
+bool DetectAvx2()
+{
+#ifdef DECIMATION_FILTER_AVX2
+  return __builtin_cpu_supports("avx2");
+#else
+  return false;
+#endif
+}
+
+} // namespace
+
+DecimationFilterBank::DecimationFilterBank(const char *name, const uint32_t numChannels,
+  const uint32_t numFilters, const DecimationConfig *configs)
+  : mNumChannels(numChannels)
+  , mNumFilters(numFilters)
+  , mNumGroups((numFilters + 3) / 4)
+  , mValid(false)
+  , mStages{}
+  , mIntegrators{}
+  , mCountdowns{}
+  , mOffsets{}
+  , mName(name)
+{
+  if(numChannels == 0 || numFilters == 0 || numFilters > DecimationLimit::kMaxFilters)
+  {
+    printf("%s: %u filters of %u channels, 1 to %u filters of at least one channel.\n",
+      mName, numFilters, numChannels, DecimationLimit::kMaxFilters);
+    return;
+  }
+  for(auto j{0u}; j < numFilters; ++j)
+  {
+    const auto &config = configs[j];
+    const auto bits = config.mCicDecimation > 1 ?
+      config.mCicOrder * ceil(log2(config.mCicDecimation)) : 0.;
+    if(config.mChannel >= numChannels || config.mCicOrder == 0 ||
+      config.mCicOrder > DecimationLimit::kMaxCicOrder || config.mCicDecimation == 0 ||
+      bits > DecimationLimit::kMaxCicBits)
+    {
+      printf("%s: Filter %u: channel %u of %u, cic order %u (1 to %u) decimating by %u, "
+        "at most %u bits of growth.\n", mName, j, config.mChannel, numChannels,
+        config.mCicOrder, DecimationLimit::kMaxCicOrder, config.mCicDecimation,
+        DecimationLimit::kMaxCicBits);
+      return;
+    }
+    if(config.mFirTaps > DecimationLimit::kMaxFirTaps || config.mFirDecimation == 0 ||
+      config.mFirDecimation > DecimationLimit::kMaxFirDecimation ||
+      (config.mFirTaps == 0 && config.mFirDecimation != 1) ||
+      (config.mFirTaps > 0 && !(config.mPassband > 0.f && config.mPassband < 0.5f)))
+    {
+      printf("%s: Filter %u: %u fir taps (at most %u) decimating by %u (1 to %u, 1 without "
+        "taps), passband %.3f of the output rate (below 0.5).\n", mName, j, config.mFirTaps,
+        DecimationLimit::kMaxFirTaps, config.mFirDecimation,
+        DecimationLimit::kMaxFirDecimation, config.mPassband);
+      return;
+    }
+    // the transition has to fit between the passband and its first alias
+    const auto transition = (1. - 2. * config.mPassband) / config.mFirDecimation;
+    if(config.mFirTaps > 0 && (config.mFirTaps - 1) * transition < kKaiserTransition)
+    {
+      printf("%s: Filter %u: %u fir taps decimating by %u are too few for a passband of "
+        "%.3f, %.0f at least.\n", mName, j, config.mFirTaps, config.mFirDecimation,
+        config.mPassband, ceil(kKaiserTransition / transition) + 1);
+      return;
+    }
+
+    auto &stage = mStages[j];
+    stage.mConfig = config;
+    stage.mCicScale = 1. / pow(static_cast<double>(config.mCicDecimation), config.mCicOrder);
+    stage.mFirLength = (config.mFirTaps + 15) & ~15u;
+    if(config.mFirTaps)
+    {
+      float taps[DecimationLimit::kMaxFirTaps];
+      DesignCompensator(config, taps);
+      const auto padding = stage.mFirLength - config.mFirTaps;
+      for(auto i{0u}; i < stage.mFirLength; ++i)
+      {
+        stage.mTaps[i] = (i < padding) ? 0.f : taps[stage.mFirLength - 1 - i];
+      }
+    }
+    mOffsets[j] = static_cast<int32_t>(config.mChannel);
+  }
+  mValid = true;
+  Reset();
+}
+
+void DecimationFilterBank::Reset()
+{
+  memset(mIntegrators, 0, sizeof(mIntegrators));
+  for(auto j{0u}; j < DecimationLimit::kMaxFilters; ++j)
+  {
+    auto &stage = mStages[j];
+    mCountdowns[j] = (j < mNumFilters) ? stage.mConfig.mCicDecimation : kIdle;
+    memset(stage.mCombs, 0, sizeof(stage.mCombs));
+    memset(stage.mHistory, 0, sizeof(stage.mHistory));
+    stage.mFirCountdown = stage.mConfig.mFirDecimation;
+    stage.mFirPosition = 0;
+  }
+}
+
+// the comb cascade of filter index on its last integrator, then the fir
+void DecimationFilterBank::Comb(const unsigned int index, float *const *outputs,
+  unsigned int *numOutputs, const bool useAvx2)
+{
+  auto &stage = mStages[index];
+  const auto &config = stage.mConfig;
+  mCountdowns[index] = config.mCicDecimation;
+  auto value = mIntegrators[config.mCicOrder - 1][index];
+  for(auto k{0u}; k < config.mCicOrder; ++k)
+  {
+    const auto input = value;
+    value -= stage.mCombs[k];
+    stage.mCombs[k] = input;
+  }
+  const auto code = static_cast<float>(static_cast<int64_t>(value) * stage.mCicScale);
+  if(stage.mFirLength == 0)
+  {
+    outputs[index][numOutputs[index]++] = code;
+    return;
+  }
+
+  const auto length = stage.mFirLength;
+  const auto position = (stage.mFirPosition + 1 < length) ? stage.mFirPosition + 1 : 0;
+  stage.mHistory[position] = stage.mHistory[position + length] = code;
+  stage.mFirPosition = position;
+  if(--stage.mFirCountdown)
+    return;
+  stage.mFirCountdown = config.mFirDecimation;
+  const auto *window = stage.mHistory + position + 1;
+#ifdef DECIMATION_FILTER_AVX2
+  outputs[index][numOutputs[index]++] = useAvx2 ? DotAvx2(stage.mTaps, window, length) :
+    DotScalar(stage.mTaps, window, length);
+#else
+  outputs[index][numOutputs[index]++] = DotScalar(stage.mTaps, window, length);
+#endif
+}
+
+void DecimationFilterBank::IntegrateScalar(const int16_t *raw, const unsigned int numScans,
+  float *const *outputs, unsigned int *numOutputs)
+{
+  for(auto j{0u}; j < mNumFilters; ++j)
+  {
+    const auto order = mStages[j].mConfig.mCicOrder;
+    const auto *sample = raw + mOffsets[j];
+    uint64_t integrators[DecimationLimit::kMaxCicOrder];
+    for(auto k{0u}; k < order; ++k)
+    {
+      integrators[k] = mIntegrators[k][j];
+    }
+    for(auto s{0u}; s < numScans; ++s, sample += mNumChannels)
+    {
+      integrators[0] += static_cast<uint64_t>(static_cast<int64_t>(*sample));
+      for(auto k{1u}; k < order; ++k)
+      {
+        integrators[k] += integrators[k - 1];
+      }
+      if(--mCountdowns[j])
+        continue;
+      mIntegrators[order - 1][j] = integrators[order - 1];
+      Comb(j, outputs, numOutputs, false);
+    }
+    for(auto k{0u}; k < order; ++k)
+    {
+      mIntegrators[k][j] = integrators[k];
+    }
+  }
+}
+
+#ifdef DECIMATION_FILTER_AVX2
+__attribute__((target("avx2")))
+void DecimationFilterBank::IntegrateAvx2(const int16_t *raw, const unsigned int numScans,
+  float *const *outputs, unsigned int *numOutputs)
+{
+  const auto one = _mm256_set1_epi64x(1);
+  const auto zero = _mm256_setzero_si256();
+  for(auto g{0u}; g < mNumGroups; ++g)
+  {
+    const auto first = 4 * g;
+    // every integrator of the highest order, so that they stay in registers; a filter of
+    // a lower order combs its own and never reads those above
+    constexpr auto order = DecimationLimit::kMaxCicOrder;
+    const auto offsets = _mm_load_si128(reinterpret_cast<const __m128i*>(mOffsets + first));
+    auto *countdowns = reinterpret_cast<__m256i*>(mCountdowns + first);
+    __m256i integrators[DecimationLimit::kMaxCicOrder];
+    for(auto k{0u}; k < order; ++k)
+    {
+      integrators[k] = _mm256_load_si256(reinterpret_cast<const __m256i*>(&mIntegrators[k][first]));
+    }
+    auto countdown = _mm256_load_si256(countdowns);
+    for(auto s{0u}; s < numScans; ++s)
+    {
+      const auto *scan = raw + s * mNumChannels;
+      __m128i words;
+      if(s + 1 < numScans)
+      {
+        words = _mm_i32gather_epi32(reinterpret_cast<const int*>(scan), offsets, 2);
+      }
+      else
+      {
+        // a 32 bit gather reads the sample after the last one too
+        words = _mm_setr_epi32(scan[mOffsets[first]], scan[mOffsets[first + 1]],
+          scan[mOffsets[first + 2]], scan[mOffsets[first + 3]]);
+      }
+      // sign extend the low half of every word
+      words = _mm_srai_epi32(_mm_slli_epi32(words, 16), 16);
+      integrators[0] = _mm256_add_epi64(integrators[0], _mm256_cvtepi32_epi64(words));
+      for(auto k{1u}; k < order; ++k)
+      {
+        integrators[k] = _mm256_add_epi64(integrators[k], integrators[k - 1]);
+      }
+      countdown = _mm256_sub_epi64(countdown, one);
+      auto due = _mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpeq_epi64(countdown, zero)));
+      if(!due)
+        continue;
+      for(auto k{0u}; k < order; ++k)
+      {
+        _mm256_store_si256(reinterpret_cast<__m256i*>(&mIntegrators[k][first]), integrators[k]);
+      }
+      _mm256_store_si256(countdowns, countdown);
+      for(; due; due &= due - 1)
+      {
+        Comb(first + __builtin_ctz(due), outputs, numOutputs, true);
+      }
+      countdown = _mm256_load_si256(countdowns);
+    }
+    for(auto k{0u}; k < order; ++k)
+    {
+      _mm256_store_si256(reinterpret_cast<__m256i*>(&mIntegrators[k][first]), integrators[k]);
+    }
+    _mm256_store_si256(countdowns, countdown);
+  }
+}
+#else
+void DecimationFilterBank::IntegrateAvx2(const int16_t *raw, const unsigned int numScans,
+  float *const *outputs, unsigned int *numOutputs)
+{
+  IntegrateScalar(raw, numScans, outputs, numOutputs);
+}
+#endif
+
+bool DecimationUsesAvx2()
+{
+  static const bool useAvx2 = DetectAvx2();
+  return useAvx2;
+}
+
+void DecimationFilterBank::Filter(const int16_t *raw, const unsigned int numScans,
+  float *const *outputs, unsigned int *numOutputs)
+{
+  memset(numOutputs, 0, mNumFilters * sizeof(*numOutputs));
+  if(!mValid)
+    return;
+  if(DecimationUsesAvx2())
+    IntegrateAvx2(raw, numScans, outputs, numOutputs);
+  else
+    IntegrateScalar(raw, numScans, outputs, numOutputs);
+}
+
+void DecimationFilterBank::FilterScalar(const int16_t *raw, const unsigned int numScans,
+  float *const *outputs, unsigned int *numOutputs)
+{
+  memset(numOutputs, 0, mNumFilters * sizeof(*numOutputs));
+  if(mValid)
+    IntegrateScalar(raw, numScans, outputs, numOutputs);
+}
+
+double DecimationFilterBank::Delay(const unsigned int filter) const
+{
+  const auto &config = mStages[filter].mConfig;
+  const auto cic = config.mCicOrder * (config.mCicDecimation - 1) / 2.;
+  const auto fir = config.mFirTaps ? (config.mFirTaps - 1) / 2. : 0.;
+  return cic + fir * config.mCicDecimation;
+}
+
+double DecimationFilterBank::Response(const unsigned int filter, const double frequency) const
+{
+  const auto &stage = mStages[filter];
+  const auto &config = stage.mConfig;
+  const auto cic = CicResponse(config.mCicOrder, config.mCicDecimation,
+    frequency * config.mCicDecimation);
+  if(config.mFirTaps == 0)
+    return cic;
+  auto real{0.};
+  auto imaginary{0.};
+  for(auto n{0u}; n < config.mFirTaps; ++n)
+  {
+    const auto tap = stage.mTaps[stage.mFirLength - 1 - n];
+    const auto phase = 2. * kPi * frequency * config.mCicDecimation * n;
+    real += tap * cos(phase);
+    imaginary -= tap * sin(phase);
+  }
+  return cic * sqrt(real * real + imaginary * imaginary);
+}
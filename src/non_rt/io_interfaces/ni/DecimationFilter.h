@@ -0,0 +1,118 @@
+#ifndef _DECIMATIONFILTER_H_
+#define _DECIMATIONFILTER_H_
+
+#include <stdint.h>
+
+namespace DecimationLimit
+{
+constexpr auto kMaxFilters = 16u; // of one bank, four per vector of integrators
+constexpr auto kMaxCicOrder = 6u;
+constexpr auto kMaxCicBits = 47u; // order * log2(decimation), 16 bit samples in 64 bits
+constexpr auto kMaxFirDecimation = 16u;
+constexpr auto kMaxFirTaps = 128u;
+}
+
+// one filter of a bank: a cic decimator, then a compensating fir decimator
+struct DecimationConfig
+{
+  uint32_t mChannel; // of the scans
+  uint32_t mCicOrder; // 1 with decimation 1 passes the samples through
+  uint32_t mCicDecimation;
+  uint32_t mFirDecimation;
+  uint32_t mFirTaps; // 0 for no fir, then its decimation is 1
+  // end of the flat band as a fraction of the output rate, the fir is at half gain at
+  // half of it; the wider, the more taps it takes to stop the aliases of the passband
+  float mPassband;
+};
+
+/*
+ * streaming multi-channel decimation of interleaved 16 bit scans
+ *
+ * every filter is a cic decimator of its own order and rate followed by a linear phase
+ * fir that flattens the cic droop over the passband and cuts everything that would
+ * alias onto it. the fir is designed at construction by sampling the inverse cic
+ * response up to half the output rate, windowed with kaiser. the cic integrators are
+ * exact 64 bit integers with wraparound, so only the comb output has to fit; they run
+ * for four filters at once with avx2, every scan, and a count down per filter finds the
+ * scans its comb runs on.
+ * the fir runs in polyphase form, only on the samples it keeps, as a dot product of
+ * sixteen partial sums; the portable kernels add in the same order, so both match bit
+ * for bit. the choice is made on the first call.
+ */
+class DecimationFilterBank
+{
+private:
+  struct Stage
+  {
+    DecimationConfig mConfig;
+    double mCicScale; // one over the cic gain
+    uint64_t mCombs[DecimationLimit::kMaxCicOrder]; // previous input of every comb
+    uint32_t mFirCountdown;
+    uint32_t mFirLength; // taps padded to a multiple of sixteen
+    uint32_t mFirPosition; // of the newest sample in the history
+    // reversed, the padding first, so a dot product with the window gives one output
+    float mTaps[DecimationLimit::kMaxFirTaps];
+    // every sample twice so that the window of the newest mFirLength is contiguous
+    float mHistory[2 * DecimationLimit::kMaxFirTaps];
+  };
+
+  uint32_t mNumChannels; // of the scans
+  uint32_t mNumFilters;
+  uint32_t mNumGroups; // of four filters, all integrated together
+  bool mValid;
+  Stage mStages[DecimationLimit::kMaxFilters];
+  // integrator k of filter j at [k][j], and the scans until filter j combs
+  alignas(32) uint64_t
+    mIntegrators[DecimationLimit::kMaxCicOrder][DecimationLimit::kMaxFilters];
+  alignas(32) int64_t mCountdowns[DecimationLimit::kMaxFilters];
+  alignas(32) int32_t mOffsets[DecimationLimit::kMaxFilters]; // of the channel in a scan
+
+  void Comb(const unsigned int index, float *const *outputs, unsigned int *numOutputs,
+    const bool useAvx2);
+  void IntegrateScalar(const int16_t *raw, const unsigned int numScans,
+    float *const *outputs, unsigned int *numOutputs);
+  void IntegrateAvx2(const int16_t *raw, const unsigned int numScans,
+    float *const *outputs, unsigned int *numOutputs);
+
+public:
+  const char *mName;
+
+public:
+  DecimationFilterBank() = delete;
+  // checks every config and designs its fir; the bank does nothing unless Valid()
+  DecimationFilterBank(const char *name, const uint32_t numChannels,
+    const uint32_t numFilters, const DecimationConfig *configs);
+
+  DecimationFilterBank(const DecimationFilterBank&) = delete;
+  DecimationFilterBank& operator=(const DecimationFilterBank&) = delete;
+
+  bool Valid() const
+  {
+    return mValid;
+  }
+  // clears every integrator, comb and fir history
+  void Reset();
+  // writes what filter j gives out of numScans scans to outputs[j], in raw codes, and
+  // their number to numOutputs[j]; outputs[j] must have room for
+  // numScans / Decimation(j) + 1 samples
+  void Filter(const int16_t *raw, const unsigned int numScans, float *const *outputs,
+    unsigned int *numOutputs);
+  // the portable kernels, for comparison
+  void FilterScalar(const int16_t *raw, const unsigned int numScans, float *const *outputs,
+    unsigned int *numOutputs);
+
+  uint32_t Decimation(const unsigned int filter) const
+  {
+    const auto &config = mStages[filter].mConfig;
+    return config.mCicDecimation * config.mFirDecimation;
+  }
+  // group delay in input samples
+  double Delay(const unsigned int filter) const;
+  // gain of filter j at frequency, as a fraction of the input rate
+  double Response(const unsigned int filter, const double frequency) const;
+};
+
+// true when the bank runs the avx2 kernels
+bool DecimationUsesAvx2();
+
+#endif // _DECIMATIONFILTER_H_
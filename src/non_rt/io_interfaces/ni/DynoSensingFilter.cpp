@@ -0,0 +1,176 @@
+#include <DynoSensingFilter.h>
+
+namespace {
+
+constexpr auto kTimebaseHz = 100e6;
+
+const char *const kFieldNames[] = {"torque", "voltage q", "voltage d", "current u",
+  "current v", "current w"};
+
+} // namespace
+
+DynoSensingFilter::DynoSensingFilter(const char *name, std::shared_ptr<NiDeviceService> service,
+  unsigned long long (*clock)(), const DynoSensingConfig &config)
+  : mService(service)
+  , mClock(clock)
+  , mConfig(config)
+  , mNumOutputs{}
+  , mSample{}
+  , mCounters{}
+  , mLastScans(0)
+  , mRunning(false)
+  , mName(name)
+{
+  for(auto j{0u}; j < DynoSensingLimit::kMaxChannels; ++j)
+  {
+    mOutputPointers[j] = mOutputs[j];
+  }
+}
+
+int DynoSensingFilter::Open()
+{
+  if(mConfig.mNumChannels == 0 || mConfig.mNumChannels > DynoSensingLimit::kMaxChannels ||
+    mConfig.mScanPeriodTicks < DynoSensingLimit::kMinScanPeriodTicks)
+  {
+    printf("%s: 1 to %u sensors scanned every %u ticks or more expected.\n", mName,
+      DynoSensingLimit::kMaxChannels, DynoSensingLimit::kMinScanPeriodTicks);
+    return -1;
+  }
+  auto fields{0u};
+  DecimationConfig filters[DynoSensingLimit::kMaxChannels];
+  for(auto j{0u}; j < mConfig.mNumChannels; ++j)
+  {
+    const auto &channel = mConfig.mChannels[j];
+    if(channel.mField < 0 || channel.mField >= kNumDynoSensingFields ||
+      (fields & (1u << channel.mField)))
+    {
+      printf("%s: Sensor %u: every MsgDynoSensing field takes one sensor at most.\n", mName, j);
+      return -1;
+    }
+    fields |= 1u << channel.mField;
+    filters[j] = channel.mFilter;
+  }
+  mBank = std::make_unique<DecimationFilterBank>(mName, mConfig.mNumAiChannels,
+    mConfig.mNumChannels, filters);
+  if(!mBank->Valid())
+    return -1;
+
+  if(mService->EnableAi(NiAiConfig{mConfig.mNumAiChannels, mConfig.mRange,
+    mConfig.mTerminalConfig, mConfig.mScanPeriodTicks}))
+    return -1;
+  if(mService->FrameBytes(nNISTC3::kAI_DMAChannel) != mConfig.mNumAiChannels * sizeof(int16_t))
+  {
+    printf("%s: The ai frames are not the %u channels scanned.\n", mName,
+      mConfig.mNumAiChannels);
+    return -1;
+  }
+  for(auto j{0u}; j < mConfig.mNumChannels; ++j)
+  {
+    const auto &channel = mConfig.mChannels[j];
+    printf("%s: %s on ai%u, %u by cic and %u by fir to %.0f S/s, %.1f us behind.\n", mName,
+      kFieldNames[channel.mField], channel.mFilter.mChannel, channel.mFilter.mCicDecimation,
+      channel.mFilter.mFirDecimation, OutputHz(j), DelayNs(j) * 1e-3);
+  }
+  return 0;
+}
+
+int DynoSensingFilter::Start()
+{
+  if(!mBank)
+    return -1;
+  mBank->Reset();
+  mSample = DynoSensingSample{};
+  if(mService->Start())
+    return -1;
+  mRunning = true;
+  return 0;
+}
+
+int DynoSensingFilter::Poll()
+{
+  if(!mRunning)
+    return -1;
+
+  const auto result = mService->Poll();
+  const auto beginNs = mClock();
+  const auto &scaling = mService->AiScaling();
+  const auto scanBytes = mConfig.mNumAiChannels * sizeof(int16_t);
+  auto &ring = mService->Ring(nNISTC3::kAI_DMAChannel);
+  auto updated{0u};
+  NiStreamBlock *block;
+  while((block = ring.Peek()) != NULL)
+  {
+    const auto numScans = block->mBytes / scanBytes;
+    mBank->Filter(reinterpret_cast<const int16_t*>(block->mData), numScans, mOutputPointers,
+      mNumOutputs);
+    for(auto j{0u}; j < mConfig.mNumChannels; ++j)
+    {
+      if(mNumOutputs[j] == 0)
+        continue;
+      // the calibration of the decimated code, as ScaleAi() would of every sample
+      const auto &channel = mConfig.mChannels[j];
+      const auto *c = scaling.mCoefficients[channel.mFilter.mChannel];
+      const auto code = mOutputs[j][mNumOutputs[j] - 1];
+      const auto volts = ((c[3] * code + c[2]) * code + c[1]) * code + c[0];
+      mSample.ft_Value[channel.mField] = volts * channel.mScale + channel.mOffset;
+      mSample.sampleNs[channel.mField] = block->mNs;
+      updated |= 1u << channel.mField;
+      mCounters.mValues[j] += mNumOutputs[j];
+    }
+    mCounters.mScans += numScans;
+    ring.Release();
+  }
+  if(updated)
+  {
+    ++mSample.sequence;
+    mSample.measured |= updated;
+    mLatest.Store(mSample);
+    ++mCounters.mPublished;
+  }
+
+  const auto filterNs = mClock() - beginNs;
+  mCounters.mFilterNs += filterNs;
+  if(filterNs > mCounters.mMaxFilterNs)
+    mCounters.mMaxFilterNs = filterNs;
+  ++mCounters.mPolls;
+  return result < 0 ? -1 : __builtin_popcount(updated);
+}
+
+void DynoSensingFilter::Stop()
+{
+  if(!mRunning)
+    return;
+  mService->Stop();
+  mRunning = false;
+}
+
+double DynoSensingFilter::DelayNs(const unsigned int channel) const
+{
+  return mBank ? mBank->Delay(channel) * mConfig.mScanPeriodTicks * 1e9 / kTimebaseHz : 0.;
+}
+
+double DynoSensingFilter::OutputHz(const unsigned int channel) const
+{
+  return mBank ? kTimebaseHz / mConfig.mScanPeriodTicks / mBank->Decimation(channel) : 0.;
+}
+
+void DynoSensingFilter::PrintStats(const unsigned long long elapsedNs,
+  int (*print)(const char*, ...))
+{
+  print("%s: scans/s: %.0f, polls/s: %.0f, published: %llu, filter avg %.2f us, max %.2f us\n",
+    mName, elapsedNs ? (mCounters.mScans - mLastScans) * 1e9 / elapsedNs : 0.,
+    elapsedNs ? mCounters.mPolls * 1e9 / elapsedNs : 0., mCounters.mPublished,
+    mCounters.mPolls ? mCounters.mFilterNs * 1e-3 / mCounters.mPolls : 0.,
+    mCounters.mMaxFilterNs * 1e-3);
+  for(auto j{0u}; j < mConfig.mNumChannels; ++j)
+  {
+    const auto field = mConfig.mChannels[j].mField;
+    print("%s: %s %.4f, %llu values\n", mName, kFieldNames[field], mSample.ft_Value[field],
+      mCounters.mValues[j]);
+  }
+  mLastScans = mCounters.mScans;
+  mCounters.mPolls = 0;
+  mCounters.mFilterNs = 0;
+  mCounters.mMaxFilterNs = 0;
+  mService->PrintStats(elapsedNs, print);
+}
@@ -0,0 +1,109 @@
+#ifndef _DYNOSENSINGFILTER_H_
+#define _DYNOSENSINGFILTER_H_
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include <memory>
+
+#include <DecimationFilter.h>
+#include <MessageTypes.h>
+#include <NiDeviceService.h>
+#include <RtLatestValue.h>
+
+namespace DynoSensingLimit
+{
+constexpr auto kMaxChannels = static_cast<unsigned int>(kNumDynoSensingFields);
+constexpr auto kMinScanPeriodTicks = 50u; // 2 MS/s, a simultaneous device
+// of one filter out of one ring block: every scan of a single channel
+constexpr auto kMaxBlockOutputs = NiServiceLimit::kBlockBytes / sizeof(int16_t) + 1;
+}
+
+// one sensor: an ai channel, its decimation and its units
+struct DynoSensingChannel
+{
+  DynoSensingField mField;
+  float mScale; // field units per volt
+  float mOffset; // field units at 0 V
+  DecimationConfig mFilter; // mChannel is the ai channel
+};
+
+struct DynoSensingConfig
+{
+  uint32_t mNumAiChannels; // ai0 on, scanned together
+  nNISTC3::tInputRange mRange;
+  nAI::tAI_Config_Channel_Type_t mTerminalConfig;
+  // a mio device converts one channel every 400 ticks and stretches shorter scans
+  uint32_t mScanPeriodTicks;
+  uint32_t mNumChannels;
+  DynoSensingChannel mChannels[DynoSensingLimit::kMaxChannels];
+};
+
+struct DynoSensingCounters
+{
+  unsigned long long mScans;
+  unsigned long long mValues[DynoSensingLimit::kMaxChannels];
+  unsigned long long mPublished;
+  // since the last PrintStats()
+  unsigned long long mPolls;
+  unsigned long long mFilterNs;
+  unsigned long long mMaxFilterNs;
+};
+
+/*
+ * oversampled dyno current, voltage and torque sensors into the model's MsgDynoSensing
+ *
+ * the ai of an ni device service scans the sensors far faster than the model steps.
+ * Poll() runs every ring block through a decimation filter bank, one cic and
+ * compensating fir per sensor, each at its own rate, so a 10 us current and a 1 ms
+ * torque can come from the same scans. the calibration polynomial of the channel then
+ * applies to the decimated codes only, and the newest value of every sensor goes out
+ * through mLatest, which the model step reads without waiting.
+ */
+class DynoSensingFilter
+{
+private:
+  std::shared_ptr<NiDeviceService> mService;
+  unsigned long long (*mClock)();
+  const DynoSensingConfig mConfig;
+  std::unique_ptr<DecimationFilterBank> mBank;
+  float mOutputs[DynoSensingLimit::kMaxChannels][DynoSensingLimit::kMaxBlockOutputs];
+  float *mOutputPointers[DynoSensingLimit::kMaxChannels];
+  unsigned int mNumOutputs[DynoSensingLimit::kMaxChannels];
+  DynoSensingSample mSample;
+  DynoSensingCounters mCounters;
+  unsigned long long mLastScans; // at the last PrintStats()
+  bool mRunning;
+
+public:
+  const char *mName;
+  RtLatestValue<DynoSensingSample> mLatest;
+
+public:
+  DynoSensingFilter() = delete;
+  DynoSensingFilter(const char *name, std::shared_ptr<NiDeviceService> service,
+    unsigned long long (*clock)(), const DynoSensingConfig &config);
+
+  DynoSensingFilter(const DynoSensingFilter&) = delete;
+  DynoSensingFilter& operator=(const DynoSensingFilter&) = delete;
+
+  // designs the filters, then enables ai on an opened service
+  int Open();
+  // clears the filters, then starts the service
+  int Start();
+  // polls the service and filters what ai scanned, returns the sensors that got a new
+  // value or -1 when a channel failed
+  int Poll();
+  void Stop();
+
+  // group delay of sensor channel in ns
+  double DelayNs(const unsigned int channel) const;
+  double OutputHz(const unsigned int channel) const;
+  const DynoSensingCounters& Counters() const
+  {
+    return mCounters;
+  }
+  void PrintStats(const unsigned long long elapsedNs, int (*print)(const char*, ...)=printf);
+};
+
+#endif // _DYNOSENSINGFILTER_H_
@@ -0,0 +1,296 @@
+#include <EncoderMeasurement.h>
+
+#include <math.h>
+
+#include <algorithm>
+
+namespace {
+
+constexpr auto kTwoPi = 6.283185307179586;
+constexpr auto kSecondsPerMinute = 60.;
+
+} // namespace
+
+EncoderMeasurement::EncoderMeasurement(const char *name, std::shared_ptr<NiDeviceService> service,
+  unsigned long long (*clock)(), const EncoderConfig &config)
+  : mService(service)
+  , mClock(clock)
+  , mConfig(config)
+  , mChannels{}
+  , mHistory{}
+  , mPosition(0)
+  , mAnchorNs(0)
+  , mWindowSlackNs(~0ull)
+  , mWindowEdges(0)
+  , mLastPollNs(0)
+  , mSample{}
+  , mCounters{}
+  , mLastPublished(0)
+  , mRunning(false)
+  , mName(name)
+{}
+
+int EncoderMeasurement::Open()
+{
+  if(mConfig.mCounter % 2 != 0 || mConfig.mCounter + 1 >= NiServiceLimit::kNumCounters)
+  {
+    printf("%s: Counter %u is not the first of a pair.\n", mName, mConfig.mCounter);
+    return -1;
+  }
+  if(mConfig.mLinesPerRevolution == 0 || mConfig.mStallNs == 0 ||
+    mConfig.mWindowEdges < EncoderLimit::kCountsPerLine ||
+    mConfig.mWindowEdges > EncoderLimit::kMaxWindowEdges ||
+    mConfig.mWindowEdges % EncoderLimit::kCountsPerLine != 0)
+  {
+    printf("%s: Lines, a stall time and a window of 4 to %u edges in fours expected.\n", mName,
+      EncoderLimit::kMaxWindowEdges);
+    return -1;
+  }
+  if(mService->EnableCounter(mConfig.mCounter, mConfig.mGateA, mConfig.mFilter) ||
+    mService->EnableCounter(mConfig.mCounter + 1, mConfig.mGateB, mConfig.mFilter))
+    return -1;
+  for(auto line{0u}; line < 2; ++line)
+  {
+    mChannels[line].mRing = &mService->Ring(static_cast<nNISTC3::tDMAChannelNumber>(
+      nNISTC3::kCounter0DmaChannel + mConfig.mCounter + line));
+  }
+  printf("%s: %u lines on ctr%u and ctr%u, speed of up to %u edges within %.1f ms, 0 after "
+    "%.1f ms.\n", mName, mConfig.mLinesPerRevolution, mConfig.mCounter, mConfig.mCounter + 1,
+    mConfig.mWindowEdges, mConfig.mWindowNs * 1e-6, mConfig.mStallNs * 1e-6);
+  return 0;
+}
+
+int EncoderMeasurement::Start()
+{
+  if(mChannels[0].mRing == NULL)
+    return -1;
+  if(mService->Start())
+    return -1;
+  // both counters of the pair were armed at once
+  const auto &arm = mService->CounterArm(mConfig.mCounter);
+  for(auto line{0u}; line < 2; ++line)
+  {
+    auto &channel = mChannels[line];
+    channel.mBlock = NULL;
+    channel.mIndex = 0;
+    channel.mTicks = 0;
+    channel.mLevel = mService->CounterArm(mConfig.mCounter + line).mGateHigh;
+  }
+  mPosition = 0;
+  mAnchorNs = arm.mNs;
+  mWindowSlackNs = ~0ull;
+  mWindowEdges = 0;
+  mLastPollNs = arm.mNs;
+  mSample = DynoSpeedSample{};
+  mCounters = EncoderCounters{};
+  mLastPublished = 0;
+  mRunning = true;
+  return 0;
+}
+
+// the next semi-period of a line, releasing the blocks it decoded
+const uint32_t *EncoderMeasurement::NextSemiPeriod(Channel &channel)
+{
+  for(;;)
+  {
+    if(channel.mBlock == NULL)
+    {
+      channel.mBlock = channel.mRing->Peek();
+      channel.mIndex = 0;
+      if(channel.mBlock == NULL)
+        return NULL;
+    }
+    if(channel.mIndex < channel.mBlock->mBytes / sizeof(uint32_t))
+      return reinterpret_cast<const uint32_t*>(channel.mBlock->mData) + channel.mIndex;
+    channel.mRing->Release();
+    channel.mBlock = NULL;
+  }
+}
+
+void EncoderMeasurement::Decode(const unsigned int line, const uint32_t ticks,
+  const unsigned long long readNs)
+{
+  auto &channel = mChannels[line];
+  channel.mTicks += ticks;
+  channel.mLevel = !channel.mLevel;
+  const auto other = mChannels[line ^ 1].mLevel;
+  const auto aLeads = line == 0 ? channel.mLevel != other : channel.mLevel == other;
+  if(aLeads != mConfig.mReverse)
+  {
+    ++mPosition;
+    ++mCounters.mForward;
+  }
+  else
+  {
+    --mPosition;
+    ++mCounters.mBackward;
+  }
+  mHistory[mCounters.mEdges++ & (EncoderLimit::kHistoryEdges - 1)] =
+    Edge{channel.mTicks, mPosition};
+
+  // the anchor follows the reads, as in PwmDutyDecoder::Add()
+  const auto edgeNs = EdgeNs(channel.mTicks);
+  if(edgeNs > readNs)
+  {
+    mAnchorNs -= edgeNs - readNs;
+    mWindowSlackNs = 0;
+    ++mCounters.mClockCorrections;
+  }
+  else if(readNs - edgeNs < mWindowSlackNs)
+  {
+    mWindowSlackNs = readNs - edgeNs;
+  }
+  if(++mWindowEdges == EncoderLimit::kAnchorWindow)
+  {
+    if(mWindowSlackNs > 0)
+    {
+      mAnchorNs += mWindowSlackNs;
+      ++mCounters.mClockCorrections;
+    }
+    mWindowSlackNs = ~0ull;
+    mWindowEdges = 0;
+  }
+}
+
+double EncoderMeasurement::CountsPerSecond(const bool waiting) const
+{
+  if(mCounters.mEdges <= EncoderLimit::kCountsPerLine)
+    return 0.;
+  // the most whole cycles within both windows, by bisection over the edge ticks
+  const auto &newest = History(0);
+  const auto windowTicks = mConfig.mWindowNs / EncoderLimit::kNanosecondsPerTick;
+  auto cycles{1u};
+  auto most = static_cast<unsigned int>(std::min<unsigned long long>(mCounters.mEdges - 1,
+    mConfig.mWindowEdges)) / EncoderLimit::kCountsPerLine;
+  while(cycles < most)
+  {
+    const auto middle = (cycles + most + 1) / 2;
+    if(newest.mTicks - History(middle * EncoderLimit::kCountsPerLine).mTicks <= windowTicks)
+      cycles = middle;
+    else
+      most = middle - 1;
+  }
+  const auto &oldest = History(cycles * EncoderLimit::kCountsPerLine);
+  if(newest.mTicks == oldest.mTicks)
+    return 0.;
+  const auto countsPerSecond = (newest.mPosition - oldest.mPosition) *
+    static_cast<double>(EncoderLimit::kTimebaseHz) / (newest.mTicks - oldest.mTicks);
+
+  // no edge from the newest up to the previous poll bounds the speed, unless one waits;
+  // only a speed that at least halved shows, the edge times are not exact enough for less
+  const auto edgeNs = EdgeNs(newest.mTicks);
+  if(waiting || mLastPollNs <= edgeNs)
+    return countsPerSecond;
+  const auto quietNs = mLastPollNs - edgeNs;
+  if(quietNs >= mConfig.mStallNs)
+    return 0.;
+  const auto bound = 1e9 / quietNs;
+  return fabs(countsPerSecond) > 2. * bound ? copysign(bound, countsPerSecond) :
+    countsPerSecond;
+}
+
+int EncoderMeasurement::Poll()
+{
+  if(!mRunning)
+    return -1;
+
+  // blocks of this poll are stamped at or after pollNs
+  const auto pollNs = mClock();
+  const auto result = mService->Poll();
+  const auto beginNs = mClock();
+  const auto edges = mCounters.mEdges;
+  auto waiting{false};
+  for(;;)
+  {
+    const uint32_t *next[] = {NextSemiPeriod(mChannels[0]), NextSemiPeriod(mChannels[1])};
+    unsigned int line;
+    if(next[0] != NULL && next[1] != NULL)
+    {
+      line = mChannels[0].mTicks + *next[0] <= mChannels[1].mTicks + *next[1] ? 0 : 1;
+    }
+    else if(next[0] != NULL || next[1] != NULL)
+    {
+      // an edge of the other line this poll missed may still come before it
+      line = next[0] != NULL ? 0 : 1;
+      waiting = mChannels[line].mBlock->mNs >= pollNs;
+      if(waiting)
+        break;
+    }
+    else
+    {
+      break;
+    }
+    Decode(line, *next[line], mChannels[line].mBlock->mNs);
+    ++mChannels[line].mIndex;
+  }
+
+  const auto decoded = mCounters.mEdges != edges;
+  const auto countsPerRevolution =
+    static_cast<long long>(EncoderLimit::kCountsPerLine * mConfig.mLinesPerRevolution);
+  const auto rpm = static_cast<float>(CountsPerSecond(waiting) * kSecondsPerMinute /
+    countsPerRevolution);
+  auto published{0};
+  if(decoded || rpm != mSample.ft_DynoRPM)
+  {
+    auto count = mPosition % countsPerRevolution;
+    if(count < 0)
+      count += countsPerRevolution;
+    mSample.ft_DynoRPM = rpm;
+    mSample.ft_AngleRad = static_cast<float>(kTwoPi * count / countsPerRevolution);
+    mSample.position = mPosition;
+    if(decoded)
+      mSample.edgeNs = EdgeNs(History(0).mTicks);
+    ++mSample.sequence;
+    mLatest.Store(mSample);
+    ++mCounters.mPublished;
+    published = 1;
+    if(decoded)
+    {
+      const auto publishedNs = mClock();
+      const auto latencyNs = publishedNs > mSample.edgeNs ? publishedNs - mSample.edgeNs : 0;
+      mCounters.mLatencyNs += latencyNs;
+      if(latencyNs > mCounters.mMaxLatencyNs)
+        mCounters.mMaxLatencyNs = latencyNs;
+      ++mCounters.mLatencies;
+    }
+  }
+  mLastPollNs = pollNs;
+
+  const auto decodeNs = mClock() - beginNs;
+  mCounters.mDecodeNs += decodeNs;
+  if(decodeNs > mCounters.mMaxDecodeNs)
+    mCounters.mMaxDecodeNs = decodeNs;
+  ++mCounters.mPolls;
+  return result < 0 ? -1 : published;
+}
+
+void EncoderMeasurement::Stop()
+{
+  if(!mRunning)
+    return;
+  mService->Stop();
+  mRunning = false;
+}
+
+void EncoderMeasurement::PrintStats(const unsigned long long elapsedNs,
+  int (*print)(const char*, ...))
+{
+  print("%s: rpm %.2f, angle %.4f rad, edges: %llu (%llu up, %llu down), updates/s: %.0f, "
+    "latency avg %.1f us, max %.1f us\n", mName, mSample.ft_DynoRPM, mSample.ft_AngleRad,
+    mCounters.mEdges, mCounters.mForward, mCounters.mBackward,
+    elapsedNs ? (mCounters.mPublished - mLastPublished) * 1e9 / elapsedNs : 0.,
+    mCounters.mLatencies ? mCounters.mLatencyNs * 1e-3 / mCounters.mLatencies : 0.,
+    mCounters.mMaxLatencyNs * 1e-3);
+  print("%s: polls/s: %.0f, decode avg %.2f us, max %.2f us, clock corrections: %llu\n", mName,
+    elapsedNs ? mCounters.mPolls * 1e9 / elapsedNs : 0.,
+    mCounters.mPolls ? mCounters.mDecodeNs * 1e-3 / mCounters.mPolls : 0.,
+    mCounters.mMaxDecodeNs * 1e-3, mCounters.mClockCorrections);
+  mLastPublished = mCounters.mPublished;
+  mCounters.mPolls = 0;
+  mCounters.mDecodeNs = 0;
+  mCounters.mMaxDecodeNs = 0;
+  mCounters.mLatencies = 0;
+  mCounters.mLatencyNs = 0;
+  mCounters.mMaxLatencyNs = 0;
+  mService->PrintStats(elapsedNs, print);
+}
@@ -0,0 +1,145 @@
+#ifndef _ENCODERMEASUREMENT_H_
+#define _ENCODERMEASUREMENT_H_
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include <memory>
+
+#include <MessageTypes.h>
+#include <NiDeviceService.h>
+#include <RtLatestValue.h>
+
+namespace EncoderLimit
+{
+constexpr auto kTimebaseHz = 100000000ull; // counter timebase 3
+constexpr auto kNanosecondsPerTick = 1000000000ull / kTimebaseHz;
+constexpr auto kCountsPerLine = 4u; // x4, every edge of a and b
+constexpr auto kMaxWindowEdges = 1024u;
+constexpr auto kHistoryEdges = 2 * kMaxWindowEdges; // a power of 2
+constexpr auto kAnchorWindow = 256u; // edges between forward anchor corrections
+}
+
+struct EncoderConfig
+{
+  unsigned int mCounter; // 0 or 2, counts a; its paired counter counts b
+  nCounter::tGi_Gate_Select_t mGateA;
+  nCounter::tGi_Gate_Select_t mGateB;
+  nTriggers::tTrig_Filter_Select_t mFilter; // of both pfi lines
+  uint32_t mLinesPerRevolution;
+  // the speed averages the newest whole cycles, at most this many edges, a multiple of 4,
+  uint32_t mWindowEdges;
+  // and none older than this, though always one cycle
+  unsigned long long mWindowNs;
+  unsigned long long mStallNs; // without an edge the speed is 0
+  bool mReverse; // counts down when a leads b
+};
+
+struct EncoderCounters
+{
+  unsigned long long mEdges;
+  unsigned long long mForward; // counted up
+  unsigned long long mBackward;
+  unsigned long long mPublished;
+  unsigned long long mClockCorrections;
+  // since the last PrintStats()
+  unsigned long long mPolls;
+  unsigned long long mDecodeNs;
+  unsigned long long mMaxDecodeNs;
+  unsigned long long mLatencies; // newest edge to its publication
+  unsigned long long mLatencyNs;
+  unsigned long long mMaxLatencyNs;
+};
+
+/*
+ * dyno shaft speed and angle from a quadrature encoder into the model's MsgDynoCmd
+ *
+ * a and b each gate one counter of a pair of an ni device service, measuring semi-periods
+ * into dma as PwmCapture does, with the pfi digital filter of gpctex4 against ringing.
+ * the pair is armed with one command, so the sums of the semi-periods of both place
+ * every edge on one tick timeline. Poll() merges the two edge streams in place from the
+ * rings, earliest first, and decodes each edge x4: a level change of a counts up when a
+ * then differs from b, one of b when b then equals a. an edge waits in its block until
+ * the other line has a later one or one poll went by, so a late dma transfer of the
+ * other line cannot reorder them. the speed is the net count of the newest whole cycles
+ * within both windows over their ticks, from the edge history, so the cost of a poll
+ * does not grow with the window. once the previous poll saw no edge for two counts of
+ * that speed, it falls to one count over that time, and to 0 after mStallNs. edge ticks
+ * follow the host clock as in PwmDutyDecoder, and the newest speed, angle and edge time
+ * go out through mLatest.
+ */
+class EncoderMeasurement
+{
+private:
+  struct Channel
+  {
+    NiStreamRing *mRing;
+    NiStreamBlock *mBlock; // peeked, partly decoded
+    uint32_t mIndex; // of the next semi-period in mBlock
+    unsigned long long mTicks; // of its latest edge since the arm
+    bool mLevel;
+  };
+
+  struct Edge
+  {
+    unsigned long long mTicks;
+    long long mPosition;
+  };
+
+  std::shared_ptr<NiDeviceService> mService;
+  unsigned long long (*mClock)();
+  const EncoderConfig mConfig;
+  Channel mChannels[2]; // a, b
+  Edge mHistory[EncoderLimit::kHistoryEdges]; // by mCounters.mEdges
+  long long mPosition;
+  unsigned long long mAnchorNs;
+  unsigned long long mWindowSlackNs;
+  unsigned int mWindowEdges;
+  unsigned long long mLastPollNs;
+  DynoSpeedSample mSample;
+  EncoderCounters mCounters;
+  unsigned long long mLastPublished; // at the last PrintStats()
+  bool mRunning;
+
+  const uint32_t *NextSemiPeriod(Channel &channel);
+  void Decode(const unsigned int line, const uint32_t ticks, const unsigned long long readNs);
+  double CountsPerSecond(const bool waiting) const;
+  // ago edges before the newest
+  const Edge& History(const unsigned int ago) const
+  {
+    return mHistory[(mCounters.mEdges - 1 - ago) & (EncoderLimit::kHistoryEdges - 1)];
+  }
+  unsigned long long EdgeNs(const unsigned long long ticks) const
+  {
+    return mAnchorNs + ticks * EncoderLimit::kNanosecondsPerTick;
+  }
+
+public:
+  const char *mName;
+  RtLatestValue<DynoSpeedSample> mLatest;
+
+public:
+  EncoderMeasurement() = delete;
+  EncoderMeasurement(const char *name, std::shared_ptr<NiDeviceService> service,
+    unsigned long long (*clock)(), const EncoderConfig &config);
+
+  EncoderMeasurement(const EncoderMeasurement&) = delete;
+  EncoderMeasurement& operator=(const EncoderMeasurement&) = delete;
+
+  // enables the counter pair on an opened service
+  int Open();
+  // starts the service, then the timeline from the arm of the pair
+  int Start();
+  // polls the service and decodes the edges of both lines, returns 1 when a new value
+  // went out, 0 when none or -1 when a channel failed
+  int Poll();
+  void Stop();
+
+  const EncoderCounters& Counters() const
+  {
+    return mCounters;
+  }
+  void PrintStats(const unsigned long long elapsedNs, int (*print)(const char*, ...)=printf);
+};
+
+#endif // _ENCODERMEASUREMENT_H_
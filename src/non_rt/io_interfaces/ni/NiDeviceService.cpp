@@ -0,0 +1,965 @@
+#include <NiDeviceService.h>
+
+#include <string.h>
+
+#include <vector>
+
+#include "simultaneousInit.h"
+
+#include <PwmCapture.h>
+
+namespace {
+
+constexpr auto kDelayTicks = 2u; // tb3 ticks from the start trigger to the first clock
+constexpr auto kConvertPeriodTicks = 400u; // 250 kHz ai convert clock on mio devices
+constexpr auto kTimeoutNs = 5000000000ull;
+
+// the frames of a dma span, which wraps at most once, from or to ring blocks
+void CopyFromSpan(const nNISTC3::tDMASpan &span, const uint32_t offset, uint8_t *data,
+  const uint32_t bytes)
+{
+  if(offset >= span.size[0])
+  {
+    memcpy(data, span.data[1] + (offset - span.size[0]), bytes);
+    return;
+  }
+  const auto first = bytes < span.size[0] - offset ? bytes : span.size[0] - offset;
+  memcpy(data, span.data[0] + offset, first);
+  if(bytes > first)
+    memcpy(data + first, span.data[1], bytes - first);
+}
+
+void CopyToSpan(const nNISTC3::tDMASpan &span, const uint32_t offset, const uint8_t *data,
+  const uint32_t bytes)
+{
+  if(offset >= span.size[0])
+  {
+    memcpy(span.data[1] + (offset - span.size[0]), data, bytes);
+    return;
+  }
+  const auto first = bytes < span.size[0] - offset ? bytes : span.size[0] - offset;
+  memcpy(span.data[0] + offset, data, first);
+  if(bytes > first)
+    memcpy(span.data[1], data + first, bytes - first);
+}
+
+const char *ChannelName(const unsigned int dmaChannel)
+{
+  static const char *names[] = {"ai", "ctr0", "ctr1", "ctr2", "ctr3", "di", "ao", "do"};
+  return names[dmaChannel];
+}
+
+constexpr auto kPfiFiltersPerRegister = 4u;
+constexpr auto kPfiFilterBits = 4u;
+constexpr auto kPfiFilterMask = 0x7u;
+
+// the pfi line of a gate, -1 for the internal ones
+int PfiOfGate(const nCounter::tGi_Gate_Select_t gate)
+{
+  if(gate >= nCounter::kGate_PFI0 && gate <= nCounter::kGate_PFI9)
+    return gate - nCounter::kGate_PFI0;
+  if(gate >= nCounter::kGate_PFI10 && gate <= nCounter::kGate_PFI15)
+    return 10 + gate - nCounter::kGate_PFI10;
+  return -1;
+}
+
+template <typename tFilterRegister>
+void SetPfiFilter(tFilterRegister &filterRegister, const unsigned int field,
+  const nTriggers::tTrig_Filter_Select_t filter, nMDBG::tStatus2 &status)
+{
+  const auto shift = kPfiFilterBits * field;
+  filterRegister.setRegister(static_cast<u16>((filterRegister.getRegister() &
+    ~(kPfiFilterMask << shift)) | (static_cast<u32>(filter) << shift)), &status);
+  filterRegister.flush(&status);
+}
+
+} // namespace
+
+NiDeviceService::NiDeviceService(const char *name, iBus *bus, unsigned long long (*clock)())
+  : mBus(bus)
+  , mDeviceInfo(NULL)
+  , mAiScaling{}
+  , mAoScaling{}
+  , mSync{}
+  , mAiSamplePeriodTicks(0)
+  , mDiLineMask(0)
+  , mDoLineMask(0)
+  , mClock(clock)
+  , mRunning(false)
+  , mName(name)
+{
+  for(auto &counter : mCounters)
+  {
+    counter = NULL;
+  }
+  for(auto &arm : mCounterArms)
+  {
+    arm = NiCounterArm{0, false};
+  }
+  for(auto &channel : mChannels)
+  {
+    channel.mEnabled = false;
+    channel.mIsInput = false;
+    channel.mFailed = false;
+    channel.mStarved = false;
+    channel.mFrameBytes = 0;
+    channel.mBlockBytes = 0;
+    channel.mDmaBytes = 0;
+    channel.mCounters = NiStreamCounters{};
+    channel.mLastCounters = NiStreamCounters{};
+  }
+}
+
+int NiDeviceService::Open(const char *calibrationCache)
+{
+  nMDBG::tStatus2 status;
+  const auto beginNs = mClock();
+  mBar0 = mBus->createAddressSpace(kPCI_BAR0);
+  mDevice = std::make_unique<tXSeries>(mBar0, &status);
+
+  mDeviceInfo = nNISTC3::getDeviceInfo(*mDevice, status);
+  if(status.isFatal())
+  {
+    printf("%s: Cannot identify device (%d).\n", mName, status.statusCode);
+    return -1;
+  }
+  // also opens the eeprom window of a simultaneous device
+  if(mDeviceInfo->isSimultaneous)
+    nNISTC3::initializeSimultaneousXSeries(*mDevice, status);
+
+  if(calibrationCache)
+  {
+    mCalibrationCache = std::make_unique<CalibrationCache>(mName, calibrationCache);
+    mEeprom = mCalibrationCache->Open(*mDevice, *mDeviceInfo);
+  }
+  else
+  {
+    mEeprom = std::make_unique<nNISTC3::eepromHelper>(*mDevice, mDeviceInfo->isSimultaneous,
+      mDeviceInfo->numberOfADCs, mDeviceInfo->numberOfDACs, status);
+    if(status.isFatal())
+      mEeprom.reset();
+  }
+  if(!mEeprom)
+  {
+    printf("%s: Cannot read the calibration (%d).\n", mName, status.statusCode);
+    return -1;
+  }
+
+  mCounters[0] = &mDevice->Counter0;
+  mCounters[1] = &mDevice->Counter1;
+  mCounters[2] = &mDevice->Counter2;
+  mCounters[3] = &mDevice->Counter3;
+  // the rings and their links come from one mapped and locked pool, reopening reuses it
+  if(mBus->getDMAPool() == NULL && mBus->reserveDMA(NiServiceLimit::kDmaPoolBytes))
+    printf("%s: No DMA pool, the rings come from the driver one by one.\n", mName);
+
+  // correlated di and do share the port 0 line configuration, tristated on exit
+  mDioHelper = std::make_unique<nNISTC3::dioHelper>(mDevice->DI, mDevice->DO, mHelperStatus);
+  mDioHelper->setTristate(kTrue, status);
+  mDioHelper->reset(NULL, 0, status);
+  if(status.isFatal())
+  {
+    printf("%s: DIO reset (%d).\n", mName, status.statusCode);
+    return -1;
+  }
+  printf("%s: %s serial 0x%x opened in %.1f ms, calibration from the %s.\n", mName,
+    mDeviceInfo->deviceName, mEeprom->getSerialNumber(), (mClock() - beginNs) * 1e-6,
+    mCalibrationCache && mCalibrationCache->Warm() ? "cache" : "eeprom");
+  return 0;
+}
+
+// the trigger and reference clock routes of aiex6, for any number of boards
+int NiDeviceService::EnableSync(const NiSyncConfig &config)
+{
+  nMDBG::tStatus2 status;
+  if(mPfiRtsiHelper)
+  {
+    printf("%s: Already synchronized.\n", mName);
+    return -1;
+  }
+  if(config.mLockPll && mEeprom->getSTC3_Revision() == 1)
+  {
+    printf("%s: Unable to phase-lock loop with STC3 revision A.\n", mName);
+    return -1;
+  }
+  mPfiRtsiHelper = std::make_unique<nNISTC3::pfiRtsiResetHelper>(mDevice->Triggers, kFalse,
+    status);
+  mPllHelper = std::make_unique<nNISTC3::pllHelper>(*mDevice, mDeviceInfo->isPCIe, status);
+  mSync = config;
+
+  auto &triggers = mDevice->Triggers;
+  if(config.mMaster)
+  {
+    triggers.RTSI_OutputSelectRegister_i[0].writeRTSI_i_Output_Select(nTriggers::kRTSI_AI_START1,
+      &status);
+    triggers.RTSI_Trig_Direction_Register.writeRTSI0_Pin_Dir(nTriggers::kRTSI_Output, &status);
+  }
+  else
+  {
+    triggers.RTSI_Trig_Direction_Register.writeRTSI0_Pin_Dir(nTriggers::kRTSI_Input, &status);
+  }
+  if(config.mLockPll)
+  {
+    nNISTC3::PLL_Parameters_t parameters;
+    parameters.pllDivisor = 1;
+    parameters.pllOutputDivider = 8;
+    auto source = nTriggers::kRefClkSrc_PXIe_Clk100;
+    parameters.frequency = nNISTC3::kReference100MHz;
+    // a pcie board has no backplane clock, every board locks to the master's 10 MHz
+    // reference on rtsi 1, as the start trigger is on rtsi 0
+    if(mDeviceInfo->isPCIe)
+    {
+      source = nTriggers::kRefClkSrc_RTSI1;
+      parameters.frequency = nNISTC3::kReference10MHz;
+      if(config.mMaster)
+      {
+        triggers.RTSI_OutputSelectRegister_i[1].writeRTSI_i_Output_Select(
+          nTriggers::kRTSI_RefClkOut, &status);
+        triggers.RTSI_Trig_Direction_Register.writeRTSI1_Pin_Dir(nTriggers::kRTSI_Output,
+          &status);
+      }
+      else
+      {
+        triggers.RTSI_Trig_Direction_Register.writeRTSI1_Pin_Dir(nTriggers::kRTSI_Input,
+          &status);
+      }
+    }
+    parameters.pllMultiplier = static_cast<u16>(100 / parameters.frequency);
+    mPllHelper->enablePLL(parameters, source, status);
+  }
+  if(status.isFatal())
+  {
+    printf("%s: Synchronization (%d).\n", mName, status.statusCode);
+    return -1;
+  }
+  printf("%s: %s, tb3 from the %s.\n", mName, config.mMaster ? "Master" : "Slave",
+    config.mLockPll ? "pll" : "oscillator");
+  return 0;
+}
+
+int NiDeviceService::OpenChannel(const nNISTC3::tDMAChannelNumber dmaChannel,
+  tStreamCircuitRegMap &streamCircuit, const bool isInput, const uint32_t frameBytes)
+{
+  nMDBG::tStatus2 status;
+  auto &channel = mChannels[dmaChannel];
+  channel.mIsInput = isInput;
+  channel.mFrameBytes = frameBytes;
+  channel.mBlockBytes = NiServiceLimit::kBlockBytes - NiServiceLimit::kBlockBytes % frameBytes;
+  channel.mDmaBytes = NiServiceLimit::kDmaBufferFactor * channel.mBlockBytes;
+  channel.mStreamHelper = std::make_unique<nNISTC3::streamHelper>(streamCircuit,
+    mDevice->CHInCh, mHelperStatus);
+
+  channel.mDma = std::make_unique<nNISTC3::tCHInChDMAChannel>(*mDevice, dmaChannel, status);
+  if(status.isFatal())
+  {
+    printf("%s: DMA channel initialization for %s (%d).\n", mName, ChannelName(dmaChannel),
+      status.statusCode);
+    return -1;
+  }
+  channel.mDma->reset(status);
+  channel.mDma->configure(mBus, nNISTC3::kReuseLinkRing, isInput ? nNISTC3::kIn : nNISTC3::kOut,
+    channel.mDmaBytes, status);
+  if(status.isFatal())
+  {
+    printf("%s: DMA channel configuration for %s (%d).\n", mName, ChannelName(dmaChannel),
+      status.statusCode);
+    return -1;
+  }
+  channel.mRing = std::make_unique<NiStreamRing>();
+  channel.mCounters = NiStreamCounters{};
+  channel.mLastCounters = NiStreamCounters{};
+  channel.mFailed = false;
+  channel.mStarved = false;
+  channel.mEnabled = true;
+  return 0;
+}
+
+// continuous, internally clocked scans as in aiex3
+int NiDeviceService::EnableAi(const NiAiConfig &config)
+{
+  nMDBG::tStatus2 status;
+  if(config.mNumChannels == 0 || config.mNumChannels > mDeviceInfo->numberOfAIChannels)
+  {
+    printf("%s: %u AI channels, the device has %u.\n", mName, config.mNumChannels,
+      mDeviceInfo->numberOfAIChannels);
+    return -1;
+  }
+  const auto gain = mDeviceInfo->getAI_Gain(config.mRange, status);
+  if(status.isFatal())
+  {
+    printf("%s: Invalid AI range (%d).\n", mName, status.statusCode);
+    return -1;
+  }
+  // a mio device converts the channels of a scan one by one
+  auto samplePeriod = config.mSamplePeriodTicks;
+  if(!mDeviceInfo->isSimultaneous && samplePeriod < config.mNumChannels * kConvertPeriodTicks)
+    samplePeriod = config.mNumChannels * kConvertPeriodTicks;
+
+  mAiSamplePeriodTicks = samplePeriod;
+
+  mAiHelper = std::make_unique<nNISTC3::aiHelper>(*mDevice, mDeviceInfo->isSimultaneous,
+    mHelperStatus);
+  mAiHelper->reset(status);
+  mDevice->AI.AI_Timer.Reset_Register.writeConfiguration_Start(kTrue, &status);
+  mAiHelper->programExternalGate(nAI::kGate_Disabled, nAI::kActive_High_Or_Rising_Edge, status);
+  const auto slave = mPfiRtsiHelper && !mSync.mMaster;
+  mAiHelper->programStart1(slave ? nAI::kStart1_RTSI0 : nAI::kStart1_SW_Pulse,
+    nAI::kActive_High_Or_Rising_Edge, kTrue, status);
+  mAiHelper->programStart(nAI::kStartCnv_InternalTiming, nAI::kActive_High_Or_Rising_Edge, kTrue,
+    status);
+  mAiHelper->programConvert(nAI::kStartCnv_InternalTiming, mDeviceInfo->isSimultaneous ?
+    nAI::kActive_High_Or_Rising_Edge : nAI::kActive_Low_Or_Falling_Edge, status);
+
+  mAiTiming.setAcqLevelTimingMode(nNISTC3::kInTimerContinuous, status);
+  mAiTiming.setUseSICounter(kTrue, status);
+  mAiTiming.setSamplePeriod(samplePeriod, status);
+  mAiTiming.setSampleDelay(kDelayTicks, status);
+  mAiTiming.setNumberOfSamples(0, status);
+  if(!mDeviceInfo->isSimultaneous)
+  {
+    mAiTiming.setUseSI2Counter(kTrue, status);
+    mAiTiming.setConvertPeriod(kConvertPeriodTicks, status);
+    mAiTiming.setConvertDelay(kDelayTicks, status);
+  }
+  if(mPfiRtsiHelper)
+    mAiTiming.setSyncMode(slave ? nInTimer::kSyncSlave : nInTimer::kSyncMaster, status);
+  mAiHelper->getInTimerHelper(status).programTiming(mAiTiming, status);
+  mAiHelper->programFIFOWidth(nAI::kTwoByteFifo, status);
+
+  mAiHelper->getInTimerHelper(status).clearConfigurationMemory(status);
+  std::vector<nNISTC3::aiHelper::tChannelConfiguration> channels(config.mNumChannels);
+  for(auto i{0u}; i < config.mNumChannels; ++i)
+  {
+    auto &channel = channels[i];
+    channel.isLastChannel = (i == config.mNumChannels - 1) ? kTrue : kFalse;
+    channel.enableDither = nAI::kEnabled;
+    channel.gain = gain;
+    channel.channelType = config.mTerminalConfig;
+    channel.bank = nAI::kBank0;
+    channel.channel = static_cast<u16>(i);
+    channel.range = config.mRange;
+    mAiHelper->programChannel(channel, status);
+  }
+  mAiHelper->getInTimerHelper(status).primeConfigFifo(status);
+  mDevice->AI.AI_Timer.Reset_Register.writeConfiguration_End(kTrue, &status);
+  if(status.isFatal())
+  {
+    printf("%s: AI configuration (%d).\n", mName, status.statusCode);
+    return -1;
+  }
+  if(LoadAiScalingTable(mName, *mEeprom, channels, *mDeviceInfo, mAiScaling))
+    return -1;
+  return OpenChannel(nNISTC3::kAI_DMAChannel, mDevice->AIStreamCircuit, true,
+    config.mNumChannels * sizeof(i16));
+}
+
+// continuous updates from the dma stream without regeneration, as in aoex6
+int NiDeviceService::EnableAo(const NiAoConfig &config)
+{
+  nMDBG::tStatus2 status;
+  if(config.mNumChannels == 0 || config.mNumChannels > mDeviceInfo->numberOfDACs)
+  {
+    printf("%s: %u AO channels, the device has %u.\n", mName, config.mNumChannels,
+      mDeviceInfo->numberOfDACs);
+    return -1;
+  }
+  const auto gain = mDeviceInfo->getAO_Gain(config.mRange, status);
+  if(status.isFatal())
+  {
+    printf("%s: Invalid AO range (%d).\n", mName, status.statusCode);
+    return -1;
+  }
+  const uint32_t frameBytes = config.mNumChannels * sizeof(i16);
+
+  mAoHelper = std::make_unique<nNISTC3::aoHelper>(mDevice->AO, mDevice->AO.AO_Timer,
+    mHelperStatus);
+  auto &timer = mAoHelper->getOutTimerHelper(status);
+  mAoHelper->reset(status);
+  mDevice->AO.AO_Timer.Reset_Register.writeConfiguration_Start(kTrue, &status);
+  mAoHelper->programExternalGate(nAO::kGate_Disabled, nAO::kRising_Edge, kFalse, status);
+  mAoHelper->programStart1(nAO::kStart1_Pulse, nAO::kRising_Edge, kTrue, status);
+  timer.programStart1(nOutTimer::kSyncDefault, nOutTimer::kExportSynchronizedTriggers, status);
+  // continuous, the buffer and update counts only pace the stop
+  timer.programBufferCount(2, status);
+  timer.programUpdateCount(NiServiceLimit::kBlockBytes / frameBytes, 0, status);
+  timer.loadUC(status);
+  timer.programBCGate(nOutTimer::kDisabled, status);
+  mAoHelper->programUpdate(nAO::kUpdate_UI_TC, nAO::kRising_Edge, status);
+  timer.programUICounter(nOutTimer::kUI_Src_TB3, nOutTimer::kRising_Edge,
+    nOutTimer::kContinuousOp, status);
+  timer.loadUI(kDelayTicks, config.mUpdatePeriodTicks, status);
+  timer.programStopCondition(kTrue, nOutTimer::kContinuousOp, nOutTimer::kContinue_on_Error,
+    nOutTimer::kContinue_on_Error, nOutTimer::kStop_on_Error, status);
+  timer.programFIFO(kTrue, nOutTimer::kFifoMode_Less_Than_Full, nOutTimer::kDisabled, status);
+  timer.clearFIFO(status);
+  timer.programNumberOfChannels(config.mNumChannels, status);
+
+  std::vector<nNISTC3::aoHelper::tChannelConfiguration> channels(config.mNumChannels);
+  for(auto i{0u}; i < config.mNumChannels; ++i)
+  {
+    channels[i].channel = i;
+    channels[i].gain = gain;
+    channels[i].updateMode = nAO::kTimed;
+    channels[i].range = config.mRange;
+    mAoHelper->programConfigBank(channels[i], status);
+  }
+  mAoHelper->programChannels(channels, status);
+  mDevice->AO.AO_Timer.Reset_Register.writeConfiguration_End(kTrue, &status);
+  if(status.isFatal())
+  {
+    printf("%s: AO configuration (%d).\n", mName, status.statusCode);
+    return -1;
+  }
+  if(LoadAoScalingTable(mName, *mEeprom, channels, mAoScaling))
+    return -1;
+  return OpenChannel(nNISTC3::kAO_DMAChannel, mDevice->AOStreamCircuit, false, frameBytes);
+}
+
+// correlated di of port 0 on the internal sample clock, as in dioex4
+int NiDeviceService::EnableDi(const NiDioConfig &config)
+{
+  nMDBG::tStatus2 status;
+  const auto fourBytes = mDeviceInfo->port0Length == 32;
+  const auto lineMask = config.mLineMask & (fourBytes ?
+    static_cast<u32>(nDI::nDI_FIFO_Data_Register::nCDI_FIFO_Data::kMask) :
+    static_cast<u32>(nDI::nDI_FIFO_Data_Register8::nCDI_FIFO_Data8::kMask));
+  if(lineMask == 0 || (lineMask & mDoLineMask))
+  {
+    printf("%s: DI lines 0x%x are none of port 0 or taken by DO.\n", mName, config.mLineMask);
+    return -1;
+  }
+
+  mDiHelper = std::make_unique<nNISTC3::diHelper>(mDevice->DI, mDevice->DI.DI_Timer,
+    mHelperStatus);
+  mDiHelper->reset(status);
+  mDevice->DI.DI_Timer.Reset_Register.writeConfiguration_Start(kTrue, &status);
+  mDiHelper->programExternalGate(nDI::kGate_Disabled, nDI::kActive_High_Or_Rising_Edge, status);
+  mDiHelper->programStart1(nDI::kStart1_SW_Pulse, nDI::kActive_High_Or_Rising_Edge, kTrue,
+    status);
+  mDiHelper->programConvert(nDI::kSampleClk_Internal, nDI::kActive_High_Or_Rising_Edge, status);
+
+  mDiTiming.setAcqLevelTimingMode(nNISTC3::kInTimerContinuous, status);
+  mDiTiming.setUseSICounter(kTrue, status);
+  mDiTiming.setSamplePeriod(config.mPeriodTicks, status);
+  mDiTiming.setSampleDelay(kDelayTicks, status);
+  mDiTiming.setNumberOfSamples(0, status);
+  mDiHelper->getInTimerHelper(status).programTiming(mDiTiming, status);
+
+  mDevice->DI.DI_Mode_Register.setDI_DataWidth(fourBytes ? nDI::kDI_FourBytes : nDI::kDI_OneByte,
+    &status);
+  mDevice->DI.DI_Mode_Register.setDI_Data_Lane(nDI::kDI_DataLane0, &status);
+  mDevice->DI.DI_Mode_Register.flush(&status);
+  mDiHelper->getInTimerHelper(status).clearFIFO(status);
+  mDioHelper->configureLines(lineMask, nNISTC3::kCorrInput, status);
+  mDevice->DI.DI_Timer.Reset_Register.writeConfiguration_End(kTrue, &status);
+  if(status.isFatal())
+  {
+    printf("%s: DI configuration (%d).\n", mName, status.statusCode);
+    return -1;
+  }
+  mDiLineMask = lineMask;
+  return OpenChannel(nNISTC3::kDI_DMAChannel, mDevice->DIStreamCircuit, true,
+    fourBytes ? sizeof(u32) : sizeof(u8));
+}
+
+// correlated do of port 0 from the dma stream, as in dioex5
+int NiDeviceService::EnableDo(const NiDioConfig &config)
+{
+  nMDBG::tStatus2 status;
+  const auto fourBytes = mDeviceInfo->port0Length == 32;
+  const auto lineMask = config.mLineMask & (fourBytes ?
+    static_cast<u32>(nDI::nDI_FIFO_Data_Register::nCDI_FIFO_Data::kMask) :
+    static_cast<u32>(nDI::nDI_FIFO_Data_Register8::nCDI_FIFO_Data8::kMask));
+  if(lineMask == 0 || (lineMask & mDiLineMask))
+  {
+    printf("%s: DO lines 0x%x are none of port 0 or taken by DI.\n", mName, config.mLineMask);
+    return -1;
+  }
+  const uint32_t frameBytes = fourBytes ? sizeof(u32) : sizeof(u8);
+
+  mDoHelper = std::make_unique<nNISTC3::doHelper>(mDevice->DO, mDevice->DO.DO_Timer,
+    mHelperStatus);
+  auto &timer = mDoHelper->getOutTimerHelper(status);
+  mDoHelper->reset(status);
+  mDevice->DO.DO_Timer.Reset_Register.writeConfiguration_Start(kTrue, &status);
+  mDoHelper->programExternalGate(nDO::kGate_Disabled, nDO::kRising_Edge, kFalse, status);
+  mDoHelper->programStart1(nDO::kStart1_Pulse, nDO::kRising_Edge, kTrue, status);
+  timer.programStart1(nOutTimer::kSyncDefault, nOutTimer::kExportSynchronizedTriggers, status);
+  timer.programBufferCount(2, status);
+  timer.programUpdateCount(NiServiceLimit::kBlockBytes / frameBytes, 0, status);
+  timer.loadUC(status);
+  timer.programBCGate(nOutTimer::kDisabled, status);
+  mDoHelper->programUpdate(nDO::kUpdate_UI_TC, nDO::kRising_Edge, status);
+  timer.programUICounter(nOutTimer::kUI_Src_TB3, nOutTimer::kRising_Edge,
+    nOutTimer::kContinuousOp, status);
+  timer.loadUI(kDelayTicks, config.mPeriodTicks, status);
+  timer.programStopCondition(kTrue, nOutTimer::kContinuousOp, nOutTimer::kContinue_on_Error,
+    nOutTimer::kContinue_on_Error, nOutTimer::kStop_on_Error, status);
+  timer.programFIFO(kTrue, nOutTimer::kFifoMode_Less_Than_Full, nOutTimer::kDisabled, status);
+
+  mDevice->DO.DO_Mode_Register.setDO_DataWidth(fourBytes ? nDO::kDO_FourBytes : nDO::kDO_OneByte,
+    &status);
+  mDevice->DO.DO_Mode_Register.setDO_Data_Lane(nDO::kDO_DataLane0, &status);
+  mDevice->DO.DO_Mode_Register.flush(&status);
+  timer.clearFIFO(status);
+  timer.programNumberOfChannels(1, status);
+  mDioHelper->configureLines(lineMask, nNISTC3::kCorrOutput, status);
+  mDevice->DO.DO_Timer.Reset_Register.writeConfiguration_End(kTrue, &status);
+  if(status.isFatal())
+  {
+    printf("%s: DO configuration (%d).\n", mName, status.statusCode);
+    return -1;
+  }
+  mDoLineMask = lineMask;
+  return OpenChannel(nNISTC3::kDO_DMAChannel, mDevice->DOStreamCircuit, false, frameBytes);
+}
+
+int NiDeviceService::EnableCounter(const unsigned int counter,
+  const nCounter::tGi_Gate_Select_t gate, const nTriggers::tTrig_Filter_Select_t filter)
+{
+  nMDBG::tStatus2 status;
+  if(counter >= NiServiceLimit::kNumCounters)
+  {
+    printf("%s: No counter %u.\n", mName, counter);
+    return -1;
+  }
+  if(filter != nTriggers::kNo_Filter)
+  {
+    const auto pfi = PfiOfGate(gate);
+    if(pfi < 0)
+    {
+      printf("%s: Counter %u: only a pfi gate has a filter.\n", mName, counter);
+      return -1;
+    }
+    auto &triggers = mDevice->Triggers;
+    const auto field = pfi % kPfiFiltersPerRegister;
+    switch(pfi / kPfiFiltersPerRegister)
+    {
+      case 0:
+        SetPfiFilter(triggers.PFI_Filter_Register_0, field, filter, status);
+        break;
+      case 1:
+        SetPfiFilter(triggers.PFI_Filter_Register_1, field, filter, status);
+        break;
+      case 2:
+        SetPfiFilter(triggers.PFI_Filter_Register_2, field, filter, status);
+        break;
+      default:
+        SetPfiFilter(triggers.PFI_Filter_Register_3, field, filter, status);
+        break;
+    }
+  }
+  mCounterHelpers[counter] = std::make_unique<nNISTC3::counterResetHelper>(*mCounters[counter],
+    kFalse, mHelperStatus);
+  mCounterHelpers[counter]->reset(/*initialReset*/ kTrue, status);
+  ProgramSemiPeriodCounter(*mCounters[counter], gate, status);
+  if(status.isFatal())
+  {
+    printf("%s: counter %u configuration (%d).\n", mName, counter, status.statusCode);
+    return -1;
+  }
+
+  tStreamCircuitRegMap *streamCircuits[] = {&mDevice->Counter0StreamCircuit,
+    &mDevice->Counter1StreamCircuit, &mDevice->Counter2StreamCircuit,
+    &mDevice->Counter3StreamCircuit};
+  return OpenChannel(static_cast<nNISTC3::tDMAChannelNumber>(nNISTC3::kCounter0DmaChannel +
+    counter), *streamCircuits[counter], true, sizeof(u32));
+}
+
+// fills the dma ring of an output from its ring before the channel starts
+int NiDeviceService::PrimeOutput(Channel &channel)
+{
+  nMDBG::tStatus2 status;
+  tBoolean regenerated = kFalse;
+  u32 space = 0;
+  auto primed{0u};
+  NiStreamBlock *block;
+  while((block = channel.mRing->Peek()) != NULL && primed + block->mBytes <= channel.mDmaBytes)
+  {
+    channel.mDma->write(block->mBytes, block->mData, &space, kFalse, &regenerated, status);
+    if(status.isFatal())
+      return -1;
+    primed += block->mBytes;
+    channel.mCounters.mBytes += block->mBytes;
+    ++channel.mCounters.mBlocks;
+    channel.mRing->Release();
+  }
+  return primed;
+}
+
+int NiDeviceService::WaitForFifo(tOutTimer &timer)
+{
+  nMDBG::tStatus2 status;
+  auto startNs = mClock();
+  while(timer.Status_1_Register.readFIFO_Empty_St(&status) == nOutTimer::kEmpty)
+  {
+    if(status.isFatal() || mClock() - startNs > kTimeoutNs)
+      return -1;
+  }
+  return 0;
+}
+
+int NiDeviceService::Start()
+{
+  nMDBG::tStatus2 status;
+  for(auto i{0u}; i < NiServiceLimit::kNumChannels; ++i)
+  {
+    auto &channel = mChannels[i];
+    if(!channel.mEnabled)
+      continue;
+    const auto dmaChannel = static_cast<nNISTC3::tDMAChannelNumber>(i);
+    // the transfer count throttles the stream circuit, nothing is overwritten or regenerated
+    if(channel.mIsInput)
+    {
+      channel.mDma->start(status);
+      channel.mStreamHelper->configureForInput(kTrue, dmaChannel, status);
+      channel.mStreamHelper->modifyTransferSize(channel.mDmaBytes, status);
+    }
+    else
+    {
+      auto primed = PrimeOutput(channel);
+      if(primed <= 0)
+      {
+        printf("%s: No data queued for %s.\n", mName, ChannelName(i));
+        return -1;
+      }
+      channel.mDma->start(status);
+      channel.mStreamHelper->configureForOutput(kTrue, dmaChannel, status);
+      channel.mStreamHelper->modifyTransferSize(primed, status);
+    }
+    channel.mStreamHelper->enable(status);
+  }
+  if(status.isFatal())
+  {
+    printf("%s: DMA start (%d).\n", mName, status.statusCode);
+    return -1;
+  }
+
+  for(auto i{0u}; i < NiServiceLimit::kNumCounters; ++i)
+  {
+    if(!mChannels[nNISTC3::kCounter0DmaChannel + i].mEnabled)
+      continue;
+    const auto pair = i % 2 == 0 && mChannels[nNISTC3::kCounter0DmaChannel + i + 1].mEnabled ?
+      2u : 1u;
+    for(auto j{i}; j < i + pair; ++j)
+    {
+      mCounterArms[j].mGateHigh = mCounters[j]->Gi_Status_Register.readGi_Gate_St(&status) != 0;
+    }
+    mCounters[i]->Gi_Command_Register.setGi_Arm(kTrue, &status);
+    if(pair == 2)
+      mCounters[i]->Gi_Command_Register.setGi_Arm_Paired_Counter(kTrue, &status);
+    mCounters[i]->Gi_Command_Register.flush(&status);
+    const auto armStartNs = mClock();
+    for(auto j{i}; j < i + pair; ++j)
+    {
+      mCounterArms[j].mNs = armStartNs;
+      while(mCounters[j]->Gi_Status_Register.readGi_Armed_St(&status) == nCounter::kNot_Armed)
+      {
+        if(mClock() - armStartNs > kTimeoutNs)
+        {
+          printf("%s: Counter %u did not arm within timeout.\n", mName, j);
+          return -1;
+        }
+      }
+    }
+    i += pair - 1;
+  }
+  if(mChannels[nNISTC3::kAI_DMAChannel].mEnabled)
+    mAiHelper->getInTimerHelper(status).armTiming(mAiTiming, status);
+  if(mChannels[nNISTC3::kDI_DMAChannel].mEnabled)
+    mDiHelper->getInTimerHelper(status).armTiming(mDiTiming, status);
+
+  // the output timers arm once their fifos hold data, the first sample goes to the
+  // lines without an update so they don't glitch
+  nNISTC3::outTimerHelper *outTimers[] = {
+    mChannels[nNISTC3::kAO_DMAChannel].mEnabled ? &mAoHelper->getOutTimerHelper(status) : NULL,
+    mChannels[nNISTC3::kDO_DMAChannel].mEnabled ? &mDoHelper->getOutTimerHelper(status) : NULL};
+  tOutTimer *timers[] = {&mDevice->AO.AO_Timer, &mDevice->DO.DO_Timer};
+  for(auto i{0u}; i < 2; ++i)
+  {
+    if(outTimers[i] == NULL)
+      continue;
+    if(WaitForFifo(*timers[i]))
+    {
+      printf("%s: %s FIFO did not receive data within timeout.\n", mName, i ? "DO" : "AO");
+      return -1;
+    }
+    outTimers[i]->notAnUpdate(status);
+    outTimers[i]->setArmUI(kTrue, status);
+    outTimers[i]->setArmUC(kTrue, status);
+    outTimers[i]->setArmBC(kTrue, status);
+    outTimers[i]->armTiming(status);
+  }
+  if(status.isFatal())
+  {
+    printf("%s: Arming (%d).\n", mName, status.statusCode);
+    return -1;
+  }
+
+  if(mChannels[nNISTC3::kAI_DMAChannel].mEnabled && !(mPfiRtsiHelper && !mSync.mMaster))
+    mAiHelper->getInTimerHelper(status).strobeStart1(status);
+  if(mChannels[nNISTC3::kDI_DMAChannel].mEnabled)
+    mDiHelper->getInTimerHelper(status).strobeStart1(status);
+  for(auto i{0u}; i < 2; ++i)
+  {
+    if(outTimers[i] != NULL)
+      timers[i]->Command_1_Register.writeSTART1_Pulse(kTrue, &status);
+  }
+  if(status.isFatal())
+  {
+    printf("%s: Start (%d).\n", mName, status.statusCode);
+    return -1;
+  }
+  mRunning = true;
+  return 0;
+}
+
+// one transfer count read tells what is there, then the whole of it is copied into ring
+// blocks from one span; what the ring has no room for is dropped to keep the dma going
+int NiDeviceService::PollInput(Channel &channel, const unsigned long long pollNs)
+{
+  nMDBG::tStatus2 status;
+  tBoolean overwritten = kFalse;
+  u32 available = 0;
+  channel.mDma->read(0, NULL, &available, kFalse, &overwritten, status);
+  available -= available % channel.mFrameBytes;
+  if(status.isFatal() || available == 0)
+    return status.isFatal() ? -1 : 0;
+
+  nNISTC3::tDMASpan span;
+  channel.mDma->acquireRead(available, &span, &available, kFalse, &overwritten, status);
+  if(status.isFatal())
+    return -1;
+  auto &ring = *channel.mRing;
+  auto offset{0u};
+  auto blocks{0u};
+  NiStreamBlock *block;
+  while(offset < span.size[0] + span.size[1] && (block = ring.Reserve(blocks)) != NULL)
+  {
+    auto bytes = span.size[0] + span.size[1] - offset;
+    if(bytes > channel.mBlockBytes)
+      bytes = channel.mBlockBytes;
+    CopyFromSpan(span, offset, block->mData, bytes);
+    block->mNs = pollNs;
+    block->mBytes = bytes;
+    offset += bytes;
+    ++blocks;
+  }
+  const auto acquired = span.size[0] + span.size[1];
+  channel.mDma->releaseRead(&available, kFalse, &overwritten, status);
+  if(status.isFatal())
+    return -1;
+  ring.Commit(blocks);
+  // hand the room back to the stream circuit
+  channel.mStreamHelper->modifyTransferSize(acquired, status);
+
+  channel.mCounters.mBytes += offset;
+  channel.mCounters.mBlocks += blocks;
+  if(offset < acquired)
+    ++channel.mCounters.mOverflows;
+  return status.isFatal() ? -1 : static_cast<int>(blocks);
+}
+
+// as many queued blocks as the dma ring has room for, written through one span
+int NiDeviceService::PollOutput(Channel &channel)
+{
+  nMDBG::tStatus2 status;
+  tBoolean regenerated = kFalse;
+  u32 space = 0;
+  channel.mDma->write(0, NULL, &space, kFalse, &regenerated, status);
+  if(status.isFatal())
+    return -1;
+  // the hardware has taken every sample written so far
+  if(space == channel.mDmaBytes && !channel.mStarved)
+  {
+    ++channel.mCounters.mUnderruns;
+    channel.mStarved = true;
+  }
+
+  auto &ring = *channel.mRing;
+  auto bytes{0u};
+  auto blocks{0u};
+  NiStreamBlock *block;
+  while((block = ring.Peek(blocks)) != NULL && bytes + block->mBytes <= space)
+  {
+    bytes += block->mBytes;
+    ++blocks;
+  }
+  if(blocks == 0)
+    return 0;
+
+  nNISTC3::tDMASpan span;
+  channel.mDma->acquireWrite(bytes, &span, &space, kFalse, &regenerated, status);
+  if(status.isFatal())
+    return -1;
+  auto offset{0u};
+  for(auto i{0u}; i < blocks; ++i)
+  {
+    block = ring.Peek(i);
+    CopyToSpan(span, offset, block->mData, block->mBytes);
+    offset += block->mBytes;
+  }
+  channel.mDma->releaseWrite(&space, kFalse, &regenerated, status);
+  if(status.isFatal())
+    return -1;
+  ring.Release(blocks);
+  channel.mStreamHelper->modifyTransferSize(bytes, status);
+
+  channel.mStarved = false;
+  channel.mCounters.mBytes += bytes;
+  channel.mCounters.mBlocks += blocks;
+  return status.isFatal() ? -1 : static_cast<int>(blocks);
+}
+
+bool NiDeviceService::SubsystemError(const nNISTC3::tDMAChannelNumber dmaChannel)
+{
+  nMDBG::tStatus2 status;
+  switch(dmaChannel)
+  {
+  case nNISTC3::kAI_DMAChannel:
+  {
+    auto &aiStatus = mDevice->AI.AI_Timer.Status_1_Register;
+    aiStatus.refresh(&status);
+    const bool fifoOverflow = mDeviceInfo->isSimultaneous ?
+      mDevice->SimultaneousControl.InterruptStatus.readAiFifoOverflowInterruptCondition(&status) :
+      aiStatus.getOverflow_St(&status) != nInTimer::kNO_ERROR;
+    return aiStatus.getScanOverrun_St(&status) || aiStatus.getOverrun_St(&status) ||
+      fifoOverflow || status.isFatal();
+  }
+  case nNISTC3::kDI_DMAChannel:
+  {
+    auto &diStatus = mDevice->DI.DI_Timer.Status_1_Register;
+    diStatus.refresh(&status);
+    return diStatus.getOverrun_St(&status) || diStatus.getOverflow_St(&status) ||
+      status.isFatal();
+  }
+  case nNISTC3::kAO_DMAChannel:
+  case nNISTC3::kDO_DMAChannel:
+  {
+    auto &outStatus = dmaChannel == nNISTC3::kAO_DMAChannel ?
+      mDevice->AO.AO_Timer.Status_1_Register : mDevice->DO.DO_Timer.Status_1_Register;
+    outStatus.refresh(&status);
+    return outStatus.getUnderflow_St(&status) || outStatus.getOverrun_St(&status) ||
+      status.isFatal();
+  }
+  default:
+  {
+    auto *counter = mCounters[dmaChannel - nNISTC3::kCounter0DmaChannel];
+    return counter->Gi_Status_Register.readGi_DRQ_Error(&status) || status.isFatal();
+  }
+  }
+}
+
+int NiDeviceService::Poll()
+{
+  if(!mRunning)
+    return -1;
+
+  auto pollNs = mClock();
+  auto numBlocks{0};
+  auto failed{false};
+  for(auto i{0u}; i < NiServiceLimit::kNumChannels; ++i)
+  {
+    auto &channel = mChannels[i];
+    if(!channel.mEnabled || channel.mFailed)
+      continue;
+
+    auto result = channel.mIsInput ? PollInput(channel, pollNs) : PollOutput(channel);
+    if(result < 0)
+    {
+      ++channel.mCounters.mDmaErrors;
+    }
+    else if(SubsystemError(static_cast<nNISTC3::tDMAChannelNumber>(i)))
+    {
+      ++channel.mCounters.mSubsystemErrors;
+      result = -1;
+    }
+    if(result < 0)
+    {
+      // the other channels carry on
+      channel.mFailed = true;
+      failed = true;
+      continue;
+    }
+    numBlocks += result;
+  }
+  return failed ? -1 : numBlocks;
+}
+
+void NiDeviceService::Stop()
+{
+  if(!mRunning)
+    return;
+
+  nMDBG::tStatus2 status;
+  if(mChannels[nNISTC3::kAI_DMAChannel].mEnabled)
+    mAiHelper->getInTimerHelper(status).disarmTiming(status);
+  if(mChannels[nNISTC3::kDI_DMAChannel].mEnabled)
+    mDiHelper->getInTimerHelper(status).disarmTiming(status);
+  if(mChannels[nNISTC3::kAO_DMAChannel].mEnabled)
+    mAoHelper->getOutTimerHelper(status).disarmTiming(status);
+  if(mChannels[nNISTC3::kDO_DMAChannel].mEnabled)
+    mDoHelper->getOutTimerHelper(status).disarmTiming(status);
+  for(auto i{0u}; i < NiServiceLimit::kNumCounters; ++i)
+  {
+    if(mChannels[nNISTC3::kCounter0DmaChannel + i].mEnabled)
+      mCounters[i]->Gi_Command_Register.writeGi_Disarm(kTrue, &status);
+  }
+  for(auto &channel : mChannels)
+  {
+    if(!channel.mEnabled)
+      continue;
+    channel.mStreamHelper->disable(status);
+    channel.mDma->stop(status);
+  }
+  mRunning = false;
+}
+
+void NiDeviceService::PrintStats(const unsigned long long elapsedNs,
+  int (*print)(const char*, ...))
+{
+  for(auto i{0u}; i < NiServiceLimit::kNumChannels; ++i)
+  {
+    auto &channel = mChannels[i];
+    if(!channel.mEnabled)
+      continue;
+    auto &counters = channel.mCounters;
+    auto &last = channel.mLastCounters;
+    print("%s: %s %.2f MB/s, %.0f blocks/s, ring %zu/%zu, overflows: %llu, underruns: %llu, "
+      "dma errors: %llu, subsystem errors: %llu%s\n", mName, ChannelName(i),
+      elapsedNs ? (counters.mBytes - last.mBytes) * 1e3 / elapsedNs : 0.,
+      elapsedNs ? (counters.mBlocks - last.mBlocks) * 1e9 / elapsedNs : 0.,
+      channel.mRing->Size(), NiStreamRing::Capacity(), counters.mOverflows, counters.mUnderruns,
+      counters.mDmaErrors, counters.mSubsystemErrors, channel.mFailed ? ", stopped" : "");
+    last = counters;
+  }
+}
+
+NiDeviceService::~NiDeviceService()
+{
+  Stop();
+  // the helpers unwind the subsystems and stream circuits before the device goes away
+  for(auto &channel : mChannels)
+  {
+    channel.mDma.reset();
+    channel.mStreamHelper.reset();
+  }
+  for(auto &helper : mCounterHelpers)
+  {
+    helper.reset();
+  }
+  mAiHelper.reset();
+  mEeprom.reset();
+  mCalibrationCache.reset();
+  mAoHelper.reset();
+  mDiHelper.reset();
+  mDoHelper.reset();
+  mDioHelper.reset();
+  mPllHelper.reset();
+  mPfiRtsiHelper.reset();
+  if(mDevice)
+  {
+    mDevice.reset();
+    mBus->destroyAddressSpace(mBar0);
+  }
+}
@@ -0,0 +1,255 @@
+#ifndef _NIDEVICESERVICE_H_
+#define _NIDEVICESERVICE_H_
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include <memory>
+
+// OS Interface
+#include "osiBus.h"
+
+// Chip Objects
+#include "tXSeries.h"
+
+// Chip Object Helpers
+#include "counterResetHelper.h"
+#include "devices.h"
+#include "dio/dioHelper.h"
+#include "inTimer/aiHelper.h"
+#include "inTimer/diHelper.h"
+#include "inTimer/inTimerParams.h"
+#include "outTimer/aoHelper.h"
+#include "outTimer/doHelper.h"
+#include "pfiRtsiResetHelper.h"
+#include "pllHelper.h"
+#include "streamHelper.h"
+
+// DMA Support
+#include "CHInCh/dmaProperties.h"
+#include "CHInCh/tCHInChDMAChannel.h"
+
+#include <CalibrationCache.h>
+#include <CalibrationTable.h>
+#include <RtSpscRing.h>
+
+namespace NiServiceLimit
+{
+constexpr auto kNumChannels = 8u; // one per dma channel: ai, counters 0..3, di, ao, do
+constexpr auto kNumCounters = 4u;
+constexpr auto kBlockBytes = 2048u; // whole frames of one channel per ring block
+constexpr auto kRingBlocks = 32u;
+constexpr auto kDmaBufferFactor = 8u; // dma ring in blocks
+constexpr auto kDmaPoolBytes = 256u * 1024u; // rings and sgl links of all channels, with room
+}
+
+// whole frames (one sample of every channel of the subsystem) and their poll time
+struct NiStreamBlock
+{
+  unsigned long long mNs;
+  uint32_t mBytes;
+  uint8_t mData[NiServiceLimit::kBlockBytes];
+};
+
+typedef RtSpscRing<NiStreamBlock, NiServiceLimit::kRingBlocks> NiStreamRing;
+
+struct NiStreamCounters
+{
+  unsigned long long mBytes;
+  unsigned long long mBlocks;
+  // input polls that found the ring full and dropped what the dma ring held
+  unsigned long long mOverflows;
+  // output polls that found the dma ring drained, once until it is refilled
+  unsigned long long mUnderruns;
+  unsigned long long mDmaErrors;
+  // scan overruns, fifo overflows and underflows, counter drq errors
+  unsigned long long mSubsystemErrors;
+};
+
+struct NiAiConfig
+{
+  uint32_t mNumChannels; // ai0 on
+  nNISTC3::tInputRange mRange;
+  nAI::tAI_Config_Channel_Type_t mTerminalConfig;
+  uint32_t mSamplePeriodTicks; // timebase 3 ticks per scan
+};
+
+struct NiAoConfig
+{
+  uint32_t mNumChannels; // ao0 on
+  nNISTC3::tOutputRange mRange;
+  uint32_t mUpdatePeriodTicks;
+};
+
+// one board of a group that scans together, as in aiex6: the master exports its ai start
+// trigger on rtsi 0 and the slaves start from it
+struct NiSyncConfig
+{
+  bool mMaster;
+  // tb3 from the pll, locked to the pxie backplane clock or to the master's reference
+  // clock on rtsi 1 of a pcie rtsi cable; without it every board counts its own oscillator
+  bool mLockPll;
+};
+
+struct NiDioConfig
+{
+  uint32_t mLineMask; // port 0 lines
+  uint32_t mPeriodTicks;
+};
+
+// where the semi-periods of a counter start: its first sample ends at the first edge after
+// the arm, which is a falling one when the gate was high
+struct NiCounterArm
+{
+  unsigned long long mNs;
+  bool mGateHigh;
+};
+
+/*
+ * one owner of an x series board for ai, ao, correlated di and do and the four counters
+ *
+ * the Enable*() calls program the subsystems as the aiex3, aoex6, dioex4, dioex5 and
+ * gpctex5 examples do, each into its own dma channel and stream circuit. Poll() is the
+ * one service loop for all of them: it reads the transfer count of every running dma
+ * channel once, moves whole frames between the dma rings and one lock-free ring per
+ * channel, and checks the subsystem status. inputs are read straight into ring blocks,
+ * outputs are written from them, so the rt task never waits on a consumer. a channel
+ * that errors stops being served, the others carry on.
+ */
+class NiDeviceService
+{
+private:
+  struct Channel
+  {
+    bool mEnabled;
+    bool mIsInput;
+    bool mFailed;
+    bool mStarved;
+    uint32_t mFrameBytes;
+    uint32_t mBlockBytes; // whole frames that fit a ring block
+    uint32_t mDmaBytes;
+    std::unique_ptr<nNISTC3::streamHelper> mStreamHelper;
+    std::unique_ptr<nNISTC3::tCHInChDMAChannel> mDma;
+    std::unique_ptr<NiStreamRing> mRing;
+    NiStreamCounters mCounters;
+    NiStreamCounters mLastCounters; // at the last PrintStats()
+  };
+
+  iBus *mBus;
+  tAddressSpace mBar0;
+  std::unique_ptr<tXSeries> mDevice;
+  const nNISTC3::tDeviceInfo *mDeviceInfo;
+  std::unique_ptr<CalibrationCache> mCalibrationCache;
+  std::unique_ptr<nNISTC3::eepromHelper> mEeprom;
+  AiScalingTable mAiScaling;
+  AoScalingTable mAoScaling;
+  // the example helpers keep a reference to the status they were made with
+  nMDBG::tStatus2 mHelperStatus;
+  std::unique_ptr<nNISTC3::aiHelper> mAiHelper;
+  std::unique_ptr<nNISTC3::aoHelper> mAoHelper;
+  std::unique_ptr<nNISTC3::diHelper> mDiHelper;
+  std::unique_ptr<nNISTC3::doHelper> mDoHelper;
+  std::unique_ptr<nNISTC3::dioHelper> mDioHelper;
+  // the rtsi lines stay as routed while the pll is locked to one, so it goes first
+  std::unique_ptr<nNISTC3::pfiRtsiResetHelper> mPfiRtsiHelper;
+  std::unique_ptr<nNISTC3::pllHelper> mPllHelper;
+  NiSyncConfig mSync;
+  std::unique_ptr<nNISTC3::counterResetHelper> mCounterHelpers[NiServiceLimit::kNumCounters];
+  tCounter *mCounters[NiServiceLimit::kNumCounters];
+  NiCounterArm mCounterArms[NiServiceLimit::kNumCounters];
+  nNISTC3::inTimerParams mAiTiming;
+  uint32_t mAiSamplePeriodTicks; // as programmed, stretched on a mio device
+  nNISTC3::inTimerParams mDiTiming;
+  Channel mChannels[NiServiceLimit::kNumChannels];
+  uint32_t mDiLineMask;
+  uint32_t mDoLineMask;
+  unsigned long long (*mClock)();
+  bool mRunning;
+
+  int OpenChannel(const nNISTC3::tDMAChannelNumber dmaChannel, tStreamCircuitRegMap &streamCircuit,
+    const bool isInput, const uint32_t frameBytes);
+  int PollInput(Channel &channel, const unsigned long long pollNs);
+  int PollOutput(Channel &channel);
+  int PrimeOutput(Channel &channel);
+  bool SubsystemError(const nNISTC3::tDMAChannelNumber dmaChannel);
+  int WaitForFifo(tOutTimer &timer);
+
+public:
+  const char *mName;
+
+public:
+  NiDeviceService() = delete;
+  NiDeviceService(const char *name, iBus *bus, unsigned long long (*clock)());
+
+  NiDeviceService(const NiDeviceService&) = delete;
+  NiDeviceService& operator=(const NiDeviceService&) = delete;
+
+  // identifies the device, reads its calibration and reserves the dma pool, then enable
+  // the subsystems. with a calibration cache file the coefficients come from there when
+  // the board and its calibration dates match
+  int Open(const char *calibrationCache=NULL);
+  // routes the ai start trigger and the reference clock over rtsi, then locks the pll;
+  // before EnableAi(), which then starts from the master's trigger
+  int EnableSync(const NiSyncConfig &config);
+  int EnableAi(const NiAiConfig &config);
+  int EnableAo(const NiAoConfig &config);
+  int EnableDi(const NiDioConfig &config);
+  int EnableDo(const NiDioConfig &config);
+  // semi-period measurement of gate into the counter's dma stream, as PwmCapture does; a
+  // pfi gate can have its digital filter set, as in gpctex4
+  int EnableCounter(const unsigned int counter, const nCounter::tGi_Gate_Select_t gate,
+    const nTriggers::tTrig_Filter_Select_t filter=nTriggers::kNo_Filter);
+  // starts the dma channels, primes the outputs from their rings, then arms and starts
+  // every enabled subsystem; the ai of a synchronized slave waits for the master's trigger.
+  // the two counters of a pair (0 and 1, 2 and 3) arm with one command when both are
+  // enabled, so their semi-periods count from the same tick
+  int Start();
+  // serves every channel once, returns the blocks moved or -1 when a channel failed
+  int Poll();
+  void Stop();
+
+  const nNISTC3::tDeviceInfo* DeviceInfo() const
+  {
+    return mDeviceInfo;
+  }
+  bool Enabled(const nNISTC3::tDMAChannelNumber dmaChannel) const
+  {
+    return mChannels[dmaChannel].mEnabled;
+  }
+  uint32_t FrameBytes(const nNISTC3::tDMAChannelNumber dmaChannel) const
+  {
+    return mChannels[dmaChannel].mFrameBytes;
+  }
+  uint32_t AiSamplePeriodTicks() const
+  {
+    return mAiSamplePeriodTicks;
+  }
+  // inputs are popped from their ring, outputs pushed to it with whole frames per block
+  NiStreamRing& Ring(const nNISTC3::tDMAChannelNumber dmaChannel)
+  {
+    return *mChannels[dmaChannel].mRing;
+  }
+  const NiStreamCounters& Counters(const nNISTC3::tDMAChannelNumber dmaChannel) const
+  {
+    return mChannels[dmaChannel].mCounters;
+  }
+  // of an enabled counter, once started
+  const NiCounterArm& CounterArm(const unsigned int counter) const
+  {
+    return mCounterArms[counter];
+  }
+  // volts from and to the raw samples of the enabled ai and ao channels
+  const AiScalingTable& AiScaling() const
+  {
+    return mAiScaling;
+  }
+  const AoScalingTable& AoScaling() const
+  {
+    return mAoScaling;
+  }
+  void PrintStats(const unsigned long long elapsedNs, int (*print)(const char*, ...)=printf);
+
+  ~NiDeviceService();
+};
+
+#endif // _NIDEVICESERVICE_H_
@@ -0,0 +1,165 @@
+#include <NiWatchdog.h>
+
+namespace {
+
+constexpr auto kModeBits = 2u; // per line in the mode select registers
+constexpr auto kLinesPerModeSelect = 16u;
+
+bool Expiring(const nBrdServices::tBrdSrv_WatchdogTimerStateMachineSt_t state)
+{
+  return state == nBrdServices::kWdtSt_Expired || state == nBrdServices::kWdtSt_ExpiredPulse;
+}
+
+} // namespace
+
+NiWatchdog::NiWatchdog(const char *name, iBus *bus)
+  : mBus(bus)
+  , mControl(NULL)
+  , mDeviceInfo(NULL)
+  , mFeed(NiWatchdogCommand::kFeed)
+  , mArmed(false)
+  , mPets(0)
+  , mLastPets(0)
+  , mName(name)
+{}
+
+int NiWatchdog::Open()
+{
+  nMDBG::tStatus2 status;
+  mBar0 = mBus->createAddressSpace(kPCI_BAR0);
+  mDevice = std::make_unique<tXSeries>(mBar0, &status);
+  mDeviceInfo = nNISTC3::getDeviceInfo(*mDevice, status);
+  if(status.isFatal())
+  {
+    printf("%s: Cannot identify device (%d).\n", mName, status.statusCode);
+    return -1;
+  }
+  mControl = &mDevice->BrdServices.WatchdogControl;
+
+  auto &watchdogStatus = mDevice->BrdServices.WatchdogStatusRegister;
+  if(Expiring(watchdogStatus.readWatchdogSM_State(&status)))
+    printf("%s: The watchdog expired before this run (%u times), its lines were in their safe "
+      "state.\n", mName, watchdogStatus.readWatchdogExpiredCnt(&status));
+  Disarm();
+  if(status.isFatal())
+  {
+    printf("%s: Watchdog reset (%d).\n", mName, status.statusCode);
+    return -1;
+  }
+  return 0;
+}
+
+int NiWatchdog::Arm(const NiWatchdogConfig &config)
+{
+  if(!mDevice)
+    return -1;
+  const auto lines = mDeviceInfo->port0Length;
+  const auto portMask = lines < 32 ? (1u << lines) - 1 : 0xffffffffu;
+  if(config.mLineMask == 0 || (config.mLineMask & ~portMask))
+  {
+    printf("%s: Watchdog lines 0x%x are none of port 0.\n", mName, config.mLineMask);
+    return -1;
+  }
+  if(config.mTimeoutNs < NiWatchdogLimit::kMinTimeoutNs ||
+    config.mTimeoutNs > NiWatchdogLimit::kMaxTimeoutNs)
+  {
+    printf("%s: Watchdog timeout %llu ns out of %llu..%llu ns.\n", mName, config.mTimeoutNs,
+      NiWatchdogLimit::kMinTimeoutNs, NiWatchdogLimit::kMaxTimeoutNs);
+    return -1;
+  }
+
+  // an outstanding expiration blocks programming, so acknowledge it and stop the timer
+  nMDBG::tStatus2 status;
+  auto &services = mDevice->BrdServices;
+  services.WatchdogConfiguration.writeWatchdogIntTrigEn(kFalse, &status);
+  services.WatchdogControl.writeRegister(NiWatchdogCommand::kReset, &status);
+  services.WatchdogTimeoutRegister.writeRegister(static_cast<u32>(
+    config.mTimeoutNs * NiWatchdogLimit::kBusClockHz / 1000000000ull), &status);
+
+  u32 modeSelect[2] = {0, 0};
+  for(auto line{0u}; line < lines; ++line)
+  {
+    if(config.mLineMask & (1u << line))
+      modeSelect[line / kLinesPerModeSelect] |=
+        static_cast<u32>(config.mMode) << (kModeBits * (line % kLinesPerModeSelect));
+  }
+  mDevice->DO.DO_WDT_ModeSelect1_Register.writeRegister(modeSelect[0], &status);
+  if(lines > kLinesPerModeSelect)
+    mDevice->DO.DO_WDT_ModeSelect2_Register.writeRegister(modeSelect[1], &status);
+  mDevice->DO.DO_WDT_SafeStateRegister.writeRegister(config.mSafeState & config.mLineMask,
+    &status);
+
+  services.WatchdogConfiguration.writeWatchdogIntTrigEn(kTrue, &status);
+  services.WatchdogControl.writeRegister(NiWatchdogCommand::kReset, &status);
+  services.WatchdogControl.writeRegister(NiWatchdogCommand::kStart, &status);
+  services.WatchdogControl.writeRegister(NiWatchdogCommand::kFeed, &status);
+  mFeed = NiWatchdogCommand::kFood;
+  if(status.isFatal())
+  {
+    printf("%s: Watchdog programming (%d).\n", mName, status.statusCode);
+    return -1;
+  }
+  mArmed = true;
+  printf("%s: Watchdog armed, lines 0x%x to their safe state 0x%x after %.3f ms unpetted.\n",
+    mName, config.mLineMask, config.mSafeState & config.mLineMask, config.mTimeoutNs * 1e-6);
+  return 0;
+}
+
+void NiWatchdog::Trip()
+{
+  if(!mArmed)
+    return;
+  mControl->writeRegister(NiWatchdogCommand::kKill);
+}
+
+void NiWatchdog::Disarm()
+{
+  if(!mDevice)
+    return;
+  nMDBG::tStatus2 status;
+  mDevice->BrdServices.WatchdogConfiguration.writeWatchdogIntTrigEn(kFalse, &status);
+  mControl->writeRegister(NiWatchdogCommand::kReset, &status);
+  mArmed = false;
+}
+
+bool NiWatchdog::Expired()
+{
+  if(!mDevice)
+    return false;
+  nMDBG::tStatus2 status;
+  return Expiring(mDevice->BrdServices.WatchdogStatusRegister.readWatchdogSM_State(&status));
+}
+
+uint32_t NiWatchdog::Expirations()
+{
+  if(!mDevice)
+    return 0;
+  nMDBG::tStatus2 status;
+  return mDevice->BrdServices.WatchdogStatusRegister.readWatchdogExpiredCnt(&status);
+}
+
+void NiWatchdog::EnterSafeState(void *watchdog)
+{
+  static_cast<NiWatchdog*>(watchdog)->Trip();
+}
+
+int NiWatchdog::RegisterSafeState(SafeState &safeState)
+{
+  return safeState.Register(mName, &NiWatchdog::EnterSafeState, this);
+}
+
+void NiWatchdog::PrintStats(const unsigned long long elapsedNs, int (*print)(const char*, ...))
+{
+  print("%s: watchdog %s, pets/s: %.0f\n", mName, mArmed ? "armed" : "disarmed",
+    elapsedNs ? (mPets - mLastPets) * 1e9 / elapsedNs : 0.);
+  mLastPets = mPets;
+}
+
+NiWatchdog::~NiWatchdog()
+{
+  if(mDevice)
+  {
+    mDevice.reset();
+    mBus->destroyAddressSpace(mBar0);
+  }
+}
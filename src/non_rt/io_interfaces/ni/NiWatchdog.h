@@ -0,0 +1,112 @@
+#ifndef _NIWATCHDOG_H_
+#define _NIWATCHDOG_H_
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include <memory>
+
+// OS Interface
+#include "osiBus.h"
+
+// Chip Objects
+#include "tXSeries.h"
+
+// Chip Object Helpers
+#include "devices.h"
+
+#include <SafeState.h>
+
+namespace NiWatchdogLimit
+{
+constexpr auto kBusClockHz = 100000000ull; // the timeout counts bus clock periods
+constexpr auto kMinTimeoutNs = 1000ull;
+constexpr auto kMaxTimeoutNs = 0xffffffffull * (1000000000ull / kBusClockHz);
+}
+
+// control register values, as in dioex6
+namespace NiWatchdogCommand
+{
+constexpr uint16_t kFeed = 0xFEED; // feed and food in turn reload the timeout
+constexpr uint16_t kFood = 0xF00D;
+constexpr uint16_t kStart = 0x5678;
+constexpr uint16_t kKill = 0xDEAD; // expires at once
+constexpr uint16_t kReset = 0xACED; // acknowledges an expiration and stops the timer
+}
+
+struct NiWatchdogConfig
+{
+  uint32_t mLineMask; // port 0 lines the watchdog takes over when it expires
+  nDO::tDO_WDT_Mode_t mMode; // of those lines
+  uint32_t mSafeState; // of those lines in kWDT_SafeValue mode
+  unsigned long long mTimeoutNs;
+};
+
+/*
+ * the do watchdog timer of an x series board, programmed as in dioex6
+ *
+ * Arm() gives the lines of mLineMask their watchdog mode and safe state and starts the
+ * timer; from then on the rt loop has to Pet() it within every timeout. a missed
+ * timeout, from an overrun, a hung task or a process killed without a chance to clean
+ * up, switches those lines to their safe state in hardware, with no help from the host.
+ * Pet() is one posted write of the control register and reads nothing back, so it can
+ * sit in the hottest loop; it alternates feed and food as the timer expects and must
+ * only be called from one task. the lines stay in their safe state after the process is
+ * gone; the next Open() acknowledges the expiration, which otherwise keeps the board
+ * from being programmed, so it goes before any other service opens the board.
+ */
+class NiWatchdog
+{
+private:
+  iBus *mBus;
+  tAddressSpace mBar0;
+  std::unique_ptr<tXSeries> mDevice;
+  tBrdServices::tWatchdogControl *mControl;
+  const nNISTC3::tDeviceInfo *mDeviceInfo;
+  uint16_t mFeed; // the next of feed and food
+  bool mArmed;
+  unsigned long long mPets;
+  unsigned long long mLastPets; // at the last PrintStats()
+
+  static void EnterSafeState(void *watchdog);
+
+public:
+  const char *mName;
+
+public:
+  NiWatchdog() = delete;
+  NiWatchdog(const char *name, iBus *bus);
+
+  NiWatchdog(const NiWatchdog&) = delete;
+  NiWatchdog& operator=(const NiWatchdog&) = delete;
+
+  // identifies the device and acknowledges an expiration a previous run left
+  int Open();
+  int Arm(const NiWatchdogConfig &config);
+  // rt side
+  void Pet()
+  {
+    mControl->writeRegister(mFeed);
+    mFeed ^= NiWatchdogCommand::kFeed ^ NiWatchdogCommand::kFood;
+    ++mPets;
+  }
+  // the lines to their safe state now
+  void Trip();
+  // gives the lines back to do, also after an expiration
+  void Disarm();
+  // read from the board, not for the rt loop
+  bool Expired();
+  uint32_t Expirations();
+  bool Armed() const
+  {
+    return mArmed;
+  }
+  // trips the watchdog when the process enters its safe state
+  int RegisterSafeState(SafeState &safeState);
+  void PrintStats(const unsigned long long elapsedNs, int (*print)(const char*, ...)=printf);
+
+  // leaves an armed watchdog running, to expire unless the next run opens the board
+  ~NiWatchdog();
+};
+
+#endif // _NIWATCHDOG_H_
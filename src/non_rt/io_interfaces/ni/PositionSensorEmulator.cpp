@@ -0,0 +1,403 @@
+#include <PositionSensorEmulator.h>
+
+#include <limits.h>
+#include <math.h>
+#include <string.h>
+
+#include <SampleScaling.h>
+
+namespace {
+
+constexpr auto kTimebaseHz = 100e6;
+constexpr auto kNsPerTick = 10ull;
+constexpr auto kMinDigitalPeriodTicks = 10u; // 10 MHz, the fastest do update
+constexpr auto kTwoPi = 6.283185307179586;
+constexpr auto kRadPerSecondPerRpm = kTwoPi / 60.;
+// a rising crossing counts once the excitation was this far below its mean
+constexpr auto kHysteresisVolts = 0.1f;
+constexpr auto kMeanGain = 1.f / 4096.f; // per sample
+constexpr auto kAoFrameBytes = 2 * sizeof(int16_t); // sine and cosine
+constexpr auto kDoFrameBytes = sizeof(uint32_t);
+
+} // namespace
+
+PositionSensorEmulator::PositionSensorEmulator(const char *name,
+  std::shared_ptr<NiDeviceService> service, unsigned long long (*clock)(),
+  const PositionSensorConfig &config)
+  : mService(service)
+  , mClock(clock)
+  , mConfig(config)
+  , mPattern{}
+  , mLatest{}
+  , mUseAo(config.mResolver.mEnabled)
+  , mUseDo(config.mEncoder.mLines > 0 || config.mEncoder.mPolePairs > 0)
+  , mLeadTicks(config.mWriteAheadNs / kNsPerTick)
+  , mOffsetNs(0)
+  , mWindowOffsetNs(LLONG_MAX)
+  , mLastWindowOffsetNs(LLONG_MAX)
+  , mWindowPolls(0)
+  , mInputFrames(0)
+  , mAoFrames(0)
+  , mDoFrames(0)
+  , mMean(0.f)
+  , mDeviation(0.f)
+  , mArmed(false)
+  , mNewestCrossing(0)
+  , mNumCrossings(0)
+  , mPeriodFrames(0.)
+  , mCounters{}
+  , mRunning(false)
+  , mName(name)
+{
+  const auto &encoder = config.mEncoder;
+  mPattern.mCounts = encoder.mLines ? 4.f * encoder.mLines : 4.f;
+  if(encoder.mLines)
+  {
+    // a leads b going forward
+    mPattern.mQuadrature[1] = encoder.mA;
+    mPattern.mQuadrature[2] = encoder.mA | encoder.mB;
+    mPattern.mQuadrature[3] = encoder.mB;
+    mPattern.mIndex = encoder.mZ;
+  }
+  if(encoder.mPolePairs)
+  {
+    // u, v and w high for half a turn each, 120 degrees apart
+    const uint32_t hall[] = {encoder.mU | encoder.mW, encoder.mU, encoder.mU | encoder.mV,
+      encoder.mV, encoder.mV | encoder.mW, encoder.mW};
+    memcpy(mPattern.mHall, hall, sizeof(hall));
+  }
+}
+
+int PositionSensorEmulator::Open()
+{
+  const auto &resolver = mConfig.mResolver;
+  const auto &encoder = mConfig.mEncoder;
+  if(!mUseAo && !mUseDo)
+  {
+    printf("%s: Neither a resolver, an encoder nor halls to emulate.\n", mName);
+    return -1;
+  }
+  if(mConfig.mAnalogPeriodTicks < PositionSensorLimit::kMinAnalogPeriodTicks ||
+    (mUseDo && mConfig.mDigitalPeriodTicks < kMinDigitalPeriodTicks))
+  {
+    printf("%s: An analog period of at least %u ticks and a digital one of at least %u "
+      "expected.\n", mName, PositionSensorLimit::kMinAnalogPeriodTicks, kMinDigitalPeriodTicks);
+    return -1;
+  }
+  if(mUseAo && (resolver.mPolePairs == 0 || resolver.mRatio <= 0.f))
+  {
+    printf("%s: A resolver needs pole pairs and a ratio.\n", mName);
+    return -1;
+  }
+  if((encoder.mLines && (encoder.mA == 0 || encoder.mB == 0)) ||
+    (encoder.mPolePairs && (encoder.mU == 0 || encoder.mV == 0 || encoder.mW == 0)))
+  {
+    printf("%s: An encoder needs lines a and b, halls need lines u, v and w.\n", mName);
+    return -1;
+  }
+  // the resolver reads up to two of the slowest carrier periods and a block behind the
+  // write-ahead, and the output rings hold the write-ahead with a poll to spare
+  const auto leadFrames = mLeadTicks / mConfig.mAnalogPeriodTicks;
+  const auto slowestFrames = static_cast<unsigned long long>(kTimebaseHz /
+    mConfig.mAnalogPeriodTicks / PositionSensorLimit::kMinExcitationHz);
+  const auto ringFrames = [](const uint32_t frameBytes)
+  {
+    return NiServiceLimit::kRingBlocks / 2 * (NiServiceLimit::kBlockBytes / frameBytes);
+  };
+  if(mLeadTicks < 2 * mConfig.mAnalogPeriodTicks ||
+    (mUseAo && leadFrames + 2 * slowestFrames + NiServiceLimit::kBlockBytes / kAoFrameBytes + 2 >=
+      PositionSensorLimit::kHistoryFrames) ||
+    (mUseAo && leadFrames > ringFrames(kAoFrameBytes)) ||
+    (mUseDo && mLeadTicks / mConfig.mDigitalPeriodTicks > ringFrames(kDoFrameBytes)))
+  {
+    printf("%s: A write-ahead of %llu ns does not fit the excitation history or the output "
+      "rings.\n", mName, mConfig.mWriteAheadNs);
+    return -1;
+  }
+
+  if(mService->EnableAi(NiAiConfig{1, nNISTC3::kInput_10V, nAI::kDifferential,
+    mConfig.mAnalogPeriodTicks}))
+    return -1;
+  if(mUseAo && mService->EnableAo(NiAoConfig{2, nNISTC3::kOutput_10V,
+    mConfig.mAnalogPeriodTicks}))
+    return -1;
+  if(mUseDo)
+  {
+    const auto lines = encoder.mA | encoder.mB | encoder.mZ | encoder.mU | encoder.mV |
+      encoder.mW;
+    if(mService->EnableDo(NiDioConfig{lines, mConfig.mDigitalPeriodTicks}))
+      return -1;
+    if(mService->FrameBytes(nNISTC3::kDO_DMAChannel) != kDoFrameBytes)
+    {
+      printf("%s: The encoder and halls need a port 0 of 32 lines.\n", mName);
+      return -1;
+    }
+  }
+  return 0;
+}
+
+int PositionSensorEmulator::Start()
+{
+  ReadAngles();
+  // a lower bound until the first ai samples tell
+  mOffsetNs = static_cast<long long>(mClock());
+  mWindowOffsetNs = mLastWindowOffsetNs = LLONG_MAX;
+  mWindowPolls = 0;
+  mInputFrames = mAoFrames = mDoFrames = 0;
+  mMean = mDeviation = 0.f;
+  mArmed = false;
+  mNumCrossings = 0;
+  mPeriodFrames = 0.;
+
+  if(mUseAo)
+    WriteAo(mLeadTicks);
+  if(mUseDo)
+    WriteDo(mLeadTicks);
+  if(mService->Start())
+    return -1;
+  mRunning = true;
+  return 0;
+}
+
+void PositionSensorEmulator::ReadAngles()
+{
+  AngleSample sample;
+  while(mAngles.Pop(sample))
+  {
+    mLatest = sample;
+    ++mCounters.mAngles;
+  }
+}
+
+void PositionSensorEmulator::ReadExcitation()
+{
+  auto &ring = mService->Ring(nNISTC3::kAI_DMAChannel);
+  float *const channels[] = {mVolts};
+  NiStreamBlock *block;
+  while((block = ring.Peek()) != NULL)
+  {
+    const auto numFrames = block->mBytes / sizeof(int16_t);
+    ScaleAi(mService->AiScaling(), reinterpret_cast<const int16_t*>(block->mData), numFrames,
+      channels);
+    Track(mVolts, numFrames);
+    // the last sample of the block was taken no later than the poll that read it
+    const auto gapNs = static_cast<long long>(block->mNs) -
+      static_cast<long long>(mInputFrames * mConfig.mAnalogPeriodTicks * kNsPerTick);
+    if(gapNs < mWindowOffsetNs)
+      mWindowOffsetNs = gapNs;
+    ring.Release();
+  }
+
+  const auto smallest = mWindowOffsetNs < mLastWindowOffsetNs ? mWindowOffsetNs :
+    mLastWindowOffsetNs;
+  if(smallest != LLONG_MAX)
+    mOffsetNs = smallest;
+  if(++mWindowPolls == PositionSensorLimit::kOffsetWindow)
+  {
+    mLastWindowOffsetNs = mWindowOffsetNs;
+    mWindowOffsetNs = LLONG_MAX;
+    mWindowPolls = 0;
+  }
+}
+
+void PositionSensorEmulator::Track(const float *volts, const uint32_t numFrames)
+{
+  const auto framesPerSecond = kTimebaseHz / mConfig.mAnalogPeriodTicks;
+  const auto shortest = framesPerSecond / PositionSensorLimit::kMaxExcitationHz;
+  const auto longest = framesPerSecond / PositionSensorLimit::kMinExcitationHz;
+  for(auto i{0u}; i < numFrames; ++i, ++mInputFrames)
+  {
+    const auto value = volts[i];
+    const auto slot = mInputFrames & (PositionSensorLimit::kHistoryFrames - 1);
+    mExcitation[slot] = value;
+    mExcitation[slot + PositionSensorLimit::kHistoryFrames] = value;
+
+    const auto deviation = value - mMean;
+    mMean += deviation * kMeanGain;
+    if(deviation < -kHysteresisVolts)
+    {
+      mArmed = true;
+    }
+    else if(mArmed && deviation >= 0.f && mDeviation < 0.f)
+    {
+      mArmed = false;
+      // between the last sample and this one
+      const auto position = static_cast<double>(mInputFrames) - 1. +
+        mDeviation / (mDeviation - deviation);
+      if(mNumCrossings > 0)
+      {
+        // a period off the range or the running estimate starts the measurement over
+        const auto interval = position - mCrossings[mNewestCrossing];
+        if(interval < shortest || interval > longest ||
+          (mPeriodFrames > 0. && fabs(interval - mPeriodFrames) > mPeriodFrames / 4.))
+        {
+          mNumCrossings = 0;
+          mPeriodFrames = 0.;
+        }
+      }
+      mNewestCrossing = (mNewestCrossing + 1) % PositionSensorLimit::kCrossings;
+      mCrossings[mNewestCrossing] = position;
+      if(mNumCrossings < PositionSensorLimit::kCrossings)
+        ++mNumCrossings;
+      if(mNumCrossings == PositionSensorLimit::kCrossings)
+      {
+        const auto oldest = mCrossings[(mNewestCrossing + 1) % PositionSensorLimit::kCrossings];
+        mPeriodFrames = (position - oldest) / (PositionSensorLimit::kCrossings - 1);
+      }
+    }
+    mDeviation = deviation;
+  }
+}
+
+bool PositionSensorEmulator::Locked() const
+{
+  return mPeriodFrames > 0. &&
+    mInputFrames - mCrossings[mNewestCrossing] < 2. * mPeriodFrames;
+}
+
+double PositionSensorEmulator::ExcitationHz() const
+{
+  return Locked() ? kTimebaseHz / mConfig.mAnalogPeriodTicks / mPeriodFrames : 0.;
+}
+
+// mechanical angle at a board time, extrapolated from the latest published one
+double PositionSensorEmulator::AngleAt(const unsigned long long ticks) const
+{
+  const auto ns = mOffsetNs + static_cast<long long>(ticks * kNsPerTick) -
+    static_cast<long long>(mLatest.mNs);
+  return mLatest.mAngleRad + mLatest.mRpm * kRadPerSecondPerRpm * ns * 1e-9;
+}
+
+// ao frame n goes out at board time (n + 1) periods
+void PositionSensorEmulator::WriteAo(const unsigned long long targetTicks)
+{
+  const auto &resolver = mConfig.mResolver;
+  const auto periodTicks = mConfig.mAnalogPeriodTicks;
+  const auto dueFrames = targetTicks / periodTicks;
+  const auto maxFrames = NiServiceLimit::kBlockBytes / kAoFrameBytes;
+  const auto leadFrames = static_cast<double>(mLeadTicks) / periodTicks + 2.;
+  auto &ring = mService->Ring(nNISTC3::kAO_DMAChannel);
+  const float *const channels[] = {mSine, mCosine};
+  NiStreamBlock *block;
+  while(mAoFrames < dueFrames && (block = ring.Reserve()) != NULL)
+  {
+    const auto numFrames = static_cast<uint32_t>(dueFrames - mAoFrames < maxFrames ?
+      dueFrames - mAoFrames : maxFrames);
+    // whole carrier periods and the shift behind, past the last sample and its successor
+    auto position{-1.};
+    if(Locked())
+    {
+      const auto shiftFrames = resolver.mPhaseShiftRad / kTwoPi * mPeriodFrames;
+      const auto delayFrames = ceil((leadFrames - shiftFrames) / mPeriodFrames) *
+        mPeriodFrames + shiftFrames;
+      position = static_cast<double>(mAoFrames) - delayFrames;
+    }
+    if(position >= 0.)
+    {
+      const auto first = floor(position);
+      const auto *excitation = &mExcitation[static_cast<unsigned long long>(first) &
+        (PositionSensorLimit::kHistoryFrames - 1)];
+      const auto electrical = resolver.mPolePairs * AngleAt((mAoFrames + 1) * periodTicks) +
+        resolver.mOffsetRad;
+      const SampleRamp angle{
+        static_cast<float>(electrical - kTwoPi * floor(electrical / kTwoPi + 0.5)),
+        static_cast<float>(resolver.mPolePairs * mLatest.mRpm * kRadPerSecondPerRpm *
+          periodTicks / kTimebaseHz)};
+      SynthesizeResolver(excitation, static_cast<float>(position - first), resolver.mRatio,
+        angle, numFrames, mSine, mCosine);
+    }
+    else
+    {
+      memset(mSine, 0, numFrames * sizeof(float));
+      memset(mCosine, 0, numFrames * sizeof(float));
+      mCounters.mUnlocked += numFrames;
+    }
+    ScaleAo(mService->AoScaling(), channels, numFrames,
+      reinterpret_cast<int16_t*>(block->mData));
+    block->mBytes = numFrames * kAoFrameBytes;
+    ring.Commit();
+    mAoFrames += numFrames;
+    mCounters.mAoFrames += numFrames;
+  }
+}
+
+void PositionSensorEmulator::WriteDo(const unsigned long long targetTicks)
+{
+  const auto &encoder = mConfig.mEncoder;
+  const auto periodTicks = mConfig.mDigitalPeriodTicks;
+  const auto dueFrames = targetTicks / periodTicks;
+  const auto maxFrames = NiServiceLimit::kBlockBytes / kDoFrameBytes;
+  const auto countsPerRad = mPattern.mCounts / kTwoPi;
+  const auto sixthsPerRad = encoder.mPolePairs * 6. / kTwoPi;
+  auto &ring = mService->Ring(nNISTC3::kDO_DMAChannel);
+  NiStreamBlock *block;
+  while(mDoFrames < dueFrames && (block = ring.Reserve()) != NULL)
+  {
+    const auto numFrames = static_cast<uint32_t>(dueFrames - mDoFrames < maxFrames ?
+      dueFrames - mDoFrames : maxFrames);
+    const auto mechanical = AngleAt((mDoFrames + 1) * periodTicks);
+    const auto stepRad = mLatest.mRpm * kRadPerSecondPerRpm * periodTicks / kTimebaseHz;
+    auto counts = (mechanical - encoder.mOffsetRad) * countsPerRad;
+    counts -= mPattern.mCounts * floor(counts / mPattern.mCounts);
+    auto sixths = (mechanical * encoder.mPolePairs - encoder.mHallOffsetRad) * 6. / kTwoPi;
+    sixths -= 6. * floor(sixths / 6.);
+    SynthesizeEncoder(mPattern,
+      SampleRamp{static_cast<float>(counts), static_cast<float>(stepRad * countsPerRad)},
+      SampleRamp{static_cast<float>(sixths), static_cast<float>(stepRad * sixthsPerRad)},
+      numFrames, reinterpret_cast<uint32_t*>(block->mData));
+    block->mBytes = numFrames * kDoFrameBytes;
+    ring.Commit();
+    mDoFrames += numFrames;
+    mCounters.mDoFrames += numFrames;
+  }
+}
+
+int PositionSensorEmulator::Poll()
+{
+  if(!mRunning)
+    return -1;
+
+  const auto result = mService->Poll();
+  const auto beginNs = mClock();
+  ReadAngles();
+  ReadExcitation();
+  const auto inputTicks = mInputFrames * mConfig.mAnalogPeriodTicks;
+  if((mUseAo && (mAoFrames + 1) * mConfig.mAnalogPeriodTicks <= inputTicks) ||
+    (mUseDo && (mDoFrames + 1) * mConfig.mDigitalPeriodTicks <= inputTicks))
+    ++mCounters.mBehind;
+  if(mUseAo)
+    WriteAo(inputTicks + mLeadTicks);
+  if(mUseDo)
+    WriteDo(inputTicks + mLeadTicks);
+
+  const auto synthesisNs = mClock() - beginNs;
+  mCounters.mSynthesisNs += synthesisNs;
+  if(synthesisNs > mCounters.mMaxSynthesisNs)
+    mCounters.mMaxSynthesisNs = synthesisNs;
+  ++mCounters.mPolls;
+  return result < 0 ? -1 : 0;
+}
+
+void PositionSensorEmulator::Stop()
+{
+  if(!mRunning)
+    return;
+  mService->Stop();
+  mRunning = false;
+}
+
+void PositionSensorEmulator::PrintStats(const unsigned long long elapsedNs,
+  int (*print)(const char*, ...))
+{
+  print("%s: excitation %.1f Hz, rt clock offset %lld ns, polls/s: %.0f, angles: %llu, "
+    "rejected: %llu, ao frames: %llu, unlocked: %llu, do frames: %llu, behind: %llu, "
+    "synthesis avg %.2f us, max %.2f us\n", mName, ExcitationHz(), mOffsetNs,
+    elapsedNs ? mCounters.mPolls * 1e9 / elapsedNs : 0., mCounters.mAngles,
+    mCounters.mRejected, mCounters.mAoFrames, mCounters.mUnlocked, mCounters.mDoFrames,
+    mCounters.mBehind, mCounters.mPolls ? mCounters.mSynthesisNs * 1e-3 / mCounters.mPolls : 0.,
+    mCounters.mMaxSynthesisNs * 1e-3);
+  mCounters.mPolls = 0;
+  mCounters.mSynthesisNs = 0;
+  mCounters.mMaxSynthesisNs = 0;
+  mService->PrintStats(elapsedNs, print);
+}
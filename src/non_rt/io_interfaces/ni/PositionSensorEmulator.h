@@ -0,0 +1,185 @@
+#ifndef _POSITIONSENSOREMULATOR_H_
+#define _POSITIONSENSOREMULATOR_H_
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include <memory>
+
+#include <NiDeviceService.h>
+#include <PositionSynthesis.h>
+#include <RtSpscRing.h>
+
+namespace PositionSensorLimit
+{
+constexpr auto kAngleRing = 64u; // angles published between two polls, a power of two
+constexpr auto kHistoryFrames = 8192u; // excitation kept, a power of two
+constexpr auto kCrossings = 16u; // rising crossings the excitation period is measured over
+constexpr auto kMinExcitationHz = 1000u;
+constexpr auto kMaxExcitationHz = 40000u;
+constexpr auto kMinAnalogPeriodTicks = 400u; // one ai channel converted on a mio device
+constexpr auto kOffsetWindow = 64u; // polls the rt clock offset is the smallest gap of
+}
+
+struct ResolverEmulation
+{
+  bool mEnabled;
+  float mRatio; // amplitude of the outputs over the excitation
+  uint32_t mPolePairs; // electrical turns per mechanical turn
+  float mOffsetRad; // electrical angle at mechanical 0
+  float mPhaseShiftRad; // carrier lag of the outputs behind the excitation
+};
+
+// port 0 line masks; an encoder without an index has mZ 0
+struct EncoderEmulation
+{
+  uint32_t mLines; // 0 for no encoder
+  uint32_t mA;
+  uint32_t mB;
+  uint32_t mZ;
+  float mOffsetRad; // mechanical angle of the index
+  uint32_t mPolePairs; // 0 for no halls
+  uint32_t mU;
+  uint32_t mV;
+  uint32_t mW;
+  float mHallOffsetRad; // electrical angle of the rising edge of u
+};
+
+struct PositionSensorConfig
+{
+  // ai0 scans the excitation and ao0 and ao1 update sine and cosine on this period; ai0
+  // also times the outputs when there is no resolver
+  uint32_t mAnalogPeriodTicks;
+  uint32_t mDigitalPeriodTicks; // do update
+  // outputs are computed this far ahead of the last ai sample, it must cover two polls
+  unsigned long long mWriteAheadNs;
+  ResolverEmulation mResolver;
+  EncoderEmulation mEncoder;
+};
+
+struct PositionSensorCounters
+{
+  unsigned long long mAngles;
+  // publishes that found the ring full
+  unsigned long long mRejected;
+  unsigned long long mAoFrames;
+  unsigned long long mDoFrames;
+  // ao frames that went out at 0 V while the excitation was not locked
+  unsigned long long mUnlocked;
+  // polls that computed outputs already due, the write-ahead was too short
+  unsigned long long mBehind;
+  // since the last PrintStats()
+  unsigned long long mPolls;
+  unsigned long long mSynthesisNs;
+  unsigned long long mMaxSynthesisNs;
+};
+
+/*
+ * resolver, encoder and hall signals of the model rotor angle on an ni device service
+ *
+ * the model step publishes its angle and speed with a time stamp. every poll the
+ * trajectory is extrapolated to the board time of each output sample, so the pipeline
+ * latency is compensated rather than added, and the signals of a poll are computed in
+ * blocks with the vectorized position synthesis. board time comes from ai0: sample n of
+ * every subsystem goes out n + 1 periods after the start, and the rt clock at board time
+ * 0 is the smallest gap between a poll and its last ai sample over kOffsetWindow polls,
+ * which follows the drift of the two clocks.
+ *
+ * the resolver outputs are the excitation the board captured, delayed by whole carrier
+ * periods and the phase shift and modulated with the sine and cosine of the electrical
+ * angle; the carrier period is measured from rising crossings of the excitation mean.
+ * they stay at 0 V while the excitation is not locked, as a resolver without excitation
+ * would. encoder quadrature, index and halls go out together on the do port.
+ */
+class PositionSensorEmulator
+{
+private:
+  struct AngleSample
+  {
+    unsigned long long mNs;
+    float mAngleRad;
+    float mRpm;
+  };
+
+  std::shared_ptr<NiDeviceService> mService;
+  unsigned long long (*mClock)();
+  const PositionSensorConfig mConfig;
+  EncoderPattern mPattern;
+  RtSpscRing<AngleSample, PositionSensorLimit::kAngleRing> mAngles;
+  AngleSample mLatest;
+  bool mUseAo;
+  bool mUseDo;
+  unsigned long long mLeadTicks;
+  // rt clock at board time 0, and the smallest gaps of this and the last window
+  long long mOffsetNs;
+  long long mWindowOffsetNs;
+  long long mLastWindowOffsetNs;
+  uint32_t mWindowPolls;
+  unsigned long long mInputFrames;
+  unsigned long long mAoFrames;
+  unsigned long long mDoFrames;
+  // excitation volts, every sample twice so that any window of the history is contiguous
+  float mExcitation[2 * PositionSensorLimit::kHistoryFrames];
+  float mMean;
+  float mDeviation;
+  bool mArmed;
+  double mCrossings[PositionSensorLimit::kCrossings]; // frame positions, a ring
+  uint32_t mNewestCrossing;
+  uint32_t mNumCrossings;
+  double mPeriodFrames; // excitation period, 0 while not locked
+  float mVolts[NiServiceLimit::kBlockBytes / sizeof(int16_t)];
+  float mSine[NiServiceLimit::kBlockBytes / sizeof(int16_t)];
+  float mCosine[NiServiceLimit::kBlockBytes / sizeof(int16_t)];
+  PositionSensorCounters mCounters;
+  bool mRunning;
+
+  void ReadAngles();
+  void ReadExcitation();
+  void Track(const float *volts, const uint32_t numFrames);
+  bool Locked() const;
+  double AngleAt(const unsigned long long ticks) const;
+  void WriteAo(const unsigned long long targetTicks);
+  void WriteDo(const unsigned long long targetTicks);
+
+public:
+  const char *mName;
+
+public:
+  PositionSensorEmulator() = delete;
+  PositionSensorEmulator(const char *name, std::shared_ptr<NiDeviceService> service,
+    unsigned long long (*clock)(), const PositionSensorConfig &config);
+
+  PositionSensorEmulator(const PositionSensorEmulator&) = delete;
+  PositionSensorEmulator& operator=(const PositionSensorEmulator&) = delete;
+
+  // enables ai, and ao and do as the sensors need them, on an opened service
+  int Open();
+  // computes the write-ahead from the latest angle, then starts the service
+  int Start();
+  // from the model step: the mechanical angle and speed now
+  int Publish(const float angleRad, const float rpm)
+  {
+    if(mAngles.Push(AngleSample{mClock(), angleRad, rpm}))
+      return 0;
+    ++mCounters.mRejected;
+    return -1;
+  }
+  // polls the service, then computes the outputs up to the write-ahead; -1 when a
+  // channel failed
+  int Poll();
+  void Stop();
+
+  // carrier frequency of the excitation, 0 while not locked
+  double ExcitationHz() const;
+  long long OffsetNs() const
+  {
+    return mOffsetNs;
+  }
+  const PositionSensorCounters& Counters() const
+  {
+    return mCounters;
+  }
+  void PrintStats(const unsigned long long elapsedNs, int (*print)(const char*, ...)=printf);
+};
+
+#endif // _POSITIONSENSOREMULATOR_H_
@@ -0,0 +1,261 @@
+#include <PositionSynthesis.h>
+
+#include <math.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define POSITION_SYNTHESIS_AVX2 1
+#include <immintrin.h>
+#endif
+
+namespace {
+
+// cephes sinf and cosf: reduction by pi / 4 in three parts, then one polynomial each
+constexpr auto kFourOverPi = 1.27323954473516f;
+constexpr auto kPiOver4Part1 = 0.78515625f;
+constexpr auto kPiOver4Part2 = 2.4187564849853515625e-4f;
+constexpr auto kPiOver4Part3 = 3.77489497744594108e-8f;
+constexpr auto kSin0 = -1.9515295891e-4f;
+constexpr auto kSin1 = 8.3321608736e-3f;
+constexpr auto kSin2 = -1.6666654611e-1f;
+constexpr auto kCos0 = 2.443315711809948e-5f;
+constexpr auto kCos1 = -1.388731625493765e-3f;
+constexpr auto kCos2 = 4.166664568298827e-2f;
+constexpr auto kOneSixth = 1.f / 6.f;
+
+void SinCos(const float x, float &sine, float &cosine)
+{
+  auto reduced = fabsf(x);
+  auto octant = static_cast<int>(reduced * kFourOverPi);
+  octant = (octant + 1) & ~1;
+  const auto y = static_cast<float>(octant);
+  reduced = ((reduced - y * kPiOver4Part1) - y * kPiOver4Part2) - y * kPiOver4Part3;
+  const auto z = reduced * reduced;
+  const auto cosinePoly = ((kCos0 * z + kCos1) * z + kCos2) * z * z - z * 0.5f + 1.f;
+  const auto sinePoly = ((kSin0 * z + kSin1) * z + kSin2) * z * reduced + reduced;
+  const auto swap = (octant & 2) != 0;
+  sine = swap ? cosinePoly : sinePoly;
+  cosine = swap ? sinePoly : cosinePoly;
+  if(signbit(x) != ((octant & 4) != 0))
+    sine = -sine;
+  if(((octant - 2) & 4) == 0)
+    cosine = -cosine;
+}
+
+int Wrap(const float value, const float period, const float inversePeriod, const int last)
+{
+  const auto wrapped = value - period * floorf(value * inversePeriod);
+  const auto index = static_cast<int>(floorf(wrapped));
+  return index < 0 ? 0 : index > last ? last : index;
+}
+
+#ifdef POSITION_SYNTHESIS_AVX2
+__attribute__((target("avx2")))
+inline void SinCosAvx2(__m256 x, __m256 &sine, __m256 &cosine)
+{
+  const auto signMask = _mm256_set1_ps(-0.f);
+  const auto two = _mm256_set1_epi32(2);
+  const auto four = _mm256_set1_epi32(4);
+  auto sineSign = _mm256_and_ps(x, signMask);
+  x = _mm256_andnot_ps(signMask, x);
+  auto octant = _mm256_cvttps_epi32(_mm256_mul_ps(x, _mm256_set1_ps(kFourOverPi)));
+  octant = _mm256_and_si256(_mm256_add_epi32(octant, _mm256_set1_epi32(1)),
+    _mm256_set1_epi32(~1));
+  const auto y = _mm256_cvtepi32_ps(octant);
+  sineSign = _mm256_xor_ps(sineSign,
+    _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_and_si256(octant, four), 29)));
+  const auto cosineSign = _mm256_castsi256_ps(
+    _mm256_slli_epi32(_mm256_andnot_si256(_mm256_sub_epi32(octant, two), four), 29));
+  const auto keep = _mm256_castsi256_ps(
+    _mm256_cmpeq_epi32(_mm256_and_si256(octant, two), _mm256_setzero_si256()));
+
+  x = _mm256_sub_ps(x, _mm256_mul_ps(y, _mm256_set1_ps(kPiOver4Part1)));
+  x = _mm256_sub_ps(x, _mm256_mul_ps(y, _mm256_set1_ps(kPiOver4Part2)));
+  x = _mm256_sub_ps(x, _mm256_mul_ps(y, _mm256_set1_ps(kPiOver4Part3)));
+  const auto z = _mm256_mul_ps(x, x);
+  auto cosinePoly = _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(kCos0), z),
+    _mm256_set1_ps(kCos1));
+  cosinePoly = _mm256_add_ps(_mm256_mul_ps(cosinePoly, z), _mm256_set1_ps(kCos2));
+  cosinePoly = _mm256_mul_ps(_mm256_mul_ps(cosinePoly, z), z);
+  cosinePoly = _mm256_sub_ps(cosinePoly, _mm256_mul_ps(z, _mm256_set1_ps(0.5f)));
+  cosinePoly = _mm256_add_ps(cosinePoly, _mm256_set1_ps(1.f));
+  auto sinePoly = _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(kSin0), z),
+    _mm256_set1_ps(kSin1));
+  sinePoly = _mm256_add_ps(_mm256_mul_ps(sinePoly, z), _mm256_set1_ps(kSin2));
+  sinePoly = _mm256_add_ps(_mm256_mul_ps(_mm256_mul_ps(sinePoly, z), x), x);
+
+  sine = _mm256_xor_ps(_mm256_blendv_ps(cosinePoly, sinePoly, keep), sineSign);
+  cosine = _mm256_xor_ps(_mm256_blendv_ps(sinePoly, cosinePoly, keep), cosineSign);
+}
+
+__attribute__((target("avx2")))
+inline __m256i WrapAvx2(const __m256 value, const __m256 period, const __m256 inversePeriod,
+  const __m256i last)
+{
+  const auto wrapped = _mm256_sub_ps(value,
+    _mm256_mul_ps(period, _mm256_floor_ps(_mm256_mul_ps(value, inversePeriod))));
+  const auto index = _mm256_cvttps_epi32(_mm256_floor_ps(wrapped));
+  return _mm256_min_epi32(_mm256_max_epi32(index, _mm256_setzero_si256()), last);
+}
+
+__attribute__((target("avx2")))
+void SynthesizeResolverAvx2(const float *excitation, const float fraction, const float ratio,
+  const SampleRamp &angle, const unsigned int numSamples, float *sine, float *cosine)
+{
+  const auto vectorSamples = numSamples & ~7u;
+  const auto start = _mm256_set1_ps(angle.mStart);
+  const auto step = _mm256_set1_ps(angle.mStep);
+  const auto between = _mm256_set1_ps(fraction);
+  const auto gain = _mm256_set1_ps(ratio);
+  auto index = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+  const auto eight = _mm256_set1_epi32(8);
+  auto k{0u};
+  for(; k < vectorSamples; k += 8)
+  {
+    const auto a = _mm256_add_ps(start, _mm256_mul_ps(_mm256_cvtepi32_ps(index), step));
+    const auto x0 = _mm256_loadu_ps(excitation + k);
+    const auto x1 = _mm256_loadu_ps(excitation + k + 1);
+    const auto e = _mm256_mul_ps(_mm256_add_ps(x0, _mm256_mul_ps(between,
+      _mm256_sub_ps(x1, x0))), gain);
+    __m256 s;
+    __m256 c;
+    SinCosAvx2(a, s, c);
+    _mm256_storeu_ps(sine + k, _mm256_mul_ps(e, s));
+    _mm256_storeu_ps(cosine + k, _mm256_mul_ps(e, c));
+    index = _mm256_add_epi32(index, eight);
+  }
+  for(; k < numSamples; ++k)
+  {
+    const auto a = angle.mStart + static_cast<float>(k) * angle.mStep;
+    const auto e = (excitation[k] + fraction * (excitation[k + 1] - excitation[k])) * ratio;
+    float s;
+    float c;
+    SinCos(a, s, c);
+    sine[k] = e * s;
+    cosine[k] = e * c;
+  }
+}
+
+__attribute__((target("avx2")))
+void SynthesizeEncoderAvx2(const EncoderPattern &pattern, const SampleRamp &counts,
+  const SampleRamp &sixths, const unsigned int numSamples, uint32_t *port)
+{
+  const auto vectorSamples = numSamples & ~7u;
+  const auto countStart = _mm256_set1_ps(counts.mStart);
+  const auto countStep = _mm256_set1_ps(counts.mStep);
+  const auto countPeriod = _mm256_set1_ps(pattern.mCounts);
+  const auto inverseCounts = _mm256_set1_ps(1.f / pattern.mCounts);
+  const auto lastCount = _mm256_set1_epi32(static_cast<int>(pattern.mCounts) - 1);
+  const auto sixthStart = _mm256_set1_ps(sixths.mStart);
+  const auto sixthStep = _mm256_set1_ps(sixths.mStep);
+  const auto sixthPeriod = _mm256_set1_ps(6.f);
+  const auto inverseSixths = _mm256_set1_ps(kOneSixth);
+  const auto lastSixth = _mm256_set1_epi32(5);
+  const auto quadrature = _mm256_setr_epi32(pattern.mQuadrature[0], pattern.mQuadrature[1],
+    pattern.mQuadrature[2], pattern.mQuadrature[3], pattern.mQuadrature[0],
+    pattern.mQuadrature[1], pattern.mQuadrature[2], pattern.mQuadrature[3]);
+  const auto hall = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(pattern.mHall));
+  const auto indexBits = _mm256_set1_epi32(static_cast<int>(pattern.mIndex));
+  auto index = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+  const auto eight = _mm256_set1_epi32(8);
+  auto k{0u};
+  for(; k < vectorSamples; k += 8)
+  {
+    const auto kf = _mm256_cvtepi32_ps(index);
+    const auto count = WrapAvx2(_mm256_add_ps(countStart, _mm256_mul_ps(kf, countStep)),
+      countPeriod, inverseCounts, lastCount);
+    const auto sixth = WrapAvx2(_mm256_add_ps(sixthStart, _mm256_mul_ps(kf, sixthStep)),
+      sixthPeriod, inverseSixths, lastSixth);
+    auto value = _mm256_permutevar8x32_epi32(quadrature, count);
+    value = _mm256_or_si256(value, _mm256_and_si256(indexBits,
+      _mm256_cmpeq_epi32(count, _mm256_setzero_si256())));
+    value = _mm256_or_si256(value, _mm256_permutevar8x32_epi32(hall, sixth));
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(port + k), value);
+    index = _mm256_add_epi32(index, eight);
+  }
+  const auto last = static_cast<int>(pattern.mCounts) - 1;
+  for(; k < numSamples; ++k)
+  {
+    const auto kf = static_cast<float>(k);
+    const auto count = Wrap(counts.mStart + kf * counts.mStep, pattern.mCounts,
+      1.f / pattern.mCounts, last);
+    const auto sixth = Wrap(sixths.mStart + kf * sixths.mStep, 6.f, kOneSixth, 5);
+    port[k] = pattern.mQuadrature[count & 3] | (count == 0 ? pattern.mIndex : 0) |
+      pattern.mHall[sixth];
+  }
+}
+#endif
+
+bool DetectAvx2()
+{
+#ifdef POSITION_SYNTHESIS_AVX2
+  return __builtin_cpu_supports("avx2");
+#else
+  return false;
+#endif
+}
+
+} // namespace
+
+void SynthesizeResolverScalar(const float *excitation, const float fraction,
+  const float ratio, const SampleRamp &angle, const unsigned int numSamples, float *sine,
+  float *cosine)
+{
+  for(auto k{0u}; k < numSamples; ++k)
+  {
+    const auto a = angle.mStart + static_cast<float>(k) * angle.mStep;
+    const auto e = (excitation[k] + fraction * (excitation[k + 1] - excitation[k])) * ratio;
+    float s;
+    float c;
+    SinCos(a, s, c);
+    sine[k] = e * s;
+    cosine[k] = e * c;
+  }
+}
+
+void SynthesizeEncoderScalar(const EncoderPattern &pattern, const SampleRamp &counts,
+  const SampleRamp &sixths, const unsigned int numSamples, uint32_t *port)
+{
+  const auto inverseCounts = 1.f / pattern.mCounts;
+  const auto last = static_cast<int>(pattern.mCounts) - 1;
+  for(auto k{0u}; k < numSamples; ++k)
+  {
+    const auto kf = static_cast<float>(k);
+    const auto count = Wrap(counts.mStart + kf * counts.mStep, pattern.mCounts,
+      inverseCounts, last);
+    const auto sixth = Wrap(sixths.mStart + kf * sixths.mStep, 6.f, kOneSixth, 5);
+    port[k] = pattern.mQuadrature[count & 3] | (count == 0 ? pattern.mIndex : 0) |
+      pattern.mHall[sixth];
+  }
+}
+
+bool SynthesisUsesAvx2()
+{
+  static const bool useAvx2 = DetectAvx2();
+  return useAvx2;
+}
+
+void SynthesizeResolver(const float *excitation, const float fraction, const float ratio,
+  const SampleRamp &angle, const unsigned int numSamples, float *sine, float *cosine)
+{
+#ifdef POSITION_SYNTHESIS_AVX2
+  if(SynthesisUsesAvx2())
+  {
+    SynthesizeResolverAvx2(excitation, fraction, ratio, angle, numSamples, sine, cosine);
+    return;
+  }
+#endif
+  SynthesizeResolverScalar(excitation, fraction, ratio, angle, numSamples, sine, cosine);
+}
+
+void SynthesizeEncoder(const EncoderPattern &pattern, const SampleRamp &counts,
+  const SampleRamp &sixths, const unsigned int numSamples, uint32_t *port)
+{
+#ifdef POSITION_SYNTHESIS_AVX2
+  if(SynthesisUsesAvx2())
+  {
+    SynthesizeEncoderAvx2(pattern, counts, sixths, numSamples, port);
+    return;
+  }
+#endif
+  SynthesizeEncoderScalar(pattern, counts, sixths, numSamples, port);
+}
@@ -0,0 +1,53 @@
+#ifndef _POSITIONSYNTHESIS_H_
+#define _POSITIONSYNTHESIS_H_
+
+#include <stdint.h>
+
+// a quantity that moves by the same step every sample: sample k is mStart + k * mStep
+struct SampleRamp
+{
+  float mStart;
+  float mStep;
+};
+
+// port 0 bits of the encoder and hall lines in every state
+struct EncoderPattern
+{
+  float mCounts; // quadrature counts per turn, four per line
+  uint32_t mQuadrature[4]; // a and b of count modulo 4
+  uint32_t mIndex; // z, high for count 0
+  uint32_t mHall[8]; // u, v and w of each sixth of an electrical turn, 6 and 7 unused
+};
+
+/*
+ * position sensor waveforms from a block of the rotor angle trajectory
+ *
+ * the angle moves linearly over a block, so every sensor signal is a function of a
+ * ramp. SynthesizeResolver() modulates the excitation the board captured with the sine
+ * and the cosine of the electrical angle, reading the excitation between two of its
+ * samples at a fixed fraction. SynthesizeEncoder() turns a ramp of quadrature counts and
+ * one of sixths of an electrical turn into do port samples. the sine and cosine are a
+ * range reduced cephes polynomial evaluated with a multiply then an add at every step,
+ * so on cpus with avx2 eight samples go at once and still match the portable kernels
+ * bit for bit; the choice is made on the first call.
+ */
+
+// sine[k] and cosine[k] = ratio * excitation at k + fraction * sin and cos of angle k;
+// excitation holds numSamples + 1 volts
+void SynthesizeResolver(const float *excitation, const float fraction, const float ratio,
+  const SampleRamp &angle, const unsigned int numSamples, float *sine, float *cosine);
+// port[k] from count k of counts and sixth k of sixths, both wrapped into a turn
+void SynthesizeEncoder(const EncoderPattern &pattern, const SampleRamp &counts,
+  const SampleRamp &sixths, const unsigned int numSamples, uint32_t *port);
+
+// the portable kernels, for comparison
+void SynthesizeResolverScalar(const float *excitation, const float fraction,
+  const float ratio, const SampleRamp &angle, const unsigned int numSamples, float *sine,
+  float *cosine);
+void SynthesizeEncoderScalar(const EncoderPattern &pattern, const SampleRamp &counts,
+  const SampleRamp &sixths, const unsigned int numSamples, uint32_t *port);
+
+// true when the synthesis runs the avx2 kernels
+bool SynthesisUsesAvx2();
+
+#endif // _POSITIONSYNTHESIS_H_
@@ -0,0 +1,376 @@
+#include <PwmCapture.h>
+
+#include <string.h>
+
+#include "devices.h"
+#include "simultaneousInit.h"
+
+namespace {
+
+constexpr auto kSampleSizeInBytes = sizeof(u32);
+constexpr auto kDmaSizeInBytes =
+  PwmCaptureLimit::kDmaBufferFactor * PwmCaptureLimit::kSamplesPerRead * kSampleSizeInBytes;
+
+} // namespace
+
+PwmCapture::PwmCapture(const char *name, iBus *bus, unsigned long long (*clock)())
+  : mBus(bus)
+  , mSample{}
+  , mClock(clock)
+  , mRunning(false)
+  , mName(name)
+{
+  for(auto &phase : mPhases)
+  {
+    phase.mCounter = NULL;
+    phase.mCounters = PwmCaptureCounters{};
+    phase.mUpdated = false;
+    phase.mStalled = false;
+  }
+}
+
+int PwmCapture::Open()
+{
+  nMDBG::tStatus2 status;
+  mBar0 = mBus->createAddressSpace(kPCI_BAR0);
+  mDevice = std::make_unique<tXSeries>(mBar0, &status);
+
+  const nNISTC3::tDeviceInfo *deviceInfo = nNISTC3::getDeviceInfo(*mDevice, status);
+  if(status.isFatal())
+  {
+    printf("%s: Cannot identify device (%d).\n", mName, status.statusCode);
+    return -1;
+  }
+  if(deviceInfo->isSimultaneous)
+    nNISTC3::initializeSimultaneousXSeries(*mDevice, status);
+
+  // phase u, v and w on counters 0, 1 and 2, gated by PFI0, PFI1 and PFI2
+  mPhases[0].mCounter = &mDevice->Counter0;
+  mPhases[0].mDmaChannel = nNISTC3::kCounter0DmaChannel;
+  mPhases[0].mGate = nCounter::kGate_PFI0;
+  mPhases[1].mCounter = &mDevice->Counter1;
+  mPhases[1].mDmaChannel = nNISTC3::kCounter1DmaChannel;
+  mPhases[1].mGate = nCounter::kGate_PFI1;
+  mPhases[2].mCounter = &mDevice->Counter2;
+  mPhases[2].mDmaChannel = nNISTC3::kCounter2DmaChannel;
+  mPhases[2].mGate = nCounter::kGate_PFI2;
+  // the rings and their links come from one mapped and locked pool, reopening reuses it
+  if(mBus->getDMAPool() == NULL && mBus->reserveDMA(PwmCaptureLimit::kDmaPoolBytes))
+    printf("%s: No DMA pool, the rings come from the driver one by one.\n", mName);
+
+  tStreamCircuitRegMap *streamCircuits[] = {&mDevice->Counter0StreamCircuit,
+    &mDevice->Counter1StreamCircuit, &mDevice->Counter2StreamCircuit};
+
+  // all PFI lines are inputs
+  mDevice->Triggers.PFI_Direction_Register.writeRegister(0x0, &status);
+
+  for(auto i{0u}; i < PwmCaptureLimit::kNumPhases; ++i)
+  {
+    auto &phase = mPhases[i];
+    phase.mStreamHelper = std::make_unique<nNISTC3::streamHelper>(*streamCircuits[i],
+      mDevice->CHInCh, status);
+    phase.mResetHelper = std::make_unique<nNISTC3::counterResetHelper>(*phase.mCounter,
+      kFalse, status);
+    if(ConfigureCounter(phase, status))
+      return -1;
+
+    phase.mDma = std::make_unique<nNISTC3::tCHInChDMAChannel>(*mDevice, phase.mDmaChannel,
+      status);
+    if(status.isFatal())
+    {
+      printf("%s: DMA channel initialization for phase %d (%d).\n", mName, i,
+        status.statusCode);
+      return -1;
+    }
+    phase.mDma->reset(status);
+    // the optimized 2-link sgl ring, as in gpctex5
+    phase.mDma->configure(mBus, nNISTC3::kReuseLinkRing, nNISTC3::kIn, kDmaSizeInBytes, status);
+    if(status.isFatal())
+    {
+      printf("%s: DMA channel configuration for phase %d (%d).\n", mName, i,
+        status.statusCode);
+      return -1;
+    }
+  }
+  return 0;
+}
+
+void ProgramSemiPeriodCounter(tCounter &counter, const nCounter::tGi_Gate_Select_t gate,
+  nMDBG::tStatus2 &status)
+{
+  counter.Gi_Mode_Register.setGi_Reload_Source_Switching(nCounter::kUseSameLoadRegister, &status);
+  counter.Gi_Mode_Register.setGi_Loading_On_Gate(nCounter::kReloadOnStopGate, &status);
+  counter.Gi_Mode_Register.setGi_ForceSourceEqualToTimebase(kFalse, &status);
+  counter.Gi_Mode_Register.setGi_Loading_On_TC(nCounter::kRolloverOnTC, &status);
+  counter.Gi_Mode_Register.setGi_Counting_Once(nCounter::kNoHardwareDisarm, &status);
+  counter.Gi_Mode_Register.setGi_Load_Source_Select(nCounter::kLoad_From_Register_A, &status);
+  counter.Gi_Mode_Register.setGi_Stop_Mode(nCounter::kStopOnGateCondition, &status);
+  counter.Gi_Mode_Register.setGi_Gate_On_Both_Edges(nCounter::kEnabled, &status);
+  counter.Gi_Mode_Register.setGi_Gating_Mode(nCounter::kDeassertingEdgeGating, &status);
+  counter.Gi_Mode_Register.setGi_Trigger_Mode_For_Edge_Gate(nCounter::kGateLoads, &status);
+  counter.Gi_Mode_Register.flush(&status);
+
+  counter.Gi_Mode2_Register.setGi_Up_Down(nCounter::kCountUp, &status);
+  counter.Gi_Mode2_Register.setGi_Bank_Switch_Enable(nCounter::kDisabled_If_Armed_Else_Write_To_X, &status);
+  counter.Gi_Mode2_Register.setGi_Bank_Switch_Mode(nCounter::kSoftware, &status);
+  counter.Gi_Mode2_Register.setGi_StopOnError(kFalse, &status);
+  counter.Gi_Mode2_Register.flush(&status);
+
+  counter.Gi_Counting_Mode_Register.setGi_Prescale(kFalse, &status);
+  counter.Gi_Counting_Mode_Register.setGi_HW_Arm_Enable(kFalse, &status);
+  counter.Gi_Counting_Mode_Register.setGi_Index_Mode(nCounter::kIndexModeCleared, &status);
+  counter.Gi_Counting_Mode_Register.setGi_Counting_Mode(nCounter::kNormalCounting, &status);
+  counter.Gi_Counting_Mode_Register.flush(&status);
+
+  counter.Gi_SampleClockRegister.setGi_SampleClockMode(nCounter::kSC_Disabled, &status);
+  counter.Gi_SampleClockRegister.flush(&status);
+  counter.Gi_AuxCtrRegister.writeGi_AuxCtrMode(nCounter::kAux_Disabled, &status);
+  counter.Gi_Second_Gate_Register.setGi_Second_Gate_Mode(nCounter::kDisabledSecondGate, &status);
+  counter.Gi_Second_Gate_Register.flush(&status);
+
+  counter.Gi_Input_Select_Register.setGi_Source_Polarity(nCounter::kActiveHigh, &status);
+  counter.Gi_Input_Select_Register.setGi_Gate_Select(gate, &status);
+  counter.Gi_Input_Select_Register.setGi_Source_Select(nCounter::kSrc_TB3, &status);
+  counter.Gi_Input_Select_Register.setGi_Gate_Polarity(nCounter::kActiveHigh, &status);
+  counter.Gi_Input_Select_Register.flush(&status);
+
+  counter.Gi_DMA_Config_Register.setGi_DoneNotificationEnable(kFalse, &status);
+  counter.Gi_DMA_Config_Register.setGi_WrFifoEnable(kFalse, &status);
+  counter.Gi_DMA_Config_Register.setGi_WaitForFirstEventOnGate(0, &status);
+  counter.Gi_DMA_Config_Register.setGi_DMA_Write(kFalse, &status);
+  counter.Gi_DMA_Config_Register.setGi_DMA_Enable(kTrue, &status);
+  counter.Gi_DMA_Config_Register.flush(&status);
+
+  // counting the timebase needs a preload of 1
+  counter.Gi_Load_A_Register.writeRegister(1, &status);
+  counter.Gi_Command_Register.writeGi_Load(kTrue, &status);
+}
+
+int PwmCapture::ConfigureCounter(Phase &phase, nMDBG::tStatus2 &status)
+{
+  phase.mResetHelper->reset(/*initialReset*/ kTrue, status);
+  ProgramSemiPeriodCounter(*phase.mCounter, phase.mGate, status);
+  if(status.isFatal())
+  {
+    printf("%s: counter configuration (%d).\n", mName, status.statusCode);
+    return -1;
+  }
+  return 0;
+}
+
+int PwmCapture::Start()
+{
+  nMDBG::tStatus2 status;
+  for(auto &phase : mPhases)
+  {
+    phase.mDma->start(status);
+    // preserve unread samples, the transfer count throttles the stream circuit
+    phase.mStreamHelper->configureForInput(kTrue, phase.mDmaChannel, status);
+    phase.mStreamHelper->modifyTransferSize(kDmaSizeInBytes, status);
+    phase.mStreamHelper->enable(status);
+  }
+  if(status.isFatal())
+  {
+    printf("%s: DMA start (%d).\n", mName, status.statusCode);
+    return -1;
+  }
+
+  // the arm time and the gate level at arm place every later edge on the host clock
+  for(auto &phase : mPhases)
+  {
+    auto gateHigh = phase.mCounter->Gi_Status_Register.readGi_Gate_St(&status) != 0;
+    phase.mCounter->Gi_Command_Register.writeGi_Arm(kTrue, &status);
+    phase.mDecoder.Start(mClock(), gateHigh);
+    phase.mStalled = false;
+  }
+  mSample.measured = 0;
+  mSample.stalled = 0;
+
+  for(auto &phase : mPhases)
+  {
+    auto armStartNs = mClock();
+    while(phase.mCounter->Gi_Status_Register.readGi_Armed_St(&status) == nCounter::kNot_Armed)
+    {
+      if(mClock() - armStartNs > 5000000000ull)
+      {
+        printf("%s: Counter did not arm within timeout.\n", mName);
+        return -1;
+      }
+    }
+  }
+  mRunning = true;
+  return 0;
+}
+
+int PwmCapture::Drain(Phase &phase, const unsigned int index, const unsigned long long readNs)
+{
+  nMDBG::tStatus2 status;
+  tBoolean dataOverwritten = kFalse;
+  u32 bytesAvailable = 0;
+  auto updated{false};
+
+  phase.mDma->read(0, NULL, &bytesAvailable, kFalse, &dataOverwritten, status);
+  while(status.isNotFatal() && bytesAvailable >= kSampleSizeInBytes)
+  {
+    u32 readSizeInBytes = PwmCaptureLimit::kSamplesPerRead * kSampleSizeInBytes;
+    if(bytesAvailable < readSizeInBytes)
+      readSizeInBytes = bytesAvailable - bytesAvailable % kSampleSizeInBytes;
+
+    // decode in place from the ring, the span wraps at most once
+    nNISTC3::tDMASpan span;
+    phase.mDma->acquireRead(readSizeInBytes, &span, &bytesAvailable, kFalse, &dataOverwritten,
+      status);
+    if(status.isFatal())
+      break;
+    for(auto piece{0u}; piece < 2; ++piece)
+    {
+      const auto *samples = reinterpret_cast<const u32*>(span.data[piece]);
+      for(auto i{0u}; i < span.size[piece] / kSampleSizeInBytes; ++i)
+      {
+        updated = phase.mDecoder.Add(samples[i], readNs) || updated;
+      }
+    }
+    phase.mDma->releaseRead(&bytesAvailable, kFalse, &dataOverwritten, status);
+    if(status.isFatal())
+      break;
+    // hand the room back to the stream circuit
+    phase.mStreamHelper->modifyTransferSize(readSizeInBytes, status);
+    phase.mCounters.mSemiPeriods += readSizeInBytes / kSampleSizeInBytes;
+  }
+  if(status.isFatal())
+  {
+    ++phase.mCounters.mDmaErrors;
+    return -1;
+  }
+
+  phase.mUpdated = updated;
+  const auto bit = 1u << index;
+  if(updated)
+  {
+    phase.mStalled = false;
+    mSample.measured |= bit;
+    mSample.stalled &= ~bit;
+    mSample.ft_DutyPercent[index] = phase.mDecoder.DutyPercent();
+    mSample.ft_FrequencyHz[index] = phase.mDecoder.FrequencyHz();
+    mSample.edgeNs[index] = phase.mDecoder.EdgeNs();
+    return 1;
+  }
+  // a held line has no period to complete, its duty is all or nothing, once
+  if(!phase.mStalled && phase.mDecoder.Stalled(readNs))
+  {
+    phase.mStalled = true;
+    mSample.measured |= bit;
+    mSample.stalled |= bit;
+    mSample.ft_DutyPercent[index] = phase.mDecoder.LineHigh() ? 100.f : 0.f;
+    mSample.ft_FrequencyHz[index] = 0.f;
+    mSample.edgeNs[index] = phase.mDecoder.EdgeNs();
+    return 1;
+  }
+  return 0;
+}
+
+void PwmCapture::PublishFailure()
+{
+  mSample.measured = 0;
+  ++mSample.sequence;
+  mLatest.Store(mSample);
+}
+
+int PwmCapture::Poll()
+{
+  if(!mRunning)
+    return -1;
+
+  auto readNs = mClock();
+  auto numUpdated{0};
+  for(auto i{0u}; i < PwmCaptureLimit::kNumPhases; ++i)
+  {
+    auto &phase = mPhases[i];
+    nMDBG::tStatus2 status;
+    if(phase.mCounter->Gi_Status_Register.readGi_DRQ_Error(&status))
+    {
+      ++phase.mCounters.mDrqErrors;
+      PublishFailure();
+      return -1;
+    }
+
+    auto result = Drain(phase, i, readNs);
+    if(result < 0)
+    {
+      PublishFailure();
+      return -1;
+    }
+    numUpdated += result;
+  }
+  if(numUpdated == 0)
+    return 0;
+
+  ++mSample.sequence;
+  mLatest.Store(mSample);
+
+  // edge to publish, for the phases that got a new edge
+  auto publishedNs = mClock();
+  for(auto i{0u}; i < PwmCaptureLimit::kNumPhases; ++i)
+  {
+    if(!mPhases[i].mUpdated)
+      continue;
+    auto &counters = mPhases[i].mCounters;
+    auto latencyNs = publishedNs - mSample.edgeNs[i];
+    ++counters.mPublished;
+    counters.mPublishLatencySumNs += latencyNs;
+    if(latencyNs > counters.mPublishLatencyMaxNs)
+      counters.mPublishLatencyMaxNs = latencyNs;
+  }
+  return numUpdated;
+}
+
+void PwmCapture::Stop()
+{
+  if(!mRunning)
+    return;
+
+  nMDBG::tStatus2 status;
+  for(auto &phase : mPhases)
+  {
+    phase.mCounter->Gi_Command_Register.writeGi_Disarm(kTrue, &status);
+    phase.mStreamHelper->disable(status);
+    phase.mDma->stop(status);
+  }
+  mRunning = false;
+}
+
+void PwmCapture::PrintStats(const unsigned long long elapsedNs, int (*print)(const char*, ...))
+{
+  for(auto i{0u}; i < PwmCaptureLimit::kNumPhases; ++i)
+  {
+    auto &phase = mPhases[i];
+    auto &counters = phase.mCounters;
+    print("%s: phase %c duty %.2f %% at %.1f Hz, published/s: %.0f, edge to publish avg %llu ns, "
+      "max %llu ns, semi-periods: %llu, drq errors: %llu, dma errors: %llu, glitches: %llu, "
+      "clock corrections: %llu\n", mName, "uvw"[i], mSample.ft_DutyPercent[i],
+      mSample.ft_FrequencyHz[i], elapsedNs ? counters.mPublished * 1e9 / elapsedNs : 0.,
+      counters.mPublished ? counters.mPublishLatencySumNs / counters.mPublished : 0,
+      counters.mPublishLatencyMaxNs, counters.mSemiPeriods, counters.mDrqErrors,
+      counters.mDmaErrors, phase.mDecoder.mGlitches, phase.mDecoder.mClockCorrections);
+    counters.mPublished = 0;
+    counters.mPublishLatencySumNs = 0;
+    counters.mPublishLatencyMaxNs = 0;
+  }
+}
+
+PwmCapture::~PwmCapture()
+{
+  Stop();
+  // the helpers unwind the counters and stream circuits before the device goes away
+  for(auto &phase : mPhases)
+  {
+    phase.mDma.reset();
+    phase.mStreamHelper.reset();
+    phase.mResetHelper.reset();
+  }
+  if(mDevice)
+  {
+    mDevice.reset();
+    mBus->destroyAddressSpace(mBar0);
+  }
+}
@@ -0,0 +1,119 @@
+#ifndef _PWMCAPTURE_H_
+#define _PWMCAPTURE_H_
+
+#include <stdio.h>
+
+#include <memory>
+
+// OS Interface
+#include "osiBus.h"
+
+// Chip Objects
+#include "tXSeries.h"
+
+// Chip Object Helpers
+#include "counterResetHelper.h"
+#include "streamHelper.h"
+
+// DMA Support
+#include "CHInCh/dmaProperties.h"
+#include "CHInCh/tCHInChDMAChannel.h"
+
+#include <MessageTypes.h>
+#include <PwmDutyDecoder.h>
+#include <RtLatestValue.h>
+
+namespace PwmCaptureLimit
+{
+constexpr auto kSamplesPerRead = 64u; // semi-periods taken from a dma ring per read
+constexpr auto kDmaBufferFactor = 16u;
+constexpr auto kDmaPoolBytes = 64u * 1024u; // rings and sgl links of all phases, with room
+}
+
+// semi-period measurement of gate on timebase 3 into the counter's dma stream, counting
+// from the arm rather than the first edge so the sum of all samples stays on the host
+// timeline; the counter must have been reset
+void ProgramSemiPeriodCounter(tCounter &counter, const nCounter::tGi_Gate_Select_t gate,
+  nMDBG::tStatus2 &status);
+
+struct PwmCaptureCounters
+{
+  unsigned long long mSemiPeriods;
+  unsigned long long mDrqErrors;
+  unsigned long long mDmaErrors;
+  // edge to publish, since the last PrintStats()
+  unsigned long long mPublished;
+  unsigned long long mPublishLatencySumNs;
+  unsigned long long mPublishLatencyMaxNs;
+};
+
+/*
+ * continuous duty cycle capture of the mcu pwm outputs
+ *
+ * counters 0, 1 and 2 measure the semi-periods of phases u, v and w on their gates and
+ * stream them by dma into one ring each, like gpctex5 does for edge counts. Poll()
+ * decodes the tick pairs in place in the rings into duty cycles and publishes every
+ * phase at once through mLatest, which the model step reads without waiting. each
+ * published duty carries the host time of its edge, so the reader can tell its age.
+ * a phase without edges for a few periods is published as stalled at 0 or 100 % by its
+ * line level. a dma or counter error publishes a last sample that measures no phase,
+ * so the reader does not take the duties from before the error as current.
+ */
+class PwmCapture
+{
+private:
+  struct Phase
+  {
+    tCounter *mCounter;
+    nNISTC3::tDMAChannelNumber mDmaChannel;
+    nCounter::tGi_Gate_Select_t mGate;
+    std::unique_ptr<nNISTC3::counterResetHelper> mResetHelper;
+    std::unique_ptr<nNISTC3::streamHelper> mStreamHelper;
+    std::unique_ptr<nNISTC3::tCHInChDMAChannel> mDma;
+    PwmDutyDecoder mDecoder;
+    PwmCaptureCounters mCounters;
+    bool mUpdated; // a new duty from an edge
+    bool mStalled;
+  };
+
+  iBus *mBus;
+  tAddressSpace mBar0;
+  std::unique_ptr<tXSeries> mDevice;
+  Phase mPhases[PwmCaptureLimit::kNumPhases];
+  McuOutputSample mSample;
+  unsigned long long (*mClock)();
+  bool mRunning;
+
+  int ConfigureCounter(Phase &phase, nMDBG::tStatus2 &status);
+  int Drain(Phase &phase, const unsigned int index, const unsigned long long readNs);
+  void PublishFailure();
+
+public:
+  const char *mName;
+  RtLatestValue<McuOutputSample> mLatest;
+
+public:
+  PwmCapture() = delete;
+  PwmCapture(const char *name, iBus *bus, unsigned long long (*clock)());
+
+  PwmCapture(const PwmCapture&) = delete;
+  PwmCapture& operator=(const PwmCapture&) = delete;
+
+  // identifies the device and programs counters 0..2 with dma, gates on PFI0..2
+  int Open();
+  int Start();
+  // drains all rings, returns the number of phases that got a new or stalled duty or -1
+  // on error
+  int Poll();
+  void Stop();
+
+  const PwmCaptureCounters& Counters(const unsigned int phase) const
+  {
+    return mPhases[phase].mCounters;
+  }
+  void PrintStats(const unsigned long long elapsedNs, int (*print)(const char*, ...)=printf);
+
+  ~PwmCapture();
+};
+
+#endif // _PWMCAPTURE_H_
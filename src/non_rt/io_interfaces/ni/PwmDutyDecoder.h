@@ -0,0 +1,153 @@
+#ifndef _PWMDUTYDECODER_H_
+#define _PWMDUTYDECODER_H_
+
+#include <stdint.h>
+
+namespace PwmCaptureLimit
+{
+constexpr auto kNumPhases = 3u;
+constexpr auto kTimebaseHz = 100000000ull; // counter timebase 3
+constexpr auto kNanosecondsPerTick = 1000000000ull / kTimebaseHz;
+constexpr auto kAnchorWindow = 256u; // semi-periods between forward anchor corrections
+constexpr auto kStallPeriods = 4ull; // periods without an edge before a line counts as held
+constexpr auto kStartStallNs = 10000000ull; // the same before the first period
+}
+
+/*
+ * duty cycle of one pwm line from its semi-period measurement
+ *
+ * the counter latches the ticks between consecutive edges of the line, high and low
+ * times alternating. counting starts when the counter is armed, so the first sample
+ * is the partial semi-period up to the first edge and the sum of all samples is the
+ * time of the latest edge since arming. with the host time of the arm that places
+ * every edge on the host clock. the counter timebase drifts against the host clock, so
+ * the anchor follows the reads: an edge that would land after the read that brought it
+ * in moves the anchor back at once, and when every edge of a window was read later than
+ * needed, the anchor moves forward by the smallest of those delays. edge times thus
+ * trail the true edges by at most the shortest dma delay of a window.
+ *
+ * a line held high or low latches nothing, so the decoder cannot complete a period
+ * with it. Stalled() tells when the latest edge is kStallPeriods of the latest period
+ * old, the duty is then 0 or 100 % by LineHigh().
+ */
+class PwmDutyDecoder
+{
+private:
+  unsigned long long mAnchorNs;
+  unsigned long long mEdgeTicks;
+  unsigned long long mWindowSlackNs;
+  unsigned int mWindowSamples;
+  uint32_t mHighTicks;
+  uint32_t mLowTicks;
+  unsigned int mNumSamples;
+  bool mNextIsHigh;
+
+public:
+  unsigned long long mPeriods;
+  unsigned long long mGlitches;
+  unsigned long long mClockCorrections;
+
+  PwmDutyDecoder()
+  {
+    Start(0, false);
+  }
+
+  // gateHigh is the level of the line when the counter was armed
+  void Start(const unsigned long long armNs, const bool gateHigh)
+  {
+    mAnchorNs = armNs;
+    mEdgeTicks = 0;
+    mWindowSlackNs = ~0ull;
+    mWindowSamples = 0;
+    mHighTicks = 0;
+    mLowTicks = 0;
+    mNumSamples = 0;
+    // a line high at arm ends its first semi-period with a falling edge
+    mNextIsHigh = gateHigh;
+    mPeriods = 0;
+    mGlitches = 0;
+    mClockCorrections = 0;
+  }
+
+  // one latched semi-period read at readNs, true when it completed a new duty
+  bool Add(const uint32_t ticks, const unsigned long long readNs)
+  {
+    mEdgeTicks += ticks;
+    const auto isHigh = mNextIsHigh;
+    mNextIsHigh = !mNextIsHigh;
+
+    auto edgeNs = EdgeNs();
+    if(edgeNs > readNs)
+    {
+      mAnchorNs -= edgeNs - readNs;
+      mWindowSlackNs = 0;
+      ++mClockCorrections;
+    }
+    else if(readNs - edgeNs < mWindowSlackNs)
+    {
+      mWindowSlackNs = readNs - edgeNs;
+    }
+    if(++mWindowSamples == PwmCaptureLimit::kAnchorWindow)
+    {
+      if(mWindowSlackNs > 0)
+      {
+        mAnchorNs += mWindowSlackNs;
+        ++mClockCorrections;
+      }
+      mWindowSlackNs = ~0ull;
+      mWindowSamples = 0;
+    }
+
+    // the partial first semi-period only places the timeline
+    if(++mNumSamples == 1)
+      return false;
+    if(ticks == 0)
+    {
+      ++mGlitches;
+      return false;
+    }
+
+    if(isHigh)
+      mHighTicks = ticks;
+    else
+      mLowTicks = ticks;
+    if(mNumSamples < 3)
+      return false;
+    ++mPeriods;
+    return true;
+  }
+
+  float DutyPercent() const
+  {
+    return 100.f * mHighTicks / (static_cast<float>(mHighTicks) + mLowTicks);
+  }
+
+  float FrequencyHz() const
+  {
+    return static_cast<float>(PwmCaptureLimit::kTimebaseHz) /
+      (static_cast<float>(mHighTicks) + mLowTicks);
+  }
+
+  // host time of the latest edge
+  unsigned long long EdgeNs() const
+  {
+    return mAnchorNs + mEdgeTicks * PwmCaptureLimit::kNanosecondsPerTick;
+  }
+
+  // level of the line since the latest edge
+  bool LineHigh() const
+  {
+    return mNextIsHigh;
+  }
+
+  // no edge since kStallPeriods of the latest period, or kStartStallNs before the first
+  bool Stalled(const unsigned long long nowNs) const
+  {
+    const auto stallNs = (mPeriods > 0) ? PwmCaptureLimit::kStallPeriods *
+      (static_cast<unsigned long long>(mHighTicks) + mLowTicks) *
+      PwmCaptureLimit::kNanosecondsPerTick : PwmCaptureLimit::kStartStallNs;
+    return nowNs > EdgeNs() + stallNs;
+  }
+};
+
+#endif // _PWMDUTYDECODER_H_
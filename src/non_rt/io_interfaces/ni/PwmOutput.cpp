@@ -0,0 +1,362 @@
+#include <PwmOutput.h>
+
+#include <time.h>
+
+#include "devices.h"
+#include "simultaneousInit.h"
+
+#include <PwmDutyDecoder.h>
+
+namespace {
+
+constexpr auto kSamplesPerPulse = 2u;
+constexpr auto kArmTimeoutNs = 5000000000ull;
+
+unsigned long long NowNs()
+{
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return static_cast<unsigned long long>(now.tv_sec) * 1000000000ull + now.tv_nsec;
+}
+
+} // namespace
+
+PwmOutput::PwmOutput(const char *name, iBus *bus, const unsigned int counterNumber,
+  const unsigned int pfi, const uint32_t updatePeriodTicks, const unsigned int writeAhead)
+  : mBus(bus)
+  , mCounter(NULL)
+  , mClockCounter(NULL)
+  , mCounterNumber(counterNumber)
+  , mPfi(pfi)
+  , mUpdatePeriodTicks(updatePeriodTicks)
+  , mWriteAhead(writeAhead)
+  , mCounters{}
+  , mLast{PwmOutputLimit::kMinTicks, PwmOutputLimit::kMinTicks}
+  , mRunning(false)
+  , mName(name)
+{
+  mCounters.mMinQueued = PwmOutputLimit::kFifoPulses;
+}
+
+int PwmOutput::Open()
+{
+  if(mCounterNumber > 3 || mPfi > 15)
+  {
+    printf("%s: counter 0..3 and PFI 0..15 expected.\n", mName);
+    return -1;
+  }
+  // the fifo keeps a pulse of room, the update clock needs two ticks per half
+  if(mWriteAhead < 1 || mWriteAhead >= PwmOutputLimit::kFifoPulses ||
+    mUpdatePeriodTicks < 2 * PwmOutputLimit::kMinTicks)
+  {
+    printf("%s: write-ahead of 1..%d pulses and an update period of at least %d ticks "
+      "expected.\n", mName, PwmOutputLimit::kFifoPulses - 1, 2 * PwmOutputLimit::kMinTicks);
+    return -1;
+  }
+
+  nMDBG::tStatus2 status;
+  mBar0 = mBus->createAddressSpace(kPCI_BAR0);
+  mDevice = std::make_unique<tXSeries>(mBar0, &status);
+
+  const nNISTC3::tDeviceInfo *deviceInfo = nNISTC3::getDeviceInfo(*mDevice, status);
+  if(status.isFatal())
+  {
+    printf("%s: Cannot identify device (%d).\n", mName, status.statusCode);
+    return -1;
+  }
+  if(deviceInfo->isSimultaneous)
+    nNISTC3::initializeSimultaneousXSeries(*mDevice, status);
+
+  // counters pair up as 0/1 and 2/3, the partner clocks the updates
+  tCounter *counters[] = {&mDevice->Counter0, &mDevice->Counter1, &mDevice->Counter2,
+    &mDevice->Counter3};
+  const nTriggers::tTrig_PFI_Output_Select_t outputs[] = {nTriggers::kPFI_G0_Out,
+    nTriggers::kPFI_G1_Out, nTriggers::kPFI_G2_Out, nTriggers::kPFI_G3_Out};
+  mCounter = counters[mCounterNumber];
+  mClockCounter = counters[mCounterNumber ^ 1u];
+
+  mPfiResetHelper = std::make_unique<nNISTC3::pfiRtsiResetHelper>(mDevice->Triggers, kTrue,
+    status);
+  mResetHelper = std::make_unique<nNISTC3::counterResetHelper>(*mCounter, kTrue, status);
+  mClockResetHelper = std::make_unique<nNISTC3::counterResetHelper>(*mClockCounter, kFalse,
+    status);
+
+  auto &triggers = mDevice->Triggers;
+  triggers.PFI_OutputSelectRegister_i[mPfi].writePFI_i_Output_Select(outputs[mCounterNumber],
+    &status);
+  triggers.PFI_Direction_Register.writeRegister(
+    triggers.PFI_Direction_Register.readRegister(&status) | (1u << mPfi), &status);
+
+  if(ConfigureCounter(status) || ConfigureUpdateClock(status))
+    return -1;
+  return 0;
+}
+
+// pulse train from the fifo, loads on the rising edges of the paired counter, as gpctex9
+// with its sample clock
+int PwmOutput::ConfigureCounter(nMDBG::tStatus2 &status)
+{
+  auto *counter = mCounter;
+  mResetHelper->reset(/*initialReset*/ kTrue, status);
+
+  counter->Gi_Mode_Register.setGi_Reload_Source_Switching(nCounter::kUseAlternatingLoadRegisters, &status);
+  counter->Gi_Mode_Register.setGi_Loading_On_Gate(nCounter::kNoCounterReloadOnGate, &status);
+  counter->Gi_Mode_Register.setGi_ForceSourceEqualToTimebase(kFalse, &status);
+  counter->Gi_Mode_Register.setGi_Loading_On_TC(nCounter::kReloadOnTC, &status);
+  counter->Gi_Mode_Register.setGi_Counting_Once(nCounter::kNoHardwareDisarm, &status);
+  counter->Gi_Mode_Register.setGi_Output_Mode(nCounter::kToggle_Output_On_TC, &status);
+  counter->Gi_Mode_Register.setGi_Load_Source_Select(nCounter::kLoad_From_Register_A, &status);
+  counter->Gi_Mode_Register.setGi_Trigger_Mode_For_Edge_Gate(nCounter::kGateLoads, &status);
+  counter->Gi_Mode_Register.setGi_Gating_Mode(nCounter::kAssertingEdgeGating, &status);
+  counter->Gi_Mode_Register.flush(&status);
+
+  counter->Gi_Mode2_Register.setGi_Up_Down(nCounter::kCountDown, &status);
+  counter->Gi_Mode2_Register.setGi_Bank_Switch_Mode(nCounter::kGate, &status);
+  // an underrun holds the last pulse instead of stopping the output
+  counter->Gi_Mode2_Register.setGi_StopOnError(kFalse, &status);
+  counter->Gi_Mode2_Register.setGi_CtrOutFifoRegenerationEn(0, &status);
+  counter->Gi_Mode2_Register.flush(&status);
+
+  counter->Gi_Counting_Mode_Register.setGi_Prescale(kFalse, &status);
+  counter->Gi_Counting_Mode_Register.setGi_HW_Arm_Enable(kFalse, &status);
+  counter->Gi_Counting_Mode_Register.setGi_Index_Mode(nCounter::kIndexModeCleared, &status);
+  counter->Gi_Counting_Mode_Register.setGi_Counting_Mode(nCounter::kNormalCounting, &status);
+  counter->Gi_Counting_Mode_Register.flush(&status);
+
+  counter->Gi_SampleClockRegister.setGi_SampleClockMode(nCounter::kSC_Disabled, &status);
+  counter->Gi_SampleClockRegister.flush(&status);
+  counter->Gi_AuxCtrRegister.writeGi_AuxCtrMode(nCounter::kAux_Disabled, &status);
+  counter->Gi_Second_Gate_Register.setGi_Second_Gate_Mode(nCounter::kDisabledSecondGate, &status);
+  counter->Gi_Second_Gate_Register.flush(&status);
+
+  counter->Gi_Input_Select_Register.setGi_Source_Polarity(nCounter::kActiveHigh, &status);
+  counter->Gi_Input_Select_Register.setGi_Output_Polarity(nCounter::kActiveHigh, &status);
+  counter->Gi_Input_Select_Register.setGi_Gate_Select_Load_Source(nCounter::kDisabled, &status);
+  counter->Gi_Input_Select_Register.setGi_Gate_Select(nCounter::kGate_G_PairedOut, &status);
+  counter->Gi_Input_Select_Register.setGi_Source_Select(nCounter::kSrc_TB3, &status);
+  counter->Gi_Input_Select_Register.setGi_Gate_Polarity(nCounter::kActiveHigh, &status);
+  counter->Gi_Input_Select_Register.flush(&status);
+
+  // the fifo is written by programmed io, no dma channel takes part, as gpctex1 reads it
+  counter->Gi_DMA_Config_Register.setGi_DoneNotificationEnable(kFalse, &status);
+  counter->Gi_DMA_Config_Register.setGi_WrFifoEnable(kTrue, &status);
+  counter->Gi_DMA_Config_Register.setGi_DMA_Reset(kTrue, &status);
+  counter->Gi_DMA_Config_Register.setGi_DMA_Write(kTrue, &status);
+  counter->Gi_DMA_Config_Register.setGi_DMA_Enable(kTrue, &status);
+  counter->Gi_DMA_Config_Register.flush(&status);
+
+  if(status.isFatal())
+  {
+    printf("%s: counter configuration (%d).\n", mName, status.statusCode);
+    return -1;
+  }
+  return 0;
+}
+
+// continuous square wave of one update period, as the continuous train of pwm_output
+int PwmOutput::ConfigureUpdateClock(nMDBG::tStatus2 &status)
+{
+  auto *counter = mClockCounter;
+  mClockResetHelper->reset(/*initialReset*/ kTrue, status);
+
+  counter->Gi_Mode_Register.setGi_Reload_Source_Switching(nCounter::kUseAlternatingLoadRegisters, &status);
+  counter->Gi_Mode_Register.setGi_Loading_On_Gate(nCounter::kNoCounterReloadOnGate, &status);
+  counter->Gi_Mode_Register.setGi_ForceSourceEqualToTimebase(kFalse, &status);
+  counter->Gi_Mode_Register.setGi_Loading_On_TC(nCounter::kReloadOnTC, &status);
+  counter->Gi_Mode_Register.setGi_Output_Mode(nCounter::kToggle_Output_On_TC, &status);
+  counter->Gi_Mode_Register.setGi_Load_Source_Select(nCounter::kLoad_From_Register_A, &status);
+  counter->Gi_Mode_Register.setGi_Counting_Once(nCounter::kNoHardwareDisarm, &status);
+  counter->Gi_Mode_Register.setGi_Stop_Mode(nCounter::kStopOnGateCondition, &status);
+  counter->Gi_Mode_Register.setGi_Gating_Mode(nCounter::kGateDisabled, &status);
+  counter->Gi_Mode_Register.flush(&status);
+
+  counter->Gi_Mode2_Register.setGi_Up_Down(nCounter::kCountDown, &status);
+  counter->Gi_Mode2_Register.setGi_Bank_Switch_Enable(nCounter::kDisabled_If_Armed_Else_Write_To_X, &status);
+  counter->Gi_Mode2_Register.setGi_Bank_Switch_Mode(nCounter::kSoftware, &status);
+  counter->Gi_Mode2_Register.flush(&status);
+
+  counter->Gi_Counting_Mode_Register.setGi_Prescale(kFalse, &status);
+  counter->Gi_Counting_Mode_Register.setGi_HW_Arm_Enable(kFalse, &status);
+  counter->Gi_Counting_Mode_Register.setGi_Index_Mode(nCounter::kIndexModeCleared, &status);
+  counter->Gi_Counting_Mode_Register.setGi_Counting_Mode(nCounter::kNormalCounting, &status);
+  counter->Gi_Counting_Mode_Register.flush(&status);
+
+  counter->Gi_SampleClockRegister.setGi_SampleClockMode(nCounter::kSC_Disabled, &status);
+  counter->Gi_SampleClockRegister.flush(&status);
+  counter->Gi_AuxCtrRegister.writeGi_AuxCtrMode(nCounter::kAux_Disabled, &status);
+  counter->Gi_Second_Gate_Register.setGi_Second_Gate_Mode(nCounter::kDisabledSecondGate, &status);
+  counter->Gi_Second_Gate_Register.flush(&status);
+
+  counter->Gi_Input_Select_Register.setGi_Source_Polarity(nCounter::kActiveHigh, &status);
+  counter->Gi_Input_Select_Register.setGi_Output_Polarity(nCounter::kActiveHigh, &status);
+  counter->Gi_Input_Select_Register.setGi_Source_Select(nCounter::kSrc_TB3, &status);
+  counter->Gi_Input_Select_Register.flush(&status);
+
+  counter->Gi_DMA_Config_Register.setGi_DMA_Enable(kFalse, &status);
+  counter->Gi_DMA_Config_Register.flush(&status);
+
+  // low half first, so the first rising edge comes one update period after the arm
+  const auto lowTicks = mUpdatePeriodTicks / 2;
+  counter->Gi_Load_A_Register.writeRegister(lowTicks, &status);
+  counter->Gi_Command_Register.writeGi_Load(kTrue, &status);
+  counter->Gi_Load_A_Register.writeRegister(mUpdatePeriodTicks - lowTicks, &status);
+  counter->Gi_Load_B_Register.writeRegister(lowTicks, &status);
+
+  if(status.isFatal())
+  {
+    printf("%s: update clock configuration (%d).\n", mName, status.statusCode);
+    return -1;
+  }
+  return 0;
+}
+
+void PwmOutput::WriteFifo(const PwmPulse *pulses, const unsigned int count,
+  nMDBG::tStatus2 &status)
+{
+  for(auto i{0u}; i < count; ++i)
+  {
+    mCounter->Gi_WrFifoRegister.writeRegister(pulses[i].mHighTicks, &status);
+    mCounter->Gi_WrFifoRegister.writeRegister(pulses[i].mLowTicks, &status);
+  }
+}
+
+int PwmOutput::WaitForArm(tCounter *counter)
+{
+  nMDBG::tStatus2 status;
+  auto armStartNs = NowNs();
+  while(counter->Gi_Status_Register.readGi_Armed_St(&status) == nCounter::kNot_Armed)
+  {
+    if(NowNs() - armStartNs > kArmTimeoutNs)
+    {
+      printf("%s: Counter did not arm within timeout.\n", mName);
+      return -1;
+    }
+  }
+  return 0;
+}
+
+int PwmOutput::Start(const PwmPulse &initial)
+{
+  nMDBG::tStatus2 status;
+  mQueue.Reset(initial);
+  mLast = initial;
+
+  // a short delay, then the initial pulse from bank x until the first update
+  mCounter->Gi_Load_A_Register.writeRegister(PwmOutputLimit::kMinTicks, &status);
+  mCounter->Gi_Command_Register.writeGi_Load(kTrue, &status);
+  mCounter->Gi_Load_A_Register.writeRegister(initial.mHighTicks, &status);
+  mCounter->Gi_Load_B_Register.writeRegister(initial.mLowTicks, &status);
+
+  // one pulse goes to bank y right away, the write-ahead stays in the fifo
+  for(auto i{0u}; i <= mWriteAhead; ++i)
+  {
+    WriteFifo(&initial, 1, status);
+  }
+  mCounter->Gi_Mode2_Register.writeGi_Bank_Switch_Enable(nCounter::kEnabled_If_Armed_Else_Write_To_Y, &status);
+  mCounter->Gi_Command_Register.writeGi_WrLoadRegsFromFifo(kTrue, &status);
+  auto loadStartNs = NowNs();
+  while(mCounter->Gi_Status_Register.readGi_ForcedWrFromFifoInProgSt(&status))
+  {
+    if(NowNs() - loadStartNs > kArmTimeoutNs)
+    {
+      printf("%s: Counter did not load data from FIFO within timeout.\n", mName);
+      return -1;
+    }
+  }
+
+  // the output first, so it is ready for the first update edge
+  mCounter->Gi_Command_Register.writeGi_Arm(kTrue, &status);
+  if(WaitForArm(mCounter))
+    return -1;
+  mClockCounter->Gi_Command_Register.writeGi_Arm(kTrue, &status);
+  if(WaitForArm(mClockCounter))
+    return -1;
+
+  if(status.isFatal())
+  {
+    printf("%s: start (%d).\n", mName, status.statusCode);
+    return -1;
+  }
+  mRunning = true;
+  return 0;
+}
+
+int PwmOutput::Poll()
+{
+  if(!mRunning)
+    return -1;
+
+  nMDBG::tStatus2 status;
+  auto &statusRegister = mCounter->Gi_Status_Register;
+  statusRegister.refresh(&status);
+  if(statusRegister.getGi_GateSwitchError_St(&status))
+  {
+    ++mCounters.mUnderruns;
+    mCounter->Gi_Interrupt1_Register.writeGi_GateSwitchError_Ack(kTrue, &status);
+  }
+  if(statusRegister.getGi_WritesTooFastErrorSt(&status))
+  {
+    ++mCounters.mWritesTooFast;
+    mCounter->Gi_Interrupt1_Register.writeGi_WritesTooFastErrorAck(kTrue, &status);
+  }
+  if(statusRegister.getGi_SampleClockOverrun_St(&status))
+  {
+    ++mCounters.mClockOverruns;
+    mCounter->Gi_Interrupt1_Register.writeGi_SampleClockOverrunErrorAck(kTrue, &status);
+  }
+
+  const auto queued = mCounter->Gi_FifoStatusRegister.readRegister(&status) / kSamplesPerPulse;
+  if(queued < mCounters.mMinQueued)
+    mCounters.mMinQueued = queued;
+
+  const auto numPulses = mQueue.TopUp(queued, mWriteAhead, mOut);
+  WriteFifo(mOut, numPulses, status);
+  if(numPulses > 0)
+    mLast = mOut[numPulses - 1];
+  mCounters.mPulses += numPulses;
+  ++mCounters.mPolls;
+
+  if(status.isFatal())
+    return -1;
+  return numPulses;
+}
+
+void PwmOutput::Stop()
+{
+  if(!mRunning)
+    return;
+
+  nMDBG::tStatus2 status;
+  mClockCounter->Gi_Command_Register.writeGi_Disarm(kTrue, &status);
+  mCounter->Gi_Command_Register.writeGi_Disarm(kTrue, &status);
+  mRunning = false;
+}
+
+void PwmOutput::PrintStats(const unsigned long long elapsedNs, int (*print)(const char*, ...))
+{
+  const double timebaseHz = PwmCaptureLimit::kTimebaseHz;
+  const auto periodTicks = mLast.mHighTicks + mLast.mLowTicks;
+  print("%s: duty %.2f %% at %.1f Hz, updates/s: %.0f, polls/s: %.0f, min fifo %d/%d pulses, "
+    "pushed: %llu, rejected: %llu, merged: %llu, padded: %llu, underruns: %llu, "
+    "writes too fast: %llu, clock overruns: %llu\n", mName,
+    100. * mLast.mHighTicks / periodTicks, timebaseHz / periodTicks,
+    timebaseHz / mUpdatePeriodTicks, elapsedNs ? mCounters.mPolls * 1e9 / elapsedNs : 0.,
+    mCounters.mMinQueued, mWriteAhead, mQueue.mPushed, mQueue.mRejected, mQueue.mMerged,
+    mQueue.mPadded, mCounters.mUnderruns, mCounters.mWritesTooFast, mCounters.mClockOverruns);
+  mCounters.mPolls = 0;
+  mCounters.mMinQueued = PwmOutputLimit::kFifoPulses;
+}
+
+PwmOutput::~PwmOutput()
+{
+  Stop();
+  // the helpers unwind the counters and lines before the device goes away
+  mClockResetHelper.reset();
+  mResetHelper.reset();
+  mPfiResetHelper.reset();
+  if(mDevice)
+  {
+    mDevice.reset();
+    mBus->destroyAddressSpace(mBar0);
+  }
+}
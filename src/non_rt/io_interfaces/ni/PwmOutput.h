@@ -0,0 +1,106 @@
+#ifndef _PWMOUTPUT_H_
+#define _PWMOUTPUT_H_
+
+#include <stdio.h>
+
+#include <memory>
+
+// OS Interface
+#include "osiBus.h"
+
+// Chip Objects
+#include "tXSeries.h"
+
+// Chip Object Helpers
+#include "counterResetHelper.h"
+#include "pfiRtsiResetHelper.h"
+
+#include <PwmPulseQueue.h>
+
+struct PwmOutputCounters
+{
+  unsigned long long mPulses;
+  unsigned long long mUnderruns;
+  unsigned long long mWritesTooFast;
+  unsigned long long mClockOverruns;
+  // since the last PrintStats()
+  unsigned long long mPolls;
+  unsigned int mMinQueued;
+};
+
+/*
+ * pwm output whose pulses change while the counter runs
+ *
+ * the counter generates high/low tick pairs from its fifo the way gpctex9 does, every
+ * rising edge of the update clock loads the next pair. the update clock is the paired
+ * counter (1 for 0, 3 for 2 and back) running a square wave, so an update needs no
+ * external line. the rt task pushes pairs into the write-ahead queue and Poll() writes
+ * them into the fifo by programmed io, there is no dma ring whose prefetch would delay
+ * every update by the ring size. fifo regeneration stays off since it replays a fixed
+ * table. should the fifo run dry anyway the counter keeps its last pair and the gate
+ * switch error is counted as an underrun.
+ */
+class PwmOutput
+{
+private:
+  iBus *mBus;
+  tAddressSpace mBar0;
+  std::unique_ptr<tXSeries> mDevice;
+  tCounter *mCounter;
+  tCounter *mClockCounter;
+  std::unique_ptr<nNISTC3::pfiRtsiResetHelper> mPfiResetHelper;
+  std::unique_ptr<nNISTC3::counterResetHelper> mResetHelper;
+  std::unique_ptr<nNISTC3::counterResetHelper> mClockResetHelper;
+  const unsigned int mCounterNumber;
+  const unsigned int mPfi;
+  const uint32_t mUpdatePeriodTicks;
+  const unsigned int mWriteAhead;
+  PwmPulseQueue mQueue;
+  PwmOutputCounters mCounters;
+  PwmPulse mOut[PwmOutputLimit::kFifoPulses];
+  PwmPulse mLast;
+  bool mRunning;
+
+  int ConfigureCounter(nMDBG::tStatus2 &status);
+  int ConfigureUpdateClock(nMDBG::tStatus2 &status);
+  void WriteFifo(const PwmPulse *pulses, const unsigned int count, nMDBG::tStatus2 &status);
+  int WaitForArm(tCounter *counter);
+
+public:
+  const char *mName;
+
+public:
+  PwmOutput() = delete;
+  // counter 0..3 drives PFI pfi, updatePeriodTicks of timebase 3 between fifo loads
+  PwmOutput(const char *name, iBus *bus, const unsigned int counterNumber,
+    const unsigned int pfi, const uint32_t updatePeriodTicks, const unsigned int writeAhead);
+
+  PwmOutput(const PwmOutput&) = delete;
+  PwmOutput& operator=(const PwmOutput&) = delete;
+
+  int Open();
+  // primes the fifo with initial and arms the counter, then the update clock
+  int Start(const PwmPulse &initial);
+  // queues the pulse of the next update period, -1 when the queue is full
+  int Push(const PwmPulse &pulse)
+  {
+    return mQueue.Push(pulse);
+  }
+  // tops the fifo up to the write-ahead, returns the pulses written or -1 on error
+  int Poll();
+  void Stop();
+
+  uint32_t UpdatePeriodTicks() const
+  {
+    return mUpdatePeriodTicks;
+  }
+  const PwmOutputCounters& Counters() const
+  {
+    return mCounters;
+  }
+  void PrintStats(const unsigned long long elapsedNs, int (*print)(const char*, ...)=printf);
+
+  ~PwmOutput();
+};
+
+#endif // _PWMOUTPUT_H_
@@ -0,0 +1,126 @@
+#ifndef _PWMPULSEQUEUE_H_
+#define _PWMPULSEQUEUE_H_
+
+#include <stdint.h>
+
+namespace PwmOutputLimit
+{
+constexpr auto kFifoPulses = 63u; // the counter fifo holds 127 tick counts, two per pulse
+constexpr auto kMaxPending = 64u; // power of two
+constexpr auto kMinTicks = 2u; // the counter must count at least two ticks
+}
+
+static_assert((PwmOutputLimit::kMaxPending & (PwmOutputLimit::kMaxPending - 1)) == 0,
+  "kMaxPending must be a power of two");
+
+// one pwm period as the counter generates it, high first
+struct PwmPulse
+{
+  uint32_t mHighTicks;
+  uint32_t mLowTicks;
+};
+
+// duty cycle in percent over a period of periodTicks, both halves at least kMinTicks
+inline PwmPulse PwmPulseFromDuty(const float dutyPercent, const uint32_t periodTicks)
+{
+  auto duty = (dutyPercent < 0.f) ? 0.f : (dutyPercent > 100.f) ? 100.f : dutyPercent;
+  auto highTicks = static_cast<uint32_t>(periodTicks * duty / 100.f + 0.5f);
+  if(highTicks < PwmOutputLimit::kMinTicks)
+    highTicks = PwmOutputLimit::kMinTicks;
+  if(highTicks > periodTicks - PwmOutputLimit::kMinTicks)
+    highTicks = periodTicks - PwmOutputLimit::kMinTicks;
+  return PwmPulse{highTicks, periodTicks - highTicks};
+}
+
+/*
+ * write-ahead queue in front of the counter fifo
+ *
+ * the rt task pushes the pulses of the coming update periods, TopUp() hands out what
+ * keeps the fifo at its write-ahead depth. the write-ahead is the latency of an update
+ * in update periods and the slack the task has before the fifo runs dry. when the task
+ * was late, pulses beyond the free fifo room are merged into the newest one, so a late
+ * period does not add latency for good. when nothing is pending and the fifo is empty,
+ * the last pulse is repeated to keep the fifo primed; the counter would hold it anyway,
+ * but flag an underrun.
+ */
+class PwmPulseQueue
+{
+private:
+  PwmPulse mPending[PwmOutputLimit::kMaxPending];
+  unsigned int mHead;
+  unsigned int mTail;
+  PwmPulse mLast;
+
+public:
+  unsigned long long mPushed;
+  unsigned long long mRejected;
+  unsigned long long mMerged;
+  unsigned long long mPadded;
+
+  explicit PwmPulseQueue(const PwmPulse &initial = PwmPulse{PwmOutputLimit::kMinTicks,
+    PwmOutputLimit::kMinTicks})
+  {
+    Reset(initial);
+  }
+
+  void Reset(const PwmPulse &initial)
+  {
+    mHead = 0;
+    mTail = 0;
+    mLast = initial;
+    mPushed = 0;
+    mRejected = 0;
+    mMerged = 0;
+    mPadded = 0;
+  }
+
+  unsigned int NumPending() const
+  {
+    return mTail - mHead;
+  }
+
+  // 0 on success, -1 when kMaxPending pulses are waiting already
+  int Push(const PwmPulse &pulse)
+  {
+    if(NumPending() == PwmOutputLimit::kMaxPending)
+    {
+      ++mRejected;
+      return -1;
+    }
+    auto &slot = mPending[mTail++ & (PwmOutputLimit::kMaxPending - 1)];
+    slot.mHighTicks = pulse.mHighTicks < PwmOutputLimit::kMinTicks ?
+      PwmOutputLimit::kMinTicks : pulse.mHighTicks;
+    slot.mLowTicks = pulse.mLowTicks < PwmOutputLimit::kMinTicks ?
+      PwmOutputLimit::kMinTicks : pulse.mLowTicks;
+    ++mPushed;
+    return 0;
+  }
+
+  // pulses to write into a fifo holding queued of them, at most writeAhead in out
+  unsigned int TopUp(const unsigned int queued, const unsigned int writeAhead, PwmPulse *out)
+  {
+    auto free = (writeAhead > queued) ? writeAhead - queued : 0u;
+    // the newest pulse waits for room, older ones that do not fit are stale
+    while(NumPending() > (free > 0 ? free : 1u))
+    {
+      ++mHead;
+      ++mMerged;
+    }
+
+    auto numOut{0u};
+    while(numOut < free && NumPending() > 0)
+    {
+      out[numOut++] = mPending[mHead++ & (PwmOutputLimit::kMaxPending - 1)];
+    }
+    if(queued + numOut == 0 && writeAhead > 0)
+    {
+      out[numOut++] = mLast;
+      ++mPadded;
+    }
+    if(numOut > 0)
+      mLast = out[numOut - 1];
+    return numOut;
+  }
+};
+
+#endif // _PWMPULSEQUEUE_H_
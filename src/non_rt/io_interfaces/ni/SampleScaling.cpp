@@ -0,0 +1,165 @@
+#include <SampleScaling.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define SAMPLE_SCALING_AVX2 1
+#include <immintrin.h>
+#endif
+
+namespace {
+
+constexpr auto kDacMin = -32768.f;
+constexpr auto kDacMax = 32767.f;
+
+#ifdef SAMPLE_SCALING_AVX2
+__attribute__((target("avx2")))
+void ScaleAiAvx2(const AiScalingTable &table, const int16_t *raw, const unsigned int numScans,
+  float *const *channels)
+{
+  const auto numChannels = table.mNumChannels;
+  // a 32 bit gather reads the sample after the last one too, the final scans go scalar
+  const auto vectorScans = (numScans > 0) ? ((numScans - 1) & ~7u) : 0u;
+  const auto *base = reinterpret_cast<const int*>(raw);
+  const auto step = _mm256_set1_epi32(static_cast<int>(8 * numChannels));
+  for(auto m{0u}; m < numChannels; ++m)
+  {
+    const auto *c = table.mCoefficients[m];
+    const auto c0 = _mm256_set1_ps(c[0]);
+    const auto c1 = _mm256_set1_ps(c[1]);
+    const auto c2 = _mm256_set1_ps(c[2]);
+    const auto c3 = _mm256_set1_ps(c[3]);
+    auto *out = channels[m];
+    const int n = static_cast<int>(numChannels);
+    auto index = _mm256_setr_epi32(m, n + m, 2 * n + m, 3 * n + m, 4 * n + m, 5 * n + m,
+      6 * n + m, 7 * n + m);
+    auto s{0u};
+    for(; s < vectorScans; s += 8)
+    {
+      // sign extend the low half of every gathered word
+      auto words = _mm256_i32gather_epi32(base, index, 2);
+      auto value = _mm256_cvtepi32_ps(_mm256_srai_epi32(_mm256_slli_epi32(words, 16), 16));
+      auto result = _mm256_add_ps(_mm256_mul_ps(c3, value), c2);
+      result = _mm256_add_ps(_mm256_mul_ps(result, value), c1);
+      result = _mm256_add_ps(_mm256_mul_ps(result, value), c0);
+      _mm256_storeu_ps(out + s, result);
+      index = _mm256_add_epi32(index, step);
+    }
+    for(; s < numScans; ++s)
+    {
+      const float value = raw[s * numChannels + m];
+      out[s] = ((c[3] * value + c[2]) * value + c[1]) * value + c[0];
+    }
+  }
+}
+
+__attribute__((target("avx2")))
+void ScaleAoAvx2(const AoScalingTable &table, const float *const *channels,
+  const unsigned int numScans, int16_t *raw)
+{
+  const auto numChannels = table.mNumChannels;
+  const auto vectorScans = numScans & ~7u;
+  const auto minimum = _mm256_set1_ps(kDacMin);
+  const auto maximum = _mm256_set1_ps(kDacMax);
+  alignas(32) int32_t codes[8];
+  for(auto m{0u}; m < numChannels; ++m)
+  {
+    const auto *c = table.mCoefficients[m];
+    const auto c0 = _mm256_set1_ps(c[0]);
+    const auto c1 = _mm256_set1_ps(c[1]);
+    const auto *in = channels[m];
+    auto *out = raw + m;
+    auto s{0u};
+    for(; s < vectorScans; s += 8)
+    {
+      auto result = _mm256_add_ps(_mm256_mul_ps(_mm256_loadu_ps(in + s), c1), c0);
+      result = _mm256_min_ps(_mm256_max_ps(result, minimum), maximum);
+      _mm256_store_si256(reinterpret_cast<__m256i*>(codes), _mm256_cvttps_epi32(result));
+      for(auto k{0u}; k < 8; ++k)
+      {
+        out[(s + k) * numChannels] = static_cast<int16_t>(codes[k]);
+      }
+    }
+    for(; s < numScans; ++s)
+    {
+      auto result = in[s] * c[1] + c[0];
+      result = (result < kDacMin) ? kDacMin : (result > kDacMax) ? kDacMax : result;
+      out[s * numChannels] = static_cast<int16_t>(result);
+    }
+  }
+}
+#endif
+
+bool DetectAvx2()
+{
+#ifdef SAMPLE_SCALING_AVX2
+  return __builtin_cpu_supports("avx2");
+#else
+  return false;
+#endif
+}
+
+} // namespace
+
+void ScaleAiScalar(const AiScalingTable &table, const int16_t *raw,
+  const unsigned int numScans, float *const *channels)
+{
+  const auto numChannels = table.mNumChannels;
+  for(auto s{0u}; s < numScans; ++s)
+  {
+    const auto *scan = raw + s * numChannels;
+    for(auto m{0u}; m < numChannels; ++m)
+    {
+      const auto *c = table.mCoefficients[m];
+      const float value = scan[m];
+      channels[m][s] = ((c[3] * value + c[2]) * value + c[1]) * value + c[0];
+    }
+  }
+}
+
+void ScaleAoScalar(const AoScalingTable &table, const float *const *channels,
+  const unsigned int numScans, int16_t *raw)
+{
+  const auto numChannels = table.mNumChannels;
+  for(auto s{0u}; s < numScans; ++s)
+  {
+    auto *scan = raw + s * numChannels;
+    for(auto m{0u}; m < numChannels; ++m)
+    {
+      const auto *c = table.mCoefficients[m];
+      auto result = channels[m][s] * c[1] + c[0];
+      result = (result < kDacMin) ? kDacMin : (result > kDacMax) ? kDacMax : result;
+      scan[m] = static_cast<int16_t>(result);
+    }
+  }
+}
+
+bool ScalingUsesAvx2()
+{
+  static const bool useAvx2 = DetectAvx2();
+  return useAvx2;
+}
+
+void ScaleAi(const AiScalingTable &table, const int16_t *raw, const unsigned int numScans,
+  float *const *channels)
+{
+#ifdef SAMPLE_SCALING_AVX2
+  if(ScalingUsesAvx2())
+  {
+    ScaleAiAvx2(table, raw, numScans, channels);
+    return;
+  }
+#endif
+  ScaleAiScalar(table, raw, numScans, channels);
+}
+
+void ScaleAo(const AoScalingTable &table, const float *const *channels,
+  const unsigned int numScans, int16_t *raw)
+{
+#ifdef SAMPLE_SCALING_AVX2
+  if(ScalingUsesAvx2())
+  {
+    ScaleAoAvx2(table, channels, numScans, raw);
+    return;
+  }
+#endif
+  ScaleAoScalar(table, channels, numScans, raw);
+}
@@ -0,0 +1,54 @@
+#ifndef _SAMPLESCALING_H_
+#define _SAMPLESCALING_H_
+
+#include <stdint.h>
+
+namespace ScalingLimit
+{
+constexpr auto kMaxChannels = 32u; // ai channels one x series device scans at most
+constexpr auto kAiCoefficients = 4u; // as nNISTC3::kNumAIScalingCoefficients
+constexpr auto kAoCoefficients = 2u; // as nNISTC3::kNumAOScalingCoefficients
+}
+
+// calibration polynomial of every channel of a scan list, resolved once per configuration
+struct AiScalingTable
+{
+  unsigned int mNumChannels;
+  float mCoefficients[ScalingLimit::kMaxChannels][ScalingLimit::kAiCoefficients];
+};
+
+struct AoScalingTable
+{
+  unsigned int mNumChannels;
+  float mCoefficients[ScalingLimit::kMaxChannels][ScalingLimit::kAoCoefficients];
+};
+
+/*
+ * raw samples to volts and back with the coefficients of a scaling table
+ *
+ * the ai fifo delivers scans interleaved, channel after channel. ScaleAi() applies the
+ * polynomial of each channel and writes channel m of scan s to channels[m][s] in the
+ * same pass, so nothing downstream deinterleaves again. ScaleAo() does the reverse for
+ * the ao fifo. the arithmetic is nNISTC3::scale() step by step, a multiply then an add,
+ * so the results match the per sample helpers bit for bit. on cpus with avx2 eight scans
+ * of one channel are gathered and scaled at once, the choice is made on the first call.
+ */
+
+// scans of table.mNumChannels raw samples each into one float array per channel
+void ScaleAi(const AiScalingTable &table, const int16_t *raw, const unsigned int numScans,
+  float *const *channels);
+// one float array per channel into scans of table.mNumChannels raw samples, clamped to
+// the dac range
+void ScaleAo(const AoScalingTable &table, const float *const *channels,
+  const unsigned int numScans, int16_t *raw);
+
+// the portable kernels, for comparison
+void ScaleAiScalar(const AiScalingTable &table, const int16_t *raw,
+  const unsigned int numScans, float *const *channels);
+void ScaleAoScalar(const AoScalingTable &table, const float *const *channels,
+  const unsigned int numScans, int16_t *raw);
+
+// true when ScaleAi() and ScaleAo() run the avx2 kernels
+bool ScalingUsesAvx2();
+
+#endif // _SAMPLESCALING_H_
@@ -0,0 +1,157 @@
+#ifndef _SCANCLOCK_H_
+#define _SCANCLOCK_H_
+
+#include <math.h>
+
+namespace ScanClockLimit
+{
+constexpr auto kWindowNs = 100000000ull; // between anchor corrections
+constexpr auto kSlopeAnchors = 16u; // the windows the period and the line are fitted to
+constexpr auto kMaxDriftPpm = 500.; // a slope further off is a stalled or skipped poll
+}
+
+/*
+ * host time of every scan of a free running ai timer
+ *
+ * the host only learns of a scan when a poll finds it in the dma ring, after it was
+ * taken, so every poll gives an upper bound for the time of the newest scan it
+ * delivered. the bounds closest to the scans, the lower envelope, are the polls that
+ * came right after a scan. every window keeps the poll with the least delay after its
+ * newest scan as an anchor. the period is the least squares slope through the anchors
+ * of the last windows, which follows the timebase of the board drifting against the
+ * host clock, and the scans are placed on the line of that slope through the lowest
+ * anchor, all others lying above it. a scan that would land after the poll that
+ * brought it in moves the anchor there at once, as PwmDutyDecoder does, so scan times
+ * trail the true scans by about the shortest poll delay of the last windows.
+ */
+class ScanClock
+{
+private:
+  struct Anchor
+  {
+    double mScan;
+    double mNs; // since mOriginNs
+  };
+
+  unsigned long long mOriginNs;
+  double mNominalPeriodNs;
+  double mPeriodNs;
+  Anchor mAnchor;
+  Anchor mAnchors[ScanClockLimit::kSlopeAnchors]; // of the last windows, oldest first
+  unsigned int mNumAnchors;
+  // the poll of the window with the least delay after its newest scan
+  unsigned long long mWindowBeginNs;
+  Anchor mWindowBest;
+  double mWindowSlackNs;
+
+public:
+  unsigned long long mCorrections;
+
+  ScanClock()
+  {
+    Start(0, 1.);
+  }
+
+  // startNs is at or before the first scan
+  void Start(const unsigned long long startNs, const double periodNs)
+  {
+    mOriginNs = startNs;
+    mNominalPeriodNs = periodNs;
+    mPeriodNs = periodNs;
+    mAnchor = Anchor{0., 0.};
+    mNumAnchors = 0;
+    mWindowBeginNs = startNs;
+    mWindowSlackNs = HUGE_VAL;
+    mCorrections = 0;
+  }
+
+  // numScans delivered since the start by a poll that ended at pollNs
+  void Observe(const unsigned long long numScans, const unsigned long long pollNs)
+  {
+    if(numScans == 0 || pollNs < mOriginNs)
+      return;
+    const auto newest = Anchor{static_cast<double>(numScans - 1),
+      static_cast<double>(pollNs - mOriginNs)};
+    const auto slackNs = newest.mNs - Predict(newest.mScan);
+    if(slackNs < 0.)
+    {
+      mAnchor = newest;
+      mWindowBest = newest;
+      mWindowSlackNs = 0.;
+      ++mCorrections;
+    }
+    else if(slackNs < mWindowSlackNs)
+    {
+      mWindowBest = newest;
+      mWindowSlackNs = slackNs;
+    }
+    if(pollNs - mWindowBeginNs < ScanClockLimit::kWindowNs)
+      return;
+
+    if(mNumAnchors == ScanClockLimit::kSlopeAnchors)
+    {
+      for(auto i{1u}; i < mNumAnchors; ++i)
+      {
+        mAnchors[i - 1] = mAnchors[i];
+      }
+      --mNumAnchors;
+    }
+    mAnchors[mNumAnchors++] = mWindowBest;
+    if(mNumAnchors > 1)
+    {
+      // least squares, the delays of the anchors are alike
+      auto meanScan{0.}, meanNs{0.};
+      for(auto i{0u}; i < mNumAnchors; ++i)
+      {
+        meanScan += mAnchors[i].mScan / mNumAnchors;
+        meanNs += mAnchors[i].mNs / mNumAnchors;
+      }
+      auto sxy{0.}, sxx{0.};
+      for(auto i{0u}; i < mNumAnchors; ++i)
+      {
+        sxy += (mAnchors[i].mScan - meanScan) * (mAnchors[i].mNs - meanNs);
+        sxx += (mAnchors[i].mScan - meanScan) * (mAnchors[i].mScan - meanScan);
+      }
+      const auto periodNs = sxx > 0. ? sxy / sxx : mPeriodNs;
+      if(fabs(periodNs / mNominalPeriodNs - 1.) * 1e6 < ScanClockLimit::kMaxDriftPpm)
+        mPeriodNs = periodNs;
+    }
+    // through the anchor with the least delay, the others lie above the line
+    auto anchor = mAnchors[0];
+    for(auto i{1u}; i < mNumAnchors; ++i)
+    {
+      if(mAnchors[i].mNs - mAnchors[i].mScan * mPeriodNs < anchor.mNs - anchor.mScan * mPeriodNs)
+        anchor = mAnchors[i];
+    }
+    if(anchor.mScan != mAnchor.mScan)
+      ++mCorrections;
+    mAnchor = anchor;
+    mWindowBeginNs = pollNs;
+    mWindowSlackNs = HUGE_VAL;
+  }
+
+  // since mOriginNs
+  double Predict(const double scan) const
+  {
+    return mAnchor.mNs + (scan - mAnchor.mScan) * mPeriodNs;
+  }
+
+  unsigned long long ScanNs(const unsigned long long scan) const
+  {
+    const auto ns = Predict(scan);
+    return mOriginNs + (ns > 0. ? static_cast<unsigned long long>(llround(ns)) : 0ull);
+  }
+
+  double PeriodNs() const
+  {
+    return mPeriodNs;
+  }
+
+  // of the board timebase against the host clock
+  double DriftPpm() const
+  {
+    return (mPeriodNs / mNominalPeriodNs - 1.) * 1e6;
+  }
+};
+
+#endif // _SCANCLOCK_H_
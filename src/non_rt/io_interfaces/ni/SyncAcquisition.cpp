@@ -0,0 +1,225 @@
+#include <SyncAcquisition.h>
+
+#include <string.h>
+
+namespace {
+
+constexpr auto kTimebaseHz = 100e6;
+
+} // namespace
+
+SyncAcquisition::SyncAcquisition(const char *name, unsigned long long (*clock)())
+  : mOffsets{}
+  , mNumDevices(0)
+  , mFrameBytes(0)
+  , mClock(clock)
+  , mCounters{}
+  , mLastScans(0)
+  , mRunning(false)
+  , mName(name)
+  , mRing(std::make_unique<SyncRing>())
+{}
+
+int SyncAcquisition::AddDevice(std::shared_ptr<NiDeviceService> service)
+{
+  if(mNumDevices == SyncAcquisitionLimit::kMaxDevices)
+  {
+    printf("%s: %u devices at most.\n", mName, SyncAcquisitionLimit::kMaxDevices);
+    return -1;
+  }
+  mServices[mNumDevices++] = service;
+  return 0;
+}
+
+int SyncAcquisition::Open(const NiAiConfig &config, const bool lockPll)
+{
+  if(mNumDevices == 0)
+  {
+    printf("%s: No devices.\n", mName);
+    return -1;
+  }
+  const auto isPCIe = mServices[0]->DeviceInfo()->isPCIe;
+  for(auto i{1u}; i < mNumDevices; ++i)
+  {
+    if(mServices[i]->DeviceInfo()->isPCIe != isPCIe)
+    {
+      printf("%s: Unable to perform trigger skew correction with mixed PCIe and PXIe devices.\n",
+        mName);
+      return -1;
+    }
+  }
+
+  for(auto i{0u}; i < mNumDevices; ++i)
+  {
+    auto &service = *mServices[i];
+    if(service.EnableSync(NiSyncConfig{i == 0, lockPll}) || service.EnableAi(config))
+      return -1;
+    const auto frameBytes = service.FrameBytes(nNISTC3::kAI_DMAChannel);
+    if(i > 0 && (frameBytes != mFrameBytes ||
+      service.AiSamplePeriodTicks() != mServices[0]->AiSamplePeriodTicks()))
+    {
+      printf("%s: %s does not scan as %s does.\n", mName, service.mName, mServices[0]->mName);
+      return -1;
+    }
+    mFrameBytes = frameBytes;
+  }
+  printf("%s: %u devices, %u channels each every %.1f us, %s.\n", mName, mNumDevices,
+    config.mNumChannels, mServices[0]->AiSamplePeriodTicks() * 1e6 / kTimebaseHz,
+    lockPll ? "phase-locked" : "on their own oscillators");
+  return 0;
+}
+
+int SyncAcquisition::Start()
+{
+  if(mFrameBytes == 0)
+    return -1;
+  mCounters = SyncAcquisitionCounters{};
+  mLastScans = 0;
+  for(auto &offset : mOffsets)
+  {
+    offset = 0;
+  }
+  // the slaves arm and wait for the master's trigger
+  for(auto i{mNumDevices}; i-- > 1;)
+  {
+    if(mServices[i]->Start())
+    {
+      Stop();
+      return -1;
+    }
+  }
+  mScanClock.Start(mClock(), mServices[0]->AiSamplePeriodTicks() * 1e9 / kTimebaseHz);
+  if(mServices[0]->Start())
+  {
+    Stop();
+    return -1;
+  }
+  mRunning = true;
+  return 0;
+}
+
+// the scans every device has in its oldest block, side by side into ring blocks
+void SyncAcquisition::Merge()
+{
+  const auto maxScans = NiServiceLimit::kBlockBytes / mFrameBytes;
+  const NiStreamBlock *blocks[SyncAcquisitionLimit::kMaxDevices];
+  while(true)
+  {
+    auto numScans = maxScans;
+    for(auto i{0u}; i < mNumDevices; ++i)
+    {
+      blocks[i] = mServices[i]->Ring(nNISTC3::kAI_DMAChannel).Peek();
+      const auto available = blocks[i] ? (blocks[i]->mBytes - mOffsets[i]) / mFrameBytes : 0;
+      if(available < numScans)
+        numScans = available;
+    }
+    if(numScans == 0)
+      return;
+
+    auto *merged = mRing->Reserve();
+    if(merged != NULL)
+    {
+      auto *data = merged->mData;
+      for(auto k{0u}; k < numScans; ++k)
+      {
+        for(auto i{0u}; i < mNumDevices; ++i)
+        {
+          memcpy(data, blocks[i]->mData + mOffsets[i] + k * mFrameBytes, mFrameBytes);
+          data += mFrameBytes;
+        }
+      }
+      merged->mFirstScan = mCounters.mScans;
+      merged->mNs = mScanClock.ScanNs(mCounters.mScans);
+      merged->mPeriodNs = mScanClock.PeriodNs();
+      merged->mNumScans = numScans;
+      merged->mBytes = static_cast<uint32_t>(data - merged->mData);
+      mRing->Commit();
+      ++mCounters.mBlocks;
+    }
+    else
+    {
+      ++mCounters.mOverflows;
+    }
+    mCounters.mScans += numScans;
+
+    for(auto i{0u}; i < mNumDevices; ++i)
+    {
+      mOffsets[i] += numScans * mFrameBytes;
+      if(mOffsets[i] == blocks[i]->mBytes)
+      {
+        mServices[i]->Ring(nNISTC3::kAI_DMAChannel).Release();
+        mOffsets[i] = 0;
+      }
+    }
+  }
+}
+
+int SyncAcquisition::Poll()
+{
+  if(!mRunning)
+    return -1;
+
+  auto failed{false};
+  for(auto i{0u}; i < mNumDevices; ++i)
+  {
+    if(mServices[i]->Poll() < 0)
+      failed = true;
+  }
+  // the newest scan the master delivered was taken before the polls returned
+  const auto pollNs = mClock();
+  unsigned long long minScans{~0ull}, maxScans{0};
+  for(auto i{0u}; i < mNumDevices; ++i)
+  {
+    const auto &counters = mServices[i]->Counters(nNISTC3::kAI_DMAChannel);
+    const auto scans = counters.mBytes / mFrameBytes;
+    if(scans < minScans)
+      minScans = scans;
+    if(scans > maxScans)
+      maxScans = scans;
+    if(counters.mOverflows > 0)
+      failed = true;
+  }
+  mScanClock.Observe(mServices[0]->Counters(nNISTC3::kAI_DMAChannel).mBytes / mFrameBytes,
+    pollNs);
+  if(maxScans - minScans > mCounters.mMaxSkewScans)
+    mCounters.mMaxSkewScans = maxScans - minScans;
+
+  const auto scans = mCounters.mScans;
+  Merge();
+  if(failed)
+  {
+    ++mCounters.mMisaligned;
+    return -1;
+  }
+  return static_cast<int>(mCounters.mScans - scans);
+}
+
+void SyncAcquisition::Stop()
+{
+  for(auto i{0u}; i < mNumDevices; ++i)
+  {
+    mServices[i]->Stop();
+  }
+  mRunning = false;
+}
+
+void SyncAcquisition::PrintStats(const unsigned long long elapsedNs,
+  int (*print)(const char*, ...))
+{
+  print("%s: scans/s: %.0f, blocks: %llu, overflows: %llu, misaligned: %llu, max skew %llu "
+    "scans, drift %.2f ppm, clock corrections: %llu\n", mName,
+    elapsedNs ? (mCounters.mScans - mLastScans) * 1e9 / elapsedNs : 0., mCounters.mBlocks,
+    mCounters.mOverflows, mCounters.mMisaligned, mCounters.mMaxSkewScans,
+    mScanClock.DriftPpm(), mScanClock.mCorrections);
+  mLastScans = mCounters.mScans;
+  mCounters.mMaxSkewScans = 0;
+  for(auto i{0u}; i < mNumDevices; ++i)
+  {
+    mServices[i]->PrintStats(elapsedNs, print);
+  }
+}
+
+SyncAcquisition::~SyncAcquisition()
+{
+  Stop();
+}
@@ -0,0 +1,114 @@
+#ifndef _SYNCACQUISITION_H_
+#define _SYNCACQUISITION_H_
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include <memory>
+
+#include <NiDeviceService.h>
+#include <RtSpscRing.h>
+#include <ScanClock.h>
+
+namespace SyncAcquisitionLimit
+{
+constexpr auto kMaxDevices = 4u; // master first
+constexpr auto kRingBlocks = 32u;
+constexpr auto kBlockBytes = kMaxDevices * NiServiceLimit::kBlockBytes;
+}
+
+// the same scans of every device side by side, device 0 first, and their host time
+struct SyncBlock
+{
+  unsigned long long mFirstScan; // since the start
+  unsigned long long mNs; // of the first scan, on the clock of the service loop
+  double mPeriodNs; // scan k of the block was at mNs + k * mPeriodNs
+  uint32_t mNumScans;
+  uint32_t mBytes;
+  uint8_t mData[SyncAcquisitionLimit::kBlockBytes];
+};
+
+typedef RtSpscRing<SyncBlock, SyncAcquisitionLimit::kRingBlocks> SyncRing;
+
+struct SyncAcquisitionCounters
+{
+  unsigned long long mScans; // merged
+  unsigned long long mBlocks;
+  // scans of every device dropped on a full ring, they stay aligned
+  unsigned long long mOverflows;
+  // polls that found a device ring overflowed, the devices can't be aligned after one
+  unsigned long long mMisaligned;
+  // since the last PrintStats()
+  unsigned long long mMaxSkewScans; // the most one device delivered ahead of another
+};
+
+/*
+ * ai of several x series boards scanning together, merged and timestamped
+ *
+ * the boards are routed as in aiex6: the master exports its ai start trigger on rtsi 0
+ * and every slave starts from it, and with the pll their timebases lock to one
+ * reference, so scan k of every board is the same instant and they never drift apart.
+ * Poll() serves every board, then merges the scans all of them delivered into one ring,
+ * whole scans of every board side by side. a ScanClock fed by the polls of the master
+ * maps the scan count into the time of the clock the polls run on, so a block is
+ * stamped with when its scans were taken rather than when they were read.
+ */
+class SyncAcquisition
+{
+private:
+  std::shared_ptr<NiDeviceService> mServices[SyncAcquisitionLimit::kMaxDevices];
+  uint32_t mOffsets[SyncAcquisitionLimit::kMaxDevices]; // into the oldest block of a device
+  unsigned int mNumDevices;
+  uint32_t mFrameBytes; // of one device
+  unsigned long long (*mClock)();
+  ScanClock mScanClock;
+  SyncAcquisitionCounters mCounters;
+  unsigned long long mLastScans; // at the last PrintStats()
+  bool mRunning;
+
+  void Merge();
+
+public:
+  const char *mName;
+  std::unique_ptr<SyncRing> mRing;
+
+public:
+  SyncAcquisition() = delete;
+  SyncAcquisition(const char *name, unsigned long long (*clock)());
+
+  SyncAcquisition(const SyncAcquisition&) = delete;
+  SyncAcquisition& operator=(const SyncAcquisition&) = delete;
+
+  // an opened service, the first one added is the master
+  int AddDevice(std::shared_ptr<NiDeviceService> service);
+  // synchronizes the devices, then enables the same ai on each
+  int Open(const NiAiConfig &config, const bool lockPll=true);
+  // starts the slaves waiting for the trigger, then the master
+  int Start();
+  // polls every device and merges what all of them scanned, returns the scans merged or
+  // -1 when a device failed or fell out of step
+  int Poll();
+  void Stop();
+
+  unsigned int NumDevices() const
+  {
+    return mNumDevices;
+  }
+  uint32_t FrameBytes() const
+  {
+    return mFrameBytes;
+  }
+  const ScanClock& Clock() const
+  {
+    return mScanClock;
+  }
+  const SyncAcquisitionCounters& Counters() const
+  {
+    return mCounters;
+  }
+  void PrintStats(const unsigned long long elapsedNs, int (*print)(const char*, ...)=printf);
+
+  ~SyncAcquisition();
+};
+
+#endif // _SYNCACQUISITION_H_
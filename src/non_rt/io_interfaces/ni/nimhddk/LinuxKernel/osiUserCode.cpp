@@ -14,9 +14,11 @@
 
 // Platform independent headers
 #include "osiBus.h"
+#include "osiDMAPool.h"
 
 // Linux specific headers
 #include <stdio.h>
+#include <string.h>
 #include <fcntl.h>
 #include <unistd.h>
 #include <sys/mman.h>
@@ -33,8 +35,14 @@ struct tLinuxSpecific
     void *mappedMemory1;
     unsigned long bar1Size;
     #endif
+    tDMAPool *dmaPool;
+    void *dmaPoolMemory;
+    unsigned long dmaPoolPhysical;
+    unsigned long dmaPoolSize;
 };
 
+static void releaseDMAPool (tLinuxSpecific *specific);
+
 
 static i32 getBoardId (u32 bus, u32 device);
 
@@ -148,6 +156,10 @@ iBus* acquireBoard(tChar* brdLocation)
     specific->mappedMemory1 = mem1;
     specific->bar1Size = bar1Size;
     #endif
+    specific->dmaPool = NULL;
+    specific->dmaPoolMemory = NULL;
+    specific->dmaPoolPhysical = 0;
+    specific->dmaPoolSize = 0;
 
     bus->_osSpecific = reinterpret_cast<void*> (specific);
     return bus;
@@ -157,6 +169,8 @@ void releaseBoard(iBus *&bus)
 {
     tLinuxSpecific *specific = reinterpret_cast <tLinuxSpecific *> ( bus->_osSpecific );
 
+    releaseDMAPool (specific);
+
     munmap (specific->mappedMemory0, specific->bar0Size);
     #ifndef kBAR0Only
     munmap (specific->mappedMemory1, specific->bar1Size);
@@ -216,6 +230,26 @@ class tLinuxDMAMemory : public tDMAMemory
     int _fd;
 };
 
+// A block of the DMA pool, freeing it hands it back to the pool
+class tLinuxPooledDMAMemory : public tDMAMemory
+{
+
+    public:
+
+    tLinuxPooledDMAMemory (void * vAddress, u32 pAddress, u32 size, tDMAPool *pool, u32 offset):
+        tDMAMemory (vAddress, pAddress, size),
+        _pool(pool),
+        _offset(offset)
+    {};
+
+    ~tLinuxPooledDMAMemory();
+
+    private:
+
+    tDMAPool *_pool;
+    u32 _offset;
+};
+
 
 tDMAMemory * iBus::allocDMA (u32 size)
 {
@@ -225,6 +259,17 @@ tDMAMemory * iBus::allocDMA (u32 size)
     unsigned long physicalAddress;
     void *virtualAddress;
 
+    // Carve the buffer from the pool when there is room
+    if (specific->dmaPool != NULL)
+    {
+        u32 offset = specific->dmaPool->allocate(size);
+        if (offset != kDMAPoolInvalidOffset)
+        {
+            return new tLinuxPooledDMAMemory ((u8 *)specific->dmaPoolMemory + offset,
+                (u32)(specific->dmaPoolPhysical + offset), size, specific->dmaPool, offset);
+        }
+    }
+
     physicalAddress = (unsigned long) size;
     if ( ioctl (fd, NIRLP_IOCTL_ALLOCATE_DMA_BUFFER, &physicalAddress) < 0 )
     {
@@ -253,6 +298,76 @@ void iBus::freeDMA (tDMAMemory *mem)
     delete mem;
 }
 
+tStatus iBus::reserveDMA (u32 size)
+{
+    tLinuxSpecific *specific = reinterpret_cast <tLinuxSpecific*> ( _osSpecific );
+
+    if (size == 0)
+    {
+        if (specific->dmaPool != NULL && specific->dmaPool->getBytesUsed() != 0)
+        {
+            return kStatusWrongState;
+        }
+        releaseDMAPool (specific);
+        return kStatusSuccess;
+    }
+
+    if (specific->dmaPool != NULL)
+    {
+        return kStatusWrongState;
+    }
+
+    // One physically contiguous block from the driver, as allocDMA() gets
+    int fd = specific->fileDescriptor;
+    unsigned long physicalAddress = (unsigned long) size;
+    if ( ioctl (fd, NIRLP_IOCTL_ALLOCATE_DMA_BUFFER, &physicalAddress) < 0 )
+    {
+        return kStatusRuntimeError;
+    }
+
+    // Map all pages up front and keep them resident. The driver maps its
+    // buffers with small pages, so huge pages are not available here; one
+    // region still keeps every buffer on a few neighbouring page table pages.
+    void *virtualAddress = mmap (NULL, size, PROT_READ|PROT_WRITE, MAP_SHARED|MAP_POPULATE,
+        fd, physicalAddress);
+    if (virtualAddress == MAP_FAILED)
+    {
+        ioctl (fd, NIRLP_IOCTL_FREE_DMA_BUFFER, &physicalAddress);
+        return kStatusRuntimeError;
+    }
+    mlock (virtualAddress, size);
+    memset (virtualAddress, 0x0, size);
+
+    specific->dmaPool = new tDMAPool (size);
+    specific->dmaPoolMemory = virtualAddress;
+    specific->dmaPoolPhysical = physicalAddress;
+    specific->dmaPoolSize = size;
+    return kStatusSuccess;
+}
+
+const tDMAPool* iBus::getDMAPool () const
+{
+    const tLinuxSpecific *specific = reinterpret_cast <const tLinuxSpecific*> ( _osSpecific );
+    return specific->dmaPool;
+}
+
+void releaseDMAPool (tLinuxSpecific *specific)
+{
+    if (specific->dmaPool == NULL)
+    {
+        return;
+    }
+
+    munmap (specific->dmaPoolMemory, specific->dmaPoolSize);
+    ioctl (specific->fileDescriptor, NIRLP_IOCTL_FREE_DMA_BUFFER, &specific->dmaPoolPhysical);
+
+    delete specific->dmaPool;
+    specific->dmaPool = NULL;
+    specific->dmaPoolMemory = NULL;
+    specific->dmaPoolPhysical = 0;
+    specific->dmaPoolSize = 0;
+}
+
 //
 //  tLinuxDMAMemory
 //
@@ -267,3 +382,13 @@ tLinuxDMAMemory::~tLinuxDMAMemory()
     ioctl (_fd, NIRLP_IOCTL_FREE_DMA_BUFFER, &physicalAddress );
     _fd = 0;
 }
+
+//
+//  tLinuxPooledDMAMemory
+//
+
+tLinuxPooledDMAMemory::~tLinuxPooledDMAMemory()
+{
+    _pool->free(_offset);
+    _pool = NULL;
+}
@@ -0,0 +1,280 @@
+/*
+ * osiUserCode.cpp (for a simulated board)
+ *   osiUserCode.cpp holds the two user defined functions needed to port iBus
+ *   to a target platform. This port has no board and no driver behind it:
+ *   BAR0 is the register file of a tSimulatedXSeries and DMA memory is a
+ *   host mapping with made up bus addresses that the simulated DMA channels
+ *   resolve.
+ *
+ *   iBus* acquireBoard(char*brdLocation) -- constructs a simulated board and its iBus
+ *   void  releaseBoard(iBus *&bus) -- deletes both
+ *
+ * Build with kSimulatedBus so tAddressSpace hands its accesses to the board.
+ *
+ */
+
+// Platform independent headers
+#include "osiBus.h"
+#include "osiDMAPool.h"
+
+#include "tSimulatedXSeries.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+
+// Host DMA memory of a board, and the bus address the DMA channels see for it
+static const u32 kSimulatedDMAMemorySize = 64 * 1024 * 1024;
+static const u32 kSimulatedDMAPhysical   = 0x40000000;
+static const u32 kSimulatedBoards        = 4;
+
+struct tSimulatedSpecific
+{
+    tSimulatedXSeries *device;
+    void *dmaMemory;
+    tDMAPool *dmaMemoryPool;
+    tDMAPool *dmaPool;
+    u32 dmaPoolOffset;
+};
+
+struct tSimulatedBoard
+{
+    iBus *bus;
+    tSimulatedXSeries *device;
+};
+
+static tSimulatedBoard boards[kSimulatedBoards];
+
+iBus* acquireBoard(tChar* brdLocation)
+{
+    u32 slot = 0;
+    while (slot < kSimulatedBoards && boards[slot].bus != NULL)
+    {
+        ++slot;
+    }
+    if (slot == kSimulatedBoards)
+    {
+        printf ("no simulated board left for %s\n", brdLocation);
+        return NULL;
+    }
+
+    // Pages are faulted in as the DMA buffers touch them
+    void *dmaMemory = mmap (NULL, kSimulatedDMAMemorySize, PROT_READ|PROT_WRITE,
+        MAP_PRIVATE|MAP_ANONYMOUS, -1, 0);
+    if (dmaMemory == MAP_FAILED)
+    {
+        return NULL;
+    }
+
+    tSimulatedXSeries *device = new tSimulatedXSeries ((u8 *)dmaMemory, kSimulatedDMAPhysical,
+        kSimulatedDMAMemorySize);
+
+    iBus *bus = new iBus(0, 0, device->getBar0(), NULL);
+    bus->_physBar[0] = (u32)NULL;
+    bus->_physBar[1] = (u32)NULL;
+    bus->_physBar[2] = (u32)NULL;
+    bus->_physBar[3] = (u32)NULL;
+    bus->_physBar[4] = (u32)NULL;
+    bus->_physBar[5] = (u32)NULL;
+
+    tSimulatedSpecific *specific = new tSimulatedSpecific;
+    specific->device = device;
+    specific->dmaMemory = dmaMemory;
+    specific->dmaMemoryPool = new tDMAPool (kSimulatedDMAMemorySize);
+    specific->dmaPool = NULL;
+    specific->dmaPoolOffset = kDMAPoolInvalidOffset;
+
+    bus->_osSpecific = reinterpret_cast<void*> (specific);
+    boards[slot].bus = bus;
+    boards[slot].device = device;
+    return bus;
+}
+
+void releaseBoard(iBus *&bus)
+{
+    tSimulatedSpecific *specific = reinterpret_cast <tSimulatedSpecific *> ( bus->_osSpecific );
+
+    for (u32 slot=0; slot<kSimulatedBoards; ++slot)
+    {
+        if (boards[slot].bus == bus)
+        {
+            boards[slot].bus = NULL;
+            boards[slot].device = NULL;
+        }
+    }
+
+    delete specific->dmaPool;
+    delete specific->dmaMemoryPool;
+    munmap (specific->dmaMemory, kSimulatedDMAMemorySize);
+    delete specific->device;
+
+    delete specific;
+    delete bus;
+    bus = NULL;
+}
+
+tSimulatedXSeries* getSimulatedXSeries (iBus* bus)
+{
+    for (u32 slot=0; slot<kSimulatedBoards; ++slot)
+    {
+        if (boards[slot].bus == bus && bus != NULL)
+        {
+            return boards[slot].device;
+        }
+    }
+    return NULL;
+}
+
+//
+// Register accesses
+//
+
+static tSimulatedXSeries* findDevice (const u8 *address, u32 &offset)
+{
+    // An address space can start anywhere in BAR0, eepromHelper starts one
+    // at the EEPROM window
+    for (u32 slot=0; slot<kSimulatedBoards; ++slot)
+    {
+        tSimulatedXSeries *device = boards[slot].device;
+        if (device != NULL && address >= device->getBar0() &&
+            address < device->getBar0() + kSimulatedBar0Size)
+        {
+            offset = (u32)(address - device->getBar0());
+            return device;
+        }
+    }
+    return NULL;
+}
+
+u32 tAddressSpace::_simulatedRead(const u32 registerOffset, const u32 size)
+{
+    u32 offset = 0;
+    tSimulatedXSeries *device = findDevice ((u8 *)theSpace + registerOffset, offset);
+    if (device == NULL)
+    {
+        return 0xFFFFFFFF;
+    }
+    return device->read (offset, size);
+}
+
+void tAddressSpace::_simulatedWrite(const u32 registerOffset, const u32 data, const u32 size)
+{
+    u32 offset = 0;
+    tSimulatedXSeries *device = findDevice ((u8 *)theSpace + registerOffset, offset);
+    if (device != NULL)
+    {
+        device->write (offset, data, size);
+    }
+}
+
+//
+// DMA Memory support
+//
+
+// A block of host DMA memory or of the reserved pool, freeing it hands it back
+class tSimulatedDMAMemory : public tDMAMemory
+{
+
+    public:
+
+    tSimulatedDMAMemory (void * vAddress, u32 pAddress, u32 size, tDMAPool *pool, u32 offset):
+        tDMAMemory (vAddress, pAddress, size),
+        _pool(pool),
+        _offset(offset)
+    {};
+
+    ~tSimulatedDMAMemory();
+
+    private:
+
+    tDMAPool *_pool;
+    u32 _offset;
+};
+
+
+tDMAMemory * iBus::allocDMA (u32 size)
+{
+    tSimulatedSpecific *specific = reinterpret_cast <tSimulatedSpecific*> ( _osSpecific );
+
+    // Carve the buffer from the reserved pool when there is room
+    if (specific->dmaPool != NULL)
+    {
+        u32 offset = specific->dmaPool->allocate(size);
+        if (offset != kDMAPoolInvalidOffset)
+        {
+            u32 hostOffset = specific->dmaPoolOffset + offset;
+            return new tSimulatedDMAMemory ((u8 *)specific->dmaMemory + hostOffset,
+                kSimulatedDMAPhysical + hostOffset, size, specific->dmaPool, offset);
+        }
+    }
+
+    u32 offset = specific->dmaMemoryPool->allocate(size);
+    if (offset == kDMAPoolInvalidOffset)
+    {
+        return NULL;
+    }
+
+    // Fresh from the driver a buffer reads zero, reused host memory would not
+    void *virtualAddress = (u8 *)specific->dmaMemory + offset;
+    memset (virtualAddress, 0x0, size);
+    return new tSimulatedDMAMemory (virtualAddress, kSimulatedDMAPhysical + offset, size,
+        specific->dmaMemoryPool, offset);
+}
+
+void iBus::freeDMA (tDMAMemory *mem)
+{
+    delete mem;
+}
+
+tStatus iBus::reserveDMA (u32 size)
+{
+    tSimulatedSpecific *specific = reinterpret_cast <tSimulatedSpecific*> ( _osSpecific );
+
+    if (size == 0)
+    {
+        if (specific->dmaPool != NULL && specific->dmaPool->getBytesUsed() != 0)
+        {
+            return kStatusWrongState;
+        }
+        if (specific->dmaPool != NULL)
+        {
+            specific->dmaMemoryPool->free(specific->dmaPoolOffset);
+            delete specific->dmaPool;
+            specific->dmaPool = NULL;
+            specific->dmaPoolOffset = kDMAPoolInvalidOffset;
+        }
+        return kStatusSuccess;
+    }
+
+    if (specific->dmaPool != NULL)
+    {
+        return kStatusWrongState;
+    }
+
+    u32 offset = specific->dmaMemoryPool->allocate(size);
+    if (offset == kDMAPoolInvalidOffset)
+    {
+        return kStatusRuntimeError;
+    }
+    memset ((u8 *)specific->dmaMemory + offset, 0x0, size);
+
+    specific->dmaPool = new tDMAPool (size);
+    specific->dmaPoolOffset = offset;
+    return kStatusSuccess;
+}
+
+const tDMAPool* iBus::getDMAPool () const
+{
+    const tSimulatedSpecific *specific = reinterpret_cast <const tSimulatedSpecific*> ( _osSpecific );
+    return specific->dmaPool;
+}
+
+//
+//  tSimulatedDMAMemory
+//
+
+tSimulatedDMAMemory::~tSimulatedDMAMemory()
+{
+    _pool->free(_offset);
+    _pool = NULL;
+}
@@ -0,0 +1,1629 @@
+/*
+ * tSimulatedXSeries.cpp
+ *   The register file and behavior model of a simulated X Series board
+ *
+ */
+
+#include "tSimulatedXSeries.h"
+
+// Chip Objects, for the register offsets and fields
+#include "tXSeries.h"
+
+#include <string.h>
+#include <time.h>
+
+namespace
+{
+   namespace nCommand    = nCounter::nGi_Command_Register;
+   namespace nStatus     = nCounter::nGi_Status_Register;
+   namespace nDMAConfig  = nCounter::nGi_DMA_Config_Register;
+   namespace nInterrupt  = nCounter::nGi_Interrupt1_Register;
+   namespace nOperation  = nDMAController::nChannel_Operation_Register;
+   namespace nChStatus   = nDMAController::nChannel_Status_Register;
+   namespace nControl    = nDMAController::nChannel_Control_Register;
+   namespace nStreamCtrl = nStreamCircuitRegMap::nStreamControlStatusReg;
+   namespace nAiCommand  = nInTimer::nCommand_Register;
+   namespace nAiStatus   = nInTimer::nStatus_1_Register;
+   namespace nAoCommand  = nOutTimer::nCommand_1_Register;
+   namespace nAoStatus   = nOutTimer::nStatus_1_Register;
+   namespace nAoIrq      = nOutTimer::nInterrupt1_Register;
+   namespace nAiTrigger  = nAI::nAI_Trigger_Select_Register;
+   namespace nRtsiSelect = nTriggers::nRTSI_OutputSelectRegister_t;
+   namespace nRtsiDirection = nTriggers::nRTSI_Trig_Direction_Register;
+   namespace nWdtStatus  = nBrdServices::nWatchdogStatusRegister;
+   namespace nWdtConfig  = nBrdServices::nWatchdogConfiguration;
+
+   // Bases of the register maps in BAR0, as tXSeries::initialize() puts them
+   const u32 kDMAChannelBase     = 0x2000;
+   const u32 kDMAChannelStride   = 0x100;
+   const u32 kCounterBase        = 0x20300;
+   const u32 kCounterStride      = 0x40;
+   const u32 kStreamBase         = 0x24000;
+   const u32 kStreamStride       = 0x2000;
+   const u32 kAIBase             = 0x20270;
+   const u32 kAITimerBase        = kAIBase + 0x40;
+   const u32 kAOBase             = 0x20400;
+   const u32 kAOTimerBase        = kAOBase + 0x70;
+   const u32 kDIBase             = 0x20530;
+   const u32 kDITimerBase        = kDIBase + 0x30;
+   const u32 kDOBase             = 0x204AC;
+   const u32 kDOTimerBase        = kDOBase + 0x34;
+   const u32 kBrdServicesBase    = 0x20000;
+   const u32 kTriggersBase       = 0x20000;
+   const u32 kRtsiOutputSelect   = kTriggersBase + 0xA8; // RTSI_OutputSelectRegister_i, a byte each
+
+   const u32 kAIStream           = 0;
+   const u32 kCounterStream      = 1;
+   const u32 kDIStream           = 5;
+   const u32 kAOStream           = 6;
+   const u32 kDOStream           = 7;
+   const u32 kDigitalSampleSize  = sizeof(u32);
+   const u32 kDigitalLines       = 32;       // Of port 0
+   const u32 kWdtModeBits        = 2;        // Per line in DO_WDT_ModeSelect1 and 2
+
+   // Watchdog Timer control values, as dioex6 writes them
+   const u16 kWdtFeed            = 0xFEED;
+   const u16 kWdtFood            = 0xF00D;
+   const u16 kWdtPause           = 0x1234;
+   const u16 kWdtStart           = 0x5678;
+   const u16 kWdtKill            = 0xDEAD;
+   const u16 kWdtReset           = 0xACED;
+
+   const u32 kNIVendorId         = 0x1093;
+   const u32 kMaxPayloadExponent = 8;        // 256 byte PCIe payloads
+   const u32 kMaxTransactionLimit = 0x10;
+   const u32 kChunkyLinkHeader   = 16;       // Bytes of a header or transfer link
+   const u32 kIsLastLink         = 0x80000000;
+   const u32 kMaxLinkSteps       = 64;       // Empty links followed before giving up
+
+   const u64 kNever              = ~0ull;
+
+   const u32 kRtsiLines          = 8;
+   const u32 kSoftwareTrigger    = kRtsiLines; // What an armed AI waits on besides a line
+   const u32 kNoTrigger          = ~0u;
+
+   // The RTSI lines all boards share, with the last pulse on each in model time
+   struct tBackplane
+   {
+      u64 pulseNs[kRtsiLines];
+      u64 pulses[kRtsiLines];
+   };
+
+   tBackplane backplane;
+
+   // The RTSI line of an AI START1 source, kNoTrigger for the others
+   u32 rtsiLine(u32 start1Select)
+   {
+      if (start1Select >= nAI::kStart1_RTSI0 && start1Select <= nAI::kStart1_RTSI6)
+      {
+         return start1Select - nAI::kStart1_RTSI0;
+      }
+      return start1Select == nAI::kStart1_RTSI7 ? 7 : kNoTrigger;
+   }
+
+   inline u64 ticks(u64 ns)
+   {
+      return ns / (1000000000 / kSimulatedTimebaseHz);
+   }
+
+   inline u64 nanoseconds(u64 ticks)
+   {
+      return ticks * (1000000000 / kSimulatedTimebaseHz);
+   }
+
+   inline u64 readU64(const u8* p)
+   {
+      u64 value;
+      memcpy(&value, p, sizeof(value));
+      return value;
+   }
+
+   inline u32 readU32(const u8* p)
+   {
+      u32 value;
+      memcpy(&value, p, sizeof(value));
+      return value;
+   }
+}
+
+tSimulatedXSeries::tSimulatedXSeries(u8* host, u64 hostPhysical, u32 hostSize) :
+   _memory(new u8[kSimulatedBar0Size]),
+   _hostMemory(host),
+   _hostPhysical(hostPhysical),
+   _hostSize(hostSize),
+   _productId(kSimulatedProductId),
+   _aiArmed(kFalse),
+   _aiChannels(0),
+   _aiScanPeriodNs(0),
+   _aiNextScanNs(kNever),
+   _aiStartNs(0),
+   _aiScans(0),
+   _aiPeriodScale(1.),
+   _aiTriggerLine(kNoTrigger),
+   _aiTriggerPulses(0),
+   _aiSource(NULL),
+   _aiContext(NULL),
+   _aiOverflow(kFalse),
+   _aoArmed(kFalse),
+   _aoChannels(0),
+   _aoUpdatePeriodNs(0),
+   _aoNextUpdateNs(kNever),
+   _aoSink(NULL),
+   _aoContext(NULL),
+   _aoUnderflow(kFalse),
+   _diArmed(kFalse),
+   _diSamplePeriodNs(0),
+   _diNextSampleNs(kNever),
+   _diSource(NULL),
+   _diContext(NULL),
+   _diOverflow(kFalse),
+   _doArmed(kFalse),
+   _doUpdatePeriodNs(0),
+   _doNextUpdateNs(kNever),
+   _doSink(NULL),
+   _doContext(NULL),
+   _doUnderflow(kFalse),
+   _doLastValue(0),
+   _doPortValue(0),
+   _wdtState(nBrdServices::kWdtSt_SynchReset),
+   _wdtDeadlineNs(kNever),
+   _wdtExpirations(0),
+   _wdtFrozenValue(0),
+   _pulseSink(NULL),
+   _pulseContext(NULL),
+   _oscillatorPpm(0.),
+   _manualClock(kFalse),
+   _startNs(0),
+   _nowNs(0),
+   _overflows(0),
+   _underflows(0),
+   _eepromReads(0)
+{
+   memset(_memory, 0, kSimulatedBar0Size);
+   for (u32 i=0; i<kSimulatedStreams; ++i)
+   {
+      tStream& stream = _streams[i];
+      memset(&stream, 0, sizeof(stream));
+      tBoolean isInput = (i != kAOStream && i != kDOStream) ? kTrue : kFalse;
+      u32 capacity = (i >= kCounterStream && i < kCounterStream + kSimulatedCounters) ?
+         kSimulatedCounterFifo : kSimulatedDataFifo;
+      _resetStream(stream, isInput, capacity);
+   }
+   for (u32 i=0; i<kSimulatedCounters; ++i)
+   {
+      memset(&_counters[i], 0, sizeof(_counters[i]));
+      _counters[i].nextEdgeTick = kNever;
+      _counters[i].nextUpdateTick = kNever;
+   }
+   setEeprom(kSimulatedSerialNumber, kSimulatedCalTime, 1, 4);
+   _startNs = _hostNs();
+}
+
+tSimulatedXSeries::~tSimulatedXSeries()
+{
+   delete [] _memory;
+}
+
+//
+// Register file
+//
+
+u32 tSimulatedXSeries::read(u32 offset, u32 size)
+{
+   _update();
+
+   if (offset >= nCHInCh::kEEPROMOffset && offset < nCHInCh::kEEPROMOffset + kSimulatedEepromSize)
+   {
+      ++_eepromReads;
+   }
+
+   u32 data = 0;
+   if (_readModel(offset, size, data))
+   {
+      return data;
+   }
+   if (offset + size > kSimulatedBar0Size)
+   {
+      return 0xFFFFFFFF;
+   }
+   switch (size)
+   {
+      case 1:
+         return _memory[offset];
+      case 2:
+         return (u32)_memory[offset] | ((u32)_memory[offset + 1] << 8);
+      default:
+         return readU32(_memory + offset);
+   }
+}
+
+void tSimulatedXSeries::write(u32 offset, u32 data, u32 size)
+{
+   _update();
+
+   if (offset + size > kSimulatedBar0Size)
+   {
+      return;
+   }
+   memcpy(_memory + offset, &data, size);
+   _writeModel(offset, data);
+}
+
+tBoolean tSimulatedXSeries::_readModel(u32 offset, u32 size, u32& data)
+{
+   if (offset >= kDMAChannelBase && offset < kDMAChannelBase + kSimulatedStreams * kDMAChannelStride)
+   {
+      u32 index = (offset - kDMAChannelBase) / kDMAChannelStride;
+      u32 reg = (offset - kDMAChannelBase) % kDMAChannelStride;
+      switch (reg)
+      {
+         case tDMAController::tChannel_Status_Register::kOffset:
+         case tDMAController::tChannel_Total_Transfer_Count_Status_Register_LSW::kOffset:
+         case tDMAController::tChannel_Total_Transfer_Count_Status_Register_MSW::kOffset:
+            data = _readDMA(index, reg);
+            return kTrue;
+         default:
+            return kFalse;
+      }
+   }
+   if (offset >= kCounterBase && offset < kCounterBase + kSimulatedCounters * kCounterStride)
+   {
+      u32 index = (offset - kCounterBase) / kCounterStride;
+      u32 reg = (offset - kCounterBase) % kCounterStride;
+      switch (reg)
+      {
+         case tCounter::tGi_HW_Save_Register::kOffset:
+         case tCounter::tGi_Save_Register::kOffset:
+         case tCounter::tGi_Status_Register::kOffset:
+         case tCounter::tGi_FifoStatusRegister::kOffset:
+         case tCounter::tGi_RdFifoRegister::kOffset:
+            data = _readCounter(index, reg, size);
+            return kTrue;
+         default:
+            return kFalse;
+      }
+   }
+   if (offset >= kStreamBase && offset < kStreamBase + kSimulatedStreams * kStreamStride)
+   {
+      u32 index = (offset - kStreamBase) / kStreamStride;
+      u32 reg = (offset - kStreamBase) % kStreamStride;
+      switch (reg)
+      {
+         case tStreamCircuitRegMap::tStreamControlStatusReg::kOffset:
+         case tStreamCircuitRegMap::tStreamTransferCountReg::kOffset:
+         case tStreamCircuitRegMap::tStreamFifoSizeReg::kOffset:
+         case tStreamCircuitRegMap::tStreamTransactionLimitReg::kOffset:
+            data = _readStream(index, reg);
+            return kTrue;
+         default:
+            return kFalse;
+      }
+   }
+
+   switch (offset)
+   {
+      case tCHInCh::tCHInCh_Identification_Register::kOffset:
+         data = (u32)nCHInCh::kCHInChSignature;
+         return kTrue;
+      case tCHInCh::tIO_Port_Resource_Description_Register::kOffset:
+         data = kMaxPayloadExponent << nCHInCh::nIO_Port_Resource_Description_Register::nIOMPS::kOffset;
+         return kTrue;
+      case tCHInCh::tPCI_SubSystem_ID_Access_Register::kOffset:
+         data = (_productId << 16) | kNIVendorId;
+         return kTrue;
+      case kBrdServicesBase + tBrdServices::tSignature_Register::kOffset:
+         data = nBrdServices::kSTC3_RevBSignature;
+         return kTrue;
+      case kBrdServicesBase + tBrdServices::tWatchdogStatusRegister::kOffset:
+         data = ((_wdtState << nWdtStatus::nWatchdogSM_State::kOffset) &
+            nWdtStatus::nWatchdogSM_State::kMask) |
+            ((_wdtExpirations << nWdtStatus::nWatchdogExpiredCnt::kOffset) &
+            nWdtStatus::nWatchdogExpiredCnt::kMask);
+         return kTrue;
+      case kTriggersBase + tTriggers::tPLL_Status_Register::kOffset:
+         data = nTriggers::nPLL_Status_Register::nPLL_TimerExpired::kMask |
+            nTriggers::nPLL_Status_Register::nHW_Pll_Locked::kMask;
+         return kTrue;
+      case kAIBase + tAI::tAI_Data_FIFO_Status_Register::kOffset:
+         data = _streams[kAIStream].count / sizeof(i16);
+         return kTrue;
+      case kAIBase + tAI::tAI_FIFO_Data_Register::kOffset:
+         data = 0;
+         _pop(_streams[kAIStream], &data, size);
+         return kTrue;
+      case kAITimerBase + tInTimer::tStatus_1_Register::kOffset:
+         data = 0;
+         if (_aiArmed)
+         {
+            data |= nAiStatus::nSC_Armed_St::kMask | nAiStatus::nSI_Armed_St::kMask;
+         }
+         if (_streams[kAIStream].count == 0)
+         {
+            data |= nAiStatus::nFIFO_Empty_St::kMask;
+         }
+         if (_aiOverflow)
+         {
+            data |= nAiStatus::nOverflow_St::kMask;
+         }
+         return kTrue;
+      case kAOBase + tAO::tAO_FIFO_Status_Register::kOffset:
+         data = _streams[kAOStream].count / sizeof(i16);
+         return kTrue;
+      case kAOTimerBase + tOutTimer::tStatus_1_Register::kOffset:
+         data = 0;
+         if (_aoArmed)
+         {
+            data |= nAoStatus::nBC_Armed_St::kMask | nAoStatus::nUI_Armed_St::kMask |
+               nAoStatus::nUC_Armed_St::kMask;
+         }
+         if (_streams[kAOStream].count == 0)
+         {
+            data |= nAoStatus::nFIFO_Empty_St::kMask;
+         }
+         if (_aoUnderflow)
+         {
+            data |= nAoStatus::nUnderflow_St::kMask;
+         }
+         return kTrue;
+      case kDIBase + tDI::tDI_FIFO_St_Register::kOffset:
+         data = _streams[kDIStream].count / kDigitalSampleSize;
+         return kTrue;
+      case kDITimerBase + tInTimer::tStatus_1_Register::kOffset:
+         data = 0;
+         if (_diArmed)
+         {
+            data |= nAiStatus::nSC_Armed_St::kMask | nAiStatus::nSI_Armed_St::kMask;
+         }
+         if (_streams[kDIStream].count == 0)
+         {
+            data |= nAiStatus::nFIFO_Empty_St::kMask;
+         }
+         if (_diOverflow)
+         {
+            data |= nAiStatus::nOverflow_St::kMask;
+         }
+         return kTrue;
+      case kDOBase + tDO::tDO_FIFO_St_Register::kOffset:
+         data = _streams[kDOStream].count / kDigitalSampleSize;
+         return kTrue;
+      case kDOTimerBase + tOutTimer::tStatus_1_Register::kOffset:
+         data = 0;
+         if (_doArmed)
+         {
+            data |= nAoStatus::nBC_Armed_St::kMask | nAoStatus::nUI_Armed_St::kMask |
+               nAoStatus::nUC_Armed_St::kMask;
+         }
+         if (_streams[kDOStream].count == 0)
+         {
+            data |= nAoStatus::nFIFO_Empty_St::kMask;
+         }
+         if (_doUnderflow)
+         {
+            data |= nAoStatus::nUnderflow_St::kMask;
+         }
+         return kTrue;
+      default:
+         return kFalse;
+   }
+}
+
+tBoolean tSimulatedXSeries::_writeModel(u32 offset, u32 data)
+{
+   if (offset >= kDMAChannelBase && offset < kDMAChannelBase + kSimulatedStreams * kDMAChannelStride)
+   {
+      _writeDMA((offset - kDMAChannelBase) / kDMAChannelStride,
+         (offset - kDMAChannelBase) % kDMAChannelStride, data);
+      return kTrue;
+   }
+   if (offset >= kCounterBase && offset < kCounterBase + kSimulatedCounters * kCounterStride)
+   {
+      _writeCounter((offset - kCounterBase) / kCounterStride,
+         (offset - kCounterBase) % kCounterStride, data);
+      return kTrue;
+   }
+   if (offset >= kStreamBase && offset < kStreamBase + kSimulatedStreams * kStreamStride)
+   {
+      _writeStream((offset - kStreamBase) / kStreamStride, (offset - kStreamBase) % kStreamStride,
+         data);
+      return kTrue;
+   }
+
+   switch (offset)
+   {
+      case kBrdServicesBase + tBrdServices::tWatchdogControl::kOffset:
+         _commandWatchdog((u16)data);
+         return kTrue;
+      case kBrdServicesBase + tBrdServices::tWatchdogConfiguration::kOffset:
+         _emitDoPort(_nowNs);
+         return kTrue;
+      case kAITimerBase + tInTimer::tCommand_Register::kOffset:
+         if (data & nAiCommand::nDisarm::kMask)
+         {
+            _aiArmed = kFalse;
+            _aiNextScanNs = kNever;
+            _aiTriggerLine = kNoTrigger;
+         }
+         else if (data & nAiCommand::nSC_Arm::kMask)
+         {
+            _aiArmed = kTrue;
+            _aiOverflow = kFalse;
+            _aiNextScanNs = kNever;
+            u32 select = (readU32(_memory + kAIBase + tAI::tAI_Trigger_Select_Register::kOffset) &
+               nAiTrigger::nAI_START1_Select::kMask) >> nAiTrigger::nAI_START1_Select::kOffset;
+            _aiTriggerLine = (select == nAI::kStart1_SW_Pulse) ? kSoftwareTrigger : rtsiLine(select);
+            if (_aiTriggerLine == kNoTrigger)
+            {
+               _startAi(_nowNs);
+            }
+            else if (_aiTriggerLine < kRtsiLines)
+            {
+               _aiTriggerPulses = backplane.pulses[_aiTriggerLine];
+            }
+         }
+         if ((data & nAiCommand::nSTART1_Pulse::kMask) && _aiArmed &&
+            _aiTriggerLine == kSoftwareTrigger)
+         {
+            _startAi(_nowNs);
+         }
+         return kTrue;
+      case kAOBase + tAO::tAO_FIFO_Data_Register::kOffset:
+      {
+         i16 sample = (i16)data;
+         _push(_streams[kAOStream], &sample, sizeof(sample));
+         return kTrue;
+      }
+      case kAOTimerBase + tOutTimer::tCommand_1_Register::kOffset:
+         if (data & nAoCommand::nDisarm::kMask)
+         {
+            _aoArmed = kFalse;
+            _aoNextUpdateNs = kNever;
+         }
+         else if (data & (nAoCommand::nBC_Arm::kMask | nAoCommand::nUC_Arm::kMask |
+            nAoCommand::nUI_Arm::kMask))
+         {
+            _aoArmed = kTrue;
+            _aoUnderflow = kFalse;
+            _aoNextUpdateNs = _aoUpdatePeriodNs ? _nowNs + _aoUpdatePeriodNs : kNever;
+         }
+         return kTrue;
+      case kAOTimerBase + tOutTimer::tInterrupt1_Register::kOffset:
+         if (data & nAoIrq::nError_Interrupt_Ack::kMask)
+         {
+            _aoUnderflow = kFalse;
+         }
+         return kTrue;
+      case kDITimerBase + tInTimer::tCommand_Register::kOffset:
+         if (data & nAiCommand::nDisarm::kMask)
+         {
+            _diArmed = kFalse;
+            _diNextSampleNs = kNever;
+         }
+         else if (data & nAiCommand::nSC_Arm::kMask)
+         {
+            _diArmed = kTrue;
+            _diOverflow = kFalse;
+            _diNextSampleNs = _diSamplePeriodNs ? _nowNs + _diSamplePeriodNs : kNever;
+         }
+         return kTrue;
+      case kDOTimerBase + tOutTimer::tCommand_1_Register::kOffset:
+         if (data & nAoCommand::nDisarm::kMask)
+         {
+            _doArmed = kFalse;
+            _doNextUpdateNs = kNever;
+         }
+         else if (data & (nAoCommand::nBC_Arm::kMask | nAoCommand::nUC_Arm::kMask |
+            nAoCommand::nUI_Arm::kMask))
+         {
+            _doArmed = kTrue;
+            _doUnderflow = kFalse;
+            _doNextUpdateNs = _doUpdatePeriodNs ? _nowNs + _doUpdatePeriodNs : kNever;
+         }
+         return kTrue;
+      default:
+         return kFalse;
+   }
+}
+
+//
+// Script
+//
+
+void tSimulatedXSeries::setProductId(u32 productId)
+{
+   _productId = productId;
+}
+
+void tSimulatedXSeries::setEeprom(u32 serialNumber, u32 calTime, u32 numberOfADCs,
+                                  u32 numberOfDACs)
+{
+   // The layout eepromHelper walks: the list pointers, a serial number node and a
+   // device specific node of 32 bit ID, value pairs pointing at the cal areas
+   u8* eeprom = _memory + nCHInCh::kEEPROMOffset;
+   memset(eeprom, 0, kSimulatedEepromSize);
+   struct tWriter
+   {
+      u8* eeprom;
+      void u8At (u32 address, u8 value)   { eeprom[address] = value; }
+      void u16At (u32 address, u16 value) { memcpy(eeprom + address, &value, sizeof(value)); }
+      void u32At (u32 address, u32 value) { memcpy(eeprom + address, &value, sizeof(value)); }
+      void f32At (u32 address, f32 value) { memcpy(eeprom + address, &value, sizeof(value)); }
+   } put = { eeprom };
+
+   const u32 kListFlag      = 0x20;
+   const u32 kSerialNode    = 0x40;
+   const u32 kDeviceNode    = 0x50;
+   const u32 kExtCalArea    = 0x100;
+   const u32 kSelfCalArea   = 0x200;
+   put.u32At(0x0C, kListFlag);
+   put.u32At(kListFlag, 0);                        // List A
+   put.u32At(0x10, kSerialNode);
+
+   put.u16At(kSerialNode, (kDeviceNode - kSerialNode) | 0x2);   // Relative
+   put.u16At(kSerialNode + 2, 0x0004);
+   put.u32At(kSerialNode + 4, serialNumber);
+
+   const u32 pairs[][2] = { {0x40, kExtCalArea}, {0x42, kSelfCalArea},
+                            {0x0002, kSimulatedStc3Revision} };
+   const u32 numPairs = sizeof(pairs) / sizeof(pairs[0]);
+   put.u16At(kDeviceNode, 0);                      // Last node
+   put.u16At(kDeviceNode + 2, 0x0001);
+   put.u32At(kDeviceNode + 4, numPairs * 8 + 2 * sizeof(u32));
+   put.u32At(kDeviceNode + 8, 0x4);                // 32 bit ID, value
+   for (u32 i=0; i<numPairs; ++i)
+   {
+      put.u32At(kDeviceNode + 0xC + 8 * i, pairs[i][0]);
+      put.u32At(kDeviceNode + 0xC + 8 * i + 4, pairs[i][1]);
+   }
+
+   const u32 areas[] = { kExtCalArea, kSelfCalArea };
+   for (u32 i=0; i<2; ++i)
+   {
+      put.u32At(areas[i] + 2, calTime);
+      put.u32At(areas[i] + 6, 0);
+      put.f32At(areas[i] + 10, 25.0f + i);
+      put.f32At(areas[i] + 14, 5.0f);
+   }
+
+   // Modes are an order and four coefficients, intervals a gain and an offset
+   const f32 trim = 1.0f + static_cast<f32>((serialNumber ^ calTime) % 1000) * 1e-6f;
+   u32 address = kSelfCalArea + 2 + 0x10;
+   for (u32 i=0; i<numberOfADCs && address < kSimulatedEepromSize - 124; ++i)
+   {
+      for (u32 mode=0; mode<4; ++mode)
+      {
+         put.u8At(address, mode == 0 ? 1 : 0);
+         put.f32At(address + 1, mode == 0 ? 1e-4f * i : 0.0f);
+         put.f32At(address + 5, mode == 0 ? 10.0f / 32768.0f * trim : 0.0f);
+         put.f32At(address + 9, 0.0f);
+         put.f32At(address + 13, 0.0f);
+         address += 17;
+      }
+      for (u32 interval=0; interval<7; ++interval)
+      {
+         put.f32At(address, 1.0f / static_cast<f32>(1 << interval));
+         put.f32At(address + 4, 1e-5f * interval);
+         address += 8;
+      }
+   }
+   for (u32 i=0; i<numberOfDACs && address < kSimulatedEepromSize - 49; ++i)
+   {
+      put.u8At(address, 1);
+      put.f32At(address + 1, 0.0f);
+      put.f32At(address + 5, 1.0f);
+      put.f32At(address + 9, 0.0f);
+      put.f32At(address + 13, 0.0f);
+      address += 17;
+      for (u32 interval=0; interval<4; ++interval)
+      {
+         put.f32At(address, 3276.8f * trim / static_cast<f32>(1 << interval));
+         put.f32At(address + 4, 0.5f * i);
+         address += 8;
+      }
+   }
+}
+
+void tSimulatedXSeries::setCounterGate(u32 counter, u32 periodTicks, u32 highTicks)
+{
+   if (counter >= kSimulatedCounters)
+   {
+      return;
+   }
+   _update();
+
+   tCounterState& state = _counters[counter];
+   if (state.nextEdgeTick != kNever)
+   {
+      // Toggling, wait for the next rising edge
+      state.pendingPeriod = periodTicks;
+      state.pendingHigh = highTicks;
+      return;
+   }
+
+   // Held at one level, the new gate starts now
+   state.gatePeriod = periodTicks;
+   state.gateHigh = highTicks;
+   state.pendingPeriod = periodTicks;
+   state.pendingHigh = highTicks;
+   if (periodTicks == 0 || highTicks == 0 || highTicks >= periodTicks)
+   {
+      state.gateLevel = (periodTicks != 0 && highTicks != 0) ? kTrue : kFalse;
+      state.nextEdgeTick = kNever;
+   }
+   else
+   {
+      state.gateLevel = kTrue;
+      state.nextEdgeTick = ticks(_nowNs) + highTicks;
+   }
+}
+
+void tSimulatedXSeries::setAiSource(u32 numChannels, u64 scanPeriodNs, tSimulatedAiSource source,
+                                    void* context)
+{
+   _update();
+   if (_aiNextScanNs != kNever)
+   {
+      // The scans after the next one follow the new period
+      _aiStartNs = _aiNextScanNs - (u64)(scanPeriodNs * _aiPeriodScale + 0.5);
+      _aiScans = 0;
+   }
+   _aiChannels = numChannels;
+   _aiScanPeriodNs = scanPeriodNs;
+   _aiSource = source;
+   _aiContext = context;
+}
+
+void tSimulatedXSeries::setOscillatorPpm(f64 ppm)
+{
+   _update();
+   _oscillatorPpm = ppm;
+}
+
+void tSimulatedXSeries::setAoSink(u32 numChannels, u64 updatePeriodNs, tSimulatedAoSink sink,
+                                  void* context)
+{
+   _update();
+   _aoChannels = numChannels;
+   _aoUpdatePeriodNs = updatePeriodNs;
+   _aoSink = sink;
+   _aoContext = context;
+}
+
+void tSimulatedXSeries::setDiSource(u64 samplePeriodNs, tSimulatedDiSource source, void* context)
+{
+   _update();
+   _diSamplePeriodNs = samplePeriodNs;
+   _diSource = source;
+   _diContext = context;
+}
+
+void tSimulatedXSeries::setDoSink(u64 updatePeriodNs, tSimulatedDoSink sink, void* context)
+{
+   _update();
+   _doUpdatePeriodNs = updatePeriodNs;
+   _doSink = sink;
+   _doContext = context;
+}
+
+void tSimulatedXSeries::setPulseSink(tSimulatedPulseSink sink, void* context)
+{
+   _pulseSink = sink;
+   _pulseContext = context;
+}
+
+//
+// Time
+//
+
+u64 tSimulatedXSeries::_hostNs() const
+{
+   struct timespec now;
+   clock_gettime(CLOCK_MONOTONIC, &now);
+   return (u64)now.tv_sec * 1000000000ull + now.tv_nsec;
+}
+
+u64 tSimulatedXSeries::getTime()
+{
+   _update();
+   return _nowNs;
+}
+
+void tSimulatedXSeries::useManualClock(tBoolean manual)
+{
+   _update();
+   _manualClock = manual;
+   if (!manual)
+   {
+      // Carry on from the model time
+      _startNs = _hostNs() - _nowNs;
+   }
+}
+
+void tSimulatedXSeries::advance(u64 ns)
+{
+   if (_manualClock)
+   {
+      _runTo(_nowNs + ns);
+   }
+}
+
+void tSimulatedXSeries::advanceTo(u64 ns)
+{
+   if (_manualClock)
+   {
+      _runTo(ns);
+   }
+}
+
+void tSimulatedXSeries::_update()
+{
+   if (!_manualClock)
+   {
+      _runTo(_hostNs() - _startNs);
+   }
+}
+
+void tSimulatedXSeries::_runTo(u64 ns)
+{
+   if (ns <= _nowNs)
+   {
+      return;
+   }
+   u64 untilTick = ticks(ns);
+   for (u32 i=0; i<kSimulatedCounters; ++i)
+   {
+      _runCounter(i, untilTick);
+   }
+   _runAi(ns);
+   _runAo(ns);
+   _runDi(ns);
+   _runDo(ns);
+   if (_wdtDeadlineNs <= ns)
+   {
+      _expireWatchdog(_wdtDeadlineNs);
+   }
+   _nowNs = ns;
+   for (u32 i=0; i<kSimulatedStreams; ++i)
+   {
+      _pump(_streams[i]);
+   }
+}
+
+//
+// Counters
+//
+
+void tSimulatedXSeries::_runCounter(u32 index, u64 untilTick)
+{
+   tCounterState& state = _counters[index];
+   tStream& stream = _streams[kCounterStream + index];
+   tBoolean measuring = state.armed && (state.dmaConfig & nDMAConfig::nGi_DMA_Enable::kMask) &&
+      !(state.dmaConfig & (nDMAConfig::nGi_DMA_Write::kMask | nDMAConfig::nGi_WrFifoEnable::kMask));
+
+   // Semi-periods of the gate, edge to edge, the first one from the arm
+   while (state.nextEdgeTick <= untilTick)
+   {
+      u64 edge = state.nextEdgeTick;
+      tBoolean wasLevel = state.gateLevel;
+      state.gateLevel = state.gateLevel ? kFalse : kTrue;
+      if (state.gateLevel)
+      {
+         state.gatePeriod = state.pendingPeriod;
+         state.gateHigh = state.pendingHigh;
+      }
+      if (state.gatePeriod == 0 || state.gateHigh == 0 || state.gateHigh >= state.gatePeriod)
+      {
+         state.gateLevel = (state.gatePeriod != 0 && state.gateHigh != 0) ? kTrue : kFalse;
+         state.nextEdgeTick = kNever;
+      }
+      else
+      {
+         state.nextEdgeTick = edge + (state.gateLevel ? state.gateHigh :
+            state.gatePeriod - state.gateHigh);
+      }
+
+      // A gate held at the level it had makes no edge
+      if (measuring && state.gateLevel != wasLevel)
+      {
+         u32 sample = (u32)(edge - state.lastEdgeTick);
+         state.lastEdgeTick = edge;
+         if (stream.count + sizeof(sample) > stream.capacity)
+         {
+            _pump(stream);
+         }
+         if (!_push(stream, &sample, sizeof(sample)))
+         {
+            state.errors |= nStatus::nGi_DRQ_Error::kMask;
+            ++_overflows;
+         }
+      }
+   }
+
+   // Pulses from the write FIFO, a new pair on every update of the paired counter
+   tCounterState& clock = _counters[index ^ 1];
+   if (!state.armed || !(state.dmaConfig & nDMAConfig::nGi_WrFifoEnable::kMask) || !clock.armed)
+   {
+      return;
+   }
+   while (clock.nextUpdateTick <= untilTick)
+   {
+      u64 edge = clock.nextUpdateTick;
+      clock.nextUpdateTick += clock.updatePeriod ? clock.updatePeriod : 1;
+      if (_pulseSink != NULL)
+      {
+         _pulseSink(_pulseContext, index, state.nextHigh, state.nextLow, nanoseconds(edge));
+      }
+      _loadFromFifo(index);
+   }
+}
+
+void tSimulatedXSeries::_loadFromFifo(u32 index)
+{
+   tCounterState& state = _counters[index];
+   tStream& stream = _streams[kCounterStream + index];
+
+   if (stream.count < 2 * sizeof(u32))
+   {
+      _pump(stream);
+   }
+   if (stream.count < 2 * sizeof(u32))
+   {
+      // Nothing to switch to, the counter keeps its pulse
+      state.errors |= nStatus::nGi_GateSwitchError_St::kMask;
+      ++_underflows;
+      return;
+   }
+   _pop(stream, &state.nextHigh, sizeof(u32));
+   _pop(stream, &state.nextLow, sizeof(u32));
+}
+
+void tSimulatedXSeries::_resetCounter(u32 index)
+{
+   tCounterState& state = _counters[index];
+   state.dmaConfig = 0;
+   state.loadA = 0;
+   state.loadB = 0;
+   state.value = 0;
+   state.armed = kFalse;
+   state.armTick = 0;
+   state.errors = 0;
+   state.lastEdgeTick = 0;
+   state.updatePeriod = 0;
+   state.nextUpdateTick = kNever;
+   state.nextHigh = 0;
+   state.nextLow = 0;
+   tStream& stream = _streams[kCounterStream + index];
+   stream.head = 0;
+   stream.count = 0;
+}
+
+void tSimulatedXSeries::_armCounter(u32 index)
+{
+   tCounterState& state = _counters[index];
+   if (state.armed)
+   {
+      return;
+   }
+   u64 now = ticks(_nowNs);
+   state.armed = kTrue;
+   state.armTick = now;
+   state.lastEdgeTick = now;
+
+   // As the update clock of the paired counter: the loaded count, then every period
+   state.updatePeriod = state.loadA + state.loadB;
+   state.nextUpdateTick = now + (state.value ? state.value : state.updatePeriod);
+
+   // As a pulse generator: the pulse in the load registers until the first update
+   if ((state.dmaConfig & nDMAConfig::nGi_WrFifoEnable::kMask) && _pulseSink != NULL)
+   {
+      _pulseSink(_pulseContext, index, state.loadA, state.loadB, _nowNs);
+   }
+}
+
+u32 tSimulatedXSeries::_counterStatus(u32 index)
+{
+   tCounterState& state = _counters[index];
+   u32 data = state.errors;
+   if (state.armed)
+   {
+      data |= nStatus::nGi_Armed_St::kMask | nStatus::nGi_Counting_St::kMask;
+   }
+   if (state.gateLevel)
+   {
+      data |= nStatus::nGi_Gate_St::kMask;
+   }
+   return data;
+}
+
+u32 tSimulatedXSeries::_readCounter(u32 index, u32 reg, u32 size)
+{
+   tCounterState& state = _counters[index];
+   tStream& stream = _streams[kCounterStream + index];
+   switch (reg)
+   {
+      case tCounter::tGi_HW_Save_Register::kOffset:
+      case tCounter::tGi_Save_Register::kOffset:
+         // Counting the timebase up from the load value while armed
+         return state.armed ? (u32)(state.value + ticks(_nowNs) - state.armTick) : state.value;
+      case tCounter::tGi_Status_Register::kOffset:
+         return _counterStatus(index);
+      case tCounter::tGi_FifoStatusRegister::kOffset:
+         return stream.count / sizeof(u32);
+      case tCounter::tGi_RdFifoRegister::kOffset:
+      {
+         u32 data = 0;
+         _pop(stream, &data, size);
+         return data;
+      }
+      default:
+         return 0;
+   }
+}
+
+void tSimulatedXSeries::_writeCounter(u32 index, u32 reg, u32 data)
+{
+   tCounterState& state = _counters[index];
+   switch (reg)
+   {
+      case tCounter::tGi_Command_Register::kOffset:
+         if (data & nCommand::nGi_Reset::kMask)
+         {
+            _resetCounter(index);
+         }
+         if (data & nCommand::nGi_Load::kMask)
+         {
+            state.value = state.loadA;
+         }
+         if (data & nCommand::nGi_WrLoadRegsFromFifo::kMask)
+         {
+            _loadFromFifo(index);
+         }
+         if ((data & nCommand::nGi_Disarm::kMask) && state.armed)
+         {
+            state.armed = kFalse;
+            state.value = (u32)(state.value + ticks(_nowNs) - state.armTick);
+         }
+         if (data & nCommand::nGi_Disarm_Paired_Counter::kMask)
+         {
+            _counters[index ^ 1].armed = kFalse;
+         }
+         if (data & nCommand::nGi_Arm::kMask)
+         {
+            _armCounter(index);
+         }
+         if (data & nCommand::nGi_Arm_Paired_Counter::kMask)
+         {
+            _armCounter(index ^ 1);
+         }
+         break;
+      case tCounter::tGi_Load_A_Register::kOffset:
+         state.loadA = data;
+         break;
+      case tCounter::tGi_Load_B_Register::kOffset:
+         state.loadB = data;
+         break;
+      case tCounter::tGi_DMA_Config_Register::kOffset:
+         state.dmaConfig = (u16)(data & ~nDMAConfig::nGi_DMA_Reset::kMask);
+         if (data & nDMAConfig::nGi_DMA_Reset::kMask)
+         {
+            tStream& stream = _streams[kCounterStream + index];
+            stream.head = 0;
+            stream.count = 0;
+            state.errors &= ~nStatus::nGi_DRQ_Error::kMask;
+         }
+         break;
+      case tCounter::tGi_WrFifoRegister::kOffset:
+         if (!_push(_streams[kCounterStream + index], &data, sizeof(data)))
+         {
+            state.errors |= nStatus::nGi_WritesTooFastErrorSt::kMask;
+         }
+         break;
+      case tCounter::tGi_Interrupt1_Register::kOffset:
+      case tCounter::tGi_Interrupt2_Register::kOffset:
+         if (data & nInterrupt::nGi_GateSwitchError_Ack::kMask)
+         {
+            state.errors &= ~nStatus::nGi_GateSwitchError_St::kMask;
+         }
+         if (data & nInterrupt::nGi_WritesTooFastErrorAck::kMask)
+         {
+            state.errors &= ~nStatus::nGi_WritesTooFastErrorSt::kMask;
+         }
+         if (data & nInterrupt::nGi_SampleClockOverrunErrorAck::kMask)
+         {
+            state.errors &= ~nStatus::nGi_SampleClockOverrun_St::kMask;
+         }
+         if (data & nInterrupt::nGi_DMA_Error_Ack::kMask)
+         {
+            state.errors &= ~nStatus::nGi_DRQ_Error::kMask;
+         }
+         break;
+      default:
+         break;
+   }
+}
+
+//
+// AI, AO, DI and DO
+//
+
+void tSimulatedXSeries::_startAi(u64 ns)
+{
+   _aiTriggerLine = kNoTrigger;
+   _aiStartNs = ns;
+   _aiScans = 0;
+   u32 clock = readU32(_memory + kTriggersBase + tTriggers::tClock_And_Fout2_Register::kOffset);
+   tBoolean fromPll = (clock & nTriggers::nClock_And_Fout2_Register::nTB3_Select::kMask) ?
+      kTrue : kFalse;
+   _aiPeriodScale = fromPll ? 1. : 1. / (1. + _oscillatorPpm * 1e-6);
+   _aiNextScanNs = _aiScanPeriodNs ? ns + (u64)(_aiScanPeriodNs * _aiPeriodScale + 0.5) : kNever;
+
+   // Out on every RTSI line that drives the AI start trigger
+   u32 directions = readU32(_memory + kTriggersBase +
+      tTriggers::tRTSI_Trig_Direction_Register::kOffset);
+   for (u32 line=0; line<kRtsiLines; ++line)
+   {
+      u32 select = _memory[kRtsiOutputSelect + line] & nRtsiSelect::nRTSI_i_Output_Select::kMask;
+      if ((directions & (nRtsiDirection::nRTSI0_Pin_Dir::kMask << line)) &&
+         select == nTriggers::kRTSI_AI_START1)
+      {
+         backplane.pulseNs[line] = ns;
+         ++backplane.pulses[line];
+      }
+   }
+}
+
+void tSimulatedXSeries::_runAi(u64 untilNs)
+{
+   tStream& stream = _streams[kAIStream];
+   if (_aiArmed && _aiTriggerLine < kRtsiLines &&
+      backplane.pulses[_aiTriggerLine] != _aiTriggerPulses)
+   {
+      _startAi(backplane.pulseNs[_aiTriggerLine]);
+   }
+   while (_aiArmed && _aiNextScanNs <= untilNs)
+   {
+      u64 scanNs = _aiNextScanNs;
+      ++_aiScans;
+      _aiNextScanNs = _aiStartNs + (u64)((_aiScans + 1) * _aiScanPeriodNs * _aiPeriodScale + 0.5);
+      if (stream.count + _aiChannels * sizeof(i16) > stream.capacity)
+      {
+         _pump(stream);
+      }
+      if (stream.count + _aiChannels * sizeof(i16) > stream.capacity)
+      {
+         _aiOverflow = kTrue;
+         ++_overflows;
+         continue;
+      }
+      for (u32 channel=0; channel<_aiChannels; ++channel)
+      {
+         i16 sample = _aiSource != NULL ? _aiSource(_aiContext, channel, scanNs) : 0;
+         _push(stream, &sample, sizeof(sample));
+      }
+   }
+}
+
+void tSimulatedXSeries::_runAo(u64 untilNs)
+{
+   tStream& stream = _streams[kAOStream];
+   while (_aoArmed && _aoNextUpdateNs <= untilNs)
+   {
+      u64 updateNs = _aoNextUpdateNs;
+      _aoNextUpdateNs += _aoUpdatePeriodNs;
+      if (stream.count < _aoChannels * sizeof(i16))
+      {
+         _pump(stream);
+      }
+      if (stream.count < _aoChannels * sizeof(i16))
+      {
+         _aoUnderflow = kTrue;
+         ++_underflows;
+         continue;
+      }
+      for (u32 channel=0; channel<_aoChannels; ++channel)
+      {
+         i16 code;
+         _pop(stream, &code, sizeof(code));
+         if (_aoSink != NULL)
+         {
+            _aoSink(_aoContext, channel, code, updateNs);
+         }
+      }
+   }
+}
+
+void tSimulatedXSeries::_runDi(u64 untilNs)
+{
+   tStream& stream = _streams[kDIStream];
+   while (_diArmed && _diNextSampleNs <= untilNs)
+   {
+      u64 sampleNs = _diNextSampleNs;
+      _diNextSampleNs += _diSamplePeriodNs;
+      if (stream.count + kDigitalSampleSize > stream.capacity)
+      {
+         _pump(stream);
+      }
+      if (stream.count + kDigitalSampleSize > stream.capacity)
+      {
+         _diOverflow = kTrue;
+         ++_overflows;
+         continue;
+      }
+      u32 sample = _diSource != NULL ? _diSource(_diContext, sampleNs) : 0;
+      _push(stream, &sample, kDigitalSampleSize);
+   }
+}
+
+void tSimulatedXSeries::_runDo(u64 untilNs)
+{
+   tStream& stream = _streams[kDOStream];
+   while (_doArmed && _doNextUpdateNs <= untilNs)
+   {
+      u64 updateNs = _doNextUpdateNs;
+      _doNextUpdateNs += _doUpdatePeriodNs;
+      if (_wdtDeadlineNs <= updateNs)
+      {
+         _expireWatchdog(_wdtDeadlineNs);
+      }
+      if (stream.count < kDigitalSampleSize)
+      {
+         _pump(stream);
+      }
+      if (stream.count < kDigitalSampleSize)
+      {
+         _doUnderflow = kTrue;
+         ++_underflows;
+         continue;
+      }
+      u32 value;
+      _pop(stream, &value, kDigitalSampleSize);
+      _doLastValue = value;
+      _doPortValue = _doPort(value);
+      if (_doSink != NULL)
+      {
+         _doSink(_doContext, _doPortValue, updateNs);
+      }
+   }
+}
+
+//
+// DO watchdog timer
+//
+
+void tSimulatedXSeries::_commandWatchdog(u16 command)
+{
+   u64 timeoutNs = nanoseconds(readU32(_memory + kBrdServicesBase +
+      tBrdServices::tWatchdogTimeoutRegister::kOffset));
+   switch (command)
+   {
+      case kWdtReset:
+         // The lines go back to the DO subsystem
+         _wdtState = nBrdServices::kWdtSt_SynchReset;
+         _wdtDeadlineNs = kNever;
+         _emitDoPort(_nowNs);
+         break;
+      case kWdtStart:
+         if (_wdtState == nBrdServices::kWdtSt_SynchReset ||
+            _wdtState == nBrdServices::kWdtSt_Sleeping)
+         {
+            _wdtState = nBrdServices::kWdtSt_CountDownFeed;
+            _wdtDeadlineNs = _nowNs + timeoutNs;
+         }
+         break;
+      case kWdtPause:
+         if (_wdtState == nBrdServices::kWdtSt_CountDownFeed ||
+            _wdtState == nBrdServices::kWdtSt_CountDownFood)
+         {
+            _wdtState = nBrdServices::kWdtSt_Sleeping;
+            _wdtDeadlineNs = kNever;
+         }
+         break;
+      case kWdtFeed:
+         if (_wdtState == nBrdServices::kWdtSt_CountDownFeed)
+         {
+            _wdtState = nBrdServices::kWdtSt_CountDownFood;
+            _wdtDeadlineNs = _nowNs + timeoutNs;
+         }
+         break;
+      case kWdtFood:
+         if (_wdtState == nBrdServices::kWdtSt_CountDownFood)
+         {
+            _wdtState = nBrdServices::kWdtSt_CountDownFeed;
+            _wdtDeadlineNs = _nowNs + timeoutNs;
+         }
+         break;
+      case kWdtKill:
+         if (_wdtState != nBrdServices::kWdtSt_Expired)
+         {
+            _expireWatchdog(_nowNs);
+         }
+         break;
+      default:
+         break;
+   }
+}
+
+void tSimulatedXSeries::_expireWatchdog(u64 ns)
+{
+   _wdtState = nBrdServices::kWdtSt_Expired;
+   _wdtDeadlineNs = kNever;
+   _wdtFrozenValue = _doLastValue;
+   ++_wdtExpirations;
+   _emitDoPort(ns);
+}
+
+void tSimulatedXSeries::_emitDoPort(u64 ns)
+{
+   u32 value = _doPort(_doLastValue);
+   if (value == _doPortValue)
+   {
+      return;
+   }
+   _doPortValue = value;
+   if (_doSink != NULL)
+   {
+      _doSink(_doContext, value, ns);
+   }
+}
+
+u32 tSimulatedXSeries::_doPort(u32 value)
+{
+   u32 configuration = _memory[kBrdServicesBase + tBrdServices::tWatchdogConfiguration::kOffset] |
+      ((u32)_memory[kBrdServicesBase + tBrdServices::tWatchdogConfiguration::kOffset + 1] << 8);
+   if (_wdtState != nBrdServices::kWdtSt_Expired ||
+      !(configuration & nWdtConfig::nWatchdogIntTrigEn::kMask))
+   {
+      return value;
+   }
+   u32 safeState = readU32(_memory + kDOBase + tDO::tDO_WDT_SafeStateRegister::kOffset);
+   u32 modes[2] =
+   {
+      readU32(_memory + kDOBase + tDO::tDO_WDT_ModeSelect1_Register::kOffset),
+      readU32(_memory + kDOBase + tDO::tDO_WDT_ModeSelect2_Register::kOffset)
+   };
+   u32 linesPerRegister = kDigitalLines / 2;
+   for (u32 line=0; line<kDigitalLines; ++line)
+   {
+      u32 bit = 1u << line;
+      u32 mode = (modes[line / linesPerRegister] >> (kWdtModeBits * (line % linesPerRegister))) &
+         ((1u << kWdtModeBits) - 1);
+      switch (mode)
+      {
+         case nDO::kWDT_SafeValue:
+            value = (value & ~bit) | (safeState & bit);
+            break;
+         case nDO::kWDT_Freeze:
+            value = (value & ~bit) | (_wdtFrozenValue & bit);
+            break;
+         case nDO::kWDT_Tristate:
+            value &= ~bit;
+            break;
+         default:
+            break;
+      }
+   }
+   return value;
+}
+
+//
+// Stream circuits and their FIFOs
+//
+
+tBoolean tSimulatedXSeries::_push(tStream& stream, const void* data, u32 bytes)
+{
+   if (stream.count + bytes > stream.capacity)
+   {
+      return kFalse;
+   }
+   // At most two pieces, up to the end of the ring and from its start
+   u32 tail = (stream.head + stream.count) % stream.capacity;
+   u32 first = (bytes < stream.capacity - tail) ? bytes : stream.capacity - tail;
+   memcpy(stream.fifo + tail, data, first);
+   memcpy(stream.fifo, (const u8*)data + first, bytes - first);
+   stream.count += bytes;
+   return kTrue;
+}
+
+tBoolean tSimulatedXSeries::_pop(tStream& stream, void* data, u32 bytes)
+{
+   if (stream.count < bytes)
+   {
+      return kFalse;
+   }
+   u32 first = (bytes < stream.capacity - stream.head) ? bytes : stream.capacity - stream.head;
+   memcpy(data, stream.fifo + stream.head, first);
+   memcpy((u8*)data + first, stream.fifo, bytes - first);
+   stream.head = (stream.head + bytes) % stream.capacity;
+   stream.count -= bytes;
+   return kTrue;
+}
+
+void tSimulatedXSeries::_resetStream(tStream& stream, tBoolean isInput, u32 capacity)
+{
+   stream.capacity = capacity;
+   stream.isInput = isInput;
+   stream.head = 0;
+   stream.count = 0;
+   stream.enabled = kFalse;
+   stream.useCredit = kFalse;
+   stream.credit = 0;
+}
+
+u32 tSimulatedXSeries::_readStream(u32 index, u32 reg)
+{
+   tStream& stream = _streams[index];
+   switch (reg)
+   {
+      case tStreamCircuitRegMap::tStreamControlStatusReg::kOffset:
+      {
+         u32 data = nStreamCtrl::nStreamCircuitResetComplete::kMask;
+         if (stream.enabled)
+         {
+            data |= nStreamCtrl::nDataTransferEnable::kMask;
+         }
+         if (stream.count == 0)
+         {
+            data |= nStreamCtrl::nFifoEmpty::kMask;
+         }
+         return data;
+      }
+      case tStreamCircuitRegMap::tStreamTransferCountReg::kOffset:
+         return stream.credit > 0 ? (u32)stream.credit : 0;
+      case tStreamCircuitRegMap::tStreamFifoSizeReg::kOffset:
+         return stream.capacity;
+      case tStreamCircuitRegMap::tStreamTransactionLimitReg::kOffset:
+      {
+         u32 offset = kStreamBase + index * kStreamStride + reg;
+         u32 limit = readU32(_memory + offset) &
+            nStreamCircuitRegMap::nStreamTransactionLimitReg::nTransactionLimit::kMask;
+         return limit | (kMaxTransactionLimit <<
+            nStreamCircuitRegMap::nStreamTransactionLimitReg::nMaxTransactionLimit::kOffset);
+      }
+      default:
+         return 0;
+   }
+}
+
+void tSimulatedXSeries::_writeStream(u32 index, u32 reg, u32 data)
+{
+   tStream& stream = _streams[index];
+   switch (reg)
+   {
+      case tStreamCircuitRegMap::tStreamControlStatusReg::kOffset:
+         if (data & nStreamCtrl::nStreamCircuitReset::kMask)
+         {
+            _resetStream(stream, stream.isInput, stream.capacity);
+         }
+         if (data & nStreamCtrl::nCISTCR_Clear::kMask)
+         {
+            stream.credit = 0;
+         }
+         if (data & nStreamCtrl::nCISTCR_Enable::kMask)
+         {
+            stream.useCredit = kTrue;
+         }
+         if (data & nStreamCtrl::nCISTCR_Disable::kMask)
+         {
+            stream.useCredit = kFalse;
+         }
+         if (data & nStreamCtrl::nDataTransferEnable::kMask)
+         {
+            stream.enabled = kTrue;
+         }
+         _pump(stream);
+         break;
+      case tStreamCircuitRegMap::tStreamAdditiveTransferCountReg::kOffset:
+         stream.credit += (i32)data;
+         _pump(stream);
+         break;
+      default:
+         break;
+   }
+}
+
+//
+// CHInCh DMA channels
+//
+
+u32 tSimulatedXSeries::_readDMA(u32 index, u32 reg)
+{
+   tStream& stream = _streams[index];
+   switch (reg)
+   {
+      case tDMAController::tChannel_Status_Register::kOffset:
+      {
+         u32 data = 0;
+         if (stream.running && (stream.control & nControl::nMODE::kMask) ==
+            nDMAController::kLinkChainDmaMode)
+         {
+            data |= nChStatus::nLink_Ready::kMask;
+         }
+         if (stream.done)
+         {
+            data |= nChStatus::nDone::kMask;
+         }
+         if (stream.lastLink)
+         {
+            data |= nChStatus::nLast_Link::kMask;
+         }
+         if (stream.error)
+         {
+            data |= nChStatus::nError::kMask;
+         }
+         return data;
+      }
+      case tDMAController::tChannel_Total_Transfer_Count_Status_Register_LSW::kOffset:
+         return (u32)stream.transferCount;
+      case tDMAController::tChannel_Total_Transfer_Count_Status_Register_MSW::kOffset:
+         return (u32)(stream.transferCount >> 32);
+      default:
+         return 0;
+   }
+}
+
+void tSimulatedXSeries::_writeDMA(u32 index, u32 reg, u32 data)
+{
+   tStream& stream = _streams[index];
+   switch (reg)
+   {
+      case tDMAController::tChannel_Memory_Address_Register_LSW::kOffset:
+         stream.memoryAddress[0] = data;
+         break;
+      case tDMAController::tChannel_Memory_Address_Register_MSW::kOffset:
+         stream.memoryAddress[1] = data;
+         break;
+      case tDMAController::tChannel_Link_Address_Register_LSW::kOffset:
+         stream.linkAddress[0] = data;
+         break;
+      case tDMAController::tChannel_Link_Address_Register_MSW::kOffset:
+         stream.linkAddress[1] = data;
+         break;
+      case tDMAController::tChannel_Link_Size_Register::kOffset:
+         stream.linkSize = data;
+         break;
+      case tDMAController::tChannel_Control_Register::kOffset:
+         stream.control = data;
+         break;
+      case tDMAController::tChannel_Operation_Register::kOffset:
+         // The chip objects write their soft copy, several commands at once
+         if (data & nOperation::nCLR_TTC::kMask)
+         {
+            stream.transferCount = 0;
+         }
+         if (data & nOperation::nSTOP::kMask)
+         {
+            stream.running = kFalse;
+            stream.done = kTrue;
+         }
+         else if (data & nOperation::nSTART::kMask)
+         {
+            _startDMA(stream);
+         }
+         break;
+      default:
+         break;
+   }
+}
+
+void tSimulatedXSeries::_startDMA(tStream& stream)
+{
+   stream.running = kTrue;
+   stream.done = kFalse;
+   stream.lastLink = kFalse;
+   stream.error = kFalse;
+   stream.link = ((u64)stream.linkAddress[1] << 32) | stream.linkAddress[0];
+   stream.currentLinkSize = stream.linkSize;
+   stream.transferLink = kChunkyLinkHeader;
+   stream.transferOffset = 0;
+   _pump(stream);
+}
+
+u8* tSimulatedXSeries::_host(u64 physical, u32 bytes)
+{
+   if (physical < _hostPhysical || physical - _hostPhysical + bytes > _hostSize)
+   {
+      return NULL;
+   }
+   return _hostMemory + (physical - _hostPhysical);
+}
+
+u8* tSimulatedXSeries::_segment(tStream& stream, u32& bytes)
+{
+   if ((stream.control & nControl::nMODE::kMask) != nDMAController::kLinkChainDmaMode)
+   {
+      // Normal mode, one block from the memory address on
+      u64 address = ((u64)stream.memoryAddress[1] << 32) | stream.memoryAddress[0];
+      return _host(address + stream.transferCount, bytes);
+   }
+
+   for (u32 step=0; step<kMaxLinkSteps; ++step)
+   {
+      if (stream.transferLink + kChunkyLinkHeader > stream.currentLinkSize)
+      {
+         // End of the chunky link, the header says where to go
+         u8* header = _host(stream.link, kChunkyLinkHeader);
+         if (header == NULL)
+         {
+            return NULL;
+         }
+         // A reuse link only spares the hardware the fetch, the next link of
+         // the tail of a ring is its head either way
+         u32 flags = readU32(header + 4);
+         if (flags & kIsLastLink)
+         {
+            stream.running = kFalse;
+            stream.done = kTrue;
+            stream.lastLink = kTrue;
+            return NULL;
+         }
+         else
+         {
+            stream.currentLinkSize = readU32(header);
+            stream.link = readU64(header + 8);
+            stream.transferLink = kChunkyLinkHeader;
+         }
+         stream.transferOffset = 0;
+         continue;
+      }
+
+      u8* transfer = _host(stream.link + stream.transferLink, kChunkyLinkHeader);
+      if (transfer == NULL)
+      {
+         return NULL;
+      }
+      u32 transferSize = readU32(transfer);
+      if (stream.transferOffset >= transferSize)
+      {
+         stream.transferLink += kChunkyLinkHeader;
+         stream.transferOffset = 0;
+         continue;
+      }
+      if (bytes > transferSize - stream.transferOffset)
+      {
+         bytes = transferSize - stream.transferOffset;
+      }
+      return _host(readU64(transfer + 8) + stream.transferOffset, bytes);
+   }
+   return NULL;
+}
+
+void tSimulatedXSeries::_pump(tStream& stream)
+{
+   while (stream.running && stream.enabled)
+   {
+      u32 bytes = stream.isInput ? stream.count : stream.capacity - stream.count;
+      if (stream.useCredit && (i64)bytes > stream.credit)
+      {
+         bytes = stream.credit > 0 ? (u32)stream.credit : 0;
+      }
+      if (bytes == 0)
+      {
+         return;
+      }
+
+      u8* host = _segment(stream, bytes);
+      if (host == NULL)
+      {
+         if (stream.running)
+         {
+            // A link or buffer outside host DMA memory
+            stream.running = kFalse;
+            stream.error = kTrue;
+         }
+         return;
+      }
+      if (stream.isInput)
+      {
+         _pop(stream, host, bytes);
+      }
+      else
+      {
+         _push(stream, host, bytes);
+      }
+      stream.transferOffset += bytes;
+      stream.transferCount += bytes;
+      if (stream.useCredit)
+      {
+         stream.credit -= bytes;
+      }
+   }
+}
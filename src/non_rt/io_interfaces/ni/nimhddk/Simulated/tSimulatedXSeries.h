@@ -0,0 +1,348 @@
+/*
+ * tSimulatedXSeries.h
+ *
+ * tSimulatedXSeries -- An X Series BAR0 register file in memory, with a
+ *    behavior model of the parts our tools drive. Built with kSimulatedBus,
+ *    acquireBoard() returns an iBus over one of these (Simulated/osiUserCode.cpp)
+ *    and every tAddressSpace access lands in read() or write(), so the chip
+ *    objects, the CHInCh DMA classes and the Examples helpers run unmodified
+ *    without a board.
+ *
+ * Registers without a model keep what was last written to them. The model
+ * covers:
+ *    - identification: CHInCh and STC3 signatures, the product ID (a PXIe-6363
+ *      unless setProductId() says otherwise), payload and FIFO sizes
+ *    - counters 0..3: arm, disarm, reset and load commands, the save and status
+ *      registers, semi-period measurement of a scripted gate into the counter
+ *      FIFO or its DMA stream, and pulse generation from the write FIFO on every
+ *      update edge of the paired counter (0 with 1, 2 with 3)
+ *    - AI, AO, DI and DO: arm and disarm of the timing engines, the data FIFOs
+ *      and their status, at the scan, sample and update rates the script sets;
+ *      the timing registers themselves are not decoded, and DI and DO move
+ *      4 byte samples of port 0 (the 32 line port of a PXIe-6363)
+ *    - stream circuits: reset, enable and the transfer count (CISTCR) credit
+ *    - CHInCh DMA channels: start, stop, status and total transfer count, with
+ *      the data moved through the chunky link lists in host DMA memory
+ *    - the EEPROM: a capabilities list with the serial number and an external
+ *      and a self calibration area as eepromHelper reads them, for the ADCs and
+ *      DACs setEeprom() says (one and four, as on a PXIe-6363, by default);
+ *      reads through it are counted. The window of simultaneous devices is not
+ *      modeled.
+ *    - the PLL always reads locked. AI scans run on the model time while
+ *      timebase 3 comes from the PLL, and off by setOscillatorPpm() while it
+ *      comes from the on-board oscillator
+ *    - the AI start trigger: the software pulse, or a pulse on an RTSI (PXI
+ *      trigger) line that another board drives with its own AI start trigger;
+ *      sources without a model fire at the arm. The RTSI lines of all boards
+ *      are one backplane on model time, so boards that trigger each other
+ *      have to run on the same clock, in lockstep when it is manual.
+ *    - the DO watchdog timer: RESET, START, PAUSE, KILL and FEED and FOOD in
+ *      turn through its control register (a feed out of turn does not
+ *      reload), the timeout in 100 MHz bus clock periods, and the state and
+ *      expiration count in its status register. While it is expired with the
+ *      internal trigger enabled, port 0 lines in safe value mode go out as the
+ *      safe state, frozen lines hold and tri-stated lines read low, at the
+ *      expiration and on every DO update, until a reset or clearing the
+ *      internal trigger gives them back. That an expiration blocks
+ *      programming the board is not modeled.
+ *
+ * Subsystem n streams through stream circuit n and DMA channel n, in the
+ * order of nNISTC3::tDMAChannelNumber (AI, counters 0..3, DI, AO, DO).
+ *
+ * Time runs on the host clock from acquireBoard() on, or only through
+ * advance() once useManualClock() is set, which makes a run repeatable. The
+ * model catches up on elapsed time before every access. It is not thread
+ * safe; drive a simulated board from one thread.
+ *
+ */
+
+#ifndef  ___tSimulatedXSeries_h___
+#define  ___tSimulatedXSeries_h___
+
+#ifndef ___osiTypes_h___
+ #include "osiTypes.h"
+#endif
+
+class iBus;
+
+static const u32 kSimulatedBar0Size       = 0x40000;
+static const u32 kSimulatedTimebaseHz     = 100000000;   // Counter timebase 3
+static const u32 kSimulatedCounters       = 4;
+static const u32 kSimulatedStreams        = 8;           // AI, counters 0..3, DI, AO, DO
+static const u32 kSimulatedCounterFifo    = 127 * 4;     // Bytes, 127 tick counts
+static const u32 kSimulatedDataFifo       = 4096;        // Bytes, AI, AO, DI and DO FIFOs
+static const u32 kSimulatedProductId      = 0x7434;      // PXIe-6363
+static const u32 kSimulatedEepromSize     = 0x1000;      // Bytes behind the EEPROM window
+static const u32 kSimulatedSerialNumber   = 0x01A2B3C4;
+static const u32 kSimulatedCalTime        = 0xDB000000;  // Seconds since 1904, as stored
+static const u32 kSimulatedStc3Revision   = 2;           // B, as the signature reads; A has no PLL
+
+// AI samples: the raw ADC code of channel at time ns
+typedef i16  (*tSimulatedAiSource)   (void* context, u32 channel, u64 ns);
+// AO updates: the code of channel that went out at time ns
+typedef void (*tSimulatedAoSink)     (void* context, u32 channel, i16 code, u64 ns);
+// DI samples: port 0 at time ns
+typedef u32  (*tSimulatedDiSource)   (void* context, u64 ns);
+// DO updates: port 0 as it went out at time ns
+typedef void (*tSimulatedDoSink)     (void* context, u32 value, u64 ns);
+// Counter output: the pulse counter started at time ns, high ticks first
+typedef void (*tSimulatedPulseSink)  (void* context, u32 counter, u32 highTicks, u32 lowTicks,
+                                      u64 ns);
+
+class tSimulatedXSeries
+{
+   public:
+
+      // host:         host DMA memory the chunky links and buffers live in
+      // hostPhysical: bus address of host[0] as the DMA channels see it
+      // hostSize:     bytes of host DMA memory
+      tSimulatedXSeries (u8* host, u64 hostPhysical, u32 hostSize);
+      ~tSimulatedXSeries ();
+
+      // The register file, what tAddressSpace accesses go to
+      u32  read  (u32 offset, u32 size);
+      void write (u32 offset, u32 data, u32 size);
+
+      u8* getBar0 ()
+      {
+         return _memory;
+      }
+
+      //
+      // Script
+      //
+
+      void setProductId (u32 productId);
+
+      // EEPROM contents of a board calibrated at calTime (seconds since 1904);
+      // the coefficients follow from serialNumber and calTime, so a new
+      // calibration also reads back different values
+      void setEeprom (u32 serialNumber, u32 calTime, u32 numberOfADCs, u32 numberOfDACs);
+
+      // Gate of a counter: a pwm of periodTicks with highTicks high, starting
+      // high. A change takes effect at the next rising edge, like a pwm
+      // reload; a highTicks of 0 or periodTicks holds the line low or high.
+      void setCounterGate (u32 counter, u32 periodTicks, u32 highTicks);
+
+      // AI scans of numChannels samples every scanPeriodNs while the AI
+      // timing engine is armed
+      void setAiSource (u32 numChannels, u64 scanPeriodNs, tSimulatedAiSource source,
+                        void* context);
+
+      // AO updates of numChannels samples every updatePeriodNs while the AO
+      // timing engine is armed
+      void setAoSink (u32 numChannels, u64 updatePeriodNs, tSimulatedAoSink sink, void* context);
+
+      // DI samples of port 0 every samplePeriodNs while the DI timing engine
+      // is armed
+      void setDiSource (u64 samplePeriodNs, tSimulatedDiSource source, void* context);
+
+      // DO updates of port 0 every updatePeriodNs while the DO timing engine
+      // is armed
+      void setDoSink (u64 updatePeriodNs, tSimulatedDoSink sink, void* context);
+
+      void setPulseSink (tSimulatedPulseSink sink, void* context);
+
+      // Error of the on-board oscillator in parts per million, positive for
+      // a fast one
+      void setOscillatorPpm (f64 ppm);
+
+      // Time in ns since the board was acquired
+      u64 getTime ();
+
+      // Stop following the host clock, time then moves only with advance()
+      void useManualClock (tBoolean manual);
+
+      // Run the model ns further, manual clock only
+      void advance (u64 ns);
+
+      // Run the model up to time ns, manual clock only; boards acquired one after
+      // the other meet on one time with it
+      void advanceTo (u64 ns);
+
+      // Counter, AI and DI overflows and AO and DO underflows so far
+      u64 getOverflows () const
+      {
+         return _overflows;
+      }
+
+      u64 getUnderflows () const
+      {
+         return _underflows;
+      }
+
+      // Reads through the EEPROM window so far
+      u64 getEepromReads () const
+      {
+         return _eepromReads;
+      }
+
+   private:
+
+      // A subsystem FIFO and the stream circuit and DMA channel behind it
+      struct tStream
+      {
+         // FIFO, a byte ring
+         u8       fifo[kSimulatedDataFifo];
+         u32      capacity;
+         u32      head;
+         u32      count;
+         tBoolean isInput;
+
+         // Stream circuit
+         tBoolean enabled;
+         tBoolean useCredit;          // CISTCR
+         i64      credit;
+
+         // DMA channel
+         u32      control;
+         u32      memoryAddress[2];
+         u32      linkAddress[2];
+         u32      linkSize;
+         tBoolean running;
+         tBoolean done;
+         tBoolean lastLink;
+         tBoolean error;
+         u64      transferCount;
+         u64      link;               // Current chunky link
+         u32      currentLinkSize;
+         u32      transferLink;       // Offset of the current transfer link
+         u32      transferOffset;     // Bytes done of the current transfer link
+      };
+
+      struct tCounterState
+      {
+         u16      dmaConfig;
+         u32      loadA;
+         u32      loadB;
+         u32      value;
+         tBoolean armed;
+         u64      armTick;
+         u32      errors;             // Gi_Status_Register error bits
+
+         // Gate
+         u32      gatePeriod;
+         u32      gateHigh;
+         u32      pendingPeriod;
+         u32      pendingHigh;
+         tBoolean gateLevel;
+         u64      nextEdgeTick;
+         u64      lastEdgeTick;
+
+         // Update clock for the paired counter, and the pulse loaded next
+         u32      updatePeriod;
+         u64      nextUpdateTick;
+         u32      nextHigh;
+         u32      nextLow;
+      };
+
+      // Elapsed time
+      void _update ();
+      void _runTo (u64 ns);
+      void _runCounter (u32 index, u64 untilTick);
+      void _runAi (u64 untilNs);
+      void _startAi (u64 ns);
+      void _runAo (u64 untilNs);
+      void _runDi (u64 untilNs);
+      void _runDo (u64 untilNs);
+      void _commandWatchdog (u16 command);
+      void _expireWatchdog (u64 ns);
+      u32  _doPort (u32 value);
+      void _emitDoPort (u64 ns);
+      u64  _hostNs () const;
+
+      // Registers with a model
+      tBoolean _readModel  (u32 offset, u32 size, u32& data);
+      tBoolean _writeModel (u32 offset, u32 data);
+      u32  _readCounter  (u32 index, u32 reg, u32 size);
+      void _writeCounter (u32 index, u32 reg, u32 data);
+      u32  _readDMA  (u32 index, u32 reg);
+      void _writeDMA (u32 index, u32 reg, u32 data);
+      u32  _readStream  (u32 index, u32 reg);
+      void _writeStream (u32 index, u32 reg, u32 data);
+
+      // Counter behavior
+      void _resetCounter (u32 index);
+      void _armCounter (u32 index);
+      void _loadFromFifo (u32 index);
+      u32  _counterStatus (u32 index);
+
+      // FIFOs
+      tBoolean _push (tStream& stream, const void* data, u32 bytes);
+      tBoolean _pop  (tStream& stream, void* data, u32 bytes);
+      void     _resetStream (tStream& stream, tBoolean isInput, u32 capacity);
+
+      // DMA through the chunky links
+      void     _startDMA (tStream& stream);
+      void     _pump (tStream& stream);
+      u8*      _segment (tStream& stream, u32& bytes);
+      u8*      _host (u64 physical, u32 bytes);
+
+      u8*  _memory;
+      u8*  _hostMemory;
+      u64  _hostPhysical;
+      u32  _hostSize;
+      u32  _productId;
+
+      tStream       _streams[kSimulatedStreams];
+      tCounterState _counters[kSimulatedCounters];
+
+      tBoolean _aiArmed;
+      u32      _aiChannels;
+      u64      _aiScanPeriodNs;
+      u64      _aiNextScanNs;
+      u64      _aiStartNs;          // Of the start trigger, scan k follows at (k+1) periods
+      u64      _aiScans;
+      f64      _aiPeriodScale;      // Of the timebase the scans started on
+      u32      _aiTriggerLine;      // RTSI line the armed AI waits on, 8 for the pulse
+      u64      _aiTriggerPulses;    // Pulses on it at the arm
+      tSimulatedAiSource _aiSource;
+      void*    _aiContext;
+      tBoolean _aiOverflow;
+
+      tBoolean _aoArmed;
+      u32      _aoChannels;
+      u64      _aoUpdatePeriodNs;
+      u64      _aoNextUpdateNs;
+      tSimulatedAoSink _aoSink;
+      void*    _aoContext;
+      tBoolean _aoUnderflow;
+
+      tBoolean _diArmed;
+      u64      _diSamplePeriodNs;
+      u64      _diNextSampleNs;
+      tSimulatedDiSource _diSource;
+      void*    _diContext;
+      tBoolean _diOverflow;
+
+      tBoolean _doArmed;
+      u64      _doUpdatePeriodNs;
+      u64      _doNextUpdateNs;
+      tSimulatedDoSink _doSink;
+      void*    _doContext;
+      tBoolean _doUnderflow;
+      u32      _doLastValue;        // Of the DO subsystem, before the watchdog
+      u32      _doPortValue;        // Last given to the sink
+
+      u32      _wdtState;           // nBrdServices::tBrdSrv_WatchdogTimerStateMachineSt_t
+      u64      _wdtDeadlineNs;
+      u32      _wdtExpirations;
+      u32      _wdtFrozenValue;     // Port 0 at the expiration
+
+      tSimulatedPulseSink _pulseSink;
+      void*    _pulseContext;
+
+      f64      _oscillatorPpm;
+
+      tBoolean _manualClock;
+      u64      _startNs;
+      u64      _nowNs;
+      u64      _overflows;
+      u64      _underflows;
+      u64      _eepromReads;
+};
+
+// The simulated board behind an iBus from acquireBoard(), NULL for other buses
+tSimulatedXSeries* getSimulatedXSeries (iBus* bus);
+
+#endif // ___tSimulatedXSeries_h___
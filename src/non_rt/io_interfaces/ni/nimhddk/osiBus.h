@@ -23,6 +23,7 @@
 #endif
 
 class iBus;
+class tDMAPool;
 
 /*
  * tAddressSpace
@@ -37,6 +38,13 @@ class iBus;
  * by dereferencing offsets as pointers. Because the read/write functions are
  * inline, it is quite fast and is usually compiled away.
  *
+ * Built with kMMIOProfiling, every access goes through an out of line
+ * function that records it in getMMIOProfile(), see osiMMIOProfile.h.
+ *
+ * Built with kSimulatedBus, there is no board behind the address space and
+ * every access goes to the register model of Simulated/tSimulatedXSeries.h
+ * instead, through the out of line functions of Simulated/osiUserCode.cpp.
+ *
  */
 class tAddressSpace
 {
@@ -66,6 +74,20 @@ class tAddressSpace
       inline u8  read8  (const u32 offset);
       inline u16 read16 (const u32 offset);
       inline u32 read32 (const u32 offset);
+
+   #ifdef kMMIOProfiling
+   private:
+
+      u32  _profiledRead  (const u32 offset, const u32 size) __attribute__((noinline));
+      void _profiledWrite (const u32 offset, const u32 data, const u32 size) __attribute__((noinline));
+   #endif
+
+   #ifdef kSimulatedBus
+   private:
+
+      u32  _simulatedRead  (const u32 offset, const u32 size) __attribute__((noinline));
+      void _simulatedWrite (const u32 offset, const u32 data, const u32 size) __attribute__((noinline));
+   #endif
 };
 
 //
@@ -185,6 +207,19 @@ class iBus
       // delete directly on the tDMAMemory object.
       void freeDMA (tDMAMemory *mem);
 
+      // Reserve a DMA memory pool that allocDMA() carves its blocks from
+      //
+      // The pool is allocated, mapped, prefaulted and locked once, so buffers
+      // allocated and freed on every (re)configuration cost no driver calls
+      // and no page faults. Blocks that do not fit still come from the driver
+      // one by one. Reserve before the first allocDMA(); size 0 releases the
+      // pool once all of its blocks are freed.
+      //   size: bytes of DMA memory in the pool
+      tStatus reserveDMA (u32 size);
+
+      // The pool of reserveDMA(), NULL without one
+      const tDMAPool* getDMAPool () const;
+
    private:
 
       inline iBus(
@@ -287,36 +322,72 @@ inline void iBus::destroyAddressSpace(tAddressSpace &addressSpace)
 // bug in versions of gcc prior to 3.0.4.
 inline void tAddressSpace::write8(const u32 registerOffset, const u32 data)
 {
+#if defined(kMMIOProfiling)
+   _profiledWrite(registerOffset, data, 1);
+#elif defined(kSimulatedBus)
+   _simulatedWrite(registerOffset, data, 1);
+#else
    volatile u8* p = ((u8*) theSpace) + registerOffset;
    (void)(*p = (u8) data);
+#endif
 }
 inline void tAddressSpace::write16( const u32 registerOffset, const u32 data)
 {
+#if defined(kMMIOProfiling)
+   _profiledWrite(registerOffset, data, 2);
+#elif defined(kSimulatedBus)
+   _simulatedWrite(registerOffset, data, 2);
+#else
    volatile u16* p = (u16*) (((u8*) theSpace) + registerOffset);
    (void)(*p = (u16) ReadLittleEndianU16(data));
+#endif
 }
 inline void tAddressSpace::write32(const u32 registerOffset, const u32 data)
 {
+#if defined(kMMIOProfiling)
+   _profiledWrite(registerOffset, data, 4);
+#elif defined(kSimulatedBus)
+   _simulatedWrite(registerOffset, data, 4);
+#else
    volatile u32* p = (u32*) (((u8*) theSpace) + registerOffset);
    (void)(*p = ReadLittleEndianU32(data));
+#endif
 }
 inline u8 tAddressSpace::read8(const u32 registerOffset)
 {
+#if defined(kMMIOProfiling)
+   return (u8) _profiledRead(registerOffset, 1);
+#elif defined(kSimulatedBus)
+   return (u8) _simulatedRead(registerOffset, 1);
+#else
    volatile u8* p = ((u8*) theSpace) + registerOffset;
    u8  data = *p;
    return data;
+#endif
 }
 inline u16 tAddressSpace::read16(const u32 registerOffset)
 {
+#if defined(kMMIOProfiling)
+   return (u16) _profiledRead(registerOffset, 2);
+#elif defined(kSimulatedBus)
+   return (u16) _simulatedRead(registerOffset, 2);
+#else
    volatile u16* p = (u16*) (((u8*) theSpace) + registerOffset);
    u16  data = *p;
    return ReadLittleEndianU16(data);
+#endif
 }
 inline u32 tAddressSpace::read32(const u32 registerOffset)
 {
+#if defined(kMMIOProfiling)
+   return _profiledRead(registerOffset, 4);
+#elif defined(kSimulatedBus)
+   return _simulatedRead(registerOffset, 4);
+#else
    volatile u32* p = (u32*) (((u8*) theSpace) + registerOffset);
    u32  data = *p;
    return ReadLittleEndianU32(data);
+#endif
 }
 
 // iBus
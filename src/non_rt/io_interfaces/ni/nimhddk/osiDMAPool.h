@@ -0,0 +1,126 @@
+/*
+ * osiDMAPool.h
+ *
+ * tDMAPool -- Hands out blocks of one DMA memory region that is allocated and
+ *    mapped once, see iBus::reserveDMA(). Freed blocks are merged with their
+ *    free neighbours and reused, so reconfiguring a channel with the same
+ *    buffer size gets the same block back without a trip into the driver.
+ *
+ */
+
+#ifndef  ___osiDMAPool_h___
+#define  ___osiDMAPool_h___
+
+#ifndef ___osiTypes_h___
+ #include "osiTypes.h"
+#endif
+
+#include <vector>
+
+// Block alignment in the pool. The CHInCh fetches a chunky link with a
+// single 512-byte read when the link is aligned to 512 bytes, which
+// iBus::allocDMA() cannot promise for buffers of its own.
+static const u32 kDMAPoolAlignment = 512;
+static const u32 kDMAPoolInvalidOffset = 0xFFFFFFFF;
+
+class tDMAPool
+{
+   public:
+
+      explicit tDMAPool (u32 size) :
+         _size (size - size % kDMAPoolAlignment),
+         _bytesUsed (0),
+         _peakBytesUsed (0)
+      {
+         tBlock all = { 0, _size, kFalse };
+         _blocks.push_back(all);
+      }
+
+      // Offset of a block of at least size bytes, kDMAPoolInvalidOffset when
+      // no free block is large enough. The lowest block that fits is taken.
+      u32 allocate (u32 size)
+      {
+         if (size == 0)
+         {
+            return kDMAPoolInvalidOffset;
+         }
+         u32 rounded = (size + kDMAPoolAlignment - 1) / kDMAPoolAlignment * kDMAPoolAlignment;
+         for (u32 i=0; i<_blocks.size(); ++i)
+         {
+            if (_blocks[i].used || _blocks[i].size < rounded)
+            {
+               continue;
+            }
+            if (_blocks[i].size > rounded)
+            {
+               tBlock rest = { _blocks[i].offset + rounded, _blocks[i].size - rounded, kFalse };
+               _blocks.insert(_blocks.begin() + i + 1, rest);
+               _blocks[i].size = rounded;
+            }
+            _blocks[i].used = kTrue;
+            _bytesUsed += rounded;
+            if (_bytesUsed > _peakBytesUsed)
+            {
+               _peakBytesUsed = _bytesUsed;
+            }
+            return _blocks[i].offset;
+         }
+         return kDMAPoolInvalidOffset;
+      }
+
+      // Return a block from allocate()
+      void free (u32 offset)
+      {
+         for (u32 i=0; i<_blocks.size(); ++i)
+         {
+            if (_blocks[i].offset != offset || !_blocks[i].used)
+            {
+               continue;
+            }
+            _blocks[i].used = kFalse;
+            _bytesUsed -= _blocks[i].size;
+            if (i+1 < _blocks.size() && !_blocks[i+1].used)
+            {
+               _blocks[i].size += _blocks[i+1].size;
+               _blocks.erase(_blocks.begin() + i + 1);
+            }
+            if (i > 0 && !_blocks[i-1].used)
+            {
+               _blocks[i-1].size += _blocks[i].size;
+               _blocks.erase(_blocks.begin() + i);
+            }
+            return;
+         }
+      }
+
+      u32 getSize () const
+      {
+         return _size;
+      }
+
+      u32 getBytesUsed () const
+      {
+         return _bytesUsed;
+      }
+
+      u32 getPeakBytesUsed () const
+      {
+         return _peakBytesUsed;
+      }
+
+   private:
+
+      struct tBlock
+      {
+         u32      offset;
+         u32      size;
+         tBoolean used;
+      };
+
+      u32 _size;
+      u32 _bytesUsed;
+      u32 _peakBytesUsed;
+      std::vector<tBlock> _blocks;  // Sorted by offset, no two free blocks in a row
+};
+
+#endif // ___osiDMAPool_h___
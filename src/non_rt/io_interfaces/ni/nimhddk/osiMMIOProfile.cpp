@@ -0,0 +1,273 @@
+/*
+ * osiMMIOProfile.cpp
+ *   Records tAddressSpace accesses when built with kMMIOProfiling
+ *
+ */
+
+#include "osiBus.h"
+#include "osiMMIOProfile.h"
+
+#include <link.h>
+#include <string.h>
+#include <time.h>
+
+namespace
+{
+   inline u32 hashAddress(const void* address, u32 offset)
+   {
+      u64 key = (u64)(size_t)address + offset;
+      key *= 0x9E3779B97F4A7C15ull;
+      return (u32)(key >> 32);
+   }
+
+   inline u64 nowNs()
+   {
+      struct timespec now;
+      clock_gettime(CLOCK_MONOTONIC, &now);
+      return (u64)now.tv_sec * 1000000000ull + now.tv_nsec;
+   }
+
+   struct tModuleLookup
+   {
+      size_t      address;
+      size_t      base;
+      const char* name;
+   };
+
+   int findModule(struct dl_phdr_info* info, size_t, void* data)
+   {
+      tModuleLookup* lookup = (tModuleLookup*)data;
+      for (u32 i=0; i<info->dlpi_phnum; ++i)
+      {
+         const ElfW(Phdr)& header = info->dlpi_phdr[i];
+         if (header.p_type != PT_LOAD) continue;
+         size_t begin = info->dlpi_addr + header.p_vaddr;
+         if (lookup->address >= begin && lookup->address < begin + header.p_memsz)
+         {
+            lookup->base = info->dlpi_addr;
+            lookup->name = (info->dlpi_name && info->dlpi_name[0]) ? info->dlpi_name : "exe";
+            return 1;
+         }
+      }
+      return 0;
+   }
+
+   inline u64 perIteration(u64 value, u64 iterations)
+   {
+      return iterations ? value / iterations : value;
+   }
+}
+
+tMMIOProfile::tMMIOProfile()
+{
+   reset();
+}
+
+void tMMIOProfile::reset()
+{
+   memset(_registers, 0, sizeof(_registers));
+   memset(_sites, 0, sizeof(_sites));
+   memset(&_totals, 0, sizeof(_totals));
+   _iterations = 0;
+   _dropped = 0;
+}
+
+void tMMIOProfile::_add(tCounts& counts, tBoolean isWrite, u64 ns)
+{
+   if (isWrite)
+   {
+      ++counts.writes;
+      counts.writeNs += ns;
+   }
+   else
+   {
+      ++counts.reads;
+      counts.readNs += ns;
+      if (ns > counts.maxReadNs) counts.maxReadNs = ns;
+   }
+}
+
+void tMMIOProfile::record(const void* space, u32 offset, tBoolean isWrite, const void* site, u64 ns)
+{
+   _add(_totals, isWrite, ns);
+
+   // Open addressing, linear probing
+   tRegisterEntry* reg = NULL;
+   u32 index = hashAddress(space, offset);
+   for (u32 probe=0; probe<kMMIOProfileRegisters; ++probe)
+   {
+      tRegisterEntry& entry = _registers[(index + probe) & (kMMIOProfileRegisters - 1)];
+      if (!entry.inUse)
+      {
+         entry.inUse = kTrue;
+         entry.space = space;
+         entry.offset = offset;
+      }
+      if (entry.space == space && entry.offset == offset)
+      {
+         reg = &entry;
+         break;
+      }
+   }
+
+   tSiteEntry* where = NULL;
+   index = hashAddress(site, 0);
+   for (u32 probe=0; probe<kMMIOProfileSites; ++probe)
+   {
+      tSiteEntry& entry = _sites[(index + probe) & (kMMIOProfileSites - 1)];
+      if (!entry.inUse)
+      {
+         entry.inUse = kTrue;
+         entry.site = site;
+      }
+      if (entry.site == site)
+      {
+         where = &entry;
+         break;
+      }
+   }
+
+   if (reg == NULL || where == NULL)
+   {
+      ++_dropped;
+   }
+   if (reg != NULL)
+   {
+      _add(reg->counts, isWrite, ns);
+   }
+   if (where != NULL)
+   {
+      where->offset = offset;
+      _add(where->counts, isWrite, ns);
+   }
+}
+
+void tMMIOProfile::report(u32 maxRows, int (*print)(const char*, ...)) const
+{
+   u64 n = _iterations;
+   print("mmio: %llu iterations, per iteration %llu reads (%llu ns), %llu writes (%llu ns), "
+      "%llu accesses not in the tables\n", (unsigned long long)n,
+      (unsigned long long)perIteration(_totals.reads, n),
+      (unsigned long long)perIteration(_totals.readNs, n),
+      (unsigned long long)perIteration(_totals.writes, n),
+      (unsigned long long)perIteration(_totals.writeNs, n),
+      (unsigned long long)_dropped);
+
+   // Hottest first: repeatedly pick the largest entry not printed yet
+   tBoolean printed[kMMIOProfileSites];
+   memset(printed, 0, sizeof(printed));
+   print("  %-10s %-18s %10s %10s %10s %10s\n", "register", "space", "reads/it", "writes/it",
+      "ns/it", "max read");
+   for (u32 row=0; row<maxRows; ++row)
+   {
+      const tRegisterEntry* hottest = NULL;
+      u32 hottestIndex = 0;
+      for (u32 i=0; i<kMMIOProfileRegisters; ++i)
+      {
+         const tRegisterEntry& entry = _registers[i];
+         if (!entry.inUse || printed[i]) continue;
+         if (hottest == NULL || entry.counts.readNs + entry.counts.writeNs >
+            hottest->counts.readNs + hottest->counts.writeNs)
+         {
+            hottest = &entry;
+            hottestIndex = i;
+         }
+      }
+      if (hottest == NULL) break;
+      printed[hottestIndex] = kTrue;
+      print("  0x%08x %18p %10.2f %10.2f %10llu %10llu\n", hottest->offset, hottest->space,
+         n ? (double)hottest->counts.reads / n : (double)hottest->counts.reads,
+         n ? (double)hottest->counts.writes / n : (double)hottest->counts.writes,
+         (unsigned long long)perIteration(hottest->counts.readNs + hottest->counts.writeNs, n),
+         (unsigned long long)hottest->counts.maxReadNs);
+   }
+
+   memset(printed, 0, sizeof(printed));
+   print("  %-40s %-10s %10s %10s %10s\n", "call site (addr2line -f -e)", "register", "reads/it",
+      "writes/it", "ns/it");
+   for (u32 row=0; row<maxRows; ++row)
+   {
+      const tSiteEntry* hottest = NULL;
+      u32 hottestIndex = 0;
+      for (u32 i=0; i<kMMIOProfileSites; ++i)
+      {
+         const tSiteEntry& entry = _sites[i];
+         if (!entry.inUse || printed[i]) continue;
+         if (hottest == NULL || entry.counts.readNs + entry.counts.writeNs >
+            hottest->counts.readNs + hottest->counts.writeNs)
+         {
+            hottest = &entry;
+            hottestIndex = i;
+         }
+      }
+      if (hottest == NULL) break;
+      printed[hottestIndex] = kTrue;
+
+      tModuleLookup lookup = { (size_t)hottest->site, 0, "?" };
+      dl_iterate_phdr(findModule, &lookup);
+      char where[256];
+      snprintf(where, sizeof(where), "%s 0x%zx", lookup.name, lookup.address - lookup.base);
+      print("  %-40s 0x%08x %10.2f %10.2f %10llu\n", where, hottest->offset,
+         n ? (double)hottest->counts.reads / n : (double)hottest->counts.reads,
+         n ? (double)hottest->counts.writes / n : (double)hottest->counts.writes,
+         (unsigned long long)perIteration(hottest->counts.readNs + hottest->counts.writeNs, n));
+   }
+}
+
+tMMIOProfile& getMMIOProfile()
+{
+   static thread_local tMMIOProfile profile;
+   return profile;
+}
+
+#ifdef kMMIOProfiling
+// Not inlined, so the return address is the code that issued the access
+u32 tAddressSpace::_profiledRead(const u32 registerOffset, const u32 size)
+{
+   u64 begin = nowNs();
+   u32 data = 0;
+#ifdef kSimulatedBus
+   data = _simulatedRead(registerOffset, size);
+#else
+   switch (size)
+   {
+      case 1:
+         data = *(volatile u8*)(((u8*) theSpace) + registerOffset);
+         break;
+      case 2:
+         data = ReadLittleEndianU16(*(volatile u16*)(((u8*) theSpace) + registerOffset));
+         break;
+      default:
+         data = ReadLittleEndianU32(*(volatile u32*)(((u8*) theSpace) + registerOffset));
+         break;
+   }
+#endif
+   getMMIOProfile().record(theSpace, registerOffset, kFalse, __builtin_return_address(0),
+      nowNs() - begin);
+   return data;
+}
+
+void tAddressSpace::_profiledWrite(const u32 registerOffset, const u32 data, const u32 size)
+{
+   u64 begin = nowNs();
+#ifdef kSimulatedBus
+   _simulatedWrite(registerOffset, data, size);
+#else
+   switch (size)
+   {
+      case 1:
+         (void)(*(volatile u8*)(((u8*) theSpace) + registerOffset) = (u8) data);
+         break;
+      case 2:
+         (void)(*(volatile u16*)(((u8*) theSpace) + registerOffset) =
+            (u16) ReadLittleEndianU16(data));
+         break;
+      default:
+         (void)(*(volatile u32*)(((u8*) theSpace) + registerOffset) = ReadLittleEndianU32(data));
+         break;
+   }
+#endif
+   getMMIOProfile().record(theSpace, registerOffset, kTrue, __builtin_return_address(0),
+      nowNs() - begin);
+}
+#endif
@@ -0,0 +1,118 @@
+/*
+ * osiMMIOProfile.h
+ *
+ * tMMIOProfile -- Counts and times the register reads and writes that go
+ *    through tAddressSpace, per register and per call site. Build with
+ *    kMMIOProfiling defined to route every access through the profile;
+ *    without it tAddressSpace stays the plain inline dereference and the
+ *    profile records nothing.
+ *
+ * A read across PCIe stalls the CPU for about a microsecond, while a write is
+ * posted and returns right away, so reads are what a loop wants to lose.
+ * Call markIteration() once per loop iteration and report() prints the
+ * hottest registers and call sites per iteration. Call sites are return
+ * addresses into the code that issued the access, printed as an offset into
+ * their module for addr2line -f -e <module> <offset>.
+ *
+ * The tables are fixed in size and nothing is allocated while recording, so
+ * the profile can run inside an RT loop. A tMMIOProfile is not thread safe,
+ * so every thread records into a profile of its own: markIteration(),
+ * report() and reset() of a task only see the accesses of that task.
+ *
+ */
+
+#ifndef  ___osiMMIOProfile_h___
+#define  ___osiMMIOProfile_h___
+
+#ifndef ___osiTypes_h___
+ #include "osiTypes.h"
+#endif
+
+#include <stdio.h>
+
+static const u32 kMMIOProfileRegisters = 256;   // Power of two
+static const u32 kMMIOProfileSites     = 512;   // Power of two
+
+class tMMIOProfile
+{
+   public:
+
+      tMMIOProfile();
+
+      // Record one access
+      //   space:   base of the address space, tells devices apart
+      //   offset:  register offset in the address space
+      //   isWrite: write or read
+      //   site:    return address of the access
+      //   ns:      time the access took
+      void record(const void* space, u32 offset, tBoolean isWrite, const void* site, u64 ns);
+
+      // Count one iteration of the profiled loop
+      void markIteration()
+      {
+         ++_iterations;
+      }
+
+      // Print the maxRows registers and call sites that took the most time,
+      // per iteration when markIteration() was called
+      void report(u32 maxRows, int (*print)(const char*, ...) = printf) const;
+
+      // Forget all accesses and iterations
+      void reset();
+
+      u64 getIterations() const
+      {
+         return _iterations;
+      }
+
+      u64 getReads() const
+      {
+         return _totals.reads;
+      }
+
+      u64 getWrites() const
+      {
+         return _totals.writes;
+      }
+
+   private:
+
+      struct tCounts
+      {
+         u64 reads;
+         u64 writes;
+         u64 readNs;
+         u64 writeNs;
+         u64 maxReadNs;
+      };
+
+      struct tRegisterEntry
+      {
+         const void* space;
+         u32         offset;
+         tBoolean    inUse;
+         tCounts     counts;
+      };
+
+      struct tSiteEntry
+      {
+         const void* site;
+         u32         offset;       // Last register the site accessed
+         tBoolean    inUse;
+         tCounts     counts;
+      };
+
+      static void _add(tCounts& counts, tBoolean isWrite, u64 ns);
+
+      tRegisterEntry _registers[kMMIOProfileRegisters];
+      tSiteEntry     _sites[kMMIOProfileSites];
+      tCounts        _totals;
+      u64            _iterations;
+      u64            _dropped;     // Accesses that found their table full
+};
+
+// The profile the tAddressSpace accesses of the calling thread are recorded in,
+// created at the first access of the thread
+tMMIOProfile& getMMIOProfile();
+
+#endif // ___osiMMIOProfile_h___
@@ -27,6 +27,7 @@ namespace nNISTC3
       _readIdx(0),
       _writeIdx(0),
       _lastwriteIdx(0),
+      _acquiredBytes(0),
       _direction(kIn),
       _topo(kNone),
       _size(0),
@@ -111,6 +112,7 @@ namespace nNISTC3
       _readIdx  = 0;
       _writeIdx = 0;
       _lastwriteIdx = 0;
+      _acquiredBytes = 0;
 
       _state = kIdle;
    }
@@ -345,6 +347,206 @@ namespace nNISTC3
       *bytesLeft = bytesFree;
    }
 
+   void tCHInChDMAChannel::acquireRead( u32              requestedBytes,
+                                        tDMASpan*        span,
+                                        u32*             bytesLeft,
+                                        tBoolean         allowOverwrite,
+                                        tBoolean*        dataOverwritten,
+                                        nMDBG::tStatus2& status )
+   {
+      if (status.isFatal()) return;
+
+      if ( !(_state == kStarted || _state == kStopped) )
+      {
+         status.setCode(kWrongChannelState);
+         return;
+      }
+
+      // A new acquisition replaces one that was not released
+      _acquiredBytes = 0;
+
+      // 1. Get number of bytes available in the buffer and validate, as read()
+      u32 bytesInBuffer = _getBytesInBuffer(status);
+
+      // 1a. If bytes transfered exceed the buffer size, the DMA buffer overflowed
+      if (bytesInBuffer > _size && !allowOverwrite)
+      {
+         status.setCode(kBufferOverflow);
+         return;
+      }
+
+      // 1b. If the user didn't pass a span, just return the bytes available
+      if (requestedBytes == 0 || span == NULL)
+      {
+         *bytesLeft = bytesInBuffer;
+         return;
+      }
+
+      // 1c. Check if there's enough data to satisfy user request
+      if (requestedBytes > bytesInBuffer)
+      {
+         status.setCode(kDataNotAvailable);
+         return;
+      }
+
+      // 1d. Check if the user request is too large
+      if (requestedBytes > _size)
+      {
+         status.setCode(kInvalidInput);
+         return;
+      }
+
+      // 2. Point at the data in the DMA buffer
+      if (allowOverwrite && bytesInBuffer > _size)
+      {
+         // Data has been overwritten, so set the buffer and index locations to
+         // the most recent data
+         _buffer->setLocation( (_writeIdx - requestedBytes) % _size );
+         _readIdx = _writeIdx - requestedBytes;
+         *dataOverwritten = kTrue;
+      }
+      _buffer->getSpan(requestedBytes, *span);
+      _acquiredBytes = requestedBytes;
+      *bytesLeft = bytesInBuffer - requestedBytes;
+   }
+
+   void tCHInChDMAChannel::releaseRead( u32*             bytesLeft,
+                                        tBoolean         allowOverwrite,
+                                        tBoolean*        dataOverwritten,
+                                        nMDBG::tStatus2& status )
+   {
+      if (status.isFatal()) return;
+
+      if ( !(_state == kStarted || _state == kStopped) )
+      {
+         status.setCode(kWrongChannelState);
+         return;
+      }
+
+      // 3. Check for overflow again
+      //    The channel may have overwritten the data while the user worked on it
+      //    in place, which read() would have caught during its copy.
+      u32 bytesInBuffer = _getBytesInBuffer(status);
+      if (bytesInBuffer > _size)
+      {
+         if (!allowOverwrite)
+         {
+            status.setCode(kBufferOverflow);
+            return;
+         }
+         *dataOverwritten = kTrue;
+      }
+
+      // 4. Update read index and buffer location and recalculate the number of
+      //    bytes available to return to the user.
+      _buffer->setLocation( (_buffer->getLocation() + _acquiredBytes) % _size );
+      _readIdx += _acquiredBytes;
+      _acquiredBytes = 0;
+      bytesInBuffer = _getBytesInBuffer(status);
+      *bytesLeft = bytesInBuffer;
+   }
+
+   void tCHInChDMAChannel::acquireWrite( u32              requestedBytes,
+                                         tDMASpan*        span,
+                                         u32*             bytesLeft,
+                                         tBoolean         allowRegeneration,
+                                         tBoolean*        dataRegenerated,
+                                         nMDBG::tStatus2& status )
+   {
+      if (status.isFatal()) return;
+
+      if ( !(_state == kStarted || _state == kConfigured) )
+      {
+         status.setCode(kWrongChannelState);
+         return;
+      }
+
+      // A new acquisition replaces one that was not released
+      _acquiredBytes = 0;
+
+      // 1. Get number of bytes available/free in the buffer and validate, as write()
+      u32 bytesInBuffer = _getBytesInBuffer(status);
+      u32 bytesFree     = _size - bytesInBuffer;
+
+      // 1a. If bytes transfered exceed the buffer size, the DMA buffer underflowed
+      //     This occurs when the read index passes the write index
+      if (bytesInBuffer > _size && !allowRegeneration)
+      {
+         status.setCode(kBufferUnderflow);
+         return;
+      }
+
+      // 1b. If the user didn't pass a span, just return the bytes available
+      if (requestedBytes == 0 || span == NULL)
+      {
+         *bytesLeft = bytesFree;
+         return;
+      }
+
+      // 1c. Check if there's enough space to write user data
+      if (requestedBytes > bytesFree)
+      {
+         status.setCode(kSpaceNotAvailable);
+         return;
+      }
+
+      // 1d. Check if user request is too large
+      if (requestedBytes > _size)
+      {
+         status.setCode(kInvalidInput);
+         return;
+      }
+
+      // 2. Point at the free space in the DMA buffer
+      if (allowRegeneration && bytesInBuffer > _size)
+      {
+         // Data has been regenerated, so set the buffer and index locations to
+         // the most recent data
+         _buffer->setLocation( (_readIdx - requestedBytes) % _size );
+         _writeIdx = _readIdx - requestedBytes;
+         *dataRegenerated = kTrue;
+      }
+      _buffer->getSpan(requestedBytes, *span);
+      _acquiredBytes = requestedBytes;
+      *bytesLeft = bytesFree - requestedBytes;
+   }
+
+   void tCHInChDMAChannel::releaseWrite( u32*             bytesLeft,
+                                         tBoolean         allowRegeneration,
+                                         tBoolean*        dataRegenerated,
+                                         nMDBG::tStatus2& status )
+   {
+      if (status.isFatal()) return;
+
+      if ( !(_state == kStarted || _state == kConfigured) )
+      {
+         status.setCode(kWrongChannelState);
+         return;
+      }
+
+      // 3. Check for underflow again
+      //    The channel may have run past the write index while the user filled
+      //    the space in place.
+      u32 bytesInBuffer = _getBytesInBuffer(status);
+      if (bytesInBuffer > _size)
+      {
+         if (!allowRegeneration)
+         {
+            status.setCode(kBufferUnderflow);
+            return;
+         }
+         *dataRegenerated = kTrue;
+      }
+
+      // 4. Update write index and buffer location and recalculate number of
+      //    empty bytes to return to the user.
+      _buffer->setLocation( (_buffer->getLocation() + _acquiredBytes) % _size );
+      _writeIdx += _acquiredBytes;
+      _acquiredBytes = 0;
+      bytesInBuffer = _getBytesInBuffer(status);
+      *bytesLeft = _size - bytesInBuffer;
+   }
+
    void tCHInChDMAChannel::_config(nMDBG::tStatus2& status)
    {
       if (status.isFatal()) return;
@@ -375,6 +577,7 @@ namespace nNISTC3
       _buffer->setLocation(0);
       _readIdx  = 0;
       _writeIdx = 0;
+      _acquiredBytes = 0;
 
       _state = kConfigured;
    }
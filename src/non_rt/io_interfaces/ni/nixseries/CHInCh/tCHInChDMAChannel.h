@@ -83,6 +83,58 @@ namespace nNISTC3
                   tBoolean* dataRegenerated,
                   nMDBG::tStatus2& status );
 
+      // Read data in place: channel must be in kStarted state
+      // Same checks as read(), but the data stays in the DMA buffer and span
+      // points at it. The data belongs to the caller until releaseRead().
+      //   requestedBytes:  requested number of bytes to be read
+      //   span:            where the data is in the DMA buffer
+      //   bytesLeft:       data left in the DMA buffer
+      //   allowOverwrite:  can the channel overwrite unread data?
+      //   dataOverwritten: has the channel overwritten unread data?
+      //   status
+      void acquireRead( u32       requestedBytes,
+                        tDMASpan* span,
+                        u32*      bytesLeft,
+                        tBoolean  allowOverwrite,
+                        tBoolean* dataOverwritten,
+                        nMDBG::tStatus2& status );
+
+      // Give the data of the last acquireRead() back to the channel
+      //   bytesLeft:       data left in the DMA buffer
+      //   allowOverwrite:  can the channel overwrite unread data?
+      //   dataOverwritten: has the channel overwritten the acquired data?
+      //   status
+      void releaseRead( u32*      bytesLeft,
+                        tBoolean  allowOverwrite,
+                        tBoolean* dataOverwritten,
+                        nMDBG::tStatus2& status );
+
+      // Write data in place: channel must be kConfigured or kStarted
+      // Same checks as write(), span points at free space in the DMA buffer to
+      // fill before releaseWrite() hands it to the channel.
+      //   requestedBytes:    requested number of bytes to be written
+      //   span:              where to put the data in the DMA buffer
+      //   bytesLeft:         space left in the DMA buffer
+      //   allowRegeneration: can the channel regenerate old data?
+      //   dataRegenerated:   has the channel regenerated old data?
+      //   status
+      void acquireWrite( u32       requestedBytes,
+                         tDMASpan* span,
+                         u32*      bytesLeft,
+                         tBoolean  allowRegeneration,
+                         tBoolean* dataRegenerated,
+                         nMDBG::tStatus2& status );
+
+      // Hand the space of the last acquireWrite() to the channel
+      //   bytesLeft:         space left in the DMA buffer
+      //   allowRegeneration: can the channel regenerate old data?
+      //   dataRegenerated:   has the channel regenerated old data?
+      //   status
+      void releaseWrite( u32*      bytesLeft,
+                         tBoolean  allowRegeneration,
+                         tBoolean* dataRegenerated,
+                         nMDBG::tStatus2& status );
+
       // Reset the DMA channel: place channel into kIdle state
       void reset(nMDBG::tStatus2& status);
 
@@ -101,6 +153,7 @@ namespace nNISTC3
       u64                         _readIdx;
       u64                         _writeIdx;
       u64                         _lastwriteIdx;  // Last "good" _writdeIdx snapshot
+      u32                         _acquiredBytes; // Held by the user between acquire and release
 
       tDMADirection               _direction;
       tDMATopology                _topo;
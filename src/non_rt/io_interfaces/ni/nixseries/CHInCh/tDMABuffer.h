@@ -20,6 +20,15 @@
 
 namespace nNISTC3
 {
+   // Region of the DMA buffer handed out in place of a copy
+   // A region that wraps around the end of the buffer comes in two pieces; the
+   // second piece starts at the beginning of the buffer and is empty otherwise.
+   struct tDMASpan
+   {
+      u8* data[2];
+      u32 size[2];
+   };
+
    class tDMABuffer
    {
    public:
@@ -38,7 +47,13 @@ namespace nNISTC3
       virtual void  read(u32 requestedBytes, void *buffer) = 0;
       virtual void write(u32 requestedBytes, void *buffer) = 0;
 
+      // Map data in the DMA buffer without copying it
+      //   requestedBytes: bytes from the current location on
+      //   span:           one or two pieces covering them
+      inline void getSpan(u32 requestedBytes, tDMASpan& span) const;
+
       // Retrieve information describing the DMA buffer's location/size
+      virtual u8* getAddress() const = 0;      // Host address of the DMA buffer data
       virtual u64 getStartAddress() const = 0; // Physical address of the DMA buffer/SGL link
       virtual u32 getSize() const = 0;         // Length of the DMA buffer
       virtual u32 getLinkSize() const = 0;     // Length of the first DMA SGL link
@@ -59,6 +74,18 @@ namespace nNISTC3
    {
       _index = location;
    }
+
+   inline void tDMABuffer::getSpan(u32 requestedBytes, tDMASpan& span) const
+   {
+      u32 size = getSize();
+      u32 current = (u32)_index;
+      u32 tail = size - current;
+
+      span.data[0] = getAddress() + current;
+      span.size[0] = (requestedBytes < tail) ? requestedBytes : tail;
+      span.data[1] = getAddress();
+      span.size[1] = requestedBytes - span.size[0];
+   }
 } // nNISTC3
 
 #endif // ___tDMABuffer_h___
@@ -114,6 +114,11 @@ namespace nNISTC3
       setLocation(end);
    }
 
+   u8* tLinearDMABuffer::getAddress() const
+   {
+      return (u8 *)_memory->getAddress();
+   }
+
    u64 tLinearDMABuffer::getStartAddress() const
    {
       return _memory->getPhysicalAddress();
@@ -166,6 +166,11 @@ namespace nNISTC3
       setLocation(end);
    }
 
+   u8* tScatterGatherDMABuffer::getAddress() const
+   {
+      return (u8 *)_memory->getAddress();
+   }
+
    u64 tScatterGatherDMABuffer::getStartAddress() const
    {
       return _sgl.getCHLAR();
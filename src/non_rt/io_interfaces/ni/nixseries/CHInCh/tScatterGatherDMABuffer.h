@@ -38,6 +38,7 @@ namespace nNISTC3
       virtual void write(u32 requestedBytes, void *buffer);
 
       // Retrieve information describing the DMA link's location/size
+      virtual u8* getAddress() const;      // Host address of the DMA buffer data
       virtual u64 getStartAddress() const; // Physical address of the DMA buffer/SGL link
       virtual u32 getSize() const;         // Length of the DMA buffer
       virtual u32 getLinkSize() const;     // Length of the first DMA SGL link
@@ -34,7 +34,7 @@
 // order in the resulting combined id.
 #define nNIMXRegisterMap120_mBuildFieldId(fieldId, regId) \
    ( \
-     ((fieldId) << 27) | \
+     (((fieldId) & 0x1f) << 27) | \
      ((((fieldId) >> 5) & 0x1) << 26) | \
      ((((fieldId) >> 6) & 0x1) << 25) | \
      (regId) \
@@ -12,6 +12,7 @@
 #include "eepromHelper.h"
 
 #include <stdio.h>
+#include <string.h>
 
 // Chip Objects
 #include "tXSeries.h"
@@ -40,7 +41,48 @@ namespace nNISTC3
       _selfCalTemp(0.0),
       _selfCalVoltRef(0.0),
       _aiCalInfo(NULL),
-      _aoCalInfo(NULL)
+      _aoCalInfo(NULL),
+      _coefficientsAddress(0),
+      _snapshots(NULL),
+      _numberOfSnapshots(0),
+      _fromSnapshot(kFalse)
+   {
+      _initialize(status);
+   }
+
+   eepromHelper::eepromHelper( tXSeries&        xseries,
+                               tBoolean         isSimultaneous,
+                               u32              numberOfADCs,
+                               u32              numberOfDACs,
+                               const tSnapshot* snapshots,
+                               u32              numberOfSnapshots,
+                               nMDBG::tStatus2& status ) :
+      _eeprom(xseries.getBusSpaceReference() + nCHInCh::kEEPROMOffset),
+      _xseries(xseries),
+      _isSimultaneous(isSimultaneous),
+      _baseAddress(0),
+      _numberOfADCs(numberOfADCs),
+      _numberOfDACs(numberOfDACs),
+      _serialNumber(0),
+      _geographicalAddress(0),
+      _stc3Revision(0),
+      _extCalTime(0),
+      _extCalTemp(0.0),
+      _extCalVoltRef(0.0),
+      _selfCalTime(0),
+      _selfCalTemp(0.0),
+      _selfCalVoltRef(0.0),
+      _aiCalInfo(NULL),
+      _aoCalInfo(NULL),
+      _coefficientsAddress(0),
+      _snapshots(snapshots),
+      _numberOfSnapshots(numberOfSnapshots),
+      _fromSnapshot(kFalse)
+   {
+      _initialize(status);
+   }
+
+   void eepromHelper::_initialize(nMDBG::tStatus2& status)
    {
       // This shouldn't happen!
       if (_numberOfADCs > 1 && !_isSimultaneous)
@@ -64,6 +106,17 @@ namespace nNISTC3
       _aiCalInfo = new tAICalibration[_numberOfADCs];
       _aoCalInfo = new tAOCalibration[_numberOfDACs];
       _traverseCapabilitiesList(capabilitiesListOffset, status);
+      if (status.isFatal()) return;
+
+      // The serial number node can follow the calibration, so the coefficients are
+      // read, or taken from a snapshot, once the whole list is known
+      _fromSnapshot = _loadSnapshot();
+      if (!_fromSnapshot)
+      {
+         _readCoefficients(status);
+      }
+      _snapshots = NULL;
+      _numberOfSnapshots = 0;
    }
 
    eepromHelper::~eepromHelper()
@@ -286,7 +339,18 @@ namespace nNISTC3
       _selfCalTemp = _readF32(selfCalDataOffset + kCalTemperatureOffset);
       _selfCalVoltRef = _readF32(selfCalDataOffset + kCalVoltageRefOffset);
 
-      u32 currentCalAddress = selfCalDataOffset + kCalCoefficientsOffset;
+      _coefficientsAddress = selfCalDataOffset + kCalCoefficientsOffset;
+   }
+
+   void eepromHelper::_readCoefficients(nMDBG::tStatus2& status)
+   {
+      if (_coefficientsAddress == 0)
+      {
+         status.setCode(kStatusBadSelector);
+         return;
+      }
+
+      u32 currentCalAddress = _coefficientsAddress;
       for (u32 i=0; i<_numberOfADCs; ++i)
       {
          for (u32 j=0; j<kNumAIModes; ++j)
@@ -312,6 +376,61 @@ namespace nNISTC3
       }
    }
 
+   tBoolean eepromHelper::_loadSnapshot()
+   {
+      if (_numberOfADCs > kMaxSnapshotADCs || _numberOfDACs > kMaxSnapshotDACs) return kFalse;
+
+      for (u32 i=0; i<_numberOfSnapshots; ++i)
+      {
+         const tSnapshot& snapshot = _snapshots[i];
+         if (snapshot.serialNumber == _serialNumber &&
+             snapshot.stc3Revision == _stc3Revision &&
+             snapshot.extCalTime == static_cast<i64>(_extCalTime) &&
+             snapshot.selfCalTime == static_cast<i64>(_selfCalTime) &&
+             snapshot.numberOfADCs == _numberOfADCs &&
+             snapshot.numberOfDACs == _numberOfDACs)
+         {
+            for (u32 j=0; j<_numberOfADCs; ++j)
+            {
+               _aiCalInfo[j] = snapshot.aiCalInfo[j];
+            }
+            for (u32 j=0; j<_numberOfDACs; ++j)
+            {
+               _aoCalInfo[j] = snapshot.aoCalInfo[j];
+            }
+            return kTrue;
+         }
+      }
+      return kFalse;
+   }
+
+   void eepromHelper::getSnapshot(tSnapshot& snapshot, nMDBG::tStatus2& status)
+   {
+      if (status.isFatal()) return;
+
+      if (_numberOfADCs > kMaxSnapshotADCs || _numberOfDACs > kMaxSnapshotDACs)
+      {
+         status.setCode(kStatusBadSelector);
+         return;
+      }
+
+      memset(&snapshot, 0, sizeof(snapshot));
+      snapshot.serialNumber = _serialNumber;
+      snapshot.stc3Revision = _stc3Revision;
+      snapshot.extCalTime = static_cast<i64>(_extCalTime);
+      snapshot.selfCalTime = static_cast<i64>(_selfCalTime);
+      snapshot.numberOfADCs = _numberOfADCs;
+      snapshot.numberOfDACs = _numberOfDACs;
+      for (u32 i=0; i<_numberOfADCs; ++i)
+      {
+         snapshot.aiCalInfo[i] = _aiCalInfo[i];
+      }
+      for (u32 i=0; i<_numberOfDACs; ++i)
+      {
+         snapshot.aoCalInfo[i] = _aoCalInfo[i];
+      }
+   }
+
    void eepromHelper::_readMode(u32 address, tMode& mode)
    {
       mode.order = _readU8(address);
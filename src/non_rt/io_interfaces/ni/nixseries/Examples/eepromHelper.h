@@ -55,6 +55,16 @@ namespace nNISTC3
                     u32              numberOfADCs,
                     u32              numberOfDACs,
                     nMDBG::tStatus2& status );
+      // Reads the identity and calibration dates only, and takes the coefficients
+      // from the snapshot of the same board and calibration when there is one
+      struct tSnapshot;
+      eepromHelper( tXSeries&        xseries,
+                    tBoolean         isSimultaneous,
+                    u32              numberOfADCs,
+                    u32              numberOfDACs,
+                    const tSnapshot* snapshots,
+                    u32              numberOfSnapshots,
+                    nMDBG::tStatus2& status );
       ~eepromHelper();
 
       u32 getSerialNumber() { return _serialNumber; }
@@ -71,6 +81,11 @@ namespace nNISTC3
       void getAIScalingCoefficients(u32 ADCNumber, u32 intervalNumber, tAIScalingCoefficients& coefficients, nMDBG::tStatus2& status);
       void getAOScalingCoefficients(u32 DACNumber, u32 intervalNumber, tAOScalingCoefficients& coefficients, nMDBG::tStatus2& status);
 
+      static const u32 kMaxSnapshotADCs = 16;
+      static const u32 kMaxSnapshotDACs = 4;
+      tBoolean isFromSnapshot() { return _fromSnapshot; }
+      void getSnapshot(tSnapshot& snapshot, nMDBG::tStatus2& status);
+
    private:
       static const u32 kCapabilitiesListFlagPtrOffset = 0x0C;
       static const u32 kCapabilitiesListAPtrOffset    = 0x10;
@@ -146,12 +161,15 @@ namespace nNISTC3
          tInterval intervals[kNumAOIntervals];
       };
 
+      void _initialize(nMDBG::tStatus2& status);
       void _traverseCapabilitiesList(u32 nodeAddress, nMDBG::tStatus2& status);
       void _parseGeographicalAddressingNode(u32 nodeAddress, nMDBG::tStatus2& status);
       void _parseSerialNumberNode(u32 nodeAddress, nMDBG::tStatus2& status);
       void _parseDeviceSpecificNode(u32 nodeAddress, nMDBG::tStatus2& status);
       void _readMode(u32 address, tMode& mode);
       void _readInterval(u32 address, tInterval& interval);
+      void _readCoefficients(nMDBG::tStatus2& status);
+      tBoolean _loadSnapshot();
       u32 _getOffsetForPages(u32 aOffset, u32 bOffset, nMDBG::tStatus2& status);
 
       void _shiftWindow(u32 address);
@@ -181,11 +199,31 @@ namespace nNISTC3
       f32             _selfCalVoltRef;
       tAICalibration* _aiCalInfo;
       tAOCalibration* _aoCalInfo;
+      u32             _coefficientsAddress;
+
+      // Snapshots offered by the caller, only used while constructing
+      const tSnapshot* _snapshots;
+      u32              _numberOfSnapshots;
+      tBoolean         _fromSnapshot;
 
       // Usage guidelines
       eepromHelper(const eepromHelper&);
       eepromHelper& operator=(const eepromHelper&);
    };
+
+   // Everything eepromHelper reads from the coefficient area, and the identity it
+   // belongs to. Plain data, it can be stored and handed back to the constructor.
+   struct eepromHelper::tSnapshot
+   {
+      u32            serialNumber;
+      u32            stc3Revision;
+      i64            extCalTime;
+      i64            selfCalTime;
+      u32            numberOfADCs;
+      u32            numberOfDACs;
+      tAICalibration aiCalInfo[kMaxSnapshotADCs];
+      tAOCalibration aoCalInfo[kMaxSnapshotDACs];
+   };
 }
 
 #endif // ___eepromHelper_h___
@@ -0,0 +1,93 @@
+#ifndef _CANCODEC_H_
+#define _CANCODEC_H_
+
+#include <stdint.h>
+
+#include <CanTypes.h>
+
+/*
+ * support for the codecs generated by scripts/dbc_codegen.py
+ *
+ * a generated message packs into a 64 bit payload word whose bit n is bit n % 8 of
+ * data byte n / 8 (intel order); motorola signals are placed in the byte swapped
+ * word, so every signal becomes one shift and one mask either way
+ */
+namespace CanCodec
+{
+
+constexpr uint64_t Swap(const uint64_t word)
+{
+  return ((word & 0x00000000000000ffull) << 56) | ((word & 0x000000000000ff00ull) << 40) |
+    ((word & 0x0000000000ff0000ull) << 24) | ((word & 0x00000000ff000000ull) << 8) |
+    ((word & 0x000000ff00000000ull) >> 8) | ((word & 0x0000ff0000000000ull) >> 24) |
+    ((word & 0x00ff000000000000ull) >> 40) | ((word & 0xff00000000000000ull) >> 56);
+}
+
+// physical value to raw, clamped to [rawMin, rawMax], nan goes to rawMin
+constexpr int64_t Encode(const double value, const double offset, const double inverseFactor,
+  const double rawMin, const double rawMax)
+{
+  auto raw = (value - offset) * inverseFactor;
+  // every comparison with nan is false, it would pass the clamps below as rawMax
+  if(raw != raw)
+    raw = rawMin;
+  raw = (raw < rawMax) ? raw : rawMax;
+  raw = (raw > rawMin) ? raw : rawMin;
+  return static_cast<int64_t>(raw >= 0. ? raw + 0.5 : raw - 0.5);
+}
+
+constexpr int64_t SignExtend(const uint64_t raw, const unsigned int length)
+{
+  return static_cast<int64_t>((raw ^ (1ull << (length - 1))) - (1ull << (length - 1)));
+}
+
+inline uint64_t LoadPayload(const CanFrame &frame)
+{
+  uint64_t payload{0};
+  for(auto i{0u}; i < CanLimit::kMaxDataLength; ++i)
+  {
+    payload |= static_cast<uint64_t>(frame.mData[i]) << (8u * i);
+  }
+  return payload;
+}
+
+inline void StorePayload(const uint64_t payload, CanFrame &frame)
+{
+  for(auto i{0u}; i < CanLimit::kMaxDataLength; ++i)
+  {
+    frame.mData[i] = static_cast<uint8_t>(payload >> (8u * i));
+  }
+}
+
+// many messages of one type per cycle, frames receive id, type, length and payload
+template <typename tMessage>
+void PackFrames(const tMessage *messages, CanFrame *frames, const unsigned int count)
+{
+  for(auto i{0u}; i < count; ++i)
+  {
+    frames[i].mId = tMessage::kId;
+    frames[i].mType = tMessage::kType;
+    frames[i].mLen = tMessage::kLength;
+    StorePayload(tMessage::Pack(messages[i]), frames[i]);
+  }
+}
+
+template <typename tMessage>
+void UnpackFrames(const CanFrame *frames, tMessage *messages, const unsigned int count)
+{
+  for(auto i{0u}; i < count; ++i)
+  {
+    messages[i] = tMessage::Unpack(LoadPayload(frames[i]));
+  }
+}
+
+// CanPayloadSource of the transmit schedule, context points to the message to send
+template <typename tMessage>
+void PackSource(void *context, CanFrame &frame)
+{
+  StorePayload(tMessage::Pack(*static_cast<const tMessage*>(context)), frame);
+}
+
+} // namespace CanCodec
+
+#endif // _CANCODEC_H_
@@ -0,0 +1,56 @@
+#ifndef _CANDEVICE_H_
+#define _CANDEVICE_H_
+
+#include <stdio.h>
+
+#include <CanTypes.h>
+
+/*
+ * one can bus as seen by the receive and transmit tasks
+ *
+ * Read() waits at most timeoutUs for a frame, then takes whatever else is already
+ * pending, up to maxFrames, and returns the number read: 0 on timeout, -1 on a device
+ * error. mDriverUs of every frame is the device timestamp, in whatever clock the
+ * device uses. Write() never waits for room and returns how many of the frames were
+ * queued, stopping at the first that did not fit, or -1 on a device error.
+ * Write() may run in several tasks at once, a transmit task and gateway rules, so an
+ * implementation keeps no write state in members; frames of concurrent calls may
+ * interleave, each goes out whole.
+ *
+ * a device with a data bit rate is opened in can fd mode and also carries fd frames;
+ * whether a frame switches to the data bit rate is up to its kBitRateSwitch flag.
+ */
+class CanDevice
+{
+public:
+  const char *mName;
+  const char *mDeviceName;
+  unsigned int mBitRate; // bits/s
+  unsigned int mDataBitRate; // bits/s, 0 for classic can
+
+public:
+  CanDevice(const char *name, const char *deviceName, const unsigned int bitRate,
+    const unsigned int dataBitRate=0)
+    : mName(name)
+    , mDeviceName(deviceName)
+    , mBitRate(bitRate)
+    , mDataBitRate(dataBitRate)
+  {}
+
+  CanDevice(const CanDevice&) = delete;
+  CanDevice& operator=(const CanDevice&) = delete;
+
+  virtual int Open() = 0;
+  virtual int Read(CanFrame *frames, const unsigned int maxFrames, const int timeoutUs) = 0;
+  virtual int Write(const CanFrame *frames, const unsigned int numFrames) = 0;
+
+  // CanWriter of the gateway, 0 when the frame was queued
+  static int Write(void *device, const CanFrame &frame)
+  {
+    return (static_cast<CanDevice*>(device)->Write(&frame, 1) == 1) ? 0 : -1;
+  }
+
+  virtual ~CanDevice() {}
+};
+
+#endif // _CANDEVICE_H_
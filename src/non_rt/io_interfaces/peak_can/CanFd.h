@@ -0,0 +1,64 @@
+#ifndef _CANFD_H_
+#define _CANFD_H_
+
+#include <stdint.h>
+
+#include <CanTypes.h>
+
+/*
+ * can fd payload lengths and frame timing
+ *
+ * an fd frame carries 0 to 8, 12, 16, 20, 24, 32, 48 or 64 bytes. with bit rate
+ * switching everything from the brs bit to the crc delimiter runs at the data bit
+ * rate, the arbitration and the frame end stay at the nominal one.
+ */
+namespace CanFd
+{
+
+constexpr uint8_t kDlcToLength[16] = {0, 1, 2, 3, 4, 5, 6, 7, 8, 12, 16, 20, 24, 32, 48, 64};
+
+constexpr uint8_t LengthToDlc(const unsigned int length)
+{
+  return (length <= 8) ? length : (length <= 12) ? 9 : (length <= 16) ? 10 :
+    (length <= 20) ? 11 : (length <= 24) ? 12 : (length <= 32) ? 13 : (length <= 48) ? 14 : 15;
+}
+
+// smallest length the frame can actually carry, the rest is padding
+constexpr unsigned int RoundUpLength(const unsigned int length)
+{
+  return kDlcToLength[LengthToDlc(length)];
+}
+
+/*
+ * worst case time of a frame on the bus in ns, stuff bits included
+ * classic frames and fd frames without kBitRateSwitch run at the nominal rate only
+ */
+inline unsigned long long FrameTimeNs(const CanFrame &frame, const unsigned int bitRate,
+  const unsigned int dataBitRate)
+{
+  const auto extended = (frame.mType & CanFrameType::kExtended) != 0;
+  if(!(frame.mType & CanFrameType::kFd))
+  {
+    // 34 (standard) or 54 (extended) bits are exposed to stuffing besides the data
+    const auto stuffed = (extended ? 54u : 34u) + 8u * frame.mLen;
+    return (stuffed + 13u + (stuffed - 1u) / 4u) * 1000000000ull / bitRate;
+  }
+
+  // sof to brs, then esi, dlc and data, both with dynamic stuffing
+  const auto arbitration = extended ? 36u : 17u;
+  const auto length = RoundUpLength(frame.mLen);
+  const auto data = 5u + 8u * length;
+  // stuff count, crc and its fixed stuff bits, then the crc delimiter
+  const auto crc = 4u + ((length <= 16) ? 17u + 6u : 21u + 7u) + 1u;
+  // ack, ack delimiter, eof and intermission
+  const auto end = 12u;
+
+  const auto nominalBits = arbitration + arbitration / 4u + end;
+  const auto dataBits = data + data / 4u + crc;
+  const auto dataRate = (frame.mType & CanFrameType::kBitRateSwitch) ? dataBitRate : bitRate;
+  return nominalBits * 1000000000ull / bitRate + dataBits * 1000000000ull / dataRate;
+}
+
+} // namespace CanFd
+
+#endif // _CANFD_H_
@@ -0,0 +1,161 @@
+#include <CanGateway.h>
+
+CanGateway::CanGateway(unsigned long long (*clock)())
+  : mNumRules(0)
+  , mClock(clock)
+{
+  for(auto i{0u}; i < CanRoute::kMaxChannels; ++i)
+  {
+    mWriters[i] = NULL;
+    mWriterContexts[i] = NULL;
+  }
+}
+
+int CanGateway::AddRule(const CanGatewayRule &rule)
+{
+  if(mNumRules == CanRoute::kMaxRules)
+  {
+    printf("CanGateway: no more than %d rules\n", CanRoute::kMaxRules);
+    return -1;
+  }
+  if(rule.mSource >= CanRoute::kMaxChannels || rule.mDestination >= CanRoute::kMaxChannels)
+  {
+    printf("CanGateway: channels are 0 to %d\n", CanRoute::kMaxChannels - 1);
+    return -1;
+  }
+  if(rule.mSource == rule.mDestination)
+  {
+    printf("CanGateway: rule 0x%x would send channel %d back to itself\n", rule.mId,
+      rule.mSource);
+    return -1;
+  }
+
+  mRules[mNumRules] = rule;
+  mCounters[mNumRules] = CanGatewayCounters{0, 0, 0, 0, 0, 0};
+  return mNumRules++;
+}
+
+int CanGateway::SetWriter(const unsigned int channel, CanWriter writer, void *context)
+{
+  if(channel >= CanRoute::kMaxChannels)
+    return -1;
+
+  mWriters[channel] = writer;
+  mWriterContexts[channel] = context;
+  return 0;
+}
+
+int CanGateway::Build()
+{
+  mRuleOrder.clear();
+  for(auto channel{0u}; channel < CanRoute::kMaxChannels; ++channel)
+  {
+    // distinct source keys of this channel, in the order they first appear
+    std::vector<uint32_t> keys;
+    std::vector<std::vector<uint16_t>> rulesOfKey;
+    for(auto rule{0u}; rule < mNumRules; ++rule)
+    {
+      if(mRules[rule].mSource != channel)
+        continue;
+
+      if(mWriters[mRules[rule].mDestination] == NULL)
+      {
+        printf("CanGateway: no writer for channel %d\n", mRules[rule].mDestination);
+        return -1;
+      }
+
+      auto key = CanIdTable::Key(mRules[rule].mId, mRules[rule].mType);
+      auto found{0u};
+      while(found < keys.size() && keys[found] != key)
+        ++found;
+      if(found == keys.size())
+      {
+        keys.push_back(key);
+        rulesOfKey.emplace_back();
+      }
+      rulesOfKey[found].push_back(rule);
+    }
+
+    mRuleBegin[channel].assign(1, mRuleOrder.size());
+    for(auto &rules : rulesOfKey)
+    {
+      mRuleOrder.insert(mRuleOrder.end(), rules.begin(), rules.end());
+      mRuleBegin[channel].push_back(mRuleOrder.size());
+    }
+
+    if(mTables[channel].Build(keys.data(), keys.size()))
+      return -1;
+  }
+
+  printf("CanGateway: %d rules\n", mNumRules);
+  return 0;
+}
+
+unsigned int CanGateway::Forward(const unsigned int source, const CanFrame &frame,
+  const unsigned long long readNs)
+{
+  if(frame.mType & CanFrameType::kStatus)
+    return 0;
+
+  auto index = mTables[source].Find(CanIdTable::Key(frame.mId, frame.mType));
+  if(index < 0)
+    return 0;
+
+  auto &ruleBegin = mRuleBegin[source];
+  auto written{0u};
+  for(auto i = ruleBegin[index]; i < ruleBegin[index + 1]; ++i)
+  {
+    auto rule = mRuleOrder[i];
+    auto &route = mRules[rule];
+    auto &counters = mCounters[rule];
+
+    auto out = frame;
+    if(route.mOutId != CanRoute::kKeepId)
+    {
+      out.mId = route.mOutId;
+      out.mType = route.mOutType;
+    }
+
+    if(mWriters[route.mDestination](mWriterContexts[route.mDestination], out))
+    {
+      ++counters.mTxFull;
+      continue;
+    }
+
+    auto latencyNs = mClock() - readNs;
+    ++counters.mForwarded;
+    counters.mTotalLatencyNs += latencyNs;
+    ++counters.mLatencySamples;
+    if(latencyNs > counters.mMaxLatencyNs)
+      counters.mMaxLatencyNs = latencyNs;
+    ++written;
+  }
+  return written;
+}
+
+void CanGateway::PrintStats(const unsigned int source, const char *name,
+  const unsigned long long elapsedNs, int (*print)(const char*, ...))
+{
+  for(auto rule{0u}; rule < mNumRules; ++rule)
+  {
+    auto &route = mRules[rule];
+    if(route.mSource != source)
+      continue;
+
+    auto &counters = mCounters[rule];
+    auto forwarded = counters.mForwarded - counters.mForwardedAtLastPrint;
+    print("%s: route 0x%08x -> channel %d 0x%08x: %llu frames/s, latency avg/max: "
+      "%llu/%llu ns, forwarded: %llu, tx full: %llu\n",
+      name, CanIdTable::Key(route.mId, route.mType), route.mDestination,
+      (route.mOutId == CanRoute::kKeepId) ? CanIdTable::Key(route.mId, route.mType) :
+        CanIdTable::Key(route.mOutId, route.mOutType),
+      elapsedNs ? forwarded * 1000000000ull / elapsedNs : 0ull,
+      counters.mLatencySamples ? counters.mTotalLatencyNs / counters.mLatencySamples : 0ull,
+      counters.mMaxLatencyNs, counters.mForwarded, counters.mTxFull);
+
+    counters.mForwardedAtLastPrint = counters.mForwarded;
+    counters.mMaxLatencyNs = 0;
+    counters.mTotalLatencyNs = 0;
+    counters.mLatencySamples = 0;
+  }
+}
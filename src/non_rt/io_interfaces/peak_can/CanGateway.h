@@ -0,0 +1,102 @@
+#ifndef _CANGATEWAY_H_
+#define _CANGATEWAY_H_
+
+#include <limits.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include <vector>
+
+#include <CanIdTable.h>
+#include <CanTypes.h>
+
+namespace CanRoute
+{
+constexpr auto kMaxChannels = 8u;
+constexpr auto kMaxRules = 256u;
+constexpr uint32_t kKeepId = 0xffffffffu;
+}
+
+// sends a frame on a channel without blocking, 0 when the frame was queued
+typedef int (*CanWriter)(void *context, const CanFrame &frame);
+
+/*
+ * forward mId/mType received on mSource to mDestination, as mOutId/mOutType
+ * unless mOutId is kKeepId
+ */
+struct CanGatewayRule
+{
+  unsigned int mSource;
+  uint32_t mId;
+  uint8_t mType;
+  unsigned int mDestination;
+  uint32_t mOutId;
+  uint8_t mOutType;
+};
+
+/*
+ * counters of one rule, written only by the reader of its source channel
+ * the latency is read to write done and covers the window since the last PrintStats()
+ */
+struct CanGatewayCounters
+{
+  unsigned long long mForwarded;
+  unsigned long long mTxFull;
+  unsigned long long mForwardedAtLastPrint;
+  unsigned long long mMaxLatencyNs;
+  unsigned long long mTotalLatencyNs;
+  unsigned long long mLatencySamples;
+};
+
+/*
+ * rx to tx routing between can channels
+ *
+ * the reader of each channel calls Forward() on every frame it drains, before the
+ * frame goes anywhere else, and the matching rules write it out to their destination
+ * right away. there is no queue in between: the latency is bounded by the read batch
+ * of the source plus one non-blocking driver write per rule, and a full destination
+ * queue drops the frame and counts it against the rule.
+ *
+ * every source channel gets its own id table, so the lookup is the same collision free
+ * hash as the receive path, and one id can fan out to several rules.
+ * AddRule(), SetWriter() and Build() must be called before the readers start.
+ */
+class CanGateway
+{
+private:
+  CanGatewayRule mRules[CanRoute::kMaxRules];
+  CanGatewayCounters mCounters[CanRoute::kMaxRules];
+  unsigned int mNumRules;
+
+  CanWriter mWriters[CanRoute::kMaxChannels];
+  void *mWriterContexts[CanRoute::kMaxChannels];
+
+  // rules of id i of channel c are mRuleOrder[mRuleBegin[c][i] .. mRuleBegin[c][i + 1])
+  CanIdTable mTables[CanRoute::kMaxChannels];
+  std::vector<unsigned int> mRuleBegin[CanRoute::kMaxChannels];
+  std::vector<uint16_t> mRuleOrder;
+
+  unsigned long long (*mClock)();
+
+public:
+  explicit CanGateway(unsigned long long (*clock)());
+
+  CanGateway(const CanGateway&) = delete;
+  CanGateway& operator=(const CanGateway&) = delete;
+
+  int AddRule(const CanGatewayRule &rule);
+  int SetWriter(const unsigned int channel, CanWriter writer, void *context);
+  int Build();
+
+  // reader side of the source channel, returns the number of frames written
+  unsigned int Forward(const unsigned int source, const CanFrame &frame,
+    const unsigned long long readNs);
+  void PrintStats(const unsigned int source, const char *name,
+    const unsigned long long elapsedNs, int (*print)(const char*, ...)=printf);
+
+  unsigned int NumRules() const { return mNumRules; }
+  const CanGatewayRule& Rule(const unsigned int rule) const { return mRules[rule]; }
+  const CanGatewayCounters& Counters(const unsigned int rule) const { return mCounters[rule]; }
+};
+
+#endif // _CANGATEWAY_H_
@@ -0,0 +1,79 @@
+#include <CanIdTable.h>
+
+#include <stdio.h>
+
+CanIdTable::CanIdTable()
+{
+  Clear();
+}
+
+void CanIdTable::Clear()
+{
+  mMultiplier = 0;
+  mShift = 31;
+  mBits = 1;
+  mKeys[0] = mKeys[1] = CanHash::kEmptyKey;
+}
+
+int CanIdTable::Build(const uint32_t *keys, const unsigned int numKeys)
+{
+  if(numKeys > CanHash::kMaxKeys)
+  {
+    printf("CanIdTable: no more than %d ids\n", CanHash::kMaxKeys);
+    return -1;
+  }
+
+  // start at a load factor of at most one half
+  auto bits{1u};
+  while((1u << bits) < 2 * numKeys)
+  {
+    ++bits;
+  }
+
+  for(; bits <= CanHash::kMaxTableBits; ++bits)
+  {
+    const auto size = 1u << bits;
+    uint32_t seed = 0x9e3779b9u;
+    for(auto attempt{0u}; attempt < CanHash::kMultiplierAttempts; ++attempt)
+    {
+      // odd multipliers from a xorshift sequence
+      seed ^= seed << 13;
+      seed ^= seed >> 17;
+      seed ^= seed << 5;
+      const auto multiplier = seed | 1u;
+      const auto shift = 32u - bits;
+
+      for(auto slot{0u}; slot < size; ++slot)
+      {
+        mKeys[slot] = CanHash::kEmptyKey;
+      }
+
+      auto collision{false};
+      for(auto i{0u}; i < numKeys && !collision; ++i)
+      {
+        auto slot = (keys[i] * multiplier) >> shift;
+        if(mKeys[slot] == keys[i])
+        {
+          printf("CanIdTable: id 0x%08x registered twice\n", keys[i]);
+          Clear();
+          return -1;
+        }
+        collision = mKeys[slot] != CanHash::kEmptyKey;
+        mKeys[slot] = keys[i];
+        mIndices[slot] = i;
+      }
+
+      if(!collision)
+      {
+        mMultiplier = multiplier;
+        mShift = shift;
+        mBits = bits;
+        return 0;
+      }
+    }
+  }
+
+  printf("CanIdTable: no collision free table for %d ids\n", numKeys);
+  Clear();
+  return -1;
+}
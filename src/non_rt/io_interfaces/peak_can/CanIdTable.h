@@ -0,0 +1,55 @@
+#ifndef _CANIDTABLE_H_
+#define _CANIDTABLE_H_
+
+#include <stdint.h>
+
+#include <CanTypes.h>
+
+namespace CanHash
+{
+constexpr auto kMaxKeys = 256u;
+constexpr auto kMaxTableBits = 12u;
+constexpr auto kMultiplierAttempts = 4096u;
+constexpr uint32_t kEmptyKey = 0xffffffffu; // never a valid id, see Key()
+}
+
+/*
+ * collision free hash from can ids to dense indices, built once before the rt loop
+ *
+ * Build() searches for a multiplier that sends every registered key to its own slot
+ * of a power of two table, so Find() is one multiply, one shift and one compare with
+ * no probing, whatever the id mix
+ */
+class CanIdTable
+{
+private:
+  uint32_t mKeys[1u << CanHash::kMaxTableBits];
+  int16_t mIndices[1u << CanHash::kMaxTableBits];
+  uint32_t mMultiplier;
+  unsigned int mShift;
+  unsigned int mBits;
+
+  void Clear();
+
+public:
+  CanIdTable();
+
+  // keys[i] is found as index i
+  int Build(const uint32_t *keys, const unsigned int numKeys);
+
+  int Find(const uint32_t key) const
+  {
+    auto slot = (key * mMultiplier) >> mShift;
+    return (mKeys[slot] == key) ? mIndices[slot] : -1;
+  }
+
+  unsigned int TableSize() const { return 1u << mBits; }
+
+  // standard and extended frames with the same number are different ids
+  static uint32_t Key(const uint32_t id, const uint8_t type)
+  {
+    return (type & CanFrameType::kExtended) ? (id | 0x80000000u) : id;
+  }
+};
+
+#endif // _CANIDTABLE_H_
@@ -0,0 +1,191 @@
+#include <CanReceiveEngine.h>
+
+CanReceiveEngine::CanReceiveEngine()
+  : mNumIds(0)
+  , mOffsetNs(0)
+  , mWindowOffsetNs(LLONG_MAX)
+  , mDriftNs(0)
+  , mWindowStartNs(0)
+  , mSynced(false)
+  , mUnknownFrames(0)
+  , mStatusFrames(0)
+  , mReadErrors(0)
+  , mWakes(0)
+  , mMaxBatch(0)
+  , mMaxLatencyNs(0)
+  , mTotalLatencyNs(0)
+  , mLatencySamples(0)
+{}
+
+int CanReceiveEngine::Register(const uint32_t id, const uint8_t type, CanDecoder decoder,
+  void *context)
+{
+  if(mNumIds == CanReceive::kMaxIds)
+  {
+    printf("CanReceiveEngine: no more than %d ids\n", CanReceive::kMaxIds);
+    return -1;
+  }
+
+  auto index = mNumIds;
+  mRegistrations[index] = CanRxRegistration{CanIdTable::Key(id, type), decoder, context};
+
+  auto &counters = mCounters[index];
+  counters.mFrames = 0;
+  counters.mOverflows = 0;
+  counters.mFramesAtLastPrint = 0;
+  counters.mLastDriverUs = 0;
+  counters.mMinIntervalUs = ULLONG_MAX;
+  counters.mMaxIntervalUs = 0;
+  counters.mDispatched.store(0);
+
+  ++mNumIds;
+  return index;
+}
+
+int CanReceiveEngine::Build()
+{
+  uint32_t keys[CanReceive::kMaxIds];
+  for(auto i{0u}; i < mNumIds; ++i)
+  {
+    keys[i] = mRegistrations[i].mKey;
+  }
+
+  if(mTable.Build(keys, mNumIds))
+    return -1;
+  printf("CanReceiveEngine: %d ids in a %d slot table\n", mNumIds, mTable.TableSize());
+  return 0;
+}
+
+void CanReceiveEngine::Synchronize(const CanFrame &frame, const unsigned long long readNs)
+{
+  auto offsetNs = static_cast<long long>(readNs) - static_cast<long long>(frame.mDriverUs * 1000ull);
+  if(!mSynced)
+  {
+    mOffsetNs = offsetNs;
+    mWindowStartNs = readNs;
+    mSynced = true;
+  }
+
+  if(offsetNs < mWindowOffsetNs)
+    mWindowOffsetNs = offsetNs;
+  // a smaller offset is a frame read sooner after reception, use it right away
+  if(offsetNs < mOffsetNs)
+    mOffsetNs = offsetNs;
+
+  if(readNs - mWindowStartNs > CanReceive::kSyncWindowNs)
+  {
+    mDriftNs = mWindowOffsetNs - mOffsetNs;
+    mOffsetNs = mWindowOffsetNs;
+    mWindowOffsetNs = LLONG_MAX;
+    mWindowStartNs = readNs;
+  }
+}
+
+unsigned long long CanReceiveEngine::ToHostNs(const unsigned long long driverUs) const
+{
+  return static_cast<unsigned long long>(static_cast<long long>(driverUs * 1000ull) + mOffsetNs);
+}
+
+void CanReceiveEngine::Receive(CanFrame &frame, const unsigned long long readNs)
+{
+  if(frame.mType & CanFrameType::kStatus)
+  {
+    ++mStatusFrames;
+    return;
+  }
+
+  auto index = mTable.Find(CanIdTable::Key(frame.mId, frame.mType));
+  if(index < 0)
+  {
+    ++mUnknownFrames;
+    return;
+  }
+
+  Synchronize(frame, readNs);
+  frame.mHostNs = ToHostNs(frame.mDriverUs);
+
+  auto latencyNs = readNs > frame.mHostNs ? readNs - frame.mHostNs : 0ull;
+  mTotalLatencyNs += latencyNs;
+  ++mLatencySamples;
+  if(latencyNs > mMaxLatencyNs)
+    mMaxLatencyNs = latencyNs;
+
+  auto &counters = mCounters[index];
+  if(counters.mFrames > 0)
+  {
+    auto intervalUs = frame.mDriverUs - counters.mLastDriverUs;
+    if(intervalUs < counters.mMinIntervalUs)
+      counters.mMinIntervalUs = intervalUs;
+    if(intervalUs > counters.mMaxIntervalUs)
+      counters.mMaxIntervalUs = intervalUs;
+  }
+  counters.mLastDriverUs = frame.mDriverUs;
+  ++counters.mFrames;
+
+  if(!mRing.Push(CanRxEvent{index, frame}))
+    ++counters.mOverflows;
+}
+
+void CanReceiveEngine::EndBatch(const unsigned int numFrames)
+{
+  ++mWakes;
+  if(numFrames > mMaxBatch)
+    mMaxBatch = numFrames;
+}
+
+unsigned int CanReceiveEngine::Dispatch(const unsigned int maxFrames)
+{
+  auto dispatched{0u};
+  while(dispatched < maxFrames)
+  {
+    auto batch = maxFrames - dispatched;
+    if(batch > CanReceive::kMaxBatch)
+      batch = CanReceive::kMaxBatch;
+
+    auto numEvents = mRing.PopBatch(mDispatchEvents, batch);
+    for(auto i{0u}; i < numEvents; ++i)
+    {
+      auto &event = mDispatchEvents[i];
+      auto &registration = mRegistrations[event.mIndex];
+      registration.mDecoder(registration.mContext, event.mFrame);
+      mCounters[event.mIndex].mDispatched.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    dispatched += numEvents;
+    if(numEvents < batch)
+      break;
+  }
+  return dispatched;
+}
+
+void CanReceiveEngine::PrintStats(const char *name, const unsigned long long elapsedNs,
+  int (*print)(const char*, ...))
+{
+  print("%s: wakes: %llu, max frames per wake: %llu, unknown: %llu, status: %llu, "
+    "read errors: %llu, read latency avg/max: %llu/%llu ns, clock drift: %lld ns\n",
+    name, mWakes, mMaxBatch, mUnknownFrames, mStatusFrames, mReadErrors,
+    mLatencySamples ? mTotalLatencyNs / mLatencySamples : 0ull, mMaxLatencyNs,
+    mDriftNs);
+
+  for(auto i{0u}; i < mNumIds; ++i)
+  {
+    auto &counters = mCounters[i];
+    auto frames = counters.mFrames - counters.mFramesAtLastPrint;
+    print("  0x%08x: %llu frames/s, interval min/max: %llu/%llu us, frames: %llu, "
+      "dispatched: %llu, overflows: %llu\n",
+      mRegistrations[i].mKey,
+      elapsedNs ? frames * 1000000000ull / elapsedNs : 0ull,
+      frames ? counters.mMinIntervalUs : 0ull, counters.mMaxIntervalUs,
+      counters.mFrames, counters.mDispatched.load(std::memory_order_relaxed),
+      counters.mOverflows);
+
+    counters.mFramesAtLastPrint = counters.mFrames;
+    counters.mMinIntervalUs = ULLONG_MAX;
+    counters.mMaxIntervalUs = 0;
+  }
+
+  mMaxBatch = 0;
+  mMaxLatencyNs = 0;
+  mTotalLatencyNs = 0;
+  mLatencySamples = 0;
+}
@@ -0,0 +1,121 @@
+#ifndef _CANRECEIVEENGINE_H_
+#define _CANRECEIVEENGINE_H_
+
+#include <limits.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include <atomic>
+
+#include <CanIdTable.h>
+#include <CanTypes.h>
+#include <RtSpscRing.h>
+
+namespace CanReceive
+{
+constexpr auto kMaxIds = CanHash::kMaxKeys;
+constexpr auto kRingSize = 4096u;
+constexpr auto kMaxBatch = 256u;
+constexpr auto kSyncWindowNs = 1000000000ull;
+}
+
+typedef void (*CanDecoder)(void *context, const CanFrame &frame);
+
+struct CanRxRegistration
+{
+  uint32_t mKey;
+  CanDecoder mDecoder;
+  void *mContext;
+};
+
+struct CanRxEvent
+{
+  int mIndex;
+  CanFrame mFrame;
+};
+
+/*
+ * counters of one registered id, written by the reader except mDispatched
+ * the interval and latency figures cover the window since the last PrintStats()
+ */
+struct CanIdCounters
+{
+  unsigned long long mFrames;
+  unsigned long long mOverflows;
+  unsigned long long mFramesAtLastPrint;
+  unsigned long long mLastDriverUs;
+  unsigned long long mMinIntervalUs;
+  unsigned long long mMaxIntervalUs;
+  std::atomic<unsigned long long> mDispatched;
+};
+
+/*
+ * receive side of one can channel
+ *
+ * the reader (whatever drains the driver) hands every frame to Receive(), which
+ * stamps it on the rt clock, drops ids nobody registered and queues the rest on a
+ * lock-free ring. the consumer calls Dispatch() at its own pace and the registered
+ * decoders run in its context. a full ring drops the newest frame and counts an
+ * overflow against its id rather than blocking the reader.
+ *
+ * driver timestamps are mapped to the rt clock with the smallest read minus driver
+ * offset seen over the last window: the frame read with the least delay is the best
+ * estimate of the fixed offset, and renewing it every window follows the drift
+ * between the two clocks.
+ *
+ * Register() and Build() must be called before the reader and consumer start.
+ */
+class CanReceiveEngine
+{
+private:
+  CanIdTable mTable;
+  CanRxRegistration mRegistrations[CanReceive::kMaxIds];
+  CanIdCounters mCounters[CanReceive::kMaxIds];
+  unsigned int mNumIds;
+
+  RtSpscRing<CanRxEvent, CanReceive::kRingSize> mRing;
+  CanRxEvent mDispatchEvents[CanReceive::kMaxBatch];
+
+  // reader side
+  long long mOffsetNs;
+  long long mWindowOffsetNs;
+  long long mDriftNs;
+  unsigned long long mWindowStartNs;
+  bool mSynced;
+
+  unsigned long long mUnknownFrames;
+  unsigned long long mStatusFrames;
+  unsigned long long mReadErrors;
+  unsigned long long mWakes;
+  unsigned long long mMaxBatch;
+  unsigned long long mMaxLatencyNs;
+  unsigned long long mTotalLatencyNs;
+  unsigned long long mLatencySamples;
+
+  void Synchronize(const CanFrame &frame, const unsigned long long readNs);
+
+public:
+  CanReceiveEngine();
+
+  CanReceiveEngine(const CanReceiveEngine&) = delete;
+  CanReceiveEngine& operator=(const CanReceiveEngine&) = delete;
+
+  int Register(const uint32_t id, const uint8_t type, CanDecoder decoder, void *context);
+  int Build();
+
+  // reader side
+  void Receive(CanFrame &frame, const unsigned long long readNs);
+  void EndBatch(const unsigned int numFrames);
+  void RecordError() { ++mReadErrors; }
+  unsigned long long ToHostNs(const unsigned long long driverUs) const;
+  void PrintStats(const char *name, const unsigned long long elapsedNs,
+    int (*print)(const char*, ...)=printf);
+
+  // consumer side
+  unsigned int Dispatch(const unsigned int maxFrames=CanReceive::kRingSize);
+
+  unsigned int NumIds() const { return mNumIds; }
+  const CanIdCounters& Counters(const unsigned int index) const { return mCounters[index]; }
+};
+
+#endif // _CANRECEIVEENGINE_H_
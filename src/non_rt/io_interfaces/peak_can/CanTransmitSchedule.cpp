@@ -0,0 +1,355 @@
+#include <CanTransmitSchedule.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+
+namespace {
+
+unsigned long Gcd(unsigned long a, unsigned long b)
+{
+  while(b)
+  {
+    auto r = a % b;
+    a = b;
+    b = r;
+  }
+  return a;
+}
+
+} // namespace
+
+CanTransmitSchedule::CanTransmitSchedule()
+  : mSlotBegin(2, 0)
+  , mTickUs(0)
+  , mNumSlots(1)
+  , mTxFifoDepth(CanSchedule::kDefaultTxFifoDepth)
+  , mMaxSlotFrames(0)
+  , mMaxSlotBits(0)
+  , mSentBits(0)
+  , mSentBitsAtLastPrint(0)
+{}
+
+int CanTransmitSchedule::Add(const CanScheduleEntry &entry)
+{
+  if(mEntries.size() == CanSchedule::kMaxEntries)
+  {
+    printf("CanTransmitSchedule: no more than %d entries\n", CanSchedule::kMaxEntries);
+    return -1;
+  }
+  if(entry.mPeriodUs == 0 || entry.mFrame.mLen > CanLimit::kMaxDataLength ||
+    (entry.mOffsetUs != CanSchedule::kAutoOffset &&
+      (entry.mOffsetUs < 0 || static_cast<unsigned long>(entry.mOffsetUs) >= entry.mPeriodUs)))
+  {
+    printf("CanTransmitSchedule: invalid entry for id 0x%x\n", entry.mFrame.mId);
+    return -1;
+  }
+
+  mEntries.push_back(entry);
+  return mEntries.size() - 1;
+}
+
+int CanTransmitSchedule::SetSource(const uint32_t id, const uint8_t type,
+  CanPayloadSource source, void *context)
+{
+  auto found{0};
+  for(auto &entry : mEntries)
+  {
+    if(entry.mFrame.mId == id &&
+      (entry.mFrame.mType & CanFrameType::kExtended) == (type & CanFrameType::kExtended))
+    {
+      entry.mSource = source;
+      entry.mContext = context;
+      ++found;
+    }
+  }
+
+  if(found == 0)
+  {
+    printf("CanTransmitSchedule: id 0x%x is not scheduled\n", id);
+    return -1;
+  }
+  return 0;
+}
+
+/*
+ * one frame per line, '#' starts a comment, numbers may be hex (0x...):
+ *   <id> <period us> <offset us or -1 for auto> <length> [<data byte> ...]
+ * add 0x80000000 to the id for an extended frame
+ */
+int CanTransmitSchedule::Load(const char *path)
+{
+  auto *file = fopen(path, "r");
+  if(!file)
+  {
+    printf("CanTransmitSchedule: could not open schedule %s\n", path);
+    return -1;
+  }
+
+  char line[512];
+  auto lineNum{0u};
+  auto result{0};
+  while(fgets(line, sizeof(line), file))
+  {
+    ++lineNum;
+    auto *comment = strchr(line, '#');
+    if(comment)
+      *comment = '\0';
+
+    char *cursor = line;
+    char *end;
+    auto id = strtoul(cursor, &end, 0);
+    if(end == cursor)
+      continue; // blank line
+    cursor = end;
+
+    CanScheduleEntry entry{};
+    entry.mFrame.mId = id & CanLimit::kMaxExtendedId;
+    entry.mFrame.mType = (id & 0x80000000ul) ? CanFrameType::kExtended : CanFrameType::kStandard;
+    entry.mPeriodUs = strtoul(cursor, &end, 0);
+    cursor = end;
+    entry.mOffsetUs = strtol(cursor, &end, 0);
+    cursor = end;
+    entry.mFrame.mLen = strtoul(cursor, &end, 0);
+    if(end == cursor)
+    {
+      printf("CanTransmitSchedule: %s:%d: expected id, period, offset and length\n",
+        path, lineNum);
+      result = -1;
+      break;
+    }
+    cursor = end;
+
+    for(auto i{0u}; i < entry.mFrame.mLen && i < CanLimit::kMaxDataLength; ++i)
+    {
+      entry.mFrame.mData[i] = strtoul(cursor, &end, 0);
+      cursor = end;
+    }
+
+    if(Add(entry) < 0)
+    {
+      printf("CanTransmitSchedule: %s:%d rejected\n", path, lineNum);
+      result = -1;
+      break;
+    }
+  }
+  fclose(file);
+  return result;
+}
+
+int CanTransmitSchedule::Build(const unsigned long tickUs, const unsigned int txFifoDepth)
+{
+  if(mEntries.empty() || tickUs == 0)
+  {
+    printf("CanTransmitSchedule: nothing to schedule\n");
+    return -1;
+  }
+
+  // everything in ticks
+  std::vector<unsigned long> periods(mEntries.size());
+  unsigned long long hyperperiod{1};
+  for(auto i{0u}; i < mEntries.size(); ++i)
+  {
+    auto &entry = mEntries[i];
+    if(entry.mPeriodUs % tickUs ||
+      (entry.mOffsetUs != CanSchedule::kAutoOffset && entry.mOffsetUs % tickUs))
+    {
+      printf("CanTransmitSchedule: id 0x%x is not aligned to the %lu us tick\n",
+        entry.mFrame.mId, tickUs);
+      return -1;
+    }
+    periods[i] = entry.mPeriodUs / tickUs;
+    hyperperiod = hyperperiod / Gcd(hyperperiod, periods[i]) * periods[i];
+    if(hyperperiod > CanSchedule::kMaxSlots)
+    {
+      printf("CanTransmitSchedule: hyperperiod exceeds %d ticks\n", CanSchedule::kMaxSlots);
+      return -1;
+    }
+  }
+  const auto numSlots = static_cast<unsigned int>(hyperperiod);
+
+  // fixed offsets first, then the automatic ones from the shortest period up, as
+  // they have the least room to move
+  std::vector<unsigned int> order(mEntries.size());
+  for(auto i{0u}; i < order.size(); ++i)
+  {
+    order[i] = i;
+  }
+  std::stable_sort(order.begin(), order.end(), [&](unsigned int a, unsigned int b)
+  {
+    auto fixedA = mEntries[a].mOffsetUs != CanSchedule::kAutoOffset;
+    auto fixedB = mEntries[b].mOffsetUs != CanSchedule::kAutoOffset;
+    if(fixedA != fixedB)
+      return fixedA;
+    return periods[a] < periods[b];
+  });
+
+  std::vector<unsigned int> slotFrames(numSlots, 0);
+  std::vector<unsigned long long> slotBits(numSlots, 0);
+  std::vector<unsigned long> offsets(mEntries.size());
+  for(auto i : order)
+  {
+    auto &entry = mEntries[i];
+    auto period = periods[i];
+    auto bits = FrameBits(entry.mFrame);
+
+    auto bestOffset = 0ul;
+    if(entry.mOffsetUs != CanSchedule::kAutoOffset)
+    {
+      bestOffset = entry.mOffsetUs / tickUs;
+    }
+    else
+    {
+      auto bestFrames = UINT_MAX;
+      auto bestBits = ULLONG_MAX;
+      for(auto offset{0ul}; offset < period; ++offset)
+      {
+        auto frames{0u};
+        auto maxBits{0ull};
+        for(auto slot = offset; slot < numSlots; slot += period)
+        {
+          frames = std::max(frames, slotFrames[slot]);
+          maxBits = std::max(maxBits, slotBits[slot]);
+        }
+        if(frames < bestFrames || (frames == bestFrames && maxBits < bestBits))
+        {
+          bestFrames = frames;
+          bestBits = maxBits;
+          bestOffset = offset;
+        }
+      }
+    }
+
+    offsets[i] = bestOffset;
+    for(auto slot = bestOffset; slot < numSlots; slot += period)
+    {
+      ++slotFrames[slot];
+      slotBits[slot] += bits;
+    }
+  }
+
+  mMaxSlotFrames = *std::max_element(slotFrames.begin(), slotFrames.end());
+  mMaxSlotBits = *std::max_element(slotBits.begin(), slotBits.end());
+  if(mMaxSlotFrames > txFifoDepth)
+  {
+    printf("CanTransmitSchedule: %d frames share a tick, the tx fifo holds %d\n",
+      mMaxSlotFrames, txFifoDepth);
+    return -1;
+  }
+
+  // flatten into per slot lists, in entry order within a slot
+  mSlotBegin.assign(numSlots + 1, 0);
+  for(auto slot{0u}; slot < numSlots; ++slot)
+  {
+    mSlotBegin[slot + 1] = mSlotBegin[slot] + slotFrames[slot];
+  }
+  mSlotEntries.assign(mSlotBegin[numSlots], 0);
+  std::vector<unsigned int> fill(mSlotBegin.begin(), mSlotBegin.end() - 1);
+  for(auto i{0u}; i < mEntries.size(); ++i)
+  {
+    for(auto slot = offsets[i]; slot < numSlots; slot += periods[i])
+    {
+      mSlotEntries[fill[slot]++] = i;
+    }
+  }
+
+  // the chosen phases become the configured ones
+  for(auto i{0u}; i < mEntries.size(); ++i)
+  {
+    mEntries[i].mOffsetUs = offsets[i] * tickUs;
+  }
+
+  mCounters.assign(mEntries.size(), CanScheduleCounters{0, 0, 0, LLONG_MAX, LLONG_MIN});
+  mTickUs = tickUs;
+  mNumSlots = numSlots;
+  mTxFifoDepth = txFifoDepth;
+  return 0;
+}
+
+CanFrame& CanTransmitSchedule::Prepare(const uint16_t entry)
+{
+  auto &scheduled = mEntries[entry];
+  if(scheduled.mSource)
+    scheduled.mSource(scheduled.mContext, scheduled.mFrame);
+  return scheduled.mFrame;
+}
+
+void CanTransmitSchedule::RecordSend(const uint16_t entry, const unsigned long long sendNs,
+  const bool sent)
+{
+  auto &counters = mCounters[entry];
+  if(!sent)
+  {
+    ++counters.mTxFull;
+    return;
+  }
+
+  if(counters.mSent > 0)
+  {
+    auto jitterNs = static_cast<long long>(sendNs - counters.mLastSendNs) -
+      static_cast<long long>(mEntries[entry].mPeriodUs * 1000ull);
+    if(jitterNs < counters.mMinJitterNs)
+      counters.mMinJitterNs = jitterNs;
+    if(jitterNs > counters.mMaxJitterNs)
+      counters.mMaxJitterNs = jitterNs;
+  }
+  counters.mLastSendNs = sendNs;
+  ++counters.mSent;
+  mSentBits += FrameBits(mEntries[entry].mFrame);
+}
+
+unsigned int CanTransmitSchedule::FrameBits(const CanFrame &frame)
+{
+  // 34 (standard) or 54 (extended) bits are exposed to stuffing besides the data
+  const auto stuffed = ((frame.mType & CanFrameType::kExtended) ? 54u : 34u) + 8u * frame.mLen;
+  return stuffed + 13u + (stuffed - 1u) / 4u;
+}
+
+double CanTransmitSchedule::EstimateBusLoad(const unsigned int bitRate) const
+{
+  auto bitsPerSecond{0.};
+  for(auto &entry : mEntries)
+  {
+    bitsPerSecond += FrameBits(entry.mFrame) * 1e6 / entry.mPeriodUs;
+  }
+  return bitsPerSecond / bitRate;
+}
+
+void CanTransmitSchedule::PrintSchedule(const unsigned int bitRate) const
+{
+  auto tickBits = static_cast<double>(bitRate) * mTickUs / 1e6;
+  printf("CanTransmitSchedule: %lu entries, %d slots of %lu us, worst slot %d frames "
+    "(%llu bits, %.0f %% of a tick), estimated bus load %.1f %%\n",
+    mEntries.size(), mNumSlots, mTickUs, mMaxSlotFrames, mMaxSlotBits,
+    100. * mMaxSlotBits / tickBits, 100. * EstimateBusLoad(bitRate));
+  if(mMaxSlotBits > tickBits)
+    printf("CanTransmitSchedule: warning, the worst slot takes longer than a tick on the bus\n");
+
+  for(auto &entry : mEntries)
+  {
+    printf("  0x%08x: period %lu us, offset %ld us, %d bytes\n", entry.mFrame.mId,
+      entry.mPeriodUs, entry.mOffsetUs, entry.mFrame.mLen);
+  }
+}
+
+void CanTransmitSchedule::PrintStats(const char *name, const unsigned long long elapsedNs,
+  const unsigned int bitRate, int (*print)(const char*, ...))
+{
+  auto bits = mSentBits - mSentBitsAtLastPrint;
+  print("%s: bus load %.1f %% measured, %.1f %% scheduled\n", name,
+    elapsedNs ? 100. * bits * 1e9 / elapsedNs / bitRate : 0.,
+    100. * EstimateBusLoad(bitRate));
+  mSentBitsAtLastPrint = mSentBits;
+
+  for(auto i{0u}; i < mEntries.size(); ++i)
+  {
+    auto &counters = mCounters[i];
+    print("  0x%08x: sent: %llu, tx full: %llu, jitter min/max: %lld/%lld ns\n",
+      mEntries[i].mFrame.mId, counters.mSent, counters.mTxFull,
+      counters.mMinJitterNs == LLONG_MAX ? 0ll : counters.mMinJitterNs,
+      counters.mMaxJitterNs == LLONG_MIN ? 0ll : counters.mMaxJitterNs);
+    counters.mMinJitterNs = LLONG_MAX;
+    counters.mMaxJitterNs = LLONG_MIN;
+  }
+}
@@ -0,0 +1,111 @@
+#ifndef _CANTRANSMITSCHEDULE_H_
+#define _CANTRANSMITSCHEDULE_H_
+
+#include <limits.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include <vector>
+
+#include <CanTypes.h>
+
+namespace CanSchedule
+{
+constexpr auto kMaxEntries = 256u;
+constexpr auto kMaxSlots = 10000u;
+constexpr auto kAutoOffset = -1l;
+constexpr auto kDefaultTxFifoDepth = 4u;
+}
+
+// fills the payload of a scheduled frame right before it is sent
+typedef void (*CanPayloadSource)(void *context, CanFrame &frame);
+
+/*
+ * one periodic frame of the rest-bus simulation
+ * mPeriodUs and mOffsetUs must be multiples of the base tick
+ */
+struct CanScheduleEntry
+{
+  CanFrame mFrame;
+  unsigned long mPeriodUs;
+  long mOffsetUs;
+  CanPayloadSource mSource;
+  void *mContext;
+};
+
+/*
+ * send statistics of one entry, the jitter is the deviation of the interval between
+ * two sends from the period, over the window since the last PrintStats()
+ */
+struct CanScheduleCounters
+{
+  unsigned long long mSent;
+  unsigned long long mTxFull;
+  unsigned long long mLastSendNs;
+  long long mMinJitterNs;
+  long long mMaxJitterNs;
+};
+
+/*
+ * precomputed time-triggered transmit table
+ *
+ * Build() turns every entry into ticks, takes the hyperperiod (lcm of all periods)
+ * and lays the frames out over its slots, so the rt task only walks the list of the
+ * current slot. entries with kAutoOffset get the phase that keeps the busiest slot
+ * they land in as empty as possible, shortest periods first. Build() fails when a
+ * slot needs more frames than the controller tx fifo holds, since the extra frames
+ * would wait a tick or be dropped.
+ */
+class CanTransmitSchedule
+{
+private:
+  std::vector<CanScheduleEntry> mEntries;
+  std::vector<CanScheduleCounters> mCounters;
+
+  // entries of slot s are mSlotEntries[mSlotBegin[s] .. mSlotBegin[s + 1])
+  std::vector<unsigned int> mSlotBegin;
+  std::vector<uint16_t> mSlotEntries;
+
+  unsigned long mTickUs;
+  unsigned int mNumSlots;
+  unsigned int mTxFifoDepth;
+  unsigned int mMaxSlotFrames;
+  unsigned long long mMaxSlotBits;
+
+  unsigned long long mSentBits;
+  unsigned long long mSentBitsAtLastPrint;
+
+public:
+  CanTransmitSchedule();
+
+  int Add(const CanScheduleEntry &entry);
+  int SetSource(const uint32_t id, const uint8_t type, CanPayloadSource source, void *context);
+  int Load(const char *path);
+  int Build(const unsigned long tickUs,
+    const unsigned int txFifoDepth=CanSchedule::kDefaultTxFifoDepth);
+
+  // rt side
+  unsigned int Slot(const unsigned long long tick, const uint16_t **entries) const
+  {
+    auto slot = tick % mNumSlots;
+    *entries = mSlotEntries.data() + mSlotBegin[slot];
+    return mSlotBegin[slot + 1] - mSlotBegin[slot];
+  }
+  CanFrame& Prepare(const uint16_t entry);
+  void RecordSend(const uint16_t entry, const unsigned long long sendNs, const bool sent);
+
+  double EstimateBusLoad(const unsigned int bitRate) const;
+  void PrintSchedule(const unsigned int bitRate) const;
+  void PrintStats(const char *name, const unsigned long long elapsedNs,
+    const unsigned int bitRate, int (*print)(const char*, ...)=printf);
+
+  unsigned int NumEntries() const { return mEntries.size(); }
+  unsigned int NumSlots() const { return mNumSlots; }
+  const CanScheduleEntry& Entry(const unsigned int entry) const { return mEntries[entry]; }
+  const CanScheduleCounters& Counters(const unsigned int entry) const { return mCounters[entry]; }
+
+  // worst case length of a classic frame on the wire, stuff bits included
+  static unsigned int FrameBits(const CanFrame &frame);
+};
+
+#endif // _CANTRANSMITSCHEDULE_H_
@@ -0,0 +1,42 @@
+#ifndef _CANTYPES_H_
+#define _CANTYPES_H_
+
+#include <stdint.h>
+
+namespace CanLimit
+{
+constexpr auto kMaxDataLength = 8u;
+constexpr auto kMaxFdDataLength = 64u;
+constexpr auto kMaxStandardId = 0x7ffu;
+constexpr auto kMaxExtendedId = 0x1fffffffu;
+}
+
+// same bit values as the libpcan MSGTYPE_* flags, except the can fd ones which the
+// fd devices translate
+namespace CanFrameType
+{
+constexpr uint8_t kStandard = 0x00;
+constexpr uint8_t kRtr = 0x01;
+constexpr uint8_t kExtended = 0x02;
+constexpr uint8_t kSelfReceive = 0x04;
+constexpr uint8_t kFd = 0x10;
+constexpr uint8_t kBitRateSwitch = 0x20; // data phase at the data bit rate, fd only
+constexpr uint8_t kStatus = 0x80;
+}
+
+/*
+ * one received or transmitted frame, independent of the driver it came through
+ * mLen is the payload length in bytes, up to 8 for classic and 64 for fd frames
+ * mDriverUs is the controller timestamp, mHostNs the same instant on the rt clock
+ */
+struct CanFrame
+{
+  uint32_t mId;
+  uint8_t mType;
+  uint8_t mLen;
+  uint8_t mData[CanLimit::kMaxFdDataLength];
+  unsigned long long mDriverUs;
+  unsigned long long mHostNs;
+};
+
+#endif // _CANTYPES_H_
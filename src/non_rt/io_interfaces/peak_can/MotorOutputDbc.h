@@ -0,0 +1,128 @@
+#ifndef _MOTOROUTPUTDBC_H_
+#define _MOTOROUTPUTDBC_H_
+
+// generated by scripts/dbc_codegen.py from motor_output.dbc, do not edit
+
+#include <stdint.h>
+
+#include <CanCodec.h>
+#include <CanTypes.h>
+
+namespace MotorOutputDbc
+{
+
+struct MotorCurrents
+{
+  static constexpr uint32_t kId = 0x200;
+  static constexpr uint8_t kType = CanFrameType::kStandard;
+  static constexpr uint8_t kLength = 6;
+
+  float mCurrentU; // A
+  float mCurrentV; // A
+  float mCurrentW; // A
+
+  static constexpr uint64_t Pack(const MotorCurrents &message)
+  {
+    uint64_t intel{0};
+    intel |= (static_cast<uint64_t>(CanCodec::Encode(message.mCurrentU, 0.0, 100.0, -30000.0, 30000.0)) & 0xffffull) << 0;
+    intel |= (static_cast<uint64_t>(CanCodec::Encode(message.mCurrentV, 0.0, 100.0, -30000.0, 30000.0)) & 0xffffull) << 16;
+    intel |= (static_cast<uint64_t>(CanCodec::Encode(message.mCurrentW, 0.0, 100.0, -30000.0, 30000.0)) & 0xffffull) << 32;
+    return intel;
+  }
+
+  static constexpr MotorCurrents Unpack(const uint64_t payload)
+  {
+    MotorCurrents message{};
+    message.mCurrentU = static_cast<float>(CanCodec::SignExtend(((payload >> 0) & 0xffffull), 16) * 0.01);
+    message.mCurrentV = static_cast<float>(CanCodec::SignExtend(((payload >> 16) & 0xffffull), 16) * 0.01);
+    message.mCurrentW = static_cast<float>(CanCodec::SignExtend(((payload >> 32) & 0xffffull), 16) * 0.01);
+    return message;
+  }
+};
+
+struct MotorState
+{
+  static constexpr uint32_t kId = 0x201;
+  static constexpr uint8_t kType = CanFrameType::kStandard;
+  static constexpr uint8_t kLength = 8;
+
+  float mRotorRPM; // rpm
+  float mRotorDegreeRad; // rad
+  float mOutputTorque; // Nm
+  float mStateCounter;
+
+  static constexpr uint64_t Pack(const MotorState &message)
+  {
+    uint64_t motorola{0};
+    motorola |= (static_cast<uint64_t>(CanCodec::Encode(message.mRotorRPM, 0.0, 2.0, -32000.0, 32000.0)) & 0xffffull) << 48;
+    motorola |= (static_cast<uint64_t>(CanCodec::Encode(message.mRotorDegreeRad, 0.0, 10000.0, 0.0, 62832.0)) & 0xffffull) << 32;
+    motorola |= (static_cast<uint64_t>(CanCodec::Encode(message.mOutputTorque, 0.0, 100.0, -30000.0, 30000.0)) & 0xffffull) << 16;
+    motorola |= (static_cast<uint64_t>(CanCodec::Encode(message.mStateCounter, 0.0, 1.0, 0.0, 15.0)) & 0xfull) << 12;
+    return CanCodec::Swap(motorola);
+  }
+
+  static constexpr MotorState Unpack(const uint64_t payload)
+  {
+    const auto motorola = CanCodec::Swap(payload);
+    MotorState message{};
+    message.mRotorRPM = static_cast<float>(CanCodec::SignExtend(((motorola >> 48) & 0xffffull), 16) * 0.5);
+    message.mRotorDegreeRad = static_cast<float>(static_cast<int64_t>((motorola >> 32) & 0xffffull) * 0.0001);
+    message.mOutputTorque = static_cast<float>(CanCodec::SignExtend(((motorola >> 16) & 0xffffull), 16) * 0.01);
+    message.mStateCounter = static_cast<float>(static_cast<int64_t>((motorola >> 12) & 0xfull));
+    return message;
+  }
+};
+
+struct MotorDiagnostics
+{
+  static constexpr uint32_t kId = 0x19000000;
+  static constexpr uint8_t kType = CanFrameType::kExtended;
+  static constexpr uint8_t kLength = 8;
+
+  uint32_t mDiagMux;
+  float mVoltageQ; // mDiagMux = 0, V
+  float mVoltageD; // mDiagMux = 0, V
+  float mDutyU; // mDiagMux = 1
+  float mDutyV; // mDiagMux = 1
+  float mDutyW; // mDiagMux = 1
+
+  static constexpr uint64_t Pack(const MotorDiagnostics &message)
+  {
+    uint64_t intel{0};
+    intel |= (static_cast<uint64_t>(CanCodec::Encode(message.mDiagMux, 0.0, 1.0, 0.0, 1.0)) & 0xffull) << 0;
+    if(message.mDiagMux == 0)
+    {
+      intel |= (static_cast<uint64_t>(CanCodec::Encode(message.mVoltageQ, 0.0, 50.0, -20000.0, 20000.0)) & 0xffffull) << 8;
+      intel |= (static_cast<uint64_t>(CanCodec::Encode(message.mVoltageD, 0.0, 50.0, -20000.0, 20000.0)) & 0xffffull) << 24;
+    }
+    if(message.mDiagMux == 1)
+    {
+      intel |= (static_cast<uint64_t>(CanCodec::Encode(message.mDutyU, 0.0, 10000.0, 0.0, 10000.0)) & 0xffffull) << 8;
+      intel |= (static_cast<uint64_t>(CanCodec::Encode(message.mDutyV, 0.0, 10000.0, 0.0, 10000.0)) & 0xffffull) << 24;
+      intel |= (static_cast<uint64_t>(CanCodec::Encode(message.mDutyW, 0.0, 10000.0, 0.0, 10000.0)) & 0xffffull) << 40;
+    }
+    return intel;
+  }
+
+  static constexpr MotorDiagnostics Unpack(const uint64_t payload)
+  {
+    MotorDiagnostics message{};
+    message.mDiagMux = static_cast<uint32_t>(static_cast<int64_t>((payload >> 0) & 0xffull));
+    if(message.mDiagMux == 0)
+    {
+      message.mVoltageQ = static_cast<float>(CanCodec::SignExtend(((payload >> 8) & 0xffffull), 16) * 0.02);
+      message.mVoltageD = static_cast<float>(CanCodec::SignExtend(((payload >> 24) & 0xffffull), 16) * 0.02);
+    }
+    if(message.mDiagMux == 1)
+    {
+      message.mDutyU = static_cast<float>(static_cast<int64_t>((payload >> 8) & 0xffffull) * 0.0001);
+      message.mDutyV = static_cast<float>(static_cast<int64_t>((payload >> 24) & 0xffffull) * 0.0001);
+      message.mDutyW = static_cast<float>(static_cast<int64_t>((payload >> 40) & 0xffffull) * 0.0001);
+    }
+    return message;
+  }
+};
+
+} // namespace MotorOutputDbc
+
+#endif // _MOTOROUTPUTDBC_H_
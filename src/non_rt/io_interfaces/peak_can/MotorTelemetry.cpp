@@ -0,0 +1,139 @@
+#include <MotorTelemetry.h>
+
+#include <math.h>
+#include <string.h>
+
+#include <CanCodec.h>
+
+namespace {
+
+void StoreSample(const MotorSample &sample, uint8_t *data)
+{
+  using namespace MotorTelemetry;
+  constexpr auto kInverseCurrent = 1. / kCurrentScale;
+  auto currentU = CanCodec::Encode(sample.mCurrentU, 0., kInverseCurrent, -32768., 32767.);
+  auto currentV = CanCodec::Encode(sample.mCurrentV, 0., kInverseCurrent, -32768., 32767.);
+  // the angle wraps instead of clamping, 2 pi is 0 again
+  auto angle = static_cast<int64_t>(floor(sample.mRotorAngleRad / kAngleScale + 0.5));
+  const int64_t fields[] = {currentU, currentV, angle};
+  for(auto i{0u}; i < 3; ++i)
+  {
+    data[2 * i] = static_cast<uint8_t>(fields[i]);
+    data[2 * i + 1] = static_cast<uint8_t>(fields[i] >> 8);
+  }
+}
+
+MotorSample LoadSample(const uint8_t *data)
+{
+  using namespace MotorTelemetry;
+  auto currentU = static_cast<int16_t>(data[0] | (data[1] << 8));
+  auto currentV = static_cast<int16_t>(data[2] | (data[3] << 8));
+  auto angle = static_cast<uint16_t>(data[4] | (data[5] << 8));
+
+  MotorSample sample;
+  sample.mCurrentU = static_cast<float>(currentU * kCurrentScale);
+  sample.mCurrentV = static_cast<float>(currentV * kCurrentScale);
+  sample.mCurrentW = static_cast<float>(-(currentU + currentV) * kCurrentScale);
+  sample.mRotorAngleRad = static_cast<float>(angle * kAngleScale);
+  return sample;
+}
+
+} // namespace
+
+MotorTelemetryPacker::MotorTelemetryPacker(const uint32_t id, const uint8_t type)
+  : mFrame{}
+  , mSequence(0)
+  , mNumSamples(0)
+  , mFirstUs(0)
+  , mLastUs(0)
+  , mFrames(0)
+  , mSamples(0)
+{
+  mFrame.mId = id;
+  mFrame.mType = type;
+}
+
+bool MotorTelemetryPacker::Add(const MotorSample &sample, const uint32_t timeUs, CanFrame &frame)
+{
+  if(mNumSamples == 0)
+    mFirstUs = timeUs;
+  mLastUs = timeUs;
+  StoreSample(sample,
+    mFrame.mData + MotorTelemetry::kHeaderBytes + mNumSamples * MotorTelemetry::kSampleBytes);
+  ++mSamples;
+  if(++mNumSamples < MotorTelemetry::kMaxSamples)
+    return false;
+  return Flush(frame);
+}
+
+bool MotorTelemetryPacker::Flush(CanFrame &frame)
+{
+  if(mNumSamples == 0)
+    return false;
+
+  // mean spacing of the samples, they are one model step apart
+  auto periodUs = (mNumSamples > 1) ? (mLastUs - mFirstUs) / (mNumSamples - 1) : 0u;
+  if(periodUs > 0xffffu)
+    periodUs = 0xffffu;
+  CanCodec::StorePayload(static_cast<uint64_t>(mSequence) |
+    (static_cast<uint64_t>(mNumSamples) << 8) | (static_cast<uint64_t>(periodUs) << 16) |
+    (static_cast<uint64_t>(mFirstUs) << 32), mFrame);
+
+  // a partial frame is padded up to the next valid fd length
+  const auto length = MotorTelemetry::kHeaderBytes + mNumSamples * MotorTelemetry::kSampleBytes;
+  mFrame.mLen = CanFd::RoundUpLength(length);
+  memset(mFrame.mData + length, 0, mFrame.mLen - length);
+
+  frame = mFrame;
+  ++mSequence;
+  ++mFrames;
+  mNumSamples = 0;
+  return true;
+}
+
+MotorTelemetryUnpacker::MotorTelemetryUnpacker()
+  : mExpectedSequence(0)
+  , mSynchronized(false)
+  , mFrames(0)
+  , mSamples(0)
+  , mLostFrames(0)
+  , mMalformed(0)
+{}
+
+int MotorTelemetryUnpacker::Unpack(const CanFrame &frame, MotorSample *samples, uint32_t *timesUs)
+{
+  const auto header = CanCodec::LoadPayload(frame);
+  const auto sequence = static_cast<uint8_t>(header);
+  const auto numSamples = static_cast<unsigned int>((header >> 8) & 0xff);
+  const auto periodUs = static_cast<uint32_t>((header >> 16) & 0xffff);
+  const auto firstUs = static_cast<uint32_t>(header >> 32);
+  if(frame.mLen < MotorTelemetry::kHeaderBytes || numSamples == 0 ||
+    numSamples > MotorTelemetry::kMaxSamples ||
+    MotorTelemetry::kHeaderBytes + numSamples * MotorTelemetry::kSampleBytes > frame.mLen)
+  {
+    ++mMalformed;
+    return -1;
+  }
+
+  // a gap in the 8 bit sequence is the number of frames lost since the last one
+  if(mSynchronized)
+    mLostFrames += static_cast<uint8_t>(sequence - mExpectedSequence);
+  mExpectedSequence = sequence + 1;
+  mSynchronized = true;
+
+  for(auto i{0u}; i < numSamples; ++i)
+  {
+    samples[i] = LoadSample(
+      frame.mData + MotorTelemetry::kHeaderBytes + i * MotorTelemetry::kSampleBytes);
+    timesUs[i] = firstUs + i * periodUs;
+  }
+  ++mFrames;
+  mSamples += numSamples;
+  return numSamples;
+}
+
+void MotorTelemetryUnpacker::PrintStats(const char *name, int (*print)(const char*, ...)) const
+{
+  print("%s: telemetry frames: %llu, samples: %llu, lost frames: %llu, malformed: %llu\n",
+    name, mFrames, mSamples, mLostFrames, mMalformed);
+}
@@ -0,0 +1,81 @@
+#ifndef _MOTORTELEMETRY_H_
+#define _MOTORTELEMETRY_H_
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include <CanFd.h>
+#include <CanTypes.h>
+
+/*
+ * high rate motor telemetry over can fd
+ *
+ * one fd frame batches up to 9 model samples behind an 8 byte header:
+ *   header  seq (u8), sample count (u8), sample period in us (u16), time of the first
+ *           sample in us (u32)
+ *   sample  currents u, v (s16, 0.01 A), rotor angle (u16, 2 pi / 65536 rad)
+ * all little endian. the motor has no neutral connection, so current w is not sent but
+ * restored as -(u + v) on the receiving side. the samples of a frame are taken one
+ * model step apart, so their times follow from the first one and the period. the
+ * sequence number lets the receiver count lost frames.
+ */
+namespace MotorTelemetry
+{
+constexpr auto kHeaderBytes = 8u;
+constexpr auto kSampleBytes = 6u;
+constexpr auto kMaxSamples = (CanLimit::kMaxFdDataLength - kHeaderBytes) / kSampleBytes;
+constexpr auto kCurrentScale = 0.01; // A per bit
+constexpr auto kAngleScale = 6.283185307179586 / 65536.; // rad per bit
+constexpr uint8_t kFrameType = CanFrameType::kFd | CanFrameType::kBitRateSwitch;
+}
+
+struct MotorSample
+{
+  float mCurrentU; // A
+  float mCurrentV; // A
+  float mCurrentW; // A
+  float mRotorAngleRad;
+};
+
+class MotorTelemetryPacker
+{
+private:
+  CanFrame mFrame;
+  uint8_t mSequence;
+  unsigned int mNumSamples;
+  uint32_t mFirstUs;
+  uint32_t mLastUs;
+
+public:
+  unsigned long long mFrames;
+  unsigned long long mSamples;
+
+  MotorTelemetryPacker(const uint32_t id, const uint8_t type=MotorTelemetry::kFrameType);
+
+  // true when the sample completed a frame, which is then copied to frame
+  bool Add(const MotorSample &sample, const uint32_t timeUs, CanFrame &frame);
+  // a partial frame of the samples added so far, false when there are none
+  bool Flush(CanFrame &frame);
+};
+
+class MotorTelemetryUnpacker
+{
+private:
+  uint8_t mExpectedSequence;
+  bool mSynchronized;
+
+public:
+  unsigned long long mFrames;
+  unsigned long long mSamples;
+  unsigned long long mLostFrames;
+  unsigned long long mMalformed;
+
+  MotorTelemetryUnpacker();
+
+  // samples and times must hold MotorTelemetry::kMaxSamples, returns the number of
+  // samples in the frame or -1 when it is not a telemetry frame
+  int Unpack(const CanFrame &frame, MotorSample *samples, uint32_t *timesUs);
+  void PrintStats(const char *name, int (*print)(const char*, ...)=printf) const;
+};
+
+#endif // _MOTORTELEMETRY_H_
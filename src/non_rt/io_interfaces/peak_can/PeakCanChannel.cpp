@@ -0,0 +1,104 @@
+#include <PeakCanChannel.h>
+
+#include <string.h>
+
+namespace {
+
+void ToCanFrame(const TPCANRdMsg &readMessage, CanFrame &frame)
+{
+  frame.mId = readMessage.Msg.ID;
+  frame.mType = readMessage.Msg.MSGTYPE;
+  frame.mLen = readMessage.Msg.LEN;
+  memcpy(frame.mData, readMessage.Msg.DATA, CanLimit::kMaxDataLength);
+  frame.mDriverUs = readMessage.dwTime * 1000ull + readMessage.wUsec;
+}
+
+} // namespace
+
+PeakCanChannel::PeakCanChannel(
+  const char *name, const char *deviceName, const unsigned int baudRate)
+  : CanDevice(name, deviceName, baudRate * 1000)
+  , mHandle(NULL)
+{
+  mBaudRate = (baudRate == 1000) ? 0x0014 :
+              (baudRate == 500) ? 0x001C :
+              (baudRate == 250) ? 0x011C :
+              (baudRate == 125) ? 0x031C :
+              (baudRate == 100) ? 0x432F :
+              (baudRate == 50) ? 0x472F :
+              (baudRate == 20) ? 0x532F :
+              (baudRate == 10) ? 0x672F :
+              (baudRate == 5) ? 0x7F7F : 0;
+}
+
+int PeakCanChannel::Open()
+{
+  if(mBaudRate == 0)
+  {
+    printf("%s: BaudRate not good, please specify Baud Rate to be one of the following: "
+      "%dk|%dk|%dk|%dk|%dk|%dk|%dk|%dk|%dk\n", mName, 1000, 500, 250, 125, 100, 50, 20, 10, 5);
+    return -1;
+  }
+
+  mHandle = LINUX_CAN_Open(mDeviceName, 0);
+  if(mHandle == NULL)
+  {
+    printf("%s: Error opening %s\n", mName, mDeviceName);
+    return -1;
+  }
+
+  errno = CAN_Init(mHandle, mBaudRate, CAN_INIT_TYPE_EX);
+  if(errno)
+  {
+    perror("PeakCanChannel: Error with CAN_Init()");
+    return -1;
+  }
+  printf("%s: %s at %d kbit/s, CAN_Status = %i\n", mName, mDeviceName, mBitRate / 1000,
+    CAN_Status(mHandle));
+  return 0;
+}
+
+int PeakCanChannel::Read(CanFrame *frames, const unsigned int maxFrames, const int timeoutUs)
+{
+  // libpcan hands out one frame per call, the first one may wait
+  TPCANRdMsg readMessage;
+  auto numFrames{0u};
+  auto result = LINUX_CAN_Read_Timeout(mHandle, &readMessage, timeoutUs);
+  while(result == CAN_ERR_OK)
+  {
+    ToCanFrame(readMessage, frames[numFrames]);
+    if(++numFrames == maxFrames)
+      break;
+    result = LINUX_CAN_Read_Timeout(mHandle, &readMessage, 0);
+  }
+
+  // an error after some frames shows up again on the next call
+  if(numFrames == 0 && result != CAN_ERR_OK && result != CAN_ERR_QRCVEMPTY)
+    return -1;
+  return numFrames;
+}
+
+int PeakCanChannel::Write(const CanFrame *frames, const unsigned int numFrames)
+{
+  TPCANMsg writeMessage;
+  for(auto i{0u}; i < numFrames; ++i)
+  {
+    // the classic api has no room for fd frames, see PeakCanFdChannel
+    if(frames[i].mType & CanFrameType::kFd)
+      return i;
+
+    writeMessage.ID = frames[i].mId;
+    writeMessage.MSGTYPE = frames[i].mType;
+    writeMessage.LEN = frames[i].mLen;
+    memcpy(writeMessage.DATA, frames[i].mData, CanLimit::kMaxDataLength);
+    if(LINUX_CAN_Write_Timeout(mHandle, &writeMessage, 0) != CAN_ERR_OK)
+      return i;
+  }
+  return numFrames;
+}
+
+PeakCanChannel::~PeakCanChannel()
+{
+  if(mHandle != NULL)
+    CAN_Close(mHandle);
+}
@@ -0,0 +1,38 @@
+#ifndef _PEAKCANCHANNEL_H_
+#define _PEAKCANCHANNEL_H_
+
+#include <errno.h>
+#include <stdio.h>
+
+#include <libpcan.h>
+
+#include <CanDevice.h>
+
+/*
+ * a peak can device through libpcan
+ *
+ * every channel owns its own driver handle, so a process can drive as many buses as
+ * it has devices. the receive and transmit tasks of a channel share it, and so does
+ * any gateway rule sending to it; each write hands one whole frame to the driver.
+ */
+class PeakCanChannel : public CanDevice
+{
+private:
+  unsigned int mBaudRate; // btr0btr1 register value
+
+public:
+  HANDLE mHandle;
+
+public:
+  PeakCanChannel() = delete;
+  PeakCanChannel(const char *name, const char *deviceName, const unsigned int baudRate);
+
+  int Open() override;
+  int Read(CanFrame *frames, const unsigned int maxFrames, const int timeoutUs) override;
+  int Write(const CanFrame *frames, const unsigned int numFrames) override;
+  using CanDevice::Write;
+
+  ~PeakCanChannel();
+};
+
+#endif // _PEAKCANCHANNEL_H_
@@ -0,0 +1,99 @@
+#include <PeakCanFdChannel.h>
+
+#include <errno.h>
+#include <poll.h>
+#include <string.h>
+
+PeakCanFdChannel::PeakCanFdChannel(
+  const char *name, const char *deviceName, const unsigned int baudRate,
+  const unsigned int dataBaudRate)
+  : CanDevice(name, deviceName, baudRate * 1000, dataBaudRate * 1000)
+  , mFd(-1)
+{}
+
+int PeakCanFdChannel::Open()
+{
+  if(mDataBitRate < mBitRate)
+  {
+    printf("%s: the data bit rate must be at least the nominal one\n", mName);
+    return -1;
+  }
+
+  mFd = pcanfd_open(const_cast<char*>(mDeviceName), OFD_BITRATE | OFD_DBITRATE | OFD_NONBLOCKING,
+    mBitRate, mDataBitRate);
+  if(mFd < 0)
+  {
+    printf("%s: Error opening %s: %s\n", mName, mDeviceName, strerror(-mFd));
+    return -1;
+  }
+  printf("%s: %s at %d/%d kbit/s (fd)\n", mName, mDeviceName, mBitRate / 1000,
+    mDataBitRate / 1000);
+  return 0;
+}
+
+int PeakCanFdChannel::Read(CanFrame *frames, const unsigned int maxFrames, const int timeoutUs)
+{
+  struct pollfd readable{mFd, POLLIN, 0};
+  auto ready = poll(&readable, 1, timeoutUs / 1000);
+  if(ready == 0 || (ready < 0 && errno == EINTR))
+    return 0;
+  if(ready < 0)
+    return -1;
+
+  struct pcanfd_msg message;
+  auto numFrames{0u};
+  while(numFrames < maxFrames)
+  {
+    auto result = pcanfd_recv_msg(mFd, &message);
+    if(result == -EAGAIN || result == -EWOULDBLOCK)
+      break;
+    if(result < 0)
+      return numFrames > 0 ? static_cast<int>(numFrames) : -1;
+
+    auto &frame = frames[numFrames++];
+    auto fd = message.type == PCANFD_TYPE_CANFD_MSG;
+    frame.mId = message.id;
+    frame.mType = ((message.flags & PCANFD_MSG_EXT) ? CanFrameType::kExtended : 0) |
+      ((message.flags & PCANFD_MSG_RTR) ? CanFrameType::kRtr : 0) |
+      ((message.type == PCANFD_TYPE_STATUS || message.type == PCANFD_TYPE_ERROR_MSG) ?
+        CanFrameType::kStatus : 0) |
+      (fd ? CanFrameType::kFd : 0) |
+      ((fd && (message.flags & PCANFD_MSG_BRS)) ? CanFrameType::kBitRateSwitch : 0);
+    frame.mLen = message.data_len;
+    memcpy(frame.mData, message.data, fd ? CanLimit::kMaxFdDataLength : CanLimit::kMaxDataLength);
+    frame.mDriverUs = message.timestamp.tv_sec * 1000000ull + message.timestamp.tv_usec;
+  }
+  return numFrames;
+}
+
+int PeakCanFdChannel::Write(const CanFrame *frames, const unsigned int numFrames)
+{
+  struct pcanfd_msg message;
+  memset(&message, 0, sizeof(message));
+  for(auto i{0u}; i < numFrames; ++i)
+  {
+    auto &frame = frames[i];
+    auto fd = (frame.mType & CanFrameType::kFd) != 0;
+    message.type = fd ? PCANFD_TYPE_CANFD_MSG : PCANFD_TYPE_CAN20_MSG;
+    message.id = frame.mId;
+    message.flags = ((frame.mType & CanFrameType::kExtended) ? PCANFD_MSG_EXT : PCANFD_MSG_STD) |
+      ((frame.mType & CanFrameType::kRtr) ? PCANFD_MSG_RTR : 0) |
+      ((fd && (frame.mType & CanFrameType::kBitRateSwitch)) ? PCANFD_MSG_BRS : 0);
+    message.data_len = frame.mLen;
+    memcpy(message.data, frame.mData, fd ? CanLimit::kMaxFdDataLength : CanLimit::kMaxDataLength);
+
+    // a full tx fifo is -EAGAIN on a non blocking device
+    auto result = pcanfd_send_msg(mFd, &message);
+    if(result == -EAGAIN || result == -EWOULDBLOCK)
+      return i;
+    if(result < 0)
+      return i > 0 ? static_cast<int>(i) : -1;
+  }
+  return numFrames;
+}
+
+PeakCanFdChannel::~PeakCanFdChannel()
+{
+  if(mFd >= 0)
+    pcanfd_close(mFd);
+}
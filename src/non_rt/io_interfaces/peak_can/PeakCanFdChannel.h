@@ -0,0 +1,35 @@
+#ifndef _PEAKCANFDCHANNEL_H_
+#define _PEAKCANFDCHANNEL_H_
+
+#include <stdio.h>
+
+#include <libpcanfd.h>
+
+#include <CanDevice.h>
+
+/*
+ * a peak can fd device through libpcanfd
+ *
+ * the device is opened non blocking with its nominal and data bit rates and carries
+ * classic and fd frames alike. reads wait on the file descriptor, so the receive task
+ * still sleeps until a frame arrives.
+ */
+class PeakCanFdChannel : public CanDevice
+{
+private:
+  int mFd;
+
+public:
+  PeakCanFdChannel() = delete;
+  PeakCanFdChannel(const char *name, const char *deviceName, const unsigned int baudRate,
+    const unsigned int dataBaudRate);
+
+  int Open() override;
+  int Read(CanFrame *frames, const unsigned int maxFrames, const int timeoutUs) override;
+  int Write(const CanFrame *frames, const unsigned int numFrames) override;
+  using CanDevice::Write;
+
+  ~PeakCanFdChannel();
+};
+
+#endif // _PEAKCANFDCHANNEL_H_
@@ -1,44 +1,34 @@
 #include <PeakCanTask.h>
 
-HANDLE PeakCanTask::mHandle;
+#include <string.h>
+
+#include <PeakCanChannel.h>
+#include <PeakCanFdChannel.h>
+#include <SocketCanDevice.h>
 
 PeakCanTask::PeakCanTask(
   const char *deviceName, const unsigned int baudRate)
+  : mDevice(MakeDevice(deviceName, deviceName, baudRate))
+  , mBitRate(baudRate * 1000)
 {
-  mHandle = LINUX_CAN_Open(deviceName, 0);
-
-  mBaudRate = (baudRate == 1000) ? 0x0014 :
-              (baudRate == 500) ? 0x001C :
-              (baudRate == 250) ? 0x011C :
-              (baudRate == 125) ? 0x031C :
-              (baudRate == 100) ? 0x432F :
-              (baudRate == 50) ? 0x472F :
-              (baudRate == 20) ? 0x532F :
-              (baudRate == 10) ? 0x672F :
-              (baudRate == 5) ? 0x7F7F : 0;
-
-  if(mBaudRate == 0)
-  {
-    printf("BaudRate not good, please specify Baud Rate to be one of the following: "
-      "%dk|%dk|%dk|%dk|%dk|%dk|%dk|%dk|%dk\n", 1000, 500, 250, 125, 100, 50, 20, 10, 5);
+  if(mDevice->Open())
     exit(-1);
-  }
-
-  Init();
 }
 
-int PeakCanTask::Init()
+PeakCanTask::PeakCanTask(std::shared_ptr<CanDevice> device)
+  : mDevice(device)
+  , mBitRate(device->mBitRate)
+{}
+
+std::shared_ptr<CanDevice> PeakCanTask::MakeDevice(const char *name,
+  const char *deviceName, const unsigned int baudRate, const unsigned int dataBaudRate)
 {
-  errno = CAN_Init(mHandle, mBaudRate, CAN_INIT_TYPE_EX);
-  if(errno)
-  {
-    perror("PeakCanTask: Error with CAN_Init()");
-    return errno;
-  }
-  printf("PeakCanTask: CAN_Status = %i\n", CAN_Status(mHandle));
+  if(strncmp(deviceName, "/dev/", 5) != 0)
+    return std::make_shared<SocketCanDevice>(name, deviceName, baudRate, dataBaudRate);
+  if(dataBaudRate > 0)
+    return std::make_shared<PeakCanFdChannel>(name, deviceName, baudRate, dataBaudRate);
+  return std::make_shared<PeakCanChannel>(name, deviceName, baudRate);
 }
 
 PeakCanTask::~PeakCanTask()
-{
-  CAN_Close(mHandle);
-}
+{}
@@ -5,19 +5,34 @@
 #include <stdio.h>
 #include <stdlib.h>
 
-#include <libpcan.h>
+#include <memory>
 
+#include <CanDevice.h>
+
+/*
+ * base of the tasks working on one can bus
+ * tasks built from a device name open a device of their own, tasks of a process
+ * driving several buses share the device they are given
+ */
 class PeakCanTask
 {
 protected:
-  static HANDLE mHandle;
-  unsigned int mBaudRate;
+  std::shared_ptr<CanDevice> mDevice;
+
+public:
+  unsigned int mBitRate; // bits/s
 
 public:
   PeakCanTask() = delete;
   PeakCanTask(const char *deviceName, const unsigned int baudRate);
+  explicit PeakCanTask(std::shared_ptr<CanDevice> device);
 
-  int Init();
+  /*
+   * /dev/pcan* opens a peak channel, through libpcanfd when a data baud rate is given,
+   * anything else a socketcan interface, in fd mode with a data baud rate
+   */
+  static std::shared_ptr<CanDevice> MakeDevice(const char *name, const char *deviceName,
+    const unsigned int baudRate, const unsigned int dataBaudRate=0);
 
   ~PeakCanTask();
 };
@@ -0,0 +1,220 @@
+#include <SocketCanDevice.h>
+
+#include <errno.h>
+#include <net/if.h>
+#include <poll.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <linux/can/raw.h>
+
+SocketCanDevice::SocketCanDevice(
+  const char *name, const char *interfaceName, const unsigned int baudRate,
+  const unsigned int dataBaudRate)
+  : CanDevice(name, interfaceName, baudRate * 1000, dataBaudRate * 1000)
+  , mSocket(-1)
+  , mDropped(0)
+{
+  memset(mReadHeaders, 0, sizeof(mReadHeaders));
+  for(auto i{0u}; i < SocketCan::kMaxBatch; ++i)
+  {
+    mReadVectors[i].iov_base = &mReadFrames[i];
+    mReadVectors[i].iov_len = sizeof(struct canfd_frame);
+    mReadHeaders[i].msg_hdr.msg_iov = &mReadVectors[i];
+    mReadHeaders[i].msg_hdr.msg_iovlen = 1;
+  }
+}
+
+int SocketCanDevice::Open()
+{
+  mSocket = socket(PF_CAN, SOCK_RAW | SOCK_NONBLOCK, CAN_RAW);
+  if(mSocket < 0)
+  {
+    perror("SocketCanDevice: Error with socket()");
+    return -1;
+  }
+
+  struct sockaddr_can address;
+  memset(&address, 0, sizeof(address));
+  address.can_family = AF_CAN;
+  address.can_ifindex = if_nametoindex(mDeviceName);
+  if(address.can_ifindex == 0)
+  {
+    printf("%s: no can interface %s\n", mName, mDeviceName);
+    return -1;
+  }
+
+  // error frames come up as status frames, a large buffer rides out consumer hiccups
+  can_err_mask_t errorMask = CAN_ERR_MASK;
+  int enable = 1;
+  int bufferBytes = SocketCan::kReceiveBufferBytes;
+  if(setsockopt(mSocket, SOL_CAN_RAW, CAN_RAW_ERR_FILTER, &errorMask, sizeof(errorMask)) ||
+    setsockopt(mSocket, SOL_SOCKET, SO_TIMESTAMPNS, &enable, sizeof(enable)) ||
+    setsockopt(mSocket, SOL_SOCKET, SO_RXQ_OVFL, &enable, sizeof(enable)) ||
+    setsockopt(mSocket, SOL_SOCKET, SO_RCVBUF, &bufferBytes, sizeof(bufferBytes)))
+  {
+    perror("SocketCanDevice: Error with setsockopt()");
+    return -1;
+  }
+
+  if(mDataBitRate > 0 &&
+    setsockopt(mSocket, SOL_CAN_RAW, CAN_RAW_FD_FRAMES, &enable, sizeof(enable)))
+  {
+    perror("SocketCanDevice: Error enabling can fd frames");
+    return -1;
+  }
+
+  if(bind(mSocket, reinterpret_cast<struct sockaddr*>(&address), sizeof(address)))
+  {
+    perror("SocketCanDevice: Error with bind()");
+    return -1;
+  }
+  printf("%s: socketcan %s%s\n", mName, mDeviceName, mDataBitRate > 0 ? " (fd)" : "");
+  return 0;
+}
+
+int SocketCanDevice::Read(CanFrame *frames, const unsigned int maxFrames, const int timeoutUs)
+{
+  struct pollfd readable{mSocket, POLLIN, 0};
+  auto ready = poll(&readable, 1, timeoutUs / 1000);
+  if(ready == 0 || (ready < 0 && errno == EINTR))
+    return 0;
+  if(ready < 0)
+    return -1;
+
+  auto numFrames{0u};
+  while(numFrames < maxFrames)
+  {
+    auto batch = maxFrames - numFrames;
+    if(batch > SocketCan::kMaxBatch)
+      batch = SocketCan::kMaxBatch;
+
+    for(auto i{0u}; i < batch; ++i)
+    {
+      mReadHeaders[i].msg_hdr.msg_control = mReadControl[i];
+      mReadHeaders[i].msg_hdr.msg_controllen = sizeof(mReadControl[i]);
+    }
+
+    auto numRead = recvmmsg(mSocket, mReadHeaders, batch, MSG_DONTWAIT, NULL);
+    if(numRead < 0)
+    {
+      if(errno == EAGAIN || errno == EWOULDBLOCK)
+        break;
+      return numFrames > 0 ? static_cast<int>(numFrames) : -1;
+    }
+
+    for(auto i{0}; i < numRead; ++i)
+    {
+      auto &raw = mReadFrames[i];
+      auto &frame = frames[numFrames + i];
+      frame.mId = raw.can_id & ((raw.can_id & CAN_EFF_FLAG) ? CAN_EFF_MASK : CAN_SFF_MASK);
+      // the size of the message tells a classic frame from an fd one
+      auto fd = mReadHeaders[i].msg_len == CANFD_MTU;
+      frame.mType = ((raw.can_id & CAN_EFF_FLAG) ? CanFrameType::kExtended : 0) |
+        ((raw.can_id & CAN_RTR_FLAG) ? CanFrameType::kRtr : 0) |
+        ((raw.can_id & CAN_ERR_FLAG) ? CanFrameType::kStatus : 0) |
+        (fd ? CanFrameType::kFd : 0) |
+        ((fd && (raw.flags & CANFD_BRS)) ? CanFrameType::kBitRateSwitch : 0);
+      frame.mLen = raw.len;
+      memcpy(frame.mData, raw.data, fd ? CanLimit::kMaxFdDataLength : CanLimit::kMaxDataLength);
+      frame.mDriverUs = 0;
+
+      for(auto *control = CMSG_FIRSTHDR(&mReadHeaders[i].msg_hdr); control != NULL;
+        control = CMSG_NXTHDR(&mReadHeaders[i].msg_hdr, control))
+      {
+        if(control->cmsg_level != SOL_SOCKET)
+          continue;
+        if(control->cmsg_type == SO_TIMESTAMPNS)
+        {
+          struct timespec stamp;
+          memcpy(&stamp, CMSG_DATA(control), sizeof(stamp));
+          frame.mDriverUs = static_cast<unsigned long long>(stamp.tv_sec) * 1000000ull +
+            stamp.tv_nsec / 1000;
+        }
+        else if(control->cmsg_type == SO_RXQ_OVFL)
+        {
+          uint32_t dropped;
+          memcpy(&dropped, CMSG_DATA(control), sizeof(dropped));
+          mDropped = dropped;
+        }
+      }
+    }
+
+    numFrames += numRead;
+    if(static_cast<unsigned int>(numRead) < batch)
+      break;
+  }
+  return numFrames;
+}
+
+int SocketCanDevice::Write(const CanFrame *frames, const unsigned int numFrames)
+{
+  // locals, not members: the writers of a device do not share a batch
+  struct canfd_frame writeFrames[SocketCan::kMaxBatch];
+  struct iovec writeVectors[SocketCan::kMaxBatch];
+  struct mmsghdr writeHeaders[SocketCan::kMaxBatch];
+
+  auto written{0u};
+  while(written < numFrames)
+  {
+    auto batch = numFrames - written;
+    if(batch > SocketCan::kMaxBatch)
+      batch = SocketCan::kMaxBatch;
+
+    for(auto i{0u}; i < batch; ++i)
+    {
+      auto &frame = frames[written + i];
+      auto &raw = writeFrames[i];
+      // the kernel refuses fd frames on a classic socket, stop in front of them
+      if((frame.mType & CanFrameType::kFd) && mDataBitRate == 0)
+      {
+        batch = i;
+        break;
+      }
+
+      raw.can_id = frame.mId |
+        ((frame.mType & CanFrameType::kExtended) ? CAN_EFF_FLAG : 0) |
+        ((frame.mType & CanFrameType::kRtr) ? CAN_RTR_FLAG : 0);
+      raw.len = frame.mLen;
+      if(frame.mType & CanFrameType::kFd)
+      {
+        raw.flags = (frame.mType & CanFrameType::kBitRateSwitch) ? CANFD_BRS : 0;
+        memcpy(raw.data, frame.mData, CanLimit::kMaxFdDataLength);
+        writeVectors[i].iov_len = CANFD_MTU;
+      }
+      else
+      {
+        raw.flags = 0;
+        memcpy(raw.data, frame.mData, CanLimit::kMaxDataLength);
+        writeVectors[i].iov_len = CAN_MTU;
+      }
+      writeVectors[i].iov_base = &raw;
+      memset(&writeHeaders[i], 0, sizeof(writeHeaders[i]));
+      writeHeaders[i].msg_hdr.msg_iov = &writeVectors[i];
+      writeHeaders[i].msg_hdr.msg_iovlen = 1;
+    }
+
+    if(batch == 0)
+      break;
+
+    // the tx queue of the interface is full with ENOBUFS, like a full driver fifo
+    auto numSent = sendmmsg(mSocket, writeHeaders, batch, MSG_DONTWAIT);
+    if(numSent < 0)
+    {
+      if(errno == EAGAIN || errno == EWOULDBLOCK || errno == ENOBUFS)
+        break;
+      return written > 0 ? static_cast<int>(written) : -1;
+    }
+
+    written += numSent;
+    if(static_cast<unsigned int>(numSent) < batch)
+      break;
+  }
+  return written;
+}
+
+SocketCanDevice::~SocketCanDevice()
+{
+  if(mSocket >= 0)
+    close(mSocket);
+}
@@ -0,0 +1,53 @@
+#ifndef _SOCKETCANDEVICE_H_
+#define _SOCKETCANDEVICE_H_
+
+#include <stdio.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+
+#include <linux/can.h>
+
+#include <CanDevice.h>
+
+namespace SocketCan
+{
+constexpr auto kMaxBatch = 64u;
+constexpr auto kReceiveBufferBytes = 1u << 20;
+}
+
+/*
+ * a socketcan interface (can0, vcan0, ...) through a raw can socket
+ *
+ * reads and writes move up to SocketCan::kMaxBatch frames per recvmmsg/sendmmsg call.
+ * Write() builds its batch on the stack, about 10 kB, as its callers may overlap.
+ * mDriverUs is the kernel receive timestamp. the bit rates of a real adapter are set
+ * with ip link (bitrate, dbitrate, fd on), mBitRate and mDataBitRate only tell the
+ * device whether to accept fd frames and feed bus load figures; vcan has none.
+ */
+class SocketCanDevice : public CanDevice
+{
+private:
+  int mSocket;
+
+  struct canfd_frame mReadFrames[SocketCan::kMaxBatch];
+  struct iovec mReadVectors[SocketCan::kMaxBatch];
+  struct mmsghdr mReadHeaders[SocketCan::kMaxBatch];
+  char mReadControl[SocketCan::kMaxBatch][CMSG_SPACE(sizeof(struct timespec))];
+
+public:
+  unsigned long long mDropped; // frames the kernel dropped for a full socket buffer
+
+public:
+  SocketCanDevice() = delete;
+  SocketCanDevice(const char *name, const char *interfaceName, const unsigned int baudRate,
+    const unsigned int dataBaudRate=0);
+
+  int Open() override;
+  int Read(CanFrame *frames, const unsigned int maxFrames, const int timeoutUs) override;
+  int Write(const CanFrame *frames, const unsigned int numFrames) override;
+  using CanDevice::Write;
+
+  ~SocketCanDevice();
+};
+
+#endif // _SOCKETCANDEVICE_H_
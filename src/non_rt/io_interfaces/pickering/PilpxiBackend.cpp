@@ -0,0 +1,75 @@
+#include <PilpxiBackend.h>
+
+DWORD PilpxiBackend::CountFreeCards(DWORD *numCards)
+{
+  return PIL_CountFreeCards(numCards);
+}
+
+DWORD PilpxiBackend::FindFreeCards(DWORD numCards, DWORD *buses, DWORD *devices)
+{
+  return PIL_FindFreeCards(numCards, buses, devices);
+}
+
+DWORD PilpxiBackend::OpenSpecifiedCard(DWORD bus, DWORD device, DWORD *cardNum)
+{
+  return PIL_OpenSpecifiedCard(bus, device, cardNum);
+}
+
+DWORD PilpxiBackend::CloseSpecifiedCard(DWORD cardNum)
+{
+  return PIL_CloseSpecifiedCard(cardNum);
+}
+
+DWORD PilpxiBackend::ClearCard(DWORD cardNum)
+{
+  return PIL_ClearCard(cardNum);
+}
+
+DWORD PilpxiBackend::CardId(DWORD cardNum, CHAR *cardId)
+{
+  return PIL_CardId(cardNum, cardId);
+}
+
+DWORD PilpxiBackend::EnumerateSubs(DWORD cardNum, DWORD *inSubs, DWORD *outSubs)
+{
+  return PIL_EnumerateSubs(cardNum, inSubs, outSubs);
+}
+
+DWORD PilpxiBackend::SubInfo(DWORD cardNum, DWORD subunit, BOOL out,
+  DWORD *typeNum, DWORD *rows, DWORD *cols)
+{
+  return PIL_SubInfo(cardNum, subunit, out, typeNum, rows, cols);
+}
+
+DWORD PilpxiBackend::SubType(DWORD cardNum, DWORD subunit, BOOL out, CHAR *subType)
+{
+  return PIL_SubType(cardNum, subunit, out, subType);
+}
+
+DWORD PilpxiBackend::ViewSub(DWORD cardNum, DWORD subunit, DWORD *data)
+{
+  return PIL_ViewSub(cardNum, subunit, data);
+}
+
+DWORD PilpxiBackend::WriteSub(DWORD cardNum, DWORD subunit, DWORD *data)
+{
+  return PIL_WriteSub(cardNum, subunit, data);
+}
+
+DWORD PilpxiBackend::OpBit(DWORD cardNum, DWORD subunit, DWORD bit, BOOL state)
+{
+  return PIL_OpBit(cardNum, subunit, bit, state);
+}
+
+DWORD PilpxiBackend::ViewBit(DWORD cardNum, DWORD subunit, DWORD bit, BOOL *state)
+{
+  return PIL_ViewBit(cardNum, subunit, bit, state);
+}
+
+DWORD PilpxiBackend::ResInfo(DWORD cardNum, DWORD subunit, double *minRes, double *maxRes)
+{
+  double refRes, precPC, precDelta, int1, intDelta;
+  DWORD capabilities;
+  return PIL_ResInfo(cardNum, subunit, minRes, maxRes, &refRes, &precPC, &precDelta,
+    &int1, &intDelta, &capabilities);
+}
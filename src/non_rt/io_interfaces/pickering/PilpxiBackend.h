@@ -0,0 +1,31 @@
+#ifndef _PILPXIBACKEND_H_
+#define _PILPXIBACKEND_H_
+
+#include <Pilpxi.h>
+
+#include <PxiBackend.h>
+
+/*
+ * PxiBackend over the pickering pilpxi64 driver library
+ */
+class PilpxiBackend : public PxiBackend
+{
+public:
+  DWORD CountFreeCards(DWORD *numCards) override;
+  DWORD FindFreeCards(DWORD numCards, DWORD *buses, DWORD *devices) override;
+  DWORD OpenSpecifiedCard(DWORD bus, DWORD device, DWORD *cardNum) override;
+  DWORD CloseSpecifiedCard(DWORD cardNum) override;
+  DWORD ClearCard(DWORD cardNum) override;
+  DWORD CardId(DWORD cardNum, CHAR *cardId) override;
+  DWORD EnumerateSubs(DWORD cardNum, DWORD *inSubs, DWORD *outSubs) override;
+  DWORD SubInfo(DWORD cardNum, DWORD subunit, BOOL out,
+    DWORD *typeNum, DWORD *rows, DWORD *cols) override;
+  DWORD SubType(DWORD cardNum, DWORD subunit, BOOL out, CHAR *subType) override;
+  DWORD ViewSub(DWORD cardNum, DWORD subunit, DWORD *data) override;
+  DWORD WriteSub(DWORD cardNum, DWORD subunit, DWORD *data) override;
+  DWORD OpBit(DWORD cardNum, DWORD subunit, DWORD bit, BOOL state) override;
+  DWORD ViewBit(DWORD cardNum, DWORD subunit, DWORD bit, BOOL *state) override;
+  DWORD ResInfo(DWORD cardNum, DWORD subunit, double *minRes, double *maxRes) override;
+};
+
+#endif // _PILPXIBACKEND_H_
@@ -0,0 +1,32 @@
+#ifndef _PXIBACKEND_H_
+#define _PXIBACKEND_H_
+
+#include <PxiTypes.h>
+
+/*
+ * the subset of the pilpxi api used by PxiCard and PxiCardManager
+ * every call mirrors the PIL_* function of the same name and returns its error code
+ */
+class PxiBackend
+{
+public:
+  virtual DWORD CountFreeCards(DWORD *numCards) = 0;
+  virtual DWORD FindFreeCards(DWORD numCards, DWORD *buses, DWORD *devices) = 0;
+  virtual DWORD OpenSpecifiedCard(DWORD bus, DWORD device, DWORD *cardNum) = 0;
+  virtual DWORD CloseSpecifiedCard(DWORD cardNum) = 0;
+  virtual DWORD ClearCard(DWORD cardNum) = 0;
+  virtual DWORD CardId(DWORD cardNum, CHAR *cardId) = 0;
+  virtual DWORD EnumerateSubs(DWORD cardNum, DWORD *inSubs, DWORD *outSubs) = 0;
+  virtual DWORD SubInfo(DWORD cardNum, DWORD subunit, BOOL out,
+    DWORD *typeNum, DWORD *rows, DWORD *cols) = 0;
+  virtual DWORD SubType(DWORD cardNum, DWORD subunit, BOOL out, CHAR *subType) = 0;
+  virtual DWORD ViewSub(DWORD cardNum, DWORD subunit, DWORD *data) = 0;
+  virtual DWORD WriteSub(DWORD cardNum, DWORD subunit, DWORD *data) = 0;
+  virtual DWORD OpBit(DWORD cardNum, DWORD subunit, DWORD bit, BOOL state) = 0;
+  virtual DWORD ViewBit(DWORD cardNum, DWORD subunit, DWORD bit, BOOL *state) = 0;
+  virtual DWORD ResInfo(DWORD cardNum, DWORD subunit, double *minRes, double *maxRes) = 0;
+
+  virtual ~PxiBackend() {}
+};
+
+#endif // _PXIBACKEND_H_
@@ -0,0 +1,214 @@
+#include <PxiCard.h>
+
+void PxiCardStats::Record(const unsigned long long elapsedNs)
+{
+  ++mCycles;
+  mLastNs = elapsedNs;
+  mTotalNs += elapsedNs;
+  if(mMinNs == 0 || elapsedNs < mMinNs)
+    mMinNs = elapsedNs;
+  if(elapsedNs > mMaxNs)
+    mMaxNs = elapsedNs;
+}
+
+void PxiCardStats::Reset()
+{
+  memset(this, 0, sizeof(PxiCardStats));
+}
+
+PxiCard::PxiCard(std::shared_ptr<PxiBackend> backend, const DWORD bus, const DWORD device)
+  : mBackend(backend)
+  , mBus(bus)
+  , mDevice(device)
+  , mCardNum(0)
+  , mNumInputSubunits(0)
+  , mNumOutputSubunits(0)
+  , mOpen(false)
+{
+  memset(mCardId, 0, sizeof(mCardId));
+  memset(mOutputSubunits, 0, sizeof(mOutputSubunits));
+  mStats.Reset();
+}
+
+int PxiCard::Open()
+{
+  auto e = mBackend->OpenSpecifiedCard(mBus, mDevice, &mCardNum);
+  if(e)
+  {
+    printf("PxiCard: error %d opening card at bus %d, device %d\n", e, mBus, mDevice);
+    return -1;
+  }
+  mOpen = true;
+
+  mBackend->CardId(mCardNum, mCardId);
+  mBackend->EnumerateSubs(mCardNum, &mNumInputSubunits, &mNumOutputSubunits);
+
+  if(mNumOutputSubunits > PxiLimit::kMaxSubunits)
+  {
+    printf("PxiCard: card %d has %d output subunits, only the first %d are used\n",
+      mCardNum, mNumOutputSubunits, PxiLimit::kMaxSubunits);
+    mNumOutputSubunits = PxiLimit::kMaxSubunits;
+  }
+
+  // cache topology once so the rt tasks never have to ask the driver for it
+  auto dataWords{0u};
+  for(auto i{0u}; i < mNumOutputSubunits; ++i)
+  {
+    auto &info = mOutputSubunits[i];
+    mBackend->SubInfo(mCardNum, i + 1, true, &info.mTypeNum, &info.mRows, &info.mCols);
+    mBackend->SubType(mCardNum, i + 1, true, info.mSubType);
+
+    info.mMinOhm = 0;
+    info.mMaxOhm = ~DWORD{0};
+    if(info.mTypeNum == PxiSubunitType::kResistor)
+    {
+      double minRes, maxRes;
+      if(mBackend->ResInfo(mCardNum, i + 1, &minRes, &maxRes) == 0)
+      {
+        info.mMinOhm = static_cast<DWORD>(minRes + 0.5);
+        info.mMaxOhm = static_cast<DWORD>(maxRes);
+      }
+    }
+
+    info.mDataOffset = dataWords;
+    info.mDataWords = (info.mRows * info.mCols + 31u) / 32u;
+    if(info.mDataWords == 0)
+      info.mDataWords = 1;
+    dataWords += info.mDataWords;
+  }
+
+  // seed the shadow state with what the card currently outputs
+  mShadow.assign(dataWords, 0);
+  for(auto i{0u}; i < mNumOutputSubunits; ++i)
+  {
+    mBackend->ViewSub(mCardNum, i + 1, &mShadow[mOutputSubunits[i].mDataOffset]);
+  }
+
+  return 0;
+}
+
+void PxiCard::Clear()
+{
+  if(!mOpen)
+    return;
+
+  mBackend->ClearCard(mCardNum);
+  for(auto &word : mShadow)
+  {
+    word = 0;
+  }
+}
+
+void PxiCard::Close()
+{
+  if(!mOpen)
+    return;
+
+  mBackend->CloseSpecifiedCard(mCardNum);
+  mOpen = false;
+}
+
+int PxiCard::WriteSubunit(const DWORD subunit, const DWORD *data)
+{
+  const auto &info = mOutputSubunits[subunit - 1];
+  auto *shadow = &mShadow[info.mDataOffset];
+
+  if(memcmp(shadow, data, info.mDataWords * sizeof(DWORD)) == 0)
+  {
+    ++mStats.mSkips;
+    return 0;
+  }
+
+  memcpy(shadow, data, info.mDataWords * sizeof(DWORD));
+  if(mBackend->WriteSub(mCardNum, subunit, shadow))
+  {
+    // force a rewrite on the next cycle
+    shadow[0] = ~data[0];
+    ++mStats.mErrors;
+    return -1;
+  }
+  ++mStats.mWrites;
+  return 1;
+}
+
+int PxiCard::WriteSubunitValue(const DWORD subunit, const DWORD value)
+{
+  auto *shadow = &mShadow[mOutputSubunits[subunit - 1].mDataOffset];
+
+  if(shadow[0] == value)
+  {
+    ++mStats.mSkips;
+    return 0;
+  }
+
+  shadow[0] = value;
+  if(mBackend->WriteSub(mCardNum, subunit, shadow))
+  {
+    shadow[0] = ~value;
+    ++mStats.mErrors;
+    return -1;
+  }
+  ++mStats.mWrites;
+  return 1;
+}
+
+int PxiCard::OpBit(const DWORD subunit, const DWORD bit, const BOOL state)
+{
+  auto &word = mShadow[mOutputSubunits[subunit - 1].mDataOffset + (bit - 1) / 32u];
+  const DWORD mask = 1u << ((bit - 1) % 32u);
+
+  if(static_cast<bool>(word & mask) == static_cast<bool>(state))
+  {
+    ++mStats.mSkips;
+    return 0;
+  }
+
+  if(mBackend->OpBit(mCardNum, subunit, bit, state))
+  {
+    ++mStats.mErrors;
+    return -1;
+  }
+  word = state ? (word | mask) : (word & ~mask);
+  ++mStats.mWrites;
+  return 1;
+}
+
+DWORD PxiCard::GetSubunitValue(const DWORD subunit) const
+{
+  return mShadow[mOutputSubunits[subunit - 1].mDataOffset];
+}
+
+BOOL PxiCard::GetBit(const DWORD subunit, const DWORD bit) const
+{
+  const auto word = mShadow[mOutputSubunits[subunit - 1].mDataOffset + (bit - 1) / 32u];
+  return (word >> ((bit - 1) % 32u)) & 1u;
+}
+
+void PxiCard::PrintInfo() const
+{
+  printf("Card #%d, bus: %d, device: %d, card id: %s, "
+    "# input subunits: %d, # output subunits: %d\n",
+    mCardNum, mBus, mDevice, mCardId, mNumInputSubunits, mNumOutputSubunits);
+
+  for(auto i{0u}; i < mNumOutputSubunits; ++i)
+  {
+    const auto &info = mOutputSubunits[i];
+    printf("  Output subunit #%d (%s), type: %d, rows: %d, cols: %d, value: %d\n",
+      i + 1, info.mSubType, info.mTypeNum, info.mRows, info.mCols,
+      mShadow[info.mDataOffset]);
+  }
+}
+
+void PxiCard::PrintStats() const
+{
+  printf("Card #%d (bus %d, device %d): cycles: %llu, writes: %llu, skips: %llu, "
+    "errors: %llu, last/min/avg/max: %llu/%llu/%llu/%llu ns\n",
+    mCardNum, mBus, mDevice, mStats.mCycles, mStats.mWrites, mStats.mSkips,
+    mStats.mErrors, mStats.mLastNs, mStats.mMinNs,
+    mStats.mCycles ? mStats.mTotalNs / mStats.mCycles : 0ull, mStats.mMaxNs);
+}
+
+PxiCard::~PxiCard()
+{
+  Close();
+}
@@ -0,0 +1,103 @@
+#ifndef _PXICARD_H_
+#define _PXICARD_H_
+
+#include <stdio.h>
+#include <string.h>
+
+#include <memory>
+#include <vector>
+
+#include <PxiBackend.h>
+#include <PxiTypes.h>
+
+namespace PxiLimit
+{
+constexpr auto kMaxCards = 100u;
+constexpr auto kMaxSubunits = 100u;
+constexpr auto kMaxSharedSubunits = 256u;
+constexpr auto kStringLength = 100u;
+}
+
+/*
+ * topology of one output subunit as reported by PIL_SubInfo/PIL_SubType
+ * mDataOffset/mDataWords locate the subunit inside the card's shadow state
+ * mMinOhm/mMaxOhm are the valid range of resistor subunits (PIL_ResInfo)
+ */
+struct PxiSubunitInfo
+{
+  DWORD mTypeNum;
+  DWORD mRows;
+  DWORD mCols;
+  DWORD mDataOffset;
+  DWORD mDataWords;
+  DWORD mMinOhm;
+  DWORD mMaxOhm;
+  CHAR mSubType[PxiLimit::kStringLength];
+};
+
+/*
+ * update statistics of one card, recorded by whichever rt task drives it
+ */
+struct PxiCardStats
+{
+  unsigned long long mCycles;
+  unsigned long long mWrites;
+  unsigned long long mSkips;
+  unsigned long long mErrors;
+  unsigned long long mLastNs;
+  unsigned long long mMinNs;
+  unsigned long long mMaxNs;
+  unsigned long long mTotalNs;
+
+  void Record(const unsigned long long elapsedNs);
+  void Reset();
+};
+
+/*
+ * one pickering pxi card: its handle, enumerated subunit topology and a shadow
+ * copy of every output subunit so unchanged states never reach the driver
+ * subunit and bit numbers are 1-based, as in the pilpxi api
+ */
+class PxiCard
+{
+private:
+  std::shared_ptr<PxiBackend> mBackend;
+
+public:
+  DWORD mBus;
+  DWORD mDevice;
+  DWORD mCardNum;
+  DWORD mNumInputSubunits;
+  DWORD mNumOutputSubunits;
+
+  CHAR mCardId[PxiLimit::kStringLength];
+
+  bool mOpen;
+
+  PxiSubunitInfo mOutputSubunits[PxiLimit::kMaxSubunits];
+  std::vector<DWORD> mShadow;
+
+  PxiCardStats mStats;
+
+public:
+  PxiCard() = delete;
+  PxiCard(std::shared_ptr<PxiBackend> backend, const DWORD bus, const DWORD device);
+
+  int Open();
+  void Clear();
+  void Close();
+
+  int WriteSubunit(const DWORD subunit, const DWORD *data);
+  int WriteSubunitValue(const DWORD subunit, const DWORD value);
+  int OpBit(const DWORD subunit, const DWORD bit, const BOOL state);
+
+  DWORD GetSubunitValue(const DWORD subunit) const;
+  BOOL GetBit(const DWORD subunit, const DWORD bit) const;
+
+  void PrintInfo() const;
+  void PrintStats() const;
+
+  ~PxiCard();
+};
+
+#endif // _PXICARD_H_
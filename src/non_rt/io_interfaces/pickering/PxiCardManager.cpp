@@ -0,0 +1,167 @@
+#include <PxiCardManager.h>
+
+PxiCardManager::PxiCardManager(std::shared_ptr<PxiBackend> backend)
+  : mBackend(backend)
+  , mNumOfFreeCards(0)
+{}
+
+DWORD PxiCardManager::FindFreeCards()
+{
+  mBackend->CountFreeCards(&mNumOfFreeCards);
+  if(mNumOfFreeCards > PxiLimit::kMaxCards)
+    mNumOfFreeCards = PxiLimit::kMaxCards;
+  mBackend->FindFreeCards(mNumOfFreeCards, mBuses, mDevices);
+
+  mCards.clear();
+  for(auto i{0u}; i < mNumOfFreeCards; ++i)
+  {
+    mCards.push_back(std::make_shared<PxiCard>(mBackend, mBuses[i], mDevices[i]));
+  }
+
+  printf("PxiCardManager: found %d free cards\n", mNumOfFreeCards);
+  return mNumOfFreeCards;
+}
+
+int PxiCardManager::OpenCards(const std::vector<DWORD> &cardPositions)
+{
+  auto begin = std::chrono::steady_clock::now();
+
+  // opening and enumerating is dominated by driver round trips, so do every card at once
+  std::vector<std::thread> openThreads;
+  std::vector<int> results(cardPositions.size(), -1);
+  for(auto i{0u}; i < cardPositions.size(); ++i)
+  {
+    auto card = GetCard(cardPositions[i]);
+    if(!card)
+    {
+      printf("PxiCardManager: no card at position %d\n", cardPositions[i]);
+      continue;
+    }
+    openThreads.emplace_back([card, &results, i]() { results[i] = card->Open(); });
+  }
+
+  for(auto &openThread : openThreads)
+  {
+    openThread.join();
+  }
+
+  auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(
+    std::chrono::steady_clock::now() - begin);
+
+  auto errors{0};
+  for(auto result : results)
+  {
+    if(result)
+      ++errors;
+  }
+
+  printf("PxiCardManager: opened %lu/%lu cards in %lld microseconds\n",
+    cardPositions.size() - errors, cardPositions.size(), static_cast<long long>(elapsed.count()));
+
+  return errors ? -1 : 0;
+}
+
+int PxiCardManager::OpenAllCards()
+{
+  std::vector<DWORD> cardPositions;
+  for(auto i{1u}; i <= mCards.size(); ++i)
+  {
+    cardPositions.push_back(i);
+  }
+  return OpenCards(cardPositions);
+}
+
+void PxiCardManager::CloseAllCards()
+{
+  for(auto &card : mCards)
+  {
+    card->Clear();
+    card->Close();
+  }
+}
+
+int PxiCardManager::AddSafeSubunit(const DWORD cardPosition, const DWORD subunit,
+  const DWORD value)
+{
+  auto card = GetCard(cardPosition);
+  if(!card || !card->mOpen)
+  {
+    printf("PxiCardManager: no open card at position %d for a safe state\n", cardPosition);
+    return -1;
+  }
+  if(subunit == 0 || subunit > card->mNumOutputSubunits)
+  {
+    printf("PxiCardManager: card %d has no output subunit %d for a safe state\n",
+      cardPosition, subunit);
+    return -1;
+  }
+  mSafeSubunits.push_back(PxiSafeSubunit{cardPosition, subunit, value});
+  return 0;
+}
+
+void PxiCardManager::EnterSafeState()
+{
+  for(auto &card : mCards)
+  {
+    card->Clear();
+  }
+  for(auto &safe : mSafeSubunits)
+  {
+    auto card = GetCard(safe.mCardPosition);
+    if(card->mOpen && card->WriteSubunitValue(safe.mSubunit, safe.mValue) < 0)
+      printf("PxiCardManager: card %d subunit %d not set to its safe state\n",
+        safe.mCardPosition, safe.mSubunit);
+  }
+}
+
+void PxiCardManager::EnterSafeState(void *manager)
+{
+  static_cast<PxiCardManager*>(manager)->EnterSafeState();
+}
+
+int PxiCardManager::RegisterSafeState(SafeState &safeState)
+{
+  return safeState.Register("PxiCardManager", &PxiCardManager::EnterSafeState, this);
+}
+
+std::shared_ptr<PxiCard> PxiCardManager::GetCard(const DWORD cardPosition)
+{
+  if(cardPosition == 0 || cardPosition > mCards.size())
+    return nullptr;
+  return mCards[cardPosition - 1];
+}
+
+std::vector<std::shared_ptr<PxiCard>> PxiCardManager::GetOpenCards()
+{
+  std::vector<std::shared_ptr<PxiCard>> openCards;
+  for(auto &card : mCards)
+  {
+    if(card->mOpen)
+      openCards.push_back(card);
+  }
+  return openCards;
+}
+
+void PxiCardManager::ListAllCards()
+{
+  for(auto i{0u}; i < mCards.size(); ++i)
+  {
+    printf("Card position: %d, ", i + 1);
+    if(mCards[i]->mOpen)
+    {
+      mCards[i]->PrintInfo();
+    }
+    else
+    {
+      printf("bus: %d, device: %d (not opened)\n", mCards[i]->mBus, mCards[i]->mDevice);
+    }
+  }
+}
+
+PxiCardManager::~PxiCardManager()
+{
+  for(auto &card : mCards)
+  {
+    card->Close();
+  }
+}
@@ -0,0 +1,67 @@
+#ifndef _PXICARDMANAGER_H_
+#define _PXICARDMANAGER_H_
+
+#include <stdio.h>
+
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include <PxiBackend.h>
+#include <PxiCard.h>
+#include <PxiTypes.h>
+#include <SafeState.h>
+
+// a subunit state the safe state of the cards sets after clearing them
+struct PxiSafeSubunit
+{
+  DWORD mCardPosition;
+  DWORD mSubunit;
+  DWORD mValue;
+};
+
+/*
+ * enumerates every free pickering card once and owns one PxiCard per card
+ * card positions are 1-based in the order returned by PIL_FindFreeCards
+ */
+class PxiCardManager
+{
+private:
+  std::shared_ptr<PxiBackend> mBackend;
+  std::vector<PxiSafeSubunit> mSafeSubunits;
+
+  static void EnterSafeState(void *manager);
+
+public:
+  DWORD mNumOfFreeCards;
+  DWORD mBuses[PxiLimit::kMaxCards];
+  DWORD mDevices[PxiLimit::kMaxCards];
+
+  std::vector<std::shared_ptr<PxiCard>> mCards;
+
+public:
+  PxiCardManager() = delete;
+  PxiCardManager(std::shared_ptr<PxiBackend> backend);
+
+  DWORD FindFreeCards();
+  int OpenCards(const std::vector<DWORD> &cardPositions);
+  int OpenAllCards();
+  void CloseAllCards();
+
+  // every open card is cleared in the safe state, a safe subunit is then set to its value
+  int AddSafeSubunit(const DWORD cardPosition, const DWORD subunit, const DWORD value);
+  void EnterSafeState();
+  // the executor feeding the cards must have registered its own after this, so it is
+  // stopped before the cards are written
+  int RegisterSafeState(SafeState &safeState);
+
+  std::shared_ptr<PxiCard> GetCard(const DWORD cardPosition);
+  std::vector<std::shared_ptr<PxiCard>> GetOpenCards();
+
+  void ListAllCards();
+
+  ~PxiCardManager();
+};
+
+#endif // _PXICARDMANAGER_H_
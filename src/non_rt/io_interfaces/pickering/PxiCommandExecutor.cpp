@@ -0,0 +1,225 @@
+#include <PxiCommandExecutor.h>
+
+PxiCommandExecutor::PxiCommandExecutor(const int coreId, const bool printStats)
+  : mSlots(new PxiCommandSlot[PxiExecutor::kMaxSlots])
+  , mNumSlots(0)
+  , mReadyRings(new tReadyRing[PxiExecutor::kMaxProducers])
+  , mStatusRings(new tStatusRing[PxiExecutor::kMaxProducers])
+  , mNumProducers(0)
+  , mRunning(false)
+  , mCoreId(coreId)
+  , mPrintStats(printStats)
+{
+  mStats = PxiExecutorStats{};
+}
+
+int PxiCommandExecutor::RegisterProducer()
+{
+  auto producer = mNumProducers.load();
+  if(producer >= PxiExecutor::kMaxProducers)
+  {
+    printf("PxiCommandExecutor: no more than %d producers\n", PxiExecutor::kMaxProducers);
+    return -1;
+  }
+  mNumProducers.store(producer + 1);
+  return producer;
+}
+
+int PxiCommandExecutor::RegisterSubunit(const int producer, std::shared_ptr<PxiCard> card,
+  const DWORD subunit, const unsigned long long deadlineNs)
+{
+  return RegisterBit(producer, card, subunit, 0, deadlineNs);
+}
+
+int PxiCommandExecutor::RegisterBit(const int producer, std::shared_ptr<PxiCard> card,
+  const DWORD subunit, const DWORD bit, const unsigned long long deadlineNs)
+{
+  auto handle = mNumSlots.load();
+  if(handle >= PxiExecutor::kMaxSlots || producer < 0 ||
+    static_cast<unsigned int>(producer) >= mNumProducers.load())
+  {
+    printf("PxiCommandExecutor: cannot register card #%d subunit %d bit %d\n",
+      card->mCardNum, subunit, bit);
+    return -1;
+  }
+
+  auto &slot = mSlots[handle];
+  slot.mCard = card;
+  slot.mSubunit = subunit;
+  slot.mBit = bit;
+  slot.mProducer = producer;
+  slot.mDeadlineNs = deadlineNs;
+  slot.mValue.store(bit ? card->GetBit(subunit, bit) : card->GetSubunitValue(subunit));
+  slot.mPending.store(false);
+  slot.mPostedNs.store(0);
+  slot.mPosts.store(0);
+
+  // publish the slot only once it is fully initialized
+  mNumSlots.store(handle + 1, std::memory_order_release);
+  return handle;
+}
+
+int PxiCommandExecutor::Start()
+{
+  mRunning = true;
+  mThread = std::thread(&PxiCommandExecutor::Run, this);
+
+  if(mCoreId >= 0)
+  {
+    cpu_set_t cpuSet;
+    CPU_ZERO(&cpuSet);
+    CPU_SET(mCoreId, &cpuSet);
+    if(pthread_setaffinity_np(mThread.native_handle(), sizeof(cpu_set_t), &cpuSet))
+      printf("PxiCommandExecutor: could not pin executor to core %d\n", mCoreId);
+  }
+  printf("PxiCommandExecutor started with %d slots, %d producers\n",
+    mNumSlots.load(), mNumProducers.load());
+  return 0;
+}
+
+void PxiCommandExecutor::Stop()
+{
+  if(!mRunning)
+    return;
+
+  mRunning = false;
+  if(mThread.joinable())
+    mThread.join();
+}
+
+void PxiCommandExecutor::EnterSafeState(void *executor)
+{
+  static_cast<PxiCommandExecutor*>(executor)->Stop();
+}
+
+int PxiCommandExecutor::RegisterSafeState(SafeState &safeState)
+{
+  return safeState.Register("PxiCommandExecutor", &PxiCommandExecutor::EnterSafeState, this);
+}
+
+void PxiCommandExecutor::Post(const int handle, const DWORD value)
+{
+  auto &slot = mSlots[handle];
+  slot.mValue.store(value);
+  slot.mPosts.fetch_add(1, std::memory_order_relaxed);
+
+  // only the first post of a pending cycle is queued, later ones coalesce into it
+  if(!slot.mPending.exchange(true))
+  {
+    slot.mPostedNs.store(NowNs(), std::memory_order_relaxed);
+    mReadyRings[slot.mProducer].Push(handle);
+  }
+}
+
+bool PxiCommandExecutor::PollStatus(const int producer, PxiCommandStatus &status)
+{
+  return mStatusRings[producer].Pop(status);
+}
+
+void PxiCommandExecutor::Apply(const int handle)
+{
+  auto &slot = mSlots[handle];
+  auto postedNs = slot.mPostedNs.load(std::memory_order_relaxed);
+
+  // clear pending before reading the value so a concurrent post is never lost
+  slot.mPending.store(false);
+  auto value = slot.mValue.load();
+
+  auto appliedNs = NowNs();
+  auto result = slot.mBit ?
+    slot.mCard->OpBit(slot.mSubunit, slot.mBit, value) :
+    slot.mCard->WriteSubunitValue(slot.mSubunit, value);
+
+  auto completedNs = NowNs();
+  auto latencyNs = completedNs - postedNs;
+  auto deadlineMissed = slot.mDeadlineNs > 0 && latencyNs > slot.mDeadlineNs;
+
+  slot.mCard->mStats.Record(completedNs - appliedNs);
+
+  ++mStats.mApplied;
+  mStats.mTotalLatencyNs += latencyNs;
+  if(mStats.mMinLatencyNs == 0 || latencyNs < mStats.mMinLatencyNs)
+    mStats.mMinLatencyNs = latencyNs;
+  if(latencyNs > mStats.mMaxLatencyNs)
+    mStats.mMaxLatencyNs = latencyNs;
+  if(deadlineMissed)
+    ++mStats.mDeadlineMisses;
+  if(result < 0)
+    ++mStats.mErrors;
+
+  PxiCommandStatus status{handle, value, result, deadlineMissed, postedNs, completedNs};
+  if(!mStatusRings[slot.mProducer].Push(status))
+    ++mStats.mStatusDrops;
+}
+
+void PxiCommandExecutor::Run()
+{
+  const struct timespec idleSleep{0, PxiExecutor::kIdleSleepNs};
+  int handles[PxiExecutor::kMaxSlots];
+  auto statsTimer = NowNs();
+
+  while(mRunning)
+  {
+    auto applied{0u};
+    auto numProducers = mNumProducers.load();
+    for(auto producer{0u}; producer < numProducers; ++producer)
+    {
+      auto numHandles = mReadyRings[producer].PopBatch(handles, PxiExecutor::kMaxSlots);
+      for(auto i{0u}; i < numHandles; ++i)
+      {
+        Apply(handles[i]);
+      }
+      applied += numHandles;
+    }
+
+    if(applied == 0)
+      nanosleep(&idleSleep, NULL);
+
+    if(mPrintStats && NowNs() - statsTimer > PxiExecutor::kStatsPeriodNs)
+    {
+      PrintStats();
+      statsTimer = NowNs();
+    }
+  }
+}
+
+void PxiCommandExecutor::PrintStats() const
+{
+  unsigned long long posts{0};
+  auto numSlots = mNumSlots.load();
+  for(auto i{0u}; i < numSlots; ++i)
+  {
+    posts += mSlots[i].mPosts.load(std::memory_order_relaxed);
+  }
+
+  printf("PxiCommandExecutor: posts: %llu, applied: %llu, coalesced: %llu, "
+    "deadline misses: %llu, errors: %llu, status drops: %llu, "
+    "actuation latency min/avg/max: %llu/%llu/%llu ns\n",
+    posts, mStats.mApplied, posts > mStats.mApplied ? posts - mStats.mApplied : 0ull,
+    mStats.mDeadlineMisses, mStats.mErrors, mStats.mStatusDrops, mStats.mMinLatencyNs,
+    mStats.mApplied ? mStats.mTotalLatencyNs / mStats.mApplied : 0ull,
+    mStats.mMaxLatencyNs);
+
+  // cards are only ever written from the executor, so their stats are consistent here
+  std::shared_ptr<PxiCard> lastCard;
+  for(auto i{0u}; i < numSlots; ++i)
+  {
+    if(mSlots[i].mCard != lastCard)
+    {
+      lastCard = mSlots[i].mCard;
+      lastCard->PrintStats();
+    }
+  }
+}
+
+unsigned long long PxiCommandExecutor::NowNs()
+{
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return static_cast<unsigned long long>(now.tv_sec) * 1000000000ull + now.tv_nsec;
+}
+
+PxiCommandExecutor::~PxiCommandExecutor()
+{
+  Stop();
+}
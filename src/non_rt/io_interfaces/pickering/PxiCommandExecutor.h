@@ -0,0 +1,128 @@
+#ifndef _PXICOMMANDEXECUTOR_H_
+#define _PXICOMMANDEXECUTOR_H_
+
+#include <pthread.h>
+#include <stdio.h>
+#include <time.h>
+
+#include <atomic>
+#include <memory>
+#include <thread>
+
+#include <PxiCard.h>
+#include <PxiTypes.h>
+#include <RtSpscRing.h>
+#include <SafeState.h>
+
+namespace PxiExecutor
+{
+constexpr auto kMaxSlots = 1024u;
+constexpr auto kMaxProducers = 8u;
+constexpr auto kIdleSleepNs = 50000l; // 50 us
+constexpr auto kStatsPeriodNs = 1000000000ull;
+}
+
+/*
+ * one coalescing point: the latest state an rt task wants on a subunit (mBit == 0)
+ * or on a single switch bit
+ */
+struct PxiCommandSlot
+{
+  std::shared_ptr<PxiCard> mCard;
+  DWORD mSubunit;
+  DWORD mBit;
+  unsigned int mProducer;
+  unsigned long long mDeadlineNs;
+
+  std::atomic<DWORD> mValue;
+  std::atomic<bool> mPending;
+  std::atomic<unsigned long long> mPostedNs;
+  std::atomic<unsigned long long> mPosts;
+};
+
+/*
+ * completion report of one applied slot, handed back to the producing rt task
+ */
+struct PxiCommandStatus
+{
+  int mHandle;
+  DWORD mValue;
+  int mResult;
+  bool mDeadlineMissed;
+  unsigned long long mPostedNs;
+  unsigned long long mCompletedNs;
+};
+
+struct PxiExecutorStats
+{
+  unsigned long long mApplied;
+  unsigned long long mDeadlineMisses;
+  unsigned long long mErrors;
+  unsigned long long mStatusDrops;
+  unsigned long long mMinLatencyNs;
+  unsigned long long mMaxLatencyNs;
+  unsigned long long mTotalLatencyNs;
+};
+
+/*
+ * applies card states requested by rt tasks from a dedicated linux thread
+ *
+ * rt tasks only touch atomics and lock-free rings in Post() and PollStatus(), so the
+ * pilpxi calls, which may syscall into the driver, never demote them to secondary
+ * mode. posting to a slot that is still pending only replaces its value, so a slow
+ * card sees the latest state rather than a backlog.
+ * slots and producers must be registered before the rt tasks start posting to them.
+ */
+class PxiCommandExecutor
+{
+private:
+  typedef RtSpscRing<int, PxiExecutor::kMaxSlots> tReadyRing;
+  typedef RtSpscRing<PxiCommandStatus, PxiExecutor::kMaxSlots> tStatusRing;
+
+  std::unique_ptr<PxiCommandSlot[]> mSlots;
+  std::atomic<unsigned int> mNumSlots;
+
+  std::unique_ptr<tReadyRing[]> mReadyRings;
+  std::unique_ptr<tStatusRing[]> mStatusRings;
+  std::atomic<unsigned int> mNumProducers;
+
+  std::thread mThread;
+  std::atomic<bool> mRunning;
+  int mCoreId;
+  bool mPrintStats;
+
+  void Run();
+  void Apply(const int handle);
+
+  static void EnterSafeState(void *executor);
+
+public:
+  PxiExecutorStats mStats;
+
+public:
+  PxiCommandExecutor(const int coreId=-1, const bool printStats=true);
+
+  int RegisterProducer();
+  int RegisterSubunit(const int producer, std::shared_ptr<PxiCard> card,
+    const DWORD subunit, const unsigned long long deadlineNs);
+  int RegisterBit(const int producer, std::shared_ptr<PxiCard> card,
+    const DWORD subunit, const DWORD bit, const unsigned long long deadlineNs);
+
+  int Start();
+  void Stop();
+  // stops applying posts when the process enters its safe state, so nothing the rt
+  // tasks still post reaches the cards after they were made safe
+  int RegisterSafeState(SafeState &safeState);
+
+  // rt side
+  void Post(const int handle, const DWORD value);
+  bool PollStatus(const int producer, PxiCommandStatus &status);
+
+  void PrintStats() const;
+
+  static unsigned long long NowNs();
+
+  ~PxiCommandExecutor();
+};
+
+#endif // _PXICOMMANDEXECUTOR_H_
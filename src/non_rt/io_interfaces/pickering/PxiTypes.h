@@ -0,0 +1,25 @@
+#ifndef _PXITYPES_H_
+#define _PXITYPES_H_
+
+/*
+ * pilpxi types, without requiring the pickering headers when only the simulated
+ * backend is built
+ */
+#ifdef PXI_SIMULATED_BACKEND
+#include <stdint.h>
+
+typedef uint32_t DWORD;
+typedef int BOOL;
+typedef char CHAR;
+#else
+#include <Pilpxi.h>
+#endif
+
+// pilpxi subunit type numbers
+namespace PxiSubunitType
+{
+constexpr DWORD kSwitch = 1u;
+constexpr DWORD kResistor = 7u;
+}
+
+#endif // _PXITYPES_H_
@@ -0,0 +1,346 @@
+#include <SimulatedPxiBackend.h>
+
+namespace {
+
+unsigned long long NowNs()
+{
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return static_cast<unsigned long long>(now.tv_sec) * 1000000000ull + now.tv_nsec;
+}
+
+} // namespace
+
+SimulatedPxiBackend::SimulatedPxiBackend(const std::vector<SimulatedCardConfig> &cards,
+  const SimulatedLatencyConfig &latency, const unsigned int seed)
+  : mLatency(latency)
+  , mGenerator(seed)
+{
+  for(auto &config : cards)
+  {
+    SimulatedCard card{config, false, {}};
+    for(auto &subunit : config.mSubunits)
+    {
+      auto words = (subunit.mRows * subunit.mCols + 31u) / 32u;
+      card.mData.emplace_back(words ? words : 1u, 0u);
+    }
+    mCards.push_back(card);
+  }
+
+  mStats.mViewSubs = 0;
+  mStats.mWriteSubs = 0;
+  mStats.mOpBits = 0;
+  mStats.mBusyNs = 0;
+}
+
+std::vector<SimulatedCardConfig> SimulatedPxiBackend::MakeRack(
+  const unsigned int numResistanceCards, const unsigned int numSwitchCards,
+  const unsigned int subunitsPerCard)
+{
+  std::vector<SimulatedCardConfig> cards;
+  auto device{10u};
+  for(auto i{0u}; i < numResistanceCards + numSwitchCards; ++i)
+  {
+    bool resistor = i < numResistanceCards;
+    SimulatedCardConfig card;
+    card.mBus = 1;
+    card.mDevice = device++;
+    card.mCardId = resistor ? "40-297-002,SIM,1.0" : "40-139-101,SIM,1.0";
+    for(auto s{0u}; s < subunitsPerCard; ++s)
+    {
+      if(resistor)
+        card.mSubunits.push_back(SimulatedSubunitConfig{
+          PxiSubunitType::kResistor, 1, 24, 10, 100000});
+      else
+        card.mSubunits.push_back(SimulatedSubunitConfig{
+          PxiSubunitType::kSwitch, 1, 16, 0, 0});
+    }
+    cards.push_back(card);
+  }
+  return cards;
+}
+
+SimulatedLatencyConfig SimulatedPxiBackend::DriverLatency()
+{
+  // rough orders of magnitude of the pilpxi kernel driver, tune them to the rack being modelled
+  return SimulatedLatencyConfig{
+    {30000000., 5000000., false}, // open: enumerate and map the card
+    {2000., 500., true},          // queries answered from the library cache
+    {8000., 2000., true},         // view sub: register reads
+    {25000., 8000., true},        // write sub: register writes and relay settle check
+    {18000., 6000., true}};       // op bit
+}
+
+SimulatedLatencyConfig SimulatedPxiBackend::NoLatency()
+{
+  return SimulatedLatencyConfig{
+    {0., 0., false}, {0., 0., false}, {0., 0., false}, {0., 0., false}, {0., 0., false}};
+}
+
+SimulatedPxiBackend::SimulatedCard* SimulatedPxiBackend::GetCard(DWORD cardNum)
+{
+  if(cardNum == 0 || cardNum > mCards.size() || !mCards[cardNum - 1].mOpen)
+    return nullptr;
+  return &mCards[cardNum - 1];
+}
+
+void SimulatedPxiBackend::Delay(const SimulatedLatency &latency)
+{
+  if(latency.mMeanNs <= 0.)
+    return;
+
+  double delayNs;
+  {
+    // the executor and the opening threads draw from the one generator in turn
+    std::lock_guard<std::mutex> lock(mGeneratorMutex);
+    if(latency.mLogNormal)
+    {
+      auto variance = latency.mStdDevNs * latency.mStdDevNs;
+      auto sigma2 = std::log(1. + variance / (latency.mMeanNs * latency.mMeanNs));
+      std::lognormal_distribution<double> distribution(
+        std::log(latency.mMeanNs) - sigma2 / 2., std::sqrt(sigma2));
+      delayNs = distribution(mGenerator);
+    }
+    else
+    {
+      std::normal_distribution<double> distribution(latency.mMeanNs, latency.mStdDevNs);
+      delayNs = std::max(0., distribution(mGenerator));
+    }
+  }
+
+  mStats.mBusyNs += static_cast<unsigned long long>(delayNs);
+  if(delayNs > PxiSimulation::kSpinLimitNs)
+  {
+    struct timespec sleep{static_cast<time_t>(delayNs / 1e9),
+      static_cast<long>(std::fmod(delayNs, 1e9))};
+    nanosleep(&sleep, NULL);
+    return;
+  }
+
+  // short driver calls keep the calling thread busy, so spin rather than sleep
+  auto end = NowNs() + static_cast<unsigned long long>(delayNs);
+  while(NowNs() < end)
+  {}
+}
+
+DWORD SimulatedPxiBackend::CountFreeCards(DWORD *numCards)
+{
+  Delay(mLatency.mQuery);
+  *numCards = 0;
+  for(auto &card : mCards)
+  {
+    if(!card.mOpen)
+      ++*numCards;
+  }
+  return 0;
+}
+
+DWORD SimulatedPxiBackend::FindFreeCards(DWORD numCards, DWORD *buses, DWORD *devices)
+{
+  Delay(mLatency.mQuery);
+  auto found{0u};
+  for(auto &card : mCards)
+  {
+    if(found == numCards)
+      break;
+    if(card.mOpen)
+      continue;
+    buses[found] = card.mConfig.mBus;
+    devices[found] = card.mConfig.mDevice;
+    ++found;
+  }
+  return 0;
+}
+
+DWORD SimulatedPxiBackend::OpenSpecifiedCard(DWORD bus, DWORD device, DWORD *cardNum)
+{
+  Delay(mLatency.mOpen);
+
+  std::lock_guard<std::mutex> lock(mOpenMutex);
+  for(auto i{0u}; i < mCards.size(); ++i)
+  {
+    auto &card = mCards[i];
+    if(card.mConfig.mBus != bus || card.mConfig.mDevice != device)
+      continue;
+    if(card.mOpen)
+      return PxiSimulation::kErrorCardInUse;
+
+    card.mOpen = true;
+    *cardNum = i + 1;
+    return 0;
+  }
+  return PxiSimulation::kErrorBadCard;
+}
+
+DWORD SimulatedPxiBackend::CloseSpecifiedCard(DWORD cardNum)
+{
+  std::lock_guard<std::mutex> lock(mOpenMutex);
+  auto *card = GetCard(cardNum);
+  if(!card)
+    return PxiSimulation::kErrorBadCard;
+  card->mOpen = false;
+  return 0;
+}
+
+DWORD SimulatedPxiBackend::ClearCard(DWORD cardNum)
+{
+  auto *card = GetCard(cardNum);
+  if(!card)
+    return PxiSimulation::kErrorBadCard;
+
+  Delay(mLatency.mWriteSub);
+  for(auto &words : card->mData)
+  {
+    for(auto &word : words)
+    {
+      word = 0;
+    }
+  }
+  return 0;
+}
+
+DWORD SimulatedPxiBackend::CardId(DWORD cardNum, CHAR *cardId)
+{
+  auto *card = GetCard(cardNum);
+  if(!card)
+    return PxiSimulation::kErrorBadCard;
+
+  Delay(mLatency.mQuery);
+  strcpy(cardId, card->mConfig.mCardId.c_str());
+  return 0;
+}
+
+DWORD SimulatedPxiBackend::EnumerateSubs(DWORD cardNum, DWORD *inSubs, DWORD *outSubs)
+{
+  auto *card = GetCard(cardNum);
+  if(!card)
+    return PxiSimulation::kErrorBadCard;
+
+  Delay(mLatency.mQuery);
+  *inSubs = 0;
+  *outSubs = card->mConfig.mSubunits.size();
+  return 0;
+}
+
+DWORD SimulatedPxiBackend::SubInfo(DWORD cardNum, DWORD subunit, BOOL out,
+  DWORD *typeNum, DWORD *rows, DWORD *cols)
+{
+  auto *card = GetCard(cardNum);
+  if(!card)
+    return PxiSimulation::kErrorBadCard;
+  if(!out || subunit == 0 || subunit > card->mConfig.mSubunits.size())
+    return PxiSimulation::kErrorBadSubunit;
+
+  Delay(mLatency.mQuery);
+  auto &config = card->mConfig.mSubunits[subunit - 1];
+  *typeNum = config.mTypeNum;
+  *rows = config.mRows;
+  *cols = config.mCols;
+  return 0;
+}
+
+DWORD SimulatedPxiBackend::SubType(DWORD cardNum, DWORD subunit, BOOL out, CHAR *subType)
+{
+  auto *card = GetCard(cardNum);
+  if(!card)
+    return PxiSimulation::kErrorBadCard;
+  if(!out || subunit == 0 || subunit > card->mConfig.mSubunits.size())
+    return PxiSimulation::kErrorBadSubunit;
+
+  Delay(mLatency.mQuery);
+  auto &config = card->mConfig.mSubunits[subunit - 1];
+  sprintf(subType, "%s(%d)",
+    config.mTypeNum == PxiSubunitType::kResistor ? "RES" : "SWITCH", config.mCols);
+  return 0;
+}
+
+DWORD SimulatedPxiBackend::ViewSub(DWORD cardNum, DWORD subunit, DWORD *data)
+{
+  auto *card = GetCard(cardNum);
+  if(!card)
+    return PxiSimulation::kErrorBadCard;
+  if(subunit == 0 || subunit > card->mData.size())
+    return PxiSimulation::kErrorBadSubunit;
+
+  Delay(mLatency.mViewSub);
+  ++mStats.mViewSubs;
+  auto &words = card->mData[subunit - 1];
+  memcpy(data, words.data(), words.size() * sizeof(DWORD));
+  return 0;
+}
+
+DWORD SimulatedPxiBackend::WriteSub(DWORD cardNum, DWORD subunit, DWORD *data)
+{
+  auto *card = GetCard(cardNum);
+  if(!card)
+    return PxiSimulation::kErrorBadCard;
+  if(subunit == 0 || subunit > card->mData.size())
+    return PxiSimulation::kErrorBadSubunit;
+
+  Delay(mLatency.mWriteSub);
+  ++mStats.mWriteSubs;
+  auto &config = card->mConfig.mSubunits[subunit - 1];
+  auto &words = card->mData[subunit - 1];
+  memcpy(words.data(), data, words.size() * sizeof(DWORD));
+
+  // a resistor subunit settles on the closest value it can realize
+  if(config.mTypeNum == PxiSubunitType::kResistor)
+    words[0] = std::min(std::max(words[0], config.mMinOhm), config.mMaxOhm);
+  return 0;
+}
+
+DWORD SimulatedPxiBackend::OpBit(DWORD cardNum, DWORD subunit, DWORD bit, BOOL state)
+{
+  auto *card = GetCard(cardNum);
+  if(!card)
+    return PxiSimulation::kErrorBadCard;
+  if(subunit == 0 || subunit > card->mData.size())
+    return PxiSimulation::kErrorBadSubunit;
+
+  auto &config = card->mConfig.mSubunits[subunit - 1];
+  if(bit == 0 || bit > config.mRows * config.mCols)
+    return PxiSimulation::kErrorBadBit;
+
+  Delay(mLatency.mOpBit);
+  ++mStats.mOpBits;
+  auto &word = card->mData[subunit - 1][(bit - 1) / 32u];
+  const DWORD mask = 1u << ((bit - 1) % 32u);
+  word = state ? (word | mask) : (word & ~mask);
+  return 0;
+}
+
+DWORD SimulatedPxiBackend::ViewBit(DWORD cardNum, DWORD subunit, DWORD bit, BOOL *state)
+{
+  auto *card = GetCard(cardNum);
+  if(!card)
+    return PxiSimulation::kErrorBadCard;
+  if(subunit == 0 || subunit > card->mData.size())
+    return PxiSimulation::kErrorBadSubunit;
+
+  auto &config = card->mConfig.mSubunits[subunit - 1];
+  if(bit == 0 || bit > config.mRows * config.mCols)
+    return PxiSimulation::kErrorBadBit;
+
+  Delay(mLatency.mViewSub);
+  ++mStats.mViewSubs;
+  *state = (card->mData[subunit - 1][(bit - 1) / 32u] >> ((bit - 1) % 32u)) & 1u;
+  return 0;
+}
+
+DWORD SimulatedPxiBackend::ResInfo(DWORD cardNum, DWORD subunit, double *minRes, double *maxRes)
+{
+  auto *card = GetCard(cardNum);
+  if(!card)
+    return PxiSimulation::kErrorBadCard;
+  if(subunit == 0 || subunit > card->mData.size())
+    return PxiSimulation::kErrorBadSubunit;
+
+  auto &config = card->mConfig.mSubunits[subunit - 1];
+  if(config.mTypeNum != PxiSubunitType::kResistor)
+    return PxiSimulation::kErrorBadSubunit;
+
+  Delay(mLatency.mQuery);
+  *minRes = config.mMinOhm;
+  *maxRes = config.mMaxOhm;
+  return 0;
+}
@@ -0,0 +1,128 @@
+#ifndef _SIMULATEDPXIBACKEND_H_
+#define _SIMULATEDPXIBACKEND_H_
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <mutex>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <PxiBackend.h>
+
+namespace PxiSimulation
+{
+constexpr auto kErrorBadCard = 1u;
+constexpr auto kErrorBadSubunit = 2u;
+constexpr auto kErrorBadBit = 3u;
+constexpr auto kErrorCardInUse = 4u;
+
+// delays above this are slept rather than spun
+constexpr auto kSpinLimitNs = 200000.;
+}
+
+/*
+ * per-call latency: a normal or log-normal distribution, in nanoseconds
+ */
+struct SimulatedLatency
+{
+  double mMeanNs;
+  double mStdDevNs;
+  bool mLogNormal;
+};
+
+struct SimulatedLatencyConfig
+{
+  SimulatedLatency mOpen;
+  SimulatedLatency mQuery;
+  SimulatedLatency mViewSub;
+  SimulatedLatency mWriteSub;
+  SimulatedLatency mOpBit;
+};
+
+struct SimulatedSubunitConfig
+{
+  DWORD mTypeNum;
+  DWORD mRows;
+  DWORD mCols;
+  DWORD mMinOhm;
+  DWORD mMaxOhm;
+};
+
+struct SimulatedCardConfig
+{
+  DWORD mBus;
+  DWORD mDevice;
+  std::string mCardId;
+  std::vector<SimulatedSubunitConfig> mSubunits;
+};
+
+struct SimulatedCallStats
+{
+  std::atomic<unsigned long long> mViewSubs;
+  std::atomic<unsigned long long> mWriteSubs;
+  std::atomic<unsigned long long> mOpBits;
+  std::atomic<unsigned long long> mBusyNs;
+};
+
+/*
+ * PxiBackend that models cards, subunits, resistance ranges and switch bits in memory
+ * each call spends a delay drawn from its latency distribution, mimicking the time the
+ * real driver spends in the kernel, so the update engine can be profiled off-rig
+ */
+class SimulatedPxiBackend : public PxiBackend
+{
+private:
+  struct SimulatedCard
+  {
+    SimulatedCardConfig mConfig;
+    bool mOpen;
+    std::vector<std::vector<DWORD>> mData;
+  };
+
+  std::vector<SimulatedCard> mCards;
+  SimulatedLatencyConfig mLatency;
+  std::mutex mOpenMutex;
+  // seeded per backend, so its delays repeat whichever threads call it
+  std::mt19937 mGenerator;
+  std::mutex mGeneratorMutex;
+
+  SimulatedCard* GetCard(DWORD cardNum);
+  void Delay(const SimulatedLatency &latency);
+
+public:
+  SimulatedCallStats mStats;
+
+public:
+  SimulatedPxiBackend() = delete;
+  SimulatedPxiBackend(const std::vector<SimulatedCardConfig> &cards,
+    const SimulatedLatencyConfig &latency, const unsigned int seed=1);
+
+  static std::vector<SimulatedCardConfig> MakeRack(const unsigned int numResistanceCards,
+    const unsigned int numSwitchCards, const unsigned int subunitsPerCard);
+  static SimulatedLatencyConfig DriverLatency();
+  static SimulatedLatencyConfig NoLatency();
+
+  DWORD CountFreeCards(DWORD *numCards) override;
+  DWORD FindFreeCards(DWORD numCards, DWORD *buses, DWORD *devices) override;
+  DWORD OpenSpecifiedCard(DWORD bus, DWORD device, DWORD *cardNum) override;
+  DWORD CloseSpecifiedCard(DWORD cardNum) override;
+  DWORD ClearCard(DWORD cardNum) override;
+  DWORD CardId(DWORD cardNum, CHAR *cardId) override;
+  DWORD EnumerateSubs(DWORD cardNum, DWORD *inSubs, DWORD *outSubs) override;
+  DWORD SubInfo(DWORD cardNum, DWORD subunit, BOOL out,
+    DWORD *typeNum, DWORD *rows, DWORD *cols) override;
+  DWORD SubType(DWORD cardNum, DWORD subunit, BOOL out, CHAR *subType) override;
+  DWORD ViewSub(DWORD cardNum, DWORD subunit, DWORD *data) override;
+  DWORD WriteSub(DWORD cardNum, DWORD subunit, DWORD *data) override;
+  DWORD OpBit(DWORD cardNum, DWORD subunit, DWORD bit, BOOL state) override;
+  DWORD ViewBit(DWORD cardNum, DWORD subunit, DWORD bit, BOOL *state) override;
+  DWORD ResInfo(DWORD cardNum, DWORD subunit, double *minRes, double *maxRes) override;
+};
+
+#endif // _SIMULATEDPXIBACKEND_H_
@@ -2,7 +2,9 @@
 #define __ELAPSEDTIMES_HPP__
 
 #include <chrono>
+#include <climits>
 #include <iomanip>
+#include <iostream>
 #include <string>
 #include <vector>
 
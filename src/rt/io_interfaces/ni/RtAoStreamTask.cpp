@@ -0,0 +1,15 @@
+#include <RtAoStreamTask.h>
+
+RtAoStreamTask::RtAoStreamTask(
+  std::shared_ptr<AoStream> stream, const char *name,
+  const int stackSize, const int priority, const int mode, const int period,
+  const int coreId)
+  : RtPollTask(stream, "ao error, the dacs hold their last update", true,
+    name, stackSize, priority, mode, period, coreId)
+  , mInitial{}
+{}
+
+int RtAoStreamTask::StartService()
+{
+  return mService->Start(mInitial);
+}
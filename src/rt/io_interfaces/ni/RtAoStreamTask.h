@@ -0,0 +1,30 @@
+#ifndef _RTAOSTREAMTASK_H_
+#define _RTAOSTREAMTASK_H_
+
+#include <memory>
+
+#include <AoStream.h>
+#include <RtPollTask.h>
+
+/*
+ * writes the frames the model pushed into an ao stream every period
+ *
+ * the model step pushes one frame per update from its own task, this one only moves
+ * them to the hardware. the period sets the write-ahead the stream settles at, about
+ * twice the updates of one period, and with it the latency from step to dac.
+ */
+class RtAoStreamTask : public RtPollTask<RtAoStreamTask, AoStream>
+{
+public:
+  AoFrame mInitial;
+
+public:
+  RtAoStreamTask() = delete;
+  RtAoStreamTask(std::shared_ptr<AoStream> stream,
+    const char *name, const int stackSize, const int priority, const int mode,
+    const int period, const int coreId);
+
+  int StartService();
+};
+
+#endif // _RTAOSTREAMTASK_H_
@@ -0,0 +1,9 @@
+#include <RtDynoSensingTask.h>
+
+RtDynoSensingTask::RtDynoSensingTask(
+  std::shared_ptr<DynoSensingFilter> filter, const char *name,
+  const int stackSize, const int priority, const int mode, const int period,
+  const int coreId)
+  : RtPollTask(filter, "channel error, the sensor values it carries stop", false,
+    name, stackSize, priority, mode, period, coreId)
+{}
@@ -0,0 +1,25 @@
+#ifndef _RTDYNOSENSINGTASK_H_
+#define _RTDYNOSENSINGTASK_H_
+
+#include <memory>
+
+#include <DynoSensingFilter.h>
+#include <RtPollTask.h>
+
+/*
+ * serves the ni device service of the dyno sensors and filters what it scanned
+ *
+ * every period this task polls the service and runs the new ai blocks through the
+ * decimation filters; the model step takes the newest values from its own task. the
+ * period only sets the age of a value, the filters see every scan whatever it is.
+ */
+class RtDynoSensingTask : public RtPollTask<RtDynoSensingTask, DynoSensingFilter>
+{
+public:
+  RtDynoSensingTask() = delete;
+  RtDynoSensingTask(std::shared_ptr<DynoSensingFilter> filter,
+    const char *name, const int stackSize, const int priority, const int mode,
+    const int period, const int coreId);
+};
+
+#endif // _RTDYNOSENSINGTASK_H_
@@ -0,0 +1,9 @@
+#include <RtEncoderMeasurementTask.h>
+
+RtEncoderMeasurementTask::RtEncoderMeasurementTask(
+  std::shared_ptr<EncoderMeasurement> encoder, const char *name,
+  const int stackSize, const int priority, const int mode, const int period,
+  const int coreId)
+  : RtPollTask(encoder, "channel error, the dyno speed stops", false,
+    name, stackSize, priority, mode, period, coreId)
+{}
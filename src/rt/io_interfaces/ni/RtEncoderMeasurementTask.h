@@ -0,0 +1,25 @@
+#ifndef _RTENCODERMEASUREMENTTASK_H_
+#define _RTENCODERMEASUREMENTTASK_H_
+
+#include <memory>
+
+#include <EncoderMeasurement.h>
+#include <RtPollTask.h>
+
+/*
+ * serves the ni device service of the dyno encoder and decodes its edges
+ *
+ * every period this task polls the service and decodes the new semi-periods of both
+ * lines; the model step takes the newest speed from its own task. the period sets the
+ * age of a value and how soon a stall shows, the decoder sees every edge whatever it is.
+ */
+class RtEncoderMeasurementTask : public RtPollTask<RtEncoderMeasurementTask, EncoderMeasurement>
+{
+public:
+  RtEncoderMeasurementTask() = delete;
+  RtEncoderMeasurementTask(std::shared_ptr<EncoderMeasurement> encoder,
+    const char *name, const int stackSize, const int priority, const int mode,
+    const int period, const int coreId);
+};
+
+#endif // _RTENCODERMEASUREMENTTASK_H_
@@ -0,0 +1,9 @@
+#include <RtNiDeviceTask.h>
+
+RtNiDeviceTask::RtNiDeviceTask(
+  std::shared_ptr<NiDeviceService> service, const char *name,
+  const int stackSize, const int priority, const int mode, const int period,
+  const int coreId)
+  : RtPollTask(service, "channel error, the other channels keep running", false,
+    name, stackSize, priority, mode, period, coreId)
+{}
@@ -0,0 +1,26 @@
+#ifndef _RTNIDEVICETASK_H_
+#define _RTNIDEVICETASK_H_
+
+#include <memory>
+
+#include <NiDeviceService.h>
+#include <RtPollTask.h>
+
+/*
+ * the one service loop of an ni board: every period it polls the dma channels of all
+ * enabled subsystems and moves their data through the service rings
+ *
+ * the period and the ring depth bound how long a consumer may fall behind before input
+ * blocks are dropped or an output runs dry. a failed channel is left out of later
+ * polls, the others keep running.
+ */
+class RtNiDeviceTask : public RtPollTask<RtNiDeviceTask, NiDeviceService>
+{
+public:
+  RtNiDeviceTask() = delete;
+  RtNiDeviceTask(std::shared_ptr<NiDeviceService> service,
+    const char *name, const int stackSize, const int priority, const int mode,
+    const int period, const int coreId);
+};
+
+#endif // _RTNIDEVICETASK_H_
@@ -0,0 +1,122 @@
+#ifndef _RTPOLLTASK_H_
+#define _RTPOLLTASK_H_
+
+#include <stdlib.h>
+#include <sys/mman.h>
+
+#include <memory>
+
+#include <RtMacro.h>
+#include <RtPeriodicTask.h>
+
+#ifdef kMMIOProfiling
+#include <osiMMIOProfile.h>
+#endif
+
+/*
+ * the periodic loop every ni service task shares: start the service, step it every
+ * period, print its stats and the register profile once a second
+ *
+ * Task derives from RtPollTask<Task, Service> and may hide StartService() and Step()
+ * with its own, they are called on Task without a virtual call. Service provides
+ * Start(), Poll(), Stop() and PrintStats(elapsedNs, print). the first of consecutive
+ * failed steps prints mFailure; with mStopOnFailure the task stops stepping then, for
+ * services whose hardware must not be touched after an error.
+ */
+template <class Task, class Service>
+class RtPollTask : public RtPeriodicTask
+{
+public:
+  std::shared_ptr<Service> mService;
+  const char *mFailure;
+  bool mStopOnFailure;
+
+public:
+  RtPollTask() = delete;
+  RtPollTask(std::shared_ptr<Service> service, const char *failure, const bool stopOnFailure,
+    const char *name, const int stackSize, const int priority, const int mode,
+    const int period, const int coreId)
+    : RtPeriodicTask(name, stackSize, priority, mode, period, coreId)
+    , mService(service)
+    , mFailure(failure)
+    , mStopOnFailure(stopOnFailure)
+  {}
+
+  int StartRoutine()
+  {
+    mlockall(MCL_CURRENT|MCL_FUTURE);
+
+    int e1 = rt_task_create(&mRtTask, mName, mStackSize, mPriority, mMode);
+    int e2 = rt_task_set_periodic(&mRtTask, TM_NOW, rt_timer_ns2ticks(mPeriod));
+    int e3 = (mCoreId > 0) ? rt_task_set_affinity(&mRtTask, &mCpuSet) : 0;
+    int e4 = rt_task_start(&mRtTask, &RtPollTask::Routine, this);
+
+    if(e1 | e2 | e3 | e4)
+    {
+      printf("Error with %s StartRoutine(). Exiting.\n", mName);
+      return -1;
+    }
+    printf("%s running on CoreId: %d\n", mName, mCoreId);
+    return 0;
+  }
+
+  static void Routine(void *arg)
+  {
+    auto *task = static_cast<Task*>(static_cast<RtPollTask*>(arg));
+
+    if(task->StartService())
+      return;
+
+    RTIME oneSecondTimer = rt_timer_read();
+    auto failed{false};
+    auto stopped{false};
+    while(true)
+    {
+      if(!stopped)
+      {
+        const auto result = task->Step();
+        if(result < 0 && !failed)
+          rt_printf("%s: %s\n", task->mName, task->mFailure);
+        failed = result < 0;
+        stopped = failed && task->mStopOnFailure;
+      }
+
+#ifdef kMMIOProfiling
+      getMMIOProfile().markIteration();
+#endif
+
+      RTIME now = rt_timer_read();
+      if(static_cast<long>(now - oneSecondTimer) / RtTime::kNanosecondsToSeconds > 0)
+      {
+        task->mService->PrintStats(now - oneSecondTimer, rt_printf);
+#ifdef kMMIOProfiling
+        // register accesses per period, hottest first
+        getMMIOProfile().report(8, rt_printf);
+        getMMIOProfile().reset();
+#endif
+        oneSecondTimer = now;
+      }
+      rt_task_wait_period(NULL);
+    }
+  }
+
+  // the service-specific part of the loop, a task hides these with its own
+  int StartService()
+  {
+    return mService->Start();
+  }
+  int Step()
+  {
+    return mService->Poll();
+  }
+
+  ~RtPollTask()
+  {
+    int e = rt_task_delete(&mRtTask);
+    if(e)
+      printf("Error deleting task %s\n", mName);
+    mService->Stop();
+  }
+};
+
+#endif // _RTPOLLTASK_H_
@@ -0,0 +1,9 @@
+#include <RtPositionSensorTask.h>
+
+RtPositionSensorTask::RtPositionSensorTask(
+  std::shared_ptr<PositionSensorEmulator> emulator, const char *name,
+  const int stackSize, const int priority, const int mode, const int period,
+  const int coreId)
+  : RtPollTask(emulator, "channel error, the sensor signals it carries stop", false,
+    name, stackSize, priority, mode, period, coreId)
+{}
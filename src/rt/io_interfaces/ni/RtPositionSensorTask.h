@@ -0,0 +1,25 @@
+#ifndef _RTPOSITIONSENSORTASK_H_
+#define _RTPOSITIONSENSORTASK_H_
+
+#include <memory>
+
+#include <PositionSensorEmulator.h>
+#include <RtPollTask.h>
+
+/*
+ * serves the ni device service of a position sensor emulator and computes its outputs
+ *
+ * the model step publishes its angle from its own task. every period this one polls the
+ * service, then computes the sensor signals up to the write-ahead, which must cover two
+ * of its periods: what is computed now goes to the hardware with the next poll.
+ */
+class RtPositionSensorTask : public RtPollTask<RtPositionSensorTask, PositionSensorEmulator>
+{
+public:
+  RtPositionSensorTask() = delete;
+  RtPositionSensorTask(std::shared_ptr<PositionSensorEmulator> emulator,
+    const char *name, const int stackSize, const int priority, const int mode,
+    const int period, const int coreId);
+};
+
+#endif // _RTPOSITIONSENSORTASK_H_
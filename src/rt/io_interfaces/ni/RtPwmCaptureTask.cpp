@@ -0,0 +1,9 @@
+#include <RtPwmCaptureTask.h>
+
+RtPwmCaptureTask::RtPwmCaptureTask(
+  std::shared_ptr<PwmCapture> capture, const char *name,
+  const int stackSize, const int priority, const int mode, const int period,
+  const int coreId)
+  : RtPollTask(capture, "capture error, the duty cycles read 0 %", true,
+    name, stackSize, priority, mode, period, coreId)
+{}
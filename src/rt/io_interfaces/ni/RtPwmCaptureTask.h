@@ -0,0 +1,25 @@
+#ifndef _RTPWMCAPTURETASK_H_
+#define _RTPWMCAPTURETASK_H_
+
+#include <memory>
+
+#include <PwmCapture.h>
+#include <RtPollTask.h>
+
+/*
+ * drains the pwm capture dma rings every period and publishes the duty cycles
+ *
+ * the period bounds how old a captured edge can be when the model step sees it, so it
+ * is kept well below the pwm period. a dma or counter error stops the capture after
+ * publishing that no phase is measured anymore, the model then drives no phase.
+ */
+class RtPwmCaptureTask : public RtPollTask<RtPwmCaptureTask, PwmCapture>
+{
+public:
+  RtPwmCaptureTask() = delete;
+  RtPwmCaptureTask(std::shared_ptr<PwmCapture> capture,
+    const char *name, const int stackSize, const int priority, const int mode,
+    const int period, const int coreId);
+};
+
+#endif // _RTPWMCAPTURETASK_H_
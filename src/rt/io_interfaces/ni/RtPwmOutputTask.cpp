@@ -0,0 +1,47 @@
+#include <RtPwmOutputTask.h>
+
+#include <PwmDutyDecoder.h>
+
+RtPwmOutputTask::RtPwmOutputTask(
+  std::shared_ptr<PwmOutput> output, const char *name,
+  const int stackSize, const int priority, const int mode, const int period,
+  const int coreId)
+  : RtPollTask(output, "output error, the counter holds its last pulse", true,
+    name, stackSize, priority, mode, period, coreId)
+  , mUpdatePeriodNs(0)
+  , mDueNs(0)
+  , mSource(NULL)
+  , mSourceContext(NULL)
+  , mInitial{PwmOutputLimit::kMinTicks, PwmOutputLimit::kMinTicks}
+{}
+
+int RtPwmOutputTask::StartRoutine()
+{
+  if(!mSource)
+  {
+    printf("RtPwmOutputTask needs a pulse source. Exiting.\n");
+    return -1;
+  }
+  return RtPollTask::StartRoutine();
+}
+
+int RtPwmOutputTask::StartService()
+{
+  // update periods per task period, the remainder carries over
+  mUpdatePeriodNs = mService->UpdatePeriodTicks() * PwmCaptureLimit::kNanosecondsPerTick;
+  mDueNs = 0;
+  return mService->Start(mInitial);
+}
+
+int RtPwmOutputTask::Step()
+{
+  mDueNs += mPeriod;
+  while(mDueNs >= mUpdatePeriodNs)
+  {
+    PwmPulse pulse;
+    mSource(mSourceContext, pulse);
+    mService->Push(pulse);
+    mDueNs -= mUpdatePeriodNs;
+  }
+  return mService->Poll();
+}
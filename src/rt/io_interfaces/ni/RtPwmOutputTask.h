@@ -0,0 +1,41 @@
+#ifndef _RTPWMOUTPUTTASK_H_
+#define _RTPWMOUTPUTTASK_H_
+
+#include <memory>
+
+#include <PwmOutput.h>
+#include <RtPollTask.h>
+
+// fills the pulse of one update period
+typedef void (*PwmPulseSource)(void *context, PwmPulse &pulse);
+
+/*
+ * feeds a pwm output every period
+ *
+ * the source is asked for one pulse per update period that fits in the task period,
+ * then the fifo is topped up. the write-ahead of the output must cover the task period
+ * and its wake-up jitter, or the counter holds its last pulse and counts an underrun.
+ */
+class RtPwmOutputTask : public RtPollTask<RtPwmOutputTask, PwmOutput>
+{
+private:
+  unsigned long long mUpdatePeriodNs;
+  unsigned long long mDueNs; // the remainder of the previous periods
+
+public:
+  PwmPulseSource mSource;
+  void *mSourceContext;
+  PwmPulse mInitial;
+
+public:
+  RtPwmOutputTask() = delete;
+  RtPwmOutputTask(std::shared_ptr<PwmOutput> output,
+    const char *name, const int stackSize, const int priority, const int mode,
+    const int period, const int coreId);
+
+  int StartRoutine();
+  int StartService();
+  int Step();
+};
+
+#endif // _RTPWMOUTPUTTASK_H_
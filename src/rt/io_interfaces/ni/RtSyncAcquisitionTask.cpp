@@ -0,0 +1,9 @@
+#include <RtSyncAcquisitionTask.h>
+
+RtSyncAcquisitionTask::RtSyncAcquisitionTask(
+  std::shared_ptr<SyncAcquisition> acquisition, const char *name,
+  const int stackSize, const int priority, const int mode, const int period,
+  const int coreId)
+  : RtPollTask(acquisition, "a board failed or dropped scans, the boards are out of step", false,
+    name, stackSize, priority, mode, period, coreId)
+{}
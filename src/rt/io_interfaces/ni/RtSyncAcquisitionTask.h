@@ -0,0 +1,25 @@
+#ifndef _RTSYNCACQUISITIONTASK_H_
+#define _RTSYNCACQUISITIONTASK_H_
+
+#include <memory>
+
+#include <SyncAcquisition.h>
+#include <RtPollTask.h>
+
+/*
+ * the one service loop of a group of synchronized ni boards
+ *
+ * every period this task polls every board and merges the scans all of them delivered
+ * into the ring of the acquisition. the polls are also what places the scans on the rt
+ * clock, so the closer a poll follows the scans the tighter their timestamps.
+ */
+class RtSyncAcquisitionTask : public RtPollTask<RtSyncAcquisitionTask, SyncAcquisition>
+{
+public:
+  RtSyncAcquisitionTask() = delete;
+  RtSyncAcquisitionTask(std::shared_ptr<SyncAcquisition> acquisition,
+    const char *name, const int stackSize, const int priority, const int mode,
+    const int period, const int coreId);
+};
+
+#endif // _RTSYNCACQUISITIONTASK_H_
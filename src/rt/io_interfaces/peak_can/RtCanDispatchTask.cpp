@@ -0,0 +1,45 @@
+#include <RtCanDispatchTask.h>
+
+RtCanDispatchTask::RtCanDispatchTask(
+  const char* name, const int stackSize, const int priority, const int mode,
+  const int period, const int coreId)
+  : RtPeriodicTask(name, stackSize, priority, mode, period, coreId)
+{}
+
+int RtCanDispatchTask::StartRoutine()
+{
+  mlockall(MCL_CURRENT|MCL_FUTURE);
+
+  int e1 = rt_task_create(&mRtTask, mName, mStackSize, mPriority, mMode);
+  int e2 = rt_task_set_periodic(&mRtTask, TM_NOW, rt_timer_ns2ticks(mPeriod));
+  int e3 = (mCoreId > 0) ? rt_task_set_affinity(&mRtTask, &mCpuSet) : 0;
+  int e4 = rt_task_start(&mRtTask, &Routine, this);
+
+  if(e1 | e2 | e3 | e4)
+  {
+    printf("Error with RtCanDispatchTask::StartRoutine(). Exiting.\n");
+    return -1;
+  }
+  return 0;
+}
+
+void RtCanDispatchTask::Routine(void *arg)
+{
+  auto *task = static_cast<RtCanDispatchTask*>(arg);
+
+  while(true)
+  {
+    for(auto &engine : task->mEngines)
+    {
+      engine->Dispatch();
+    }
+    rt_task_wait_period(NULL);
+  }
+}
+
+RtCanDispatchTask::~RtCanDispatchTask()
+{
+  int e = rt_task_delete(&mRtTask);
+  if(e)
+    printf("Error deleting task RtCanDispatchTask::mRtTask\n");
+}
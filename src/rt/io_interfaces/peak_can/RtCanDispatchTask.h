@@ -0,0 +1,33 @@
+#ifndef _RTCANDISPATCHTASK_H_
+#define _RTCANDISPATCHTASK_H_
+
+#include <sys/mman.h>
+
+#include <memory>
+#include <vector>
+
+#include <alchemy/task.h>
+
+#include <CanReceiveEngine.h>
+#include <RtPeriodicTask.h>
+
+/*
+ * runs the decoders of one or more CanReceiveEngines once per period, for processes
+ * whose model loop does not call Dispatch() itself
+ */
+class RtCanDispatchTask : public RtPeriodicTask
+{
+public:
+  std::vector<std::shared_ptr<CanReceiveEngine>> mEngines;
+
+public:
+  RtCanDispatchTask() = delete;
+  RtCanDispatchTask(
+    const char* name, const int stackSize, const int priority, const int mode,
+    const int period, const int coreId=0);
+  int StartRoutine();
+  static void Routine(void*);
+  ~RtCanDispatchTask();
+};
+
+#endif // _RTCANDISPATCHTASK_H_
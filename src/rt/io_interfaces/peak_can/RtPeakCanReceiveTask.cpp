@@ -1,77 +1,103 @@
 #include <RtPeakCanReceiveTask.h>
 
-namespace {
-
-/*
- * print out the content of a CAN message
- * ported from test/src/common.c
- */
-void PrintMessage(const char *prompt, TPCANMsg *m)
-{
-  int i;
-  /* print RTR, 11 or 29, CAN-Id and datalength */
-  printf("%s: %c %c 0x%08x %1d ",
-      prompt,
-      (m->MSGTYPE & MSGTYPE_STATUS) ? 'x' :
-        ((m->MSGTYPE & MSGTYPE_RTR) ? 'r' : 'm') -
-        ((m->MSGTYPE & MSGTYPE_SELFRECEIVE) ? 0x20 : 0),
-      (m->MSGTYPE & MSGTYPE_STATUS) ? '-' :
-        ((m->MSGTYPE & MSGTYPE_EXTENDED) ? 'e' : 's'),
-       m->ID,
-       m->LEN);
-  /* don't print any telegram contents for remote frames */
-  if (!(m->MSGTYPE & MSGTYPE_RTR))
-    for (i = 0; i < m->LEN; i++)
-      printf("%02x ", m->DATA[i]);
-  printf("\n");
-
-}
-
-} // namespace
-
 RtPeakCanReceiveTask::RtPeakCanReceiveTask(
   const char *deviceName, const unsigned int baudRate, const char *name,
   const int stackSize, const int priority, const int mode, const int period,
   const int coreId)
   : PeakCanTask(deviceName, baudRate)
   , RtPeriodicTask(name, stackSize, priority, mode, period, coreId)
+  , mStarted(false)
+  , mChannelIndex(0)
+{}
+
+RtPeakCanReceiveTask::RtPeakCanReceiveTask(
+  std::shared_ptr<CanDevice> device, const char *name,
+  const int stackSize, const int priority, const int mode, const int period,
+  const int coreId)
+  : PeakCanTask(device)
+  , RtPeriodicTask(name, stackSize, priority, mode, period, coreId)
+  , mStarted(false)
+  , mChannelIndex(0)
 {}
 
 int RtPeakCanReceiveTask::StartRoutine()
 {
+  mlockall(MCL_CURRENT|MCL_FUTURE);
+
+  // not periodic, the driver wakes the task up
   int e1 = rt_task_create(&mRtTask, mName, mStackSize, mPriority, mMode);
-  int e2 = rt_task_set_periodic(&mRtTask, TM_NOW, rt_timer_ns2ticks(mPeriod));
-  int e3 = (mCoreId > 0) ? rt_task_set_affinity(&mRtTask, &mCpuSet) : 0;
-  int e4 = rt_task_start(&mRtTask, &RtPeakCanReceiveTask::Routine, NULL);
+  int e2 = (mCoreId > 0) ? rt_task_set_affinity(&mRtTask, &mCpuSet) : 0;
+  int e3 = rt_task_start(&mRtTask, &RtPeakCanReceiveTask::Routine, this);
 
-  if(e1 | e2 | e3 | e4)
+  if(e1 | e2 | e3)
   {
     printf("Error with RtPeakCanReceiveTask::StartRoutine(). Exiting.\n");
-    exit(-1);
+    return -1;
   }
+  mStarted = true;
+  printf("%s running on CoreId: %d with %d ids\n", mName, mCoreId, mEngine->NumIds());
+  return 0;
 }
 
-void RtPeakCanReceiveTask::Routine(void*)
+void RtPeakCanReceiveTask::Routine(void *arg)
 {
-  TPCANRdMsg readMessage;
+  auto *task = static_cast<RtPeakCanReceiveTask*>(arg);
+  auto &engine = *task->mEngine;
+  auto *gateway = task->mGateway.get();
+  const int waitUs = task->mPeriod / RtTime::kNanosecondsToMicroseconds;
+
+  auto &device = *task->mDevice;
+  CanFrame frames[CanReceive::kMaxBatch];
 
+  RTIME oneSecondTimer = rt_timer_read();
   while(true)
   {
-    // read
-    if(LINUX_CAN_Read(mHandle, &readMessage))
+    auto numFrames = device.Read(frames, CanReceive::kMaxBatch, waitUs);
+
+    // a timeout returns no frames, an error is counted and backed off from so a dead
+    // channel does not spin the core
+    if(numFrames < 0)
     {
-      perror("RtPeakCanReceiveTask: error with LINUX_CAN_READ()");
-      exit(-1);
+      engine.RecordError();
+      rt_task_sleep(task->mPeriod);
+      numFrames = 0;
     }
 
-    // print
-    printf("%u.%u ", readMessage.dwTime, readMessage.wUsec);
-    PrintMessage(
-      "RtPeakCanReceiveTask::PrintReadMessage()", &(readMessage.Msg));
+    auto readNs = rt_timer_read();
+    for(auto i{0}; i < numFrames; ++i)
+    {
+      if(gateway)
+        gateway->Forward(task->mChannelIndex, frames[i], readNs);
+      engine.Receive(frames[i], readNs);
+    }
+    if(numFrames > 0)
+      engine.EndBatch(numFrames);
 
-    rt_task_wait_period(NULL);
+    RTIME now = rt_timer_read();
+    if(static_cast<long>(now - oneSecondTimer) / RtTime::kNanosecondsToSeconds > 0)
+    {
+      engine.PrintStats(task->mName, now - oneSecondTimer, rt_printf);
+      if(gateway)
+        gateway->PrintStats(task->mChannelIndex, task->mName, now - oneSecondTimer, rt_printf);
+      oneSecondTimer = now;
+    }
   }
 }
 
+void RtPeakCanReceiveTask::EnterSafeState(void *arg)
+{
+  auto *task = static_cast<RtPeakCanReceiveTask*>(arg);
+  if(task->mStarted)
+  {
+    rt_task_delete(&task->mRtTask);
+    task->mStarted = false;
+  }
+}
+
+int RtPeakCanReceiveTask::RegisterSafeState(SafeState &safeState)
+{
+  return safeState.Register(mName, &RtPeakCanReceiveTask::EnterSafeState, this);
+}
+
 RtPeakCanReceiveTask::~RtPeakCanReceiveTask()
 {}
@@ -4,19 +4,54 @@
 #include <stdlib.h>
 #include <sys/mman.h>
 
+#include <memory>
+
+#include <CanGateway.h>
+#include <CanReceiveEngine.h>
 #include <PeakCanTask.h>
+#include <RtMacro.h>
 #include <RtPeriodicTask.h>
+#include <SafeState.h>
 
+/*
+ * reader of one peak can channel
+ *
+ * the task sleeps in the device until a frame arrives, then drains everything
+ * pending (up to CanReceive::kMaxBatch frames) into mEngine before blocking again.
+ * mPeriod only bounds how long it blocks, so statistics are still printed on an
+ * idle bus. decoding happens wherever mEngine->Dispatch() is called.
+ *
+ * with a gateway every frame is first offered to mGateway as channel mChannelIndex,
+ * so forwarded frames leave before the engine or any decoder sees them.
+ *
+ * in the safe state the task stops, and with it the gateway writes to other channels.
+ * it registers after the transmit tasks of those channels, so it is stopped before
+ * they send their safe frames.
+ */
 class RtPeakCanReceiveTask : public PeakCanTask, public RtPeriodicTask
 {
+private:
+  bool mStarted;
+
+  static void EnterSafeState(void *task);
+
+public:
+  std::shared_ptr<CanReceiveEngine> mEngine;
+  std::shared_ptr<CanGateway> mGateway;
+  unsigned int mChannelIndex;
+
 public:
   RtPeakCanReceiveTask() = delete;
   RtPeakCanReceiveTask(const char *deviceName, const unsigned int baudRate,
     const char *name, const int stackSize, const int priority, const int mode,
     const int period, const int coreId);
+  RtPeakCanReceiveTask(std::shared_ptr<CanDevice> device,
+    const char *name, const int stackSize, const int priority, const int mode,
+    const int period, const int coreId);
 
   int StartRoutine();
   static void Routine(void*);
+  int RegisterSafeState(SafeState &safeState);
 
   ~RtPeakCanReceiveTask();
 };
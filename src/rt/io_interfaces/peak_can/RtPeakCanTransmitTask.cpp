@@ -1,44 +1,127 @@
 #include <RtPeakCanTransmitTask.h>
 
+#include <chrono>
+#include <thread>
+
+namespace {
+
+constexpr auto kSafeFrameAttempts = 10u; // a millisecond apart, for room in the driver queue
+
+} // namespace
+
 RtPeakCanTransmitTask::RtPeakCanTransmitTask(
   const char *deviceName, const unsigned int baudRate,
   const char *name, const int stackSize, const int priority, const int mode,
   const int period, const int coreId)
   : PeakCanTask::PeakCanTask(deviceName, baudRate)
   , RtPeriodicTask::RtPeriodicTask(name, stackSize, priority, mode, period, coreId)
+  , mStarted(false)
+  , mOverruns(0)
+{}
+
+RtPeakCanTransmitTask::RtPeakCanTransmitTask(
+  std::shared_ptr<CanDevice> device,
+  const char *name, const int stackSize, const int priority, const int mode,
+  const int period, const int coreId)
+  : PeakCanTask::PeakCanTask(device)
+  , RtPeriodicTask::RtPeriodicTask(name, stackSize, priority, mode, period, coreId)
+  , mStarted(false)
+  , mOverruns(0)
 {}
 
 int RtPeakCanTransmitTask::StartRoutine()
 {
+  if(!mSchedule || mSchedule->NumEntries() == 0)
+  {
+    printf("RtPeakCanTransmitTask: no schedule\n");
+    return -1;
+  }
+
   mlockall(MCL_CURRENT|MCL_FUTURE);
 
   int e1 = rt_task_create(&mRtTask, mName, mStackSize, mPriority, mMode);
   int e2 = rt_task_set_periodic(&mRtTask, TM_NOW, rt_timer_ns2ticks(mPeriod));
   int e3 = (mCoreId > 0) ? rt_task_set_affinity(&mRtTask, &mCpuSet) : 0;
-  int e4 = rt_task_start(&mRtTask, &Routine, NULL);
+  int e4 = rt_task_start(&mRtTask, &Routine, this);
 
   if(e1 | e2 | e3 | e4)
   {
     printf("Error with RtPeakCanTransmitTask::StartRoutine(). Exiting.\n");
-    exit(-1);
+    return -1;
   }
+  mStarted = true;
+  printf("%s running on CoreId: %d\n", mName, mCoreId);
+  mSchedule->PrintSchedule(mBitRate);
+  return 0;
 }
 
-void RtPeakCanTransmitTask::Routine(void*)
+void RtPeakCanTransmitTask::Routine(void *arg)
 {
-  TPCANMsg writeMessage;
-  writeMessage.ID = 0x123;
-  writeMessage.MSGTYPE = MSGTYPE_STANDARD;
-  writeMessage.LEN = 3;
-  writeMessage.DATA[0] = 0x1f;
-  writeMessage.DATA[1] = 0x2a;
-  writeMessage.DATA[2] = 0x3e;
+  auto *task = static_cast<RtPeakCanTransmitTask*>(arg);
+  auto &schedule = *task->mSchedule;
+
+  auto &device = *task->mDevice;
+  const uint16_t *entries;
+  unsigned long long tick{0};
+  unsigned long overruns{0};
 
+  RTIME oneSecondTimer = rt_timer_read();
   while(true)
   {
-    CAN_Write(mHandle, &writeMessage);
-    rt_task_wait_period(NULL);
+    auto numEntries = schedule.Slot(tick, &entries);
+    for(auto i{0u}; i < numEntries; ++i)
+    {
+      // never wait for room in the driver queue, that would delay the whole slot
+      auto sent = device.Write(&schedule.Prepare(entries[i]), 1);
+      schedule.RecordSend(entries[i], rt_timer_read(), sent == 1);
+    }
+
+    // missed ticks are skipped rather than sent late in a burst
+    overruns = 0;
+    rt_task_wait_period(&overruns);
+    task->mOverruns += overruns;
+    tick += 1 + overruns;
+
+    RTIME now = rt_timer_read();
+    if(static_cast<long>(now - oneSecondTimer) / RtTime::kNanosecondsToSeconds > 0)
+    {
+      rt_printf("%s: overruns: %llu\n", task->mName, task->mOverruns);
+      schedule.PrintStats(task->mName, now - oneSecondTimer, task->mBitRate, rt_printf);
+      oneSecondTimer = now;
+    }
+  }
+}
+
+void RtPeakCanTransmitTask::EnterSafeState(void *arg)
+{
+  auto *task = static_cast<RtPeakCanTransmitTask*>(arg);
+  if(task->mStarted)
+  {
+    rt_task_delete(&task->mRtTask);
+    task->mStarted = false;
   }
+
+  // the task is gone and the other writers were stopped before, see RegisterSafeState()
+  // of the receive tasks, so this thread has the device to itself
+  auto sent{0u};
+  for(auto attempt{0u}; attempt < kSafeFrameAttempts && sent < task->mSafeFrames.size();
+    ++attempt)
+  {
+    if(attempt > 0)
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    const auto written = task->mDevice->Write(task->mSafeFrames.data() + sent,
+      task->mSafeFrames.size() - sent);
+    if(written < 0)
+      break;
+    sent += written;
+  }
+  if(sent < task->mSafeFrames.size())
+    printf("%s: %u of %lu safe frames sent\n", task->mName, sent, task->mSafeFrames.size());
+}
+
+int RtPeakCanTransmitTask::RegisterSafeState(SafeState &safeState)
+{
+  return safeState.Register(mName, &RtPeakCanTransmitTask::EnterSafeState, this);
 }
 
 RtPeakCanTransmitTask::~RtPeakCanTransmitTask()
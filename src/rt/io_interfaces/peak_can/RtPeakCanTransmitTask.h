@@ -4,19 +4,49 @@
 #include <stdlib.h>
 #include <sys/mman.h>
 
+#include <memory>
+#include <vector>
+
+#include <CanTransmitSchedule.h>
 #include <PeakCanTask.h>
+#include <RtMacro.h>
 #include <RtPeriodicTask.h>
+#include <SafeState.h>
 
+/*
+ * sends the frames of mSchedule, mPeriod is the base tick of the schedule
+ * payloads are refreshed from their sources right before each frame is written and
+ * a full driver queue is counted against the frame instead of blocking the tick
+ *
+ * in the safe state the schedule stops and mSafeFrames go out once, so the bus either
+ * falls silent, which the receivers see as a timeout, or carries a last explicit state.
+ * every other writer of the device, such as a receive task forwarding gateway frames
+ * to it, must register its safe state after this task so it is stopped first.
+ */
 class RtPeakCanTransmitTask : public PeakCanTask, public RtPeriodicTask
 {
+private:
+  bool mStarted;
+
+  static void EnterSafeState(void *task);
+
+public:
+  std::shared_ptr<CanTransmitSchedule> mSchedule;
+  std::vector<CanFrame> mSafeFrames;
+  unsigned long long mOverruns;
+
 public:
   RtPeakCanTransmitTask() = delete;
   RtPeakCanTransmitTask(const char *deviceName, const unsigned int baudRate,
     const char* name, const int stackSize, const int priority, const int mode,
     const int period, const int coreId);
+  RtPeakCanTransmitTask(std::shared_ptr<CanDevice> device,
+    const char* name, const int stackSize, const int priority, const int mode,
+    const int period, const int coreId);
 
   int StartRoutine();
   static void Routine(void*);
+  int RegisterSafeState(SafeState &safeState);
 
   ~RtPeakCanTransmitTask();
 };
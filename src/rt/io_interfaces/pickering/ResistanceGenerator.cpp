@@ -0,0 +1,229 @@
+#include <ResistanceGenerator.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+ResistanceGenerator::ResistanceGenerator()
+  : mNumSubunits(0)
+  , mNumSignals(0)
+{}
+
+int ResistanceGenerator::Configure(const std::vector<std::shared_ptr<PxiCard>> &cards,
+  const unsigned int numSignals)
+{
+  if(numSignals == 0 || numSignals > ResistanceTable::kMaxSignals)
+  {
+    printf("ResistanceGenerator: %d signals requested, between 1 and %d supported\n",
+      numSignals, ResistanceTable::kMaxSignals);
+    return -1;
+  }
+
+  auto numSubunits{0u};
+  for(auto &card : cards)
+  {
+    for(auto subunit{0u}; subunit < card->mNumOutputSubunits; ++subunit)
+    {
+      if(numSubunits == PxiLimit::kMaxSharedSubunits)
+      {
+        printf("ResistanceGenerator: more than %d subunits\n", PxiLimit::kMaxSharedSubunits);
+        return -1;
+      }
+
+      auto &info = card->mOutputSubunits[subunit];
+      mMinOhm[numSubunits] = info.mMinOhm;
+      mMaxOhm[numSubunits] = info.mMaxOhm;
+      ++numSubunits;
+    }
+  }
+  mNumSubunits = numSubunits;
+  mNumSignals = numSignals;
+
+  // default: round robin over the signals with the original 2 * x + 10 ohm mapping, spanning
+  // the whole valid range of the subunit so that it only clamps where the card would
+  for(auto i{0u}; i < mNumSubunits; ++i)
+  {
+    auto minOhm = static_cast<double>(mMinOhm[i]);
+    auto maxOhm = (mMaxOhm[i] > mMinOhm[i]) ? static_cast<double>(mMaxOhm[i]) : minOhm + 2.;
+    ResistanceCalibration calibration{i % mNumSignals, 2,
+      {(minOhm - 10.) / 2., (maxOhm - 10.) / 2.}, {minOhm, maxOhm}};
+    mCalibrations[i] = calibration;
+    BuildTable(i);
+  }
+  return 0;
+}
+
+int ResistanceGenerator::SetCalibration(const unsigned int subunit,
+  const ResistanceCalibration &calibration)
+{
+  if(subunit >= mNumSubunits || calibration.mSignal >= mNumSignals ||
+    calibration.mNumBreakpoints == 0 ||
+    calibration.mNumBreakpoints > ResistanceTable::kMaxBreakpoints)
+  {
+    printf("ResistanceGenerator: invalid calibration for subunit %d\n", subunit);
+    return -1;
+  }
+
+  for(auto i{1u}; i < calibration.mNumBreakpoints; ++i)
+  {
+    if(!(calibration.mX[i] > calibration.mX[i - 1]))
+    {
+      printf("ResistanceGenerator: breakpoints of subunit %d are not increasing\n", subunit);
+      return -1;
+    }
+  }
+
+  mCalibrations[subunit] = calibration;
+  BuildTable(subunit);
+  return 0;
+}
+
+/*
+ * one subunit per line, '#' starts a comment:
+ *   <subunit index> <signal index> <x1> <ohm1> [<x2> <ohm2> ...]
+ * subunits not listed keep their current calibration
+ */
+int ResistanceGenerator::LoadCalibration(const char *path)
+{
+  auto *file = fopen(path, "r");
+  if(!file)
+  {
+    printf("ResistanceGenerator: could not open calibration file %s\n", path);
+    return -1;
+  }
+
+  char line[1024];
+  auto lineNum{0u};
+  auto loaded{0u};
+  auto result{0};
+  while(fgets(line, sizeof(line), file))
+  {
+    ++lineNum;
+    auto *comment = strchr(line, '#');
+    if(comment)
+      *comment = '\0';
+
+    char *cursor = line;
+    char *end;
+    auto subunit = strtoul(cursor, &end, 10);
+    if(end == cursor)
+      continue; // blank line
+    cursor = end;
+
+    ResistanceCalibration calibration{};
+    calibration.mSignal = strtoul(cursor, &end, 10);
+    if(end == cursor)
+    {
+      printf("ResistanceGenerator: %s:%d: missing signal index\n", path, lineNum);
+      result = -1;
+      break;
+    }
+    cursor = end;
+
+    while(calibration.mNumBreakpoints < ResistanceTable::kMaxBreakpoints)
+    {
+      auto x = strtod(cursor, &end);
+      if(end == cursor)
+        break;
+      cursor = end;
+      auto ohm = strtod(cursor, &end);
+      if(end == cursor)
+        break;
+      cursor = end;
+
+      calibration.mX[calibration.mNumBreakpoints] = x;
+      calibration.mOhm[calibration.mNumBreakpoints] = ohm;
+      ++calibration.mNumBreakpoints;
+    }
+
+    if(SetCalibration(subunit, calibration))
+    {
+      printf("ResistanceGenerator: %s:%d rejected\n", path, lineNum);
+      result = -1;
+      break;
+    }
+    ++loaded;
+  }
+  fclose(file);
+
+  if(result == 0)
+    printf("ResistanceGenerator: %d calibrations loaded from %s\n", loaded, path);
+  return result;
+}
+
+void ResistanceGenerator::BuildTable(const unsigned int subunit)
+{
+  auto &calibration = mCalibrations[subunit];
+  auto *table = mTables[subunit];
+  auto last = calibration.mNumBreakpoints - 1;
+
+  auto x0 = calibration.mX[0];
+  auto span = calibration.mX[last] - x0;
+  auto step = (last > 0) ? span / (ResistanceTable::kPoints - 1) : 0.;
+
+  mSignals[subunit] = calibration.mSignal;
+  mOffsets[subunit] = static_cast<float>(x0);
+  mScales[subunit] = (last > 0) ? static_cast<float>((ResistanceTable::kPoints - 1) / span) : 0.f;
+
+  auto segment{0u};
+  for(auto point{0u}; point < ResistanceTable::kPoints; ++point)
+  {
+    auto x = x0 + point * step;
+    while(segment + 1 < last && x > calibration.mX[segment + 1])
+    {
+      ++segment;
+    }
+
+    auto ohm = calibration.mOhm[segment];
+    if(last > 0)
+    {
+      auto fraction = (x - calibration.mX[segment]) /
+        (calibration.mX[segment + 1] - calibration.mX[segment]);
+      ohm += fraction * (calibration.mOhm[segment + 1] - calibration.mOhm[segment]);
+    }
+
+    // clamping here keeps every interpolated value within range as well
+    if(ohm < mMinOhm[subunit])
+      ohm = mMinOhm[subunit];
+    if(ohm > mMaxOhm[subunit])
+      ohm = mMaxOhm[subunit];
+    table[point] = static_cast<float>(ohm);
+  }
+  table[ResistanceTable::kPoints] = table[ResistanceTable::kPoints - 1];
+}
+
+void ResistanceGenerator::Generate(const double *signals, DWORD *resistances) const
+{
+  constexpr auto kLastPoint = static_cast<float>(ResistanceTable::kPoints - 1);
+
+  for(auto i{0u}; i < mNumSubunits; ++i)
+  {
+    auto position = (static_cast<float>(signals[mSignals[i]]) - mOffsets[i]) * mScales[i];
+
+    // written so that a nan signal lands on the first point
+    position = (position > 0.f) ? position : 0.f;
+    position = (position < kLastPoint) ? position : kLastPoint;
+
+    auto index = static_cast<int>(position);
+    auto fraction = position - index;
+    auto *table = mTables[i];
+    auto ohm = table[index] + fraction * (table[index + 1] - table[index]);
+
+    // via a signed 64 bit integer, a single instruction unlike float to unsigned
+    resistances[i] = static_cast<DWORD>(static_cast<long long>(ohm + 0.5f));
+  }
+}
+
+void ResistanceGenerator::PrintCalibration() const
+{
+  for(auto i{0u}; i < mNumSubunits; ++i)
+  {
+    auto &calibration = mCalibrations[i];
+    printf("subunit %3d <- signal %2d, range [%u, %u] ohm:", i, calibration.mSignal,
+      mMinOhm[i], mMaxOhm[i]);
+    for(auto j{0u}; j < calibration.mNumBreakpoints; ++j)
+    {
+      printf(" (%g, %g)", calibration.mX[j], calibration.mOhm[j]);
+    }
+    printf("\n");
+  }
+}
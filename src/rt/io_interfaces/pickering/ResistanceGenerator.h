@@ -0,0 +1,76 @@
+#ifndef _RESISTANCEGENERATOR_H_
+#define _RESISTANCEGENERATOR_H_
+
+#include <stdio.h>
+
+#include <memory>
+#include <vector>
+
+#include <PxiCard.h>
+#include <PxiTypes.h>
+
+namespace ResistanceTable
+{
+constexpr auto kMaxSignals = 32u;
+constexpr auto kMaxBreakpoints = 16u;
+constexpr auto kPoints = 128u; // uniform grid each calibration is resampled onto
+}
+
+/*
+ * calibration of one resistor subunit: model signal mSignal is mapped through the
+ * piecewise linear curve (mX[i], mOhm[i]), mX strictly increasing
+ * signals outside [mX[0], mX[n - 1]] hold the end values
+ */
+struct ResistanceCalibration
+{
+  unsigned int mSignal;
+  unsigned int mNumBreakpoints;
+  double mX[ResistanceTable::kMaxBreakpoints];
+  double mOhm[ResistanceTable::kMaxBreakpoints];
+};
+
+/*
+ * maps model output signals to the resistance of every output subunit of a set of
+ * cards, in the same order RtResistanceTask indexes the shared array
+ *
+ * calibration curves are resampled at configure time onto a uniform grid already
+ * clamped to each subunit's valid range, so a cycle is one multiply, one clamp and
+ * one lerp per subunit with no search, branch on the subunit type or allocation.
+ * Configure() and the calibration setters are not rt safe, Generate() is.
+ */
+class ResistanceGenerator
+{
+private:
+  // one row per subunit, padded by one point so the lerp never reads past the end
+  float mTables[PxiLimit::kMaxSharedSubunits][ResistanceTable::kPoints + 1];
+  float mOffsets[PxiLimit::kMaxSharedSubunits];
+  float mScales[PxiLimit::kMaxSharedSubunits];
+  unsigned int mSignals[PxiLimit::kMaxSharedSubunits];
+
+  DWORD mMinOhm[PxiLimit::kMaxSharedSubunits];
+  DWORD mMaxOhm[PxiLimit::kMaxSharedSubunits];
+  ResistanceCalibration mCalibrations[PxiLimit::kMaxSharedSubunits];
+
+  unsigned int mNumSubunits;
+  unsigned int mNumSignals;
+
+  void BuildTable(const unsigned int subunit);
+
+public:
+  ResistanceGenerator();
+
+  int Configure(const std::vector<std::shared_ptr<PxiCard>> &cards,
+    const unsigned int numSignals);
+  int SetCalibration(const unsigned int subunit, const ResistanceCalibration &calibration);
+  int LoadCalibration(const char *path);
+
+  // signals holds NumSignals() values, resistances receives NumSubunits() values
+  void Generate(const double *signals, DWORD *resistances) const;
+
+  unsigned int NumSubunits() const { return mNumSubunits; }
+  unsigned int NumSignals() const { return mNumSignals; }
+
+  void PrintCalibration() const;
+};
+
+#endif // _RESISTANCEGENERATOR_H_
@@ -1,9 +1,5 @@
 #include <RtGenerateResistanceArrayTask.h>
 
-// TODO: change name of RtsharedResistanceArray to something more generic
-std::shared_ptr<RtSharedArray> RtGenerateResistanceArrayTask::mRtSharedArray;
-testingModelClass RtGenerateResistanceArrayTask::mModel;
-
 RtGenerateResistanceArrayTask::RtGenerateResistanceArrayTask(
   const char* name, const int stackSize, const int priority, const int mode,
   const int period, const int coreId)
@@ -12,42 +8,65 @@ RtGenerateResistanceArrayTask::RtGenerateResistanceArrayTask(
 
 int RtGenerateResistanceArrayTask::StartRoutine()
 {
+  if(mGenerator.NumSubunits() == 0)
+  {
+    printf("RtGenerateResistanceArrayTask: generator not configured\n");
+    return -1;
+  }
+
   mlockall(MCL_CURRENT|MCL_FUTURE);
 
   int e1 = rt_task_create(&mRtTask, mName, mStackSize, mPriority, mMode);
   int e2 = rt_task_set_periodic(&mRtTask, TM_NOW, rt_timer_ns2ticks(mPeriod));
   int e3 = (mCoreId > 0) ? rt_task_set_affinity(&mRtTask, &mCpuSet) : 0;
-  int e4 = rt_task_start(&mRtTask, &Routine, NULL);
+  int e4 = rt_task_start(&mRtTask, &Routine, this);
 
   if(e1 | e2 | e3 | e4)
   {
     printf("Error with RtGenerateResistanceArrayTask::StartRoutine(). Exiting.\n");
     exit(-1);
   }
+  printf("%s running on CoreId: %d with %d signals, %d subunits\n", mName, mCoreId,
+    mGenerator.NumSignals(), mGenerator.NumSubunits());
+  return 0;
 }
 
-void RtGenerateResistanceArrayTask::Routine(void*)
+void RtGenerateResistanceArrayTask::Routine(void *arg)
 {
-  mModel.initialize();
+  auto *task = static_cast<RtGenerateResistanceArrayTask*>(arg);
+  task->mModel.initialize();
 
-  std::vector<DWORD> resistances;
+  double signals[ResistanceTable::kMaxSignals];
+  DWORD resistances[PxiLimit::kMaxSharedSubunits];
+  const auto numSignals = task->mGenerator.NumSignals();
+  const auto numSubunits = task->mGenerator.NumSubunits();
 
+  RTIME maxGenerateTime{0};
+  RTIME oneSecondTimer = rt_timer_read();
   while(true)
   {
-    resistances.clear();
-
-    // TODO: make 10u a size for share array
-    for(auto i{0u}; i < 10u; ++i)
+    RTIME generateBegin = rt_timer_read();
+    for(auto i{0u}; i < numSignals; ++i)
     {
-      mModel.step();
-      DWORD subunit = i;
-      DWORD resistance = mModel.testing_Y.Out1 * 2 + 10;
-
-      resistances.push_back(resistance);
+      task->mModel.step();
+      signals[i] = task->mModel.testing_Y.Out1;
     }
-    mRtSharedArray->SetArray(resistances);
+    task->mGenerator.Generate(signals, resistances);
+    task->mRtSharedArray->SetArray(resistances, numSubunits);
+
+    RTIME generateTime = rt_timer_read() - generateBegin;
+    if(generateTime > maxGenerateTime)
+      maxGenerateTime = generateTime;
 
     rt_task_wait_period(NULL);
+
+    RTIME now = rt_timer_read();
+    if(static_cast<long>(now - oneSecondTimer) / RtTime::kNanosecondsToSeconds > 0)
+    {
+      rt_printf("%s: max generate time: %llu ns\n", task->mName, maxGenerateTime);
+      maxGenerateTime = 0;
+      oneSecondTimer = now;
+    }
   }
 }
 
@@ -4,20 +4,28 @@
 #include <sys/mman.h>
 
 #include <memory>
-#include <vector>
 
 #include <alchemy/task.h>
 
+#include <ResistanceGenerator.h>
+#include <RtMacro.h>
 #include <RtPeriodicTask.h>
 #include <RtSharedArray.h>
 
 #include <testing.h>
 
+/*
+ * steps the model mGenerator.NumSignals() times per period, keeping each output as
+ * one signal, and publishes the resistances of every subunit in a single SetArray()
+ * mGenerator must be configured before StartRoutine()
+ */
 class RtGenerateResistanceArrayTask : public RtPeriodicTask
 {
 public:
-  static std::shared_ptr<RtSharedArray> mRtSharedArray;
-  static testingModelClass mModel;
+  std::shared_ptr<RtSharedArray> mRtSharedArray;
+  ResistanceGenerator mGenerator;
+  testingModelClass mModel;
+
 public:
   RtGenerateResistanceArrayTask() = delete;
   RtGenerateResistanceArrayTask(
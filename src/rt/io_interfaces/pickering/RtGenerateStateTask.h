@@ -10,8 +10,6 @@
 #include <RtPeriodicTask.h>
 #include <RtSharedState.h>
 
-#include <PxiCardTask.h>
-
 class RtGenerateStateTask: public RtPeriodicTask
 {
 public:
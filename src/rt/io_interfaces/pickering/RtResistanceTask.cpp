@@ -1,68 +1,107 @@
 #include <RtResistanceTask.h>
 
-std::shared_ptr<RtSharedArray> RtResistanceTask::mRtSharedArray;
-
 RtResistanceTask::RtResistanceTask(
   const char* name, const int stackSize, const int priority, const int mode,
   const int period, const int coreId)
   : RtPeriodicTask(name, stackSize, priority, mode, period, coreId)
+  , mProducer(-1)
 {}
 
+void RtResistanceTask::AddCard(std::shared_ptr<PxiCard> card)
+{
+  auto numSubunits = card->mNumOutputSubunits;
+  for(auto &addedCard : mCards)
+  {
+    numSubunits += addedCard->mNumOutputSubunits;
+  }
+
+  if(numSubunits > PxiLimit::kMaxSharedSubunits)
+  {
+    printf("RtResistanceTask: %d subunits do not fit the shared array, card #%d not added\n",
+      numSubunits, card->mCardNum);
+    return;
+  }
+  mCards.push_back(card);
+}
+
 int RtResistanceTask::StartRoutine()
 {
   mlockall(MCL_CURRENT|MCL_FUTURE);
 
+  // register every subunit before the task starts posting, each must land within a period
+  mProducer = mExecutor->RegisterProducer();
+  for(auto &card : mCards)
+  {
+    for(auto subunit{1u}; subunit <= card->mNumOutputSubunits; ++subunit)
+    {
+      auto handle = mExecutor->RegisterSubunit(mProducer, card, subunit, mPeriod);
+      if(handle < 0)
+      {
+        printf("Error registering RtResistanceTask subunits. Exiting.\n");
+        return -1;
+      }
+      mHandles.push_back(handle);
+    }
+  }
+
   int e1 = rt_task_create(&mRtTask, mName, mStackSize, mPriority, mMode);
   int e2 = rt_task_set_periodic(&mRtTask, TM_NOW, rt_timer_ns2ticks(mPeriod));
   int e3 = (mCoreId > 0) ? rt_task_set_affinity(&mRtTask, &mCpuSet) : 0;
-  int e4 = rt_task_start(&mRtTask, &Routine, NULL);
+  int e4 = rt_task_start(&mRtTask, &Routine, this);
 
    if(e1 | e2 | e3 | e4)
    {
      printf("Error launching periodic task SetSubunitResistanceRoutine. Exiting.\n");
      return -1;
    }
+   printf("%s running on CoreId: %d with %lu cards\n", mName, mCoreId, mCards.size());
+   return 0;
 }
 
-void RtResistanceTask::Routine(void*)
+void RtResistanceTask::Routine(void *arg)
 {
-  printf("Accessing bus %d, device %d, target resistance %d\n", mBus, mDevice, mResistance);
-  mPrevious = rt_timer_read();
+  auto *task = static_cast<RtResistanceTask*>(arg);
+
+  PxiCommandStatus status;
+  RTIME maxPostTime{0};
+  unsigned long long maxActuationNs{0};
+  auto completions{0u};
+  auto deadlineMisses{0u};
+
+  RTIME oneSecondTimer = rt_timer_read();
   while(true)
   {
-    for(auto i{0u}; i < mNumOutputSubunits; ++i)
+    RTIME postBegin = rt_timer_read();
+    for(auto i{0u}; i < task->mHandles.size(); ++i)
     {
-      PIL_ViewSub(mCardNum, i, mData);
-      auto previousResistance = mData[0];
-      mData[0] = mRtSharedArray->Get(i);
-      PIL_WriteSub(mCardNum, i, mData);
-
-      rt_task_wait_period(NULL);
-
-      mNow = rt_timer_read();
+      task->mExecutor->Post(task->mHandles[i], task->mRtSharedArray->Get(i));
+    }
+    RTIME postTime = rt_timer_read() - postBegin;
+    if(postTime > maxPostTime)
+      maxPostTime = postTime;
 
-      if(static_cast<long>(mNow - mOneSecondTimer) / RtTime::kNanosecondsToSeconds > 0)
-      {
-        printf("Time elapsed for task: %ld.%ld microseconds\n",
-          static_cast<long>(mNow - mPrevious) / RtTime::kNanosecondsToMicroseconds,
-          static_cast<long>(mNow - mPrevious) % RtTime::kNanosecondsToMicroseconds);
-        mOneSecondTimer = mNow;
+    while(task->mExecutor->PollStatus(task->mProducer, status))
+    {
+      ++completions;
+      if(status.mDeadlineMissed)
+        ++deadlineMisses;
+      if(status.mCompletedNs - status.mPostedNs > maxActuationNs)
+        maxActuationNs = status.mCompletedNs - status.mPostedNs;
+    }
 
-        /* show all subunits */
-        PIL_EnumerateSubs(mCardNum, &mNumInputSubunits, &mNumOutputSubunits);
-        for(auto i{0u}; i < mNumOutputSubunits; ++i)
-        {
-          BOOL out;
-          CHAR subType[100];
-          DWORD data[100];
-          PIL_SubType(mCardNum, i, out, subType);
-          PIL_ViewSub(mCardNum, i, data);
-          printf("Subunit #%d (%s) = %d Ohm\n", i, subType, data[0]);
-        }
-        printf("\n");
-      }
+    rt_task_wait_period(NULL);
 
-      mPrevious = mNow;
+    RTIME now = rt_timer_read();
+    if(static_cast<long>(now - oneSecondTimer) / RtTime::kNanosecondsToSeconds > 0)
+    {
+      rt_printf("%s: max post time: %llu ns, completions: %u, deadline misses: %u, "
+        "max actuation latency: %llu ns\n", task->mName, maxPostTime, completions,
+        deadlineMisses, maxActuationNs);
+      maxPostTime = 0;
+      maxActuationNs = 0;
+      completions = 0;
+      deadlineMisses = 0;
+      oneSecondTimer = now;
     }
   }
 }
@@ -4,23 +4,36 @@
 #include <sys/mman.h>
 
 #include <memory>
+#include <vector>
 
 #include <RtMacro.h>
 #include <RtPeriodicTask.h>
 #include <RtSharedArray.h>
 
-#include <PxiCardTask.h>
+#include <PxiCard.h>
+#include <PxiCommandExecutor.h>
 
-class RtResistanceTask: public RtPeriodicTask, public PxiCardTask
+/*
+ * drives the output subunits of one or more resistance cards from a shared array
+ * the subunits of each card take consecutive indices in mRtSharedArray, in the
+ * order the cards were added
+ * the task only posts the desired resistances, mExecutor applies them to the cards
+ */
+class RtResistanceTask: public RtPeriodicTask
 {
 public:
-  static std::shared_ptr<RtSharedArray> mRtSharedArray;
+  std::shared_ptr<RtSharedArray> mRtSharedArray;
+  std::shared_ptr<PxiCommandExecutor> mExecutor;
+  std::vector<std::shared_ptr<PxiCard>> mCards;
+  std::vector<int> mHandles;
+  int mProducer;
 
 public:
   RtResistanceTask() = delete;
   RtResistanceTask(
     const char* name, const int stackSize, const int priority, const int mode,
     const int period, const int coreId=0);
+  void AddCard(std::shared_ptr<PxiCard> card);
   int StartRoutine();
   static void Routine(void*);
   ~RtResistanceTask();
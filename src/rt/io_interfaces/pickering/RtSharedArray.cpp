@@ -1,5 +1,7 @@
 #include <RtSharedArray.h>
 
+#include <string.h>
+
 RtSharedArray::RtSharedArray(const char* name, const RTIME &timeout)
   : mName(name)
   , mTimeout(timeout)
@@ -14,14 +16,14 @@ void RtSharedArray::Set(unsigned int index, DWORD element)
   rt_mutex_release(&mMutex);
 }
 
-void RtSharedArray::SetArray(const std::vector<DWORD> &elements)
+int RtSharedArray::SetArray(const DWORD *elements, const unsigned int numElements)
 {
+  if(numElements > PxiLimit::kMaxSharedSubunits)
+    return -1;
   rt_mutex_acquire_until(&mMutex, mTimeout);
-  for(auto i{0u}; i < elements.size(); ++i)
-  {
-    mArray[i] = elements[i];
-  }
+  memcpy(mArray, elements, numElements * sizeof(DWORD));
   rt_mutex_release(&mMutex);
+  return 0;
 }
 
 DWORD RtSharedArray::Get(unsigned int index)
@@ -1,16 +1,15 @@
 #ifndef _RTSHAREDARRAY_H_
 #define _RTSHAREDARRAY_H_
 
-#include <vector>
-
 #include <alchemy/mutex.h>
 
-#include <Pilpxi.h>
+#include <PxiCard.h>
+#include <PxiTypes.h>
 
 class RtSharedArray
 {
 public:
-  DWORD mArray[100];
+  DWORD mArray[PxiLimit::kMaxSharedSubunits];
   RT_MUTEX mMutex;
   RTIME mTimeout;
   const char* mName;
@@ -19,7 +18,8 @@ public:
   RtSharedArray() = delete;
   RtSharedArray(const char* name, const RTIME &timeout=TM_INFINITE);
   void Set(unsigned int index, DWORD element);
-  void SetArray(const std::vector<DWORD> &elements);
+  // rejects more than kMaxSharedSubunits elements
+  int SetArray(const DWORD *elements, const unsigned int numElements);
   DWORD Get(unsigned int index);
 };
 
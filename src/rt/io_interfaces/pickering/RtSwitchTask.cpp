@@ -1,61 +1,89 @@
 #include <RtSwitchTask.h>
 
-std::shared_ptr<RtSharedState> RtSwitchTask::mRtSharedState;
-
 RtSwitchTask::RtSwitchTask(
   const char* name, const int stackSize, const int priority, const int mode,
   const int period, const int coreId)
   : RtPeriodicTask(name, stackSize, priority, mode, period, coreId)
+  , mProducer(-1)
 {}
 
+void RtSwitchTask::AddTarget(std::shared_ptr<PxiCard> card, const DWORD subunit, const DWORD bit)
+{
+  mTargets.push_back(PxiSwitchTarget{card, subunit, bit});
+}
+
 int RtSwitchTask::StartRoutine()
 {
   mlockall(MCL_CURRENT|MCL_FUTURE);
 
+  mProducer = mExecutor->RegisterProducer();
+  for(auto &target : mTargets)
+  {
+    auto handle = mExecutor->RegisterBit(
+      mProducer, target.mCard, target.mSubunit, target.mBit, mPeriod);
+    if(handle < 0)
+    {
+      printf("Error registering RtSwitchTask targets. Exiting.\n");
+      return -1;
+    }
+    mHandles.push_back(handle);
+  }
+
   int e1 = rt_task_create(&mRtTask, mName, mStackSize, mPriority, mMode);
   int e2 = rt_task_set_periodic(&mRtTask, TM_NOW, rt_timer_ns2ticks(mPeriod));
   int e3 = (mCoreId > 0) ? rt_task_set_affinity(&mRtTask, &mCpuSet) : 0;
-  int e4 = rt_task_start(&mRtTask, &Routine, NULL);
+  int e4 = rt_task_start(&mRtTask, &Routine, this);
 
   if(e1 | e2 | e3 | e4)
   {
     printf("Error launching periodic task SetSubunitSwitchState. Exiting.\n");
     return -1;
   }
-  printf("RtSwitchTask running on CoreId: %d\n", mCoreId);
+  printf("RtSwitchTask running on CoreId: %d with %lu targets\n", mCoreId, mTargets.size());
+  return 0;
 }
 
-void RtSwitchTask::Routine(void*)
+void RtSwitchTask::Routine(void *arg)
 {
-  printf("Accessing bus %d, device %d, target resistance %d\n", mBus, mDevice, mResistance);
-  mPrevious = rt_timer_read();
-  BOOL prevState;
+  auto *task = static_cast<RtSwitchTask*>(arg);
+
+  PxiCommandStatus status;
+  unsigned long long maxActuationNs{0};
+  auto completions{0u};
+  auto deadlineMisses{0u};
+
+  RTIME oneSecondTimer = rt_timer_read();
   while(true)
   {
-    // TODO: check how many bits are in the subunit
-    PIL_ViewBit(mCardNum, mSubunit, mBit, &prevState);
+    auto setState = task->mRtSharedState->Get();
 
-    auto setState = mRtSharedState->Get();
+    for(auto handle : task->mHandles)
+    {
+      task->mExecutor->Post(handle, setState);
+    }
 
-    PIL_OpBit(mCardNum, mSubunit, mBit, setState);
-    PIL_ViewBit(mCardNum, mSubunit, mBit, &mState);
+    while(task->mExecutor->PollStatus(task->mProducer, status))
+    {
+      ++completions;
+      if(status.mDeadlineMissed)
+        ++deadlineMisses;
+      if(status.mCompletedNs - status.mPostedNs > maxActuationNs)
+        maxActuationNs = status.mCompletedNs - status.mPostedNs;
+    }
 
     rt_task_wait_period(NULL);
 
-    mNow = rt_timer_read();
-
-    if(static_cast<long>(mNow - mOneSecondTimer) / RtTime::kNanosecondsToSeconds > 0)
+    RTIME now = rt_timer_read();
+    if(static_cast<long>(now - oneSecondTimer) / RtTime::kNanosecondsToSeconds > 0)
     {
-      printf("Time elapsed for task: %ld.%ld microseconds\n",
-        static_cast<long>(mNow - mPrevious) / RtTime::kNanosecondsToMicroseconds,
-        static_cast<long>(mNow - mPrevious) % RtTime::kNanosecondsToMicroseconds);
-
-      printf("State changed from %s -> %s (setState = %s)\n",
-        prevState ? "true" : "false", mState ? "true" : "false", setState ? "true" : "false");
-
-      mOneSecondTimer = mNow;
+      rt_printf("%s: setState = %s, completions: %u, deadline misses: %u, "
+        "max actuation latency: %llu ns\n", task->mName, setState ? "true" : "false",
+        completions, deadlineMisses, maxActuationNs);
+      maxActuationNs = 0;
+      completions = 0;
+      deadlineMisses = 0;
+      oneSecondTimer = now;
     }
-    mPrevious = mNow;
   }
 }
 
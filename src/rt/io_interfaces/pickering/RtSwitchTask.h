@@ -4,22 +4,40 @@
 #include <sys/mman.h>
 
 #include <memory>
+#include <vector>
 
 #include <RtMacro.h>
 #include <RtPeriodicTask.h>
 #include <RtSharedState.h>
 
-#include <PxiCardTask.h>
+#include <PxiCard.h>
+#include <PxiCommandExecutor.h>
 
-class RtSwitchTask: public RtPeriodicTask, public PxiCardTask
+struct PxiSwitchTarget
+{
+  std::shared_ptr<PxiCard> mCard;
+  DWORD mSubunit;
+  DWORD mBit;
+};
+
+/*
+ * drives one or more switch bits, possibly spread over several cards, to the shared state
+ * the task only posts the desired states, mExecutor applies them to the cards
+ */
+class RtSwitchTask: public RtPeriodicTask
 {
 public:
-  static std::shared_ptr<RtSharedState> mRtSharedState;
+  std::shared_ptr<RtSharedState> mRtSharedState;
+  std::shared_ptr<PxiCommandExecutor> mExecutor;
+  std::vector<PxiSwitchTarget> mTargets;
+  std::vector<int> mHandles;
+  int mProducer;
 
 public:
   RtSwitchTask(
     const char* name, const int stackSize, const int priority, const int mode,
     const int period, const int coreId=0);
+  void AddTarget(std::shared_ptr<PxiCard> card, const DWORD subunit, const DWORD bit);
   int StartRoutine();
   static void Routine(void*);
   ~RtSwitchTask();
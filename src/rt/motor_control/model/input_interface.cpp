@@ -5,21 +5,124 @@ auto constexpr kDummyDynoRPM = 5.5;
 namespace input_interface
 {
 
+static RtLatestValue<McuOutputSample> *mcuOutputSource = nullptr;
+static unsigned long long (*mcuOutputClock)() = nullptr;
+static unsigned long long mcuOutputEdgeNs = 0;
+static InputLatency mcuOutputLatency{};
+static RtLatestValue<DynoSensingSample> *dynoSensingSource = nullptr;
+static RtLatestValue<DynoSpeedSample> *dynoCmdSource = nullptr;
+static unsigned long long (*dynoCmdClock)() = nullptr;
+static unsigned long long dynoCmdEdgeNs = 0;
+static InputLatency dynoCmdLatency{};
+
 MsgDynoCmd GetMsgDynoCmd()
 {
   MsgDynoCmd MsgDynoCmdRetData;
   MsgDynoCmdRetData.ft_DynoRPM = kDummyDynoRPM;
+  if(!dynoCmdSource)
+    return MsgDynoCmdRetData;
+
+  DynoSpeedSample sample;
+  // a speed that only fell between edges has no new edge to measure
+  if(dynoCmdSource->Load(sample) && sample.edgeNs != dynoCmdEdgeNs)
+  {
+    dynoCmdEdgeNs = sample.edgeNs;
+    auto latencyNs = dynoCmdClock() - sample.edgeNs;
+    ++dynoCmdLatency.samples;
+    dynoCmdLatency.sumNs += latencyNs;
+    if(latencyNs > dynoCmdLatency.maxNs)
+      dynoCmdLatency.maxNs = latencyNs;
+  }
+  MsgDynoCmdRetData.ft_DynoRPM = sample.ft_DynoRPM;
   return MsgDynoCmdRetData;
 }
 
+void SetDynoCmdSource(RtLatestValue<DynoSpeedSample> *source, unsigned long long (*clock)())
+{
+  dynoCmdClock = clock;
+  dynoCmdSource = source;
+}
+
+InputLatency TakeDynoCmdLatency()
+{
+  auto latency = dynoCmdLatency;
+  dynoCmdLatency = InputLatency{};
+  return latency;
+}
+
 MsgDynoSensing GetMsgDynoSensing()
 {
-  return generated_model_DW.BusConversion_InsertedFor_MsgDynoSensing_at_inport_0_BusCreator1;
+  auto dynoSensing =
+    generated_model_DW.BusConversion_InsertedFor_MsgDynoSensing_at_inport_0_BusCreator1;
+  if(!dynoSensingSource)
+    return dynoSensing;
+
+  DynoSensingSample sample;
+  dynoSensingSource->Load(sample);
+
+  real32_T *fields[] = {&dynoSensing.ft_OutputTorqueS, &dynoSensing.ft_VoltageQ,
+    &dynoSensing.ft_VoltageD, &dynoSensing.ft_CurrentUS, &dynoSensing.ft_CurrentVS,
+    &dynoSensing.ft_CurrentWS};
+  for(auto i{0}; i < kNumDynoSensingFields; ++i)
+  {
+    if(sample.measured & (1u << i))
+      *fields[i] = sample.ft_Value[i];
+  }
+  return dynoSensing;
+}
+
+void SetDynoSensingSource(RtLatestValue<DynoSensingSample> *source)
+{
+  dynoSensingSource = source;
 }
 
 MsgMcuOutput GetMsgMcuOutput()
 {
-  return generated_model_DW.MsgMcuOutput_m;
+  if(!mcuOutputSource)
+    return generated_model_DW.MsgMcuOutput_m;
+
+  McuOutputSample sample;
+  if(!mcuOutputSource->Load(sample))
+    return generated_model_DW.MsgMcuOutput_m;
+
+  // the newest edge is the one that made this sample, a stalled or failed phase has none
+  auto edgeNs = sample.edgeNs[0];
+  for(auto phaseEdgeNs : sample.edgeNs)
+  {
+    edgeNs = (phaseEdgeNs > edgeNs) ? phaseEdgeNs : edgeNs;
+  }
+  if(edgeNs != mcuOutputEdgeNs)
+  {
+    mcuOutputEdgeNs = edgeNs;
+    auto latencyNs = mcuOutputClock() - edgeNs;
+    ++mcuOutputLatency.samples;
+    mcuOutputLatency.sumNs += latencyNs;
+    if(latencyNs > mcuOutputLatency.maxNs)
+      mcuOutputLatency.maxNs = latencyNs;
+  }
+
+  // a phase the capture does not measure drives nothing rather than its last duty
+  MsgMcuOutput mcuOutput;
+  real32_T *duties[] = {&mcuOutput.ft_DutyUPhase, &mcuOutput.ft_DutyVPhase,
+    &mcuOutput.ft_DutyWPhase};
+  for(auto i{0}; i < 3; ++i)
+  {
+    *duties[i] = (sample.measured & (1u << i)) ? sample.ft_DutyPercent[i] : 0.f;
+  }
+  return mcuOutput;
+}
+
+void SetMcuOutputSource(RtLatestValue<McuOutputSample> *source, unsigned long long (*clock)())
+{
+  mcuOutputClock = clock;
+  mcuOutputSource = source;
+}
+
+InputLatency TakeMcuOutputLatency()
+{
+  auto latency = mcuOutputLatency;
+  mcuOutputLatency = InputLatency{};
+  return latency;
 }
 
 MsgMotorOutput GetMsgMotorOutput()
@@ -7,15 +7,42 @@
 #include "generated_model.h"
 #include "generated_model_private.h"
 
+#include <MessageTypes.h>
+#include <RtLatestValue.h>
+
 namespace input_interface
 {
 
+// edge to model input of a measured source, taken by the model step
+struct InputLatency
+{
+  unsigned long long samples;
+  unsigned long long sumNs;
+  unsigned long long maxNs;
+};
+
 MsgDynoCmd GetMsgDynoCmd();
 
+// the dyno speed comes from source once set, clock is the one of the edge times
+void SetDynoCmdSource(RtLatestValue<DynoSpeedSample> *source, unsigned long long (*clock)());
+
+// latency since the previous call, call it from the thread that steps the model
+InputLatency TakeDynoCmdLatency();
+
 MsgDynoSensing GetMsgDynoSensing();
 
+// measured fields of MsgDynoSensing come from source once set, the others from the model
+void SetDynoSensingSource(RtLatestValue<DynoSensingSample> *source);
+
 MsgMcuOutput GetMsgMcuOutput();
 
+// duty cycles come from source once set, clock is the one of the edge times. a phase
+// the source does not measure, as after a capture error, reads 0 %
+void SetMcuOutputSource(RtLatestValue<McuOutputSample> *source, unsigned long long (*clock)());
+
+// latency since the previous call, call it from the thread that steps the model
+InputLatency TakeMcuOutputLatency();
+
 MsgMotorOutput GetMsgMotorOutput();
 
 void OutputMsgMotorOutput(const MsgMotorOutput& output);
@@ -29,4 +29,46 @@ struct MotorInputMessage
   float ft_CurrentWS;
 };
 
+// duty cycles captured from the mcu pwm outputs, one entry per phase u, v, w
+struct McuOutputSample
+{
+  unsigned long long sequence;
+  unsigned int measured; // bit per phase, none once the capture failed
+  unsigned int stalled; // bit per phase held high or low, at 100 or 0 % and 0 Hz
+  float ft_DutyPercent[3];
+  float ft_FrequencyHz[3];
+  unsigned long long edgeNs[3]; // rt clock time of the edge that completed the duty
+};
+
+// fields of MsgDynoSensing, in its order
+enum DynoSensingField
+{
+  kDynoOutputTorque,
+  kDynoVoltageQ,
+  kDynoVoltageD,
+  kDynoCurrentU,
+  kDynoCurrentV,
+  kDynoCurrentW,
+  kNumDynoSensingFields
+};
+
+// filtered dyno sensor channels, one entry per DynoSensingField
+struct DynoSensingSample
+{
+  unsigned long long sequence;
+  unsigned int measured; // bit per field, the others stay what the model computed
+  float ft_Value[kNumDynoSensingFields];
+  unsigned long long sampleNs[kNumDynoSensingFields]; // rt clock time of the newest ai scan
+};
+
+// dyno shaft speed and angle from its encoder, ft_DynoRPM is the MsgDynoCmd input
+struct DynoSpeedSample
+{
+  unsigned long long sequence;
+  float ft_DynoRPM;
+  float ft_AngleRad; // of the shaft, 0 at the start
+  long long position; // counts since the start
+  unsigned long long edgeNs; // rt clock time of the newest encoder edge
+};
+
 #endif // _MESSAGETYPES_H_
@@ -0,0 +1,61 @@
+#ifndef _RTLATESTVALUE_H_
+#define _RTLATESTVALUE_H_
+
+#include <atomic>
+#include <cstddef>
+
+/*
+ * lock-free single producer, single consumer latest value slot (triple buffer)
+ * the producer always overwrites, the consumer always gets the newest complete value.
+ * neither side waits for the other, so a slow reader never holds back the producer
+ * and a value is never torn. Load() without a new value returns the previous one.
+ */
+template <typename T>
+class RtLatestValue
+{
+private:
+  static constexpr unsigned int kIndexMask = 0x3;
+  static constexpr unsigned int kFresh = 0x4; // the middle slot holds an unread value
+  static constexpr std::size_t kCacheLine = 64;
+
+  T mSlots[3];
+  // padded rather than aligned, same as RtSpscRing
+  std::atomic<unsigned int> mMiddle; // index of the slot being handed over, plus kFresh
+  char mMiddlePadding[kCacheLine - sizeof(std::atomic<unsigned int>)];
+  unsigned int mBack; // slot the producer writes, owned by producer
+  char mBackPadding[kCacheLine - sizeof(unsigned int)];
+  unsigned int mFront; // slot the consumer reads, owned by consumer
+
+public:
+  RtLatestValue()
+    : mSlots{}
+    , mMiddle(1)
+    , mBack(0)
+    , mFront(2)
+  {}
+
+  RtLatestValue(const RtLatestValue&) = delete;
+  RtLatestValue& operator=(const RtLatestValue&) = delete;
+
+  void Store(const T &value)
+  {
+    mSlots[mBack] = value;
+    mBack = mMiddle.exchange(mBack | kFresh, std::memory_order_acq_rel) & kIndexMask;
+  }
+
+  // true when value is newer than the one of the previous call
+  bool Load(T &value)
+  {
+    if(!(mMiddle.load(std::memory_order_relaxed) & kFresh))
+    {
+      value = mSlots[mFront];
+      return false;
+    }
+
+    mFront = mMiddle.exchange(mFront, std::memory_order_acq_rel) & kIndexMask;
+    value = mSlots[mFront];
+    return true;
+  }
+};
+
+#endif // _RTLATESTVALUE_H_
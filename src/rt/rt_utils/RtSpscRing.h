@@ -0,0 +1,123 @@
+#ifndef _RTSPSCRING_H_
+#define _RTSPSCRING_H_
+
+#include <atomic>
+#include <cstddef>
+
+/*
+ * lock-free single producer, single consumer ring buffer
+ * neither side ever blocks or allocates, so it can be shared between an rt task
+ * and a non-rt thread without forcing the rt task into secondary mode
+ * kCapacity must be a power of two
+ */
+template <typename T, std::size_t kCapacity>
+class RtSpscRing
+{
+  static_assert(kCapacity > 0 && (kCapacity & (kCapacity - 1)) == 0,
+    "RtSpscRing capacity must be a power of two");
+
+private:
+  static constexpr std::size_t kMask = kCapacity - 1;
+  static constexpr std::size_t kCacheLine = 64;
+
+  // padded rather than aligned so the ring can be heap allocated without c++17 aligned new
+  std::atomic<std::size_t> mHead; // next slot to write, owned by producer
+  char mHeadPadding[kCacheLine - sizeof(std::atomic<std::size_t>)];
+  std::atomic<std::size_t> mTail; // next slot to read, owned by consumer
+  char mTailPadding[kCacheLine - sizeof(std::atomic<std::size_t>)];
+  T mBuffer[kCapacity];
+
+public:
+  RtSpscRing()
+    : mHead(0)
+    , mTail(0)
+  {}
+
+  RtSpscRing(const RtSpscRing&) = delete;
+  RtSpscRing& operator=(const RtSpscRing&) = delete;
+
+  bool Push(const T &element)
+  {
+    const auto head = mHead.load(std::memory_order_relaxed);
+    if(head - mTail.load(std::memory_order_acquire) == kCapacity)
+      return false;
+
+    mBuffer[head & kMask] = element;
+    mHead.store(head + 1, std::memory_order_release);
+    return true;
+  }
+
+  bool Pop(T &element)
+  {
+    const auto tail = mTail.load(std::memory_order_relaxed);
+    if(tail == mHead.load(std::memory_order_acquire))
+      return false;
+
+    element = mBuffer[tail & kMask];
+    mTail.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+
+  // pops up to maxElements in one go, publishing the new tail once
+  std::size_t PopBatch(T *elements, const std::size_t maxElements)
+  {
+    const auto tail = mTail.load(std::memory_order_relaxed);
+    auto available = mHead.load(std::memory_order_acquire) - tail;
+    if(available > maxElements)
+      available = maxElements;
+
+    for(auto i = std::size_t{0}; i < available; ++i)
+    {
+      elements[i] = mBuffer[(tail + i) & kMask];
+    }
+    mTail.store(tail + available, std::memory_order_release);
+    return available;
+  }
+
+  // in place push for large elements: the slot ahead places past the next one to
+  // fill, NULL when the ring has no room for it; Commit() publishes the filled slots
+  T *Reserve(const std::size_t ahead=0)
+  {
+    const auto head = mHead.load(std::memory_order_relaxed);
+    if(head + ahead - mTail.load(std::memory_order_acquire) >= kCapacity)
+      return NULL;
+    return &mBuffer[(head + ahead) & kMask];
+  }
+
+  void Commit(const std::size_t count=1)
+  {
+    mHead.store(mHead.load(std::memory_order_relaxed) + count, std::memory_order_release);
+  }
+
+  // in place pop: the element ahead places past the oldest, NULL when there is none;
+  // Release() frees the oldest slots
+  T *Peek(const std::size_t ahead=0)
+  {
+    const auto tail = mTail.load(std::memory_order_relaxed);
+    if(mHead.load(std::memory_order_acquire) - tail <= ahead)
+      return NULL;
+    return &mBuffer[(tail + ahead) & kMask];
+  }
+
+  void Release(const std::size_t count=1)
+  {
+    mTail.store(mTail.load(std::memory_order_relaxed) + count, std::memory_order_release);
+  }
+
+  std::size_t Size() const
+  {
+    return mHead.load(std::memory_order_acquire) - mTail.load(std::memory_order_acquire);
+  }
+
+  bool Empty() const
+  {
+    return Size() == 0;
+  }
+
+  static constexpr std::size_t Capacity()
+  {
+    return kCapacity;
+  }
+};
+
+#endif // _RTSPSCRING_H_
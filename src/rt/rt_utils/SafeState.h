@@ -0,0 +1,90 @@
+#ifndef _SAFESTATE_H_
+#define _SAFESTATE_H_
+
+#include <stdio.h>
+
+#include <atomic>
+
+namespace SafeStateLimit
+{
+constexpr auto kMaxHandlers = 16u;
+}
+
+// puts the outputs of one engine in their safe state
+typedef void (*SafeStateHandler)(void *context);
+
+/*
+ * the safe state of every output a process drives, entered once however the process stops
+ *
+ * each engine registers a handler for its own outputs at setup, and the termination
+ * handler calls Enter() before it tears anything down. the handlers run most recent
+ * first, as destructors would, so an engine registered after the outputs it feeds is
+ * stopped before they are made safe. outputs that have to reach their safe state also
+ * when no handler runs, on kill -9 or a hung rt task, sit behind a hardware watchdog
+ * the rt loop pets, as NiWatchdog does.
+ * handlers are registered before the rt tasks start, Enter() may then come from any thread.
+ */
+class SafeState
+{
+private:
+  struct Handler
+  {
+    const char *mName;
+    SafeStateHandler mHandler;
+    void *mContext;
+  };
+
+  Handler mHandlers[SafeStateLimit::kMaxHandlers];
+  unsigned int mNumHandlers;
+  std::atomic<bool> mEntered;
+
+public:
+  const char *mName;
+
+public:
+  explicit SafeState(const char *name)
+    : mNumHandlers(0)
+    , mEntered(false)
+    , mName(name)
+  {}
+
+  SafeState(const SafeState&) = delete;
+  SafeState& operator=(const SafeState&) = delete;
+
+  int Register(const char *name, SafeStateHandler handler, void *context)
+  {
+    if(mNumHandlers == SafeStateLimit::kMaxHandlers)
+    {
+      printf("%s: %u safe state handlers at most, %s has none.\n", mName,
+        SafeStateLimit::kMaxHandlers, name);
+      return -1;
+    }
+    mHandlers[mNumHandlers++] = Handler{name, handler, context};
+    return 0;
+  }
+
+  // runs every handler, false when the safe state was entered before
+  bool Enter(int (*print)(const char*, ...)=printf)
+  {
+    if(mEntered.exchange(true))
+      return false;
+    for(auto i{mNumHandlers}; i-- > 0;)
+    {
+      print("%s: %s to its safe state\n", mName, mHandlers[i].mName);
+      mHandlers[i].mHandler(mHandlers[i].mContext);
+    }
+    return true;
+  }
+
+  bool Entered() const
+  {
+    return mEntered.load();
+  }
+
+  unsigned int NumHandlers() const
+  {
+    return mNumHandlers;
+  }
+};
+
+#endif // _SAFESTATE_H_